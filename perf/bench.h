@@ -0,0 +1,110 @@
+#ifndef TARANTOOL_BENCH_H_INCLUDED
+#define TARANTOOL_BENCH_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Tiny micro-benchmark harness, see perf/CMakeLists.txt.
+ *
+ * Each measurement is reported as one JSON object per line:
+ *
+ *   {"name": "...", "iterations": N,
+ *    "ns_per_op": ..., "ops_per_sec": ...}
+ *
+ * so the output of `make bench` can be collected as is and
+ * trended over builds.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+static double bench_start_time;
+
+static inline double
+bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Start a measurement. */
+static inline void
+bench_start(void)
+{
+	bench_start_time = bench_now();
+}
+
+/**
+ * Finish a measurement of @a iterations operations started with
+ * bench_start() and report it.
+ */
+static inline void
+bench_stop(const char *name, long long iterations)
+{
+	double total = bench_now() - bench_start_time;
+	printf("{\"name\": \"%s\", \"iterations\": %lld, "
+	       "\"ns_per_op\": %.2f, \"ops_per_sec\": %.0f}\n",
+	       name, iterations, total * 1e9 / iterations,
+	       iterations / total);
+	fflush(stdout);
+}
+
+/**
+ * Consume a value so the compiler can't optimize away the loop
+ * that computed it.
+ */
+static inline void
+bench_blackhole(uint64_t value)
+{
+	__asm__ __volatile__("" : : "g"(value) : "memory");
+}
+
+/** A cheap xorshift64 generator to defeat the branch predictor. */
+static inline uint64_t
+bench_rand(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BENCH_H_INCLUDED */
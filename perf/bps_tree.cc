@@ -0,0 +1,89 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+static int
+compare(int64_t a, int64_t b)
+{
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+/* Settings match the memtx tree index. */
+#define BPS_TREE_NAME tree
+#define BPS_TREE_BLOCK_SIZE 512
+#define BPS_TREE_EXTENT_SIZE 16 * 1024
+#define BPS_TREE_IS_IDENTICAL(a, b) (a == b)
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t int64_t
+#define bps_tree_key_t int64_t
+#define bps_tree_arg_t int
+#include "salad/bps_tree.h"
+
+enum {
+	/** Number of elements in the tree under test. */
+	TREE_SIZE = 1024 * 1024,
+	/** Number of measured lookups. */
+	LOOKUP_COUNT = 4 * 1024 * 1024,
+};
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void)ctx;
+	return malloc(BPS_TREE_EXTENT_SIZE);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void)ctx;
+	free(extent);
+}
+
+int
+main(void)
+{
+	struct tree tree;
+	tree_create(&tree, 0, extent_alloc, extent_free, NULL);
+
+	uint64_t state = 42;
+	bench_start();
+	for (int64_t i = 0; i < TREE_SIZE; i++) {
+		int64_t key = bench_rand(&state) % (TREE_SIZE * 16);
+		tree_insert(&tree, key, NULL);
+	}
+	bench_stop("bps_tree.insert.random", TREE_SIZE);
+
+	state = 42;
+	uint64_t found = 0;
+	bench_start();
+	for (int64_t i = 0; i < LOOKUP_COUNT; i++) {
+		int64_t key = bench_rand(&state) % (TREE_SIZE * 16);
+		found += tree_find(&tree, key) != NULL;
+	}
+	bench_stop("bps_tree.find.random", LOOKUP_COUNT);
+	bench_blackhole(found);
+
+	uint64_t sum = 0;
+	size_t count = 0;
+	bench_start();
+	struct tree_iterator it = tree_iterator_first(&tree);
+	int64_t *elem;
+	while ((elem = tree_iterator_get_elem(&tree, &it)) != NULL) {
+		sum += *elem;
+		count++;
+		tree_iterator_next(&tree, &it);
+	}
+	bench_stop("bps_tree.iterate.full", count);
+	bench_blackhole(sum);
+
+	bench_start();
+	for (int64_t i = 0; i < TREE_SIZE; i++)
+		tree_insert(&tree, TREE_SIZE * 16 + i, NULL);
+	bench_stop("bps_tree.insert.sequential", TREE_SIZE);
+
+	tree_destroy(&tree);
+	return 0;
+}
@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "crc32.h"
+
+#include "bench.h"
+
+enum {
+	/** A WAL-page-like payload size. */
+	BUF_SIZE = 64 * 1024,
+	/** Number of checksummed buffers measured. */
+	ROUND_COUNT = 64 * 1024,
+};
+
+int
+main(void)
+{
+	/* Picks the hardware implementation when available. */
+	crc32_init();
+
+	char *buf = malloc(BUF_SIZE);
+	if (buf == NULL)
+		return EXIT_FAILURE;
+	uint64_t state = 42;
+	for (size_t i = 0; i < BUF_SIZE; i++)
+		buf[i] = bench_rand(&state);
+
+	uint32_t crc = 0;
+	bench_start();
+	for (int round = 0; round < ROUND_COUNT; round++)
+		crc = crc32_calc(crc, buf, BUF_SIZE);
+	bench_stop("crc32_calc.64k", ROUND_COUNT);
+	bench_blackhole(crc);
+
+	/* Short rows: header-sized inputs stress the call overhead. */
+	crc = 0;
+	bench_start();
+	for (int round = 0; round < ROUND_COUNT * 16; round++)
+		crc = crc32_calc(crc, buf + (round % BUF_SIZE / 2), 52);
+	bench_stop("crc32_calc.row_header", ROUND_COUNT * 16);
+	bench_blackhole(crc);
+
+	free(buf);
+	return 0;
+}
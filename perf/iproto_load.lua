@@ -0,0 +1,209 @@
+#!/usr/bin/env tarantool
+--
+-- End-to-end iproto load benchmark.
+--
+-- The script boots a box instance, preloads a memtx space and
+-- drives it over real iproto connections with a configurable
+-- request mix and key distribution, so a change to iproto, txn
+-- or memtx can be checked against a reproducible load.
+--
+-- Everything is configured through environment variables:
+--
+--   BENCH_PORT      listen port               (default 3391)
+--   BENCH_CLIENTS   client connections        (default 16)
+--   BENCH_REQUESTS  requests per client       (default 100000)
+--   BENCH_KEYS      key space size            (default 1000000)
+--   BENCH_MIX       request mix in percent    (default get=50,replace=40,update=10)
+--   BENCH_DIST      uniform | zipfian         (default uniform)
+--   BENCH_ALPHA     zipfian skew              (default 0.99)
+--   BENCH_WAL       wal_mode for the instance (default none)
+--
+-- The result is printed as one JSON object per line in the same
+-- format as the C micro-benchmarks (see bench.h), followed by an
+-- object with latency percentiles in microseconds.
+--
+local clock = require('clock')
+local fiber = require('fiber')
+local fio = require('fio')
+local json = require('json')
+local net_box = require('net.box')
+
+local function getenv_num(name, default)
+    return tonumber(os.getenv(name)) or default
+end
+
+local port = getenv_num('BENCH_PORT', 3391)
+local n_clients = getenv_num('BENCH_CLIENTS', 16)
+local n_requests = getenv_num('BENCH_REQUESTS', 100000)
+local n_keys = getenv_num('BENCH_KEYS', 1000000)
+local mix_str = os.getenv('BENCH_MIX') or 'get=50,replace=40,update=10'
+local dist = os.getenv('BENCH_DIST') or 'uniform'
+local alpha = getenv_num('BENCH_ALPHA', 0.99)
+local wal_mode = os.getenv('BENCH_WAL') or 'none'
+
+--
+-- Parse 'get=50,replace=40,update=10' into a lookup table mapping
+-- a percent bucket to a request kind.
+--
+local function parse_mix(str)
+    local mix = {}
+    local total = 0
+    for kind, percent in str:gmatch('(%a+)=(%d+)') do
+        total = total + tonumber(percent)
+        table.insert(mix, {kind = kind, upto = total})
+    end
+    if total ~= 100 then
+        error('BENCH_MIX percents must sum up to 100')
+    end
+    return mix
+end
+
+local mix = parse_mix(mix_str)
+
+--
+-- Key distributions. The zipfian sampler inverts a precomputed
+-- CDF with a binary search - sampling is O(log n) and the table
+-- is built once.
+--
+local sample_key
+if dist == 'uniform' then
+    sample_key = function()
+        return math.random(n_keys)
+    end
+elseif dist == 'zipfian' then
+    local cdf = {}
+    local sum = 0
+    for i = 1, n_keys do
+        sum = sum + 1 / i ^ alpha
+        cdf[i] = sum
+    end
+    sample_key = function()
+        local x = math.random() * sum
+        local lo, hi = 1, n_keys
+        while lo < hi do
+            local mid = math.floor((lo + hi) / 2)
+            if cdf[mid] < x then
+                lo = mid + 1
+            else
+                hi = mid
+            end
+        end
+        return lo
+    end
+else
+    error('BENCH_DIST must be uniform or zipfian')
+end
+
+--
+-- Log-scale latency histogram, same bucketing idea as
+-- histogram.c latency buckets: powers of two microseconds split
+-- into 4 sub-buckets each. Percentile resolution is ~25%, which
+-- is enough to trend p99 across builds.
+--
+local hist = {counts = {}, total = 0, max = 0}
+
+local function hist_collect(usec)
+    local bucket = 1
+    local bound = 1
+    while bound < usec and bucket < 128 do
+        bucket = bucket + 1
+        bound = 2 ^ math.floor(bucket / 4) * (1 + bucket % 4 / 4)
+    end
+    hist.counts[bucket] = (hist.counts[bucket] or 0) + 1
+    hist.total = hist.total + 1
+    if usec > hist.max then
+        hist.max = usec
+    end
+end
+
+local function hist_percentile(pct)
+    local need = hist.total * pct / 100
+    local seen = 0
+    for bucket = 1, 128 do
+        seen = seen + (hist.counts[bucket] or 0)
+        if seen >= need then
+            return 2 ^ math.floor(bucket / 4) * (1 + bucket % 4 / 4)
+        end
+    end
+    return hist.max
+end
+
+--
+-- Boot the instance in a scratch directory.
+--
+local dir = fio.tempdir()
+box.cfg{
+    listen = '127.0.0.1:' .. port,
+    wal_mode = wal_mode,
+    work_dir = dir,
+    memtx_memory = 1024 * 1024 * 1024,
+    log_level = 2,
+}
+box.schema.user.grant('guest', 'read,write,execute', 'universe',
+                      nil, {if_not_exists = true})
+local space = box.schema.space.create('bench', {if_not_exists = true})
+space:create_index('pk', {parts = {1, 'unsigned'}, if_not_exists = true})
+
+for i = 1, n_keys do
+    space:replace{i, i, 'payload-payload-payload'}
+end
+
+--
+-- The clients.
+--
+local function client_f(done)
+    local conn = net_box.connect('127.0.0.1:' .. port)
+    local bench = conn.space.bench
+    for _ = 1, n_requests do
+        local key = sample_key()
+        local slot = math.random(100)
+        local start = clock.monotonic64()
+        for _, entry in ipairs(mix) do
+            if slot <= entry.upto then
+                if entry.kind == 'get' then
+                    bench:get{key}
+                elseif entry.kind == 'replace' then
+                    bench:replace{key, key, 'payload-payload-payload'}
+                elseif entry.kind == 'update' then
+                    bench:update({key}, {{'+', 2, 1}})
+                else
+                    error('unknown request kind: ' .. entry.kind)
+                end
+                break
+            end
+        end
+        hist_collect(tonumber(clock.monotonic64() - start) / 1000)
+    end
+    conn:close()
+    done:put(true)
+end
+
+math.randomseed(42)
+local done = fiber.channel(n_clients)
+local start = clock.monotonic()
+for _ = 1, n_clients do
+    fiber.create(client_f, done)
+end
+for _ = 1, n_clients do
+    done:get()
+end
+local elapsed = clock.monotonic() - start
+
+local total = n_clients * n_requests
+print(json.encode({
+    name = 'iproto_load.' .. mix_str .. '.' .. dist,
+    iterations = total,
+    ns_per_op = elapsed * 1e9 / total,
+    ops_per_sec = math.floor(total / elapsed),
+}))
+print(json.encode({
+    name = 'iproto_load.latency_us',
+    p50 = hist_percentile(50),
+    p90 = hist_percentile(90),
+    p99 = hist_percentile(99),
+    p999 = hist_percentile(99.9),
+    max = hist.max,
+}))
+
+fio.rmtree(dir)
+os.exit(0)
@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+static const size_t light_extent_size = 16 * 1024;
+
+static uint32_t
+hash(uint64_t value)
+{
+	/* Don't feed the hash table perfectly spread hashes. */
+	return (uint32_t)(value * 2654435761ULL);
+}
+
+#define LIGHT_NAME
+#define LIGHT_DATA_TYPE uint64_t
+#define LIGHT_KEY_TYPE uint64_t
+#define LIGHT_CMP_ARG_TYPE int
+#define LIGHT_EQUAL(a, b, arg) ((a) == (b))
+#define LIGHT_EQUAL_KEY(a, b, arg) ((a) == (b))
+#include "salad/light.h"
+
+enum {
+	/** Number of elements in the hash table under test. */
+	TABLE_SIZE = 1024 * 1024,
+	/** Number of measured probes. */
+	PROBE_COUNT = 4 * 1024 * 1024,
+};
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void)ctx;
+	return malloc(light_extent_size);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void)ctx;
+	free(extent);
+}
+
+int
+main(void)
+{
+	struct light_core ht;
+	light_create(&ht, light_extent_size, extent_alloc, extent_free,
+		     NULL, 0);
+
+	bench_start();
+	for (uint64_t i = 0; i < TABLE_SIZE; i++)
+		light_insert(&ht, hash(i), i);
+	bench_stop("light.insert", TABLE_SIZE);
+
+	uint64_t state = 42;
+	uint64_t found = 0;
+	bench_start();
+	for (uint64_t i = 0; i < PROBE_COUNT; i++) {
+		uint64_t key = bench_rand(&state) % TABLE_SIZE;
+		found += light_find(&ht, hash(key), key) != light_end;
+	}
+	bench_stop("light.find.hit", PROBE_COUNT);
+	bench_blackhole(found);
+
+	found = 0;
+	state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < PROBE_COUNT; i++) {
+		uint64_t key = TABLE_SIZE + bench_rand(&state) % TABLE_SIZE;
+		found += light_find(&ht, hash(key), key) != light_end;
+	}
+	bench_stop("light.find.miss", PROBE_COUNT);
+	bench_blackhole(found);
+
+	light_destroy(&ht);
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <msgpuck.h>
+
+#include "bench.h"
+
+enum {
+	/** Number of tuples encoded into the checked buffer. */
+	TUPLE_COUNT = 64 * 1024,
+	/** Number of full buffer validations measured. */
+	ROUND_COUNT = 64,
+};
+
+int
+main(void)
+{
+	/*
+	 * Encode a typical flat tuple stream: small arrays of
+	 * integers and short strings, like a secondary index key
+	 * block or an iproto batch.
+	 */
+	size_t size = TUPLE_COUNT * 64;
+	char *buf = malloc(size);
+	if (buf == NULL)
+		return EXIT_FAILURE;
+	char *d = buf;
+	for (uint64_t i = 0; i < TUPLE_COUNT; i++) {
+		d = mp_encode_array(d, 4);
+		d = mp_encode_uint(d, i);
+		d = mp_encode_uint(d, i * 1000000);
+		d = mp_encode_str(d, "abcdefghijklmnop", 16);
+		d = mp_encode_double(d, i * 0.5);
+	}
+
+	uint64_t failures = 0;
+	bench_start();
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		const char *pos = buf;
+		for (uint64_t i = 0; i < TUPLE_COUNT; i++)
+			failures += mp_check(&pos, d) != 0;
+	}
+	bench_stop("mp_check.tuple", (long long)ROUND_COUNT * TUPLE_COUNT);
+	bench_blackhole(failures);
+
+	uint64_t sum = 0;
+	bench_start();
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		const char *pos = buf;
+		for (uint64_t i = 0; i < TUPLE_COUNT; i++) {
+			mp_next(&pos);
+			sum += (uintptr_t)pos;
+		}
+	}
+	bench_stop("mp_next.tuple", (long long)ROUND_COUNT * TUPLE_COUNT);
+	bench_blackhole(sum);
+
+	free(buf);
+	return 0;
+}
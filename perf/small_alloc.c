@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <small/quota.h>
+#include <small/slab_arena.h>
+#include <small/slab_cache.h>
+#include <small/small.h>
+
+#include "bench.h"
+
+enum {
+	SLAB_SIZE = 4 * 1024 * 1024,
+	OBJSIZE_MIN = 16,
+	/** Number of objects alive at a time. */
+	POOL_SIZE = 256 * 1024,
+	/** Number of measured alloc/free cycles. */
+	CYCLE_COUNT = 4 * 1024 * 1024,
+	/** Spread of object sizes, memtx tuple-like. */
+	OBJSIZE_MAX = 512,
+};
+
+static const float ALLOC_FACTOR = 1.05;
+
+int
+main(void)
+{
+	struct quota quota;
+	struct slab_arena arena;
+	struct slab_cache cache;
+	struct small_alloc alloc;
+
+	quota_init(&quota, QUOTA_MAX);
+	slab_arena_create(&arena, &quota, 0, SLAB_SIZE, SLAB_ARENA_PRIVATE);
+	slab_cache_create(&cache, &arena);
+	small_alloc_create(&alloc, &cache, OBJSIZE_MIN, ALLOC_FACTOR);
+
+	struct obj {
+		void *ptr;
+		size_t size;
+	};
+	struct obj *objs = calloc(POOL_SIZE, sizeof(*objs));
+	if (objs == NULL)
+		return EXIT_FAILURE;
+
+	/*
+	 * Steady state: a pool of live objects with random
+	 * replacement, the way a loaded memtx arena behaves, as
+	 * opposed to a pure LIFO pattern that never leaves the
+	 * hottest slab.
+	 */
+	uint64_t state = 42;
+	bench_start();
+	for (int i = 0; i < CYCLE_COUNT; i++) {
+		struct obj *obj = &objs[bench_rand(&state) % POOL_SIZE];
+		if (obj->ptr != NULL)
+			smfree(&alloc, obj->ptr, obj->size);
+		obj->size = OBJSIZE_MIN +
+			bench_rand(&state) % (OBJSIZE_MAX - OBJSIZE_MIN);
+		obj->ptr = smalloc(&alloc, obj->size);
+		if (obj->ptr == NULL)
+			return EXIT_FAILURE;
+	}
+	bench_stop("small.alloc_free.random", CYCLE_COUNT);
+
+	for (int i = 0; i < POOL_SIZE; i++) {
+		if (objs[i].ptr != NULL)
+			smfree(&alloc, objs[i].ptr, objs[i].size);
+	}
+	free(objs);
+
+	small_alloc_destroy(&alloc);
+	slab_cache_destroy(&cache);
+	slab_arena_destroy(&arena);
+	return 0;
+}
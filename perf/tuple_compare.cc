@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <msgpuck.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "tuple.h"
+#include "key_def.h"
+
+#include "bench.h"
+
+enum {
+	/** Number of tuples in each compared set. */
+	TUPLE_COUNT = 64 * 1024,
+	/** Number of measured comparisons. */
+	COMPARE_COUNT = 16 * 1024 * 1024,
+};
+
+static struct key_part_def key_part_unsigned = {
+	/* .fieldno = */ 0,
+	/* .type = */ FIELD_TYPE_UNSIGNED,
+	/* .coll_id = */ COLL_NONE,
+	/* .is_nullable = */ false,
+	/* .nullable_action = */ ON_CONFLICT_ACTION_DEFAULT,
+	/* .sort_order = */ SORT_ORDER_ASC,
+	/* .path = */ NULL,
+};
+
+static struct key_part_def key_part_string = {
+	/* .fieldno = */ 1,
+	/* .type = */ FIELD_TYPE_STRING,
+	/* .coll_id = */ COLL_NONE,
+	/* .is_nullable = */ false,
+	/* .nullable_action = */ ON_CONFLICT_ACTION_DEFAULT,
+	/* .sort_order = */ SORT_ORDER_ASC,
+	/* .path = */ NULL,
+};
+
+static struct tuple **
+create_tuples(void)
+{
+	struct tuple **tuples =
+		(struct tuple **)calloc(TUPLE_COUNT, sizeof(*tuples));
+	if (tuples == NULL)
+		return NULL;
+	uint64_t state = 42;
+	char buf[64];
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		char str[17];
+		snprintf(str, sizeof(str), "%016llx",
+			 (unsigned long long)bench_rand(&state));
+		char *d = buf;
+		d = mp_encode_array(d, 2);
+		d = mp_encode_uint(d, bench_rand(&state));
+		d = mp_encode_str(d, str, 16);
+		struct tuple *tuple =
+			tuple_new(box_tuple_format_default(), buf, d);
+		if (tuple == NULL)
+			return NULL;
+		tuple_ref(tuple);
+		tuples[i] = tuple;
+	}
+	return tuples;
+}
+
+static void
+bench_compare(const char *name, struct tuple **tuples, struct key_def *def)
+{
+	uint64_t state = 42;
+	int64_t sum = 0;
+	bench_start();
+	for (int i = 0; i < COMPARE_COUNT; i++) {
+		struct tuple *a = tuples[bench_rand(&state) % TUPLE_COUNT];
+		struct tuple *b = tuples[bench_rand(&state) % TUPLE_COUNT];
+		sum += tuple_compare(a, HINT_NONE, b, HINT_NONE, def);
+	}
+	bench_stop(name, COMPARE_COUNT);
+	bench_blackhole(sum);
+}
+
+static void
+bench_compare_hinted(const char *name, struct tuple **tuples,
+		     struct key_def *def)
+{
+	hint_t *hints = (hint_t *)calloc(TUPLE_COUNT, sizeof(*hints));
+	if (hints == NULL)
+		return;
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		hints[i] = tuple_hint(tuples[i], def);
+	uint64_t state = 42;
+	int64_t sum = 0;
+	bench_start();
+	for (int i = 0; i < COMPARE_COUNT; i++) {
+		uint32_t ia = bench_rand(&state) % TUPLE_COUNT;
+		uint32_t ib = bench_rand(&state) % TUPLE_COUNT;
+		sum += tuple_compare(tuples[ia], hints[ia],
+				     tuples[ib], hints[ib], def);
+	}
+	bench_stop(name, COMPARE_COUNT);
+	bench_blackhole(sum);
+	free(hints);
+}
+
+int
+main(void)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+
+	struct tuple **tuples = create_tuples();
+	if (tuples == NULL)
+		return EXIT_FAILURE;
+
+	struct key_def *def_unsigned =
+		key_def_new(&key_part_unsigned, 1, false);
+	struct key_def *def_string = key_def_new(&key_part_string, 1, false);
+	if (def_unsigned == NULL || def_string == NULL)
+		return EXIT_FAILURE;
+
+	bench_compare("tuple_compare.unsigned", tuples, def_unsigned);
+	bench_compare_hinted("tuple_compare.unsigned.hinted", tuples,
+			     def_unsigned);
+	bench_compare("tuple_compare.string", tuples, def_string);
+	bench_compare_hinted("tuple_compare.string.hinted", tuples,
+			     def_string);
+
+	key_def_delete(def_unsigned);
+	key_def_delete(def_string);
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		tuple_unref(tuples[i]);
+	free(tuples);
+
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -687,6 +687,7 @@ space_swap_triggers(struct space *new_space, struct space *old_space)
 {
 	rlist_swap(&new_space->before_replace, &old_space->before_replace);
 	rlist_swap(&new_space->on_replace, &old_space->on_replace);
+	rlist_swap(&new_space->on_replace_batch, &old_space->on_replace_batch);
 	/** Swap SQL Triggers pointer. */
 	struct sql_trigger *new_value = new_space->sql_triggers;
 	new_space->sql_triggers = old_space->sql_triggers;
@@ -2881,10 +2882,11 @@ on_replace_dd_truncate(struct trigger * /* trigger */, void *event)
 
 	/*
 	 * Modify the WAL header to prohibit
-	 * replication of local & temporary
-	 * spaces truncation.
+	 * replication of local, temporary and
+	 * non-journalled spaces truncation.
 	 */
 	if (space_is_temporary(old_space) ||
+	    space_is_wal_disabled(old_space) ||
 	    space_group_id(old_space) == GROUP_LOCAL) {
 		stmt->row->group_id = GROUP_LOCAL;
 	}
@@ -4506,6 +4508,8 @@ on_replace_dd_sequence(struct trigger * /* trigger */, void *event)
 		if (on_commit == NULL || on_rollback == NULL)
 			return -1;
 		seq->def = new_def;
+		/* The leased range was made under the old rules. */
+		sequence_lease_discard(seq);
 		txn_stmt_on_commit(stmt, on_commit);
 		txn_stmt_on_rollback(stmt, on_rollback);
 	}
@@ -4534,6 +4538,20 @@ on_drop_sequence_data_rollback(struct trigger *trigger, void * /* event */)
 	return 0;
 }
 
+/** Discard the leased sequence value range on rollback. */
+static int
+on_sequence_data_rollback(struct trigger *trigger, void * /* event */)
+{
+	struct tuple *tuple = (struct tuple *)trigger->data;
+	uint32_t id;
+	if (tuple_field_u32(tuple, BOX_SEQUENCE_DATA_FIELD_ID, &id) != 0)
+		return -1;
+	struct sequence *seq = sequence_by_id(id);
+	if (seq != NULL)
+		sequence_lease_discard(seq);
+	return 0;
+}
+
 /**
  * A trigger invoked on replace in space _sequence_data.
  * Used to update a sequence value.
@@ -4562,6 +4580,17 @@ on_replace_dd_sequence_data(struct trigger * /* trigger */, void *event)
 			return -1;
 		if (sequence_set(seq, value) != 0)
 			return -1;
+		/*
+		 * If the transaction is rolled back, the leased
+		 * value range loses its record on disk - discard
+		 * it so that every dispensed value has been
+		 * persisted at least once.
+		 */
+		struct trigger *on_rollback = txn_alter_trigger_new(
+				on_sequence_data_rollback, new_tuple);
+		if (on_rollback == NULL)
+			return -1;
+		txn_stmt_on_rollback(stmt, on_rollback);
 	} else {					/* DELETE */
 		/*
 		 * A sequence isn't supposed to roll back to the old
@@ -30,13 +30,17 @@
  */
 #include "applier.h"
 
+#include <fcntl.h>
 #include <msgpuck.h>
+#include <zstd.h>
 
 #include "xlog.h"
 #include "fiber.h"
 #include "fiber_cond.h"
 #include "coio.h"
 #include "coio_buf.h"
+#include "coio_file.h"
+#include "memtx_engine.h"
 #include "wal.h"
 #include "xrow.h"
 #include "replication.h"
@@ -47,6 +51,7 @@
 #include "error.h"
 #include "session.h"
 #include "cfg.h"
+#include "region_profile.h"
 #include "schema.h"
 #include "txn.h"
 #include "box.h"
@@ -54,6 +59,18 @@
 
 STRS(applier_state, applier_STATE);
 
+enum {
+	/** The gc reserve covers this percentile of applied rows. */
+	APPLIER_REGION_PERCENTILE = 99,
+	/** Hard cap on the gc region retained by an applier fiber. */
+	APPLIER_REGION_RESERVE_MAX = 1024 * 1024,
+	/** Granularity of decompression of the subscribe stream. */
+	APPLIER_ZSTD_BUF_SIZE = 16384,
+};
+
+/** Retention profile of applier fiber gc regions. */
+static struct region_profile applier_region_profile;
+
 static inline void
 applier_set_state(struct applier *applier, enum applier_state state)
 {
@@ -149,16 +166,13 @@ applier_writer_f(va_list ap)
 
 	while (!fiber_is_cancelled()) {
 		/*
-		 * Tarantool >= 1.7.7 sends periodic heartbeat
-		 * messages so we don't need to send ACKs every
-		 * replication_timeout seconds any more.
+		 * Commits coalesce their ACKs while the pool is
+		 * busy (see applier_on_commit()), so wake up on a
+		 * timeout anyway to put an upper bound on the ACK
+		 * delay under a sustained stream.
 		 */
-		if (applier->version_id >= version_id(1, 7, 7))
-			fiber_cond_wait_timeout(&applier->writer_cond,
-						TIMEOUT_INFINITY);
-		else
-			fiber_cond_wait_timeout(&applier->writer_cond,
-						replication_timeout);
+		fiber_cond_wait_timeout(&applier->writer_cond,
+					replication_timeout);
 		/*
 		 * A writer fiber is going to be awaken after a commit or
 		 * a heartbeat message. So this is an appropriate place to
@@ -171,10 +185,20 @@ applier_writer_f(va_list ap)
 		if (applier->state != APPLIER_SYNC &&
 		    applier->state != APPLIER_FOLLOW)
 			continue;
+		/*
+		 * Tarantool >= 1.7.7 sends periodic heartbeat
+		 * messages so the ACK is not needed as a
+		 * keepalive and may wait for a commit or a
+		 * heartbeat to request it.
+		 */
+		if (!applier->ack_pending &&
+		    applier->version_id >= version_id(1, 7, 7))
+			continue;
 		try {
 			struct xrow_header xrow;
 			xrow_encode_vclock(&xrow, &replicaset.vclock);
 			coio_write_xrow(&io, &xrow);
+			applier->ack_pending = false;
 		} catch (SocketError *e) {
 			/*
 			 * There is no point trying to send ACKs if
@@ -196,7 +220,7 @@ applier_writer_f(va_list ap)
 			 */
 			e->log();
 		}
-		fiber_gc();
+		region_profile_fiber_gc();
 	}
 	return 0;
 }
@@ -223,13 +247,13 @@ apply_snapshot_row(struct xrow_header *row)
 	if (txn_commit_stmt(txn, &request))
 		goto rollback;
 	rc = txn_commit(txn);
-	fiber_gc();
+	region_profile_fiber_gc();
 	return rc;
 rollback_stmt:
 	txn_rollback_stmt(txn);
 rollback:
 	txn_rollback(txn);
-	fiber_gc();
+	region_profile_fiber_gc();
 	return -1;
 }
 
@@ -275,12 +299,12 @@ apply_final_join_row(struct xrow_header *row)
 		return -1;
 	if (apply_row(row) != 0) {
 		txn_rollback(txn);
-		fiber_gc();
+		region_profile_fiber_gc();
 		return -1;
 	}
 	if (txn_commit(txn) != 0)
 		return -1;
-	fiber_gc();
+	region_profile_fiber_gc();
 	return 0;
 }
 
@@ -388,6 +412,102 @@ done:
 	applier_set_state(applier, APPLIER_READY);
 }
 
+/**
+ * Download a raw snapshot file sent by the master instead of the
+ * row-by-row initial join stream and recover from it. The file
+ * is written to the memtx snap dir under the .inprogress suffix
+ * and removed once recovered: the replica makes a checkpoint of
+ * its own at the end of bootstrap. Download progress is recorded
+ * in the applier so that a reconnect resumes the transfer from
+ * where it stopped instead of starting over.
+ */
+static void
+applier_fetch_snap_file(struct applier *applier, uint64_t snap_size,
+			uint64_t snap_offset)
+{
+	struct ev_io *coio = &applier->io;
+	struct ibuf *ibuf = &applier->ibuf;
+	struct memtx_engine *memtx =
+		(struct memtx_engine *) engine_by_name("memtx");
+	assert(memtx != NULL);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s",
+		 xdir_format_filename(&memtx->snap_dir,
+				      vclock_sum(&replicaset.vclock),
+				      INPROGRESS));
+	say_info("receiving snapshot file `%s', %llu bytes at offset %llu",
+		 path, (unsigned long long) snap_size,
+		 (unsigned long long) snap_offset);
+
+	int fd = open(path, O_CREAT | O_WRONLY, 0644);
+	if (fd < 0)
+		tnt_raise(SystemError, "failed to open `%s'", path);
+	auto fd_guard = make_scoped_guard([=] { close(fd); });
+	/*
+	 * The master grants a non-zero offset only for the very
+	 * transfer recorded in the applier, in which case the
+	 * file already holds exactly that many bytes. A zero
+	 * offset discards whatever stale leftovers are there.
+	 */
+	if (ftruncate(fd, snap_offset) < 0)
+		tnt_raise(SystemError, "failed to truncate `%s'", path);
+	vclock_copy(&applier->join_snap_vclock, &replicaset.vclock);
+	applier->join_snap_offset = snap_offset;
+
+	uint64_t pos = snap_offset;
+	uint64_t end = snap_offset + snap_size;
+	/*
+	 * The row reader may have read a piece of the file into
+	 * the input buffer together with the response - drain it
+	 * first. Bytes past the file end belong to the following
+	 * packets and are left in the buffer.
+	 */
+	size_t avail = ibuf_used(ibuf);
+	if (avail > 0) {
+		size_t chunk = MIN((uint64_t) avail, end - pos);
+		if (coio_pwrite(fd, ibuf->rpos, chunk, pos) !=
+		    (ssize_t) chunk)
+			tnt_raise(SystemError, "failed to write `%s'", path);
+		ibuf->rpos += chunk;
+		pos += chunk;
+		applier->join_snap_offset = pos;
+	}
+	enum { JOIN_SNAP_CHUNK = 1024 * 1024 };
+	char *buf = (char *) malloc(JOIN_SNAP_CHUNK);
+	if (buf == NULL) {
+		tnt_raise(OutOfMemory, JOIN_SNAP_CHUNK, "malloc",
+			  "snapshot receive buffer");
+	}
+	auto buf_guard = make_scoped_guard([=] { free(buf); });
+	while (pos < end) {
+		size_t chunk = MIN((uint64_t) JOIN_SNAP_CHUNK, end - pos);
+		coio_readn(coio, buf, chunk);
+		if (coio_pwrite(fd, buf, chunk, pos) != (ssize_t) chunk)
+			tnt_raise(SystemError, "failed to write `%s'", path);
+		pos += chunk;
+		applier->join_snap_offset = pos;
+		applier->last_row_time = ev_monotonic_now(loop());
+		if ((pos >> 30) != ((pos - chunk) >> 30))
+			say_info("%.1fG received", pos / 1e9);
+	}
+	fd_guard.is_active = false;
+	if (close(fd) < 0)
+		tnt_raise(SystemError, "failed to write `%s'", path);
+	say_info("snapshot file received");
+
+	/*
+	 * Recovering the file verifies the per-transaction
+	 * checksums, so a corrupted transfer is caught here.
+	 */
+	if (memtx_engine_recover_snapshot_file(memtx, &replicaset.vclock,
+					       path) != 0)
+		diag_raise();
+	applier->join_snap_offset = 0;
+	if (unlink(path) < 0)
+		say_syserror("failed to remove `%s'", path);
+}
+
 static uint64_t
 applier_wait_snapshot(struct applier *applier)
 {
@@ -415,6 +535,19 @@ applier_wait_snapshot(struct applier *applier)
 		 * vclock in bootstrap_from_master()
 		 */
 		xrow_decode_vclock_xc(&row, &replicaset.vclock);
+		/*
+		 * The master may ship the whole checkpoint as a
+		 * raw file instead of the row stream; the rest
+		 * of the join protocol is unchanged.
+		 */
+		bool has_snap = false;
+		uint64_t snap_size = 0, snap_offset = 0;
+		xrow_decode_join_snap_xc(&row, &has_snap, &snap_size,
+					 &snap_offset, NULL);
+		if (has_snap) {
+			applier_fetch_snap_file(applier, snap_size,
+						snap_offset);
+		}
 	}
 
 	/*
@@ -547,7 +680,14 @@ applier_join(struct applier *applier)
 	struct xrow_header row;
 	uint64_t row_count;
 
-	xrow_encode_join_xc(&row, &INSTANCE_UUID);
+	if (applier->join_snap_offset > 0) {
+		/* Resume an interrupted snapshot file download. */
+		xrow_encode_join_xc(&row, &INSTANCE_UUID,
+				    &applier->join_snap_vclock,
+				    applier->join_snap_offset);
+	} else {
+		xrow_encode_join_xc(&row, &INSTANCE_UUID, NULL, 0);
+	}
 	coio_write_xrow(coio, &row);
 
 	applier_set_state(applier, APPLIER_INITIAL_JOIN);
@@ -581,14 +721,89 @@ struct applier_tx_row {
 	struct stailq_entry next;
 	/* xrow_header struct for the current transaction row. */
 	struct xrow_header row;
+	/*
+	 * DML request decoded from the row when the transaction
+	 * was dispatched to the pool, valid if has_request is
+	 * set. The apply path reuses it instead of decoding the
+	 * row for the second time.
+	 */
+	struct request request;
+	/* Set if request is valid. */
+	bool has_request;
 };
 
+/**
+ * Feed compressed socket input through the decompression stream
+ * until the applier input buffer holds at least @a size bytes of
+ * raw row data.
+ */
+static void
+applier_zread_ensure(struct applier *applier, size_t size, double timeout)
+{
+	struct ibuf *in = &applier->ibuf;
+	while (ibuf_used(in) < size) {
+		if (ibuf_used(&applier->zibuf) == 0)
+			coio_breadn_timeout(&applier->io, &applier->zibuf, 1,
+					    timeout);
+		ZSTD_inBuffer zin;
+		zin.src = applier->zibuf.rpos;
+		zin.size = ibuf_used(&applier->zibuf);
+		zin.pos = 0;
+		if (ibuf_reserve(in, APPLIER_ZSTD_BUF_SIZE) == NULL)
+			tnt_raise(OutOfMemory, APPLIER_ZSTD_BUF_SIZE,
+				  "ibuf", "decompressed rows");
+		ZSTD_outBuffer zout;
+		zout.dst = in->wpos;
+		zout.size = ibuf_unused(in);
+		zout.pos = 0;
+		size_t rc = ZSTD_decompressStream(applier->zstream,
+						  &zout, &zin);
+		if (ZSTD_isError(rc))
+			tnt_raise(ClientError, ER_SYSTEM,
+				  ZSTD_getErrorName(rc));
+		in->wpos += zout.pos;
+		ibuf_consume(&applier->zibuf, zin.pos);
+	}
+}
+
+/**
+ * Read a row from the master connection, reassembling it from
+ * the compressed stream if compression has been negotiated at
+ * subscribe time. The plain path simply delegates to
+ * coio_read_xrow().
+ */
+static void
+applier_read_xrow(struct applier *applier, struct xrow_header *row,
+		  double timeout)
+{
+	struct ibuf *in = &applier->ibuf;
+	if (applier->zstream == NULL) {
+		if (timeout == TIMEOUT_INFINITY)
+			coio_read_xrow(&applier->io, in, row);
+		else
+			coio_read_xrow_timeout_xc(&applier->io, in, row,
+						  timeout);
+		return;
+	}
+	/* Mirrors coio_read_xrow(), but reads decompressed data. */
+	applier_zread_ensure(applier, 1, timeout);
+	if (mp_typeof(*in->rpos) != MP_UINT) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  "packet length");
+	}
+	ssize_t to_read = mp_check_uint(in->rpos, in->wpos);
+	if (to_read > 0)
+		applier_zread_ensure(applier, ibuf_used(in) + to_read,
+				     timeout);
+	uint32_t len = mp_decode_uint((const char **) &in->rpos);
+	applier_zread_ensure(applier, len, timeout);
+	xrow_header_decode_xc(row, (const char **) &in->rpos,
+			      in->rpos + len, true);
+}
+
 static struct applier_tx_row *
 applier_read_tx_row(struct applier *applier)
 {
-	struct ev_io *coio = &applier->io;
-	struct ibuf *ibuf = &applier->ibuf;
-
 	struct applier_tx_row *tx_row = (struct applier_tx_row *)
 		region_alloc(&fiber()->gc, sizeof(struct applier_tx_row));
 
@@ -596,6 +811,7 @@ applier_read_tx_row(struct applier *applier)
 		tnt_raise(OutOfMemory, sizeof(struct applier_tx_row),
 			  "region", "struct applier_tx_row");
 
+	tx_row->has_request = false;
 	struct xrow_header *row = &tx_row->row;
 
 	double timeout = replication_disconnect_timeout();
@@ -606,9 +822,9 @@ applier_read_tx_row(struct applier *applier)
 	 * broken - the master might just be idle.
 	 */
 	if (applier->version_id < version_id(1, 7, 7))
-		coio_read_xrow(coio, ibuf, row);
+		applier_read_xrow(applier, row, TIMEOUT_INFINITY);
 	else
-		coio_read_xrow_timeout_xc(coio, ibuf, row, timeout);
+		applier_read_xrow(applier, row, timeout);
 
 	applier->lag = ev_now(loop()) - row->tm;
 	applier->last_row_time = ev_monotonic_now(loop());
@@ -664,24 +880,12 @@ applier_read_tx(struct applier *applier, struct stailq *rows)
 				  "interleaving transactions");
 
 		assert(row->bodycnt <= 1);
-		if (row->bodycnt == 1 && !row->is_commit) {
-			/*
-			 * Save row body to gc region.
-			 * Not done for single-statement
-			 * transactions knowing that the input
-			 * buffer will not be used while the
-			 * transaction is applied.
-			 */
-			void *new_base = region_alloc(&fiber()->gc,
-						      row->body->iov_len);
-			if (new_base == NULL)
-				tnt_raise(OutOfMemory, row->body->iov_len,
-					  "region", "xrow body");
-			memcpy(new_base, row->body->iov_base,
-			       row->body->iov_len);
-			/* Adjust row body pointers. */
-			row->body->iov_base = new_base;
-		}
+		/*
+		 * Row bodies point into the input buffer here.
+		 * They are copied off it when the transaction is
+		 * handed over to the pool, see
+		 * applier_dispatch_tx().
+		 */
 		stailq_add_tail(rows, &tx_row->next);
 
 	} while (!stailq_last_entry(rows, struct applier_tx_row,
@@ -711,14 +915,169 @@ applier_txn_commit_cb(struct trigger *trigger, void *event)
 	return 0;
 }
 
+enum {
+	/**
+	 * Maximum number of distinct spaces tracked in a
+	 * transaction footprint. A transaction touching more
+	 * spaces is treated as conflicting with any other
+	 * transaction.
+	 */
+	APPLIER_TX_SPACE_MAX = 8,
+	/**
+	 * Maximum number of transactions waiting in
+	 * applier->tx_queue before the reader fiber blocks.
+	 */
+	APPLIER_TX_QUEUE_MAX = 64,
+};
+
+/**
+ * A transaction read from the replication stream, copied off the
+ * reader fiber so that a pool fiber can apply it while the reader
+ * goes on to read and decode the next one.
+ */
+struct applier_tx {
+	/** Link in applier->tx_queue. */
+	struct stailq_entry next;
+	/** Link in applier->tx_inflight. */
+	struct rlist in_inflight;
+	/** Transaction rows, linked by applier_tx_row::next. */
+	struct stailq rows;
+	/** Storage for row copies and their bodies. */
+	struct region region;
+	/** WAL submit order sequence number. */
+	uint64_t seq;
+	/** Ids of the spaces the transaction touches. */
+	uint32_t space_ids[APPLIER_TX_SPACE_MAX];
+	/** Number of ids in space_ids. */
+	uint32_t space_count;
+	/**
+	 * Set if the footprint did not fit in space_ids or could
+	 * not be decoded. Such a transaction conflicts with any
+	 * other transaction.
+	 */
+	bool is_wide;
+	/**
+	 * Set if the transaction touches an engine that does not
+	 * allow yielding inside a transaction. Such a transaction
+	 * has to take its WAL submit turn before it starts.
+	 */
+	bool has_memtx;
+};
+
+/** Free a transaction copied off the reader fiber. */
+static void
+applier_tx_delete(struct applier_tx *tx)
+{
+	region_destroy(&tx->region);
+	free(tx);
+}
+
+/** Account a space touched by @a tx in its footprint. */
+static void
+applier_tx_add_space(struct applier_tx *tx, uint32_t space_id)
+{
+	for (uint32_t i = 0; i < tx->space_count; i++) {
+		if (tx->space_ids[i] == space_id)
+			return;
+	}
+	if (tx->space_count == APPLIER_TX_SPACE_MAX) {
+		tx->is_wide = true;
+		tx->has_memtx = true;
+		return;
+	}
+	tx->space_ids[tx->space_count++] = space_id;
+	/*
+	 * Only vinyl transactions may yield while waiting for
+	 * their WAL submit turn. A space missing from the cache
+	 * will fail to apply anyway, so treat it as non-yielding
+	 * to report the error in the stream order.
+	 */
+	struct space *space = space_by_id(space_id);
+	if (space == NULL || !space_is_vinyl(space))
+		tx->has_memtx = true;
+}
+
+/**
+ * Check if @a tx conflicts with an earlier dispatched transaction
+ * that has not been submitted to the WAL yet. Conflicting
+ * transactions have to be applied in the replication stream order.
+ */
+static bool
+applier_tx_conflicts(struct applier *applier, struct applier_tx *tx)
+{
+	struct applier_tx *other;
+	rlist_foreach_entry(other, &applier->tx_inflight, in_inflight) {
+		if (other->seq >= tx->seq)
+			continue;
+		if (tx->is_wide || other->is_wide)
+			return true;
+		for (uint32_t i = 0; i < tx->space_count; i++) {
+			for (uint32_t j = 0; j < other->space_count; j++) {
+				if (tx->space_ids[i] == other->space_ids[j])
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+/** Wait until it is the turn of @a tx to be submitted to the WAL. */
+static int
+applier_tx_wait_submit_turn(struct applier *applier, struct applier_tx *tx)
+{
+	while (applier->tx_submit_seq != tx->seq) {
+		if (fiber_is_cancelled())
+			return -1;
+		fiber_cond_wait(&applier->tx_submit_cond);
+	}
+	return 0;
+}
+
+/** Pass the WAL submit turn to the next transaction. */
+static void
+applier_tx_done_submit_turn(struct applier *applier)
+{
+	applier->tx_submit_seq++;
+	fiber_cond_broadcast(&applier->tx_submit_cond);
+}
+
 /**
- * Apply all rows in the rows queue as a single transaction.
+ * Apply a single transaction row, reusing the request decoded at
+ * dispatch when there is one so that the row is not decoded
+ * twice.
+ */
+static int
+apply_tx_row(struct applier_tx_row *item)
+{
+	if (!item->has_request)
+		return apply_row(&item->row);
+	struct request *request = &item->request;
+	struct space *space = space_cache_find(request->space_id);
+	if (space == NULL)
+		return -1;
+	if (box_process_rw(request, space, NULL) != 0) {
+		say_error("error applying row: %s", request_str(request));
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Apply all rows of @a tx as a single transaction.
+ *
+ * Transactions with disjoint space footprints are applied by pool
+ * fibers concurrently, but are submitted to the WAL strictly in
+ * the replication stream order. A memtx transaction may not yield
+ * once started, so it takes its submit turn up front. A vinyl
+ * transaction first applies its rows, possibly yielding on disk
+ * reads, and waits for the turn before the commit.
  *
  * Return 0 for success or -1 in case of an error.
  */
 static int
-applier_apply_tx(struct stailq *rows)
+applier_apply_tx(struct applier *applier, struct applier_tx *tx)
 {
+	struct stailq *rows = &tx->rows;
 	struct xrow_header *first_row = &stailq_first_entry(rows,
 					struct applier_tx_row, next)->row;
 	struct replica *replica = replica_by_id(first_row->replica_id);
@@ -730,11 +1089,18 @@ applier_apply_tx(struct stailq *rows)
 	 */
 	struct latch *latch = (replica ? &replica->order_latch :
 			       &replicaset.applier.order_latch);
-	latch_lock(latch);
-	if (vclock_get(&replicaset.applier.vclock,
-		       first_row->replica_id) >= first_row->lsn) {
-		latch_unlock(latch);
-		return 0;
+	bool latched = false;
+	struct txn *txn = NULL;
+	struct applier_tx_row *item;
+
+	if (tx->has_memtx) {
+		if (applier_tx_wait_submit_turn(applier, tx) != 0)
+			return -1;
+		latch_lock(latch);
+		latched = true;
+		if (vclock_get(&replicaset.applier.vclock,
+			       first_row->replica_id) >= first_row->lsn)
+			goto skip;
 	}
 
 	/**
@@ -743,15 +1109,12 @@ applier_apply_tx(struct stailq *rows)
 	 * conflict safely access failed xrow object and allocate
 	 * IPROTO_NOP on gc.
 	 */
-	struct txn *txn = txn_begin();
-	struct applier_tx_row *item;
-	if (txn == NULL) {
-		latch_unlock(latch);
-		return -1;
-	}
+	txn = txn_begin();
+	if (txn == NULL)
+		goto fail;
 	stailq_foreach_entry(item, rows, next) {
 		struct xrow_header *row = &item->row;
-		int res = apply_row(row);
+		int res = apply_tx_row(item);
 		if (res != 0) {
 			struct error *e = diag_last_error(diag_get());
 			/*
@@ -767,6 +1130,7 @@ applier_apply_tx(struct stailq *rows)
 				diag_clear(diag_get());
 				row->type = IPROTO_NOP;
 				row->bodycnt = 0;
+				item->has_request = false;
 				res = apply_row(row);
 			}
 		}
@@ -790,6 +1154,28 @@ applier_apply_tx(struct stailq *rows)
 		goto rollback;
 	}
 
+	if (!tx->has_memtx) {
+		/*
+		 * A vinyl transaction survives a yield, so wait
+		 * for the submit turn with the rows applied.
+		 */
+		if (applier_tx_wait_submit_turn(applier, tx) != 0)
+			goto rollback;
+		latch_lock(latch);
+		latched = true;
+		if (vclock_get(&replicaset.applier.vclock,
+			       first_row->replica_id) >= first_row->lsn) {
+			/*
+			 * The same transaction has arrived via
+			 * another applier while this one was
+			 * being applied.
+			 */
+			txn_rollback(txn);
+			txn = NULL;
+			goto skip;
+		}
+	}
+
 	/* We are ready to submit txn to wal. */
 	struct trigger *on_rollback, *on_commit;
 	on_rollback = (struct trigger *)region_alloc(&txn->region,
@@ -811,16 +1197,182 @@ applier_apply_tx(struct stailq *rows)
 	/* Transaction was sent to journal so promote vclock. */
 	vclock_follow(&replicaset.applier.vclock,
 		      first_row->replica_id, first_row->lsn);
+skip:
 	latch_unlock(latch);
+	applier_tx_done_submit_turn(applier);
 	return 0;
 rollback:
 	txn_rollback(txn);
 fail:
-	latch_unlock(latch);
-	fiber_gc();
+	if (latched)
+		latch_unlock(latch);
+	region_profile_fiber_gc();
 	return -1;
 }
 
+/** A pool fiber applying transactions from applier->tx_queue. */
+static int
+applier_pool_f(va_list ap)
+{
+	struct applier *applier = va_arg(ap, struct applier *);
+	while (!fiber_is_cancelled()) {
+		while (stailq_empty(&applier->tx_queue)) {
+			fiber_cond_wait(&applier->tx_queue_cond);
+			if (fiber_is_cancelled())
+				return 0;
+		}
+		struct applier_tx *tx =
+			stailq_shift_entry(&applier->tx_queue,
+					   struct applier_tx, next);
+		applier->tx_queue_len--;
+		fiber_cond_signal(&applier->tx_dequeue_cond);
+		/*
+		 * Publish the transaction before possibly
+		 * yielding so that later transactions see it as
+		 * a conflict candidate and do not overtake it.
+		 */
+		rlist_add_tail_entry(&applier->tx_inflight, tx, in_inflight);
+		while (applier_tx_conflicts(applier, tx) &&
+		       !fiber_is_cancelled())
+			fiber_cond_wait(&applier->tx_inflight_cond);
+		int rc = fiber_is_cancelled() ? -1 :
+			 applier_apply_tx(applier, tx);
+		rlist_del_entry(tx, in_inflight);
+		fiber_cond_broadcast(&applier->tx_inflight_cond);
+		applier_tx_delete(tx);
+		if (rc != 0) {
+			if (!fiber_is_cancelled()) {
+				/*
+				 * Deliver the error to the reader,
+				 * which will tear the connection
+				 * down. Transactions that were read
+				 * but not submitted to the WAL are
+				 * re-fetched after a reconnect.
+				 */
+				if (diag_is_empty(&applier->diag))
+					diag_move(diag_get(), &applier->diag);
+				fiber_cancel(applier->reader);
+			}
+			return -1;
+		}
+		region_profile_fiber_gc();
+	}
+	return 0;
+}
+
+/**
+ * Copy a freshly read transaction off the reader fiber gc region
+ * and the input buffer and hand it over to the pool. Blocks while
+ * the queue is full.
+ */
+static void
+applier_dispatch_tx(struct applier *applier, struct stailq *rows)
+{
+	while (applier->tx_queue_len >= APPLIER_TX_QUEUE_MAX) {
+		fiber_cond_wait(&applier->tx_dequeue_cond);
+		fiber_testcancel();
+	}
+	struct applier_tx *tx = (struct applier_tx *)malloc(sizeof(*tx));
+	if (tx == NULL)
+		tnt_raise(OutOfMemory, sizeof(*tx), "malloc",
+			  "struct applier_tx");
+	region_create(&tx->region, &cord()->slabc);
+	auto tx_guard = make_scoped_guard([=] { applier_tx_delete(tx); });
+	stailq_create(&tx->rows);
+	tx->space_count = 0;
+	tx->is_wide = false;
+	tx->has_memtx = false;
+	struct applier_tx_row *item;
+	stailq_foreach_entry(item, rows, next) {
+		struct applier_tx_row *copy = (struct applier_tx_row *)
+			region_alloc(&tx->region, sizeof(*copy));
+		if (copy == NULL)
+			tnt_raise(OutOfMemory, sizeof(*copy), "region",
+				  "struct applier_tx_row");
+		copy->row = item->row;
+		if (copy->row.bodycnt == 1) {
+			/*
+			 * The input buffer is reused for the next
+			 * rows while the transaction waits in the
+			 * queue, so the body has to be copied.
+			 */
+			size_t len = copy->row.body->iov_len;
+			void *body = region_alloc(&tx->region, len);
+			if (body == NULL)
+				tnt_raise(OutOfMemory, len, "region",
+					  "xrow body");
+			memcpy(body, copy->row.body->iov_base, len);
+			copy->row.body->iov_base = body;
+		}
+		copy->has_request = false;
+		if (copy->row.type != IPROTO_NOP) {
+			if (xrow_decode_dml(&copy->row, &copy->request,
+					    dml_request_key_map(
+						copy->row.type)) != 0) {
+				/*
+				 * Let apply_row() report the
+				 * error in the stream order.
+				 */
+				diag_clear(diag_get());
+				tx->is_wide = true;
+				tx->has_memtx = true;
+			} else {
+				copy->has_request = true;
+				applier_tx_add_space(tx,
+						     copy->request.space_id);
+			}
+		}
+		stailq_add_tail(&tx->rows, &copy->next);
+	}
+	tx->seq = applier->tx_dispatch_seq++;
+	stailq_add_tail(&applier->tx_queue, &tx->next);
+	applier->tx_queue_len++;
+	tx_guard.is_active = false;
+	fiber_cond_signal(&applier->tx_queue_cond);
+}
+
+/** Start the transaction pool fibers. */
+static void
+applier_start_pool(struct applier *applier)
+{
+	stailq_create(&applier->tx_queue);
+	applier->tx_queue_len = 0;
+	rlist_create(&applier->tx_inflight);
+	applier->tx_dispatch_seq = 0;
+	applier->tx_submit_seq = 0;
+
+	char name[FIBER_NAME_MAX];
+	int pos = snprintf(name, sizeof(name), "applierp/");
+	uri_format(name + pos, sizeof(name) - pos, &applier->uri, false);
+	for (int i = 0; i < APPLIER_POOL_SIZE; i++) {
+		struct fiber *f = fiber_new_xc(name, applier_pool_f);
+		fiber_set_joinable(f, true);
+		applier->pool[i] = f;
+		fiber_start(f, applier);
+	}
+}
+
+/** Stop the pool fibers and free the queued transactions. */
+static void
+applier_stop_pool(struct applier *applier)
+{
+	for (int i = 0; i < APPLIER_POOL_SIZE; i++) {
+		if (applier->pool[i] != NULL)
+			fiber_cancel(applier->pool[i]);
+	}
+	for (int i = 0; i < APPLIER_POOL_SIZE; i++) {
+		if (applier->pool[i] == NULL)
+			continue;
+		fiber_join(applier->pool[i]);
+		applier->pool[i] = NULL;
+	}
+	struct applier_tx *tx, *next_tx;
+	stailq_foreach_entry_safe(tx, next_tx, &applier->tx_queue, next)
+		applier_tx_delete(tx);
+	stailq_create(&applier->tx_queue);
+	applier->tx_queue_len = 0;
+}
+
 /*
  * A trigger to update an applier state after a replication commit.
  */
@@ -829,7 +1381,18 @@ applier_on_commit(struct trigger *trigger, void *event)
 {
 	(void) event;
 	struct applier *applier = (struct applier *)trigger->data;
-	fiber_cond_signal(&applier->writer_cond);
+	applier->ack_pending = true;
+	/*
+	 * Coalesce ACKs: while more transactions are queued or
+	 * wait for their WAL submit turn, the vclock keeps
+	 * moving, so hold the ACK until the batch drains and
+	 * acknowledge it as a whole. The writer wakes up every
+	 * replication_timeout anyway, which bounds the ACK delay
+	 * under a sustained stream.
+	 */
+	if (applier->tx_queue_len == 0 &&
+	    applier->tx_submit_seq == applier->tx_dispatch_seq)
+		fiber_cond_signal(&applier->writer_cond);
 	return 0;
 }
 
@@ -872,7 +1435,8 @@ applier_subscribe(struct applier *applier)
 	 */
 	uint32_t id_filter = box_is_orphan() ? 0 : 1 << instance_id;
 	xrow_encode_subscribe_xc(&row, &REPLICASET_UUID, &INSTANCE_UUID,
-				 &vclock, replication_anon, id_filter);
+				 &vclock, replication_anon, id_filter,
+				 replication_compression);
 	coio_write_xrow(coio, &row);
 
 	/* Read SUBSCRIBE response */
@@ -895,6 +1459,24 @@ applier_subscribe(struct applier *applier)
 		vclock_create(&applier->remote_vclock_at_subscribe);
 		xrow_decode_subscribe_response_xc(&row, &cluster_id,
 					&applier->remote_vclock_at_subscribe);
+		/*
+		 * The master echoes the compression key back only
+		 * if it agreed to compress the stream. An old
+		 * master ignores the key, so its absence simply
+		 * keeps the channel raw.
+		 */
+		bool compress = false;
+		if (xrow_decode_compression(&row, &compress) != 0)
+			diag_raise();
+		if (compress) {
+			applier->zstream = ZSTD_createDStream();
+			if (applier->zstream == NULL)
+				tnt_raise(OutOfMemory, 0,
+					  "ZSTD_createDStream", "zstream");
+			ZSTD_initDStream(applier->zstream);
+			say_info("master will compress the replication "
+				 "stream");
+		}
 		/*
 		 * If master didn't send us its cluster id
 		 * assume that it has done all the checks.
@@ -972,6 +1554,11 @@ applier_subscribe(struct applier *applier)
 		trigger_clear(&on_rollback);
 	});
 
+	auto pool_guard = make_scoped_guard([&] {
+		applier_stop_pool(applier);
+	});
+	applier_start_pool(applier);
+
 	/*
 	 * Process a stream of rows from the binary log.
 	 */
@@ -993,14 +1580,16 @@ applier_subscribe(struct applier *applier)
 		 * and check applier state.
 		 */
 		if (stailq_first_entry(&rows, struct applier_tx_row,
-				       next)->row.lsn == 0)
+				       next)->row.lsn == 0) {
+			applier->ack_pending = true;
 			fiber_cond_signal(&applier->writer_cond);
-		else if (applier_apply_tx(&rows) != 0)
-			diag_raise();
+		} else {
+			applier_dispatch_tx(applier, &rows);
+		}
 
 		if (ibuf_used(ibuf) == 0)
 			ibuf_reset(ibuf);
-		fiber_gc();
+		region_profile_fiber_gc();
 	}
 }
 
@@ -1017,7 +1606,13 @@ applier_disconnect(struct applier *applier, enum applier_state state)
 	coio_close_io(loop(), &applier->io);
 	/* Clear all unparsed input. */
 	ibuf_reinit(&applier->ibuf);
-	fiber_gc();
+	/* Compression is re-negotiated on the next subscribe. */
+	if (applier->zstream != NULL) {
+		ZSTD_freeDStream(applier->zstream);
+		applier->zstream = NULL;
+	}
+	ibuf_reinit(&applier->zibuf);
+	region_profile_fiber_gc();
 }
 
 static int
@@ -1033,6 +1628,17 @@ applier_f(va_list ap)
 		return -1;
 	session_set_type(session, SESSION_TYPE_APPLIER);
 
+	/*
+	 * The applier streams a steady flow of similar-sized
+	 * rows, so retain enough of the gc region to serve the
+	 * vast majority of them without going back to the slab
+	 * cache.
+	 */
+	region_profile_create(&applier_region_profile, "applier",
+			      APPLIER_REGION_PERCENTILE,
+			      APPLIER_REGION_RESERVE_MAX);
+	fiber()->gc_profile = &applier_region_profile;
+
 	/* Re-connect loop */
 	while (!fiber_is_cancelled()) {
 		try {
@@ -1179,6 +1785,7 @@ applier_new(const char *uri)
 	}
 	coio_create(&applier->io, -1);
 	ibuf_create(&applier->ibuf, &cord()->slabc, 1024);
+	ibuf_create(&applier->zibuf, &cord()->slabc, 1024);
 
 	/* uri_parse() sets pointers to applier->source buffer */
 	snprintf(applier->source, sizeof(applier->source), "%s", uri);
@@ -1191,6 +1798,12 @@ applier_new(const char *uri)
 	rlist_create(&applier->on_state);
 	fiber_cond_create(&applier->resume_cond);
 	fiber_cond_create(&applier->writer_cond);
+	stailq_create(&applier->tx_queue);
+	fiber_cond_create(&applier->tx_queue_cond);
+	fiber_cond_create(&applier->tx_dequeue_cond);
+	rlist_create(&applier->tx_inflight);
+	fiber_cond_create(&applier->tx_inflight_cond);
+	fiber_cond_create(&applier->tx_submit_cond);
 	diag_create(&applier->diag);
 
 	return applier;
@@ -1200,7 +1813,9 @@ void
 applier_delete(struct applier *applier)
 {
 	assert(applier->reader == NULL && applier->writer == NULL);
+	assert(applier->zstream == NULL);
 	ibuf_destroy(&applier->ibuf);
+	ibuf_destroy(&applier->zibuf);
 	assert(applier->io.fd == -1);
 	trigger_destroy(&applier->on_state);
 	diag_destroy(&applier->diag);
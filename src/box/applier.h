@@ -38,6 +38,7 @@
 #include <small/ibuf.h>
 
 #include "fiber_cond.h"
+#include "salad/stailq.h"
 #include "trigger.h"
 #include "trivia/util.h"
 #include "uuid/tt_uuid.h"
@@ -47,6 +48,12 @@
 
 enum { APPLIER_SOURCE_MAXLEN = 1024 }; /* enough to fit URI with passwords */
 
+/** ZSTD_DStream, forward declared to avoid including zstd.h here. */
+struct ZSTD_DCtx_s;
+
+/** Number of fibers applying incoming transactions in parallel. */
+enum { APPLIER_POOL_SIZE = 4 };
+
 #define applier_STATE(_)                                             \
 	_(APPLIER_OFF, 0)                                            \
 	_(APPLIER_CONNECT, 1)                                        \
@@ -80,6 +87,14 @@ struct applier {
 	struct fiber *writer;
 	/** Writer cond. */
 	struct fiber_cond writer_cond;
+	/**
+	 * Set when the master is waiting for an ACK: a
+	 * transaction was committed or a heartbeat arrived.
+	 * Cleared by the writer once the vclock is sent. Lets
+	 * the writer acknowledge a batch of committed
+	 * transactions with a single ACK.
+	 */
+	bool ack_pending;
 	/** Finite-state machine */
 	enum applier_state state;
 	/** Local time of this replica when the last row has been received */
@@ -109,6 +124,16 @@ struct applier {
 	struct ev_io io;
 	/** Input buffer */
 	struct ibuf ibuf;
+	/**
+	 * zstd decompression stream when the master compresses
+	 * the subscribe channel, NULL otherwise.
+	 */
+	struct ZSTD_DCtx_s *zstream;
+	/**
+	 * Buffer of compressed socket input, decompressed into
+	 * ibuf before row parsing.
+	 */
+	struct ibuf zibuf;
 	/** Triggers invoked on state change */
 	struct rlist on_state;
 	/**
@@ -122,6 +147,43 @@ struct applier {
 	struct diag diag;
 	/* Master's vclock at the time of SUBSCRIBE. */
 	struct vclock remote_vclock_at_subscribe;
+	/**
+	 * Checkpoint vclock of a partially downloaded snapshot
+	 * file, unset if there is no download to resume.
+	 */
+	struct vclock join_snap_vclock;
+	/** Snapshot file bytes already written to disk. */
+	uint64_t join_snap_offset;
+	/** Fibers applying incoming transactions. */
+	struct fiber *pool[APPLIER_POOL_SIZE];
+	/** Transactions read from the master, waiting to be applied. */
+	struct stailq tx_queue;
+	/** Number of transactions in tx_queue. */
+	int tx_queue_len;
+	/** Signaled when a transaction is added to tx_queue. */
+	struct fiber_cond tx_queue_cond;
+	/** Signaled when a transaction is taken off tx_queue. */
+	struct fiber_cond tx_dequeue_cond;
+	/**
+	 * Transactions taken off tx_queue by pool fibers, but not
+	 * yet submitted to the WAL, in dispatch order. A pool
+	 * fiber may not apply a transaction while it conflicts
+	 * with an earlier transaction on this list.
+	 */
+	struct rlist tx_inflight;
+	/** Signaled when a transaction leaves tx_inflight. */
+	struct fiber_cond tx_inflight_cond;
+	/** Sequence number assigned to the next read transaction. */
+	uint64_t tx_dispatch_seq;
+	/**
+	 * Sequence number of the transaction whose turn it is to
+	 * be submitted to the WAL. Transactions are dispatched to
+	 * the pool and applied out of order, but submitted to the
+	 * WAL strictly in the replication stream order.
+	 */
+	uint64_t tx_submit_seq;
+	/** Signaled when tx_submit_seq is incremented. */
+	struct fiber_cond tx_submit_cond;
 };
 
 /**
@@ -33,10 +33,174 @@
 #include "session.h"
 #include "msgpuck.h"
 #include "error.h"
+#include "fiber.h"
+#include "random.h"
+#include "crypto/crypto.h"
 #include "third_party/base64.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
 
 static char zero_hash[SCRAMBLE_SIZE];
 
+enum {
+	/** How long an issued resumption ticket stays valid, in seconds. */
+	AUTH_TICKET_TTL = 600,
+	/** Size of the HMAC-SHA256 tag appended to a ticket. */
+	AUTH_TICKET_MAC_SIZE = 32,
+	/** Size of the HMAC key. */
+	AUTH_TICKET_MAC_KEY_SIZE = 32,
+};
+
+/**
+ * Ticket payload sealed by the ticket codec. Layout consistency
+ * is not a concern: tickets are encoded and decoded by the same
+ * process, see authenticate_ticket_issue().
+ */
+struct auth_ticket {
+	/** Id of the authenticated user. */
+	uint32_t uid;
+	/** Monotonic time after which the ticket is rejected. */
+	double expiry;
+	/** Password hash the ticket was issued against. */
+	char hash2[SCRAMBLE_SIZE];
+};
+
+/**
+ * Codec sealing resumption tickets with a random process-local
+ * key. Created on first ticket issue.
+ */
+static struct crypto_codec *auth_ticket_codec;
+
+/**
+ * Key of the HMAC authenticating tickets. CBC alone gives no
+ * integrity: the first plaintext block (uid and expiry) would be
+ * malleable by XOR-ing the client-visible IV. Generated together
+ * with the codec key.
+ */
+static char auth_ticket_mac_key[AUTH_TICKET_MAC_KEY_SIZE];
+
+static struct crypto_codec *
+auth_ticket_codec_get(void)
+{
+	if (auth_ticket_codec == NULL) {
+		char key[CRYPTO_AES128_KEY_SIZE];
+		random_bytes(key, sizeof(key));
+		random_bytes(auth_ticket_mac_key,
+			     sizeof(auth_ticket_mac_key));
+		auth_ticket_codec = crypto_codec_new(CRYPTO_ALGO_AES128,
+						     CRYPTO_MODE_CBC,
+						     key, sizeof(key));
+		if (auth_ticket_codec == NULL)
+			diag_log();
+	}
+	return auth_ticket_codec;
+}
+
+void
+auth_ticket_free(void)
+{
+	if (auth_ticket_codec != NULL) {
+		crypto_codec_delete(auth_ticket_codec);
+		auth_ticket_codec = NULL;
+	}
+}
+
+int
+authenticate_ticket_issue(const char *user_name, char *out, int out_size)
+{
+	struct crypto_codec *codec = auth_ticket_codec_get();
+	if (codec == NULL)
+		return 0;
+	uint32_t len;
+	const char *name = mp_decode_str(&user_name, &len);
+	struct user *user = user_find_by_name(name, len);
+	if (user == NULL) {
+		diag_clear(diag_get());
+		return 0;
+	}
+	struct auth_ticket ticket;
+	memset(&ticket, 0, sizeof(ticket));
+	ticket.uid = user->def->uid;
+	ticket.expiry = ev_monotonic_now(loop()) + AUTH_TICKET_TTL;
+	memcpy(ticket.hash2, user->def->hash2, SCRAMBLE_SIZE);
+	int iv_size = crypto_codec_gen_iv(codec, out, out_size);
+	if (iv_size > out_size)
+		return 0;
+	int size = crypto_codec_encrypt(codec, out, (const char *)&ticket,
+					sizeof(ticket), out + iv_size,
+					out_size - iv_size);
+	if (size < 0) {
+		diag_log();
+		return 0;
+	}
+	if (size > out_size - iv_size - AUTH_TICKET_MAC_SIZE)
+		return 0;
+	/* Seal the IV and the ciphertext against tampering. */
+	unsigned int mac_size = 0;
+	if (HMAC(EVP_sha256(), auth_ticket_mac_key,
+		 sizeof(auth_ticket_mac_key), (const unsigned char *)out,
+		 iv_size + size, (unsigned char *)out + iv_size + size,
+		 &mac_size) == NULL)
+		return 0;
+	assert(mac_size == AUTH_TICKET_MAC_SIZE);
+	assert(iv_size + size + AUTH_TICKET_MAC_SIZE <= AUTH_TICKET_MAX_SIZE);
+	return iv_size + size + AUTH_TICKET_MAC_SIZE;
+}
+
+/**
+ * Check a resumption ticket presented in place of a scramble.
+ * Returns 0 if the ticket was issued by this process for this
+ * user against the current password and has not expired yet,
+ * -1 otherwise. A failed check is not an error: the client is
+ * expected to fall back to a regular chap-sha1 exchange.
+ */
+static int
+auth_ticket_check(const char *data, uint32_t size, struct user *user)
+{
+	if (auth_ticket_codec == NULL)
+		return -1;
+	if (size <= CRYPTO_AES_IV_SIZE + AUTH_TICKET_MAC_SIZE ||
+	    size > AUTH_TICKET_MAX_SIZE)
+		return -1;
+	/*
+	 * Verify the seal before decrypting anything: without it
+	 * the uid and the expiry would be malleable through the
+	 * IV, see auth_ticket_mac_key.
+	 */
+	uint32_t sealed_size = size - AUTH_TICKET_MAC_SIZE;
+	unsigned char mac[AUTH_TICKET_MAC_SIZE];
+	unsigned int mac_size = 0;
+	if (HMAC(EVP_sha256(), auth_ticket_mac_key,
+		 sizeof(auth_ticket_mac_key), (const unsigned char *)data,
+		 sealed_size, mac, &mac_size) == NULL)
+		return -1;
+	assert(mac_size == AUTH_TICKET_MAC_SIZE);
+	if (CRYPTO_memcmp(mac, data + sealed_size,
+			  AUTH_TICKET_MAC_SIZE) != 0)
+		return -1;
+	/* The codec wants a block size margin on top of the input. */
+	char buf[AUTH_TICKET_MAX_SIZE + CRYPTO_MAX_BLOCK_SIZE];
+	int rc = crypto_codec_decrypt(auth_ticket_codec, data,
+				      data + CRYPTO_AES_IV_SIZE,
+				      sealed_size - CRYPTO_AES_IV_SIZE,
+				      buf, sizeof(buf));
+	if (rc != sizeof(struct auth_ticket)) {
+		if (rc < 0)
+			diag_clear(diag_get());
+		return -1;
+	}
+	struct auth_ticket ticket;
+	memcpy(&ticket, buf, sizeof(ticket));
+	if (ticket.uid != user->def->uid)
+		return -1;
+	if (ticket.expiry < ev_monotonic_now(loop()))
+		return -1;
+	if (memcmp(ticket.hash2, user->def->hash2, SCRAMBLE_SIZE) != 0)
+		return -1;
+	return 0;
+}
+
 void
 authenticate(const char *user_name, uint32_t len, const char *salt,
 	     const char *tuple)
@@ -46,6 +210,9 @@ authenticate(const char *user_name, uint32_t len, const char *salt,
 	uint32_t part_count;
 	uint32_t scramble_len;
 	const char *scramble;
+	uint32_t mech_len;
+	const char *mech;
+	bool mismatch;
 	struct on_auth_trigger_ctx auth_res = { user->def->name, true };
 	/*
 	 * Allow authenticating back to GUEST user without
@@ -70,7 +237,12 @@ authenticate(const char *user_name, uint32_t len, const char *salt,
 		tnt_raise(ClientError, ER_INVALID_MSGPACK,
 			   "authentication request body");
 	}
-	mp_next(&tuple); /* Skip authentication mechanism. */
+	mech = NULL;
+	mech_len = 0;
+	if (mp_typeof(*tuple) == MP_STR)
+		mech = mp_decode_str(&tuple, &mech_len);
+	else
+		mp_next(&tuple); /* Skip authentication mechanism. */
 	if (mp_typeof(*tuple) == MP_STR) {
 		scramble = mp_decode_str(&tuple, &scramble_len);
 	} else if (mp_typeof(*tuple) == MP_BIN) {
@@ -83,13 +255,27 @@ authenticate(const char *user_name, uint32_t len, const char *salt,
 		tnt_raise(ClientError, ER_INVALID_MSGPACK,
 			   "authentication scramble");
 	}
-	if (scramble_len != SCRAMBLE_SIZE) {
-		/* Authentication mechanism, data. */
-		tnt_raise(ClientError, ER_INVALID_MSGPACK,
-			   "invalid scramble size");
+	if (mech != NULL && mech_len == strlen("ticket") &&
+	    memcmp(mech, "ticket", mech_len) == 0) {
+		/*
+		 * A session resumption ticket issued by this
+		 * process on an earlier successful authentication,
+		 * see authenticate_ticket_issue(). A failed check
+		 * is reported as a password mismatch: the client
+		 * retries with a regular chap-sha1 exchange.
+		 */
+		mismatch = auth_ticket_check(scramble, scramble_len,
+					     user) != 0;
+	} else {
+		if (scramble_len != SCRAMBLE_SIZE) {
+			/* Authentication mechanism, data. */
+			tnt_raise(ClientError, ER_INVALID_MSGPACK,
+				   "invalid scramble size");
+		}
+		mismatch = scramble_check(scramble, salt,
+					  user->def->hash2) != 0;
 	}
-
-	if (scramble_check(scramble, salt, user->def->hash2)) {
+	if (mismatch) {
 		auth_res.is_authenticated = false;
 		if (session_run_on_auth_triggers(&auth_res) != 0)
 			diag_raise();
@@ -102,3 +288,24 @@ ok:
 		diag_raise();
 	credentials_reset(&session->credentials, user);
 }
+
+void
+authenticate_cached(const char *user_name, uint32_t len,
+		    enum auth_precheck precheck)
+{
+	assert(precheck != AUTH_PRECHECK_NONE);
+	struct user *user = user_find_by_name_xc(user_name, len);
+	struct session *session = current_session();
+	struct on_auth_trigger_ctx auth_res = { user->def->name, true };
+	if (precheck == AUTH_PRECHECK_FAIL) {
+		auth_res.is_authenticated = false;
+		if (session_run_on_auth_triggers(&auth_res) != 0)
+			diag_raise();
+		tnt_raise(ClientError, ER_PASSWORD_MISMATCH, user->def->name);
+	}
+	access_check_session_xc(user);
+	if (! rlist_empty(&session_on_auth) &&
+	    session_run_on_auth_triggers(&auth_res) != 0)
+		diag_raise();
+	credentials_reset(&session->credentials, user);
+}
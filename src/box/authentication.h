@@ -33,6 +33,15 @@
 
 #include <stdint.h>
 
+enum {
+	/**
+	 * Maximal size of a session resumption ticket: an initial
+	 * vector followed by the encrypted ticket payload, padded
+	 * to the cipher block size. See authenticate_ticket_issue().
+	 */
+	AUTH_TICKET_MAX_SIZE = 128,
+};
+
 /**
  * State passed to authentication trigger.
  */
@@ -48,4 +57,60 @@ void
 authenticate(const char *user_name, uint32_t len, const char *salt,
 	     const char *tuple);
 
+/**
+ * Result of a scramble pre-check performed by a network thread
+ * against its replica of the user authentication data, see
+ * authenticate_cached().
+ */
+enum auth_precheck {
+	/** The user was not found in the network thread cache. */
+	AUTH_PRECHECK_NONE = 0,
+	/** The scramble matched the cached password hash. */
+	AUTH_PRECHECK_OK,
+	/** The scramble did not match the cached password hash. */
+	AUTH_PRECHECK_FAIL,
+};
+
+/**
+ * Finish an authentication whose scramble has already been
+ * checked by a network thread. Does everything authenticate()
+ * does except parsing the request body and checking the
+ * scramble: looks the user up, checks session access, runs
+ * on_auth triggers and resets the session credentials.
+ */
+void
+authenticate_cached(const char *user_name, uint32_t len,
+		    enum auth_precheck precheck);
+
+/**
+ * Issue a session resumption ticket for an authenticated user.
+ * A ticket is the user id, the current password hash and an
+ * expiration time encrypted with a key generated on first use
+ * and never leaving this process. A client may present it in
+ * place of a chap-sha1 scramble on reconnect to revalidate in
+ * O(1), without redoing the handshake: see authenticate().
+ *
+ * Tickets are bearer credentials, so they expire quickly and
+ * are reissued on every successful authentication. A password
+ * change invalidates outstanding tickets because the embedded
+ * hash no longer matches. Since the key is process-local, a
+ * ticket issued by another instance or before a restart simply
+ * fails to decrypt and the client falls back to full
+ * authentication.
+ *
+ * @param user_name MessagePack encoded name of the user.
+ * @param out Output buffer of at least AUTH_TICKET_MAX_SIZE
+ *            bytes.
+ * @param out_size Size of @a out.
+ *
+ * @return Size of the issued ticket, or 0 if a ticket can not
+ *         be issued (unknown user, crypto failure).
+ */
+int
+authenticate_ticket_issue(const char *user_name, char *out, int out_size);
+
+/** Release the ticket codec. */
+void
+auth_ticket_free(void);
+
 #endif /* INCLUDES_TARANTOOL_BOX_AUTHENTICATION_H */
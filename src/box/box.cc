@@ -32,6 +32,10 @@
 
 #include "trivia/config.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+
 #include "lua/utils.h" /* lua_hash() */
 #include "fiber_pool.h"
 #include <say.h>
@@ -51,6 +55,9 @@
 #include "schema.h"
 #include "engine.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "region_profile.h"
+#include "stat_snapshot.h"
 #include "sysview.h"
 #include "blackhole.h"
 #include "service_engine.h"
@@ -62,6 +69,7 @@
 #include "user.h"
 #include "cfg.h"
 #include "coio.h"
+#include "coio_file.h"
 #include "replication.h" /* replica */
 #include "title.h"
 #include "xrow.h"
@@ -74,11 +82,21 @@
 #include "systemd.h"
 #include "call.h"
 #include "func.h"
+#include "mat_view.h"
+#include "txn_limbo.h"
 #include "sequence.h"
 #include "sql_stmt_cache.h"
+#include "execute.h"
 
 static char status[64] = "unknown";
 
+/**
+ * Path to the SQL warmup dump: the statement cache is saved here
+ * on shutdown and re-prepared from here on startup. Set once the
+ * configuration is read, empty until then.
+ */
+static char sql_warmup_path[PATH_MAX];
+
 /** box.stat rmean */
 struct rmean *rmean_box;
 
@@ -139,6 +157,13 @@ static struct fiber_pool tx_fiber_pool;
  */
 static struct cbus_endpoint tx_prio_endpoint;
 
+/**
+ * How many sequence values box_sequence_next() leases per
+ * _sequence_data update, see box.cfg.sequence_cache_size. One
+ * means no caching: every value is persisted individually.
+ */
+static int64_t sequence_cache_size = 1;
+
 static int
 box_check_writable(void)
 {
@@ -173,6 +198,15 @@ box_process_rw(struct request *request, struct space *space,
 {
 	struct tuple *tuple = NULL;
 	bool return_tuple = false;
+	/*
+	 * Honor the request deadline before starting a statement:
+	 * the client has given up on the request, so don't burn tx
+	 * CPU and WAL bandwidth executing it to completion.
+	 */
+	if (fiber_deadline_is_reached()) {
+		diag_set(ClientError, ER_TIMEOUT);
+		return -1;
+	}
 	struct txn *txn = in_txn();
 	bool is_autocommit = txn == NULL;
 	if (is_autocommit && (txn = txn_begin()) == NULL)
@@ -206,7 +240,7 @@ box_process_rw(struct request *request, struct space *space,
 	if (is_autocommit) {
 		if (txn_commit(txn) != 0)
 			goto error;
-	        fiber_gc();
+	        region_profile_fiber_gc();
 	}
 	if (return_tuple) {
 		tuple_bless(tuple);
@@ -217,7 +251,7 @@ box_process_rw(struct request *request, struct space *space,
 rollback:
 	if (is_autocommit) {
 		txn_rollback(txn);
-		fiber_gc();
+		region_profile_fiber_gc();
 	}
 error:
 	if (return_tuple)
@@ -236,6 +270,8 @@ box_set_ro()
 		return; /* nothing to do */
 	if (ro)
 		engine_switch_to_ro();
+	else
+		wal_warmup();
 
 	is_ro = ro;
 	fiber_cond_broadcast(&ro_cond);
@@ -486,6 +522,29 @@ box_check_replication_sync_timeout(void)
 	return timeout;
 }
 
+static int
+box_check_replication_synchro_quorum(void)
+{
+	int quorum = cfg_geti("replication_synchro_quorum");
+	if (quorum <= 0 || quorum > VCLOCK_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_synchro_quorum",
+			  "the value must be greater than zero and less than "
+			  "maximal number of replicas");
+	}
+	return quorum;
+}
+
+static double
+box_check_replication_synchro_timeout(void)
+{
+	double timeout = cfg_getd("replication_synchro_timeout");
+	if (timeout <= 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_synchro_timeout",
+			  "the value must be greater than 0");
+	}
+	return timeout;
+}
+
 static inline void
 box_check_uuid(struct tt_uuid *uuid, const char *name)
 {
@@ -560,6 +619,27 @@ box_check_readahead(int readahead)
 	}
 }
 
+static int
+box_check_iproto_threads(int threads_count)
+{
+	if (threads_count < 1 || threads_count > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  tt_sprintf("must be greater than or equal to 1,"
+				     " less than or equal to %d",
+				     IPROTO_THREADS_MAX));
+	}
+	return threads_count;
+}
+
+static void
+box_check_sequence_cache_size(int64_t size)
+{
+	if (size < 1) {
+		tnt_raise(ClientError, ER_CFG, "sequence_cache_size",
+			  "the value must not be less than one");
+	}
+}
+
 static void
 box_check_checkpoint_count(int checkpoint_count)
 {
@@ -569,6 +649,15 @@ box_check_checkpoint_count(int checkpoint_count)
 	}
 }
 
+static void
+box_check_checkpoint_threads(int checkpoint_threads)
+{
+	if (checkpoint_threads < 1) {
+		tnt_raise(ClientError, ER_CFG, "checkpoint_threads",
+			  "the value must not be less than one");
+	}
+}
+
 static int64_t
 box_check_wal_max_size(int64_t wal_max_size)
 {
@@ -658,8 +747,13 @@ box_check_config()
 	box_check_replication_connect_quorum();
 	box_check_replication_sync_lag();
 	box_check_replication_sync_timeout();
+	box_check_replication_synchro_quorum();
+	box_check_replication_synchro_timeout();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_sequence_cache_size(cfg_geti64("sequence_cache_size"));
+	box_check_iproto_threads(cfg_geti("iproto_threads"));
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
+	box_check_checkpoint_threads(cfg_geti("checkpoint_threads"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	if (box_check_memory_quota("memtx_memory") < 0)
@@ -788,6 +882,28 @@ box_set_replication_skip_conflict(void)
 	replication_skip_conflict = cfg_geti("replication_skip_conflict");
 }
 
+void
+box_set_replication_synchro_quorum(void)
+{
+	replication_synchro_quorum = box_check_replication_synchro_quorum();
+}
+
+void
+box_set_replication_synchro_timeout(void)
+{
+	replication_synchro_timeout = box_check_replication_synchro_timeout();
+}
+
+void
+box_set_replication_compression(void)
+{
+	/*
+	 * Takes effect on the next (re)subscribe: the option is
+	 * only read when the SUBSCRIBE request is encoded.
+	 */
+	replication_compression = cfg_geti("replication_compression");
+}
+
 void
 box_set_replication_anon(void)
 {
@@ -886,6 +1002,16 @@ box_set_snap_io_rate_limit(void)
 			cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_snap_direct_write(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_direct_write(memtx,
+			cfg_geti("snap_direct_write") != 0);
+}
+
 void
 box_set_memtx_memory(void)
 {
@@ -908,6 +1034,14 @@ box_set_memtx_max_tuple_size(void)
 			cfg_geti("memtx_max_tuple_size"));
 }
 
+void
+box_set_sequence_cache_size(void)
+{
+	int64_t size = cfg_geti64("sequence_cache_size");
+	box_check_sequence_cache_size(size);
+	sequence_cache_size = size;
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -934,6 +1068,37 @@ box_set_checkpoint_count(void)
 	gc_set_min_checkpoint_count(checkpoint_count);
 }
 
+void
+box_set_checkpoint_threads(void)
+{
+	int checkpoint_threads = cfg_geti("checkpoint_threads");
+	box_check_checkpoint_threads(checkpoint_threads);
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_checkpoint_threads(memtx, checkpoint_threads);
+}
+
+void
+box_set_checkpoint_incremental(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_checkpoint_incremental(memtx,
+			cfg_geti("checkpoint_incremental") != 0);
+}
+
+void
+box_set_checkpoint_columnar(void)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_checkpoint_columnar(memtx,
+			cfg_geti("checkpoint_columnar") != 0);
+}
+
 void
 box_set_checkpoint_interval(void)
 {
@@ -941,11 +1106,64 @@ box_set_checkpoint_interval(void)
 	gc_set_checkpoint_interval(interval);
 }
 
+/**
+ * Assumed WAL replay speed when nothing has been replayed by
+ * this instance yet, e.g. right after a bootstrap.
+ */
+static const double CHECKPOINT_RECOVERY_RATE_DEFAULT = 100 * 1024 * 1024;
+
+/**
+ * Convert the configured checkpoint triggers to a WAL size
+ * threshold: the smaller of checkpoint_wal_threshold and the
+ * amount of WAL the instance is expected to replay within
+ * checkpoint_recovery_target seconds at the speed measured
+ * during the last local recovery.
+ */
+static int64_t
+box_checkpoint_threshold(void)
+{
+	int64_t threshold = cfg_geti64("checkpoint_wal_threshold");
+	double target = cfg_getd("checkpoint_recovery_target");
+	if (target > 0) {
+		double rate = recovery_throughput();
+		if (rate <= 0)
+			rate = CHECKPOINT_RECOVERY_RATE_DEFAULT;
+		int64_t bytes = target * rate;
+		if (bytes < threshold)
+			threshold = bytes;
+	}
+	return threshold;
+}
+
 void
 box_set_checkpoint_wal_threshold(void)
 {
-	int64_t threshold = cfg_geti64("checkpoint_wal_threshold");
-	wal_set_checkpoint_threshold(threshold);
+	wal_set_checkpoint_threshold(box_checkpoint_threshold());
+}
+
+void
+box_set_checkpoint_recovery_target(void)
+{
+	double target = cfg_getd("checkpoint_recovery_target");
+	if (target < 0) {
+		tnt_raise(ClientError, ER_CFG, "checkpoint_recovery_target",
+			  "the value must be >= 0");
+	}
+	wal_set_checkpoint_threshold(box_checkpoint_threshold());
+}
+
+void
+box_set_wal_retention_size(void)
+{
+	int64_t size = cfg_geti64("wal_retention_size");
+	wal_set_retention_size(size);
+}
+
+void
+box_set_wal_consumer_timeout(void)
+{
+	double timeout = cfg_getd("wal_consumer_timeout");
+	gc_set_wal_consumer_timeout(timeout);
 }
 
 void
@@ -994,6 +1212,12 @@ box_set_net_msg_max(void)
 				IPROTO_FIBER_POOL_SIZE_FACTOR);
 }
 
+void
+box_set_net_defer_latency(void)
+{
+	iproto_set_defer_latency(cfg_getd("net_defer_latency"));
+}
+
 int
 box_set_prepared_stmt_cache_size(void)
 {
@@ -1075,6 +1299,21 @@ box_return_tuple(box_function_ctx_t *ctx, box_tuple_t *tuple)
 	return port_tuple_add(ctx->port, tuple);
 }
 
+int
+box_return_mp(box_function_ctx_t *ctx, const char *mp, const char *mp_end)
+{
+	if (mp >= mp_end || mp_typeof(*mp) != MP_ARRAY) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "function result");
+		return -1;
+	}
+	struct tuple *tuple = box_tuple_new(box_tuple_format_default(),
+					    mp, mp_end);
+	if (tuple == NULL)
+		return -1;
+	return port_tuple_add(ctx->port, tuple);
+}
+
 /* schema_find_id()-like method using only public API */
 uint32_t
 box_space_id_by_name(const char *name, uint32_t len)
@@ -1132,11 +1371,15 @@ box_index_id_by_name(uint32_t space_id, const char *name, uint32_t len)
 int
 box_process1(struct request *request, box_tuple_t **result)
 {
-	/* Allow to write to temporary spaces in read-only mode. */
+	/*
+	 * Allow to write to temporary and non-journalled spaces
+	 * in read-only mode.
+	 */
 	struct space *space = space_cache_find(request->space_id);
 	if (space == NULL)
 		return -1;
 	if (!space_is_temporary(space) &&
+	    !space_is_wal_disabled(space) &&
 	    space_group_id(space) != GROUP_LOCAL &&
 	    box_check_writable() != 0)
 		return -1;
@@ -1190,11 +1433,30 @@ box_select(uint32_t space_id, uint32_t index_id,
 		return -1;
 	}
 
+	/*
+	 * Scans churn through transient tuple references (the
+	 * iterator position, vinyl read history), so pin a tuple
+	 * epoch to batch the frees they trigger off the
+	 * iteration loop.
+	 */
+	tuple_epoch_enter();
 	int rc = 0;
 	uint32_t found = 0;
+	uint32_t scanned = 0;
 	struct tuple *tuple;
 	port_tuple_create(port);
 	while (found < limit) {
+		/*
+		 * Poll the request deadline once per 1k scanned
+		 * tuples so an expired long scan (including the
+		 * offset-skip phase) aborts early instead of
+		 * running to completion.
+		 */
+		if ((++scanned & 0x3ff) == 0 && fiber_deadline_is_reached()) {
+			diag_set(ClientError, ER_TIMEOUT);
+			rc = -1;
+			break;
+		}
 		rc = iterator_next(it, &tuple);
 		if (rc != 0 || tuple == NULL)
 			break;
@@ -1202,18 +1464,28 @@ box_select(uint32_t space_id, uint32_t index_id,
 			offset--;
 			continue;
 		}
+		/*
+		 * Overlap the next tuple header load with the
+		 * per-tuple work below.
+		 */
+		iterator_prefetch(it);
+		rc = memtx_tx_track_read(txn, space, tuple);
+		if (rc != 0)
+			break;
 		rc = port_tuple_add(port, tuple);
 		if (rc != 0)
 			break;
 		found++;
 	}
 	iterator_delete(it);
+	tuple_epoch_leave();
 
 	if (rc != 0) {
 		port_destroy(port);
 		txn_rollback_stmt(txn);
 		return -1;
 	}
+	index->scan_stat.rows_returned += found;
 	txn_commit_ro_stmt(txn);
 	return 0;
 }
@@ -1232,6 +1504,53 @@ box_insert(uint32_t space_id, const char *tuple, const char *tuple_end,
 	return box_process1(&request, result);
 }
 
+int
+box_insert_ignore(uint32_t space_id, const char *tuple, const char *tuple_end,
+		  box_tuple_t **result)
+{
+	mp_tuple_assert(tuple, tuple_end);
+	if (result != NULL)
+		*result = NULL;
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	/*
+	 * Check the primary key first so that a duplicate is
+	 * dismissed without going through the transaction
+	 * statement machinery and the error path: for ingest
+	 * workloads duplicates are a steady state, not an error.
+	 */
+	struct index *pk = space_index(space, 0);
+	if (pk != NULL && !pk->def->key_def->is_multikey &&
+	    !pk->def->key_def->for_func_index) {
+		uint32_t key_size;
+		char *key = tuple_extract_key_raw(tuple, tuple_end,
+						  pk->def->key_def,
+						  MULTIKEY_NONE, &key_size);
+		if (key == NULL)
+			return -1;
+		struct tuple *found;
+		if (box_index_get(space_id, 0, key, key + key_size,
+				  &found) != 0)
+			return -1;
+		if (found != NULL)
+			return 0;
+	}
+	if (box_insert(space_id, tuple, tuple_end, result) == 0)
+		return 0;
+	/*
+	 * The precheck may be raced past by a yielding engine or
+	 * skipped altogether, and a secondary unique index may
+	 * reject the tuple as well - dismiss such conflicts too.
+	 */
+	if (box_error_code(box_error_last()) != ER_TUPLE_FOUND)
+		return -1;
+	diag_clear(diag_get());
+	if (result != NULL)
+		*result = NULL;
+	return 0;
+}
+
 int
 box_replace(uint32_t space_id, const char *tuple, const char *tuple_end,
 	    box_tuple_t **result)
@@ -1246,6 +1565,51 @@ box_replace(uint32_t space_id, const char *tuple, const char *tuple_end,
 	return box_process1(&request, result);
 }
 
+int
+box_insert_batch(uint32_t space_id, const char *tuples,
+		 const char *tuples_end, uint32_t tuple_count)
+{
+	bool is_autocommit = in_txn() == NULL;
+	if (is_autocommit && box_txn_begin() != 0)
+		return -1;
+	struct request request;
+	memset(&request, 0, sizeof(request));
+	request.type = IPROTO_REPLACE;
+	request.space_id = space_id;
+	const char *tuple = tuples;
+	for (uint32_t i = 0; i < tuple_count; i++) {
+		if (tuple >= tuples_end || mp_typeof(*tuple) != MP_ARRAY) {
+			diag_set(ClientError, ER_INVALID_MSGPACK,
+				 "batch body");
+			goto rollback;
+		}
+		const char *tuple_end = tuple;
+		mp_next(&tuple_end);
+		if (tuple_end > tuples_end) {
+			diag_set(ClientError, ER_INVALID_MSGPACK,
+				 "batch body");
+			goto rollback;
+		}
+		request.tuple = tuple;
+		request.tuple_end = tuple_end;
+		/*
+		 * Re-resolve the space on each iteration: a
+		 * vinyl statement may yield and let a concurrent
+		 * DDL replace the space object.
+		 */
+		if (box_process1(&request, NULL) != 0)
+			goto rollback;
+		tuple = tuple_end;
+	}
+	if (is_autocommit && box_txn_commit() != 0)
+		return -1;
+	return 0;
+rollback:
+	if (is_autocommit)
+		box_txn_rollback();
+	return -1;
+}
+
 int
 box_delete(uint32_t space_id, uint32_t index_id, const char *key,
 	   const char *key_end, box_tuple_t **result)
@@ -1409,10 +1773,21 @@ box_sequence_next(uint32_t seq_id, int64_t *result)
 	if (access_check_sequence(seq) != 0)
 		return -1;
 	int64_t value;
-	if (sequence_next(seq, &value) != 0)
+	if (sequence_lease_next(seq, &value)) {
+		/*
+		 * Served from the leased range - no shared state
+		 * update, no WAL write.
+		 */
+		*result = value;
+		return 0;
+	}
+	int64_t last;
+	if (sequence_lease(seq, sequence_cache_size, &value, &last) != 0)
 		return -1;
-	if (sequence_data_update(seq_id, value) != 0)
+	if (sequence_data_update(seq_id, last) != 0) {
+		sequence_lease_discard(seq);
 		return -1;
+	}
 	*result = value;
 	return 0;
 }
@@ -1512,6 +1887,21 @@ box_process_auth(struct auth_request *request, const char *salt)
 	authenticate(user, len, salt, request->scramble);
 }
 
+void
+box_process_auth_cached(struct auth_request *request,
+			enum auth_precheck precheck)
+{
+	rmean_collect(rmean_box, IPROTO_AUTH, 1);
+
+	/* Check that bootstrap has been finished */
+	if (!is_box_configured)
+		tnt_raise(ClientError, ER_LOADING);
+
+	const char *user = request->user_name;
+	uint32_t len = mp_decode_strl(&user);
+	authenticate_cached(user, len, precheck);
+}
+
 void
 box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header)
 {
@@ -1534,7 +1924,8 @@ box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header)
 
 	/* Send the snapshot data to the instance. */
 	struct vclock start_vclock;
-	relay_initial_join(io->fd, header->sync, &start_vclock);
+	relay_initial_join(io->fd, header->sync, &start_vclock,
+			   cfg_getd("snap_io_rate_limit"));
 	say_info("read-view sent.");
 
 	/* Remember master's vclock after the last request */
@@ -1638,6 +2029,96 @@ box_process_register(struct ev_io *io, struct xrow_header *header)
 	gc_guard.is_active = false;
 }
 
+/** Result of scanning the last checkpoint for a file based join. */
+struct box_join_snap_probe {
+	/** Path to the only snapshot file of the checkpoint. */
+	char path[PATH_MAX];
+	/** A snapshot file has been seen. */
+	bool found;
+	/** The checkpoint can be shipped as a single raw file. */
+	bool eligible;
+};
+
+static int
+box_join_snap_probe_cb(const char *path, void *arg)
+{
+	struct box_join_snap_probe *probe =
+		(struct box_join_snap_probe *) arg;
+	size_t len = strlen(path);
+	/*
+	 * Vinyl metadata is rebuilt by the replica from the
+	 * system spaces, so an empty vinyl log does not preclude
+	 * a file based join. Anything else - vinyl runs, an
+	 * incremental snapshot chain - does.
+	 */
+	if (len > strlen(".vylog") &&
+	    strcmp(path + len - strlen(".vylog"), ".vylog") == 0)
+		return 0;
+	if (len <= strlen(".snap") ||
+	    strcmp(path + len - strlen(".snap"), ".snap") != 0 ||
+	    probe->found || len >= sizeof(probe->path)) {
+		probe->eligible = false;
+		return 0;
+	}
+	probe->found = true;
+	strcpy(probe->path, path);
+	return 0;
+}
+
+/**
+ * Send the last checkpoint to a joining replica as a raw file:
+ * an OK packet announcing the transfer followed by the file
+ * bytes. @a resume_vclock and @a resume_offset come from the
+ * JOIN request: a non-zero offset is granted only if the replica
+ * was downloading this very checkpoint.
+ */
+static void
+box_join_send_snap_file(struct ev_io *io, struct xrow_header *header,
+			const char *path, const struct vclock *vclock,
+			const struct vclock *resume_vclock,
+			uint64_t resume_offset)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		tnt_raise(SystemError, "failed to open `%s'", path);
+	auto fd_guard = make_scoped_guard([=] { close(fd); });
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+		tnt_raise(SystemError, "failed to stat `%s'", path);
+	uint64_t size = st.st_size;
+	uint64_t offset = 0;
+	if (resume_offset > 0 && resume_offset <= size &&
+	    vclock_is_set(resume_vclock) &&
+	    vclock_compare(resume_vclock, vclock) == 0)
+		offset = resume_offset;
+
+	say_info("sending snapshot file `%s' to replica, %llu bytes "
+		 "at offset %llu", path,
+		 (unsigned long long) (size - offset),
+		 (unsigned long long) offset);
+
+	struct xrow_header row;
+	xrow_encode_join_snap_response_xc(&row, vclock, size - offset, offset);
+	row.sync = header->sync;
+	coio_write_xrow(io, &row);
+
+	enum { JOIN_SNAP_CHUNK = 1024 * 1024 };
+	char *buf = (char *) malloc(JOIN_SNAP_CHUNK);
+	if (buf == NULL) {
+		tnt_raise(OutOfMemory, JOIN_SNAP_CHUNK, "malloc",
+			  "snapshot send buffer");
+	}
+	auto buf_guard = make_scoped_guard([=] { free(buf); });
+	while (offset < size) {
+		size_t chunk = MIN((uint64_t) JOIN_SNAP_CHUNK, size - offset);
+		ssize_t rc = coio_pread(fd, buf, chunk, offset);
+		if (rc <= 0)
+			tnt_raise(SystemError, "failed to read `%s'", path);
+		coio_write(io, buf, rc);
+		offset += rc;
+	}
+}
+
 void
 box_process_join(struct ev_io *io, struct xrow_header *header)
 {
@@ -1688,6 +2169,13 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	/* Decode JOIN request */
 	struct tt_uuid instance_uuid = uuid_nil;
 	xrow_decode_join_xc(header, &instance_uuid);
+	bool snap_file = false;
+	uint64_t snap_flag, snap_offset = 0;
+	struct vclock resume_vclock;
+	vclock_create(&resume_vclock);
+	xrow_decode_join_snap_xc(header, &snap_file, &snap_flag,
+				 &snap_offset, &resume_vclock);
+	(void) snap_flag;
 
 	/* Check that bootstrap has been finished */
 	if (!is_box_configured)
@@ -1725,11 +2213,45 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 			  "wal_mode = 'none'");
 	}
 
+	/*
+	 * When the replica can take a raw snapshot file and the
+	 * whole dataset lives in a single full memtx snapshot,
+	 * ship the last checkpoint file as is and replay only the
+	 * WAL tail on top of it, skipping the row-by-row initial
+	 * stream. Pin the checkpoint so that it is not collected
+	 * while the transfer is in progress.
+	 */
+	struct gc_checkpoint *checkpoint = NULL;
+	struct gc_checkpoint_ref checkpoint_ref;
+	struct box_join_snap_probe probe;
+	probe.found = false;
+	probe.eligible = false;
+	if (snap_file && (checkpoint = gc_last_checkpoint()) != NULL) {
+		gc_ref_checkpoint(checkpoint, &checkpoint_ref,
+				  "replica %s join",
+				  tt_uuid_str(&instance_uuid));
+		probe.eligible = true;
+		if (engine_backup(&checkpoint->vclock, box_join_snap_probe_cb,
+				  &probe) != 0)
+			probe.eligible = false;
+		if (!probe.eligible || !probe.found) {
+			probe.eligible = false;
+			gc_unref_checkpoint(&checkpoint_ref);
+		}
+	}
+	bool send_snap_file = probe.eligible && probe.found;
+	auto checkpoint_guard = make_scoped_guard([&] {
+		if (send_snap_file)
+			gc_unref_checkpoint(&checkpoint_ref);
+	});
+
 	/*
 	 * Register the replica as a WAL consumer so that
 	 * it can resume FINAL JOIN where INITIAL JOIN ends.
 	 */
-	struct gc_consumer *gc = gc_consumer_register(&replicaset.vclock,
+	struct gc_consumer *gc = gc_consumer_register(
+				send_snap_file ? &checkpoint->vclock :
+						 &replicaset.vclock,
 				"replica %s", tt_uuid_str(&instance_uuid));
 	if (gc == NULL)
 		diag_raise();
@@ -1739,11 +2261,21 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 		 tt_uuid_str(&instance_uuid), sio_socketname(io->fd));
 
 	/*
-	 * Initial stream: feed replica with dirty data from engines.
+	 * Initial stream: either the raw snapshot file or dirty
+	 * data from engines fed row by row.
 	 */
 	struct vclock start_vclock;
-	relay_initial_join(io->fd, header->sync, &start_vclock);
-	say_info("initial data sent.");
+	if (send_snap_file) {
+		box_join_send_snap_file(io, header, probe.path,
+					&checkpoint->vclock, &resume_vclock,
+					snap_offset);
+		vclock_copy(&start_vclock, &checkpoint->vclock);
+		say_info("snapshot file sent.");
+	} else {
+		relay_initial_join(io->fd, header->sync, &start_vclock,
+				   cfg_getd("snap_io_rate_limit"));
+		say_info("initial data sent.");
+	}
 
 	/**
 	 * Call the server-side hook which stores the replica uuid
@@ -1806,6 +2338,28 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	uint32_t id_filter;
 	xrow_decode_subscribe_xc(header, NULL, &replica_uuid, &replica_clock,
 				 &replica_version_id, &anon, &id_filter);
+	/*
+	 * Stream compression is opt-in: the replica advertises
+	 * the codec it can read and the master confirms it in
+	 * the response. Either side being old leaves the stream
+	 * uncompressed.
+	 */
+	bool compress = false;
+	if (xrow_decode_compression(header, &compress) != 0)
+		diag_raise();
+	/*
+	 * A replica on the same host gains nothing from stream
+	 * compression: the bytes never leave the machine, while the
+	 * codec burns CPU in both the relay and the applier.
+	 * Decline the codec in the response - the replica will keep
+	 * reading a plain stream.
+	 */
+	if (compress && sio_peer_is_local(io->fd)) {
+		compress = false;
+		say_info("replica at %s is on the same host, "
+			 "not compressing the replication stream",
+			 sio_socketname(io->fd));
+	}
 
 	/* Forbid connection to itself */
 	if (tt_uuid_is_equal(&replica_uuid, &INSTANCE_UUID))
@@ -1858,7 +2412,8 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * the additional field.
 	 */
 	struct xrow_header row;
-	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock);
+	xrow_encode_subscribe_response_xc(&row, &REPLICASET_UUID, &vclock,
+					  compress);
 	/*
 	 * Identify the message with the replica id of this
 	 * instance, this is the only way for a replica to find
@@ -1888,7 +2443,7 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * indefinitely).
 	 */
 	relay_subscribe(replica, io->fd, header->sync, &replica_clock,
-			replica_version_id, id_filter);
+			replica_version_id, id_filter, compress);
 }
 
 void
@@ -1939,7 +2494,16 @@ box_free(void)
 		tuple_free();
 		port_free();
 #endif
+		if (sql_warmup_path[0] != '\0' &&
+		    sql_stmt_cache_save(sql_warmup_path) != 0) {
+			diag_log();
+			diag_clear(diag_get());
+		}
+		stat_snapshot_free();
 		iproto_free();
+		auth_ticket_free();
+		mat_view_free();
+		txn_limbo_free();
 		replication_free();
 		sequence_free();
 		gc_free();
@@ -1964,6 +2528,7 @@ engine_init()
 				    cfg_geti("memtx_min_tuple_size"),
 				    cfg_geti("strip_core"),
 				    cfg_getd("slab_alloc_factor"));
+	memtx_engine_set_use_mvcc(memtx, cfg_geti("memtx_use_mvcc_engine") != 0);
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
 
@@ -1978,6 +2543,7 @@ engine_init()
 
 	struct engine *vinyl;
 	vinyl = vinyl_engine_new_xc(cfg_gets("vinyl_dir"),
+				    cfg_gets("vinyl_cold_dir"),
 				    cfg_geti64("vinyl_memory"),
 				    cfg_geti("vinyl_read_threads"),
 				    cfg_geti("vinyl_write_threads"),
@@ -2187,6 +2753,13 @@ local_recovery(const struct tt_uuid *instance_uuid,
 	recovery = recovery_new(cfg_gets("wal_dir"),
 				cfg_geti("force_recovery"),
 				checkpoint_vclock);
+	/*
+	 * Pipeline WAL reading: a prefetch thread checksums and
+	 * decompresses the logs while tx applies the rows. The
+	 * cursor falls back to serial reading on the log being
+	 * written, so hot standby keeps working.
+	 */
+	recovery->wal_dir.prefetch = true;
 
 	/*
 	 * Make sure we report the actual recovery position
@@ -2335,6 +2908,7 @@ box_init(void)
 		diag_raise();
 
 	sequence_init();
+	txn_limbo_init();
 }
 
 bool
@@ -2361,13 +2935,15 @@ box_cfg_xc(void)
 	schema_init();
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_threads(cfg_geti("iproto_threads")));
 	sql_init();
 
 	int64_t wal_max_size = box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
-	if (wal_init(wal_mode, txn_complete_async, cfg_gets("wal_dir"),
-		     wal_max_size, &INSTANCE_UUID, on_wal_garbage_collection,
+	if (wal_init(wal_mode, cfg_geti("wal_io_uring") != 0,
+		     cfg_geti("wal_direct_write") != 0,
+		     txn_complete_async, cfg_gets("wal_dir"), wal_max_size,
+		     &INSTANCE_UUID, on_wal_garbage_collection,
 		     on_wal_checkpoint_threshold) != 0) {
 		diag_raise();
 	}
@@ -2381,7 +2957,9 @@ box_cfg_xc(void)
 	if (box_set_prepared_stmt_cache_size() != 0)
 		diag_raise();
 	box_set_net_msg_max();
+	box_set_net_defer_latency();
 	box_set_readahead();
+	box_set_sequence_cache_size();
 	box_set_too_long_threshold();
 	box_set_replication_timeout();
 	box_set_replication_connect_timeout();
@@ -2389,6 +2967,9 @@ box_cfg_xc(void)
 	box_set_replication_sync_lag();
 	box_set_replication_sync_timeout();
 	box_set_replication_skip_conflict();
+	box_set_replication_compression();
+	box_set_replication_synchro_quorum();
+	box_set_replication_synchro_timeout();
 	box_set_replication_anon();
 
 	struct gc_checkpoint *checkpoint = gc_last_checkpoint();
@@ -2444,6 +3025,29 @@ box_cfg_xc(void)
 	fiber_gc();
 	is_box_configured = true;
 
+	stat_snapshot_init();
+
+	/*
+	 * A read-only instance is a promotion candidate: prepare
+	 * the WAL writer in advance so that flipping read_only to
+	 * false makes the instance writable in milliseconds, not
+	 * seconds.
+	 */
+	if (box_is_ro())
+		wal_warmup();
+
+	/*
+	 * Re-prepare the statements dumped on the previous
+	 * shutdown, so that the post-restart latency spike of
+	 * compiling them is paid at boot, not by the clients.
+	 */
+	snprintf(sql_warmup_path, sizeof(sql_warmup_path), "%s/warmup.sql",
+		 cfg_gets("memtx_dir"));
+	if (sql_warmup(sql_warmup_path) != 0) {
+		diag_log();
+		diag_clear(diag_get());
+	}
+
 	title("running");
 	say_info("ready to accept requests");
 
@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include "trivia/util.h"
+#include "authentication.h"
 
 #include <stdbool.h>
 
@@ -182,6 +183,14 @@ box_reset_stat(void);
 void
 box_process_auth(struct auth_request *request, const char *salt);
 
+/**
+ * Finish an authentication whose scramble has been pre-checked
+ * by a network thread, see authenticate_cached().
+ */
+void
+box_process_auth_cached(struct auth_request *request,
+			enum auth_precheck precheck);
+
 /** Send current read view to the replica. */
 void
 box_process_fetch_snapshot(struct ev_io *io, struct xrow_header *header);
@@ -228,11 +237,19 @@ void box_set_log_level(void);
 void box_set_log_format(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_snap_direct_write(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
+void box_set_sequence_cache_size(void);
 void box_set_checkpoint_count(void);
+void box_set_checkpoint_threads(void);
+void box_set_checkpoint_incremental(void);
+void box_set_checkpoint_columnar(void);
 void box_set_checkpoint_interval(void);
 void box_set_checkpoint_wal_threshold(void);
+void box_set_checkpoint_recovery_target(void);
+void box_set_wal_retention_size(void);
+void box_set_wal_consumer_timeout(void);
 void box_set_memtx_memory(void);
 void box_set_memtx_max_tuple_size(void);
 void box_set_vinyl_memory(void);
@@ -245,8 +262,12 @@ void box_set_replication_connect_quorum(void);
 void box_set_replication_sync_lag(void);
 void box_set_replication_sync_timeout(void);
 void box_set_replication_skip_conflict(void);
+void box_set_replication_compression(void);
+void box_set_replication_synchro_quorum(void);
+void box_set_replication_synchro_timeout(void);
 void box_set_replication_anon(void);
 void box_set_net_msg_max(void);
+void box_set_net_defer_latency(void);
 
 int
 box_set_prepared_stmt_cache_size(void);
@@ -284,6 +305,25 @@ typedef struct box_function_ctx box_function_ctx_t;
 API_EXPORT int
 box_return_tuple(box_function_ctx_t *ctx, box_tuple_t *tuple);
 
+/**
+ * Return a MessagePack encoded result from a stored C procedure.
+ *
+ * The value must be a MessagePack array: one result row. It is
+ * copied into the runtime tuple arena right away and released
+ * automatically once the reply is sent, so \a mp may point to a
+ * stack or region buffer and no tuple management is needed on
+ * the procedure side.
+ *
+ * \param ctx an opaque structure passed to the stored C procedure
+ * by Tarantool
+ * \param mp MessagePack encoded result
+ * \param mp_end end of \a mp
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 otherwise
+ */
+API_EXPORT int
+box_return_mp(box_function_ctx_t *ctx, const char *mp, const char *mp_end);
+
 /**
  * Find space id by name.
  *
@@ -326,6 +366,25 @@ API_EXPORT int
 box_insert(uint32_t space_id, const char *tuple, const char *tuple_end,
 	   box_tuple_t **result);
 
+/**
+ * Execute an INSERT request unless a tuple with the same primary
+ * key already exists. A duplicate is not an error: the request
+ * simply does nothing and @a result is set to NULL, bypassing
+ * the transaction rollback machinery and error construction.
+ *
+ * \param space_id space identifier
+ * \param tuple encoded tuple in MsgPack Array format ([ field1, field2, ...])
+ * \param tuple_end end of @a tuple
+ * \param[out] result the inserted tuple or NULL if the insert was
+ *  dismissed. Can be set to NULL to discard result.
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \sa \code box.space[space_id]:insert_ignore(tuple) \endcode
+ */
+API_EXPORT int
+box_insert_ignore(uint32_t space_id, const char *tuple, const char *tuple_end,
+		  box_tuple_t **result);
+
 /**
  * Execute an REPLACE request.
  *
@@ -341,6 +400,30 @@ API_EXPORT int
 box_replace(uint32_t space_id, const char *tuple, const char *tuple_end,
 	    box_tuple_t **result);
 
+/**
+ * Execute a batch of REPLACE requests against one space in a
+ * single transaction.
+ *
+ * If no transaction is active, one is started, and the whole
+ * batch is committed as one transaction with a single journal
+ * entry, which makes bulk loading considerably cheaper than a
+ * replace per request. If called inside an active transaction,
+ * the batch simply becomes part of it. On any error the started
+ * transaction is rolled back and no tuple of the batch is
+ * inserted.
+ *
+ * \param space_id space identifier
+ * \param tuples \a tuple_count encoded tuples laid out back to
+ *        back, each in MsgPack Array format ([ field1, ... ])
+ * \param tuples_end end of the last tuple in @a tuples
+ * \param tuple_count the number of tuples in @a tuples
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ */
+API_EXPORT int
+box_insert_batch(uint32_t space_id, const char *tuples,
+		 const char *tuples_end, uint32_t tuple_count);
+
 /**
  * Execute an DELETE request.
  *
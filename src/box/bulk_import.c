@@ -0,0 +1,281 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "bulk_import.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <msgpuck.h>
+#include <small/ibuf.h>
+
+#include "box.h"
+#include "coio_file.h"
+#include "csv/csv.h"
+#include "diag.h"
+#include "errcode.h"
+#include "fiber.h"
+
+enum {
+	/** File read granularity. */
+	BULK_IMPORT_CHUNK_SIZE = 256 * 1024,
+	/** Rows per transaction when the caller passes 0. */
+	BULK_IMPORT_BATCH_DEFAULT = 1000,
+	/**
+	 * Cap on rows per transaction: a transaction has to fit
+	 * in memory and too large a WAL entry stalls replication.
+	 */
+	BULK_IMPORT_BATCH_MAX = 100000,
+};
+
+/**
+ * Append one CSV field to a MsgPack row under construction.
+ * A field which parses entirely as an integer or a floating
+ * point number is encoded as a number, anything else as a
+ * string - the same coercion a hand-written Lua loader does
+ * with tonumber(), only without the interpreter round trip.
+ */
+static int
+bulk_import_encode_field(struct ibuf *out, const char *field, size_t len)
+{
+	size_t max_size = mp_sizeof_str(len);
+	if (max_size < 16)
+		max_size = 16;
+	char *pos = ibuf_reserve(out, max_size);
+	if (pos == NULL) {
+		diag_set(OutOfMemory, max_size, "ibuf_reserve", "field");
+		return -1;
+	}
+	if (len > 0 && len < 32) {
+		char num[32];
+		memcpy(num, field, len);
+		num[len] = '\0';
+		char *end;
+		errno = 0;
+		long long ival = strtoll(num, &end, 10);
+		if (*end == '\0' && errno == 0) {
+			if (ival < 0)
+				out->wpos = mp_encode_int(pos, ival);
+			else
+				out->wpos = mp_encode_uint(pos, ival);
+			return 0;
+		}
+		errno = 0;
+		double dval = strtod(num, &end);
+		if (*end == '\0' && errno == 0) {
+			out->wpos = mp_encode_double(pos, dval);
+			return 0;
+		}
+	}
+	out->wpos = mp_encode_str(pos, field, len);
+	return 0;
+}
+
+/**
+ * Load a stream of back to back MsgPack arrays. Rows are carved
+ * out of the read buffer and replaced in place - no intermediate
+ * decode or copy.
+ */
+static ssize_t
+bulk_import_msgpack(uint32_t space_id, int fd, uint32_t batch_size)
+{
+	struct ibuf buf;
+	ibuf_create(&buf, cord_slab_cache(), BULK_IMPORT_CHUNK_SIZE);
+	ssize_t total = -1;
+	ssize_t loaded = 0;
+	bool eof = false;
+	for (;;) {
+		/* Carve complete rows out of the buffer. */
+		const char *batch = buf.rpos;
+		const char *pos = buf.rpos;
+		uint32_t batch_rows = 0;
+		while (batch_rows < batch_size && pos != buf.wpos) {
+			const char *row = pos;
+			if (mp_check(&pos, buf.wpos) != 0) {
+				/* Incomplete tail, read more. */
+				pos = row;
+				break;
+			}
+			batch_rows++;
+		}
+		if (batch_rows > 0) {
+			if (box_insert_batch(space_id, batch, pos,
+					     batch_rows) != 0)
+				goto out;
+			loaded += batch_rows;
+			ibuf_consume(&buf, pos - batch);
+			continue;
+		}
+		if (eof) {
+			if (ibuf_used(&buf) != 0) {
+				diag_set(ClientError, ER_INVALID_MSGPACK,
+					 "bulk import row");
+				goto out;
+			}
+			total = loaded;
+			goto out;
+		}
+		void *dst = ibuf_reserve(&buf, BULK_IMPORT_CHUNK_SIZE);
+		if (dst == NULL) {
+			diag_set(OutOfMemory, BULK_IMPORT_CHUNK_SIZE,
+				 "ibuf_reserve", "bulk import buffer");
+			goto out;
+		}
+		ssize_t n = coio_read(fd, dst, BULK_IMPORT_CHUNK_SIZE);
+		if (n < 0) {
+			diag_set(SystemError, "bulk import read failed");
+			goto out;
+		}
+		if (n == 0)
+			eof = true;
+		buf.wpos += n;
+	}
+out:
+	ibuf_destroy(&buf);
+	return total;
+}
+
+/** Load a CSV file, one row per line. */
+static ssize_t
+bulk_import_csv(uint32_t space_id, int fd, uint32_t batch_size)
+{
+	struct csv csv;
+	csv_create(&csv);
+	struct csv_iterator it;
+	csv_iterator_create(&it, &csv);
+	/* Encoded rows of the current batch, back to back. */
+	struct ibuf rows;
+	ibuf_create(&rows, cord_slab_cache(), BULK_IMPORT_CHUNK_SIZE);
+	/* Encoded fields of the row under construction. */
+	struct ibuf fields;
+	ibuf_create(&fields, cord_slab_cache(), 1024);
+	ssize_t total = -1;
+	ssize_t loaded = 0;
+	uint32_t batch_rows = 0;
+	uint32_t field_count = 0;
+	char *chunk = malloc(BULK_IMPORT_CHUNK_SIZE);
+	if (chunk == NULL) {
+		diag_set(OutOfMemory, BULK_IMPORT_CHUNK_SIZE, "malloc",
+			 "bulk import buffer");
+		goto out;
+	}
+	for (;;) {
+		ssize_t n = coio_read(fd, chunk, BULK_IMPORT_CHUNK_SIZE);
+		if (n < 0) {
+			diag_set(SystemError, "bulk import read failed");
+			goto out;
+		}
+		/* An empty buffer tells the parser this is EOF. */
+		csv_feed(&it, chunk, n);
+		int st;
+		while ((st = csv_next(&it)) != CSV_IT_NEEDMORE) {
+			if (st == CSV_IT_ERROR) {
+				diag_set(IllegalParams,
+					 "invalid CSV around row %lld",
+					 (long long)(loaded + batch_rows + 1));
+				goto out;
+			}
+			if (st == CSV_IT_OK) {
+				if (bulk_import_encode_field(&fields,
+						csv_iterator_get_field(&it),
+						csv_iterator_get_field_len(
+							&it)) != 0)
+					goto out;
+				field_count++;
+				continue;
+			}
+			/* CSV_IT_EOL or CSV_IT_EOF: finalize the row. */
+			if (field_count > 0) {
+				size_t fields_size = ibuf_used(&fields);
+				size_t row_size = mp_sizeof_array(field_count) +
+						  fields_size;
+				char *pos = ibuf_alloc(&rows, row_size);
+				if (pos == NULL) {
+					diag_set(OutOfMemory, row_size,
+						 "ibuf_alloc", "row");
+					goto out;
+				}
+				pos = mp_encode_array(pos, field_count);
+				memcpy(pos, fields.rpos, fields_size);
+				ibuf_reset(&fields);
+				field_count = 0;
+				batch_rows++;
+			}
+			if (batch_rows >= batch_size || st == CSV_IT_EOF) {
+				if (batch_rows > 0 &&
+				    box_insert_batch(space_id, rows.rpos,
+						     rows.wpos,
+						     batch_rows) != 0)
+					goto out;
+				loaded += batch_rows;
+				batch_rows = 0;
+				ibuf_reset(&rows);
+			}
+			if (st == CSV_IT_EOF) {
+				total = loaded;
+				goto out;
+			}
+		}
+	}
+out:
+	free(chunk);
+	ibuf_destroy(&fields);
+	ibuf_destroy(&rows);
+	csv_destroy(&csv);
+	return total;
+}
+
+ssize_t
+bulk_import(uint32_t space_id, const char *path,
+	    enum bulk_import_format format, uint32_t batch_size)
+{
+	if (batch_size == 0)
+		batch_size = BULK_IMPORT_BATCH_DEFAULT;
+	if (batch_size > BULK_IMPORT_BATCH_MAX)
+		batch_size = BULK_IMPORT_BATCH_MAX;
+	int fd = coio_file_open(path, O_RDONLY, 0);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s'", path);
+		return -1;
+	}
+	ssize_t rc;
+	switch (format) {
+	case BULK_IMPORT_CSV:
+		rc = bulk_import_csv(space_id, fd, batch_size);
+		break;
+	default:
+		rc = bulk_import_msgpack(space_id, fd, batch_size);
+		break;
+	}
+	coio_file_close(fd);
+	return rc;
+}
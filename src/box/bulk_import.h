@@ -0,0 +1,79 @@
+#ifndef TARANTOOL_BOX_BULK_IMPORT_H_INCLUDED
+#define TARANTOOL_BOX_BULK_IMPORT_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <sys/types.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** Input file layouts understood by bulk_import(). */
+enum bulk_import_format {
+	/** MsgPack arrays laid out back to back. */
+	BULK_IMPORT_MSGPACK = 0,
+	/** Comma-separated values, one row per line. */
+	BULK_IMPORT_CSV = 1,
+};
+
+/**
+ * Stream a file of rows straight into a space.
+ *
+ * The file is read in large chunks off the event loop thread and
+ * the rows are replaced into the space in transactions of
+ * @a batch_size rows each, so the whole batch costs one journal
+ * entry instead of a WAL write per row. A per-row Lua round trip
+ * is avoided entirely: CSV fields are converted to MsgPack right
+ * off the parser, numeric-looking fields become numbers, the rest
+ * become strings.
+ *
+ * Each batch commits on its own: a failure mid-file leaves the
+ * rows of the already committed batches in the space, and the
+ * returned error names the offending row.
+ *
+ * @param space_id space to load into
+ * @param path file to read
+ * @param format file layout, see enum bulk_import_format
+ * @param batch_size rows per transaction, 0 means the default
+ *
+ * @retval >= 0 the number of imported rows
+ * @retval -1 error, see diag
+ */
+ssize_t
+bulk_import(uint32_t space_id, const char *path,
+	    enum bulk_import_format format, uint32_t batch_size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_BULK_IMPORT_H_INCLUDED */
@@ -73,6 +73,203 @@ ck_constraint_def_delete(struct ck_constraint_def *ck_def)
 	free(ck_def);
 }
 
+/**
+ * Extract an integer literal from an expression AST node, also
+ * recognizing a unary minus over a literal.
+ * @param expr Expression node to inspect.
+ * @param[out] value The literal value.
+ * @retval true The node is an integer literal.
+ * @retval false Otherwise.
+ */
+static bool
+ck_constraint_expr_to_int(struct Expr *expr, int64_t *value)
+{
+	if (expr->op == TK_INTEGER && ExprHasProperty(expr, EP_IntValue)) {
+		*value = expr->u.iValue;
+		return true;
+	}
+	if (expr->op == TK_UMINUS && expr->pLeft != NULL &&
+	    expr->pLeft->op == TK_INTEGER &&
+	    ExprHasProperty(expr->pLeft, EP_IntValue)) {
+		*value = -(int64_t)expr->pLeft->u.iValue;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Try to specialize the check constraint expression into a direct
+ * C evaluator. The recognized shape is a comparison of a single
+ * field with an integer literal, in either operand order - the
+ * dominating pattern among real-world check constraints. The
+ * expression AST must have been resolved against the space
+ * definition. On a match ck_constraint::fast_op and friends are
+ * filled, otherwise fast_op is left CK_CONSTRAINT_FAST_NONE and
+ * the VDBE program remains the only evaluator.
+ * @param ck_constraint Check constraint to specialize.
+ * @param expr Resolved check constraint expression AST.
+ */
+static void
+ck_constraint_fast_compile(struct ck_constraint *ck_constraint,
+			   struct Expr *expr)
+{
+	enum ck_constraint_fast_op op;
+	switch (expr->op) {
+	case TK_LT:
+		op = CK_CONSTRAINT_FAST_LT;
+		break;
+	case TK_LE:
+		op = CK_CONSTRAINT_FAST_LE;
+		break;
+	case TK_GT:
+		op = CK_CONSTRAINT_FAST_GT;
+		break;
+	case TK_GE:
+		op = CK_CONSTRAINT_FAST_GE;
+		break;
+	case TK_EQ:
+		op = CK_CONSTRAINT_FAST_EQ;
+		break;
+	case TK_NE:
+		op = CK_CONSTRAINT_FAST_NE;
+		break;
+	default:
+		return;
+	}
+	struct Expr *column = expr->pLeft;
+	struct Expr *literal = expr->pRight;
+	int64_t rhs;
+	if (column->op != TK_COLUMN) {
+		/* Mirror 'literal op field' into 'field op literal'. */
+		column = expr->pRight;
+		literal = expr->pLeft;
+		if (column->op != TK_COLUMN)
+			return;
+		switch (op) {
+		case CK_CONSTRAINT_FAST_LT:
+			op = CK_CONSTRAINT_FAST_GT;
+			break;
+		case CK_CONSTRAINT_FAST_LE:
+			op = CK_CONSTRAINT_FAST_GE;
+			break;
+		case CK_CONSTRAINT_FAST_GT:
+			op = CK_CONSTRAINT_FAST_LT;
+			break;
+		case CK_CONSTRAINT_FAST_GE:
+			op = CK_CONSTRAINT_FAST_LE;
+			break;
+		default:
+			break;
+		}
+	}
+	if (column->iColumn < 0)
+		return;
+	if (!ck_constraint_expr_to_int(literal, &rhs))
+		return;
+	if (ExprHasProperty(expr, EP_Collate))
+		return;
+	ck_constraint->fast_op = op;
+	ck_constraint->fast_fieldno = column->iColumn;
+	ck_constraint->fast_rhs = rhs;
+}
+
+/**
+ * Evaluate a specialized check constraint against a tuple
+ * directly, without entering the VDBE.
+ * @param ck_constraint Check constraint to evaluate. Must have
+ *                      been specialized, see
+ *                      ck_constraint_fast_compile().
+ * @param tuple The tuple to test.
+ * @retval 0 The check constraint is satisfied.
+ * @retval -1 The check constraint is violated. The diag message
+ *            is set.
+ * @retval 1 The field type is not handled by the specialization,
+ *           the VDBE program must be run instead.
+ */
+static int
+ck_constraint_fast_eval(struct ck_constraint *ck_constraint,
+			struct tuple *tuple)
+{
+	assert(ck_constraint->fast_op != CK_CONSTRAINT_FAST_NONE);
+	const char *field = tuple_field(tuple, ck_constraint->fast_fieldno);
+	/*
+	 * As in the generated program, which jumps to the passed
+	 * label on NULL (SQL_JUMPIFNULL), an absent or nil field
+	 * satisfies the constraint.
+	 */
+	if (field == NULL)
+		return 0;
+	int64_t rhs = ck_constraint->fast_rhs;
+	int cmp;
+	switch (mp_typeof(*field)) {
+	case MP_NIL:
+		return 0;
+	case MP_UINT: {
+		uint64_t lhs = mp_decode_uint(&field);
+		if (rhs < 0 || lhs > INT64_MAX)
+			cmp = 1;
+		else
+			cmp = (int64_t)lhs < rhs ? -1 : (int64_t)lhs > rhs;
+		break;
+	}
+	case MP_INT: {
+		int64_t lhs = mp_decode_int(&field);
+		cmp = lhs < rhs ? -1 : lhs > rhs;
+		break;
+	}
+	case MP_FLOAT: {
+		/* The literal is 32-bit so the cast is exact. */
+		double lhs = mp_decode_float(&field);
+		/* SQL treats NaN as NULL, and NULL passes. */
+		if (lhs != lhs)
+			return 0;
+		cmp = lhs < (double)rhs ? -1 : lhs > (double)rhs;
+		break;
+	}
+	case MP_DOUBLE: {
+		double lhs = mp_decode_double(&field);
+		if (lhs != lhs)
+			return 0;
+		cmp = lhs < (double)rhs ? -1 : lhs > (double)rhs;
+		break;
+	}
+	default:
+		/*
+		 * Strings, booleans and the like follow the SQL
+		 * comparison rules, which the general program
+		 * implements.
+		 */
+		return 1;
+	}
+	bool is_satisfied;
+	switch (ck_constraint->fast_op) {
+	case CK_CONSTRAINT_FAST_LT:
+		is_satisfied = cmp < 0;
+		break;
+	case CK_CONSTRAINT_FAST_LE:
+		is_satisfied = cmp <= 0;
+		break;
+	case CK_CONSTRAINT_FAST_GT:
+		is_satisfied = cmp > 0;
+		break;
+	case CK_CONSTRAINT_FAST_GE:
+		is_satisfied = cmp >= 0;
+		break;
+	case CK_CONSTRAINT_FAST_EQ:
+		is_satisfied = cmp == 0;
+		break;
+	default:
+		assert(ck_constraint->fast_op == CK_CONSTRAINT_FAST_NE);
+		is_satisfied = cmp != 0;
+		break;
+	}
+	if (is_satisfied)
+		return 0;
+	diag_set(ClientError, ER_CK_CONSTRAINT_FAILED,
+		 ck_constraint->def->name, ck_constraint->def->expr_str);
+	return -1;
+}
+
 /**
  * Resolve space_def references for check constraint via AST
  * tree traversal.
@@ -203,13 +400,73 @@ ck_constraint_on_replace_trigger(struct trigger *trigger, void *event)
 
 	struct ck_constraint *ck_constraint;
 	rlist_foreach_entry(ck_constraint, &space->ck_constraint, link) {
-		if (ck_constraint->def->is_enabled &&
-		    ck_constraint_program_run(ck_constraint, field_ref) != 0)
+		if (!ck_constraint->def->is_enabled)
+			continue;
+		if (ck_constraint->fast_op != CK_CONSTRAINT_FAST_NONE) {
+			int rc = ck_constraint_fast_eval(ck_constraint,
+							 new_tuple);
+			if (rc <= 0) {
+				if (rc < 0)
+					return -1;
+				continue;
+			}
+			/* Fall back to the program. */
+		}
+		if (ck_constraint_program_run(ck_constraint, field_ref) != 0)
 			return -1;
 	}
 	return 0;
 }
 
+int
+ck_constraint_test(struct ck_constraint *ck_constraint, struct tuple *tuple,
+		   uint32_t field_count, bool *is_satisfied)
+{
+	if (ck_constraint->fast_op != CK_CONSTRAINT_FAST_NONE) {
+		int rc = ck_constraint_fast_eval(ck_constraint, tuple);
+		if (rc <= 0) {
+			if (rc < 0)
+				diag_clear(diag_get());
+			*is_satisfied = rc == 0;
+			return 0;
+		}
+		/* Fall back to the program. */
+	}
+	/*
+	 * Unlike SQL tables, plain spaces do not enforce an exact
+	 * field count, so the tuple may carry more fields than the
+	 * space format declares. The field reference slots are
+	 * initialized per decoded tuple field - size them for the
+	 * larger of the two.
+	 */
+	uint32_t slot_count = MAX(field_count, tuple_field_count(tuple));
+	uint32_t field_ref_sz = sizeof(struct vdbe_field_ref) +
+				sizeof(uint32_t) * slot_count;
+	struct vdbe_field_ref *field_ref =
+		region_alloc(&fiber()->gc, field_ref_sz);
+	if (field_ref == NULL) {
+		diag_set(OutOfMemory, field_ref_sz, "region_alloc",
+			 "field_ref");
+		return -1;
+	}
+	vdbe_field_ref_prepare_tuple(field_ref, tuple);
+	if (ck_constraint_program_run(ck_constraint, field_ref) == 0) {
+		*is_satisfied = true;
+		return 0;
+	}
+	/*
+	 * The program reports an unsatisfied expression the same
+	 * way the on_replace trigger consumes it - as an error.
+	 * Here it is a legitimate verdict, so absorb it; anything
+	 * else is a real evaluation failure.
+	 */
+	if (box_error_code(box_error_last()) != ER_CK_CONSTRAINT_FAILED)
+		return -1;
+	diag_clear(diag_get());
+	*is_satisfied = false;
+	return 0;
+}
+
 struct ck_constraint *
 ck_constraint_new(struct ck_constraint_def *ck_constraint_def,
 		  struct space_def *space_def)
@@ -227,6 +484,9 @@ ck_constraint_new(struct ck_constraint_def *ck_constraint_def,
 	}
 	ck_constraint->def = NULL;
 	ck_constraint->stmt = NULL;
+	ck_constraint->fast_op = CK_CONSTRAINT_FAST_NONE;
+	ck_constraint->fast_fieldno = 0;
+	ck_constraint->fast_rhs = 0;
 	rlist_create(&ck_constraint->link);
 	struct Expr *expr =
 		sql_expr_compile(sql_get(), ck_constraint_def->expr_str,
@@ -242,6 +502,7 @@ ck_constraint_new(struct ck_constraint_def *ck_constraint_def,
 		ck_constraint_program_compile(ck_constraint_def, expr);
 	if (ck_constraint->stmt == NULL)
 		goto error;
+	ck_constraint_fast_compile(ck_constraint, expr);
 
 	sql_expr_delete(sql_get(), expr, false);
 	ck_constraint->def = ck_constraint_def;
@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "small/rlist.h"
 
@@ -39,6 +40,7 @@ extern "C" {
 #endif
 
 struct space;
+struct tuple;
 struct space_def;
 struct sql_stmt;
 struct Expr;
@@ -53,6 +55,20 @@ enum ck_constraint_language {
 /** The supported languages strings.  */
 extern const char *ck_constraint_language_strs[];
 
+/**
+ * Comparison operator of a specialized check constraint
+ * evaluator, see ck_constraint::fast_op.
+ */
+enum ck_constraint_fast_op {
+	CK_CONSTRAINT_FAST_NONE = 0,
+	CK_CONSTRAINT_FAST_LT,
+	CK_CONSTRAINT_FAST_LE,
+	CK_CONSTRAINT_FAST_GT,
+	CK_CONSTRAINT_FAST_GE,
+	CK_CONSTRAINT_FAST_EQ,
+	CK_CONSTRAINT_FAST_NE,
+};
+
 /**
  * Check constraint definition.
  * See ck_constraint_def_sizeof() definition for implementation
@@ -98,6 +114,21 @@ struct ck_constraint {
 	 * message when ck condition unsatisfied.
 	 */
 	struct sql_stmt *stmt;
+	/**
+	 * When the expression is a comparison of a single field
+	 * with an integer literal, it is specialized at DDL time
+	 * into a direct evaluation over the decoded field value,
+	 * which is several times cheaper than a VDBE pass. The
+	 * program is kept as a fallback for field types the
+	 * specialization does not handle. Set to
+	 * CK_CONSTRAINT_FAST_NONE when the expression is too
+	 * complex to specialize.
+	 */
+	enum ck_constraint_fast_op fast_op;
+	/** Field number the specialized comparison reads. */
+	uint32_t fast_fieldno;
+	/** Right-hand side literal of the comparison. */
+	int64_t fast_rhs;
 	/**
 	 * Organize check constraint structs into linked list
 	 * with space::ck_constraint.
@@ -207,6 +238,25 @@ ck_constraint_delete(struct ck_constraint *ck_constraint);
 int
 ck_constraint_on_replace_trigger(struct trigger *trigger, void *event);
 
+/**
+ * Evaluate the check constraint expression against an arbitrary
+ * tuple. Unlike the on_replace trigger, an unsatisfied expression
+ * is not an error here: the verdict is returned via
+ * @a is_satisfied. Used by partial indexes to decide whether a
+ * tuple belongs to the index.
+ *
+ * @param ck_constraint The constraint whose expression to run.
+ * @param tuple The tuple to test.
+ * @param field_count The field count of the space definition the
+ *                    expression was compiled against.
+ * @param[out] is_satisfied Set to the expression verdict.
+ * @retval 0 On success.
+ * @retval -1 On evaluation error. The diag message is set.
+ */
+int
+ck_constraint_test(struct ck_constraint *ck_constraint, struct tuple *tuple,
+		   uint32_t field_count, bool *is_satisfied);
+
 /**
  * Find check constraint object in space by given name and
  * name_len.
@@ -32,16 +32,48 @@
 #include "coll_id.h"
 #include "diag.h"
 #include "assoc.h"
+#include "salad/mhash_cow.h"
 
 /** mhash table (name, len -> collation) */
 static struct mh_strnptr_t *coll_cache_name = NULL;
-/** mhash table (id -> collation) */
-static struct mh_i32ptr_t *coll_id_cache = NULL;
+/**
+ * mhash table (id -> collation), published copy-on-write so that
+ * threads other than tx can probe it without locking: every
+ * mutation clones the table, applies the change to the clone and
+ * publishes it, the old table is reclaimed once all registered
+ * readers have moved past it.
+ */
+static struct mh_cow coll_id_cow;
+
+static void
+coll_id_cache_free_table(void *table)
+{
+	mh_i32ptr_delete((struct mh_i32ptr_t *)table);
+}
+
+/** Clone the id hash for a copy-on-write mutation. */
+static struct mh_i32ptr_t *
+coll_id_cache_clone(struct mh_i32ptr_t *src)
+{
+	struct mh_i32ptr_t *dst = mh_i32ptr_new();
+	if (dst == NULL)
+		return NULL;
+	mh_int_t i;
+	mh_foreach(src, i) {
+		struct mh_i32ptr_node_t *node = mh_i32ptr_node(src, i);
+		struct mh_i32ptr_node_t *old = NULL;
+		if (mh_i32ptr_put(dst, node, &old, NULL) == mh_end(dst)) {
+			mh_i32ptr_delete(dst);
+			return NULL;
+		}
+	}
+	return dst;
+}
 
 int
 coll_id_cache_init()
 {
-	coll_id_cache = mh_i32ptr_new();
+	struct mh_i32ptr_t *coll_id_cache = mh_i32ptr_new();
 	if (coll_id_cache == NULL) {
 		diag_set(OutOfMemory, sizeof(*coll_id_cache), "malloc",
 			 "coll_id_cache");
@@ -54,6 +86,7 @@ coll_id_cache_init()
 		mh_i32ptr_delete(coll_id_cache);
 		return -1;
 	}
+	mh_cow_create(&coll_id_cow, coll_id_cache, coll_id_cache_free_table);
 	return 0;
 }
 
@@ -61,20 +94,33 @@ void
 coll_id_cache_destroy()
 {
 	mh_strnptr_delete(coll_cache_name);
-	mh_i32ptr_delete(coll_id_cache);
+	mh_cow_destroy(&coll_id_cow);
+}
+
+struct mh_cow *
+coll_id_cache_cow(void)
+{
+	return &coll_id_cow;
 }
 
 int
 coll_id_cache_replace(struct coll_id *coll_id, struct coll_id **replaced_id)
 {
+	struct mh_i32ptr_t *coll_id_cache = mh_cow_get(&coll_id_cow);
+	struct mh_i32ptr_t *new_cache = coll_id_cache_clone(coll_id_cache);
+	if (new_cache == NULL) {
+		diag_set(OutOfMemory, sizeof(*new_cache), "malloc",
+			 "coll_id_cache");
+		return -1;
+	}
 	const struct mh_i32ptr_node_t id_node = {coll_id->id, coll_id};
 	struct mh_i32ptr_node_t repl_id_node = {0, NULL};
 	struct mh_i32ptr_node_t *prepl_id_node = &repl_id_node;
-	mh_int_t i =
-		mh_i32ptr_put(coll_id_cache, &id_node, &prepl_id_node, NULL);
-	if (i == mh_end(coll_id_cache)) {
+	if (mh_i32ptr_put(new_cache, &id_node, &prepl_id_node,
+			  NULL) == mh_end(new_cache)) {
 		diag_set(OutOfMemory, sizeof(id_node), "malloc",
 			 "coll_id_cache");
+		mh_i32ptr_delete(new_cache);
 		return -1;
 	}
 
@@ -84,10 +130,20 @@ coll_id_cache_replace(struct coll_id *coll_id, struct coll_id **replaced_id)
 	struct mh_strnptr_node_t repl_name_node = { NULL, 0, 0, NULL };
 	struct mh_strnptr_node_t *prepl_node_name = &repl_name_node;
 	if (mh_strnptr_put(coll_cache_name, &name_node, &prepl_node_name,
-			   NULL) == mh_end(coll_id_cache)) {
+			   NULL) == mh_end(coll_cache_name)) {
 		diag_set(OutOfMemory, sizeof(name_node), "malloc",
 			 "coll_cache_name");
-		mh_i32ptr_del(coll_id_cache, i, NULL);
+		mh_i32ptr_delete(new_cache);
+		return -1;
+	}
+	if (mh_cow_publish(&coll_id_cow, new_cache) != 0) {
+		diag_set(OutOfMemory, sizeof(struct mh_cow_garbage), "malloc",
+			 "coll_id_cache");
+		mh_int_t name_i = mh_strnptr_find_inp(coll_cache_name,
+						      coll_id->name,
+						      coll_id->name_len);
+		mh_strnptr_del(coll_cache_name, name_i, NULL);
+		mh_i32ptr_delete(new_cache);
 		return -1;
 	}
 	assert(repl_id_node.val == repl_name_node.val);
@@ -99,8 +155,29 @@ coll_id_cache_replace(struct coll_id *coll_id, struct coll_id **replaced_id)
 void
 coll_id_cache_delete(const struct coll_id *coll_id)
 {
-	mh_int_t id_i = mh_i32ptr_find(coll_id_cache, coll_id->id, NULL);
-	mh_i32ptr_del(coll_id_cache, id_i, NULL);
+	struct mh_i32ptr_t *coll_id_cache = mh_cow_get(&coll_id_cow);
+	struct mh_i32ptr_t *new_cache = coll_id_cache_clone(coll_id_cache);
+	if (new_cache != NULL) {
+		mh_int_t id_i = mh_i32ptr_find(new_cache, coll_id->id, NULL);
+		if (id_i != mh_end(new_cache))
+			mh_i32ptr_del(new_cache, id_i, NULL);
+		if (mh_cow_publish(&coll_id_cow, new_cache) != 0) {
+			mh_i32ptr_delete(new_cache);
+			new_cache = NULL;
+		}
+	}
+	if (new_cache == NULL) {
+		/*
+		 * Can not publish a copy: delete in place. A
+		 * stale pointer is worse than a concurrent reader
+		 * possibly missing an unrelated entry while the
+		 * nodes are being moved around.
+		 */
+		mh_int_t id_i = mh_i32ptr_find(coll_id_cache, coll_id->id,
+					       NULL);
+		if (id_i != mh_end(coll_id_cache))
+			mh_i32ptr_del(coll_id_cache, id_i, NULL);
+	}
 	mh_int_t name_i = mh_strnptr_find_inp(coll_cache_name, coll_id->name,
 					      coll_id->name_len);
 	mh_strnptr_del(coll_cache_name, name_i, NULL);
@@ -109,6 +186,7 @@ coll_id_cache_delete(const struct coll_id *coll_id)
 struct coll_id *
 coll_by_id(uint32_t id)
 {
+	struct mh_i32ptr_t *coll_id_cache = mh_cow_get(&coll_id_cow);
 	mh_int_t pos = mh_i32ptr_find(coll_id_cache, id, NULL);
 	if (pos == mh_end(coll_id_cache))
 		return NULL;
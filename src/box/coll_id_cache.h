@@ -37,6 +37,7 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct coll_id;
+struct mh_cow;
 
 /**
  * Create global hash tables.
@@ -45,6 +46,15 @@ struct coll_id;
 int
 coll_id_cache_init();
 
+/**
+ * The copy-on-write publication of the id hash, see
+ * salad/mhash_cow.h. A thread other than tx registers a reader
+ * with it and may then probe the mh_i32ptr_t snapshot returned
+ * by mh_cow_read_lock() without any locking.
+ */
+struct mh_cow *
+coll_id_cache_cow(void);
+
 /** Delete global hash tables. */
 void
 coll_id_cache_destroy();
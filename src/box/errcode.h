@@ -265,6 +265,8 @@ struct errcode_record {
 	/*210 */_(ER_SQL_PREPARE,		"Failed to prepare SQL statement: %s") \
 	/*211 */_(ER_WRONG_QUERY_ID,		"Prepared statement with id %u does not exist") \
 	/*212 */_(ER_SEQUENCE_NOT_STARTED,		"Sequence '%s' is not started") \
+	/*213 */_(ER_TUPLE_FIELD_MAP_OVERFLOW,	"Tuple field map of %u bytes exceeds the compact field map limit") \
+	/*214 */_(ER_WATCHER_LIMIT,		"Watcher limit of %u per connection is reached") \
 
 /*
  * !IMPORTANT! Please follow instructions at start of the file
@@ -30,6 +30,14 @@
  */
 #include "execute.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <msgpuck.h>
+
 #include "assoc.h"
 #include "bind.h"
 #include "iproto_constants.h"
@@ -49,6 +57,7 @@
 #include "box/sql_stmt_cache.h"
 #include "session.h"
 #include "rmean.h"
+#include "say.h"
 
 const char *sql_info_key_strs[] = {
 	"row_count",
@@ -129,6 +138,8 @@ port_sql_create(struct port *port, struct sql_stmt *stmt,
 	port_sql->stmt = stmt;
 	port_sql->serialization_format = format;
 	port_sql->do_finalize = do_finalize;
+	port_sql->announce_metadata_version = false;
+	port_sql->skip_metadata = false;
 }
 
 /**
@@ -476,14 +487,28 @@ port_sql_dump_msgpack(struct port *port, struct obuf *out)
 	switch (sql_port->serialization_format) {
 	case DQL_EXECUTE: {
 		int keys = 2;
+		if (sql_port->announce_metadata_version)
+			keys++;
+		if (sql_port->skip_metadata)
+			keys--;
 		int size = mp_sizeof_map(keys);
+		if (sql_port->announce_metadata_version) {
+			size += mp_sizeof_uint(IPROTO_METADATA_VERSION) +
+				mp_sizeof_uint(sql_stmt_schema_version(stmt));
+		}
 		char *pos = (char *) obuf_alloc(out, size);
 		if (pos == NULL) {
 			diag_set(OutOfMemory, size, "obuf_alloc", "pos");
 			return -1;
 		}
 		pos = mp_encode_map(pos, keys);
-		if (sql_get_metadata(stmt, out, sql_column_count(stmt)) != 0)
+		if (sql_port->announce_metadata_version) {
+			pos = mp_encode_uint(pos, IPROTO_METADATA_VERSION);
+			pos = mp_encode_uint(pos,
+					     sql_stmt_schema_version(stmt));
+		}
+		if (!sql_port->skip_metadata &&
+		    sql_get_metadata(stmt, out, sql_column_count(stmt)) != 0)
 			return -1;
 		size = mp_sizeof_uint(IPROTO_DATA);
 		pos = (char *) obuf_alloc(out, size);
@@ -590,10 +615,12 @@ sql_reprepare(struct sql_stmt **stmt)
 {
 	const char *sql_str = sql_stmt_query_str(*stmt);
 	struct sql_stmt *new_stmt;
+	double start_time = ev_monotonic_now(loop());
 	if (sql_stmt_compile(sql_str, strlen(sql_str), NULL,
 			     &new_stmt, NULL) != 0)
 		return -1;
-	if (sql_stmt_cache_update(*stmt, new_stmt) != 0)
+	double prepare_time = ev_monotonic_now(loop()) - start_time;
+	if (sql_stmt_cache_update(*stmt, new_stmt, prepare_time) != 0)
 		return -1;
 	*stmt = new_stmt;
 	return 0;
@@ -611,9 +638,11 @@ sql_prepare(const char *sql, int len, struct port *port)
 	struct sql_stmt *stmt = sql_stmt_cache_find(stmt_id);
 	rmean_collect(rmean_box, IPROTO_PREPARE, 1);
 	if (stmt == NULL) {
+		double start_time = ev_monotonic_now(loop());
 		if (sql_stmt_compile(sql, len, NULL, &stmt, NULL) != 0)
 			return -1;
-		if (sql_stmt_cache_insert(stmt) != 0) {
+		double prepare_time = ev_monotonic_now(loop()) - start_time;
+		if (sql_stmt_cache_insert(stmt, prepare_time) != 0) {
 			sql_stmt_finalize(stmt);
 			return -1;
 		}
@@ -635,6 +664,85 @@ sql_prepare(const char *sql, int len, struct port *port)
 	return 0;
 }
 
+int
+sql_warmup(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		/* No dump - nothing to warm up. */
+		if (errno == ENOENT)
+			return 0;
+		diag_set(SystemError, "failed to open '%s' file", path);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		diag_set(SystemError, "failed to stat '%s' file", path);
+		close(fd);
+		return -1;
+	}
+	size_t size = st.st_size;
+	char *buf = malloc(size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "warmup dump");
+		close(fd);
+		return -1;
+	}
+	ssize_t n = read(fd, buf, size);
+	close(fd);
+	if (n != (ssize_t)size) {
+		diag_set(SystemError, "failed to read '%s' file", path);
+		free(buf);
+		return -1;
+	}
+	const char *p = buf;
+	const char *end = buf + size;
+	if (size == 0 || mp_check(&p, end) != 0 || p != end ||
+	    mp_typeof(*buf) != MP_ARRAY) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "sql warmup dump");
+		free(buf);
+		return -1;
+	}
+	p = buf;
+	uint32_t count = mp_decode_array(&p);
+	uint32_t warmed = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_typeof(*p) != MP_STR) {
+			mp_next(&p);
+			continue;
+		}
+		uint32_t len;
+		const char *sql = mp_decode_str(&p, &len);
+		uint32_t stmt_id = sql_stmt_calculate_id(sql, len);
+		if (sql_stmt_cache_find(stmt_id) != NULL)
+			continue;
+		struct sql_stmt *stmt;
+		double start_time = ev_monotonic_now(loop());
+		if (sql_stmt_compile(sql, len, NULL, &stmt, NULL) != 0) {
+			/*
+			 * The schema may have changed since the dump
+			 * was taken - skip what no longer compiles.
+			 */
+			diag_clear(diag_get());
+			continue;
+		}
+		double prepare_time = ev_monotonic_now(loop()) - start_time;
+		if (sql_stmt_cache_warmup_insert(stmt, prepare_time) != 0) {
+			/* The cache is full - enough warming. */
+			sql_stmt_finalize(stmt);
+			diag_clear(diag_get());
+			break;
+		}
+		warmed++;
+	}
+	free(buf);
+	if (warmed > 0) {
+		say_info("warmed up %u prepared statements from '%s'",
+			 warmed, path);
+	}
+	return 0;
+}
+
 /**
  * Deallocate prepared statement from current session:
  * remove its ID from session-local hash and unref entry
@@ -692,8 +800,8 @@ sql_execute(struct sql_stmt *stmt, struct port *port, struct region *region)
 
 int
 sql_execute_prepared(uint32_t stmt_id, const struct sql_bind *bind,
-		     uint32_t bind_count, struct port *port,
-		     struct region *region)
+		     uint32_t bind_count, const uint64_t *metadata_version,
+		     struct port *port, struct region *region)
 {
 
 	if (!session_check_stmt_id(current_session(), stmt_id)) {
@@ -716,6 +824,17 @@ sql_execute_prepared(uint32_t stmt_id, const struct sql_bind *bind,
 	enum sql_serialization_format format = sql_column_count(stmt) > 0 ?
 					       DQL_EXECUTE : DML_EXECUTE;
 	port_sql_create(port, stmt, format, false);
+	if (metadata_version != NULL && format == DQL_EXECUTE) {
+		/*
+		 * The metadata of a compiled statement can only
+		 * change on reprepare, so its version is the
+		 * schema version the statement was compiled at.
+		 */
+		struct port_sql *port_sql = (struct port_sql *) port;
+		port_sql->announce_metadata_version = true;
+		port_sql->skip_metadata =
+			*metadata_version == sql_stmt_schema_version(stmt);
+	}
 	if (sql_execute(stmt, port, region) != 0) {
 		port_destroy(port);
 		sql_stmt_reset(stmt);
@@ -65,10 +65,26 @@ struct sql_bind;
 int
 sql_unprepare(uint32_t stmt_id);
 
+/**
+ * Execute a prepared statement by its id.
+ * @param query_id ID of the prepared statement.
+ * @param bind Array of parameters.
+ * @param bind_count Length of @a bind.
+ * @param metadata_version Version of the result set metadata
+ *        the client has cached for this statement, or NULL if
+ *        the client does not cache metadata. When it matches
+ *        the current one, the full metadata is omitted from
+ *        the response and only the version tag is sent.
+ * @param[out] port Port to store SQL response.
+ * @param region Runtime allocator for temporary objects.
+ *
+ * @retval  0 Success.
+ * @retval -1 Client or memory error.
+ */
 int
 sql_execute_prepared(uint32_t query_id, const struct sql_bind *bind,
-		     uint32_t bind_count, struct port *port,
-		     struct region *region);
+		     uint32_t bind_count, const uint64_t *metadata_version,
+		     struct port *port, struct region *region);
 
 /**
  * Prepare and execute an SQL statement.
@@ -114,6 +130,19 @@ struct port_sql {
 	 * statement remains in cache and will be deleted later.
 	 */
 	bool do_finalize;
+	/**
+	 * True if the response should carry the metadata version
+	 * of the statement: the client announced its own cached
+	 * version in the request. Makes sense only for
+	 * DQL_EXECUTE.
+	 */
+	bool announce_metadata_version;
+	/**
+	 * True if the client's cached metadata version is up to
+	 * date and the full metadata can be omitted from the
+	 * response.
+	 */
+	bool skip_metadata;
 };
 
 extern const struct port_vtab port_sql_vtab;
@@ -149,6 +178,16 @@ sql_stmt_busy(const struct sql_stmt *stmt);
 int
 sql_prepare(const char *sql, int len, struct port *port);
 
+/**
+ * Re-prepare the statements listed in the warmup dump at @a path
+ * (written by sql_stmt_cache_save() on shutdown), populating the
+ * prepared statement cache before clients start sending requests.
+ * A missing dump is not an error; statements that no longer
+ * compile are skipped.
+ */
+int
+sql_warmup(const char *path);
+
 #if defined(__cplusplus)
 } /* extern "C" { */
 #endif
@@ -29,16 +29,36 @@
  * SUCH DAMAGE.
  */
 #include "diag.h"
+#include "error.h"
 #include "field_map.h"
 #include "small/region.h"
 
+/**
+ * Check that a compact field map under construction still fits
+ * into the 16-bit slot addressing. Must be called whenever the
+ * extents area grows.
+ */
+static int
+field_map_builder_check_compact(struct field_map_builder *builder)
+{
+	assert(builder->compact);
+	uint32_t size = field_map_build_size(builder);
+	if (size > INT16_MAX) {
+		diag_set(ClientError, ER_TUPLE_FIELD_MAP_OVERFLOW, size);
+		return -1;
+	}
+	return 0;
+}
+
 int
 field_map_builder_create(struct field_map_builder *builder,
-			 uint32_t minimal_field_map_size,
+			 uint32_t minimal_field_map_size, bool compact,
 			 struct region *region)
 {
 	builder->extents_size = 0;
-	builder->slot_count = minimal_field_map_size / sizeof(uint32_t);
+	builder->compact = compact;
+	builder->slot_count = minimal_field_map_size /
+		(compact ? sizeof(int16_t) : sizeof(uint32_t));
 	if (minimal_field_map_size == 0) {
 		builder->slots = NULL;
 		return 0;
@@ -73,12 +93,69 @@ field_map_builder_slot_extent_new(struct field_map_builder *builder,
 	builder->slots[offset_slot].extent = extent;
 	builder->slots[offset_slot].has_extent = true;
 	builder->extents_size += sz;
+	if (builder->compact && field_map_builder_check_compact(builder) != 0)
+		return NULL;
 	return extent;
 }
 
+int
+field_map_builder_slot_make_wide(struct field_map_builder *builder,
+				 int32_t offset_slot)
+{
+	assert(builder->compact);
+	assert(!builder->slots[offset_slot].has_extent);
+	if (builder->slots[offset_slot].has_wide_offset)
+		return 0;
+	builder->slots[offset_slot].has_wide_offset = true;
+	builder->extents_size += sizeof(uint32_t);
+	return field_map_builder_check_compact(builder);
+}
+
+/**
+ * Write a compact field map with 16-bit offset slots. The memory
+ * layout is the same as in field_map_build(), only the slot width
+ * differs and a wide plain offset is dumped as a single-cell
+ * extent.
+ */
+static void
+field_map_build_compact(struct field_map_builder *builder, char *buffer)
+{
+	int16_t *field_map =
+		(int16_t *)(buffer + field_map_build_size(builder));
+	char *extent_wptr = buffer;
+	for (int32_t i = -1; i >= -(int32_t)builder->slot_count; i--) {
+		struct field_map_builder_slot *slot = &builder->slots[i];
+		if (!slot->has_extent && !slot->has_wide_offset) {
+			assert(slot->offset <= INT16_MAX);
+			field_map[i] = slot->offset;
+			continue;
+		}
+		ptrdiff_t extent_offset = extent_wptr - (char *)field_map;
+		assert(extent_offset >= INT16_MIN && extent_offset < 0);
+		field_map[i] = extent_offset;
+		if (slot->has_wide_offset) {
+			assert(slot->offset > INT16_MAX);
+			*(uint32_t *)extent_wptr = slot->offset;
+			extent_wptr += sizeof(uint32_t);
+			continue;
+		}
+		struct field_map_builder_slot_extent *extent = slot->extent;
+		*(uint32_t *)extent_wptr = extent->size;
+		uint32_t extent_offset_sz = extent->size * sizeof(uint32_t);
+		memcpy(&((uint32_t *)extent_wptr)[1], extent->offset,
+		       extent_offset_sz);
+		extent_wptr += sizeof(uint32_t) + extent_offset_sz;
+	}
+	assert(extent_wptr == buffer + builder->extents_size);
+}
+
 void
 field_map_build(struct field_map_builder *builder, char *buffer)
 {
+	if (builder->compact) {
+		field_map_build_compact(builder, buffer);
+		return;
+	}
 	/*
 	 * To initialize the field map and its extents, prepare
 	 * the following memory layout with pointers:
@@ -78,6 +78,16 @@ enum { MULTIKEY_NONE = -1 };
  * represents int32_t negative value - the offset relative to
  * the field_map pointer. The i-th extent's slot contains the
  * positive offset of the i-th key field of the multikey index.
+ *
+ * A format with many offset slots may use the compact field map
+ * layout instead (see tuple_format::is_compact_field_map). It is
+ * identical to the plain one except that the slots are 16-bit:
+ * a non-negative slot is the field offset itself while a negative
+ * slot is the offset of an extent relative to the field_map
+ * pointer. Extent cells stay 32-bit. A plain field offset that
+ * does not fit into 16 bits is stored in a single-cell extent.
+ * The layout is chosen per tuple_format, so a tuple is always
+ * read with the same layout it was built with.
  */
 struct field_map_builder {
 	/**
@@ -96,6 +106,11 @@ struct field_map_builder {
 	 * extents.
 	 */
 	uint32_t extents_size;
+	/**
+	 * True when the compact field map layout with 16-bit
+	 * offset slots is being built.
+	 */
+	bool compact;
 };
 
 /**
@@ -133,6 +148,12 @@ struct field_map_builder_slot {
 	 * extent pointer.
 	 */
 	bool has_extent;
+	/**
+	 * True when the map is compact and this slot stores a
+	 * plain offset that does not fit into 16 bits, so it
+	 * must be dumped as a single-cell extent.
+	 */
+	bool has_wide_offset;
 	union {
 		/** Data offset in tuple. */
 		uint32_t offset;
@@ -149,9 +170,23 @@ struct field_map_builder_slot {
  */
 static inline uint32_t
 field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
-		     int multikey_idx)
+		     int multikey_idx, bool compact)
 {
 	uint32_t offset;
+	if (compact) {
+		int16_t slot = ((const int16_t *)field_map)[offset_slot];
+		if (slot >= 0)
+			return slot;
+		const uint32_t *extent =
+			(const uint32_t *)((const char *)field_map + slot);
+		if (multikey_idx == MULTIKEY_NONE) {
+			/* A plain offset wider than 16 bits. */
+			return extent[0];
+		}
+		if ((uint32_t)multikey_idx >= extent[0])
+			return 0;
+		return extent[multikey_idx + 1];
+	}
 	if (multikey_idx != MULTIKEY_NONE &&
 	    (int32_t) field_map[offset_slot] < 0) {
 		/**
@@ -173,7 +208,9 @@ field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
  * Initialize field_map_builder.
  *
  * The field_map_size argument is a size of the minimal field_map
- * allocation where each indexed field has own offset slot.
+ * allocation where each indexed field has own offset slot. The
+ * compact argument chooses between the plain 32-bit and the
+ * compact 16-bit slot layout and must match the size.
  *
  * Routine uses region to perform memory allocation for internal
  * structures.
@@ -183,7 +220,7 @@ field_map_get_offset(const uint32_t *field_map, int32_t offset_slot,
  */
 int
 field_map_builder_create(struct field_map_builder *builder,
-			 uint32_t minimal_field_map_size,
+			 uint32_t minimal_field_map_size, bool compact,
 			 struct region *region);
 
 /**
@@ -195,6 +232,14 @@ field_map_builder_slot_extent_new(struct field_map_builder *builder,
 				  int32_t offset_slot, uint32_t multikey_count,
 				  struct region *region);
 
+/**
+ * Internal function to account an extent cell for a plain offset
+ * that does not fit into a 16-bit slot of a compact field map.
+ */
+int
+field_map_builder_slot_make_wide(struct field_map_builder *builder,
+				 int32_t offset_slot);
+
 /**
  * Set data offset for a field identified by unique offset_slot.
  *
@@ -217,6 +262,10 @@ field_map_builder_set_slot(struct field_map_builder *builder,
 	assert(offset > 0);
 	if (multikey_idx == MULTIKEY_NONE) {
 		builder->slots[offset_slot].offset = offset;
+		if (builder->compact && offset > INT16_MAX &&
+		    field_map_builder_slot_make_wide(builder,
+						    offset_slot) != 0)
+			return -1;
 	} else {
 		assert(multikey_idx >= 0);
 		assert(multikey_idx < (int32_t)multikey_count);
@@ -242,8 +291,9 @@ field_map_builder_set_slot(struct field_map_builder *builder,
 static inline uint32_t
 field_map_build_size(struct field_map_builder *builder)
 {
-	return builder->slot_count * sizeof(uint32_t) +
-	       builder->extents_size;
+	uint32_t slot_size = builder->compact ? sizeof(int16_t) :
+					        sizeof(uint32_t);
+	return builder->slot_count * slot_size + builder->extents_size;
 }
 
 /**
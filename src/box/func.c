@@ -65,6 +65,11 @@ struct func_c {
 	 * For C functions, the body of the function.
 	 */
 	box_function_f func;
+	/**
+	 * v2 ABI entry point, if the module exports one.
+	 * Preferred over func when set.
+	 */
+	box_function_v2_f func_v2;
 	/**
 	 * Each stored function keeps a handle to the
 	 * dynamic library for the C callback.
@@ -327,6 +332,24 @@ module_sym(struct module *module, const char *name)
 	return f;
 }
 
+/**
+ * Resolve the entry points of a function in @a module. The v2
+ * ABI symbol "<sym>__v2" is looked up first; when it is absent
+ * the legacy "<sym>" symbol is required, see box_function_v2_f.
+ */
+static int
+func_c_resolve(struct func_c *func, struct module *module, const char *sym)
+{
+	func->func_v2 = (box_function_v2_f)
+		dlsym(module->handle, tt_sprintf("%s__v2", sym));
+	func->func = (box_function_f)dlsym(module->handle, sym);
+	if (func->func == NULL && func->func_v2 == NULL) {
+		diag_set(ClientError, ER_LOAD_FUNCTION, sym, dlerror());
+		return -1;
+	}
+	return 0;
+}
+
 int
 module_reload(const char *package, const char *package_end, struct module **module)
 {
@@ -345,8 +368,7 @@ module_reload(const char *package, const char *package_end, struct module **modu
 	rlist_foreach_entry_safe(func, &old_module->funcs, item, tmp_func) {
 		struct func_name name;
 		func_split_name(func->base.def->name, &name);
-		func->func = module_sym(new_module, name.sym);
-		if (func->func == NULL)
+		if (func_c_resolve(func, new_module, name.sym) != 0)
 			goto restore;
 		func->module = new_module;
 		rlist_move(&new_module->funcs, &func->item);
@@ -365,8 +387,7 @@ restore:
 	do {
 		struct func_name name;
 		func_split_name(func->base.def->name, &name);
-		func->func = module_sym(old_module, name.sym);
-		if (func->func == NULL) {
+		if (func_c_resolve(func, old_module, name.sym) != 0) {
 			/*
 			 * Something strange was happen, an early loaden
 			 * function was not found in an old dso.
@@ -441,6 +462,7 @@ func_c_new(MAYBE_UNUSED struct func_def *def)
 	}
 	func->base.vtab = &func_c_vtab;
 	func->func = NULL;
+	func->func_v2 = NULL;
 	func->module = NULL;
 	return &func->base;
 }
@@ -459,6 +481,7 @@ func_c_unload(struct func_c *func)
 	}
 	func->module = NULL;
 	func->func = NULL;
+	func->func_v2 = NULL;
 }
 
 static void
@@ -479,7 +502,7 @@ func_c_destroy(struct func *base)
 static int
 func_c_load(struct func_c *func)
 {
-	assert(func->func == NULL);
+	assert(func->module == NULL);
 
 	struct func_name name;
 	func_split_name(func->base.def->name, &name);
@@ -497,8 +520,7 @@ func_c_load(struct func_c *func)
 		}
 	}
 
-	func->func = module_sym(module, name.sym);
-	if (func->func == NULL)
+	if (func_c_resolve(func, module, name.sym) != 0)
 		return -1;
 	func->module = module;
 	rlist_add(&module->funcs, &func->item);
@@ -511,7 +533,7 @@ func_c_call(struct func *base, struct port *args, struct port *ret)
 	assert(base->vtab == &func_c_vtab);
 	assert(base != NULL && base->def->language == FUNC_LANGUAGE_C);
 	struct func_c *func = (struct func_c *) base;
-	if (func->func == NULL) {
+	if (func->module == NULL) {
 		if (func_c_load(func) != 0)
 			return -1;
 	}
@@ -530,7 +552,18 @@ func_c_call(struct func *base, struct port *args, struct port *ret)
 	struct module *module = func->module;
 	assert(module != NULL);
 	++module->calls;
-	int rc = func->func(&ctx, data, data + data_sz);
+	int rc;
+	if (func->func_v2 != NULL) {
+		/*
+		 * The v2 ABI takes a batch of invocations. There
+		 * is a single one here, but the contract allows
+		 * the dispatcher to coalesce calls in the future.
+		 */
+		struct box_function_call call = { data, data + data_sz };
+		rc = func->func_v2(&ctx, &call, 1);
+	} else {
+		rc = func->func(&ctx, data, data + data_sz);
+	}
 	--module->calls;
 	module_gc(module);
 	region_truncate(region, region_svp);
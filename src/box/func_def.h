@@ -182,6 +182,35 @@ typedef struct box_function_ctx box_function_ctx_t;
 typedef int (*box_function_f)(box_function_ctx_t *ctx,
 	     const char *args, const char *args_end);
 
+/**
+ * A single invocation in a batch passed to a v2 stored C
+ * procedure, see box_function_v2_f.
+ */
+struct box_function_call {
+	/** MessagePack encoded argument array. */
+	const char *args;
+	/** End of @a args. */
+	const char *args_end;
+};
+
+/**
+ * v2 ABI of a stored C procedure. A module opts in by exporting
+ * a "<function>__v2" symbol next to (or instead of) the legacy
+ * "<function>" one: when both are present, the v2 entry point is
+ * preferred.
+ *
+ * Unlike box_function_f, the v2 entry point receives a batch of
+ * @a count invocations to amortize the call boundary cost. The
+ * dispatcher passes batches of one today, but a procedure must
+ * handle any count. Arguments are read-only views into the
+ * request buffer valid only for the duration of the call.
+ * Results are returned through @a ctx with box_return_tuple()
+ * or box_return_mp(); on error, set a diag and return non-zero,
+ * results accumulated so far are discarded.
+ */
+typedef int (*box_function_v2_f)(box_function_ctx_t *ctx,
+	     const struct box_function_call *calls, uint32_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -107,6 +107,7 @@ gc_init(void)
 {
 	/* Don't delete any files until recovery is complete. */
 	gc.min_checkpoint_count = INT_MAX;
+	gc.wal_consumer_timeout = 0;
 
 	vclock_create(&gc.vclock);
 	rlist_create(&gc.checkpoints);
@@ -158,6 +159,39 @@ gc_free(void)
  * from old checkpoints. The number of checkpoints saved by
  * this function is specified by box.cfg.checkpoint_count.
  */
+/**
+ * Deactivate consumers that hold WALs back past the oldest
+ * preserved checkpoint and have not advanced for longer than
+ * box.cfg.wal_consumer_timeout. Keeping terabytes of WAL for a
+ * replica that went silent is worse than making it rejoin from
+ * a checkpoint, which is exactly what deactivation leads to.
+ */
+static void
+gc_demote_stale_consumers(const struct gc_checkpoint *checkpoint)
+{
+	if (gc.wal_consumer_timeout <= 0)
+		return;
+	double now = ev_monotonic_now(loop());
+	struct gc_consumer *consumer = gc_tree_first(&gc.consumers);
+	while (consumer != NULL &&
+	       vclock_sum(&consumer->vclock) <
+	       vclock_sum(&checkpoint->vclock)) {
+		struct gc_consumer *next = gc_tree_next(&gc.consumers,
+							consumer);
+		double idle = now - consumer->last_advance;
+		if (idle > gc.wal_consumer_timeout) {
+			assert(!consumer->is_inactive);
+			consumer->is_inactive = true;
+			gc_tree_remove(&gc.consumers, consumer);
+			say_crit("deactivated WAL consumer %s at %s: "
+				 "no progress for %.0f seconds, the replica "
+				 "will have to rejoin", consumer->name,
+				 vclock_to_string(&consumer->vclock), idle);
+		}
+		consumer = next;
+	}
+}
+
 static void
 gc_run_cleanup(void)
 {
@@ -187,6 +221,8 @@ gc_run_cleanup(void)
 	/* At least one checkpoint must always be available. */
 	assert(checkpoint != NULL);
 
+	gc_demote_stale_consumers(checkpoint);
+
 	/*
 	 * Find the vclock of the oldest WAL row to keep.
 	 * Note, we must keep all WALs created after the
@@ -308,6 +344,13 @@ gc_set_min_checkpoint_count(int min_checkpoint_count)
 	gc.min_checkpoint_count = min_checkpoint_count;
 }
 
+void
+gc_set_wal_consumer_timeout(double timeout)
+{
+	gc.wal_consumer_timeout = timeout;
+	gc_schedule_cleanup();
+}
+
 void
 gc_set_checkpoint_interval(double interval)
 {
@@ -530,6 +573,7 @@ gc_consumer_register(const struct vclock *vclock, const char *format, ...)
 	va_end(ap);
 
 	vclock_copy(&consumer->vclock, vclock);
+	consumer->last_advance = ev_monotonic_now(loop());
 	gc_tree_insert(&gc.consumers, consumer);
 	return consumer;
 }
@@ -557,6 +601,14 @@ gc_consumer_advance(struct gc_consumer *consumer, const struct vclock *vclock)
 	if (signature == prev_signature)
 		return; /* nothing to do */
 
+	/*
+	 * Only real progress counts against the consumer
+	 * timeout: a replica that stays connected but never
+	 * advances is no cheaper to hold WALs for than a dead
+	 * one.
+	 */
+	consumer->last_advance = ev_monotonic_now(loop());
+
 	/*
 	 * Do not update the tree unless the tree invariant
 	 * is violated.
@@ -94,9 +94,17 @@ struct gc_consumer {
 	struct vclock vclock;
 	/**
 	 * This flag is set if a WAL needed by this consumer was
-	 * deleted by the WAL thread on ENOSPC.
+	 * deleted by the WAL thread on ENOSPC or the consumer
+	 * was demoted for exceeding the retention budget.
 	 */
 	bool is_inactive;
+	/**
+	 * Time of the last advance, in terms of the monotonic
+	 * clock. A consumer that holds WALs back and has not
+	 * advanced for longer than gc_state::wal_consumer_timeout
+	 * is demoted: its replica has to rejoin from a checkpoint.
+	 */
+	double last_advance;
 };
 
 typedef rb_tree(struct gc_consumer) gc_tree_t;
@@ -123,6 +131,13 @@ struct gc_state {
 	struct rlist checkpoints;
 	/** Registered consumers, linked by gc_consumer::node. */
 	gc_tree_t consumers;
+	/**
+	 * How long a consumer that holds WALs back may go without
+	 * advancing before it is deactivated, in seconds.
+	 * Configured by box.cfg.wal_consumer_timeout, 0 means
+	 * consumers are never deactivated on timeout.
+	 */
+	double wal_consumer_timeout;
 	/** Fiber responsible for periodic checkpointing. */
 	struct fiber *checkpoint_fiber;
 	/** Schedule of periodic checkpoints. */
@@ -224,6 +239,14 @@ gc_advance(const struct vclock *vclock);
 void
 gc_set_min_checkpoint_count(int min_checkpoint_count);
 
+/**
+ * Update the WAL consumer timeout and reschedule garbage
+ * collection so that a lowered timeout takes effect right away.
+ * Called when box.cfg.wal_consumer_timeout is updated.
+ */
+void
+gc_set_wal_consumer_timeout(double timeout);
+
 /**
  * Set the time interval between checkpoints, in seconds.
  * Setting the interval to 0 disables periodic checkpointing.
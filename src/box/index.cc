@@ -29,15 +29,20 @@
  * SUCH DAMAGE.
  */
 #include "index.h"
+#include "ck_constraint.h"
 #include "tuple.h"
+#include "tuple_hash.h"
+#include "salad/hll.h"
 #include "say.h"
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
 #include "iproto_constants.h"
 #include "txn.h"
+#include "memtx_tx.h"
 #include "rmean.h"
 #include "info/info.h"
+#include "coio_task.h"
 
 /* {{{ Utilities. **********************************************/
 
@@ -112,22 +117,36 @@ key_validate(const struct index_def *index_def, enum iterator_type type,
 			}
 		}
 	} else {
-		if (part_count > index_def->key_def->part_count) {
+		struct key_def *key_def = index_def->key_def;
+		/*
+		 * A TREE index accepts keys extended past the
+		 * declared parts into the implicit primary key
+		 * tail (cmp_def). Since cmp_def is unique and is
+		 * what the tree compares with, such a key pins an
+		 * exact position in the index: pagination resumes
+		 * with an ITER_GT/ITER_LT iterator over the
+		 * position of the last seen tuple, see
+		 * index:tuple_pos().
+		 */
+		if (index_def->type == TREE &&
+		    part_count > key_def->part_count)
+			key_def = index_def->cmp_def;
+		if (part_count > key_def->part_count) {
 			diag_set(ClientError, ER_KEY_PART_COUNT,
-				 index_def->key_def->part_count, part_count);
+				 key_def->part_count, part_count);
 			return -1;
 		}
 
 		/* Partial keys are allowed only for TREE index type. */
-		if (index_def->type != TREE && part_count < index_def->key_def->part_count) {
+		if (index_def->type != TREE && part_count < key_def->part_count) {
 			diag_set(ClientError, ER_PARTIAL_KEY,
 				 index_type_strs[index_def->type],
-				 index_def->key_def->part_count,
+				 key_def->part_count,
 				 part_count);
 			return -1;
 		}
 		const char *key_end;
-		if (key_validate_parts(index_def->key_def, key,
+		if (key_validate_parts(key_def, key,
 				       part_count, true, &key_end) != 0)
 			return -1;
 	}
@@ -241,7 +260,8 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
 		return -1;
-	if (index_get(index, key, part_count, result) != 0) {
+	if (index_get(index, key, part_count, result) != 0 ||
+	    memtx_tx_track_read(txn, space, *result) != 0) {
 		txn_rollback_stmt(txn);
 		return -1;
 	}
@@ -253,6 +273,73 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	return 0;
 }
 
+int
+box_index_get_multi(uint32_t space_id, uint32_t index_id, const char *keys,
+		    const char *keys_end, uint32_t key_count,
+		    box_tuple_t **results)
+{
+	assert(keys != NULL && keys_end != NULL && results != NULL);
+	mp_tuple_assert(keys, keys_end);
+	struct space *space;
+	struct index *index;
+	if (check_index(space_id, index_id, &space, &index) != 0)
+		return -1;
+	if (!index->def->opts.is_unique) {
+		diag_set(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		return -1;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	const char **key_array = (const char **)
+		region_alloc(region, key_count * sizeof(*key_array));
+	uint32_t *part_counts = (uint32_t *)
+		region_alloc(region, key_count * sizeof(*part_counts));
+	if (key_array == NULL || part_counts == NULL) {
+		diag_set(OutOfMemory, key_count * sizeof(*key_array),
+			 "region", "get_multi keys");
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	const char *key = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		uint32_t part_count = mp_decode_array(&key);
+		if (exact_key_validate(index->def->key_def, key,
+				       part_count) != 0) {
+			region_truncate(region, region_svp);
+			return -1;
+		}
+		key_array[i] = key;
+		part_counts[i] = part_count;
+		for (uint32_t p = 0; p < part_count; p++)
+			mp_next(&key);
+	}
+	assert(key == keys_end);
+	/* Start transaction in the engine. */
+	struct txn *txn;
+	if (txn_begin_ro_stmt(space, &txn) != 0) {
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	int rc = index_get_multi(index, key_array, part_counts, key_count,
+				 results);
+	for (uint32_t i = 0; rc == 0 && i < key_count; i++)
+		rc = memtx_tx_track_read(txn, space, results[i]);
+	if (rc != 0) {
+		txn_rollback_stmt(txn);
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	txn_commit_ro_stmt(txn);
+	/* Count statistics. */
+	rmean_collect(rmean_box, IPROTO_SELECT, key_count);
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (results[i] != NULL)
+			tuple_bless(results[i]);
+	}
+	region_truncate(region, region_svp);
+	return 0;
+}
+
 int
 box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -275,7 +362,8 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
 		return -1;
-	if (index_min(index, key, part_count, result) != 0) {
+	if (index_min(index, key, part_count, result) != 0 ||
+	    memtx_tx_track_read(txn, space, *result) != 0) {
 		txn_rollback_stmt(txn);
 		return -1;
 	}
@@ -307,7 +395,8 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 	struct txn *txn;
 	if (txn_begin_ro_stmt(space, &txn) != 0)
 		return -1;
-	if (index_max(index, key, part_count, result) != 0) {
+	if (index_max(index, key, part_count, result) != 0 ||
+	    memtx_tx_track_read(txn, space, *result) != 0) {
 		txn_rollback_stmt(txn);
 		return -1;
 	}
@@ -393,8 +482,16 @@ box_iterator_next(box_iterator_t *itr, box_tuple_t **result)
 	assert(result != NULL);
 	if (iterator_next(itr, result) != 0)
 		return -1;
-	if (*result != NULL)
+	if (*result != NULL) {
+		struct txn *txn = in_txn();
+		if (txn != NULL) {
+			struct space *space = space_by_id(itr->space_id);
+			if (space != NULL &&
+			    memtx_tx_track_read(txn, space, *result) != 0)
+				return -1;
+		}
 		tuple_bless(*result);
+	}
 	return 0;
 }
 
@@ -406,6 +503,123 @@ box_iterator_free(box_iterator_t *it)
 
 /* }}} */
 
+/* {{{ Snapshot scans *******************************************/
+
+enum { SNAPSHOT_SCAN_BATCH_SIZE = 256 * 1024 };
+
+/**
+ * Make sure the batch buffer can accommodate @size bytes.
+ * Only grows the buffer, never shrinks it.
+ */
+static int
+snapshot_scan_reserve(struct snapshot_scan *scan, size_t size)
+{
+	if (size <= scan->buf_size)
+		return 0;
+	char *buf = (char *)realloc(scan->buf, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "realloc", "scan->buf");
+		return -1;
+	}
+	scan->buf = buf;
+	scan->buf_size = size;
+	return 0;
+}
+
+/** Batch fetch routine. Runs on the coio thread pool. */
+static ssize_t
+snapshot_scan_fetch_f(va_list ap)
+{
+	struct snapshot_scan *scan = va_arg(ap, struct snapshot_scan *);
+	struct snapshot_iterator *it = scan->iterator;
+	scan->data_size = 0;
+	if (scan->pending_data != NULL) {
+		if (snapshot_scan_reserve(scan, scan->pending_size) != 0)
+			return -1;
+		memcpy(scan->buf, scan->pending_data, scan->pending_size);
+		scan->data_size = scan->pending_size;
+		scan->pending_data = NULL;
+	}
+	while (!scan->eof) {
+		const char *data;
+		uint32_t size;
+		if (it->next(it, &data, &size) != 0)
+			return -1;
+		if (data == NULL) {
+			scan->eof = true;
+			break;
+		}
+		if (scan->data_size + size > scan->buf_size) {
+			if (scan->data_size > 0) {
+				/*
+				 * The read view keeps the tuple alive
+				 * so it is safe to copy it out on the
+				 * next fetch.
+				 */
+				scan->pending_data = data;
+				scan->pending_size = size;
+				break;
+			}
+			if (snapshot_scan_reserve(scan, size) != 0)
+				return -1;
+		}
+		memcpy(scan->buf + scan->data_size, data, size);
+		scan->data_size += size;
+	}
+	return scan->data_size;
+}
+
+struct snapshot_scan *
+snapshot_scan_new(uint32_t space_id, uint32_t index_id)
+{
+	struct space *space;
+	struct index *index;
+	if (check_index(space_id, index_id, &space, &index) != 0)
+		return NULL;
+	struct snapshot_scan *scan =
+		(struct snapshot_scan *)calloc(1, sizeof(*scan));
+	if (scan == NULL) {
+		diag_set(OutOfMemory, sizeof(*scan), "calloc", "scan");
+		return NULL;
+	}
+	scan->buf = (char *)malloc(SNAPSHOT_SCAN_BATCH_SIZE);
+	if (scan->buf == NULL) {
+		diag_set(OutOfMemory, SNAPSHOT_SCAN_BATCH_SIZE,
+			 "malloc", "scan->buf");
+		free(scan);
+		return NULL;
+	}
+	scan->buf_size = SNAPSHOT_SCAN_BATCH_SIZE;
+	scan->iterator = index_create_snapshot_iterator(index);
+	if (scan->iterator == NULL) {
+		free(scan->buf);
+		free(scan);
+		return NULL;
+	}
+	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+	return scan;
+}
+
+ssize_t
+snapshot_scan_fetch(struct snapshot_scan *scan)
+{
+	if (scan->eof && scan->pending_data == NULL) {
+		scan->data_size = 0;
+		return 0;
+	}
+	return coio_call(snapshot_scan_fetch_f, scan);
+}
+
+void
+snapshot_scan_delete(struct snapshot_scan *scan)
+{
+	scan->iterator->free(scan->iterator);
+	free(scan->buf);
+	free(scan);
+}
+
+/* }}} */
+
 /* {{{ Other index functions */
 
 int
@@ -431,6 +645,47 @@ box_index_compact(uint32_t space_id, uint32_t index_id)
 	return 0;
 }
 
+ssize_t
+box_index_split(uint32_t space_id, uint32_t index_id, uint32_t count,
+		const char **keys, const char **keys_end)
+{
+	struct space *space;
+	struct index *index;
+	if (check_index(space_id, index_id, &space, &index) != 0)
+		return -1;
+	if (count < 2)
+		return 0;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct tuple **tuples =
+		(struct tuple **)region_alloc(region,
+					      (count - 1) * sizeof(*tuples));
+	if (tuples == NULL) {
+		diag_set(OutOfMemory, (count - 1) * sizeof(*tuples),
+			 "region", "split tuples");
+		return -1;
+	}
+	/*
+	 * No tx management: split points are approximations used
+	 * to partition a scan, just like random() and count().
+	 */
+	ssize_t n = index_split(index, count, tuples);
+	if (n < 0)
+		return -1;
+	for (ssize_t i = 0; i < n; i++) {
+		uint32_t key_size;
+		char *key = tuple_extract_key(tuples[i], index->def->key_def,
+					      MULTIKEY_NONE, &key_size);
+		if (key == NULL) {
+			region_truncate(region, region_svp);
+			return -1;
+		}
+		keys[i] = key;
+		keys_end[i] = key + key_size;
+	}
+	return n;
+}
+
 /* }}} */
 
 /* {{{ Internal API */
@@ -439,11 +694,14 @@ void
 iterator_create(struct iterator *it, struct index *index)
 {
 	it->next = NULL;
+	it->prefetch = NULL;
 	it->free = NULL;
 	it->space_cache_version = space_cache_version;
 	it->space_id = index->def->space_id;
 	it->index_id = index->def->iid;
 	it->index = index;
+	it->nsteps = 0;
+	it->scan_estimate = 0;
 }
 
 int
@@ -463,13 +721,43 @@ iterator_next(struct iterator *it, struct tuple **ret)
 			goto invalidate;
 		it->space_cache_version = space_cache_version;
 	}
-	return it->next(it, ret);
+	if (it->next(it, ret) != 0)
+		return -1;
+	if (*ret != NULL) {
+		it->index->scan_stat.rows_scanned++;
+		if (unlikely(++it->nsteps == ITERATOR_SLOW_SCAN_MAX)) {
+			it->index->scan_stat.slow_scans++;
+			say_warn_ratelimited("slow scan: an iterator walked "
+					     "over %d tuples in space %u, "
+					     "index '%s'; a secondary index "
+					     "may be missing",
+					     ITERATOR_SLOW_SCAN_MAX,
+					     (unsigned) it->space_id,
+					     it->index->def->name);
+		}
+	}
+	return 0;
 
 invalidate:
 	*ret = NULL;
 	return 0;
 }
 
+void
+iterator_prefetch(struct iterator *it)
+{
+	if (it->prefetch == NULL)
+		return;
+	/*
+	 * Unlike iterator_next(), a stale schema does not need to
+	 * be resolved here - the hint is simply dropped.
+	 */
+	if (it->space_id != 0 &&
+	    unlikely(it->space_cache_version != space_cache_version))
+		return;
+	it->prefetch(it);
+}
+
 void
 iterator_delete(struct iterator *it)
 {
@@ -490,6 +778,9 @@ index_create(struct index *index, struct engine *engine,
 	index->def = def;
 	index->refs = 1;
 	index->space_cache_version = space_cache_version;
+	index->distinct_est = NULL;
+	memset(&index->scan_stat, 0, sizeof(index->scan_stat));
+	index->predicate = NULL;
 	return 0;
 }
 
@@ -497,6 +788,9 @@ void
 index_delete(struct index *index)
 {
 	assert(index->refs == 0);
+	free(index->distinct_est);
+	if (index->predicate != NULL)
+		ck_constraint_delete(index->predicate);
 	/*
 	 * Free index_def after destroying the index as
 	 * engine might still need it, e.g. to check if
@@ -507,6 +801,39 @@ index_delete(struct index *index)
 	index_def_delete(def);
 }
 
+void
+index_distinct_est_update(struct index *index, struct tuple *tuple)
+{
+	struct key_def *key_def = index->def->key_def;
+	/*
+	 * A multikey or functional key does not map one tuple to
+	 * one key, a single sequence of part hashes makes no
+	 * sense for it.
+	 */
+	if (key_def->is_multikey || key_def->for_func_index)
+		return;
+	uint32_t part_count = key_def->part_count;
+	if (index->distinct_est == NULL) {
+		index->distinct_est = (struct hll *)
+			calloc(part_count, sizeof(*index->distinct_est));
+		if (index->distinct_est == NULL)
+			return;
+	}
+	uint32_t hashes[BOX_INDEX_PART_MAX];
+	tuple_prefix_hashes(tuple, key_def, hashes);
+	for (uint32_t i = 0; i < part_count; i++)
+		hll_add(&index->distinct_est[i], hashes[i]);
+}
+
+ssize_t
+index_distinct_est(struct index *index, uint32_t prefix)
+{
+	assert(prefix >= 1 && prefix <= index->def->key_def->part_count);
+	if (index->distinct_est == NULL)
+		return -1;
+	return hll_estimate(&index->distinct_est[prefix - 1]);
+}
+
 int
 index_build(struct index *index, struct index *pk)
 {
@@ -537,6 +864,8 @@ index_build(struct index *index, struct index *pk)
 			break;
 		if (tuple == NULL)
 			break;
+		/* Load the next tuple while this one is indexed. */
+		iterator_prefetch(it);
 		rc = index_build_next(index, tuple);
 		if (rc != 0)
 			break;
@@ -545,8 +874,7 @@ index_build(struct index *index, struct index *pk)
 	if (rc != 0)
 		return -1;
 
-	index_end_build(index);
-	return 0;
+	return index_end_build(index);
 }
 
 /* }}} */
@@ -668,6 +996,19 @@ generic_index_get(struct index *index, const char *key,
 	return -1;
 }
 
+int
+generic_index_get_multi(struct index *index, const char **keys,
+			const uint32_t *part_counts, uint32_t key_count,
+			struct tuple **results)
+{
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (index_get(index, keys[i], part_counts[i],
+			      &results[i]) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 int
 generic_index_replace(struct index *index, struct tuple *old_tuple,
 		      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -698,11 +1039,32 @@ generic_index_create_snapshot_iterator(struct index *index)
 	return NULL;
 }
 
+ssize_t
+generic_index_split(struct index *index, uint32_t count,
+		    struct tuple **result)
+{
+	(void)index;
+	(void)count;
+	(void)result;
+	return 0;
+}
+
 void
 generic_index_stat(struct index *index, struct info_handler *handler)
 {
-	(void)index;
+	struct index_scan_stat *stat = &index->scan_stat;
 	info_begin(handler);
+	info_table_begin(handler, "iterator");
+	for (int i = 0; i < iterator_type_MAX; i++) {
+		if (stat->iterator_count[i] == 0)
+			continue;
+		info_append_int(handler, iterator_type_strs[i],
+				stat->iterator_count[i]);
+	}
+	info_table_end(handler);
+	info_append_int(handler, "rows_scanned", stat->rows_scanned);
+	info_append_int(handler, "rows_returned", stat->rows_returned);
+	info_append_int(handler, "slow_scans", stat->slow_scans);
 	info_end(handler);
 }
 
@@ -715,7 +1077,7 @@ generic_index_compact(struct index *index)
 void
 generic_index_reset_stat(struct index *index)
 {
-	(void)index;
+	memset(&index->scan_stat, 0, sizeof(index->scan_stat));
 }
 
 void
@@ -743,9 +1105,10 @@ generic_index_build_next(struct index *index, struct tuple *tuple)
 	return index_replace(index, NULL, tuple, DUP_INSERT, &unused);
 }
 
-void
+int
 generic_index_end_build(struct index *)
 {
+	return 0;
 }
 
 int
@@ -41,6 +41,8 @@ extern "C" {
 
 struct tuple;
 struct engine;
+struct hll;
+struct ck_constraint;
 struct index;
 struct index_def;
 struct key_def;
@@ -146,6 +148,31 @@ int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result);
 
+/**
+ * Get tuples from index by a batch of keys.
+ *
+ * Works as \a key_count calls of box_index_get(), but lets the
+ * engine resolve the lookups together: a memtx TREE index descends
+ * the tree for all keys in parallel, overlapping the memory
+ * stalls of the descents.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param keys \a key_count encoded keys in MsgPack Array format
+ *        ([part1, part2, ...]), laid out one after another
+ * \param keys_end the end of encoded \a keys
+ * \param key_count number of keys
+ * \param[out] results array of \a key_count tuples; results[i] is
+ *        NULL if there is no tuple with the i-th key
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \pre keys != NULL
+ */
+int
+box_index_get_multi(uint32_t space_id, uint32_t index_id, const char *keys,
+		    const char *keys_end, uint32_t key_count,
+		    box_tuple_t **results);
+
 /**
  * Return a first (minimal) tuple matched the provided key.
  *
@@ -235,6 +262,26 @@ box_index_stat(uint32_t space_id, uint32_t index_id,
 int
 box_index_compact(uint32_t space_id, uint32_t index_id);
 
+/**
+ * Estimate up to \a count - 1 keys splitting an index into
+ * chunks of roughly equal size (index:split()), e.g. to scan the
+ * chunks with parallel iterators. The keys are extracted from
+ * the split tuples with the index key definition and allocated
+ * on the fiber region.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param count the desired number of chunks
+ * \param keys output array of at least count - 1 key pointers
+ * \param keys_end output array of key end pointers
+ * \retval -1 on error (check box_error_last())
+ * \retval >=0 the number of split keys written. May be less than
+ *             count - 1, 0 when the engine can not estimate.
+ */
+ssize_t
+box_index_split(uint32_t space_id, uint32_t index_id, uint32_t count,
+		const char **keys, const char **keys_end);
+
 struct iterator {
 	/**
 	 * Iterate to the next tuple.
@@ -242,6 +289,16 @@ struct iterator {
 	 * Returns 0 on success, -1 on error.
 	 */
 	int (*next)(struct iterator *it, struct tuple **ret);
+	/**
+	 * Prefetch the element the following next() call will
+	 * return into the CPU cache. An optional hint: engines
+	 * that can peek at the next position cheaply set it,
+	 * others leave it NULL. Called via iterator_prefetch()
+	 * between receiving one tuple and requesting the next
+	 * so the tuple header load overlaps with the per-tuple
+	 * work of the caller.
+	 */
+	void (*prefetch)(struct iterator *it);
 	/** Destroy the iterator. */
 	void (*free)(struct iterator *);
 	/** Space cache version at the time of the last index lookup. */
@@ -256,6 +313,19 @@ struct iterator {
 	 * state has not changed since the last lookup.
 	 */
 	struct index *index;
+	/**
+	 * Number of tuples fetched through this iterator, for
+	 * slow-scan detection.
+	 */
+	uint64_t nsteps;
+	/**
+	 * Expected number of tuples the scan will visit, 0 when
+	 * unknown. A hint set by callers that know the scan shape
+	 * in advance, e.g. the SQL planner; engines may use it to
+	 * choose bulk paths instead of learning the access
+	 * pattern one tuple at a time.
+	 */
+	uint64_t scan_estimate;
 };
 
 /**
@@ -277,6 +347,14 @@ iterator_create(struct iterator *it, struct index *index);
 int
 iterator_next(struct iterator *it, struct tuple **ret);
 
+/**
+ * Hint the iterator to prefetch the next tuple into the CPU
+ * cache. A no-op when the engine does not support peeking or the
+ * schema has changed under the iterator. Never fails.
+ */
+void
+iterator_prefetch(struct iterator *it);
+
 /**
  * Destroy an iterator instance and free associated memory.
  */
@@ -301,6 +379,59 @@ struct snapshot_iterator {
 	void (*free)(struct snapshot_iterator *);
 };
 
+/**
+ * Consistent index scan served from a worker thread.
+ *
+ * A scan is backed by a snapshot iterator, i.e. it sees the
+ * index contents as of the moment it was opened, no matter how
+ * long it takes to drain. Snapshot iterators are safe to use
+ * from another thread so tuples are copied to the batch buffer
+ * by a coio task, leaving only tuple decoding to the tx thread.
+ */
+struct snapshot_scan {
+	/** Read view iterator the scan is backed by. */
+	struct snapshot_iterator *iterator;
+	/** Batch buffer filled by the worker thread. */
+	char *buf;
+	/** Capacity of the batch buffer. */
+	size_t buf_size;
+	/** Amount of data stored in the batch buffer. */
+	size_t data_size;
+	/** Read position in the batch buffer (tx thread only). */
+	size_t pos;
+	/**
+	 * Tuple fetched from the iterator but not fitting into
+	 * the last batch. The data stays valid until the iterator
+	 * is freed as the read view pins all tuples it covers.
+	 */
+	const char *pending_data;
+	/** Size of the pending tuple. */
+	uint32_t pending_size;
+	/** Set when the underlying iterator is exhausted. */
+	bool eof;
+};
+
+/**
+ * Open a consistent scan over the given index.
+ * Returns NULL and sets diag on error, in particular if the
+ * index engine does not support consistent read views.
+ */
+struct snapshot_scan *
+snapshot_scan_new(uint32_t space_id, uint32_t index_id);
+
+/**
+ * Fill the scan batch buffer with the next portion of tuples.
+ * Yields the caller while a worker thread walks the read view.
+ * Returns the number of bytes stored in the buffer, 0 on EOF,
+ * -1 on error.
+ */
+ssize_t
+snapshot_scan_fetch(struct snapshot_scan *scan);
+
+/** Close a scan and release the read view. */
+void
+snapshot_scan_delete(struct snapshot_scan *scan);
+
 /**
  * Check that the key has correct part count and correct part size
  * for use in an index iterator.
@@ -410,8 +541,26 @@ struct index_vtab {
 	int (*random)(struct index *index, uint32_t rnd, struct tuple **result);
 	ssize_t (*count)(struct index *index, enum iterator_type type,
 			 const char *key, uint32_t part_count);
+	/**
+	 * Fill @a result with up to @a count - 1 tuples splitting
+	 * the index into chunks of roughly equal size. An engine
+	 * which can not estimate split points returns 0.
+	 */
+	ssize_t (*split)(struct index *index, uint32_t count,
+			 struct tuple **result);
 	int (*get)(struct index *index, const char *key,
 		   uint32_t part_count, struct tuple **result);
+	/**
+	 * Look up a batch of full keys at once. An engine which
+	 * can overlap the lookups (e.g. memtx TREE descends the
+	 * tree for all keys in parallel, hiding cache misses of
+	 * one descent behind the work of the others) provides its
+	 * own implementation; the generic stub falls back to a
+	 * loop around get().
+	 */
+	int (*get_multi)(struct index *index, const char **keys,
+			 const uint32_t *part_counts, uint32_t key_count,
+			 struct tuple **results);
 	int (*replace)(struct index *index, struct tuple *old_tuple,
 		       struct tuple *new_tuple, enum dup_replace_mode mode,
 		       struct tuple **result);
@@ -445,7 +594,31 @@ struct index_vtab {
 	 */
 	int (*reserve)(struct index *index, uint32_t size_hint);
 	int (*build_next)(struct index *index, struct tuple *tuple);
-	void (*end_build)(struct index *index);
+	int (*end_build)(struct index *index);
+};
+
+enum {
+	/**
+	 * An iterator walking over this many tuples is reported
+	 * to the log as a likely missing-index scan.
+	 */
+	ITERATOR_SLOW_SCAN_MAX = 100000,
+};
+
+/**
+ * Incremental scan statistics of an index, reported by
+ * index:stat(). Maintained at the generic iterator layer, so
+ * every engine gets them for free.
+ */
+struct index_scan_stat {
+	/** Iterators created, by iterator type. */
+	uint64_t iterator_count[iterator_type_MAX];
+	/** Tuples fetched from the index by iterators. */
+	uint64_t rows_scanned;
+	/** Tuples actually returned to requests by box_select(). */
+	uint64_t rows_returned;
+	/** Iterators that walked over ITERATOR_SLOW_SCAN_MAX. */
+	uint64_t slow_scans;
 };
 
 struct index {
@@ -459,6 +632,25 @@ struct index {
 	int refs;
 	/* Space cache version at the time of construction. */
 	uint32_t space_cache_version;
+	/**
+	 * Incremental distinct-prefix estimators: the k-th
+	 * sketch accounts the distinct combinations of the
+	 * first k + 1 key parts ever inserted into the index.
+	 * The SQL planner consults them between ANALYZE runs,
+	 * see index_field_tuple_est(). Allocated on the first
+	 * insert; NULL until then and for index types the
+	 * estimator does not support.
+	 */
+	struct hll *distinct_est;
+	/** Scan statistics, see index:stat(). */
+	struct index_scan_stat scan_stat;
+	/**
+	 * Compiled partial index predicate, or NULL for a regular
+	 * index. The program is built from def->opts.predicate
+	 * against the owner space definition when the space is
+	 * created, see space_create().
+	 */
+	struct ck_constraint *predicate;
 };
 
 /**
@@ -505,6 +697,23 @@ index_create(struct index *index, struct engine *engine,
 void
 index_delete(struct index *index);
 
+/**
+ * Account an inserted tuple in the distinct-prefix estimators
+ * of the index. Cheap (one incremental key hash) and best
+ * effort: an allocation failure simply leaves the estimators
+ * empty.
+ */
+void
+index_distinct_est_update(struct index *index, struct tuple *tuple);
+
+/**
+ * Estimate the number of distinct combinations of the first
+ * @a prefix key parts ever inserted into the index.
+ * Returns -1 if no estimate is available.
+ */
+ssize_t
+index_distinct_est(struct index *index, uint32_t prefix);
+
 /**
  * Increment the reference counter of an index to prevent
  * it from being destroyed when the space it belongs to is
@@ -622,6 +831,15 @@ index_get(struct index *index, const char *key,
 	return index->vtab->get(index, key, part_count, result);
 }
 
+static inline int
+index_get_multi(struct index *index, const char **keys,
+		const uint32_t *part_counts, uint32_t key_count,
+		struct tuple **results)
+{
+	return index->vtab->get_multi(index, keys, part_counts, key_count,
+				      results);
+}
+
 static inline int
 index_replace(struct index *index, struct tuple *old_tuple,
 	      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -634,6 +852,7 @@ static inline struct iterator *
 index_create_iterator(struct index *index, enum iterator_type type,
 		      const char *key, uint32_t part_count)
 {
+	index->scan_stat.iterator_count[type]++;
 	return index->vtab->create_iterator(index, type, key, part_count);
 }
 
@@ -655,6 +874,12 @@ index_compact(struct index *index)
 	index->vtab->compact(index);
 }
 
+static inline ssize_t
+index_split(struct index *index, uint32_t count, struct tuple **result)
+{
+	return index->vtab->split(index, count, result);
+}
+
 static inline void
 index_reset_stat(struct index *index)
 {
@@ -679,10 +904,10 @@ index_build_next(struct index *index, struct tuple *tuple)
 	return index->vtab->build_next(index, tuple);
 }
 
-static inline void
+static inline int
 index_end_build(struct index *index)
 {
-	index->vtab->end_build(index);
+	return index->vtab->end_build(index);
 }
 
 /*
@@ -703,7 +928,10 @@ int generic_index_max(struct index *, const char *, uint32_t, struct tuple **);
 int generic_index_random(struct index *, uint32_t, struct tuple **);
 ssize_t generic_index_count(struct index *, enum iterator_type,
 			    const char *, uint32_t);
+ssize_t generic_index_split(struct index *, uint32_t, struct tuple **);
 int generic_index_get(struct index *, const char *, uint32_t, struct tuple **);
+int generic_index_get_multi(struct index *, const char **, const uint32_t *,
+			    uint32_t, struct tuple **);
 int generic_index_replace(struct index *, struct tuple *, struct tuple *,
 			  enum dup_replace_mode, struct tuple **);
 struct snapshot_iterator *generic_index_create_snapshot_iterator(struct index *);
@@ -716,7 +944,7 @@ struct iterator *
 generic_index_create_iterator(struct index *base, enum iterator_type type,
 			      const char *key, uint32_t part_count);
 int generic_index_build_next(struct index *, struct tuple *);
-void generic_index_end_build(struct index *);
+int generic_index_end_build(struct index *);
 int
 disabled_index_build_next(struct index *index, struct tuple *tuple);
 int
@@ -51,6 +51,7 @@ const struct index_opts index_opts_default = {
 	/* .lsn                 = */ 0,
 	/* .stat                = */ NULL,
 	/* .func                = */ 0,
+	/* .predicate           = */ NULL,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -65,6 +66,7 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("func", OPT_UINT32, struct index_opts, func_id),
+	OPT_DEF("predicate", OPT_STRPTR, struct index_opts, predicate),
 	OPT_DEF_LEGACY("sql"),
 	OPT_END,
 };
@@ -113,6 +115,17 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	def->space_id = space_id;
 	def->iid = iid;
 	def->opts = *opts;
+	if (opts->predicate != NULL) {
+		def->opts.predicate = strdup(opts->predicate);
+		if (def->opts.predicate == NULL) {
+			diag_set(OutOfMemory, strlen(opts->predicate) + 1,
+				 "strdup", "opts.predicate");
+			/* The string is still owned by the caller. */
+			def->opts = index_opts_default;
+			index_def_delete(def);
+			return NULL;
+		}
+	}
 	/* Statistics are initialized separately. */
 	assert(opts->stat == NULL);
 	return def;
@@ -143,6 +156,17 @@ index_def_dup(const struct index_def *def)
 	}
 	rlist_create(&dup->link);
 	dup->opts = def->opts;
+	if (def->opts.predicate != NULL) {
+		dup->opts.predicate = strdup(def->opts.predicate);
+		if (dup->opts.predicate == NULL) {
+			diag_set(OutOfMemory,
+				 strlen(def->opts.predicate) + 1, "strdup",
+				 "opts.predicate");
+			dup->opts.stat = NULL;
+			index_def_delete(dup);
+			return NULL;
+		}
+	}
 	if (def->opts.stat != NULL) {
 		dup->opts.stat = index_stat_dup(def->opts.stat);
 		if (dup->opts.stat == NULL) {
@@ -303,6 +327,11 @@ index_def_is_valid(struct index_def *index_def, const char *space_name)
 			space_name, "primary key can not use a function");
 		return false;
 	}
+	if (index_def->iid == 0 && index_def->opts.predicate != NULL) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name, "primary key can not be partial");
+		return false;
+	}
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
 		assert(index_def->key_def->parts[i].type < field_type_MAX);
 		if (index_def->key_def->parts[i].fieldno > BOX_INDEX_FIELD_MAX) {
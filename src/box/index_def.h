@@ -165,6 +165,13 @@ struct index_opts {
 	struct index_stat *stat;
 	/** Identifier of the functional index function. */
 	uint32_t func_id;
+	/**
+	 * Partial index predicate expression over the space
+	 * fields, e.g. "status = 'pending'". Only tuples the
+	 * expression is satisfied for are stored in the index.
+	 * NULL for a regular index.
+	 */
+	char *predicate;
 };
 
 extern const struct index_opts index_opts_default;
@@ -186,6 +193,7 @@ static inline void
 index_opts_destroy(struct index_opts *opts)
 {
 	free(opts->stat);
+	free(opts->predicate);
 	TRASH(opts);
 }
 
@@ -211,6 +219,10 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
 	if (o1->func_id != o2->func_id)
 		return o1->func_id - o2->func_id;
+	if ((o1->predicate == NULL) != (o2->predicate == NULL))
+		return o1->predicate == NULL ? -1 : 1;
+	if (o1->predicate != NULL && strcmp(o1->predicate, o2->predicate) != 0)
+		return strcmp(o1->predicate, o2->predicate);
 	return 0;
 }
 
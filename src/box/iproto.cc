@@ -32,6 +32,14 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netinet/tcp.h>
+#include "trivia/config.h"
+#ifdef HAVE_SENDFILE_LINUX
+#include <sys/sendfile.h>
+#endif
 
 #include <msgpuck.h>
 #include <small/ibuf.h>
@@ -40,9 +48,11 @@
 
 #include "version.h"
 #include "fiber.h"
+#include "fiber_cond.h"
 #include "cbus.h"
 #include "say.h"
 #include "sio.h"
+#include "fio.h"
 #include "evio.h"
 #include "coio.h"
 #include "scoped_guard.h"
@@ -53,20 +63,34 @@
 #include "port.h"
 #include "box.h"
 #include "call.h"
+#include "tuple.h"
 #include "tuple_convert.h"
 #include "session.h"
 #include "xrow.h"
 #include "schema.h" /* schema_version */
+#include "space.h"
+#include "index.h"
+#include "txn.h"
+#include "tuple_compare.h" /* HINT_NONE */
 #include "replication.h" /* instance_uuid */
 #include "iproto_constants.h"
 #include "rmean.h"
+#include "region_profile.h"
+#include "histogram.h"
+#include "latency.h"
 #include "execute.h"
 #include "errinj.h"
 #include "tt_static.h"
+#include "user.h"
+#include "scramble.h"
+
+#include <zstd.h>
 
 enum {
 	IPROTO_SALT_SIZE = 32,
 	IPROTO_PACKET_SIZE_MAX = 2UL * 1024 * 1024 * 1024,
+	/** Level of negotiated response compression. */
+	IPROTO_ZSTD_LEVEL = 3,
 };
 
 /**
@@ -173,6 +197,70 @@ iproto_reset_input(struct ibuf *ibuf)
 	}
 }
 
+/* {{{ iproto_zdata - zero-copy response payloads */
+
+enum {
+	/**
+	 * Tuples smaller than this are copied into the output
+	 * buffer as before: the saved memcpy() does not pay for
+	 * the extra iovec and the reference bookkeeping.
+	 */
+	IPROTO_ZCOPY_THRESHOLD = 1024,
+	/** Max zero-copy payloads spliced into one writev(). */
+	IPROTO_ZCOPY_IOV_MAX = 64,
+};
+
+/**
+ * A tuple payload which is sent to the socket directly from
+ * tuple memory instead of being copied into the connection
+ * output buffer. The tx thread references the tuple and records
+ * the position in the output buffer byte stream at which the
+ * payload belongs. The network thread splices the payload into
+ * writev() at that position and, once it is fully written, hands
+ * the entry back to tx for unreferencing: tuple reference
+ * counters may only be updated in tx. Entries travel between
+ * the threads inside iproto_msg, so the usual cbus
+ * happens-before rules make the fields safe to read without
+ * explicit synchronization.
+ */
+struct iproto_zdata {
+	/** Link in iproto_msg or iproto_connection queues. */
+	struct stailq_entry next;
+	/**
+	 * Offset in the output buffer byte stream after which
+	 * the payload is spliced in.
+	 */
+	size_t obuf_offset;
+	/** Payload, points into the referenced tuple. */
+	const char *data;
+	/** Payload size. */
+	uint32_t size;
+	/** Payload bytes already written to the socket. */
+	uint32_t written;
+	/** The referenced tuple. */
+	struct tuple *tuple;
+};
+
+/**
+ * Pool of iproto_zdata entries. The entries are allocated and
+ * freed in the tx thread only.
+ */
+static struct mempool iproto_zdata_pool;
+
+/** Unreference and free a list of zero-copy payloads. Tx only. */
+static void
+tx_release_zdata(struct stailq *zdata)
+{
+	struct iproto_zdata *zd, *tmp;
+	stailq_foreach_entry_safe(zd, tmp, zdata, next) {
+		tuple_unref(zd->tuple);
+		mempool_free(&iproto_zdata_pool, zd);
+	}
+	stailq_create(zdata);
+}
+
+/* }}} */
+
 /* {{{ iproto_msg - declaration */
 
 /**
@@ -195,6 +283,8 @@ struct iproto_msg
 		struct call_request call;
 		/** Authentication request. */
 		struct auth_request auth;
+		/** Watcher registration request. */
+		struct watch_request watch;
 		/* SQL request, if this is the EXECUTE/PREPARE request. */
 		struct sql_request sql;
 		/** In case of iproto parse error, saved diagnostics. */
@@ -212,6 +302,40 @@ struct iproto_msg
 	 * ibuf object.
 	 */
 	size_t len;
+	/**
+	 * Time when the request was decoded in the network
+	 * thread, used to account the end-to-end latency of
+	 * the request in iproto_thread->latency. Zero for
+	 * service messages which bypass the decoder.
+	 */
+	double start_time;
+	/**
+	 * Set by the tx thread when the request was delayed by
+	 * admission control, see tx_defer_low_priority_msg().
+	 * The network thread accounts such requests in the
+	 * DEFERRED counter of box.stat.net.
+	 */
+	bool deferred;
+	/**
+	 * Set by the tx thread when a COMPRESSION request has
+	 * been acknowledged, telling the network thread to start
+	 * compressing the output past the acknowledge reply.
+	 */
+	bool compression_accepted;
+	/**
+	 * Result of the scramble pre-check done by the network
+	 * thread against its authentication cache for an AUTH
+	 * request, AUTH_PRECHECK_NONE if the user was not cached.
+	 */
+	enum auth_precheck auth_precheck;
+	/**
+	 * Set by the tx thread after a successful authentication:
+	 * the network thread should cache auth_hash2 for the
+	 * authenticated user for later scramble pre-checks.
+	 */
+	bool auth_publish;
+	/** Password hash to cache, see user_def::hash2. */
+	char auth_hash2[SCRAMBLE_SIZE];
 	/**
 	 * Position in the connection output buffer. When sending a
 	 * message to the tx thread, iproto sets it to its current
@@ -221,6 +345,19 @@ struct iproto_msg
 	 * more output to flush.
 	 */
 	struct iproto_wpos wpos;
+	/**
+	 * Zero-copy payloads referenced by this response, in
+	 * splice order. Filled by tx, consumed by the network
+	 * thread, see struct iproto_zdata.
+	 */
+	struct stailq zdata;
+	/**
+	 * Fully written payloads returned to tx for
+	 * unreferencing. Filled by the network thread from
+	 * iproto_connection::zdata_spent when the message is
+	 * created, released in tx_accept_msg().
+	 */
+	struct stailq zdata_spent;
 	/**
 	 * Message sent by the tx thread to notify iproto that input has
 	 * been processed and can be discarded before request completion.
@@ -234,60 +371,121 @@ struct iproto_msg
 	bool close_connection;
 };
 
-static struct mempool iproto_msg_pool;
-
 static struct iproto_msg *
 iproto_msg_new(struct iproto_connection *con);
 
 /**
- * Resume stopped connections, if any.
+ * Resume stopped connections of a network thread, if any.
  */
 static void
-iproto_resume();
+iproto_resume(struct iproto_thread *iproto_thread);
 
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input);
 
+static void
+iproto_connection_resume_quota(struct iproto_connection *con);
+
 static inline void
-iproto_msg_delete(struct iproto_msg *msg)
-{
-	mempool_free(&iproto_msg_pool, msg);
-	iproto_resume();
-}
+iproto_msg_delete(struct iproto_thread *iproto_thread, struct iproto_msg *msg);
 
 /**
- * A single global queue for all requests in all connections. All
- * requests from all connections are processed concurrently.
- * Is also used as a queue for just established connections and to
- * execute disconnect triggers. A few notes about these triggers:
+ * Context of a single network thread. Each thread runs its own
+ * event loop, accepts a share of incoming connections and owns
+ * them until disconnect: reads and parses input, sends it for
+ * processing to the tx thread over a dedicated cbus pipe pair
+ * and flushes ready output back to the socket. The requests of
+ * each thread are queued into tx in FIFO order and processed
+ * concurrently with requests of other threads.
+ *
+ * The queue into tx is also used for just established connections
+ * and to execute disconnect triggers. A few notes about these
+ * triggers:
  * - they need to be run in a fiber
  * - unlike an ordinary request failure, on_connect trigger
  *   failure must lead to connection close.
  * - on_connect trigger must be processed before any other
  *   request on this connection.
  */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
+struct iproto_thread {
+	/** Network thread. */
+	struct cord net_cord;
+	/** Pipe from this network thread into tx. */
+	struct cpipe tx_pipe;
+	/** Pipe from tx into this network thread. */
+	struct cpipe net_pipe;
+	/** The thread's share of the binary listener. */
+	struct evio_service binary;
+	/** Requests in flight, allocated in the network thread. */
+	struct mempool iproto_msg_pool;
+	/** Connections served by this thread. */
+	struct mempool iproto_connection_pool;
+	/**
+	 * Connections which have stopped reading input because
+	 * the request limit is exhausted.
+	 */
+	struct rlist stopped_connections;
+	/** Network statistics of this thread. */
+	struct rmean *rmean;
+	/**
+	 * Read-only replicas of user authentication data used to
+	 * pre-check auth request scrambles without a trip to the
+	 * tx thread, see struct iproto_auth_entry.
+	 */
+	struct rlist auth_cache;
+	/** Number of entries in auth_cache. */
+	int auth_cache_size;
+	/**
+	 * Per request type latency histograms: time from the
+	 * moment a request is decoded in this thread to the
+	 * moment its reply is written to the output buffer.
+	 */
+	struct latency latency[IPROTO_TYPE_STAT_MAX];
+	/** Ordinal number of the thread, used in endpoint names. */
+	uint32_t id;
+	/*
+	 * Each message travels between this thread and tx over
+	 * the thread's own pipe pair, so the cbus routes can not
+	 * be shared between threads and are instantiated here.
+	 */
+	struct cmsg_hop destroy_route[2];
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop call_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop sql_route[2];
+	struct cmsg_hop join_route[2];
+	struct cmsg_hop subscribe_route[2];
+	struct cmsg_hop error_route[2];
+	struct cmsg_hop push_route[2];
+	struct cmsg_hop connect_route[2];
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+};
 
-/**
- * Network thread.
- */
-static struct cord net_cord;
+/** Network thread pool. */
+static struct iproto_thread *iproto_threads;
+/** Size of the network thread pool, set once at bootstrap. */
+int iproto_threads_count;
 
 /**
  * Slab cache used for allocating memory for output network buffers
- * in the tx thread.
+ * in the tx thread. The tx thread is the only user, so a single
+ * cache is shared by connections of all network threads.
  */
 static struct slab_cache net_slabc;
 
-struct rmean *rmean_net;
-
 enum rmean_net_name {
 	IPROTO_SENT,
 	IPROTO_RECEIVED,
 	IPROTO_CONNECTIONS,
 	IPROTO_REQUESTS,
+	IPROTO_READ_CALLS,
+	IPROTO_WRITE_CALLS,
+	IPROTO_DEFERRED,
+	IPROTO_SENT_SMALL,
+	IPROTO_SENT_LARGE,
 	IPROTO_LAST,
 };
 
@@ -296,6 +494,11 @@ const char *rmean_net_strings[IPROTO_LAST] = {
 	"RECEIVED",
 	"CONNECTIONS",
 	"REQUESTS",
+	"READ_CALLS",
+	"WRITE_CALLS",
+	"DEFERRED",
+	"SENT_SMALL",
+	"SENT_LARGE",
 };
 
 static void
@@ -304,11 +507,6 @@ tx_process_destroy(struct cmsg *m);
 static void
 net_finish_destroy(struct cmsg *m);
 
-static const struct cmsg_hop destroy_route[] = {
-	{ tx_process_destroy, &net_pipe },
-	{ net_finish_destroy, NULL },
-};
-
 /** Fire on_disconnect triggers in the tx thread. */
 static void
 tx_process_disconnect(struct cmsg *m);
@@ -317,11 +515,6 @@ tx_process_disconnect(struct cmsg *m);
 static void
 net_finish_disconnect(struct cmsg *m);
 
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL }
-};
-
 /**
  * Kharon is in the dead world (iproto). Schedule an event to
  * flush new obuf as reflected in the fresh wpos.
@@ -339,11 +532,19 @@ iproto_process_push(struct cmsg *m);
 static void
 tx_end_push(struct cmsg *m);
 
-static const struct cmsg_hop push_route[] = {
-	{ iproto_process_push, &tx_pipe },
-	{ tx_end_push, NULL }
-};
+/**
+ * Send Kharon to notify the iproto thread about new out-of-band
+ * data in the connection output buffer.
+ */
+static void
+tx_begin_push(struct iproto_connection *con);
 
+/**
+ * Unregister and free all watchers of a connection. Called in
+ * the tx thread when the connection is closed.
+ */
+static void
+tx_delete_watchers(struct iproto_connection *con);
 
 /* }}} */
 
@@ -441,6 +642,65 @@ struct iproto_connection
 	 * output is available (see iproto_msg::wpos).
 	 */
 	struct iproto_wpos wend;
+	/**
+	 * Zero-copy payloads awaiting output, one queue per
+	 * output buffer, ordered by obuf_offset. Owned by the
+	 * network thread; tx hands new entries over in
+	 * iproto_msg::zdata.
+	 */
+	struct stailq zdata[2];
+	/**
+	 * Payloads written in full, waiting to be carried back
+	 * to tx by the next message for unreferencing.
+	 */
+	struct stailq zdata_spent;
+	/**
+	 * Streaming compression context, created when the client
+	 * negotiates response compression with an
+	 * IPROTO_COMPRESSION request. NULL while the connection
+	 * output is plain. Owned by the network thread.
+	 */
+	ZSTD_CStream *zstream;
+	/**
+	 * Compressed bytes pending output. Filled from the output
+	 * buffer contents by iproto_flush_compressed(). Created
+	 * together with zstream.
+	 */
+	struct ibuf zbuf;
+	/**
+	 * Position in the output buffer right after the reply to
+	 * the COMPRESSION request. Everything before it is sent
+	 * plain, everything after it is compressed.
+	 */
+	struct iproto_wpos compress_activation;
+	/** Set once the plain prefix has been flushed out. */
+	bool compress_active;
+	/**
+	 * Spill file for over-threshold output: when the output
+	 * buffers grow past IPROTO_SPILL_THRESHOLD, e.g. on a huge
+	 * select, flushable bytes are written to this unlinked
+	 * temporary file instead of staying in memory, which lets
+	 * tx recycle the buffers, and are sent to the socket with
+	 * sendfile() ahead of any newer buffer bytes. -1 while
+	 * unused. Owned by the network thread.
+	 */
+	int spill_fd;
+	/** Send position in the spill file. */
+	off_t spill_rpos;
+	/** Write position in the spill file. */
+	off_t spill_wpos;
+	/** Set after a spill failure to stop retrying. */
+	bool spill_disabled;
+	/**
+	 * Set while the socket is corked for a large streaming
+	 * response, see iproto_set_cork().
+	 */
+	bool tcp_corked;
+	/**
+	 * Set after a TCP_CORK setsockopt() failure (e.g. on a
+	 * unix socket) to stop retrying.
+	 */
+	bool cork_disabled;
 	/*
 	 * Size of readahead which is not parsed yet, i.e. size of
 	 * a piece of request which is not fully read. Is always
@@ -485,6 +745,20 @@ struct iproto_connection
 	 */
 	enum iproto_connection_state state;
 	struct rlist in_stop_list;
+	/**
+	 * Number of messages of this connection currently in
+	 * flight: queued to tx or awaiting output. Limits the
+	 * share of the net_msg_max budget a single connection
+	 * may consume, see iproto_check_connection_quota().
+	 */
+	int n_inflight;
+	/**
+	 * Set when input was stopped because the connection had
+	 * used up its own share of the request budget. Such a
+	 * connection is resumed as soon as enough of its own
+	 * requests complete, not from the global stop list.
+	 */
+	bool input_blocked_by_quota;
 	/**
 	 * Kharon is used to implement box.session.push().
 	 * When a new push is ready, tx uses kharon to notify
@@ -516,6 +790,8 @@ struct iproto_connection
 	 *                          ...
 	 */
 	struct iproto_kharon kharon;
+	/** The network thread the connection is attached to. */
+	struct iproto_thread *iproto_thread;
 	/**
 	 * The following fields are used exclusively by the tx thread.
 	 * Align them to prevent false-sharing.
@@ -531,32 +807,286 @@ struct iproto_connection
 		 * return.
 		 */
 		bool is_push_pending;
+		/**
+		 * Set when the disconnect callback has run in
+		 * tx: the network end is dead and the output
+		 * will never drain, so push backpressure must
+		 * not wait for it.
+		 */
+		bool is_disconnected;
+		/**
+		 * Signalled whenever Kharon brings a fresh
+		 * flush position back to tx. Pushes exceeding
+		 * the output limit wait on it, see
+		 * iproto_session_push().
+		 */
+		struct fiber_cond push_cond;
+		/**
+		 * Watchers registered by this connection with
+		 * IPROTO_WATCH, see struct iproto_watcher.
+		 */
+		struct rlist watchers;
 	} tx;
 	/** Authentication salt. */
 	char salt[IPROTO_SALT_SIZE];
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
-
 /**
- * Return true if we have not enough spare messages
- * in the message pool.
+ * Return true if the thread has not enough spare messages
+ * in its message pool. The limit is per thread: each thread
+ * may queue up to iproto_msg_max requests into tx.
  */
 static inline bool
-iproto_check_msg_max()
+iproto_check_msg_max(struct iproto_thread *iproto_thread)
 {
-	size_t request_count = mempool_count(&iproto_msg_pool);
+	size_t request_count = mempool_count(&iproto_thread->iproto_msg_pool);
 	return request_count > (size_t) iproto_msg_max;
 }
 
+enum {
+	/**
+	 * A single connection may hold at most this fraction of
+	 * the net_msg_max budget, so that one pipelining client
+	 * can not consume the whole budget and starve the rest.
+	 */
+	IPROTO_CONNECTION_QUOTA_DIV = 4,
+	/** Lower bound of the per-connection quota. */
+	IPROTO_CONNECTION_QUOTA_MIN = 8,
+};
+
+/**
+ * Return true if the connection has used up its own share of
+ * the request budget. The share also acts as a scheduling
+ * quantum: a connection with more input than that is stopped
+ * and the event loop moves on to other connections, resuming
+ * it as its requests complete.
+ */
+static inline bool
+iproto_check_connection_quota(struct iproto_connection *con)
+{
+	int quota = iproto_msg_max / IPROTO_CONNECTION_QUOTA_DIV;
+	if (quota < IPROTO_CONNECTION_QUOTA_MIN)
+		quota = IPROTO_CONNECTION_QUOTA_MIN;
+	return con->n_inflight >= quota;
+}
+
+static inline void
+iproto_msg_delete(struct iproto_thread *iproto_thread, struct iproto_msg *msg)
+{
+	struct iproto_connection *con = msg->connection;
+	mempool_free(&iproto_thread->iproto_msg_pool, msg);
+	assert(con->n_inflight > 0);
+	con->n_inflight--;
+	if (con->input_blocked_by_quota &&
+	    !iproto_check_connection_quota(con) &&
+	    !iproto_check_msg_max(iproto_thread))
+		iproto_connection_resume_quota(con);
+	iproto_resume(iproto_thread);
+}
+
+/* {{{ iproto auth cache */
+
+enum {
+	/**
+	 * How many users a network thread may cache
+	 * authentication data for. Connection storms come from
+	 * a handful of distinct users, so the cache is small and
+	 * searched linearly.
+	 */
+	IPROTO_AUTH_CACHE_MAX = 32,
+};
+
+/**
+ * A read-only replica of a user's authentication data kept in a
+ * network thread, so that a reconnect storm can have its
+ * scrambles checked without contending with transactions in tx.
+ * An entry is added when tx successfully authenticates the user
+ * and the whole cache is dropped whenever the tx user cache
+ * changes (password change, user drop, privilege reload).
+ */
+struct iproto_auth_entry {
+	/** Link in iproto_thread::auth_cache. */
+	struct rlist in_cache;
+	/** Hash of the user password, see user_def::hash2. */
+	char hash2[SCRAMBLE_SIZE];
+	/** Length of the user name. */
+	uint32_t name_len;
+	/** User name. */
+	char name[0];
+};
+
+static struct iproto_auth_entry *
+iproto_auth_cache_find(struct iproto_thread *iproto_thread,
+		       const char *name, uint32_t name_len)
+{
+	struct iproto_auth_entry *entry;
+	rlist_foreach_entry(entry, &iproto_thread->auth_cache, in_cache) {
+		if (entry->name_len == name_len &&
+		    memcmp(entry->name, name, name_len) == 0) {
+			/* Keep the hot users in front. */
+			rlist_move(&iproto_thread->auth_cache,
+				   &entry->in_cache);
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void
+iproto_auth_cache_put(struct iproto_thread *iproto_thread, const char *name,
+		      uint32_t name_len, const char *hash2)
+{
+	struct iproto_auth_entry *entry =
+		iproto_auth_cache_find(iproto_thread, name, name_len);
+	if (entry != NULL) {
+		memcpy(entry->hash2, hash2, SCRAMBLE_SIZE);
+		return;
+	}
+	if (iproto_thread->auth_cache_size >= IPROTO_AUTH_CACHE_MAX) {
+		entry = rlist_last_entry(&iproto_thread->auth_cache,
+					 struct iproto_auth_entry, in_cache);
+		rlist_del(&entry->in_cache);
+		free(entry);
+		iproto_thread->auth_cache_size--;
+	}
+	entry = (struct iproto_auth_entry *)malloc(sizeof(*entry) + name_len);
+	if (entry == NULL) {
+		/* The cache is best-effort, tx remains correct. */
+		return;
+	}
+	entry->name_len = name_len;
+	memcpy(entry->name, name, name_len);
+	memcpy(entry->hash2, hash2, SCRAMBLE_SIZE);
+	rlist_add(&iproto_thread->auth_cache, &entry->in_cache);
+	iproto_thread->auth_cache_size++;
+}
+
+static void
+iproto_auth_cache_reset(struct iproto_thread *iproto_thread)
+{
+	struct iproto_auth_entry *entry, *next;
+	rlist_foreach_entry_safe(entry, &iproto_thread->auth_cache,
+				 in_cache, next)
+		free(entry);
+	rlist_create(&iproto_thread->auth_cache);
+	iproto_thread->auth_cache_size = 0;
+}
+
+/**
+ * Parse the scramble out of an authentication request body.
+ * Mirrors the body format handled by authenticate(). Returns -1
+ * on any deviation from it, leaving the error reporting to the
+ * tx slow path.
+ */
+static int
+iproto_auth_parse_scramble(const char *tuple, const char **scramble)
+{
+	if (mp_typeof(*tuple) != MP_ARRAY)
+		return -1;
+	uint32_t part_count = mp_decode_array(&tuple);
+	if (part_count < 2)
+		return -1;
+	/* Skip authentication mechanism. */
+	mp_next(&tuple);
+	uint32_t scramble_len;
+	if (mp_typeof(*tuple) == MP_STR) {
+		*scramble = mp_decode_str(&tuple, &scramble_len);
+	} else if (mp_typeof(*tuple) == MP_BIN) {
+		*scramble = mp_decode_bin(&tuple, &scramble_len);
+	} else {
+		return -1;
+	}
+	return scramble_len == SCRAMBLE_SIZE ? 0 : -1;
+}
+
+/**
+ * Pre-check an AUTH request against the thread's authentication
+ * cache. On a cache hit the scramble is verified right here, in
+ * the network thread, and tx only has to stamp the session
+ * credentials or report the mismatch.
+ */
+static void
+iproto_auth_precheck(struct iproto_msg *msg)
+{
+	struct iproto_thread *iproto_thread =
+		msg->connection->iproto_thread;
+	if (rlist_empty(&iproto_thread->auth_cache))
+		return;
+	const char *name = msg->auth.user_name;
+	uint32_t name_len = mp_decode_strl(&name);
+	struct iproto_auth_entry *entry =
+		iproto_auth_cache_find(iproto_thread, name, name_len);
+	if (entry == NULL)
+		return;
+	const char *scramble;
+	if (iproto_auth_parse_scramble(msg->auth.scramble, &scramble) != 0)
+		return;
+	msg->auth_precheck =
+		scramble_check(scramble, msg->connection->salt,
+			       entry->hash2) == 0 ?
+		AUTH_PRECHECK_OK : AUTH_PRECHECK_FAIL;
+}
+
+/** Carries a cache invalidation request to a network thread. */
+struct iproto_auth_invalidate_msg {
+	struct cmsg base;
+	/** The thread whose cache to drop. */
+	struct iproto_thread *iproto_thread;
+};
+
+static void
+net_auth_cache_invalidate(struct cmsg *m)
+{
+	struct iproto_auth_invalidate_msg *msg =
+		(struct iproto_auth_invalidate_msg *) m;
+	iproto_auth_cache_reset(msg->iproto_thread);
+	free(msg);
+}
+
+static const struct cmsg_hop auth_invalidate_route[] = {
+	{ net_auth_cache_invalidate, NULL },
+};
+
+/**
+ * Fired in tx on any user cache change: drop the network thread
+ * replicas so that revoked passwords can not authenticate. The
+ * invalidation messages travel the same pipes as the replies,
+ * so a reply encoded after the change can not resurrect a stale
+ * entry.
+ */
+static int
+tx_on_user_cache_change(struct trigger *trigger, void *event)
+{
+	(void) trigger;
+	(void) event;
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct iproto_auth_invalidate_msg *msg =
+			(struct iproto_auth_invalidate_msg *)
+			malloc(sizeof(*msg));
+		if (msg == NULL) {
+			say_warn("failed to allocate an iproto auth cache "
+				 "invalidation message");
+			continue;
+		}
+		cmsg_init(&msg->base, auth_invalidate_route);
+		msg->iproto_thread = &iproto_threads[i];
+		cpipe_push(&iproto_threads[i].net_pipe, &msg->base);
+	}
+	return 0;
+}
+
+static struct trigger iproto_user_cache_change_trigger;
+
+/* }}} */
+
 static struct iproto_msg *
 iproto_msg_new(struct iproto_connection *con)
 {
+	struct mempool *pool = &con->iproto_thread->iproto_msg_pool;
 	struct iproto_msg *msg =
-		(struct iproto_msg *) mempool_alloc(&iproto_msg_pool);
+		(struct iproto_msg *) mempool_alloc(pool);
 	ERROR_INJECT(ERRINJ_TESTING, {
-		mempool_free(&iproto_msg_pool, msg);
+		mempool_free(pool, msg);
 		msg = NULL;
 	});
 	if (msg == NULL) {
@@ -566,7 +1096,21 @@ iproto_msg_new(struct iproto_connection *con)
 		return NULL;
 	}
 	msg->connection = con;
-	rmean_collect(rmean_net, IPROTO_REQUESTS, 1);
+	stailq_create(&msg->zdata);
+	stailq_create(&msg->zdata_spent);
+	/*
+	 * Piggyback the written out zero-copy payloads so that
+	 * tx can unreference the tuples. Leftovers of an idle
+	 * connection are released on disconnect.
+	 */
+	stailq_concat(&msg->zdata_spent, &con->zdata_spent);
+	msg->start_time = 0;
+	msg->deferred = false;
+	msg->compression_accepted = false;
+	msg->auth_precheck = AUTH_PRECHECK_NONE;
+	msg->auth_publish = false;
+	con->n_inflight++;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_REQUESTS, 1);
 	return msg;
 }
 
@@ -621,7 +1165,23 @@ iproto_connection_stop_msg_max_limit(struct iproto_connection *con)
 	 * Important to add to tail and fetch from head to ensure
 	 * strict lifo order (fairness) for stopped connections.
 	 */
-	rlist_add_tail(&stopped_connections, &con->in_stop_list);
+	rlist_add_tail(&con->iproto_thread->stopped_connections,
+		       &con->in_stop_list);
+}
+
+/**
+ * Stop input of a connection that has used up its own share of
+ * the request budget. Unlike the msg_max stop above, such a
+ * connection is not put on the global stop list: it is resumed
+ * from iproto_msg_delete() once enough of its requests finish.
+ */
+static inline void
+iproto_connection_stop_quota_limit(struct iproto_connection *con)
+{
+	assert(rlist_empty(&con->in_stop_list));
+	assert(!con->input_blocked_by_quota);
+	con->input_blocked_by_quota = true;
+	ev_io_stop(con->loop, &con->input);
 }
 
 /**
@@ -650,7 +1210,7 @@ iproto_connection_try_to_start_destroy(struct iproto_connection *con)
 	 * other parts of the connection.
 	 */
 	con->state = IPROTO_CONNECTION_DESTROYED;
-	cpipe_push(&tx_pipe, &con->destroy_msg);
+	cpipe_push(&con->iproto_thread->tx_pipe, &con->destroy_msg);
 }
 
 /**
@@ -677,7 +1237,7 @@ iproto_connection_close(struct iproto_connection *con)
 		 * is done only once.
 		 */
 		con->p_ibuf->wpos -= con->parse_size;
-		cpipe_push(&tx_pipe, &con->disconnect_msg);
+		cpipe_push(&con->iproto_thread->tx_pipe, &con->disconnect_msg);
 		assert(con->state == IPROTO_CONNECTION_ALIVE);
 		con->state = IPROTO_CONNECTION_CLOSED;
 	} else if (con->state == IPROTO_CONNECTION_PENDING_DESTROY) {
@@ -686,6 +1246,7 @@ iproto_connection_close(struct iproto_connection *con)
 		assert(con->state == IPROTO_CONNECTION_CLOSED);
 	}
 	rlist_del(&con->in_stop_list);
+	con->input_blocked_by_quota = false;
 }
 
 static inline struct ibuf *
@@ -807,13 +1368,19 @@ static inline int
 iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 {
 	assert(rlist_empty(&con->in_stop_list));
+	struct iproto_thread *iproto_thread = con->iproto_thread;
 	int n_requests = 0;
 	bool stop_input = false;
 	const char *errmsg;
 	while (con->parse_size != 0 && !stop_input) {
-		if (iproto_check_msg_max()) {
+		if (iproto_check_msg_max(iproto_thread)) {
 			iproto_connection_stop_msg_max_limit(con);
-			cpipe_flush_input(&tx_pipe);
+			cpipe_flush_input(&iproto_thread->tx_pipe);
+			return 0;
+		}
+		if (iproto_check_connection_quota(con)) {
+			iproto_connection_stop_quota_limit(con);
+			cpipe_flush_input(&iproto_thread->tx_pipe);
 			return 0;
 		}
 		const char *reqstart = in->wpos - con->parse_size;
@@ -822,7 +1389,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		if (mp_typeof(*pos) != MP_UINT) {
 			errmsg = "packet length";
 err_msgpack:
-			cpipe_flush_input(&tx_pipe);
+			cpipe_flush_input(&iproto_thread->tx_pipe);
 			diag_set(ClientError, ER_INVALID_MSGPACK,
 				 errmsg);
 			return -1;
@@ -858,7 +1425,7 @@ err_msgpack:
 		 * This can't throw, but should not be
 		 * done in case of exception.
 		 */
-		cpipe_push_input(&tx_pipe, &msg->base);
+		cpipe_push_input(&iproto_thread->tx_pipe, &msg->base);
 		n_requests++;
 		/* Request is parsed */
 		assert(reqend > reqstart);
@@ -896,7 +1463,7 @@ err_msgpack:
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	cpipe_flush_input(&iproto_thread->tx_pipe);
 	return 0;
 }
 
@@ -908,7 +1475,7 @@ err_msgpack:
 static void
 iproto_connection_resume(struct iproto_connection *con)
 {
-	assert(! iproto_check_msg_max());
+	assert(! iproto_check_msg_max(con->iproto_thread));
 	rlist_del(&con->in_stop_list);
 	/*
 	 * Enqueue_batch() stops the connection again, if the
@@ -922,6 +1489,20 @@ iproto_connection_resume(struct iproto_connection *con)
 	}
 }
 
+/**
+ * Resume a connection stopped on its per-connection quota once
+ * enough of its requests have completed. Together with the FIFO
+ * stop list above this drains ready connections round-robin,
+ * one quota-sized quantum at a time.
+ */
+static void
+iproto_connection_resume_quota(struct iproto_connection *con)
+{
+	assert(con->input_blocked_by_quota);
+	con->input_blocked_by_quota = false;
+	iproto_connection_resume(con);
+}
+
 /**
  * Resume as many connections as possible until a request limit is
  * reached. By design of iproto_enqueue_batch(), a paused
@@ -932,15 +1513,16 @@ iproto_connection_resume(struct iproto_connection *con)
  * necessary to use up the limit.
  */
 static void
-iproto_resume()
+iproto_resume(struct iproto_thread *iproto_thread)
 {
-	while (!iproto_check_msg_max() && !rlist_empty(&stopped_connections)) {
+	while (!iproto_check_msg_max(iproto_thread) &&
+	       !rlist_empty(&iproto_thread->stopped_connections)) {
 		/*
 		 * Shift from list head to ensure strict FIFO
 		 * (fairness) for resumed connections.
 		 */
 		struct iproto_connection *con =
-			rlist_first_entry(&stopped_connections,
+			rlist_first_entry(&iproto_thread->stopped_connections,
 					  struct iproto_connection,
 					  in_stop_list);
 		iproto_connection_resume(con);
@@ -962,39 +1544,81 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	 * otherwise we might deplete the fiber pool in tx
 	 * thread and deadlock.
 	 */
-	if (iproto_check_msg_max()) {
+	if (iproto_check_msg_max(con->iproto_thread)) {
 		iproto_connection_stop_msg_max_limit(con);
 		return;
 	}
+	if (iproto_check_connection_quota(con)) {
+		iproto_connection_stop_quota_limit(con);
+		return;
+	}
 
 	try {
-		/* Ensure we have sufficient space for the next round.  */
-		struct ibuf *in = iproto_connection_input_buffer(con);
-		if (in == NULL) {
-			iproto_connection_stop_readahead_limit(con);
-			return;
-		}
-		/* Read input. */
-		int nrd = sio_read(fd, in->wpos, ibuf_unused(in));
-		if (nrd < 0) {                  /* Socket is not ready. */
-			if (! sio_wouldblock(errno))
+		/*
+		 * Drain the socket in one go instead of taking an
+		 * event loop round trip per readahead chunk: under
+		 * load a client stuffs many requests into the
+		 * connection and a single wakeup can consume them
+		 * all. The number of rounds is bounded so that one
+		 * chatty connection can not starve the others.
+		 */
+		enum { IPROTO_RECV_BURST_MAX = 8 };
+		for (int round = 0; round < IPROTO_RECV_BURST_MAX; round++) {
+			/*
+			 * Ensure we have sufficient space for the
+			 * next round.
+			 */
+			struct ibuf *in = iproto_connection_input_buffer(con);
+			if (in == NULL) {
+				iproto_connection_stop_readahead_limit(con);
+				return;
+			}
+			/* Read input. */
+			size_t to_read = ibuf_unused(in);
+			int nrd = sio_read(fd, in->wpos, to_read);
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_READ_CALLS, 1);
+			if (nrd < 0) {          /* Socket is not ready. */
+				if (! sio_wouldblock(errno))
+					diag_raise();
+				ev_io_start(loop, &con->input);
+				return;
+			}
+			if (nrd == 0) {         /* EOF */
+				iproto_connection_close(con);
+				return;
+			}
+			/* Count statistics */
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_RECEIVED, nrd);
+
+			/* Update the read position and connection state. */
+			in->wpos += nrd;
+			con->parse_size += nrd;
+			/* Enqueue all requests which are fully read up. */
+			if (iproto_enqueue_batch(con, in) != 0)
 				diag_raise();
-			ev_io_start(loop, &con->input);
-			return;
-		}
-		if (nrd == 0) {                 /* EOF */
-			iproto_connection_close(con);
-			return;
+			/*
+			 * A short read means the socket is drained,
+			 * no point in another recv() just to get
+			 * EAGAIN.
+			 */
+			if (nrd < (ssize_t) to_read)
+				return;
+			/*
+			 * Re-check the request limit before reading
+			 * more: the batch above may have pushed us
+			 * over it.
+			 */
+			if (iproto_check_msg_max(con->iproto_thread)) {
+				iproto_connection_stop_msg_max_limit(con);
+				return;
+			}
+			if (iproto_check_connection_quota(con)) {
+				iproto_connection_stop_quota_limit(con);
+				return;
+			}
 		}
-		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
-
-		/* Update the read position and connection state. */
-		in->wpos += nrd;
-		con->parse_size += nrd;
-		/* Enqueue all requests which are fully read up. */
-		if (iproto_enqueue_batch(con, in) != 0)
-			diag_raise();
 	} catch (Exception *e) {
 		/* Best effort at sending the error message to the client. */
 		iproto_write_error(fd, e, ::schema_version, 0);
@@ -1003,33 +1627,476 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+/**
+ * writev() a range of the output buffer that has zero-copy tuple
+ * payloads spliced into it. @a iov and @a iovcnt describe the
+ * obuf bytes in [begin->used, end->used), @a zdata lists the
+ * payloads in splice order. Entries are handed over strictly
+ * behind the write end position, so their offsets never exceed
+ * end->used. Return values are those of iproto_flush().
+ */
+static int
+iproto_flush_zdata(struct iproto_connection *con, struct iovec *iov,
+		   int iovcnt, struct obuf_svp *begin, struct obuf_svp *end,
+		   struct stailq *zdata)
+{
+	/*
+	 * Each splice point may split one obuf iov in two, plus
+	 * one iov for the payload itself.
+	 */
+	struct iovec out[SMALL_OBUF_IOV_MAX + 1 + 2 * IPROTO_ZCOPY_IOV_MAX];
+	/* Payload of out[i], or NULL if out[i] is obuf bytes. */
+	struct iproto_zdata *src[SMALL_OBUF_IOV_MAX + 1 +
+				 2 * IPROTO_ZCOPY_IOV_MAX];
+	int out_cnt = 0;
+	int zd_cnt = 0;
+	size_t pos = begin->used;
+	int slot = 0;
+	size_t slot_off = 0;
+	bool truncated = false;
+	struct iproto_zdata *zd;
+	(void)iovcnt;
+	stailq_foreach_entry(zd, zdata, next) {
+		assert(zd->obuf_offset >= pos);
+		if (zd->obuf_offset > end->used) {
+			/*
+			 * Past the write end, which may be clamped
+			 * to the compression activation point.
+			 * Wait for the next call.
+			 */
+			truncated = true;
+			break;
+		}
+		if (zd_cnt >= IPROTO_ZCOPY_IOV_MAX) {
+			/*
+			 * Stop the output right here: obuf bytes
+			 * past the offset of an unspliced payload
+			 * must not be sent before it. The rest
+			 * goes out with the next call.
+			 */
+			truncated = true;
+			break;
+		}
+		/* Emit obuf bytes up to the splice point. */
+		while (pos < zd->obuf_offset) {
+			while (slot_off >= iov[slot].iov_len) {
+				slot++;
+				assert(slot < iovcnt);
+				slot_off = 0;
+			}
+			size_t n = MIN(iov[slot].iov_len - slot_off,
+				       zd->obuf_offset - pos);
+			out[out_cnt].iov_base = (char *)iov[slot].iov_base +
+						slot_off;
+			out[out_cnt].iov_len = n;
+			src[out_cnt++] = NULL;
+			slot_off += n;
+			pos += n;
+		}
+		out[out_cnt].iov_base = (char *)zd->data + zd->written;
+		out[out_cnt].iov_len = zd->size - zd->written;
+		src[out_cnt++] = zd;
+		zd_cnt++;
+	}
+	/* Emit the obuf tail. */
+	while (!truncated && pos < end->used) {
+		while (slot_off >= iov[slot].iov_len) {
+			slot++;
+			assert(slot < iovcnt);
+			slot_off = 0;
+		}
+		size_t n = iov[slot].iov_len - slot_off;
+		if (n > end->used - pos)
+			n = end->used - pos;
+		out[out_cnt].iov_base = (char *)iov[slot].iov_base + slot_off;
+		out[out_cnt].iov_len = n;
+		src[out_cnt++] = NULL;
+		slot_off += n;
+		pos += n;
+	}
+
+	ssize_t nwr = sio_writev(con->output.fd, out, out_cnt);
+	rmean_collect(con->iproto_thread->rmean, IPROTO_WRITE_CALLS, 1);
+	if (nwr < 0 && ! sio_wouldblock(errno))
+		diag_raise();
+	if (nwr <= 0)
+		return -1;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+
+	/* Attribute the written bytes to obuf and payloads. */
+	size_t obuf_nwr = 0;
+	size_t left = nwr;
+	for (int i = 0; i < out_cnt && left > 0; i++) {
+		size_t n = MIN(left, out[i].iov_len);
+		if (src[i] == NULL)
+			obuf_nwr += n;
+		else
+			src[i]->written += n;
+		left -= n;
+	}
+	/*
+	 * Retire the payloads written in full. They form a
+	 * prefix of the queue since the output is sequential.
+	 */
+	while (!stailq_empty(zdata)) {
+		zd = stailq_first_entry(zdata, struct iproto_zdata, next);
+		if (zd->written < zd->size)
+			break;
+		stailq_shift(zdata);
+		stailq_add_tail(&con->zdata_spent, &zd->next);
+	}
+	if (obuf_nwr == end->used - begin->used) {
+		*begin = *end;
+		/* Done only if no payload tail is pending. */
+		return stailq_empty(zdata) ? 0 : -1;
+	}
+	if (obuf_nwr > 0) {
+		size_t offset = 0;
+		int advance = sio_move_iov(iov, obuf_nwr, &offset);
+		begin->used += obuf_nwr;	/* advance write position */
+		begin->iov_len = advance == 0 ? begin->iov_len + offset: offset;
+		begin->pos += advance;
+		assert(begin->pos <= end->pos);
+	}
+	return -1;
+}
+
+/** Feed a chunk of output bytes to the compression stream. */
+static void
+iproto_zstream_feed(struct iproto_connection *con, const void *data,
+		    size_t size)
+{
+	ZSTD_inBuffer in = { data, size, 0 };
+	while (in.pos < in.size) {
+		if (ibuf_reserve(&con->zbuf, iproto_readahead) == NULL)
+			tnt_raise(OutOfMemory, iproto_readahead,
+				  "ibuf", "compressed output");
+		ZSTD_outBuffer out = { con->zbuf.wpos,
+				       ibuf_unused(&con->zbuf), 0 };
+		size_t rc = ZSTD_compressStream(con->zstream, &out, &in);
+		con->zbuf.wpos += out.pos;
+		if (ZSTD_isError(rc))
+			tnt_raise(ClientError, ER_SYSTEM,
+				  ZSTD_getErrorName(rc));
+	}
+}
+
+/** Flush the buffered tail of the compression stream. */
+static void
+iproto_zstream_flush(struct iproto_connection *con)
+{
+	size_t rc;
+	do {
+		if (ibuf_reserve(&con->zbuf, iproto_readahead) == NULL)
+			tnt_raise(OutOfMemory, iproto_readahead,
+				  "ibuf", "compressed output");
+		ZSTD_outBuffer out = { con->zbuf.wpos,
+				       ibuf_unused(&con->zbuf), 0 };
+		rc = ZSTD_flushStream(con->zstream, &out);
+		con->zbuf.wpos += out.pos;
+		if (ZSTD_isError(rc))
+			tnt_raise(ClientError, ER_SYSTEM,
+				  ZSTD_getErrorName(rc));
+	} while (rc != 0);
+}
+
+/**
+ * Compressing flavour of the output flush: consume the pending
+ * logical bytes - obuf contents with zero-copy payloads spliced
+ * in - into the connection compression stream, then write the
+ * compressed bytes out. Consumed input is retired immediately
+ * since it is captured in the compressed buffer, so partial
+ * socket writes only ever leave compressed bytes pending.
+ * Return values are those of iproto_flush().
+ */
+static int
+iproto_flush_compressed(struct iproto_connection *con, struct iovec *iov,
+			int iovcnt, struct obuf_svp *begin,
+			struct obuf_svp *end, struct stailq *zdata)
+{
+	if (begin->used < end->used || !stailq_empty(zdata)) {
+		size_t pos = begin->used;
+		int slot = 0;
+		size_t slot_off = 0;
+		struct iproto_zdata *zd;
+		(void)iovcnt;
+		stailq_foreach_entry(zd, zdata, next) {
+			assert(zd->obuf_offset >= pos);
+			assert(zd->obuf_offset <= end->used);
+			/* Feed obuf bytes up to the splice point. */
+			while (pos < zd->obuf_offset) {
+				while (slot_off >= iov[slot].iov_len) {
+					slot++;
+					assert(slot < iovcnt);
+					slot_off = 0;
+				}
+				size_t n = MIN(iov[slot].iov_len - slot_off,
+					       zd->obuf_offset - pos);
+				iproto_zstream_feed(con, (char *)
+						    iov[slot].iov_base +
+						    slot_off, n);
+				slot_off += n;
+				pos += n;
+			}
+			iproto_zstream_feed(con, zd->data + zd->written,
+					    zd->size - zd->written);
+			zd->written = zd->size;
+		}
+		/* Feed the obuf tail. */
+		while (pos < end->used) {
+			while (slot_off >= iov[slot].iov_len) {
+				slot++;
+				assert(slot < iovcnt);
+				slot_off = 0;
+			}
+			size_t n = iov[slot].iov_len - slot_off;
+			if (n > end->used - pos)
+				n = end->used - pos;
+			iproto_zstream_feed(con, (char *)iov[slot].iov_base +
+					    slot_off, n);
+			slot_off += n;
+			pos += n;
+		}
+		iproto_zstream_flush(con);
+		/* The input is captured in zbuf, retire it. */
+		stailq_concat(&con->zdata_spent, zdata);
+		*begin = *end;
+	}
+
+	size_t total = ibuf_used(&con->zbuf);
+	assert(total > 0);
+	ssize_t nwr = sio_write(con->output.fd, con->zbuf.rpos, total);
+	rmean_collect(con->iproto_thread->rmean, IPROTO_WRITE_CALLS, 1);
+	if (nwr < 0 && ! sio_wouldblock(errno))
+		diag_raise();
+	if (nwr <= 0)
+		return -1;
+	rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+	con->zbuf.rpos += nwr;
+	if (ibuf_used(&con->zbuf) > 0)
+		return -1;
+	ibuf_reset(&con->zbuf);
+	return 0;
+}
+
+enum {
+	/**
+	 * Once the output buffers together grow past this size,
+	 * flushable bytes are spilled to a temporary file rather
+	 * than being kept in memory, see iproto_spill_write().
+	 */
+	IPROTO_SPILL_THRESHOLD = 64 * 1024 * 1024,
+};
+
+/** True if the connection output should go via the spill file. */
+static inline bool
+iproto_spill_should(struct iproto_connection *con)
+{
+	return !con->spill_disabled &&
+	       obuf_size(&con->obuf[0]) + obuf_size(&con->obuf[1]) >=
+	       IPROTO_SPILL_THRESHOLD;
+}
+
+/**
+ * Send the pending part of the spill file to the socket. Spilled
+ * bytes are older than anything in the output buffers so they
+ * always go out first. Returns 0 when the file is fully drained,
+ * -1 if the socket would block. Raises on a socket error.
+ */
+static int
+iproto_spill_drain(struct iproto_connection *con)
+{
+	while (con->spill_rpos < con->spill_wpos) {
+		size_t count = MIN((size_t)(con->spill_wpos - con->spill_rpos),
+				   (size_t)(1 << 20));
+		ssize_t nwr;
+#ifdef HAVE_SENDFILE_LINUX
+		/*
+		 * Cannot use eio/coio_file helpers - ev callbacks
+		 * are not run in fiber context.
+		 */
+		nwr = sendfile(con->output.fd, con->spill_fd,
+			       &con->spill_rpos, count);
+		if (nwr < 0 && !sio_wouldblock(errno)) {
+			tnt_raise(SocketError, sio_socketname(con->output.fd),
+				  "sendfile");
+		}
+		if (nwr <= 0)
+			return -1;
+#else
+		char buf[16384];
+		count = MIN(count, sizeof(buf));
+		ssize_t nrd = pread(con->spill_fd, buf, count,
+				    con->spill_rpos);
+		if (nrd <= 0) {
+			tnt_raise(SystemError, "failed to read iproto "
+				  "spill file");
+		}
+		nwr = sio_write(con->output.fd, buf, nrd);
+		if (nwr < 0 && !sio_wouldblock(errno))
+			diag_raise();
+		if (nwr <= 0)
+			return -1;
+		con->spill_rpos += nwr;
+#endif
+		rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+		rmean_collect(con->iproto_thread->rmean, IPROTO_WRITE_CALLS, 1);
+	}
+	/* Fully drained - recycle the file. */
+	if (ftruncate(con->spill_fd, 0) == 0)
+		con->spill_rpos = con->spill_wpos = 0;
+	return 0;
+}
+
+/**
+ * Move the flushable region of the output buffer into the spill
+ * file and advance the flush position as if it had been written
+ * to the socket: this is what lets tx find the buffer flushed out
+ * and recycle its memory. On any failure spilling is disabled for
+ * the connection and output falls back to in-memory flushing.
+ */
+static int
+iproto_spill_write(struct iproto_connection *con, struct iovec *iov,
+		   int iovcnt, struct obuf_svp *begin, struct obuf_svp *end)
+{
+	if (con->spill_fd < 0) {
+		/*
+		 * Spill files can grow to many tens of megabytes,
+		 * so honor TMPDIR like the rest of the temporary
+		 * file machinery (see coio_tempdir()) instead of
+		 * insisting on /tmp, which may be a small tmpfs.
+		 */
+		const char *tmpdir = getenv("TMPDIR");
+		if (tmpdir == NULL)
+			tmpdir = "/tmp";
+		char path[PATH_MAX];
+		int rc = snprintf(path, sizeof(path),
+				  "%s/tarantool_iproto_spill_XXXXXX", tmpdir);
+		if (rc < 0 || (size_t)rc >= sizeof(path)) {
+			say_error("iproto spill path is too long");
+			con->spill_disabled = true;
+			return -1;
+		}
+		int fd = mkstemp(path);
+		if (fd < 0) {
+			say_syserror("failed to create iproto spill file");
+			con->spill_disabled = true;
+			return -1;
+		}
+		unlink(path);
+		con->spill_fd = fd;
+	}
+	if (fio_writevn(con->spill_fd, iov, iovcnt) < 0) {
+		say_syserror("failed to write iproto spill file");
+		close(con->spill_fd);
+		con->spill_fd = -1;
+		con->spill_rpos = con->spill_wpos = 0;
+		con->spill_disabled = true;
+		return -1;
+	}
+	con->spill_wpos += end->used - begin->used;
+	*begin = *end;
+	return 0;
+}
+
+enum {
+	/**
+	 * Pending output at or above this size is treated as a
+	 * large streaming response, e.g. a huge select or an
+	 * export: the socket is corked for the duration of the
+	 * burst so the kernel sends full-sized frames instead of
+	 * the partial segments TCP_NODELAY produces at obuf slab
+	 * boundaries.
+	 */
+	IPROTO_LARGE_OUTPUT_THRESHOLD = 64 * 1024,
+	/**
+	 * Cap on the number of bytes submitted to a single
+	 * writev() for a large response - a few TSO aggregates.
+	 * Bounding the submission keeps individual syscalls short
+	 * so small replies on other connections of the same
+	 * network thread are not stuck behind one huge write.
+	 */
+	IPROTO_WRITEV_BOUND = 256 * 1024,
+};
+
+/**
+ * Cork or uncork the connection socket. Sockets are accepted with
+ * TCP_NODELAY set (see evio_setsockopt_client()), which is right
+ * for small replies but wrong while a large response is streamed
+ * in many bounded writev() calls. Corking for the duration of the
+ * burst lets the kernel coalesce full frames; uncorking when the
+ * burst is drained flushes the tail and restores the low-latency
+ * behavior. A no-op where TCP_CORK is not available or not
+ * applicable to the socket (e.g. a unix socket).
+ */
+static void
+iproto_set_cork(struct iproto_connection *con, bool on)
+{
+#ifdef TCP_CORK
+	if (con->cork_disabled)
+		return;
+	int val = on ? 1 : 0;
+	if (sio_setsockopt(con->output.fd, IPPROTO_TCP, TCP_CORK,
+			   &val, sizeof(val)) != 0) {
+		diag_clear(diag_get());
+		con->cork_disabled = true;
+		return;
+	}
+	con->tcp_corked = on;
+#else
+	(void)con;
+	(void)on;
+#endif
+}
+
 /** writev() to the socket and handle the result. */
 
 static int
 iproto_flush(struct iproto_connection *con)
 {
+	if (con->spill_fd >= 0 && con->spill_rpos < con->spill_wpos &&
+	    iproto_spill_drain(con) != 0)
+		return -1;
 	int fd = con->output.fd;
 	struct obuf *obuf = con->wpos.obuf;
 	struct obuf_svp obuf_end = obuf_create_svp(obuf);
 	struct obuf_svp *begin = &con->wpos.svp;
 	struct obuf_svp *end = &con->wend.svp;
+	struct stailq *zdata = &con->zdata[obuf == &con->obuf[1]];
+	if (con->zstream != NULL && !con->compress_active &&
+	    obuf == con->compress_activation.obuf &&
+	    begin->used >= con->compress_activation.svp.used) {
+		/* The plain prefix has been fully flushed. */
+		con->compress_active = true;
+	}
 	if (con->wend.obuf != obuf) {
 		/*
 		 * Flush the current buffer before
 		 * advancing to the next one.
 		 */
-		if (begin->used == obuf_end.used) {
+		if (begin->used == obuf_end.used && stailq_empty(zdata)) {
 			obuf = con->wpos.obuf = con->wend.obuf;
 			obuf_svp_reset(begin);
+			zdata = &con->zdata[obuf == &con->obuf[1]];
 		} else {
 			end = &obuf_end;
 		}
 	}
-	if (begin->used == end->used) {
+	if (begin->used == end->used && stailq_empty(zdata) &&
+	    (con->zstream == NULL || ibuf_used(&con->zbuf) == 0)) {
 		/* Nothing to do. */
 		return 1;
 	}
-	assert(begin->used < end->used);
+	assert(begin->used <= end->used);
+	if (con->zstream != NULL && !con->compress_active &&
+	    obuf == con->compress_activation.obuf &&
+	    end->used > con->compress_activation.svp.used) {
+		/*
+		 * Flush the plain prefix up to the activation
+		 * point, compression picks up from there.
+		 */
+		end = &con->compress_activation.svp;
+	}
 	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
 	struct iovec *src = obuf->iov;
 	int iovcnt = end->pos - begin->pos + 1;
@@ -1042,12 +2109,59 @@ iproto_flush(struct iproto_connection *con)
 	/* *Overwrite* iov_len of the last pos as it may be garbage. */
 	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
 
-	ssize_t nwr = sio_writev(fd, iov, iovcnt);
+	if (con->tcp_corked &&
+	    (con->compress_active || !stailq_empty(zdata) ||
+	     iproto_spill_should(con))) {
+		/*
+		 * The corked burst is being rerouted to a path
+		 * with its own pacing - don't delay its bytes.
+		 */
+		iproto_set_cork(con, false);
+	}
+
+	if (con->compress_active)
+		return iproto_flush_compressed(con, iov, iovcnt, begin, end,
+					       zdata);
+
+	if (! stailq_empty(zdata))
+		return iproto_flush_zdata(con, iov, iovcnt, begin, end, zdata);
+
+	if (iproto_spill_should(con))
+		return iproto_spill_write(con, iov, iovcnt, begin, end);
+
+	size_t pending = end->used - begin->used;
+	bool large = pending >= IPROTO_LARGE_OUTPUT_THRESHOLD;
+	if (large != con->tcp_corked)
+		iproto_set_cork(con, large);
+	int wcnt = iovcnt;
+	size_t submit = pending;
+	size_t saved_len = 0;
+	if (large && pending > IPROTO_WRITEV_BOUND) {
+		/* Trim the iov to the submission bound. */
+		size_t budget = IPROTO_WRITEV_BOUND;
+		for (wcnt = 0; iov[wcnt].iov_len < budget; wcnt++)
+			budget -= iov[wcnt].iov_len;
+		saved_len = iov[wcnt].iov_len;
+		iov[wcnt].iov_len = budget;
+		wcnt++;
+		submit = IPROTO_WRITEV_BOUND;
+	}
+	ssize_t nwr = sio_writev(fd, iov, wcnt);
+	rmean_collect(con->iproto_thread->rmean, IPROTO_WRITE_CALLS, 1);
+	if (saved_len != 0) {
+		/* Restore the real length for the advance math. */
+		iov[wcnt - 1].iov_len = saved_len;
+	}
 
 	if (nwr > 0) {
 		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_SENT, nwr);
+		rmean_collect(con->iproto_thread->rmean, IPROTO_SENT, nwr);
+		rmean_collect(con->iproto_thread->rmean,
+			      large ? IPROTO_SENT_LARGE : IPROTO_SENT_SMALL,
+			      nwr);
 		if (begin->used + nwr == end->used) {
+			if (con->tcp_corked)
+				iproto_set_cork(con, false);
 			*begin = *end;
 			return 0;
 		}
@@ -1058,6 +2172,14 @@ iproto_flush(struct iproto_connection *con)
 		begin->iov_len = advance == 0 ? begin->iov_len + offset: offset;
 		begin->pos += advance;
 		assert(begin->pos <= end->pos);
+		if ((size_t)nwr == submit) {
+			/*
+			 * The bounded chunk was fully accepted, so
+			 * the socket is still writable - tell the
+			 * caller to keep pumping.
+			 */
+			return 0;
+		}
 	} else if (nwr < 0 && ! sio_wouldblock(errno)) {
 		diag_raise();
 	}
@@ -1091,14 +2213,15 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 }
 
 static struct iproto_connection *
-iproto_connection_new(int fd)
+iproto_connection_new(struct iproto_thread *iproto_thread, int fd)
 {
 	struct iproto_connection *con = (struct iproto_connection *)
-		mempool_alloc(&iproto_connection_pool);
+		mempool_alloc(&iproto_thread->iproto_connection_pool);
 	if (con == NULL) {
 		diag_set(OutOfMemory, sizeof(*con), "mempool_alloc", "con");
 		return NULL;
 	}
+	con->iproto_thread = iproto_thread;
 	con->input.data = con->output.data = con;
 	con->loop = loop();
 	ev_io_init(&con->input, iproto_connection_on_input, fd, EV_READ);
@@ -1111,17 +2234,33 @@ iproto_connection_new(int fd)
 	con->tx.p_obuf = &con->obuf[0];
 	iproto_wpos_create(&con->wpos, con->tx.p_obuf);
 	iproto_wpos_create(&con->wend, con->tx.p_obuf);
+	stailq_create(&con->zdata[0]);
+	stailq_create(&con->zdata[1]);
+	stailq_create(&con->zdata_spent);
+	con->zstream = NULL;
+	con->compress_active = false;
+	con->spill_fd = -1;
+	con->spill_rpos = 0;
+	con->spill_wpos = 0;
+	con->spill_disabled = false;
+	con->tcp_corked = false;
+	con->cork_disabled = false;
 	con->parse_size = 0;
 	con->long_poll_count = 0;
+	con->n_inflight = 0;
+	con->input_blocked_by_quota = false;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
 	/* It may be very awkward to allocate at close. */
-	cmsg_init(&con->destroy_msg, destroy_route);
-	cmsg_init(&con->disconnect_msg, disconnect_route);
+	cmsg_init(&con->destroy_msg, iproto_thread->destroy_route);
+	cmsg_init(&con->disconnect_msg, iproto_thread->disconnect_route);
 	con->state = IPROTO_CONNECTION_ALIVE;
 	con->tx.is_push_pending = false;
 	con->tx.is_push_sent = false;
-	rmean_collect(rmean_net, IPROTO_CONNECTIONS, 1);
+	con->tx.is_disconnected = false;
+	fiber_cond_create(&con->tx.push_cond);
+	rlist_create(&con->tx.watchers);
+	rmean_collect(iproto_thread->rmean, IPROTO_CONNECTIONS, 1);
 	return con;
 }
 
@@ -1140,11 +2279,17 @@ iproto_connection_delete(struct iproto_connection *con)
 	 */
 	ibuf_destroy(&con->ibuf[0]);
 	ibuf_destroy(&con->ibuf[1]);
+	if (con->zstream != NULL) {
+		ZSTD_freeCStream(con->zstream);
+		ibuf_destroy(&con->zbuf);
+	}
+	if (con->spill_fd >= 0)
+		close(con->spill_fd);
 	assert(con->obuf[0].pos == 0 &&
 	       con->obuf[0].iov[0].iov_base == NULL);
 	assert(con->obuf[1].pos == 0 &&
 	       con->obuf[1].iov[0].iov_base == NULL);
-	mempool_free(&iproto_connection_pool, con);
+	mempool_free(&con->iproto_thread->iproto_connection_pool, con);
 }
 
 /* }}} iproto_connection */
@@ -1184,72 +2329,110 @@ tx_process_replication(struct cmsg *msg);
 static void
 net_end_join(struct cmsg *msg);
 
-static void
-net_end_subscribe(struct cmsg *msg);
-
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop call_route[] = {
-	{ tx_process_call, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop sql_route[] = {
-	{ tx_process_sql, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	call_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	call_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	call_route,                             /* IPROTO_CALL */
-	sql_route,                              /* IPROTO_EXECUTE */
-	NULL,                                   /* IPROTO_NOP */
-	sql_route,                              /* IPROTO_PREPARE */
-};
+static void
+net_end_subscribe(struct cmsg *msg);
 
-static const struct cmsg_hop join_route[] = {
-	{ tx_process_replication, &net_pipe },
-	{ net_end_join, NULL },
-};
+static void
+tx_process_connect(struct cmsg *m);
 
-static const struct cmsg_hop subscribe_route[] = {
-	{ tx_process_replication, &net_pipe },
-	{ net_end_subscribe, NULL },
-};
+static void
+net_send_greeting(struct cmsg *m);
 
-static const struct cmsg_hop error_route[] = {
-	{ tx_reply_iproto_error, &net_pipe },
-	{ net_send_error, NULL },
-};
+/**
+ * Instantiate the cbus routes of a network thread. The routes
+ * forward messages over the thread's own pipes, so each thread
+ * needs its own copy.
+ */
+static void
+iproto_thread_init_routes(struct iproto_thread *iproto_thread)
+{
+	struct cpipe *tx_pipe = &iproto_thread->tx_pipe;
+	struct cpipe *net_pipe = &iproto_thread->net_pipe;
+
+	iproto_thread->destroy_route[0] = { tx_process_destroy, net_pipe };
+	iproto_thread->destroy_route[1] = { net_finish_destroy, NULL };
+
+	iproto_thread->disconnect_route[0] =
+		{ tx_process_disconnect, net_pipe };
+	iproto_thread->disconnect_route[1] = { net_finish_disconnect, NULL };
+
+	iproto_thread->misc_route[0] = { tx_process_misc, net_pipe };
+	iproto_thread->misc_route[1] = { net_send_msg, NULL };
+
+	iproto_thread->call_route[0] = { tx_process_call, net_pipe };
+	iproto_thread->call_route[1] = { net_send_msg, NULL };
+
+	iproto_thread->select_route[0] = { tx_process_select, net_pipe };
+	iproto_thread->select_route[1] = { net_send_msg, NULL };
+
+	iproto_thread->process1_route[0] = { tx_process1, net_pipe };
+	iproto_thread->process1_route[1] = { net_send_msg, NULL };
+
+	iproto_thread->sql_route[0] = { tx_process_sql, net_pipe };
+	iproto_thread->sql_route[1] = { net_send_msg, NULL };
+
+	iproto_thread->join_route[0] = { tx_process_replication, net_pipe };
+	iproto_thread->join_route[1] = { net_end_join, NULL };
+
+	iproto_thread->subscribe_route[0] =
+		{ tx_process_replication, net_pipe };
+	iproto_thread->subscribe_route[1] = { net_end_subscribe, NULL };
+
+	iproto_thread->error_route[0] = { tx_reply_iproto_error, net_pipe };
+	iproto_thread->error_route[1] = { net_send_error, NULL };
+
+	iproto_thread->push_route[0] = { iproto_process_push, tx_pipe };
+	iproto_thread->push_route[1] = { tx_end_push, NULL };
+
+	iproto_thread->connect_route[0] = { tx_process_connect, net_pipe };
+	iproto_thread->connect_route[1] = { net_send_greeting, NULL };
+
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
+		NULL,                           /* IPROTO_OK */
+		iproto_thread->select_route,    /* IPROTO_SELECT */
+		iproto_thread->process1_route,  /* IPROTO_INSERT */
+		iproto_thread->process1_route,  /* IPROTO_REPLACE */
+		iproto_thread->process1_route,  /* IPROTO_UPDATE */
+		iproto_thread->process1_route,  /* IPROTO_DELETE */
+		iproto_thread->call_route,      /* IPROTO_CALL_16 */
+		iproto_thread->misc_route,      /* IPROTO_AUTH */
+		iproto_thread->call_route,      /* IPROTO_EVAL */
+		iproto_thread->process1_route,  /* IPROTO_UPSERT */
+		iproto_thread->call_route,      /* IPROTO_CALL */
+		iproto_thread->sql_route,       /* IPROTO_EXECUTE */
+		NULL,                           /* IPROTO_NOP */
+		iproto_thread->sql_route,       /* IPROTO_PREPARE */
+	};
+	memcpy(iproto_thread->dml_route, dml_route, sizeof(dml_route));
+}
 
+/**
+ * Decode a request and select a cbus route for it.
+ *
+ * Note on ordering: requests of one connection are *dispatched*
+ * in arrival order, but they are not *executed* serially. Each
+ * message runs in its own fiber of the tx fiber pool, so a
+ * request which yields (a vinyl read, a Lua call doing I/O) does
+ * not delay the requests parsed after it. Replies are sent in
+ * completion order and are matched by the client via the sync id:
+ * net_send_msg() advances the write position per message and
+ * discards exactly the message's own input bytes, neither of
+ * which depends on completion order. Long-running calls
+ * additionally release their input early through an on_yield
+ * trigger (see tx_process_call_on_yield()), so a stalled call
+ * does not pin the input buffer either. Input is stopped
+ * (*stop_input) only for replication handshake requests, which
+ * take over the connection and are incompatible with further
+ * multiplexing.
+ */
 static void
 iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
 {
+	struct iproto_thread *iproto_thread = msg->connection->iproto_thread;
 	uint8_t type;
 
+	msg->start_time = ev_monotonic_now(loop());
 	if (xrow_header_decode(&msg->header, pos, reqend, true))
 		goto error;
 	assert(*pos == reqend);
@@ -1271,43 +2454,53 @@ iproto_msg_decode(struct iproto_msg *msg, const char **pos, const char *reqend,
 		if (xrow_decode_dml(&msg->header, &msg->dml,
 				    dml_request_key_map(type)))
 			goto error;
-		assert(type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(&msg->base, dml_route[type]);
+		assert(type < lengthof(iproto_thread->dml_route));
+		cmsg_init(&msg->base, iproto_thread->dml_route[type]);
 		break;
 	case IPROTO_CALL_16:
 	case IPROTO_CALL:
 	case IPROTO_EVAL:
 		if (xrow_decode_call(&msg->header, &msg->call))
 			goto error;
-		cmsg_init(&msg->base, call_route);
+		cmsg_init(&msg->base, iproto_thread->call_route);
 		break;
 	case IPROTO_EXECUTE:
 	case IPROTO_PREPARE:
 		if (xrow_decode_sql(&msg->header, &msg->sql) != 0)
 			goto error;
-		cmsg_init(&msg->base, sql_route);
+		cmsg_init(&msg->base, iproto_thread->sql_route);
 		break;
 	case IPROTO_PING:
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_JOIN:
 	case IPROTO_FETCH_SNAPSHOT:
 	case IPROTO_REGISTER:
-		cmsg_init(&msg->base, join_route);
+		cmsg_init(&msg->base, iproto_thread->join_route);
 		*stop_input = true;
 		break;
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(&msg->base, subscribe_route);
+		cmsg_init(&msg->base, iproto_thread->subscribe_route);
 		*stop_input = true;
 		break;
 	case IPROTO_VOTE_DEPRECATED:
 	case IPROTO_VOTE:
-		cmsg_init(&msg->base, misc_route);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	case IPROTO_AUTH:
 		if (xrow_decode_auth(&msg->header, &msg->auth))
 			goto error;
-		cmsg_init(&msg->base, misc_route);
+		iproto_auth_precheck(msg);
+		cmsg_init(&msg->base, iproto_thread->misc_route);
+		break;
+	case IPROTO_COMPRESSION:
+		cmsg_init(&msg->base, iproto_thread->misc_route);
+		break;
+	case IPROTO_WATCH:
+	case IPROTO_UNWATCH:
+		if (xrow_decode_watch(&msg->header, &msg->watch))
+			goto error;
+		cmsg_init(&msg->base, iproto_thread->misc_route);
 		break;
 	default:
 		diag_set(ClientError, ER_UNKNOWN_REQUEST_TYPE,
@@ -1320,7 +2513,7 @@ error:
 	diag_log();
 	diag_create(&msg->diag);
 	diag_move(&fiber()->diag, &msg->diag);
-	cmsg_init(&msg->base, error_route);
+	cmsg_init(&msg->base, iproto_thread->error_route);
 }
 
 static void
@@ -1352,6 +2545,7 @@ tx_process_disconnect(struct cmsg *m)
 {
 	struct iproto_connection *con =
 		container_of(m, struct iproto_connection, disconnect_msg);
+	tx_delete_watchers(con);
 	if (con->session != NULL) {
 		session_close(con->session);
 		if (! rlist_empty(&session_on_disconnect)) {
@@ -1359,6 +2553,9 @@ tx_process_disconnect(struct cmsg *m)
 			session_run_on_disconnect_triggers(con->session);
 		}
 	}
+	con->tx.is_disconnected = true;
+	/* Wake up pushes waiting for the output to drain. */
+	fiber_cond_broadcast(&con->tx.push_cond);
 }
 
 static void
@@ -1382,12 +2579,21 @@ tx_process_destroy(struct cmsg *m)
 		session_destroy(con->session);
 		con->session = NULL; /* safety */
 	}
+	/*
+	 * The network thread is done with the connection by the
+	 * time the destroy message is sent, so the zero-copy
+	 * queues can be released from tx.
+	 */
+	tx_release_zdata(&con->zdata[0]);
+	tx_release_zdata(&con->zdata[1]);
+	tx_release_zdata(&con->zdata_spent);
 	/*
 	 * Got to be done in iproto thread since
 	 * that's where the memory is allocated.
 	 */
 	obuf_destroy(&con->obuf[0]);
 	obuf_destroy(&con->obuf[1]);
+	fiber_cond_destroy(&con->tx.push_cond);
 }
 
 /**
@@ -1415,6 +2621,27 @@ tx_check_schema(uint32_t new_schema_version)
 	return 0;
 }
 
+/**
+ * Park the request until this instance reaches the causal read
+ * token attached to it, if any. An empty token does not wait, but
+ * still requests the commit vclock in the response - that is how
+ * a client bootstraps a read-your-writes session.
+ */
+static int
+tx_wait_request_vclock(const struct request *request)
+{
+	if (request->vclock == NULL)
+		return 0;
+	const char *data = request->vclock;
+	struct vclock vclock;
+	if (mp_decode_vclock(&data, &vclock) != 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "causal read token");
+		return -1;
+	}
+	return replicaset_wait_vclock(&vclock, replication_sync_timeout);
+}
+
 static void
 net_discard_input(struct cmsg *m)
 {
@@ -1436,7 +2663,8 @@ tx_discard_input(struct iproto_msg *msg)
 		{ net_discard_input, NULL },
 	};
 	cmsg_init(&msg->discard_input, discard_input_route);
-	cpipe_push(&net_pipe, &msg->discard_input);
+	cpipe_push(&msg->connection->iproto_thread->net_pipe,
+		   &msg->discard_input);
 }
 
 /**
@@ -1478,12 +2706,83 @@ tx_accept_wpos(struct iproto_connection *con, const struct iproto_wpos *wpos)
 	}
 }
 
+enum {
+	/** The gc reserve covers this percentile of recent requests. */
+	IPROTO_REGION_PERCENTILE = 90,
+	/**
+	 * Hard cap on the gc region retained by a tx fiber pool
+	 * fiber between requests. The pool may hold thousands of
+	 * fibers, so the cap is kept modest: a rare huge request
+	 * frees its slabs rather than pinning them forever.
+	 */
+	IPROTO_REGION_RESERVE_MAX = 512 * 1024,
+};
+
+/** Retention profile of request-serving tx fiber gc regions. */
+static struct region_profile iproto_region_profile;
+
+enum {
+	/**
+	 * A low-priority request is never delayed longer than
+	 * this many seconds in total, whatever the queue
+	 * latency, so that low-priority sessions are not
+	 * starved indefinitely.
+	 */
+	IPROTO_DEFER_TIMEOUT = 1,
+};
+
+/**
+ * Tx queue latency threshold above which requests of
+ * low-priority sessions are deferred, in seconds. Configured
+ * with the net_defer_latency box.cfg option, zero means
+ * admission control is disabled. Accessed by the tx thread
+ * only.
+ */
+static double iproto_defer_latency = 0;
+
+/**
+ * Exponential moving average of the time requests spend queued
+ * to the tx thread, from decoding in the network thread to
+ * pickup by a tx fiber. Updated by the tx thread only.
+ */
+static double iproto_tx_queue_latency = 0;
+
+/**
+ * Delay a request of a low-priority session while the tx queue
+ * latency stays above the configured threshold, giving way to
+ * the requests of normal sessions queued behind it.
+ */
+static void
+tx_defer_low_priority_msg(struct iproto_msg *msg)
+{
+	double deadline = ev_monotonic_now(loop()) + IPROTO_DEFER_TIMEOUT;
+	while (iproto_tx_queue_latency > iproto_defer_latency &&
+	       ev_monotonic_now(loop()) < deadline) {
+		msg->deferred = true;
+		fiber_sleep(iproto_defer_latency);
+	}
+}
+
 static inline struct iproto_msg *
 tx_accept_msg(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	tx_accept_wpos(msg->connection, &msg->wpos);
+	/* Drop references to the payloads flushed by the network. */
+	if (! stailq_empty(&msg->zdata_spent))
+		tx_release_zdata(&msg->zdata_spent);
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+	fiber()->gc_profile = &iproto_region_profile;
+	if (msg->start_time != 0) {
+		/* EWMA with 1/16 weight - cheap and smooth enough. */
+		double wait = ev_monotonic_now(loop()) - msg->start_time;
+		iproto_tx_queue_latency +=
+			(wait - iproto_tx_queue_latency) / 16;
+		struct session *session = msg->connection->session;
+		if (iproto_defer_latency > 0 && session != NULL &&
+		    session->is_low_priority)
+			tx_defer_low_priority_msg(msg);
+	}
 	return msg;
 }
 
@@ -1528,8 +2827,13 @@ static void
 tx_process1(struct cmsg *m)
 {
 	struct iproto_msg *msg = tx_accept_msg(m);
+	if (msg->dml.timeout > 0)
+		fiber_set_deadline(ev_monotonic_now(loop()) +
+				   msg->dml.timeout);
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
+	if (tx_wait_request_vclock(&msg->dml) != 0)
+		goto error;
 
 	struct tuple *tuple;
 	struct obuf_svp svp;
@@ -1542,14 +2846,92 @@ tx_process1(struct cmsg *m)
 		goto error;
 	if (tuple && tuple_to_obuf(tuple, out))
 		goto error;
-	iproto_reply_select(out, &svp, msg->header.sync, ::schema_version,
-			    tuple != 0);
+	if (msg->dml.vclock != NULL) {
+		/*
+		 * The client runs a causal read session - return
+		 * the commit vclock so it can be attached to
+		 * subsequent reads on a replica.
+		 */
+		if (iproto_reply_select_with_vclock(out, &svp,
+						    msg->header.sync,
+						    ::schema_version,
+						    tuple != 0,
+						    &replicaset.vclock) != 0) {
+			obuf_rollback_to_svp(out, &svp);
+			goto error;
+		}
+	} else {
+		iproto_reply_select(out, &svp, msg->header.sync,
+				    ::schema_version, tuple != 0);
+	}
 	iproto_wpos_create(&msg->wpos, out);
+	fiber_set_deadline(0);
 	return;
 error:
+	fiber_set_deadline(0);
 	tx_reply_error(msg);
 }
 
+/**
+ * Dump a select result into the connection output buffer in the
+ * legacy (pre-1.7) format. Tuple payloads larger than
+ * IPROTO_ZCOPY_THRESHOLD are not copied: they are referenced and
+ * spliced into the socket output by the network thread, see
+ * struct iproto_zdata. The accumulated payload size is added to
+ * @a spliced_len - the response length in the packet header must
+ * account for the bytes stored outside the output buffer.
+ * Returns the number of dumped tuples or -1 on error, in which
+ * case the queued payloads are released and the caller is
+ * supposed to roll back the output buffer.
+ */
+static int
+tx_port_dump_zdata(struct iproto_msg *msg, struct port *base, struct obuf *out,
+		   size_t *spliced_len)
+{
+	assert(base->vtab == &port_tuple_vtab);
+	struct port_tuple *port = port_tuple(base);
+	struct stailq zdata;
+	stailq_create(&zdata);
+	struct port_tuple_entry *pe;
+	for (pe = port->first; pe != NULL; pe = pe->next) {
+		uint32_t bsize;
+		const char *data = tuple_data_range(pe->tuple, &bsize);
+		if (bsize < IPROTO_ZCOPY_THRESHOLD) {
+			if ((uint32_t)obuf_dup(out, data, bsize) != bsize) {
+				diag_set(OutOfMemory, bsize, "obuf_dup",
+					 "data");
+				goto error;
+			}
+			ERROR_INJECT(ERRINJ_PORT_DUMP, {
+				diag_set(OutOfMemory, bsize, "obuf_dup",
+					 "data");
+				goto error;
+			});
+			continue;
+		}
+		struct iproto_zdata *zd = (struct iproto_zdata *)
+			mempool_alloc(&iproto_zdata_pool);
+		if (zd == NULL) {
+			diag_set(OutOfMemory, sizeof(*zd), "mempool_alloc",
+				 "zd");
+			goto error;
+		}
+		zd->obuf_offset = obuf_size(out);
+		zd->data = data;
+		zd->size = bsize;
+		zd->written = 0;
+		zd->tuple = pe->tuple;
+		tuple_ref(pe->tuple);
+		stailq_add_tail(&zdata, &zd->next);
+		*spliced_len += bsize;
+	}
+	stailq_concat(&msg->zdata, &zdata);
+	return port->size;
+error:
+	tx_release_zdata(&zdata);
+	return -1;
+}
+
 static void
 tx_process_select(struct cmsg *m)
 {
@@ -1559,9 +2941,14 @@ tx_process_select(struct cmsg *m)
 	struct port port;
 	int count;
 	int rc;
+	size_t spliced_len = 0;
 	struct request *req = &msg->dml;
+	if (req->timeout > 0)
+		fiber_set_deadline(ev_monotonic_now(loop()) + req->timeout);
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
+	if (tx_wait_request_vclock(req) != 0)
+		goto error;
 
 	tx_inject_delay();
 	rc = box_select(req->space_id, req->index_id,
@@ -1578,18 +2965,20 @@ tx_process_select(struct cmsg *m)
 	/*
 	 * SELECT output format has not changed since Tarantool 1.6
 	 */
-	count = port_dump_msgpack_16(&port, out);
+	count = tx_port_dump_zdata(msg, &port, out, &spliced_len);
 	port_destroy(&port);
 	if (count < 0) {
 		/* Discard the prepared select. */
 		obuf_rollback_to_svp(out, &svp);
 		goto error;
 	}
-	iproto_reply_select(out, &svp, msg->header.sync,
-			    ::schema_version, count);
+	iproto_reply_select_spliced(out, &svp, msg->header.sync,
+				    ::schema_version, count, spliced_len);
 	iproto_wpos_create(&msg->wpos, out);
+	fiber_set_deadline(0);
 	return;
 error:
+	fiber_set_deadline(0);
 	tx_reply_error(msg);
 }
 
@@ -1683,6 +3072,300 @@ error:
 	tx_reply_error(msg);
 }
 
+/**
+ * Validate a COMPRESSION request. The only supported algorithm
+ * is zstd; an empty body stands for it as well. Raises on a
+ * malformed body or an unsupported algorithm.
+ */
+static void
+tx_check_compression(struct iproto_msg *msg)
+{
+	const char *algo;
+	uint32_t algo_len;
+	if (xrow_decode_compression(&msg->header, &algo, &algo_len) != 0)
+		diag_raise();
+	if (algo != NULL && (algo_len != 4 || memcmp(algo, "zstd", 4) != 0)) {
+		tnt_raise(ClientError, ER_UNSUPPORTED, "iproto",
+			  tt_sprintf("compression algorithm '%.*s'",
+				     algo_len, algo));
+	}
+}
+
+/**
+ * After a successful authentication hand the password hash of
+ * the user over to the network thread, so that it can pre-check
+ * the scrambles of further connections of the same user itself.
+ */
+static void
+tx_auth_publish(struct iproto_msg *msg)
+{
+	const char *name = msg->auth.user_name;
+	uint32_t name_len = mp_decode_strl(&name);
+	struct user *user = user_find_by_name(name, name_len);
+	if (user == NULL)
+		return;
+	memcpy(msg->auth_hash2, user->def->hash2, SCRAMBLE_SIZE);
+	msg->auth_publish = true;
+}
+
+/* {{{ IPROTO_WATCH implementation. */
+
+enum {
+	/**
+	 * How many watchers a single connection may register.
+	 * A watcher is cheap, but it is malloced and lives until
+	 * the connection is closed, so a runaway client must not
+	 * be able to register them without a limit.
+	 */
+	IPROTO_WATCHER_MAX = 1024,
+};
+
+/**
+ * A registered interest in changes of a space, optionally
+ * narrowed down to tuples matching a key in one of the space
+ * indexes. The watcher fires from the space on_replace trigger
+ * list in the tx thread, writes an IPROTO_EVENT packet into the
+ * connection output buffer and relies on the push machinery
+ * (see Kharon) to get it flushed. While a flush is in flight new
+ * matches only mark the watcher dirty: when Kharon returns, a
+ * single coalesced event without a key is sent instead of an
+ * event per statement, so the event traffic is bounded by the
+ * client read speed no matter how fast the space changes.
+ */
+struct iproto_watcher {
+	/** The trigger in the watched space on_replace list. */
+	struct trigger on_replace;
+	/** Connection the watcher belongs to. */
+	struct iproto_connection *con;
+	/** Sync of the IPROTO_WATCH request, tags the events. */
+	uint64_t sync;
+	/** Watched space id. */
+	uint32_t space_id;
+	/** Index of the key filter. Unused when key is NULL. */
+	uint32_t index_id;
+	/** Part count of the key filter. */
+	uint32_t part_count;
+	/** Size of the key filter, bytes. */
+	uint32_t key_size;
+	/**
+	 * Malloced msgpack array with the key filter parts, or
+	 * NULL when any change of the space matches.
+	 */
+	char *key;
+	/** An event is written out and not yet flushed. */
+	bool is_pending;
+	/** A match arrived while an event was in flight. */
+	bool is_dirty;
+	/** Link in iproto_connection::tx::watchers. */
+	struct rlist in_connection;
+};
+
+/**
+ * Write an IPROTO_EVENT packet into the connection output buffer
+ * and make sure Kharon is on its way. @a tuple provides the
+ * primary key of the event, NULL means a coalesced event without
+ * a key. Failure to notify is not an error of the statement
+ * which caused the event - the event is simply dropped.
+ */
+static void
+iproto_watcher_send(struct iproto_watcher *w, struct space *space,
+		    struct tuple *tuple)
+{
+	struct iproto_connection *con = w->con;
+	const char *key = NULL;
+	const char *key_end = NULL;
+	if (tuple != NULL) {
+		struct index *pk = space_index(space, 0);
+		if (pk != NULL) {
+			uint32_t key_size;
+			key = tuple_extract_key(tuple, pk->def->key_def,
+						MULTIKEY_NONE, &key_size);
+			if (key != NULL)
+				key_end = key + key_size;
+		}
+	}
+	if (iproto_reply_event(con->tx.p_obuf, w->sync, ::schema_version,
+			       w->space_id, key, key_end) != 0) {
+		diag_log();
+		diag_clear(&fiber()->diag);
+		return;
+	}
+	w->is_pending = true;
+	if (! con->tx.is_push_sent)
+		tx_begin_push(con);
+	else
+		con->tx.is_push_pending = true;
+}
+
+/**
+ * on_replace trigger of a watched space. Runs before the
+ * statement is committed, so a change which is rolled back later
+ * may still produce an event: an event is a hint to re-read, not
+ * a replication stream, and a spurious hint is harmless.
+ */
+static int
+iproto_watcher_fire(struct trigger *trigger, void *event)
+{
+	struct iproto_watcher *w = (struct iproto_watcher *) trigger->data;
+	struct txn *txn = (struct txn *) event;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	if (w->con->tx.is_disconnected)
+		return 0;
+	struct tuple *tuple = stmt->new_tuple != NULL ?
+			      stmt->new_tuple : stmt->old_tuple;
+	if (tuple == NULL)
+		return 0;
+	if (w->key != NULL) {
+		struct index *index = space_index(stmt->space, w->index_id);
+		/*
+		 * The index could be dropped or shrunk after the
+		 * watcher was registered. Go silent rather than
+		 * compare against a different key definition.
+		 */
+		if (index == NULL ||
+		    w->part_count > index->def->key_def->part_count)
+			return 0;
+		const char *key = w->key;
+		mp_decode_array(&key);
+		if (tuple_compare_with_key(tuple, HINT_NONE, key,
+					   w->part_count, HINT_NONE,
+					   index->def->key_def) != 0)
+			return 0;
+	}
+	if (w->is_pending) {
+		w->is_dirty = true;
+		return 0;
+	}
+	iproto_watcher_send(w, stmt->space, tuple);
+	return 0;
+}
+
+/**
+ * Register a watcher described by an IPROTO_WATCH request.
+ * Watching a space requires the same read access as reading it.
+ */
+static void
+tx_process_watch(struct iproto_connection *con, struct iproto_msg *msg)
+{
+	const struct watch_request *request = &msg->watch;
+	struct space *space = space_cache_find_xc(request->space_id);
+	access_check_space_xc(space, PRIV_R);
+	uint32_t part_count = 0;
+	if (request->key != NULL) {
+		struct index *index = index_find_xc(space, request->index_id);
+		const char *key = request->key;
+		part_count = mp_decode_array(&key);
+		if (key_validate(index->def, ITER_GE, key, part_count) != 0)
+			diag_raise();
+	}
+	int count = 0;
+	struct iproto_watcher *w;
+	rlist_foreach_entry(w, &con->tx.watchers, in_connection)
+		count++;
+	if (count >= IPROTO_WATCHER_MAX) {
+		tnt_raise(ClientError, ER_WATCHER_LIMIT,
+			  (unsigned) IPROTO_WATCHER_MAX);
+	}
+	w = (struct iproto_watcher *) malloc(sizeof(*w));
+	if (w == NULL)
+		tnt_raise(OutOfMemory, sizeof(*w), "malloc", "watcher");
+	char *key_copy = NULL;
+	uint32_t key_size = 0;
+	if (request->key != NULL) {
+		key_size = request->key_end - request->key;
+		key_copy = (char *) malloc(key_size);
+		if (key_copy == NULL) {
+			free(w);
+			tnt_raise(OutOfMemory, key_size, "malloc",
+				  "watcher key");
+		}
+		memcpy(key_copy, request->key, key_size);
+	}
+	w->con = con;
+	w->sync = msg->header.sync;
+	w->space_id = request->space_id;
+	w->index_id = request->index_id;
+	w->part_count = part_count;
+	w->key_size = key_size;
+	w->key = key_copy;
+	w->is_pending = false;
+	w->is_dirty = false;
+	/*
+	 * No destroy callback: when the space is dropped,
+	 * trigger_destroy() removes the trigger from the list and
+	 * the watcher silently stops firing. It is freed with the
+	 * connection. An alter keeps the watcher alive - triggers
+	 * are moved to the new space, see space_swap_triggers().
+	 */
+	trigger_create(&w->on_replace, iproto_watcher_fire, w, NULL);
+	trigger_add(&space->on_replace, &w->on_replace);
+	rlist_add_entry(&con->tx.watchers, w, in_connection);
+}
+
+/**
+ * Drop the connection watchers matching an IPROTO_UNWATCH
+ * request: the same space and, when the request carries a key,
+ * the same index and the same key bytes. A request without a key
+ * drops all watchers of the space.
+ */
+static void
+tx_process_unwatch(struct iproto_connection *con,
+		   const struct watch_request *request)
+{
+	struct iproto_watcher *w, *tmp;
+	rlist_foreach_entry_safe(w, &con->tx.watchers, in_connection, tmp) {
+		if (w->space_id != request->space_id)
+			continue;
+		if (request->key != NULL) {
+			uint32_t key_size = request->key_end - request->key;
+			if (w->key == NULL ||
+			    w->index_id != request->index_id ||
+			    w->key_size != key_size ||
+			    memcmp(w->key, request->key, key_size) != 0)
+				continue;
+		}
+		trigger_clear(&w->on_replace);
+		rlist_del_entry(w, in_connection);
+		free(w->key);
+		free(w);
+	}
+}
+
+/**
+ * Resolve in-flight events on Kharon return: a pending event has
+ * left for the network thread, and a watcher which matched again
+ * meanwhile gets one coalesced event without a key - the client
+ * re-reads whatever it is interested in.
+ */
+static void
+tx_watchers_end_push(struct iproto_connection *con)
+{
+	struct iproto_watcher *w;
+	rlist_foreach_entry(w, &con->tx.watchers, in_connection) {
+		if (! w->is_pending)
+			continue;
+		w->is_pending = false;
+		if (w->is_dirty) {
+			w->is_dirty = false;
+			iproto_watcher_send(w, NULL, NULL);
+		}
+	}
+}
+
+static void
+tx_delete_watchers(struct iproto_connection *con)
+{
+	struct iproto_watcher *w, *tmp;
+	rlist_foreach_entry_safe(w, &con->tx.watchers, in_connection, tmp) {
+		trigger_clear(&w->on_replace);
+		free(w->key);
+		free(w);
+	}
+	rlist_create(&con->tx.watchers);
+}
+
+/* }}} */
+
 static void
 tx_process_misc(struct cmsg *m)
 {
@@ -1695,11 +3378,33 @@ tx_process_misc(struct cmsg *m)
 	try {
 		struct ballot ballot;
 		switch (msg->header.type) {
-		case IPROTO_AUTH:
-			box_process_auth(&msg->auth, con->salt);
-			iproto_reply_ok_xc(out, msg->header.sync,
-					   ::schema_version);
+		case IPROTO_AUTH: {
+			if (msg->auth_precheck != AUTH_PRECHECK_NONE)
+				box_process_auth_cached(&msg->auth,
+							msg->auth_precheck);
+			else
+				box_process_auth(&msg->auth, con->salt);
+			/*
+			 * Issue a fresh resumption ticket so that
+			 * the client can skip the full handshake
+			 * on reconnect. Best effort: if a ticket
+			 * can not be issued, reply without one.
+			 */
+			char ticket[AUTH_TICKET_MAX_SIZE];
+			int ticket_size =
+				authenticate_ticket_issue(msg->auth.user_name,
+							  ticket,
+							  sizeof(ticket));
+			if (ticket_size > 0)
+				iproto_reply_auth_xc(out, ticket, ticket_size,
+						     msg->header.sync,
+						     ::schema_version);
+			else
+				iproto_reply_ok_xc(out, msg->header.sync,
+						   ::schema_version);
+			tx_auth_publish(msg);
 			break;
+		}
 		case IPROTO_PING:
 			iproto_reply_ok_xc(out, msg->header.sync,
 					   ::schema_version);
@@ -1714,6 +3419,22 @@ tx_process_misc(struct cmsg *m)
 			iproto_reply_vote_xc(out, &ballot, msg->header.sync,
 					     ::schema_version);
 			break;
+		case IPROTO_COMPRESSION:
+			tx_check_compression(msg);
+			iproto_reply_ok_xc(out, msg->header.sync,
+					   ::schema_version);
+			msg->compression_accepted = true;
+			break;
+		case IPROTO_WATCH:
+			tx_process_watch(con, msg);
+			iproto_reply_ok_xc(out, msg->header.sync,
+					   ::schema_version);
+			break;
+		case IPROTO_UNWATCH:
+			tx_process_unwatch(con, &msg->watch);
+			iproto_reply_ok_xc(out, msg->header.sync,
+					   ::schema_version);
+			break;
 		default:
 			unreachable();
 		}
@@ -1768,8 +3489,17 @@ tx_process_sql(struct cmsg *m)
 			assert(msg->sql.stmt_id != NULL);
 			sql = msg->sql.stmt_id;
 			uint32_t stmt_id = mp_decode_uint(&sql);
+			uint64_t metadata_version = 0;
+			const uint64_t *known_version = NULL;
+			if (msg->sql.metadata_version != NULL &&
+			    mp_typeof(*msg->sql.metadata_version) == MP_UINT) {
+				const char *mv = msg->sql.metadata_version;
+				metadata_version = mp_decode_uint(&mv);
+				known_version = &metadata_version;
+			}
 			if (sql_execute_prepared(stmt_id, bind, bind_count,
-						 &port, &fiber()->gc) != 0)
+						 known_version, &port,
+						 &fiber()->gc) != 0)
 				goto error;
 		}
 	} else {
@@ -1871,6 +3601,14 @@ net_send_msg(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct iproto_connection *con = msg->connection;
 
+	if (msg->start_time != 0 &&
+	    msg->header.type < IPROTO_TYPE_STAT_MAX) {
+		latency_collect(&con->iproto_thread->latency[msg->header.type],
+				ev_monotonic_now(con->loop) -
+				msg->start_time);
+	}
+	if (msg->deferred)
+		rmean_collect(con->iproto_thread->rmean, IPROTO_DEFERRED, 1);
 	if (msg->len != 0) {
 		/* Discard request (see iproto_enqueue_batch()). */
 		msg->p_ibuf->rpos += msg->len;
@@ -1880,6 +3618,37 @@ net_send_msg(struct cmsg *m)
 		con->long_poll_count--;
 	}
 	con->wend = msg->wpos;
+	/* Queue the zero-copy payloads of the response, if any. */
+	if (! stailq_empty(&msg->zdata)) {
+		stailq_concat(&con->zdata[msg->wpos.obuf == &con->obuf[1]],
+			      &msg->zdata);
+	}
+	if (msg->compression_accepted && con->zstream == NULL) {
+		con->zstream = ZSTD_createCStream();
+		if (con->zstream == NULL) {
+			say_error("iproto: can not create a compression "
+				  "context, closing connection %s",
+				  sio_socketname(con->output.fd));
+			iproto_connection_close(con);
+		} else {
+			ZSTD_initCStream(con->zstream, IPROTO_ZSTD_LEVEL);
+			ibuf_create(&con->zbuf, cord_slab_cache(),
+				    iproto_readahead);
+			/*
+			 * The acknowledge reply ends at the fresh
+			 * wend; it and everything before it go out
+			 * plain, the rest of the stream compressed.
+			 */
+			con->compress_activation = con->wend;
+			con->compress_active = false;
+		}
+	}
+	if (msg->auth_publish) {
+		const char *name = msg->auth.user_name;
+		uint32_t name_len = mp_decode_strl(&name);
+		iproto_auth_cache_put(con->iproto_thread, name, name_len,
+				      msg->auth_hash2);
+	}
 
 	if (evio_has_fd(&con->output)) {
 		if (! ev_is_active(&con->output))
@@ -1887,7 +3656,7 @@ net_send_msg(struct cmsg *m)
 	} else if (iproto_connection_is_idle(con)) {
 		iproto_connection_close(con);
 	}
-	iproto_msg_delete(msg);
+	iproto_msg_delete(con->iproto_thread, msg);
 }
 
 /**
@@ -1910,7 +3679,7 @@ net_end_join(struct cmsg *m)
 	struct iproto_connection *con = msg->connection;
 
 	msg->p_ibuf->rpos += msg->len;
-	iproto_msg_delete(msg);
+	iproto_msg_delete(con->iproto_thread, msg);
 
 	assert(! ev_is_active(&con->input));
 	/*
@@ -1928,7 +3697,7 @@ net_end_subscribe(struct cmsg *m)
 	struct iproto_connection *con = msg->connection;
 
 	msg->p_ibuf->rpos += msg->len;
-	iproto_msg_delete(msg);
+	iproto_msg_delete(con->iproto_thread, msg);
 
 	assert(! ev_is_active(&con->input));
 
@@ -1986,13 +3755,14 @@ net_send_greeting(struct cmsg *m)
 
 		if (nwr > 0) {
 			/* Count statistics. */
-			rmean_collect(rmean_net, IPROTO_SENT, nwr);
+			rmean_collect(con->iproto_thread->rmean,
+				      IPROTO_SENT, nwr);
 		} else if (nwr < 0 && ! sio_wouldblock(errno)) {
 			diag_log();
 		}
 		assert(iproto_connection_is_idle(con));
 		iproto_connection_close(con);
-		iproto_msg_delete(msg);
+		iproto_msg_delete(con->iproto_thread, msg);
 		return;
 	}
 	con->wend = msg->wpos;
@@ -2004,27 +3774,25 @@ net_send_greeting(struct cmsg *m)
 	assert(evio_has_fd(&con->output));
 	/* Handshake OK, start reading input. */
 	ev_feed_event(con->loop, &con->output, EV_WRITE);
-	iproto_msg_delete(msg);
+	iproto_msg_delete(con->iproto_thread, msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
 /**
  * Create a connection and start input.
  */
 static int
-iproto_on_accept(struct evio_service * /* service */, int fd,
+iproto_on_accept(struct evio_service *service, int fd,
 		 struct sockaddr *addr, socklen_t addrlen)
 {
 	(void) addr;
 	(void) addrlen;
+	struct iproto_thread *iproto_thread =
+		(struct iproto_thread *) service->on_accept_param;
 	struct iproto_msg *msg;
-	struct iproto_connection *con = iproto_connection_new(fd);
+	struct iproto_connection *con =
+		iproto_connection_new(iproto_thread, fd);
 	if (con == NULL)
 		return -1;
 	/*
@@ -2034,62 +3802,80 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 	 */
 	msg = iproto_msg_new(con);
 	if (msg == NULL) {
-		mempool_free(&iproto_connection_pool, con);
+		mempool_free(&iproto_thread->iproto_connection_pool, con);
 		return -1;
 	}
-	cmsg_init(&msg->base, connect_route);
+	cmsg_init(&msg->base, iproto_thread->connect_route);
 	msg->p_ibuf = con->p_ibuf;
 	msg->wpos = con->wpos;
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, &msg->base);
+	cpipe_push(&iproto_thread->tx_pipe, &msg->base);
 	return 0;
 }
 
-static struct evio_service binary; /* iproto binary listener */
-
 /**
  * The network io thread main function:
  * begin serving the message bus.
  */
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
-	mempool_create(&iproto_msg_pool, &cord()->slabc,
+	struct iproto_thread *iproto_thread =
+		va_arg(ap, struct iproto_thread *);
+
+	mempool_create(&iproto_thread->iproto_msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
-	mempool_create(&iproto_connection_pool, &cord()->slabc,
+	mempool_create(&iproto_thread->iproto_connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
 
-	evio_service_init(loop(), &binary, "binary",
-			  iproto_on_accept, NULL);
+	evio_service_init(loop(), &iproto_thread->binary, "binary",
+			  iproto_on_accept, iproto_thread);
 
 
 	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	iproto_thread->rmean = rmean_new(rmean_net_strings, IPROTO_LAST);
 
-	if (rmean_net == NULL) {
+	if (iproto_thread->rmean == NULL) {
 		tnt_raise(OutOfMemory, sizeof(struct rmean),
 			  "rmean", "struct rmean");
 	}
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		if (latency_create(&iproto_thread->latency[i]) != 0) {
+			tnt_raise(OutOfMemory, sizeof(struct histogram),
+				  "histogram", "struct latency");
+		}
+	}
+
+	char endpoint_name[FIBER_NAME_MAX];
+	snprintf(endpoint_name, sizeof(endpoint_name), "net%u",
+		 iproto_thread->id);
 
 	struct cbus_endpoint endpoint;
 	/* Create "net" endpoint. */
-	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
+	cbus_endpoint_create(&endpoint, endpoint_name,
+			     fiber_schedule_cb, fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
-	cpipe_set_max_input(&tx_pipe, iproto_msg_max / 2);
+	cpipe_create(&iproto_thread->tx_pipe, "tx");
+	cpipe_set_max_input(&iproto_thread->tx_pipe, iproto_msg_max / 2);
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
 
-	cpipe_destroy(&tx_pipe);
+	cpipe_destroy(&iproto_thread->tx_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
+	if (evio_service_is_active(&iproto_thread->binary)) {
+		if (iproto_thread->id == 0)
+			evio_service_stop(&iproto_thread->binary);
+		else
+			evio_service_detach(&iproto_thread->binary);
+	}
 
-	rmean_delete(rmean_net);
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++)
+		latency_destroy(&iproto_thread->latency[i]);
+	rmean_delete(iproto_thread->rmean);
 	return 0;
 }
 
@@ -2111,6 +3897,18 @@ iproto_session_sync(struct session *session)
 
 /** {{{ IPROTO_PUSH implementation. */
 
+enum {
+	/**
+	 * A push waits for the network thread to drain the
+	 * output when this many bytes are waiting to be flushed
+	 * to the socket. This bounds the memory of a stored
+	 * procedure streaming its result faster than the client
+	 * reads it. A single push may overshoot the limit by its
+	 * own size.
+	 */
+	IPROTO_PUSH_OUTPUT_MAX = 1024 * 1024,
+};
+
 static void
 iproto_process_push(struct cmsg *m)
 {
@@ -2131,11 +3929,11 @@ static void
 tx_begin_push(struct iproto_connection *con)
 {
 	assert(! con->tx.is_push_sent);
-	cmsg_init(&con->kharon.base, push_route);
+	cmsg_init(&con->kharon.base, con->iproto_thread->push_route);
 	iproto_wpos_create(&con->kharon.wpos, con->tx.p_obuf);
 	con->tx.is_push_pending = false;
 	con->tx.is_push_sent = true;
-	cpipe_push(&net_pipe, (struct cmsg *) &con->kharon);
+	cpipe_push(&con->iproto_thread->net_pipe, (struct cmsg *) &con->kharon);
 }
 
 static void
@@ -2146,6 +3944,8 @@ tx_end_push(struct cmsg *m)
 		container_of(kharon, struct iproto_connection, kharon);
 	tx_accept_wpos(con, &kharon->wpos);
 	con->tx.is_push_sent = false;
+	tx_watchers_end_push(con);
+	fiber_cond_broadcast(&con->tx.push_cond);
 	if (con->tx.is_push_pending)
 		tx_begin_push(con);
 }
@@ -2156,16 +3956,37 @@ tx_end_push(struct cmsg *m)
  * @param sync Request sync in scope of which to send the push.
  * @param port Port with data to send.
  *
- * @retval -1 Memory error.
+ * @retval -1 Memory error or the fiber is cancelled.
  * @retval  0 Success, a message is written to the output buffer.
  *            We don't wait here that the push has reached the
  *            client: the output buffer is flushed asynchronously.
+ *            However, when more than IPROTO_PUSH_OUTPUT_MAX
+ *            bytes are waiting to be flushed, the push blocks
+ *            until the network thread reports progress, so a
+ *            stream of pushes can not grow the output buffers
+ *            without a limit.
  */
 static int
 iproto_session_push(struct session *session, uint64_t sync, struct port *port)
 {
 	struct iproto_connection *con =
 		(struct iproto_connection *) session->meta.connection;
+	while (obuf_size(&con->obuf[0]) + obuf_size(&con->obuf[1]) >
+	       IPROTO_PUSH_OUTPUT_MAX && !con->tx.is_disconnected) {
+		/*
+		 * Make sure Kharon is travelling: each of its
+		 * trips brings a fresh flush position back to
+		 * tx, which is the only way to learn that the
+		 * output has drained.
+		 */
+		if (! con->tx.is_push_sent)
+			tx_begin_push(con);
+		fiber_cond_wait(&con->tx.push_cond);
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+	}
 	struct obuf_svp svp;
 	if (iproto_prepare_select(con->tx.p_obuf, &svp) != 0)
 		return -1;
@@ -2183,18 +4004,52 @@ iproto_session_push(struct session *session, uint64_t sync, struct port *port)
 
 /** }}} */
 
-/** Initialize the iproto subsystem and start network io thread */
+/**
+ * Initialize the iproto subsystem and start the network thread
+ * pool.
+ */
 void
-iproto_init()
+iproto_init(int threads_count)
 {
 	slab_cache_create(&net_slabc, &runtime);
+	region_profile_create(&iproto_region_profile, "iproto_msg",
+			      IPROTO_REGION_PERCENTILE,
+			      IPROTO_REGION_RESERVE_MAX);
+	/* Zero-copy payload entries live in the tx thread. */
+	mempool_create(&iproto_zdata_pool, &cord()->slabc,
+		       sizeof(struct iproto_zdata));
+
+	assert(threads_count >= 1 && threads_count <= IPROTO_THREADS_MAX);
+	iproto_threads_count = threads_count;
+	iproto_threads = (struct iproto_thread *)
+		calloc(threads_count, sizeof(struct iproto_thread));
+	if (iproto_threads == NULL) {
+		panic("failed to allocate %d iproto threads",
+		      threads_count);
+	}
+
+	for (int i = 0; i < threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		iproto_thread->id = i;
+		rlist_create(&iproto_thread->stopped_connections);
+		rlist_create(&iproto_thread->auth_cache);
+		iproto_thread_init_routes(iproto_thread);
+		if (cord_costart(&iproto_thread->net_cord, "iproto",
+				 net_cord_f, iproto_thread))
+			panic("failed to initialize iproto thread");
+		/* Create a pipe to the "net" thread. */
+		char endpoint_name[FIBER_NAME_MAX];
+		snprintf(endpoint_name, sizeof(endpoint_name), "net%u",
+			 iproto_thread->id);
+		cpipe_create(&iproto_thread->net_pipe, endpoint_name);
+		cpipe_set_max_input(&iproto_thread->net_pipe,
+				    iproto_msg_max / 2);
+	}
 
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
-		panic("failed to initialize iproto thread");
+	trigger_create(&iproto_user_cache_change_trigger,
+		       tx_on_user_cache_change, NULL, NULL);
+	trigger_add(&user_cache_on_change, &iproto_user_cache_change_trigger);
 
-	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
-	cpipe_set_max_input(&net_pipe, iproto_msg_max / 2);
 	struct session_vtab iproto_session_vtab = {
 		/* .push = */ iproto_session_push,
 		/* .fd = */ iproto_session_fd,
@@ -2223,6 +4078,12 @@ struct iproto_cfg_msg: public cbus_call_msg
 		struct {
 			/** New URI to bind to. */
 			const char *uri;
+			/**
+			 * The thread which owns the listening
+			 * address. All other threads attach to
+			 * its acceptor socket.
+			 */
+			const struct evio_service *master;
 			/** Result address. */
 			struct sockaddr_storage addr;
 			/** Address length. */
@@ -2232,6 +4093,8 @@ struct iproto_cfg_msg: public cbus_call_msg
 		/** New iproto max message count. */
 		int iproto_msg_max;
 	};
+	/** The thread the message is for. */
+	struct iproto_thread *iproto_thread;
 };
 
 static inline void
@@ -2245,26 +4108,38 @@ static int
 iproto_do_cfg_f(struct cbus_call_msg *m)
 {
 	struct iproto_cfg_msg *cfg_msg = (struct iproto_cfg_msg *) m;
+	struct iproto_thread *iproto_thread = cfg_msg->iproto_thread;
+	struct evio_service *binary = &iproto_thread->binary;
 	int old;
 	try {
 		switch (cfg_msg->op) {
 		case IPROTO_CFG_MSG_MAX:
-			cpipe_set_max_input(&tx_pipe,
+			cpipe_set_max_input(&iproto_thread->tx_pipe,
 					    cfg_msg->iproto_msg_max / 2);
 			old = iproto_msg_max;
 			iproto_msg_max = cfg_msg->iproto_msg_max;
 			if (old < iproto_msg_max)
-				iproto_resume();
+				iproto_resume(iproto_thread);
 			break;
 		case IPROTO_CFG_LISTEN:
-			if (evio_service_is_active(&binary))
-				evio_service_stop(&binary);
-			if (cfg_msg->uri != NULL &&
-			    (evio_service_bind(&binary, cfg_msg->uri) != 0 ||
-			     evio_service_listen(&binary) != 0))
-				diag_raise();
-			cfg_msg->addrlen = binary.addr_len;
-			cfg_msg->addr = binary.addrstorage;
+			if (evio_service_is_active(binary)) {
+				if (iproto_thread->id == 0)
+					evio_service_stop(binary);
+				else
+					evio_service_detach(binary);
+			}
+			if (cfg_msg->uri != NULL) {
+				if (cfg_msg->master != NULL) {
+					evio_service_attach(binary,
+							    cfg_msg->master);
+				} else if (evio_service_bind(binary,
+							     cfg_msg->uri) != 0 ||
+					   evio_service_listen(binary) != 0) {
+					diag_raise();
+				}
+			}
+			cfg_msg->addrlen = binary->addr_len;
+			cfg_msg->addr = binary->addrstorage;
 			break;
 		default:
 			unreachable();
@@ -2276,10 +4151,11 @@ iproto_do_cfg_f(struct cbus_call_msg *m)
 }
 
 static inline void
-iproto_do_cfg(struct iproto_cfg_msg *msg)
+iproto_do_cfg(struct iproto_thread *iproto_thread, struct iproto_cfg_msg *msg)
 {
-	if (cbus_call(&net_pipe, &tx_pipe, msg, iproto_do_cfg_f,
-		      NULL, TIMEOUT_INFINITY) != 0)
+	msg->iproto_thread = iproto_thread;
+	if (cbus_call(&iproto_thread->net_pipe, &iproto_thread->tx_pipe, msg,
+		      iproto_do_cfg_f, NULL, TIMEOUT_INFINITY) != 0)
 		diag_raise();
 }
 
@@ -2287,35 +4163,128 @@ void
 iproto_listen(const char *uri)
 {
 	struct iproto_cfg_msg cfg_msg;
-	iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_LISTEN);
-	cfg_msg.uri = uri;
-	iproto_do_cfg(&cfg_msg);
-	iproto_bound_address_storage = cfg_msg.addr;
-	iproto_bound_address_len = cfg_msg.addrlen;
+	/*
+	 * Thread 0 binds and listens first; the others attach to
+	 * its acceptor socket, so connections are distributed by
+	 * the kernel across all event loops of the pool.
+	 */
+	for (int i = 0; i < iproto_threads_count; i++) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_LISTEN);
+		cfg_msg.uri = uri;
+		cfg_msg.master = i > 0 ? &iproto_threads[0].binary : NULL;
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+		if (i == 0) {
+			iproto_bound_address_storage = cfg_msg.addr;
+			iproto_bound_address_len = cfg_msg.addrlen;
+		}
+	}
 }
 
 size_t
 iproto_mem_used(void)
 {
-	return slab_cache_used(&net_cord.slabc) + slab_cache_used(&net_slabc);
+	size_t size = slab_cache_used(&net_slabc);
+	for (int i = 0; i < iproto_threads_count; i++)
+		size += slab_cache_used(&iproto_threads[i].net_cord.slabc);
+	return size;
 }
 
 size_t
 iproto_connection_count(void)
 {
-	return mempool_count(&iproto_connection_pool);
+	size_t count = 0;
+	for (int i = 0; i < iproto_threads_count; i++)
+		count += mempool_count(&iproto_threads[i].
+				       iproto_connection_pool);
+	return count;
 }
 
 size_t
 iproto_request_count(void)
 {
-	return mempool_count(&iproto_msg_pool);
+	size_t count = 0;
+	for (int i = 0; i < iproto_threads_count; i++)
+		count += mempool_count(&iproto_threads[i].iproto_msg_pool);
+	return count;
+}
+
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx)
+{
+	for (size_t i = 0; i < IPROTO_LAST; i++) {
+		int64_t mean = 0;
+		int64_t total = 0;
+		for (int j = 0; j < iproto_threads_count; j++) {
+			mean += rmean_mean(iproto_threads[j].rmean, i);
+			total += rmean_total(iproto_threads[j].rmean, i);
+		}
+		int rc = cb(rmean_net_strings[i], mean, total, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+int
+iproto_latency_foreach(iproto_latency_cb cb, void *cb_ctx)
+{
+	struct latency merged;
+	if (latency_create(&merged) != 0)
+		return -1;
+	int rc = 0;
+	for (uint32_t type = 0;
+	     type < IPROTO_TYPE_STAT_MAX && rc == 0; type++) {
+		if (iproto_type_strs[type] == NULL)
+			continue;
+		latency_reset(&merged);
+		struct histogram *dst = merged.histogram;
+		for (int i = 0; i < iproto_threads_count; i++) {
+			struct histogram *src =
+				iproto_threads[i].latency[type].histogram;
+			assert(src->n_buckets == dst->n_buckets);
+			/*
+			 * Same dirty read from the network
+			 * threads as iproto_rmean_foreach()
+			 * does with rmean.
+			 */
+			for (size_t b = 0; b < dst->n_buckets; b++)
+				dst->buckets[b].count += src->buckets[b].count;
+			dst->total += src->total;
+			if (src->max > dst->max)
+				dst->max = src->max;
+		}
+		rc = cb(iproto_type_strs[type], &merged, cb_ctx);
+	}
+	latency_destroy(&merged);
+	return rc;
+}
+
+void
+iproto_pipe_stat(struct cpipe_stat *tx_stat, struct cpipe_stat *net_stat)
+{
+	memset(tx_stat, 0, sizeof(*tx_stat));
+	memset(net_stat, 0, sizeof(*net_stat));
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct cpipe_stat stat;
+		cpipe_stat(&iproto_threads[i].tx_pipe, &stat);
+		tx_stat->flushes += stat.flushes;
+		tx_stat->messages += stat.messages;
+		tx_stat->wakeups += stat.wakeups;
+		cpipe_stat(&iproto_threads[i].net_pipe, &stat);
+		net_stat->flushes += stat.flushes;
+		net_stat->messages += stat.messages;
+		net_stat->wakeups += stat.wakeups;
+	}
 }
 
 void
 iproto_reset_stat(void)
 {
-	rmean_cleanup(rmean_net);
+	for (int i = 0; i < iproto_threads_count; i++) {
+		rmean_cleanup(iproto_threads[i].rmean);
+		for (int j = 0; j < IPROTO_TYPE_STAT_MAX; j++)
+			latency_reset(&iproto_threads[i].latency[j]);
+	}
 }
 
 void
@@ -2327,22 +4296,40 @@ iproto_set_msg_max(int new_iproto_msg_max)
 				     IPROTO_MSG_MAX_MIN));
 	}
 	struct iproto_cfg_msg cfg_msg;
-	iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_MSG_MAX);
-	cfg_msg.iproto_msg_max = new_iproto_msg_max;
-	iproto_do_cfg(&cfg_msg);
-	cpipe_set_max_input(&net_pipe, new_iproto_msg_max / 2);
+	for (int i = 0; i < iproto_threads_count; i++) {
+		iproto_cfg_msg_create(&cfg_msg, IPROTO_CFG_MSG_MAX);
+		cfg_msg.iproto_msg_max = new_iproto_msg_max;
+		iproto_do_cfg(&iproto_threads[i], &cfg_msg);
+		cpipe_set_max_input(&iproto_threads[i].net_pipe,
+				    new_iproto_msg_max / 2);
+	}
+}
+
+void
+iproto_set_defer_latency(double latency)
+{
+	if (latency < 0) {
+		tnt_raise(ClientError, ER_CFG, "net_defer_latency",
+			  "the value must be >= 0");
+	}
+	/* Used by the tx thread only, no need to notify the net ones. */
+	iproto_defer_latency = latency;
 }
 
 void
 iproto_free()
 {
-	tt_pthread_cancel(net_cord.id);
-	tt_pthread_join(net_cord.id, NULL);
-	/*
-	* Close socket descriptor to prevent hot standby instance
-	* failing to bind in case it tries to bind before socket
-	* is closed by OS.
-	*/
-	if (evio_service_is_active(&binary))
-		close(binary.ev.fd);
+	for (int i = 0; i < iproto_threads_count; i++) {
+		struct iproto_thread *iproto_thread = &iproto_threads[i];
+		tt_pthread_cancel(iproto_thread->net_cord.id);
+		tt_pthread_join(iproto_thread->net_cord.id, NULL);
+		/*
+		* Close socket descriptor to prevent hot standby instance
+		* failing to bind in case it tries to bind before socket
+		* is closed by OS.
+		*/
+		if (evio_service_is_active(&iproto_thread->binary))
+			close(iproto_thread->binary.ev.fd);
+	}
+	free(iproto_threads);
 }
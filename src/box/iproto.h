@@ -33,6 +33,8 @@
 
 #include <stddef.h>
 
+#include "rmean.h"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -40,6 +42,8 @@ extern "C" {
 enum {
 	/** The minimal value for net_msg_max. */
 	IPROTO_MSG_MAX_MIN = 2,
+	/** The maximal allowed size of the iproto thread pool. */
+	IPROTO_THREADS_MAX = 1000,
 	/**
 	 * The size of tx fiber pool for iproto requests is
 	 * limited by the number of concurrent iproto messages,
@@ -80,6 +84,37 @@ iproto_request_count(void);
 void
 iproto_reset_stat(void);
 
+/**
+ * Walk the network statistics aggregated over all iproto
+ * threads. The callback contract is the same as in
+ * rmean_foreach().
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
+struct latency;
+
+typedef int (*iproto_latency_cb)(const char *name, struct latency *latency,
+				 void *cb_ctx);
+
+/**
+ * Walk the per request type latency histograms, merged over all
+ * iproto threads. The callback is invoked once per request type
+ * with a merged latency counter; a non-zero return code stops
+ * the iteration and is passed through to the caller.
+ */
+int
+iproto_latency_foreach(iproto_latency_cb cb, void *cb_ctx);
+
+struct cpipe_stat;
+
+/**
+ * Sum the delivery statistics of the tx-bound and net-bound
+ * cbus pipes over all iproto threads.
+ */
+void
+iproto_pipe_stat(struct cpipe_stat *tx_stat, struct cpipe_stat *net_stat);
+
 /**
  * String representation of the address served by
  * iproto. To be shown in box.info.
@@ -91,7 +126,7 @@ iproto_bound_address(void);
 } /* extern "C" */
 
 void
-iproto_init();
+iproto_init(int threads_count);
 
 void
 iproto_listen(const char *uri);
@@ -99,6 +134,9 @@ iproto_listen(const char *uri);
 void
 iproto_set_msg_max(int iproto_msg_max);
 
+void
+iproto_set_defer_latency(double latency);
+
 void
 iproto_free();
 
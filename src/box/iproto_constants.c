@@ -63,8 +63,9 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x15 */	MP_UINT, /* IPROTO_INDEX_BASE */
 	/* }}} */
 
+		/* 0x16 */	MP_DOUBLE, /* IPROTO_TIMEOUT */
+
 	/* {{{ unused */
-		/* 0x16 */	MP_UINT,
 		/* 0x17 */	MP_UINT,
 		/* 0x18 */	MP_UINT,
 		/* 0x19 */	MP_UINT,
@@ -152,7 +153,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"offset",           /* 0x13 */
 	"iterator",         /* 0x14 */
 	"index base",       /* 0x15 */
-	NULL,               /* 0x16 */
+	"timeout",          /* 0x16 */
 	NULL,               /* 0x17 */
 	NULL,               /* 0x18 */
 	NULL,               /* 0x19 */
@@ -198,6 +199,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"SQL bind",         /* 0x41 */
 	"SQL info",         /* 0x42 */
 	"stmt id",          /* 0x43 */
+	"metadata version", /* 0x44 */
 };
 
 const char *vy_page_info_key_strs[VY_PAGE_INFO_KEY_MAX] = {
@@ -226,3 +228,10 @@ const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
 	NULL,
 	"row index",
 };
+
+const char *vy_row_prefix_key_strs[VY_ROW_PREFIX_KEY_MAX] = {
+	NULL,
+	"type",
+	"prefix len",
+	"data",
+};
@@ -74,6 +74,13 @@ enum iproto_key {
 	IPROTO_OFFSET = 0x13,
 	IPROTO_ITERATOR = 0x14,
 	IPROTO_INDEX_BASE = 0x15,
+	/**
+	 * An optional relative timeout of a request, in seconds.
+	 * The server aborts an expired request with ER_TIMEOUT
+	 * instead of executing it to completion for a client
+	 * which has likely given up on it already.
+	 */
+	IPROTO_TIMEOUT = 0x16,
 
 	/* Leave a gap between integer values and other keys */
 	IPROTO_KEY = 0x20,
@@ -123,9 +130,36 @@ enum iproto_key {
 	 */
 	IPROTO_SQL_INFO = 0x42,
 	IPROTO_STMT_ID = 0x43,
+	/**
+	 * Version of the result set metadata of a prepared
+	 * statement. In an EXECUTE request: the version of the
+	 * metadata the client has cached for this statement id.
+	 * In a response: the version the returned rows were
+	 * produced with. When the client's version is up to
+	 * date, the full IPROTO_METADATA array is omitted from
+	 * the response. A response without this key always
+	 * carries full metadata.
+	 */
+	IPROTO_METADATA_VERSION = 0x44,
 	/* Leave a gap between SQL keys and additional request keys */
 	IPROTO_REPLICA_ANON = 0x50,
 	IPROTO_ID_FILTER = 0x51,
+	/** Compression algorithm name in a COMPRESSION request. */
+	IPROTO_COMPRESSION_ALGO = 0x52,
+	/**
+	 * A raw snapshot file transfer. In a JOIN request: a
+	 * boolean, the replica can accept a checkpoint file
+	 * instead of the row-by-row initial stream. In a JOIN
+	 * response: the number of raw file bytes that follow
+	 * the response packet on the wire.
+	 */
+	IPROTO_SNAP_FILE = 0x53,
+	/**
+	 * A session resumption ticket sent in an AUTH response.
+	 * A client may present it in place of a chap-sha1
+	 * scramble on reconnect to skip the full handshake.
+	 */
+	IPROTO_AUTH_TICKET = 0x54,
 	IPROTO_KEY_MAX
 };
 
@@ -156,7 +190,8 @@ enum iproto_ballot_key {
 			  bit(LSN) | bit(SCHEMA_VERSION))
 #define IPROTO_DML_BODY_BMAP (bit(SPACE_ID) | bit(INDEX_ID) | bit(LIMIT) |\
 			      bit(OFFSET) | bit(ITERATOR) | bit(INDEX_BASE) |\
-			      bit(KEY) | bit(TUPLE) | bit(OPS) | bit(TUPLE_META))
+			      bit(KEY) | bit(TUPLE) | bit(OPS) |\
+			      bit(TUPLE_META) | bit(VCLOCK) | bit(TIMEOUT))
 
 static inline bool
 xrow_header_has_key(const char *pos, const char *end)
@@ -232,6 +267,31 @@ enum iproto_type {
 	IPROTO_FETCH_SNAPSHOT = 69,
 	/** REGISTER request to leave anonymous replication. */
 	IPROTO_REGISTER = 70,
+	/**
+	 * Negotiate transparent compression of responses. Once
+	 * the request is acknowledged with IPROTO_OK, everything
+	 * the server sends after the acknowledge packet is a
+	 * single zstd stream. The request body is an optional
+	 * map { IPROTO_COMPRESSION_ALGO: "zstd" }.
+	 */
+	IPROTO_COMPRESSION = 71,
+	/**
+	 * Register a watcher: the server pushes an IPROTO_EVENT
+	 * packet tagged with this request's sync whenever a tuple
+	 * matching the watched space (and optional key prefix)
+	 * is replaced. The body is a map { IPROTO_SPACE_ID,
+	 * optional IPROTO_INDEX_ID, optional IPROTO_KEY }.
+	 */
+	IPROTO_WATCH = 72,
+	/** Remove watchers, same body as IPROTO_WATCH. */
+	IPROTO_UNWATCH = 73,
+	/**
+	 * A watcher notification pushed by the server out of
+	 * band, like IPROTO_CHUNK. The body is a map with
+	 * IPROTO_SPACE_ID and, unless notifications were
+	 * coalesced, the IPROTO_KEY of the changed tuple.
+	 */
+	IPROTO_EVENT = 74,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -239,6 +299,13 @@ enum iproto_type {
 	VY_INDEX_PAGE_INFO = 101,
 	/** Vinyl row index stored in .run file */
 	VY_RUN_ROW_INDEX = 102,
+	/**
+	 * Vinyl statement stored in .run file as a delta against
+	 * the first statement of its page: the common prefix of
+	 * the encoded bodies is stored as a length, only the
+	 * differing suffix is stored verbatim.
+	 */
+	VY_RUN_ROW_PREFIX = 103,
 
 	/** Non-final response type. */
 	IPROTO_CHUNK = 128,
@@ -276,6 +343,8 @@ iproto_type_name(uint32_t type)
 		return "PAGEINFO";
 	case VY_RUN_ROW_INDEX:
 		return "ROWINDEX";
+	case VY_RUN_ROW_PREFIX:
+		return "ROWPREFIX";
 	default:
 		return NULL;
 	}
@@ -467,6 +536,34 @@ vy_row_index_key_name(enum vy_row_index_key key)
 	return vy_row_index_key_strs[key];
 }
 
+/**
+ * Xrow keys for a prefix-compressed Vinyl statement.
+ * @sa VY_RUN_ROW_PREFIX.
+ */
+enum vy_row_prefix_key {
+	/** Type of the original statement row. */
+	VY_ROW_PREFIX_TYPE = 1,
+	/** Length of the prefix shared with the page anchor. */
+	VY_ROW_PREFIX_LEN = 2,
+	/** The rest of the statement body. */
+	VY_ROW_PREFIX_DATA = 3,
+	/** The last key in this enum + 1 */
+	VY_ROW_PREFIX_KEY_MAX
+};
+
+/**
+ * Return vy_row_prefix key name by @a key code.
+ * @param key key
+ */
+static inline const char *
+vy_row_prefix_key_name(enum vy_row_prefix_key key)
+{
+	if (key <= 0 || key >= VY_ROW_PREFIX_KEY_MAX)
+		return NULL;
+	extern const char *vy_row_prefix_key_strs[];
+	return vy_row_prefix_key_strs[key];
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif
@@ -88,8 +88,11 @@ static inline size_t
 key_def_copy_size(const struct key_def *def)
 {
 	size_t sz = 0;
-	for (uint32_t i = 0; i < def->part_count; i++)
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		sz += def->parts[i].path_token_count *
+		      sizeof(struct json_token);
 		sz += def->parts[i].path_len;
+	}
 	return key_def_sizeof(def->part_count, sz);
 }
 
@@ -104,13 +107,26 @@ key_def_copy_impl(struct key_def *res, const struct key_def *src, size_t sz)
 	memcpy(res, src, sz);
 	/*
 	 * Update the paths pointers so that they refer to the
-	 * JSON strings bytes in the new allocation.
+	 * JSON strings bytes in the new allocation. The same
+	 * goes for the compiled path tokens and the path bytes
+	 * their string tokens refer to.
 	 */
 	for (uint32_t i = 0; i < src->part_count; i++) {
 		if (src->parts[i].path == NULL)
 			continue;
 		size_t path_offset = src->parts[i].path - (char *)src;
 		res->parts[i].path = (char *)res + path_offset;
+		size_t tokens_offset = (char *)src->parts[i].path_tokens -
+				       (char *)src;
+		res->parts[i].path_tokens =
+			(struct json_token *)((char *)res + tokens_offset);
+		for (uint32_t j = 0; j < res->parts[i].path_token_count; j++) {
+			struct json_token *token =
+				&res->parts[i].path_tokens[j];
+			if (token->type != JSON_TOKEN_STR)
+				continue;
+			token->str = (char *)res + (token->str - (char *)src);
+		}
 	}
 	if (src->multikey_path != NULL) {
 		size_t path_offset = src->multikey_path - (char *)src;
@@ -156,12 +172,15 @@ key_def_set_func(struct key_def *def)
 
 static int
 key_def_set_part_path(struct key_def *def, uint32_t part_no, const char *path,
-		      uint32_t path_len, char **path_pool)
+		      uint32_t path_len, char **path_pool,
+		      struct json_token **token_pool)
 {
 	struct key_part *part = &def->parts[part_no];
 	if (path == NULL) {
 		part->path = NULL;
 		part->path_len = 0;
+		part->path_tokens = NULL;
+		part->path_token_count = 0;
 		return 0;
 	}
 	assert(path_pool != NULL);
@@ -170,6 +189,23 @@ key_def_set_part_path(struct key_def *def, uint32_t part_no, const char *path,
 	memcpy(part->path, path, path_len);
 	part->path_len = path_len;
 
+	/*
+	 * Compile the path into a flat token array so that hot
+	 * tuple field lookups do not have to run a JSON lexer.
+	 * The path has been validated by this point so the
+	 * compilation can't fail.
+	 */
+	int token_count = json_path_token_count(path, path_len,
+						TUPLE_INDEX_BASE);
+	assert(token_count >= 0);
+	assert(token_pool != NULL);
+	part->path_tokens = *token_pool;
+	part->path_token_count = token_count;
+	*token_pool += token_count;
+	if (json_path_compile(part->path, path_len, TUPLE_INDEX_BASE,
+			      part->path_tokens) != 0)
+		unreachable();
+
 	/*
 	 * Test whether this key_part has array index
 	 * placeholder [*] (i.e. is a part of multikey index
@@ -233,7 +269,8 @@ key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
 		 enum field_type type, enum on_conflict_action nullable_action,
 		 struct coll *coll, uint32_t coll_id,
 		 enum sort_order sort_order, const char *path,
-		 uint32_t path_len, char **path_pool, int32_t offset_slot,
+		 uint32_t path_len, char **path_pool,
+		 struct json_token **token_pool, int32_t offset_slot,
 		 uint64_t format_epoch)
 {
 	assert(part_no < def->part_count);
@@ -249,7 +286,8 @@ key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
 	def->parts[part_no].offset_slot_cache = offset_slot;
 	def->parts[part_no].format_epoch = format_epoch;
 	column_mask_set_fieldno(&def->column_mask, fieldno);
-	return key_def_set_part_path(def, part_no, path, path_len, path_pool);
+	return key_def_set_part_path(def, part_no, path, path_len, path_pool,
+				     token_pool);
 }
 
 struct key_def *
@@ -257,9 +295,19 @@ key_def_new(const struct key_part_def *parts, uint32_t part_count,
 	    bool for_func_index)
 {
 	size_t sz = 0;
-	for (uint32_t i = 0; i < part_count; i++)
-		sz += parts[i].path != NULL ? strlen(parts[i].path) : 0;
-	sz = key_def_sizeof(part_count, sz);
+	size_t token_pool_sz = 0;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (parts[i].path == NULL)
+			continue;
+		uint32_t path_len = strlen(parts[i].path);
+		sz += path_len;
+		int token_count = json_path_token_count(parts[i].path,
+							path_len,
+							TUPLE_INDEX_BASE);
+		assert(token_count >= 0);
+		token_pool_sz += token_count * sizeof(struct json_token);
+	}
+	sz = key_def_sizeof(part_count, sz + token_pool_sz);
 	struct key_def *def = calloc(1, sz);
 	if (def == NULL) {
 		diag_set(OutOfMemory, sz, "malloc", "struct key_def");
@@ -269,8 +317,15 @@ key_def_new(const struct key_part_def *parts, uint32_t part_count,
 	def->part_count = part_count;
 	def->unique_part_count = part_count;
 	def->for_func_index = for_func_index;
-	/* A pointer to the JSON paths data in the new key_def. */
-	char *path_pool = (char *)def + key_def_sizeof(part_count, 0);
+	/*
+	 * Pointers to the compiled JSON path tokens and the JSON
+	 * paths data in the new key_def. The token pool goes
+	 * first to keep the tokens properly aligned.
+	 */
+	struct json_token *token_pool =
+		(struct json_token *)((char *)def +
+				      key_def_sizeof(part_count, 0));
+	char *path_pool = (char *)token_pool + token_pool_sz;
 	for (uint32_t i = 0; i < part_count; i++) {
 		const struct key_part_def *part = &parts[i];
 		struct coll *coll = NULL;
@@ -287,8 +342,8 @@ key_def_new(const struct key_part_def *parts, uint32_t part_count,
 		if (key_def_set_part(def, i, part->fieldno, part->type,
 				     part->nullable_action, coll, part->coll_id,
 				     part->sort_order, part->path, path_len,
-				     &path_pool, TUPLE_OFFSET_SLOT_NIL,
-				     0) != 0)
+				     &path_pool, &token_pool,
+				     TUPLE_OFFSET_SLOT_NIL, 0) != 0)
 			goto error;
 	}
 	if (for_func_index) {
@@ -359,7 +414,7 @@ box_key_def_new(uint32_t *fields, uint32_t *types, uint32_t part_count)
 				     (enum field_type)types[item],
 				     ON_CONFLICT_ACTION_DEFAULT, NULL,
 				     COLL_NONE, SORT_ORDER_ASC, NULL, 0, NULL,
-				     TUPLE_OFFSET_SLOT_NIL, 0) != 0) {
+				     NULL, TUPLE_OFFSET_SLOT_NIL, 0) != 0) {
 			key_def_delete(key_def);
 			return NULL;
 		}
@@ -769,20 +824,27 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	 * twice since they are present in both key defs.
 	 */
 	size_t sz = 0;
+	size_t token_pool_sz = 0;
 	const struct key_part *part = first->parts;
 	const struct key_part *end = part + first->part_count;
-	for (; part != end; part++)
+	for (; part != end; part++) {
 		sz += part->path_len;
+		token_pool_sz += part->path_token_count *
+				 sizeof(struct json_token);
+	}
 	part = second->parts;
 	end = part + second->part_count;
 	for (; part != end; part++) {
-		if (!key_def_can_merge(first, part))
+		if (!key_def_can_merge(first, part)) {
 			--new_part_count;
-		else
+		} else {
 			sz += part->path_len;
+			token_pool_sz += part->path_token_count *
+					 sizeof(struct json_token);
+		}
 	}
 
-	sz = key_def_sizeof(new_part_count, sz);
+	sz = key_def_sizeof(new_part_count, sz + token_pool_sz);
 	struct key_def *new_def;
 	new_def = (struct key_def *)calloc(1, sz);
 	if (new_def == NULL) {
@@ -798,8 +860,11 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	new_def->for_func_index = first->for_func_index;
 	new_def->func_index_func = first->func_index_func;
 
-	/* JSON paths data in the new key_def. */
-	char *path_pool = (char *)new_def + key_def_sizeof(new_part_count, 0);
+	/* Compiled JSON path tokens and paths data in the new key_def. */
+	struct json_token *token_pool =
+		(struct json_token *)((char *)new_def +
+				      key_def_sizeof(new_part_count, 0));
+	char *path_pool = (char *)token_pool + token_pool_sz;
 	/* Write position in the new key def. */
 	uint32_t pos = 0;
 	/* Append first key def's parts to the new index_def. */
@@ -810,7 +875,7 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 				     part->nullable_action, part->coll,
 				     part->coll_id, part->sort_order,
 				     part->path, part->path_len, &path_pool,
-				     part->offset_slot_cache,
+				     &token_pool, part->offset_slot_cache,
 				     part->format_epoch) != 0) {
 			key_def_delete(new_def);
 			return NULL;
@@ -827,7 +892,7 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 				     part->nullable_action, part->coll,
 				     part->coll_id, part->sort_order,
 				     part->path, part->path_len, &path_pool,
-				     part->offset_slot_cache,
+				     &token_pool, part->offset_slot_cache,
 				     part->format_epoch) != 0) {
 			key_def_delete(new_def);
 			return NULL;
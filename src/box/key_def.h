@@ -75,6 +75,20 @@ struct key_part_def {
 
 extern const struct key_part_def key_part_def_default;
 
+struct coll;
+struct json_token;
+
+/** @sa key_part::field_cmp. */
+typedef int (*key_part_compare_t)(const char *field_a, const char *field_b,
+				  struct coll *coll);
+
+/** @sa key_part::field_cmp_with_type. */
+typedef int (*key_part_compare_with_type_t)(const char *field_a,
+					    enum mp_type a_type,
+					    const char *field_b,
+					    enum mp_type b_type,
+					    struct coll *coll);
+
 /** Descriptor of a single part in a multipart key. */
 struct key_part {
 	/** Tuple field index for this part */
@@ -98,6 +112,16 @@ struct key_part {
 	char *path;
 	/** The length of JSON path. */
 	uint32_t path_len;
+	/**
+	 * The JSON path above compiled into a flat array of
+	 * tokens, or NULL if the path is NULL. Allows to locate
+	 * the indexed data in a tuple without running a JSON
+	 * lexer on every access. Token memory is allocated at
+	 * the end of key_def, see json_path_compile().
+	 */
+	struct json_token *path_tokens;
+	/** The number of tokens in @a path_tokens. */
+	uint32_t path_token_count;
 	/**
 	 * Epoch of the tuple format the offset slot cached in
 	 * this part is valid for, see tuple_format::epoch.
@@ -112,6 +136,19 @@ struct key_part {
 	 * offset corresponding to the last used tuple format.
 	 */
 	int32_t offset_slot_cache;
+	/**
+	 * Comparator of two fields of this part's type, resolved
+	 * once in key_def_set_compare_func() so that the hot
+	 * comparison loops do not re-dispatch on the field type
+	 * for every field.
+	 */
+	key_part_compare_t field_cmp;
+	/**
+	 * The same as field_cmp, but for fields whose msgpack
+	 * types have already been decoded by the caller (used on
+	 * nullable paths).
+	 */
+	key_part_compare_with_type_t field_cmp_with_type;
 };
 
 struct key_def;
@@ -617,6 +654,30 @@ tuple_extract_key_raw(const char *data, const char *data_end,
 					      multikey_idx, key_size);
 }
 
+/**
+ * Extract keys of several key definitions from one tuple at once.
+ * All keys are placed in a single contiguous block allocated on
+ * the fiber region, and a tuple field referenced by more than one
+ * definition is located and measured only once, so for a
+ * statement touching K indexes this is considerably cheaper than
+ * K tuple_extract_key() calls.
+ *
+ * Multikey and functional definitions are not supported - their
+ * keys are not a pure function of the definition alone.
+ *
+ * @param tuple - tuple from which to extract the keys
+ * @param defs - array of @a def_count key definitions
+ * @param def_count - number of definitions
+ * @param[out] keys - extracted keys, one per definition
+ * @param[out] key_sizes - sizes of the extracted keys
+ *
+ * @retval  0 Success
+ * @retval -1 Memory allocation error
+ */
+int
+tuple_extract_key_batch(struct tuple *tuple, struct key_def **defs,
+			uint32_t def_count, char **keys, uint32_t *key_sizes);
+
 /**
  * Compare keys using the key definition and comparison hints.
  * @param key_a key parts with MessagePack array header
@@ -142,6 +142,17 @@ lbox_cfg_set_too_long_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_sequence_cache_size(struct lua_State *L)
+{
+	try {
+		box_set_sequence_cache_size();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 {
@@ -153,6 +164,17 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_snap_direct_write(struct lua_State *L)
+{
+	try {
+		box_set_snap_direct_write();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_checkpoint_count(struct lua_State *L)
 {
@@ -164,6 +186,39 @@ lbox_cfg_set_checkpoint_count(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_checkpoint_threads(struct lua_State *L)
+{
+	try {
+		box_set_checkpoint_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_checkpoint_incremental(struct lua_State *L)
+{
+	try {
+		box_set_checkpoint_incremental();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_checkpoint_columnar(struct lua_State *L)
+{
+	try {
+		box_set_checkpoint_columnar();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_checkpoint_interval(struct lua_State *L)
 {
@@ -186,6 +241,39 @@ lbox_cfg_set_checkpoint_wal_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_checkpoint_recovery_target(struct lua_State *L)
+{
+	try {
+		box_set_checkpoint_recovery_target();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_retention_size(struct lua_State *L)
+{
+	try {
+		box_set_wal_retention_size();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_wal_consumer_timeout(struct lua_State *L)
+{
+	try {
+		box_set_wal_consumer_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -274,6 +362,17 @@ lbox_cfg_set_net_msg_max(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_net_defer_latency(struct lua_State *L)
+{
+	try {
+		box_set_net_defer_latency();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_set_prepared_stmt_cache_size(struct lua_State *L)
 {
@@ -365,6 +464,36 @@ lbox_cfg_set_replication_skip_conflict(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_replication_compression(struct lua_State *L)
+{
+	(void) L;
+	box_set_replication_compression();
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_synchro_quorum(struct lua_State *L)
+{
+	try {
+		box_set_replication_synchro_quorum();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_synchro_timeout(struct lua_State *L)
+{
+	try {
+		box_set_replication_synchro_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 void
 box_lua_cfg_init(struct lua_State *L)
 {
@@ -377,12 +506,20 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_log_level", lbox_cfg_set_log_level},
 		{"cfg_set_log_format", lbox_cfg_set_log_format},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
+		{"cfg_set_sequence_cache_size", lbox_cfg_set_sequence_cache_size},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_snap_direct_write", lbox_cfg_set_snap_direct_write},
 		{"cfg_set_checkpoint_count", lbox_cfg_set_checkpoint_count},
 		{"cfg_set_checkpoint_interval", lbox_cfg_set_checkpoint_interval},
+		{"cfg_set_checkpoint_threads", lbox_cfg_set_checkpoint_threads},
+		{"cfg_set_checkpoint_incremental", lbox_cfg_set_checkpoint_incremental},
+		{"cfg_set_checkpoint_columnar", lbox_cfg_set_checkpoint_columnar},
 		{"cfg_set_checkpoint_wal_threshold", lbox_cfg_set_checkpoint_wal_threshold},
+		{"cfg_set_checkpoint_recovery_target", lbox_cfg_set_checkpoint_recovery_target},
+		{"cfg_set_wal_retention_size", lbox_cfg_set_wal_retention_size},
+		{"cfg_set_wal_consumer_timeout", lbox_cfg_set_wal_consumer_timeout},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_set_memtx_memory", lbox_cfg_set_memtx_memory},
 		{"cfg_set_memtx_max_tuple_size", lbox_cfg_set_memtx_max_tuple_size},
@@ -396,8 +533,12 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_replication_sync_lag", lbox_cfg_set_replication_sync_lag},
 		{"cfg_set_replication_sync_timeout", lbox_cfg_set_replication_sync_timeout},
 		{"cfg_set_replication_skip_conflict", lbox_cfg_set_replication_skip_conflict},
+		{"cfg_set_replication_compression", lbox_cfg_set_replication_compression},
+		{"cfg_set_replication_synchro_quorum", lbox_cfg_set_replication_synchro_quorum},
+		{"cfg_set_replication_synchro_timeout", lbox_cfg_set_replication_synchro_timeout},
 		{"cfg_set_replication_anon", lbox_cfg_set_replication_anon},
 		{"cfg_set_net_msg_max", lbox_cfg_set_net_msg_max},
+		{"cfg_set_net_defer_latency", lbox_cfg_set_net_defer_latency},
 		{"cfg_set_sql_cache_size", lbox_set_prepared_stmt_cache_size},
 		{NULL, NULL}
 	};
@@ -459,8 +459,8 @@ lbox_execute(struct lua_State *L)
 		lua_Integer query_id = lua_tointeger(L, 1);
 		if (query_id < 0)
 			return luaL_error(L, "Statement id can't be negative");
-		if (sql_execute_prepared(query_id, bind, bind_count, &port,
-					 &fiber()->gc) != 0)
+		if (sql_execute_prepared(query_id, bind, bind_count, NULL,
+					 &port, &fiber()->gc) != 0)
 			return luaT_push_nil_and_error(L);
 	}
 	port_dump_lua(&port, L, false);
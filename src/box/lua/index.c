@@ -34,13 +34,24 @@
 #include "info/info.h"
 #include "box/box.h"
 #include "box/index.h"
+#include "box/tuple.h"
 #include "box/lua/tuple.h"
 #include "box/lua/misc.h" /* lbox_encode_tuple_on_gc() */
+#include "box/schema.h"
+#include "box/space.h"
+#include "box/key_def.h"
+#include "box/field_map.h"
+#include "lua/msgpack.h"
+#include "msgpuck.h"
+#include "diag.h"
+#include "fiber.h"
+#include "small/region.h"
 
 /** {{{ box.index Lua library: access to spaces and indexes
  */
 
 static int CTID_STRUCT_ITERATOR_REF = 0;
+static int CTID_STRUCT_SNAPSHOT_SCAN_REF = 0;
 
 static int
 lbox_insert(lua_State *L)
@@ -58,6 +69,23 @@ lbox_insert(lua_State *L)
 	return luaT_pushtupleornil(L, result);
 }
 
+static int
+lbox_insert_ignore(lua_State *L)
+{
+	if (lua_gettop(L) != 2 || !lua_isnumber(L, 1))
+		return luaL_error(L, "Usage space:insert_ignore(tuple)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	size_t tuple_len;
+	const char *tuple = lbox_encode_tuple_on_gc(L, 2, &tuple_len);
+
+	struct tuple *result;
+	if (box_insert_ignore(space_id, tuple, tuple + tuple_len,
+			      &result) != 0)
+		return luaT_error(L);
+	return luaT_pushtupleornil(L, result);
+}
+
 static int
 lbox_replace(lua_State *L)
 {
@@ -169,6 +197,53 @@ lbox_index_get(lua_State *L)
 	return luaT_pushtupleornil(L, tuple);
 }
 
+static int
+lbox_index_get_multi(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    lua_type(L, 3) != LUA_TTABLE)
+		return luaL_error(L, "Usage index.get_multi(space_id, "
+				  "index_id, keys)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+	const char *keys_end = keys + keys_len;
+	/* The keys table is encoded as an array of keys. */
+	uint32_t key_count = mp_decode_array(&keys);
+	const char *check = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (mp_typeof(*check) != MP_ARRAY)
+			return luaL_error(L, "Usage index.get_multi(space_id, "
+					  "index_id, {key1, key2, ...})");
+		mp_next(&check);
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct tuple **results = (struct tuple **)
+		region_alloc(region, key_count * sizeof(*results));
+	if (results == NULL) {
+		diag_set(OutOfMemory, key_count * sizeof(*results),
+			 "region", "get_multi results");
+		return luaT_error(L);
+	}
+	if (box_index_get_multi(space_id, index_id, keys, keys_end, key_count,
+				results) != 0) {
+		region_truncate(region, region_svp);
+		return luaT_error(L);
+	}
+	lua_createtable(L, key_count, 0);
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (results[i] != NULL) {
+			luaT_pushtuple(L, results[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+	}
+	region_truncate(region, region_svp);
+	return 1;
+}
+
 static int
 lbox_index_min(lua_State *L)
 {
@@ -203,6 +278,48 @@ lbox_index_max(lua_State *L)
 	return luaT_pushtupleornil(L, tuple);
 }
 
+/**
+ * Extract a pagination position from a tuple: the tuple's key in
+ * a given TREE index extended with the implicit primary key tail
+ * (cmp_def). The result is unique per tuple and can be passed as
+ * a select key with the GT (or LT) iterator to resume a scan
+ * right after (before) the tuple in O(log n), regardless of how
+ * deep into the index it is.
+ */
+static int
+lbox_index_tuple_pos(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "usage index.tuple_pos(space_id, "
+				  "index_id, tuple)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	size_t data_len;
+	const char *data = lbox_encode_tuple_on_gc(L, 3, &data_len);
+
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return luaT_error(L);
+	struct index *index = index_find(space, index_id);
+	if (index == NULL)
+		return luaT_error(L);
+	if (index->def->type != TREE || index->def->key_def->is_multikey ||
+	    index->def->key_def->for_func_index) {
+		diag_set(UnsupportedIndexFeature, index->def, "pagination");
+		return luaT_error(L);
+	}
+	uint32_t key_size;
+	char *key = tuple_extract_key_raw(data, data + data_len,
+					  index->def->cmp_def, MULTIKEY_NONE,
+					  &key_size);
+	if (key == NULL)
+		return luaT_error(L);
+	const char *pos = key;
+	luamp_decode(L, luaL_msgpack_default, &pos);
+	return 1;
+}
+
 static int
 lbox_index_count(lua_State *L)
 {
@@ -296,6 +413,78 @@ lbox_truncate(struct lua_State *L)
 
 /* }}} */
 
+/* {{{ box.index snapshot scans: consistent off-thread iteration */
+
+static struct snapshot_scan *
+lbox_check_snapshot_scan(lua_State *L, int idx, const char *usage)
+{
+	uint32_t ctypeid = 0;
+	void *data = NULL;
+	if (lua_type(L, idx) == LUA_TCDATA)
+		data = luaL_checkcdata(L, idx, &ctypeid);
+	if (data == NULL || ctypeid != (uint32_t) CTID_STRUCT_SNAPSHOT_SCAN_REF)
+		luaL_error(L, usage);
+	return *(struct snapshot_scan **) data;
+}
+
+static int
+lbox_index_snapshot_scan(lua_State *L)
+{
+	if (lua_gettop(L) != 2 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "usage index.snapshot_scan(space_id, "
+				  "index_id)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+
+	struct snapshot_scan *scan = snapshot_scan_new(space_id, index_id);
+	if (scan == NULL)
+		return luaT_error(L);
+
+	assert(CTID_STRUCT_SNAPSHOT_SCAN_REF != 0);
+	struct snapshot_scan **ptr = (struct snapshot_scan **) luaL_pushcdata(L,
+		CTID_STRUCT_SNAPSHOT_SCAN_REF);
+	*ptr = scan;
+	return 1;
+}
+
+static int
+lbox_snapshot_scan_next(lua_State *L)
+{
+	struct snapshot_scan *scan =
+		lbox_check_snapshot_scan(L, 1, "usage: snapshot_scan_next(scan)");
+	if (scan->pos >= scan->data_size) {
+		ssize_t rc = snapshot_scan_fetch(scan);
+		if (rc < 0)
+			return luaT_error(L);
+		scan->pos = 0;
+		if (rc == 0) {
+			lua_pushnil(L);
+			return 1;
+		}
+	}
+	const char *data = scan->buf + scan->pos;
+	const char *end = data;
+	mp_next(&end);
+	scan->pos += end - data;
+	struct tuple *tuple = box_tuple_new(box_tuple_format_default(),
+					    data, end);
+	if (tuple == NULL)
+		return luaT_error(L);
+	return luaT_pushtupleornil(L, tuple);
+}
+
+static int
+lbox_snapshot_scan_free(lua_State *L)
+{
+	struct snapshot_scan *scan =
+		lbox_check_snapshot_scan(L, 1, "usage: snapshot_scan_free(scan)");
+	snapshot_scan_delete(scan);
+	return 0;
+}
+
+/* }}} */
+
 /* {{{ Introspection */
 
 static int
@@ -314,6 +503,35 @@ lbox_index_stat(lua_State *L)
 	return 1;
 }
 
+static int
+lbox_index_split(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_isnumber(L, 3))
+		return luaL_error(L, "usage index.split(space_id, index_id, "
+				  "count)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	uint32_t count = lua_tonumber(L, 3);
+	/* More parallel chunks make no sense anyway. */
+	enum { SPLIT_COUNT_MAX = 128 };
+	if (count > SPLIT_COUNT_MAX)
+		count = SPLIT_COUNT_MAX;
+	const char *keys[SPLIT_COUNT_MAX];
+	const char *keys_end[SPLIT_COUNT_MAX];
+	ssize_t n = box_index_split(space_id, index_id, count, keys, keys_end);
+	if (n < 0)
+		return luaT_error(L);
+	lua_createtable(L, n, 0);
+	for (ssize_t i = 0; i < n; i++) {
+		const char *key = keys[i];
+		luamp_decode(L, luaL_msgpack_default, &key);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
 static int
 lbox_index_compact(lua_State *L)
 {
@@ -339,6 +557,10 @@ box_lua_index_init(struct lua_State *L)
 	(void) rc;
 	CTID_STRUCT_ITERATOR_REF = luaL_ctypeid(L, "struct iterator&");
 	assert(CTID_STRUCT_ITERATOR_REF != 0);
+	rc = luaL_cdef(L, "struct snapshot_scan;");
+	assert(rc == 0);
+	CTID_STRUCT_SNAPSHOT_SCAN_REF = luaL_ctypeid(L, "struct snapshot_scan&");
+	assert(CTID_STRUCT_SNAPSHOT_SCAN_REF != 0);
 
 	static const struct luaL_Reg indexlib [] = {
 		{NULL, NULL}
@@ -351,20 +573,27 @@ box_lua_index_init(struct lua_State *L)
 
 	static const struct luaL_Reg boxlib_internal[] = {
 		{"insert", lbox_insert},
+		{"insert_ignore", lbox_insert_ignore},
 		{"replace",  lbox_replace},
 		{"update", lbox_index_update},
 		{"upsert",  lbox_upsert},
 		{"delete",  lbox_index_delete},
 		{"random", lbox_index_random},
 		{"get",  lbox_index_get},
+		{"get_multi",  lbox_index_get_multi},
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
+		{"tuple_pos", lbox_index_tuple_pos},
 		{"iterator", lbox_index_iterator},
 		{"iterator_next", lbox_iterator_next},
+		{"snapshot_scan", lbox_index_snapshot_scan},
+		{"snapshot_scan_next", lbox_snapshot_scan_next},
+		{"snapshot_scan_free", lbox_snapshot_scan_free},
 		{"truncate", lbox_truncate},
 		{"stat", lbox_index_stat},
 		{"compact", lbox_index_compact},
+		{"split", lbox_index_split},
 		{NULL, NULL}
 	};
 
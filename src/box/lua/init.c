@@ -36,6 +36,7 @@
 
 #include "lua/utils.h" /* luaT_error() */
 #include "lua/trigger.h"
+#include "sampler.h"
 
 #include "box/box.h"
 #include "box/txn.h"
@@ -285,7 +286,7 @@ lbox_txn_pairs(struct lua_State *L)
  * Push an argument for on_commit Lua trigger. The argument is
  * a function to open an iterator over the transaction statements.
  */
-static int
+int
 lbox_push_txn(struct lua_State *L, void *event)
 {
 	struct txn *txn = (struct txn *) event;
@@ -386,6 +387,63 @@ static const struct luaL_Reg boxlib_backup[] = {
 	{NULL, NULL}
 };
 
+/** {{{ box.internal.profiler: in-process sampling profiler. */
+
+static int
+lbox_profiler_start(struct lua_State *L)
+{
+	int freq_hz = 99;
+	if (lua_gettop(L) >= 1)
+		freq_hz = luaL_checkinteger(L, 1);
+	if (sampler_start(freq_hz) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_profiler_stop(struct lua_State *L)
+{
+	(void) L;
+	sampler_stop();
+	return 0;
+}
+
+/** Count a stack line into the aggregation table on the top. */
+static int
+lbox_profiler_dump_cb(const char *line, void *ctx)
+{
+	struct lua_State *L = (struct lua_State *) ctx;
+	lua_getfield(L, -1, line);
+	int count = lua_isnil(L, -1) ? 0 : lua_tointeger(L, -1);
+	lua_pop(L, 1);
+	lua_pushinteger(L, count + 1);
+	lua_setfield(L, -2, line);
+	return 0;
+}
+
+/**
+ * Return collected samples aggregated into a table mapping a
+ * flamegraph stack line to the number of its occurrences, and
+ * reset the sample ring.
+ */
+static int
+lbox_profiler_dump(struct lua_State *L)
+{
+	lua_newtable(L);
+	if (sampler_dump(lbox_profiler_dump_cb, L) < 0)
+		return luaT_error(L);
+	return 1;
+}
+
+static const struct luaL_Reg boxlib_profiler[] = {
+	{"start", lbox_profiler_start},
+	{"stop", lbox_profiler_stop},
+	{"dump", lbox_profiler_dump},
+	{NULL, NULL}
+};
+
+/** }}} */
+
 #include "say.h"
 
 void
@@ -402,6 +460,9 @@ box_lua_init(struct lua_State *L)
 	luaL_register(L, "box.backup", boxlib_backup);
 	lua_pop(L, 1);
 
+	luaL_register(L, "box.internal.profiler", boxlib_profiler);
+	lua_pop(L, 1);
+
 	box_lua_error_init(L);
 	box_lua_tuple_init(L);
 	box_lua_call_init(L);
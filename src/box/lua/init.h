@@ -39,6 +39,14 @@ struct lua_State;
 void
 box_lua_init(struct lua_State *L);
 
+/**
+ * Push an argument for a transaction-scope Lua trigger. The event
+ * is a struct txn, the argument is a function to open an iterator
+ * over the transaction statements.
+ */
+int
+lbox_push_txn(struct lua_State *L, void *event);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -28,12 +28,14 @@ local default_cfg = {
     strip_core          = true,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_use_mvcc_engine = false,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
     wal_dir             = ".",
 
     vinyl_dir           = '.',
+    vinyl_cold_dir      = nil,
     vinyl_memory        = 128 * 1024 * 1024,
     vinyl_cache         = 128 * 1024 * 1024,
     vinyl_max_tuple_size = 1024 * 1024,
@@ -51,10 +53,16 @@ local default_cfg = {
     log_format          = "plain",
     io_collect_interval = nil,
     readahead           = 16320,
+    sequence_cache_size = 1,
     snap_io_rate_limit  = nil, -- no limit
+    snap_direct_write   = false,
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     wal_max_size        = 256 * 1024 * 1024,
+    wal_io_uring        = false,
+    wal_direct_write    = false,
+    wal_retention_size  = 0, -- no limit
+    wal_consumer_timeout = 0, -- never deactivate on timeout
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
     replication         = nil,
@@ -69,7 +77,11 @@ local default_cfg = {
     hot_standby         = false,
     checkpoint_interval = 3600,
     checkpoint_wal_threshold = 1e18,
+    checkpoint_recovery_target = nil,
     checkpoint_count    = 2,
+    checkpoint_threads  = 1,
+    checkpoint_incremental = false,
+    checkpoint_columnar = false,
     worker_pool_threads = 4,
     replication_timeout = 1,
     replication_sync_lag = 10,
@@ -78,11 +90,16 @@ local default_cfg = {
     replication_connect_quorum = nil, -- connect all
     replication_skip_conflict = false,
     replication_anon      = false,
+    replication_compression = false,
+    replication_synchro_quorum = 1,
+    replication_synchro_timeout = 5,
     feedback_enabled      = true,
     feedback_host         = "https://feedback.tarantool.io",
     feedback_interval     = 3600,
     net_msg_max           = 768,
+    net_defer_latency     = nil, -- admission control disabled
     sql_cache_size        = 5 * 1024 * 1024,
+    iproto_threads        = 1,
 }
 
 -- types of available options
@@ -93,11 +110,13 @@ local template_cfg = {
     strip_core          = 'boolean',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_use_mvcc_engine = 'boolean',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
     wal_dir             = 'string',
     vinyl_dir           = 'string',
+    vinyl_cold_dir      = 'string',
     vinyl_memory        = 'number',
     vinyl_cache               = 'number',
     vinyl_max_tuple_size      = 'number',
@@ -116,10 +135,16 @@ local template_cfg = {
     log_format          = 'string',
     io_collect_interval = 'number',
     readahead           = 'number',
+    sequence_cache_size = 'number',
     snap_io_rate_limit  = 'number',
+    snap_direct_write   = 'boolean',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     wal_max_size        = 'number',
+    wal_io_uring        = 'boolean',
+    wal_direct_write    = 'boolean',
+    wal_retention_size  = 'number',
+    wal_consumer_timeout = 'number',
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
@@ -132,7 +157,11 @@ local template_cfg = {
     coredump            = 'boolean',
     checkpoint_interval = 'number',
     checkpoint_wal_threshold = 'number',
+    checkpoint_recovery_target = 'number',
     checkpoint_count    = 'number',
+    checkpoint_threads  = 'number',
+    checkpoint_incremental = 'boolean',
+    checkpoint_columnar = 'boolean',
     read_only           = 'boolean',
     hot_standby         = 'boolean',
     worker_pool_threads = 'number',
@@ -143,10 +172,15 @@ local template_cfg = {
     replication_connect_quorum = 'number',
     replication_skip_conflict = 'boolean',
     replication_anon      = 'boolean',
+    replication_compression = 'boolean',
+    replication_synchro_quorum = 'number',
+    replication_synchro_timeout = 'number',
     feedback_enabled      = 'boolean',
     feedback_host         = 'string',
     feedback_interval     = 'number',
     net_msg_max           = 'number',
+    net_defer_latency     = 'number',
+    iproto_threads        = 'number',
     sql_cache_size        = 'number',
 }
 
@@ -223,8 +257,10 @@ local dynamic_cfg = {
     log_format              = private.cfg_set_log_format,
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
+    sequence_cache_size     = private.cfg_set_sequence_cache_size,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snap_direct_write       = private.cfg_set_snap_direct_write,
     read_only               = private.cfg_set_read_only,
     memtx_memory            = private.cfg_set_memtx_memory,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
@@ -235,6 +271,12 @@ local dynamic_cfg = {
     checkpoint_count        = private.cfg_set_checkpoint_count,
     checkpoint_interval     = private.cfg_set_checkpoint_interval,
     checkpoint_wal_threshold = private.cfg_set_checkpoint_wal_threshold,
+    checkpoint_recovery_target = private.cfg_set_checkpoint_recovery_target,
+    wal_retention_size      = private.cfg_set_wal_retention_size,
+    wal_consumer_timeout    = private.cfg_set_wal_consumer_timeout,
+    checkpoint_threads      = private.cfg_set_checkpoint_threads,
+    checkpoint_incremental  = private.cfg_set_checkpoint_incremental,
+    checkpoint_columnar     = private.cfg_set_checkpoint_columnar,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
     feedback_enabled        = private.feedback_daemon.set_feedback_params,
     feedback_host           = private.feedback_daemon.set_feedback_params,
@@ -252,9 +294,13 @@ local dynamic_cfg = {
     replication_sync_timeout = private.cfg_set_replication_sync_timeout,
     replication_skip_conflict = private.cfg_set_replication_skip_conflict,
     replication_anon        = private.cfg_set_replication_anon,
+    replication_compression = private.cfg_set_replication_compression,
+    replication_synchro_quorum = private.cfg_set_replication_synchro_quorum,
+    replication_synchro_timeout = private.cfg_set_replication_synchro_timeout,
     instance_uuid           = check_instance_uuid,
     replicaset_uuid         = check_replicaset_uuid,
     net_msg_max             = private.cfg_set_net_msg_max,
+    net_defer_latency       = private.cfg_set_net_defer_latency,
     sql_cache_size          = private.cfg_set_sql_cache_size,
 }
 
@@ -317,13 +363,18 @@ local dynamic_cfg_skip_at_load = {
     replication_sync_timeout = true,
     replication_skip_conflict = true,
     replication_anon        = true,
+    replication_compression = true,
+    replication_synchro_quorum = true,
+    replication_synchro_timeout = true,
     wal_dir_rescan_delay    = true,
     custom_proc_title       = true,
     force_recovery          = true,
     instance_uuid           = true,
     replicaset_uuid         = true,
     net_msg_max             = true,
+    net_defer_latency       = true,
     readahead               = true,
+    sequence_cache_size     = true,
 }
 
 local function convert_gb(size)
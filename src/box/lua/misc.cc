@@ -36,6 +36,8 @@
 #include "lua/msgpack.h"
 
 #include "box/box.h"
+#include "box/bulk_import.h"
+#include "box/mat_view.h"
 #include "box/port.h"
 #include "box/tuple.h"
 #include "box/tuple_format.h"
@@ -230,7 +232,7 @@ lbox_tuple_format_new(struct lua_State *L)
 		return luaT_error(L);
 	struct tuple_format *format =
 		tuple_format_new(&tuple_format_runtime->vtab, NULL, NULL, 0,
-				 NULL, 0, 0, dict, false, false);
+				 NULL, 0, 0, dict, false, false, false);
 	/*
 	 * Since dictionary reference counter is 1 from the
 	 * beginning and after creation of the tuple_format
@@ -244,11 +246,81 @@ lbox_tuple_format_new(struct lua_State *L)
 
 /* }}} */
 
+/** {{{ Native bulk loader **/
+
+static int
+lbox_bulk_import(lua_State *L)
+{
+	if (lua_gettop(L) != 4 || !lua_isnumber(L, 1) ||
+	    !lua_isstring(L, 2) || !lua_isstring(L, 3) ||
+	    !lua_isnumber(L, 4)) {
+		return luaL_error(L, "Usage bulk_import(space_id, path, "
+				  "format, batch_size)");
+	}
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	const char *path = lua_tostring(L, 2);
+	const char *format = lua_tostring(L, 3);
+	uint32_t batch_size = lua_tonumber(L, 4);
+
+	enum bulk_import_format fmt;
+	if (strcmp(format, "msgpack") == 0)
+		fmt = BULK_IMPORT_MSGPACK;
+	else if (strcmp(format, "csv") == 0)
+		fmt = BULK_IMPORT_CSV;
+	else
+		return luaL_error(L, "bulk_import: unknown format '%s'",
+				  format);
+
+	ssize_t rows = bulk_import(space_id, path, fmt, batch_size);
+	if (rows < 0)
+		return luaT_error(L);
+	lua_pushinteger(L, rows);
+	return 1;
+}
+
+/* }}} */
+
+/** {{{ Materialized views **/
+
+static int
+lbox_mat_view_create(lua_State *L)
+{
+	if (lua_gettop(L) != 4 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_isnumber(L, 3) ||
+	    !lua_isnumber(L, 4)) {
+		return luaL_error(L, "Usage mat_view_create(source_id, "
+				  "target_id, key_fieldno, sum_fieldno)");
+	}
+	if (mat_view_create(lua_tonumber(L, 1), lua_tonumber(L, 2),
+			    lua_tonumber(L, 3), lua_tonumber(L, 4)) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_mat_view_drop(lua_State *L)
+{
+	if (lua_gettop(L) != 2 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2)) {
+		return luaL_error(L, "Usage mat_view_drop(source_id, "
+				  "target_id)");
+	}
+	if (mat_view_drop(lua_tonumber(L, 1), lua_tonumber(L, 2)) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+/* }}} */
+
 void
 box_lua_misc_init(struct lua_State *L)
 {
 	static const struct luaL_Reg boxlib_internal[] = {
 		{"select", lbox_select},
+		{"bulk_import", lbox_bulk_import},
+		{"mat_view_create", lbox_mat_view_create},
+		{"mat_view_drop", lbox_mat_view_drop},
 		{"new_tuple_format", lbox_tuple_format_new},
 		{NULL, NULL}
 	};
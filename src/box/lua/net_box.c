@@ -139,12 +139,27 @@ netbox_encode_auth(lua_State *L)
 	const char *salt = lua_tolstring(L, 5, &salt_len);
 	if (salt_len < SCRAMBLE_SIZE)
 		return luaL_error(L, "Invalid salt");
+	size_t ticket_len = 0;
+	const char *ticket = NULL;
+	if (!lua_isnoneornil(L, 6))
+		ticket = lua_tolstring(L, 6, &ticket_len);
 
 	/* Adapted from xrow_encode_auth() */
-	mpstream_encode_map(&stream, password != NULL ? 2 : 1);
+	mpstream_encode_map(&stream, password != NULL || ticket != NULL ?
+				     2 : 1);
 	mpstream_encode_uint(&stream, IPROTO_USER_NAME);
 	mpstream_encode_strn(&stream, user, user_len);
-	if (password != NULL) { /* password can be omitted */
+	if (ticket != NULL) {
+		/*
+		 * A session resumption ticket issued by the server
+		 * on an earlier successful authentication. Skips
+		 * the chap-sha1 exchange on the server side.
+		 */
+		mpstream_encode_uint(&stream, IPROTO_TUPLE);
+		mpstream_encode_array(&stream, 2);
+		mpstream_encode_str(&stream, "ticket");
+		mpstream_encode_strn(&stream, ticket, ticket_len);
+	} else if (password != NULL) { /* password can be omitted */
 		char scramble[SCRAMBLE_SIZE];
 		scramble_prepare(scramble, salt, password, password_len);
 		mpstream_encode_uint(&stream, IPROTO_TUPLE);
@@ -564,11 +579,13 @@ netbox_encode_execute(lua_State *L)
 {
 	if (lua_gettop(L) < 5)
 		return luaL_error(L, "Usage: netbox.encode_execute(ibuf, "\
-				  "sync, query, parameters, options)");
+				  "sync, query, parameters, options"\
+				  "[, metadata_version])");
 	struct mpstream stream;
 	size_t svp = netbox_prepare_request(L, &stream, IPROTO_EXECUTE);
 
-	mpstream_encode_map(&stream, 3);
+	bool has_version = lua_gettop(L) >= 6 && !lua_isnil(L, 6);
+	mpstream_encode_map(&stream, has_version ? 4 : 3);
 
 	if (lua_type(L, 3) == LUA_TNUMBER) {
 		uint32_t query_id = lua_tointeger(L, 3);
@@ -587,6 +604,16 @@ netbox_encode_execute(lua_State *L)
 	mpstream_encode_uint(&stream, IPROTO_OPTIONS);
 	luamp_encode_tuple(L, cfg, &stream, 5);
 
+	if (has_version) {
+		/*
+		 * Tell the server which metadata version we have
+		 * cached: a matching response comes back without
+		 * the metadata.
+		 */
+		mpstream_encode_uint(&stream, IPROTO_METADATA_VERSION);
+		mpstream_encode_uint(&stream, luaL_touint64(L, 6));
+	}
+
 	netbox_encode_request(&stream, svp);
 	return 0;
 }
@@ -793,7 +820,7 @@ netbox_decode_execute(struct lua_State *L)
 	const char *data = *(const char **)luaL_checkcdata(L, 1, &ctypeid);
 	assert(mp_typeof(*data) == MP_MAP);
 	uint32_t map_size = mp_decode_map(&data);
-	int rows_index = 0, meta_index = 0, info_index = 0;
+	int rows_index = 0, meta_index = 0, info_index = 0, version_index = 0;
 	for (uint32_t i = 0; i < map_size; ++i) {
 		uint32_t key = mp_decode_uint(&data);
 		switch(key) {
@@ -805,6 +832,10 @@ netbox_decode_execute(struct lua_State *L)
 			netbox_decode_metadata(L, &data);
 			meta_index = i - map_size;
 			break;
+		case IPROTO_METADATA_VERSION:
+			luaL_pushuint64(L, mp_decode_uint(&data));
+			version_index = i - map_size;
+			break;
 		default:
 			assert(key == IPROTO_SQL_INFO);
 			netbox_decode_sql_info(L, &data);
@@ -813,13 +844,24 @@ netbox_decode_execute(struct lua_State *L)
 		}
 	}
 	if (info_index == 0) {
-		assert(meta_index != 0);
 		assert(rows_index != 0);
-		lua_createtable(L, 0, 2);
-		lua_pushvalue(L, meta_index - 1);
-		lua_setfield(L, -2, "metadata");
+		lua_createtable(L, 0, 3);
+		/*
+		 * The metadata is missing if the client declared a
+		 * version matching the statement, see
+		 * remote_methods:execute() for the substitution of
+		 * the cached copy.
+		 */
+		if (meta_index != 0) {
+			lua_pushvalue(L, meta_index - 1);
+			lua_setfield(L, -2, "metadata");
+		}
 		lua_pushvalue(L, rows_index - 1);
 		lua_setfield(L, -2, "rows");
+		if (version_index != 0) {
+			lua_pushvalue(L, version_index - 1);
+			lua_setfield(L, -2, "metadata_version");
+		}
 	} else {
 		assert(meta_index == 0);
 		assert(rows_index == 0);
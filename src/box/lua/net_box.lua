@@ -44,6 +44,7 @@ local SQL_INFO_ROW_COUNT_KEY = 0
 local IPROTO_FIELD_NAME_KEY = 0
 local IPROTO_DATA_KEY      = 0x30
 local IPROTO_ERROR_KEY     = 0x31
+local IPROTO_AUTH_TICKET_KEY = 0x54
 local IPROTO_GREETING_SIZE = 128
 local IPROTO_CHUNK_KEY     = 128
 local IPROTO_OK_KEY        = 0
@@ -256,6 +257,10 @@ local function create_transport(host, port, user, password, callback,
     local worker_fiber
     local send_buf         = buffer.ibuf(buffer.READAHEAD)
     local recv_buf         = buffer.ibuf(buffer.READAHEAD)
+    -- Session resumption ticket issued by the server on a
+    -- successful authentication. Presented in place of the
+    -- scramble on reconnect to skip the full handshake.
+    local auth_ticket
 
     --
     -- Async request metamethods.
@@ -498,14 +503,20 @@ local function create_transport(host, port, user, password, callback,
     -- @retval not nil Future object.
     --
     local function perform_async_request(buffer, skip_header, method, on_push,
-                                         on_push_ctx, request_ctx, ...)
+                                         on_push_ctx, request_ctx, no_wakeup,
+                                         ...)
         if state ~= 'active' and state ~= 'fetch_schema' then
             return nil, box.error.new({code = last_errno or E_NO_CONNECTION,
                                        reason = last_error})
         end
         -- alert worker to notify it of the queued outgoing data;
-        -- if the buffer wasn't empty, assume the worker was already alerted
-        if send_buf:size() == 0 then
+        -- if the buffer wasn't empty, assume the worker was
+        -- already alerted. Requests issued in the same event
+        -- loop tick are thereby coalesced into a single write:
+        -- the worker runs after all ready fibers and sends the
+        -- whole buffer at once. A pipelined request suppresses
+        -- the wakeup entirely until the pipeline is flushed.
+        if send_buf:size() == 0 and not no_wakeup then
             worker_fiber:wakeup()
         end
         local id = next_request_id
@@ -536,7 +547,7 @@ local function create_transport(host, port, user, password, callback,
                                    on_push, on_push_ctx, request_ctx, ...)
         local request, err =
             perform_async_request(buffer, skip_header, method, on_push,
-                                  on_push_ctx, request_ctx, ...)
+                                  on_push_ctx, request_ctx, false, ...)
         if not request then
             return nil, err
         end
@@ -728,16 +739,28 @@ local function create_transport(host, port, user, password, callback,
             set_state('fetch_schema')
             return iproto_schema_sm()
         end
-        encode_auth(send_buf, new_request_id(), user, password, salt)
+        encode_auth(send_buf, new_request_id(), user, password, salt,
+                    auth_ticket)
         local err, hdr, body_rpos, body_end = send_and_recv_iproto()
         if err then
             return error_sm(err, hdr)
         end
         if hdr[IPROTO_STATUS_KEY] ~= 0 then
+            if auth_ticket ~= nil then
+                -- The ticket has expired or the password has
+                -- changed: retry with a regular exchange.
+                auth_ticket = nil
+                return iproto_auth_sm(salt)
+            end
             local body
             body, body_end = decode(body_rpos)
             return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_KEY])
         end
+        local body
+        body, body_end = decode(body_rpos)
+        if type(body) == 'table' then
+            auth_ticket = body[IPROTO_AUTH_TICKET_KEY]
+        end
         set_state('fetch_schema')
         return iproto_schema_sm(hdr[IPROTO_SCHEMA_VERSION_KEY])
     end
@@ -833,12 +856,23 @@ local function create_transport(host, port, user, password, callback,
         end
     end
 
+    --
+    -- Wake the worker up to send whatever has been accumulated
+    -- in the send buffer by pipelined requests.
+    --
+    local function flush()
+        if send_buf:size() > 0 and worker_fiber ~= nil then
+            worker_fiber:wakeup()
+        end
+    end
+
     return {
         stop            = stop,
         start           = start,
         wait_state      = wait_state,
         perform_request = perform_request,
         perform_async_request = perform_async_request,
+        flush           = flush,
     }
 end
 
@@ -922,8 +956,22 @@ local console_mt = {
     __metatable = false
 }
 
+local pipeline_methods = {}
+local pipeline_mt = {
+    __index = pipeline_methods,
+    __metatable = false
+}
+
 local space_metatable, index_metatable
 
+--
+-- Physical connections shared between logical net.box handles,
+-- keyed by host, port and user. A connection gets here when it is
+-- created with the 'shared' option and leaves the pool when its
+-- last user closes it. See connect().
+--
+local shared_pool = {}
+
 local function new_sm(host, port, opts, connection, greeting)
     local user, password = opts.user, opts.password; opts.password = nil
     local last_reconnect_error
@@ -989,6 +1037,9 @@ local function new_sm(host, port, opts, connection, greeting)
 
         remote._space_mt = space_metatable(remote)
         remote._index_mt = index_metatable(remote)
+        -- Cached metadata of prepared statements, keyed by
+        -- statement id, see remote_methods:execute().
+        remote._stmt_metadata = {}
         if opts.call_16 then
             remote.call = remote.call_16
             remote.eval = remote.eval_16
@@ -1032,12 +1083,33 @@ end
 --        hostname:port@login:password. Host and port can be
 --        passed separately with login and password in the next
 --        parameter.
--- @param opts @Sa wrap().
+-- @param opts @Sa wrap(). When opts.shared is set, logical
+--        connections to the same host, port and user multiplex
+--        over a single physical connection: the sync field of the
+--        binary protocol already acts as a stream id, so requests
+--        from all users are matched to their responses
+--        independently, while outgoing data issued in one event
+--        loop tick is coalesced into a single write on the shared
+--        socket. Such a connection is really closed only when its
+--        last user calls close().
 --
 -- @retval Net.box object.
 --
 local function connect(...)
-    return new_sm(parse_connect_params(...))
+    local host, port, opts = parse_connect_params(...)
+    if not opts.shared or opts.console then
+        return new_sm(host, port, opts)
+    end
+    local key = (host or '')..'|'..(port or '')..'|'..(opts.user or '')
+    local remote = shared_pool[key]
+    if remote == nil or is_final_state[remote.state] then
+        remote = new_sm(host, port, opts)
+        remote._shared_key = key
+        remote._shared_refs = 0
+        shared_pool[key] = remote
+    end
+    remote._shared_refs = remote._shared_refs + 1
+    return remote
 end
 
 local function check_remote_arg(remote, method)
@@ -1063,6 +1135,14 @@ end
 
 function remote_methods:close()
     check_remote_arg(self, 'close')
+    if self._shared_refs ~= nil then
+        -- The physical connection is stopped by its last user.
+        self._shared_refs = self._shared_refs - 1
+        if self._shared_refs > 0 then
+            return
+        end
+        shared_pool[self._shared_key] = nil
+    end
     self._transport.stop()
 end
 
@@ -1106,7 +1186,7 @@ function remote_methods:_request(method, opts, request_ctx, ...)
             local res, err =
                 transport.perform_async_request(buffer, skip_header, method,
                                                 table.insert, {}, request_ctx,
-                                                ...)
+                                                opts.no_wakeup, ...)
             if err then
                 box.error(err)
             end
@@ -1153,6 +1233,78 @@ function remote_methods:ping(opts)
     return (pcall(self._request, self, 'ping', opts))
 end
 
+--
+-- Open an explicit request pipeline. All requests issued through
+-- the returned handle are asynchronous: each returns a future,
+-- but the worker fiber is not woken up until flush() is called,
+-- so the whole pipeline leaves the instance in a single write.
+-- Usage:
+--
+--     local p = conn:pipeline()
+--     local f1 = p:call('f', {1})
+--     local f2 = p:call('f', {2})
+--     p:flush()
+--     f1:wait_result() f2:wait_result()
+--
+-- An unflushed pipeline does not lose requests - they are sent
+-- together with the next regular request - but it may delay them
+-- indefinitely on an idle connection, so always flush.
+--
+function remote_methods:pipeline()
+    check_remote_arg(self, 'pipeline')
+    return setmetatable({_conn = self, _is_open = true}, pipeline_mt)
+end
+
+-- Copy user options, forcing is_async and no_wakeup: pipelined
+-- requests can not wait for a response that is not even sent
+-- yet, and they do not wake the worker up until flush().
+local function pipeline_opts(opts)
+    local copy = {}
+    if opts ~= nil then
+        for k, v in pairs(opts) do copy[k] = v end
+    end
+    copy.is_async = true
+    copy.no_wakeup = true
+    return copy
+end
+
+local function check_pipeline_arg(pipeline, method)
+    if type(pipeline) ~= 'table' or pipeline._conn == nil then
+        local fmt = 'Use pipeline:%s(...) instead of pipeline.%s(...):'
+        box.error(E_PROC_LUA, string.format(fmt, method, method))
+    end
+    if not pipeline._is_open then
+        box.error(E_PROC_LUA, 'Pipeline is already flushed')
+    end
+end
+
+function pipeline_methods:call(func_name, args, opts)
+    check_pipeline_arg(self, 'call')
+    return self._conn:call(func_name, args, pipeline_opts(opts))
+end
+
+function pipeline_methods:eval(code, args, opts)
+    check_pipeline_arg(self, 'eval')
+    return self._conn:eval(code, args, pipeline_opts(opts))
+end
+
+function pipeline_methods:execute(query, parameters, sql_opts, netbox_opts)
+    check_pipeline_arg(self, 'execute')
+    return self._conn:execute(query, parameters, sql_opts,
+                              pipeline_opts(netbox_opts))
+end
+
+function pipeline_methods:ping(opts)
+    check_pipeline_arg(self, 'ping')
+    return self._conn:_request('ping', pipeline_opts(opts))
+end
+
+function pipeline_methods:flush()
+    check_pipeline_arg(self, 'flush')
+    self._is_open = false
+    self._conn._transport.flush()
+end
+
 function remote_methods:reload_schema()
     check_remote_arg(self, 'reload_schema')
     self:ping()
@@ -1197,8 +1349,36 @@ function remote_methods:execute(query, parameters, sql_opts, netbox_opts)
     if sql_opts ~= nil then
         box.error(box.error.UNSUPPORTED, "execute", "options")
     end
-    return self:_request('execute', netbox_opts, nil, query, parameters or {},
-                         sql_opts or {})
+    -- The metadata of a prepared statement only changes when the
+    -- statement is recompiled, so declare the version we have
+    -- cached: the server omits the metadata from the response if
+    -- it matches, and the cached copy is substituted below. Async
+    -- callers get the raw response and are left alone.
+    local cached, version
+    if type(query) == 'number' and self._stmt_metadata ~= nil and
+       not (netbox_opts and netbox_opts.is_async) then
+        cached = self._stmt_metadata[query]
+        -- 0 never matches a real schema version, so the first
+        -- execute gets the metadata and populates the cache.
+        version = cached and cached.version or 0
+    end
+    local res = self:_request('execute', netbox_opts, nil, query,
+                              parameters or {}, sql_opts or {}, version)
+    if type(res) ~= 'table' or netbox_opts and netbox_opts.is_async then
+        return res
+    end
+    if res.metadata_version ~= nil then
+        if res.metadata ~= nil then
+            self._stmt_metadata[query] = {
+                version = res.metadata_version,
+                metadata = res.metadata,
+            }
+        elseif cached ~= nil then
+            res.metadata = cached.metadata
+        end
+        res.metadata_version = nil
+    end
+    return res
 end
 
 function remote_methods:prepare(query, parameters, sql_opts, netbox_opts)
@@ -1220,6 +1400,9 @@ function remote_methods:unprepare(query, parameters, sql_opts, netbox_opts)
     if sql_opts ~= nil then
         box.error(box.error.UNSUPPORTED, "unprepare", "options")
     end
+    if self._stmt_metadata ~= nil then
+        self._stmt_metadata[query] = nil
+    end
     return self:_request('unprepare', netbox_opts, nil, query, parameters or {},
                          sql_opts or {})
 end
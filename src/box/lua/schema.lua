@@ -411,6 +411,11 @@ box.schema.space.create = function(name, options)
         format = 'table',
         is_local = 'boolean',
         temporary = 'boolean',
+        wal_disabled = 'boolean',
+        scan_optimized = 'boolean',
+        compression = 'boolean',
+        dictionary = 'boolean',
+        is_sync = 'boolean',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -455,6 +460,11 @@ box.schema.space.create = function(name, options)
     local space_options = setmap({
         group_id = options.is_local and 1 or nil,
         temporary = options.temporary and true or nil,
+        wal_disabled = options.wal_disabled and true or nil,
+        scan_optimized = options.scan_optimized and true or nil,
+        compression = options.compression and true or nil,
+        dictionary = options.dictionary and true or nil,
+        is_sync = options.is_sync and true or nil,
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -940,6 +950,7 @@ local index_options = {
     page_size = 'number',
     bloom_fpr = 'number',
     func = 'number, string',
+    predicate = 'string',
 }
 
 --
@@ -1055,6 +1066,7 @@ box.schema.index.create = function(space_id, name, options)
             run_size_ratio = options.run_size_ratio,
             bloom_fpr = options.bloom_fpr,
             func = options.func,
+            predicate = options.predicate,
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -1279,6 +1291,17 @@ local iterator_gen_luac = function(param, state)
     end
 end
 
+local snapshot_scan_gen = function(param, state)
+    -- next() fetches batches of tuples from a worker thread and
+    -- may yield the calling fiber, see lbox_snapshot_scan_next().
+    local tuple = internal.snapshot_scan_next(state)
+    if tuple ~= nil then
+        return state, tuple -- new state, value
+    else
+        return nil
+    end
+end
+
 -- global struct port instance to use by select()/get()
 local port_tuple = ffi.new('struct port_tuple')
 local port_tuple_entry_t = ffi.typeof('struct port_tuple_entry')
@@ -1478,6 +1501,76 @@ base_index_mt.pairs_luac = function(index, key, opts)
         ffi.gc(cdata, builtin.box_iterator_free))
 end
 
+-- Consistent full scan: iterates a read view of the index taken
+-- at the call time, with index traversal offloaded to a worker
+-- thread. Concurrent writes are neither blocked nor visible.
+base_index_mt.snapshot_pairs = function(index)
+    check_index_arg(index, 'snapshot_pairs')
+    local scan = internal.snapshot_scan(index.space_id, index.id)
+    return fun.wrap(snapshot_scan_gen, nil,
+        ffi.gc(scan, internal.snapshot_scan_free))
+end
+
+-- Approximate keys splitting the index into count chunks of
+-- roughly equal size, estimated from the index block structure.
+-- May return fewer keys than asked (always an empty table for
+-- engines which can not estimate split points).
+base_index_mt.split = function(index, count)
+    check_index_arg(index, 'split')
+    if type(count) ~= 'number' or count < 2 then
+        box.error(box.error.PROC_LUA, "Usage: index:split(count)")
+    end
+    return internal.split(index.space_id, index.id, count)
+end
+
+-- Parallel full scan: split the index into roughly equal chunks
+-- and scan them with cooperating fibers, each feeding a common
+-- channel, so a consumer doing heavy per-tuple work in Lua
+-- overlaps with the index traversal of other chunks. The order
+-- of tuples is not the index order. The iterator must be drained
+-- (or the whole transaction finished) before the fibers go away,
+-- so it suits map-reduce style jobs, not point lookups.
+base_index_mt.pairs_parallel = function(index, opts)
+    check_index_arg(index, 'pairs_parallel')
+    local fiber = require('fiber')
+    local chunks = 4
+    if opts ~= nil and opts.chunks ~= nil then
+        chunks = opts.chunks
+    end
+    local keys = chunks >= 2 and index:split(chunks) or {}
+    local kd = require('key_def').new(index.parts)
+    local workers = #keys + 1
+    local channel = fiber.channel(workers * 2)
+    local DONE = {}
+    for i = 1, workers do
+        local first = keys[i - 1]
+        local last = keys[i]
+        fiber.create(function()
+            local scan_opts = first ~= nil and {iterator = 'GE'} or nil
+            for _, tuple in index:pairs(first, scan_opts) do
+                if last ~= nil and
+                   kd:compare_with_key(tuple, last) >= 0 then
+                    break
+                end
+                channel:put(tuple)
+            end
+            channel:put(DONE)
+        end)
+    end
+    local done = 0
+    local function gen(param, state)
+        while done < workers do
+            local msg = channel:get()
+            if msg ~= DONE then
+                return state + 1, msg
+            end
+            done = done + 1
+        end
+        return nil
+    end
+    return fun.wrap(gen, nil, 0)
+end
+
 -- index subtree size
 base_index_mt.count_ffi = function(index, key, opts)
     check_index_arg(index, 'count')
@@ -1515,6 +1608,22 @@ base_index_mt.get_luac = function(index, key)
     return internal.get(index.space_id, index.id, key)
 end
 
+-- Batch point lookup: get() for several keys at once. The engine
+-- overlaps the lookups, so a fan-out of N gets is much faster than
+-- N get() calls. The result table maps the key position to the
+-- found tuple; positions of missing keys are left nil.
+base_index_mt.get_multi = function(index, keys)
+    check_index_arg(index, 'get_multi')
+    if type(keys) ~= 'table' then
+        error("Usage index:get_multi({key1, key2, ...})")
+    end
+    local packed = {}
+    for i = 1, #keys do
+        packed[i] = keify(keys[i])
+    end
+    return internal.get_multi(index.space_id, index.id, packed)
+end
+
 local function check_select_opts(opts, key_is_nil)
     local offset = 0
     local limit = 4294967295
@@ -1569,6 +1678,17 @@ base_index_mt.delete = function(index, key)
     return internal.delete(index.space_id, index.id, keify(key));
 end
 
+-- Pagination position of a tuple: its index key extended with the
+-- implicit primary key tail. Passing the result as a select key
+-- with the 'GT' ('LT' for reverse scans) iterator resumes the scan
+-- right after the tuple in O(log n) instead of rewalking an offset.
+base_index_mt.tuple_pos = function(index, tuple)
+    check_index_arg(index, 'tuple_pos')
+    if tuple == nil then
+        box.error(box.error.PROC_LUA, "Usage: index:tuple_pos(tuple)")
+    end
+    return internal.tuple_pos(index.space_id, index.id, tuple)
+end
 base_index_mt.stat = function(index)
     return internal.stat(index.space_id, index.id);
 end
@@ -1630,6 +1750,35 @@ space_mt.bsize = function(space)
     return builtin.space_bsize(s)
 end
 
+--
+-- Per-space memory accounting. All the counters are maintained
+-- incrementally: tuple bytes on every replace, index bytes on
+-- every index extent allocation, so the call is O(index count)
+-- and never walks the data.
+--
+space_mt.stat = function(space)
+    check_space_arg(space, 'stat')
+    local s = builtin.space_by_id(space.id)
+    if s == nil then
+        box.error(box.error.NO_SUCH_SPACE, space.name)
+    end
+    local stat = {
+        tuple_bsize = tonumber(builtin.space_bsize(s)),
+        index_bsize = 0,
+        index = {},
+    }
+    for id, index in pairs(space.index) do
+        -- space.index lists every index twice: by id and by name.
+        if type(id) == 'number' then
+            local bsize = index:bsize()
+            stat.index[index.name] = bsize
+            stat.index_bsize = stat.index_bsize + bsize
+        end
+    end
+    stat.total_bsize = stat.tuple_bsize + stat.index_bsize
+    return stat
+end
+
 space_mt.get = function(space, key)
     check_space_arg(space, 'get')
     return check_primary_index(space):get(key)
@@ -1642,11 +1791,31 @@ space_mt.insert = function(space, tuple)
     check_space_arg(space, 'insert')
     return internal.insert(space.id, tuple);
 end
+-- Insert a tuple unless one with the same primary key exists;
+-- a duplicate is dismissed cheaply instead of raising an error.
+space_mt.insert_ignore = function(space, tuple)
+    check_space_arg(space, 'insert_ignore')
+    return internal.insert_ignore(space.id, tuple);
+end
 space_mt.replace = function(space, tuple)
     check_space_arg(space, 'replace')
     return internal.replace(space.id, tuple);
 end
 space_mt.put = space_mt.replace; -- put is an alias for replace
+-- Stream a file of rows straight into the space: large read
+-- chunks, multi-row transactions and native field conversion
+-- instead of a Lua insert per row. Returns the number of
+-- imported rows.
+space_mt.bulk_import = function(space, path, opts)
+    check_space_arg(space, 'bulk_import')
+    if type(path) ~= 'string' then
+        box.error(box.error.PROC_LUA,
+                  "Usage: space:bulk_import(path[, opts])")
+    end
+    opts = opts or {}
+    return internal.bulk_import(space.id, path, opts.format or 'msgpack',
+                                opts.batch_size or 0)
+end
 space_mt.update = function(space, key, ops)
     check_space_arg(space, 'update')
     return check_primary_index(space):update(key, ops)
@@ -1699,6 +1868,15 @@ space_mt.pairs = function(space, key, opts)
 end
 space_mt.__pairs = space_mt.pairs -- Lua 5.2 compatibility
 space_mt.__ipairs = space_mt.pairs -- Lua 5.2 compatibility
+space_mt.snapshot_pairs = function(space)
+    check_space_arg(space, 'snapshot_pairs')
+    local pk = space.index[0]
+    if pk == nil then
+        -- empty space without indexes, return empty iterator
+        return fun.iter({})
+    end
+    return pk:snapshot_pairs()
+end
 space_mt.truncate = function(space)
     check_space_arg(space, 'truncate')
     return internal.truncate(space.id)
@@ -207,6 +207,34 @@ lbox_session_su(struct lua_State *L)
 	return lua_gettop(L) - 1;
 }
 
+/**
+ * Get or set the scheduling priority of the current session.
+ * Requests of a 'low' priority session may be deferred when the
+ * tx thread is congested, see net_defer_latency in box.cfg.
+ * Without arguments returns the current priority, 'normal' or
+ * 'low'. Per-user policies can be implemented by switching the
+ * priority in a box.session.on_auth trigger.
+ */
+static int
+lbox_session_priority(struct lua_State *L)
+{
+	struct session *session = current_session();
+	if (lua_gettop(L) < 1) {
+		lua_pushstring(L, session->is_low_priority ?
+			       "low" : "normal");
+		return 1;
+	}
+	const char *priority = luaL_checkstring(L, 1);
+	if (strcmp(priority, "low") == 0)
+		session->is_low_priority = true;
+	else if (strcmp(priority, "normal") == 0)
+		session->is_low_priority = false;
+	else
+		luaL_error(L, "session.priority(): "
+			   "expected 'normal' or 'low'");
+	return 0;
+}
+
 /**
  * Check whether or not a session exists.
  */
@@ -467,6 +495,7 @@ box_lua_session_init(struct lua_State *L)
 		{"user", lbox_session_user},
 		{"effective_user", lbox_session_effective_user},
 		{"su", lbox_session_su},
+		{"priority", lbox_session_priority},
 		{"fd", lbox_session_fd},
 		{"exists", lbox_session_exists},
 		{"peer", lbox_session_peer},
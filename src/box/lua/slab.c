@@ -30,6 +30,8 @@
  */
 #include "trivia/util.h"
 
+#include <stdbool.h>
+
 #include "box/lua/slab.h"
 #include "lua/utils.h"
 
@@ -41,9 +43,43 @@
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
+#include "mempool_registry.h"
 #include "box/engine.h"
 #include "box/memtx_engine.h"
 
+/**
+ * How many bytes of the arena mapping the kernel currently backs
+ * with transparent huge pages. Parsed from /proc/self/smaps, so
+ * returns 0 on systems without it. The arena is a single mmap()
+ * and box.slab.info() is a monitoring call, so one pass over
+ * smaps per call is acceptable.
+ */
+static uint64_t
+arena_hugepage_bytes(const struct slab_arena *arena)
+{
+	if (arena->arena == NULL)
+		return 0;
+	uintptr_t start = (uintptr_t) arena->arena;
+	uintptr_t end = start + arena->prealloc;
+	FILE *f = fopen("/proc/self/smaps", "r");
+	if (f == NULL)
+		return 0;
+	uint64_t huge = 0;
+	bool in_arena = false;
+	char line[256];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		unsigned long long vm_start, vm_end, kb;
+		if (sscanf(line, "%llx-%llx ", &vm_start, &vm_end) == 2) {
+			in_arena = vm_start < end && vm_end > start;
+		} else if (in_arena &&
+			   sscanf(line, "AnonHugePages: %llu kB", &kb) == 1) {
+			huge += kb << 10;
+		}
+	}
+	fclose(f);
+	return huge;
+}
+
 static int
 small_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
 {
@@ -198,6 +234,15 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	/*
+	 * Tuples above the huge tuple threshold live in dedicated
+	 * malloc()ed blocks outside the arena. They are charged to
+	 * the quota, so quota_used includes this value.
+	 */
+	lua_pushstring(L, "huge_tuples_used");
+	luaL_pushuint64(L, memtx->huge_tuple_mem);
+	lua_settable(L, -3);
+
 	/*
 	 * This is pretty much the same as
 	 * box.cfg.slab_alloc_arena, but in bytes
@@ -228,6 +273,26 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	/*
+	 * Huge page coverage of the arena mapping. The arena is
+	 * madvise()d with MADV_HUGEPAGE at creation, but actual
+	 * backing depends on system THP settings and memory
+	 * fragmentation; a low ratio on a big arena means extra
+	 * TLB misses on every tuple access.
+	 */
+	uint64_t hugepages = arena_hugepage_bytes(&memtx->arena);
+	lua_pushstring(L, "arena_hugepages");
+	luaL_pushuint64(L, hugepages);
+	lua_settable(L, -3);
+
+	ratio = 100 * ((double) hugepages /
+		       ((double) memtx->arena.prealloc + 0.0001));
+	snprintf(ratio_buf, sizeof(ratio_buf), "%0.1lf%%", ratio);
+
+	lua_pushstring(L, "arena_hugepages_ratio");
+	lua_pushstring(L, ratio_buf);
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -254,6 +319,53 @@ lbox_runtime_info(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_memory_info_cb(const char *name, const struct mempool_stats *stats,
+		    size_t max_used, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+
+	lua_pushstring(L, name);
+	lua_newtable(L);
+	luaL_setmaphint(L, -1);
+
+	lua_pushstring(L, "item_size");
+	luaL_pushuint64(L, stats->objsize);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "item_count");
+	luaL_pushuint64(L, stats->objcount);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "mem_used");
+	luaL_pushuint64(L, stats->totals.used);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "mem_free");
+	luaL_pushuint64(L, stats->totals.total - stats->totals.used);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "high_watermark");
+	luaL_pushuint64(L, max_used);
+	lua_settable(L, -3);
+
+	lua_settable(L, -3);
+	return 0;
+}
+
+/**
+ * Per-pool memory usage, keyed by the name the pool was
+ * registered under. Unlike box.slab.stats(), which aggregates by
+ * item size, this attributes memory to the owning subsystem.
+ */
+static int
+lbox_memory_info(struct lua_State *L)
+{
+	lua_newtable(L);
+	mempool_registry_foreach(lbox_memory_info_cb, L);
+	return 1;
+}
+
 static int
 lbox_slab_check(MAYBE_UNUSED struct lua_State *L)
 {
@@ -295,4 +407,11 @@ box_lua_slab_init(struct lua_State *L)
 	lua_settable(L, -3); /* box.runtime */
 
 	lua_pop(L, 1); /* box. */
+
+	static const struct luaL_Reg memorylib_internal[] = {
+		{"memory", lbox_memory_info},
+		{NULL, NULL}
+	};
+	luaL_register(L, "box.internal", memorylib_internal);
+	lua_pop(L, 1); /* box.internal */
 }
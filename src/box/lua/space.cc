@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "box/ck_constraint.h"
+#include "box/lua/init.h"
 #include "box/lua/space.h"
 #include "box/lua/tuple.h"
 #include "box/lua/key_def.h"
@@ -129,6 +130,29 @@ lbox_space_on_replace(struct lua_State *L)
 				  lbox_push_txn_stmt, NULL);
 }
 
+/**
+ * Set/Reset/Get space.on_replace_batch trigger. Unlike on_replace
+ * it is run once per committed transaction and receives an
+ * iterator over the transaction statements, same as box.on_commit.
+ */
+static int
+lbox_space_on_replace_batch(struct lua_State *L)
+{
+	int top = lua_gettop(L);
+
+	if (top < 1 || !lua_istable(L, 1)) {
+		luaL_error(L,
+	   "usage: space:on_replace_batch(function | nil, [function | nil])");
+	}
+	lua_getfield(L, 1, "id"); /* Get space id. */
+	uint32_t id = lua_tonumber(L, lua_gettop(L));
+	struct space *space = space_cache_find_xc(id);
+	lua_pop(L, 1);
+
+	return lbox_trigger_reset(L, 3, &space->on_replace_batch,
+				  lbox_push_txn, NULL);
+}
+
 /**
  * Set/Reset/Get space.before_replace trigger
  */
@@ -243,6 +267,11 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 	lua_pushboolean(L, space_is_temporary(space));
 	lua_settable(L, i);
 
+	/* space.wal_disabled */
+	lua_pushstring(L, "wal_disabled");
+	lua_pushboolean(L, space_is_wal_disabled(space));
+	lua_settable(L, i);
+
 	/* space.name */
 	lua_pushstring(L, "name");
 	lua_pushstring(L, space_name(space));
@@ -263,6 +292,11 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
         lua_pushcfunction(L, lbox_space_on_replace);
         lua_settable(L, i);
 
+        /* space:on_replace_batch */
+        lua_pushstring(L, "on_replace_batch");
+        lua_pushcfunction(L, lbox_space_on_replace_batch);
+        lua_settable(L, i);
+
         /* space:before_replace */
         lua_pushstring(L, "before_replace");
         lua_pushcfunction(L, lbox_space_before_replace);
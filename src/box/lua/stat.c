@@ -33,6 +33,10 @@
 
 #include <string.h>
 #include <rmean.h>
+#include "latency.h"
+#include "trivia/util.h"
+#include "cbus.h"
+#include "flightrec.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -43,14 +47,17 @@
 #include "box/engine.h"
 #include "box/vinyl.h"
 #include "box/sql.h"
+#include "box/txn.h"
+#include "box/region_profile.h"
+#include "box/stat_snapshot.h"
+#include "box/wal.h"
 #include "info/info.h"
 #include "lua/info.h"
+#include "lua/msgpack.h"
 #include "lua/utils.h"
 
 extern struct rmean *rmean_box;
 extern struct rmean *rmean_error;
-/** network statistics (iproto & cbus) */
-extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -65,6 +72,58 @@ fill_stat_item(struct lua_State *L, int rps, int64_t total)
 	lua_settable(L, -3);
 }
 
+/**
+ * Fill the table on top of the stack with request latency
+ * percentiles (seconds), as accounted by the network threads.
+ */
+static void
+fill_latency_item(struct lua_State *L, struct latency *latency)
+{
+	static const int pcts[] = {50, 90, 95, 99, 100};
+	static const char *pct_names[] = {"p50", "p90", "p95", "p99", "max"};
+
+	lua_pushstring(L, "latency");
+	lua_newtable(L);
+	for (unsigned i = 0; i < lengthof(pcts); i++) {
+		lua_pushstring(L, pct_names[i]);
+		lua_pushnumber(L, latency_get(latency, pcts[i]));
+		lua_settable(L, -3);
+	}
+	lua_settable(L, -3);
+}
+
+/**
+ * An iproto_latency_foreach() callback: add a latency subtable
+ * to the request type table created by set_stat_item().
+ */
+static int
+set_stat_latency_item(const char *name, struct latency *latency, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+
+	lua_getfield(L, -1, name);
+	if (lua_istable(L, -1))
+		fill_latency_item(L, latency);
+	lua_pop(L, 1);
+	return 0;
+}
+
+/**
+ * An iproto_latency_foreach() callback used to handle access to
+ * e.g. box.stat.DELETE. Expects the request type table pushed by
+ * seek_stat_item() on top of the stack and the key below it.
+ */
+static int
+seek_stat_latency_item(const char *name, struct latency *latency, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+	if (strcmp(name, lua_tostring(L, -2)) != 0)
+		return 0;
+
+	fill_latency_item(L, latency);
+	return 1;
+}
+
 static int
 set_stat_item(const char *name, int rps, int64_t total, void *cb_ctx)
 {
@@ -102,8 +161,10 @@ lbox_stat_index(struct lua_State *L)
 {
 	luaL_checkstring(L, -1);
 	int res = rmean_foreach(rmean_box, seek_stat_item, L);
-	if (res)
+	if (res) {
+		iproto_latency_foreach(seek_stat_latency_item, L);
 		return res;
+	}
 	return rmean_foreach(rmean_error, seek_stat_item, L);
 }
 
@@ -113,6 +174,7 @@ lbox_stat_call(struct lua_State *L)
 	lua_newtable(L);
 	rmean_foreach(rmean_box, set_stat_item, L);
 	rmean_foreach(rmean_error, set_stat_item, L);
+	iproto_latency_foreach(set_stat_latency_item, L);
 	return 1;
 }
 
@@ -136,6 +198,41 @@ lbox_stat_reset(struct lua_State *L)
 	return 0;
 }
 
+/**
+ * Push a table of cbus pipe delivery metrics of the iproto
+ * threads to a Lua stack: for each of the 'tx' and 'net' bound
+ * pipes - number of input flushes, messages and consumer
+ * wakeups since start.
+ */
+static void
+push_net_pipe_stat(struct lua_State *L)
+{
+	struct cpipe_stat tx_stat, net_stat;
+	iproto_pipe_stat(&tx_stat, &net_stat);
+	const struct {
+		const char *name;
+		const struct cpipe_stat *stat;
+	} pipes[] = {
+		{"tx", &tx_stat},
+		{"net", &net_stat},
+	};
+	lua_newtable(L);
+	for (unsigned i = 0; i < lengthof(pipes); i++) {
+		lua_pushstring(L, pipes[i].name);
+		lua_newtable(L);
+		lua_pushstring(L, "flushes");
+		lua_pushnumber(L, pipes[i].stat->flushes);
+		lua_rawset(L, -3);
+		lua_pushstring(L, "messages");
+		lua_pushnumber(L, pipes[i].stat->messages);
+		lua_rawset(L, -3);
+		lua_pushstring(L, "wakeups");
+		lua_pushnumber(L, pipes[i].stat->wakeups);
+		lua_rawset(L, -3);
+		lua_rawset(L, -3);
+	}
+}
+
 /**
  * Push a table with a network metric to a Lua stack.
  *
@@ -148,7 +245,11 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	const char *key = luaL_checkstring(L, -1);
-	if (rmean_foreach(rmean_net, seek_stat_item, L) == 0)
+	if (strcmp(key, "PIPES") == 0) {
+		push_net_pipe_stat(L);
+		return 1;
+	}
+	if (iproto_rmean_foreach(seek_stat_item, L) == 0)
 		return 0;
 
 	if (strcmp(key, "CONNECTIONS") == 0) {
@@ -170,7 +271,8 @@ lbox_stat_net_index(struct lua_State *L)
  *
  * - SENT (packets): total, rps;
  * - RECEIVED (packets): total, rps;
- * - CONNECTIONS: current.
+ * - CONNECTIONS: current;
+ * - PIPES: per cbus pipe flushes, messages, wakeups.
  *
  * These fields have the following meaning:
  *
@@ -183,7 +285,7 @@ static int
 lbox_stat_net_call(struct lua_State *L)
 {
 	lua_newtable(L);
-	rmean_foreach(rmean_net, set_stat_item, L);
+	iproto_rmean_foreach(set_stat_item, L);
 
 	lua_pushstring(L, "CONNECTIONS");
 	lua_rawget(L, -2);
@@ -199,6 +301,163 @@ lbox_stat_net_call(struct lua_State *L)
 	lua_rawset(L, -3);
 	lua_pop(L, 1);
 
+	lua_pushstring(L, "PIPES");
+	push_net_pipe_stat(L);
+	lua_rawset(L, -3);
+
+	return 1;
+}
+
+/**
+ * Push a table of WAL group commit metrics to a Lua stack.
+ *
+ * Metrics are:
+ *
+ * - flushes -- number of xlog flushes since start;
+ * - entries -- number of journal entries written since start;
+ * - flush_latency -- moving average of a flush duration, seconds;
+ * - flush_delay -- current artificial group commit delay, seconds;
+ * - batch_size_hist -- histogram of entries per flush, bucket i
+ *   counts flushes of [2^(i-1), 2^i) entries.
+ */
+static int
+lbox_stat_wal(struct lua_State *L)
+{
+	struct wal_stat stat;
+	wal_stat(&stat);
+	lua_newtable(L);
+	lua_pushstring(L, "flushes");
+	lua_pushnumber(L, stat.flush_count);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "entries");
+	lua_pushnumber(L, stat.entry_count);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "flush_latency");
+	lua_pushnumber(L, stat.flush_latency);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "flush_delay");
+	lua_pushnumber(L, stat.flush_delay);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "batch_size_hist");
+	lua_newtable(L);
+	for (int i = 0; i < WAL_BATCH_HIST_BUCKETS; i++) {
+		lua_pushnumber(L, stat.batch_size_hist[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_rawset(L, -3);
+	return 1;
+}
+
+/**
+ * Push a table of transaction memory metrics to a Lua stack.
+ *
+ * Metrics are:
+ *
+ * - txns -- number of transactions finished since start;
+ * - max_footprint -- high-water mark of a single transaction
+ *   region footprint, bytes;
+ * - arena_reserve -- region reserve kept in cached transactions,
+ *   a moving percentile of recent transaction footprints, bytes.
+ */
+static int
+lbox_stat_txn(struct lua_State *L)
+{
+	struct txn_mem_stat stat;
+	txn_mem_stat(&stat);
+	lua_newtable(L);
+	lua_pushstring(L, "txns");
+	lua_pushnumber(L, stat.txn_count);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "max_footprint");
+	lua_pushnumber(L, stat.max_footprint);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "arena_reserve");
+	lua_pushnumber(L, stat.arena_reserve);
+	lua_rawset(L, -3);
+	return 1;
+}
+
+/**
+ * A region_profile_foreach() callback: push one profile table
+ * keyed by the profile name.
+ */
+static int
+set_region_profile_item(struct region_profile *profile, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+	lua_pushstring(L, profile->name);
+	lua_newtable(L);
+	lua_pushstring(L, "reserve");
+	lua_pushnumber(L, profile->reserve);
+	lua_rawset(L, -3);
+	lua_pushstring(L, "max_footprint");
+	lua_pushnumber(L, profile->max_footprint);
+	lua_rawset(L, -3);
+	if (profile->rmean != NULL)
+		rmean_foreach(profile->rmean, set_stat_item, L);
+	lua_settable(L, -3);
+	return 0;
+}
+
+/**
+ * Push a table of region retention profiles to a Lua stack,
+ * box.stat.region().
+ *
+ * For every profile (iproto_msg, txn, applier):
+ *
+ * - reserve -- current retention target, bytes;
+ * - max_footprint -- largest single cycle footprint seen, bytes;
+ * - ALLOC -- rate and total of finished region cycles;
+ * - FALLBACK -- rate and total of cycles that outgrew the
+ *   reserve and had to take new slabs from the slab cache.
+ */
+static int
+lbox_stat_region(struct lua_State *L)
+{
+	lua_newtable(L);
+	region_profile_foreach(set_region_profile_item, L);
+	return 1;
+}
+
+/**
+ * Dump the flight recorder rings of all cords to the log. Useful
+ * right after a latency spike to see what the tx, WAL and net
+ * threads were doing.
+ */
+static int
+lbox_stat_flightrec(struct lua_State *L)
+{
+	(void)L;
+	flightrec_dump();
+	return 0;
+}
+
+/**
+ * Push the pre-rendered statistics snapshot, box.stat.snapshot().
+ *
+ * The snapshot is rendered by a background fiber once per second,
+ * so this call costs a buffer decode instead of a walk over every
+ * counter, no matter how many collectors poll it. With a truthy
+ * argument the raw msgpack string is pushed instead of a decoded
+ * table - handy for collectors that ship it over the wire as is.
+ *
+ * Returns nil if no snapshot has been rendered yet.
+ */
+static int
+lbox_stat_snapshot(struct lua_State *L)
+{
+	const char *data;
+	uint32_t size;
+	if (stat_snapshot_get(&data, &size) != 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	if (lua_gettop(L) >= 1 && lua_toboolean(L, 1)) {
+		lua_pushlstring(L, data, size);
+		return 1;
+	}
+	const char *p = data;
+	luamp_decode(L, luaL_msgpack_default, &p);
 	return 1;
 }
 
@@ -231,6 +490,11 @@ box_lua_stat_init(struct lua_State *L)
 		{"vinyl", lbox_stat_vinyl},
 		{"reset", lbox_stat_reset},
 		{"sql", lbox_stat_sql},
+		{"txn", lbox_stat_txn},
+		{"wal", lbox_stat_wal},
+		{"region", lbox_stat_region},
+		{"snapshot", lbox_stat_snapshot},
+		{"flightrec", lbox_stat_flightrec},
 		{NULL, NULL}
 	};
 
@@ -30,6 +30,10 @@ box_tuple_to_buf(box_tuple_t *tuple, char *buf, size_t size);
 const char *
 box_tuple_field(box_tuple_t *tuple, uint32_t i);
 
+int
+box_tuple_fieldno_by_name(box_tuple_t *tuple, const char *name,
+                          uint32_t name_len, uint32_t *fieldno);
+
 typedef struct tuple_iterator box_tuple_iterator_t;
 
 box_tuple_iterator_t *
@@ -305,6 +309,10 @@ local tuple_field = function(tuple, field_n)
     return (msgpackffi.decode_unchecked(field))
 end
 
+-- Scratch buffer for box_tuple_fieldno_by_name(), allocated once
+-- so a name lookup produces no garbage of its own.
+local fieldno_buf = ffi.new('uint32_t[1]')
+
 ffi.metatype(tuple_t, {
     __len = function(tuple)
         return builtin.box_tuple_field_count(tuple)
@@ -314,6 +322,23 @@ ffi.metatype(tuple_t, {
         if type(key) == "number" then
             return tuple_field(tuple, key)
         elseif type(key) == "string" then
+            -- Fast path: resolve a plain field name through the
+            -- format dictionary with one FFI call and fetch the
+            -- field like a numeric access. Unlike the JSON path
+            -- lookup below it does not cross the Lua/C stack
+            -- boundary, compiles in the JIT and allocates nothing
+            -- but the decoded value.
+            if builtin.box_tuple_fieldno_by_name(tuple, key, #key,
+                                                 fieldno_buf) == 0 then
+                local res = tuple_field(tuple, fieldno_buf[0] + 1)
+                if res ~= nil then
+                    return res
+                end
+                -- The name is known to the format but the field
+                -- is missing from this tuple; same as below,
+                -- fall back to the method table.
+                return methods[key]
+            end
             -- Try to get a field by JSON path. If it was not
             -- found (rc ~= 0) then return a method from the
             -- vtable. If a collision occurred, then fields have
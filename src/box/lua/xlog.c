@@ -288,6 +288,8 @@ lbox_xlog_parser_open_pairs(struct lua_State *L)
 	if (xlog_cursor_open(cur, filename) < 0) {
 		return luaT_error(L);
 	}
+	/* Scans are sequential - pipeline reading and decoding. */
+	xlog_cursor_enable_prefetch(cur);
 	if (strncmp(cur->meta.filetype, "SNAP", 4) != 0 &&
 	    strncmp(cur->meta.filetype, "XLOG", 4) != 0 &&
 	    strncmp(cur->meta.filetype, "RUN", 3) != 0 &&
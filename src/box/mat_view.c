@@ -0,0 +1,302 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "mat_view.h"
+
+#include <stdlib.h>
+
+#include <msgpuck.h>
+#include <small/rlist.h>
+
+#include "box.h"
+#include "diag.h"
+#include "errcode.h"
+#include "error.h"
+#include "fiber.h"
+#include "index.h"
+#include "schema.h"
+#include "space.h"
+#include "trigger.h"
+#include "trivia/util.h"
+#include "tuple.h"
+#include "txn.h"
+
+/**
+ * A registered materialized aggregate view, see mat_view.h for
+ * the semantics.
+ */
+struct mat_view {
+	/** Link in the global list of views. */
+	struct rlist link;
+	/** Aggregated space. */
+	uint32_t source_id;
+	/** Space holding the {key, count, sum} rows. */
+	uint32_t target_id;
+	/** Source field to group by. */
+	uint32_t key_fieldno;
+	/** Source field to sum. */
+	uint32_t sum_fieldno;
+	/** on_replace trigger installed on the source space. */
+	struct trigger on_replace;
+};
+
+/** All registered views. */
+static RLIST_HEAD(mat_views);
+
+/** Fetch the group key of a source tuple as raw MsgPack. */
+static int
+mat_view_tuple_key(struct mat_view *view, struct tuple *tuple,
+		   const char **key, uint32_t *key_len)
+{
+	const char *field = tuple_field(tuple, view->key_fieldno);
+	if (field == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_FIELD_NO,
+			 view->key_fieldno + TUPLE_INDEX_BASE);
+		return -1;
+	}
+	const char *end = field;
+	mp_next(&end);
+	*key = field;
+	*key_len = end - field;
+	return 0;
+}
+
+/** Fetch the measure of a source tuple as a signed integer. */
+static int
+mat_view_tuple_sum(struct mat_view *view, struct tuple *tuple, int64_t *sum)
+{
+	const char *field = tuple_field(tuple, view->sum_fieldno);
+	if (field == NULL) {
+		diag_set(ClientError, ER_NO_SUCH_FIELD_NO,
+			 view->sum_fieldno + TUPLE_INDEX_BASE);
+		return -1;
+	}
+	if (mp_typeof(*field) == MP_UINT) {
+		*sum = (int64_t) mp_decode_uint(&field);
+	} else if (mp_typeof(*field) == MP_INT) {
+		*sum = mp_decode_int(&field);
+	} else {
+		diag_set(ClientError, ER_FIELD_TYPE,
+			 int2str(view->sum_fieldno + TUPLE_INDEX_BASE),
+			 "integer");
+		return -1;
+	}
+	return 0;
+}
+
+/** Encode a signed delta, using the shortest MsgPack type. */
+static inline char *
+mat_view_encode_delta(char *data, int64_t delta)
+{
+	if (delta >= 0)
+		return mp_encode_uint(data, delta);
+	return mp_encode_int(data, delta);
+}
+
+/**
+ * Fold one source tuple in (count_delta = 1) or out
+ * (count_delta = -1) of its group row with a single upsert:
+ * the inserted tuple covers a previously unseen group, the
+ * update ops fold the delta into an existing one. A group whose
+ * count drops to zero is deleted from the target.
+ */
+static int
+mat_view_apply(struct mat_view *view, const char *key, uint32_t key_len,
+	       int64_t count_delta, int64_t sum_delta)
+{
+	struct region *gc = &fiber()->gc;
+	size_t svp = region_used(gc);
+	size_t size = mp_sizeof_array(3) + key_len + 2 * 9 +
+		mp_sizeof_array(2) +
+		2 * (mp_sizeof_array(3) + mp_sizeof_str(1) +
+		     mp_sizeof_uint(2) + 9);
+	char *tuple = region_alloc(gc, size);
+	if (tuple == NULL) {
+		diag_set(OutOfMemory, size, "region", "mat_view delta");
+		return -1;
+	}
+	char *data = mp_encode_array(tuple, 3);
+	memcpy(data, key, key_len);
+	data += key_len;
+	data = mat_view_encode_delta(data, count_delta);
+	data = mat_view_encode_delta(data, sum_delta);
+	const char *tuple_end = data;
+	char *ops = data;
+	data = mp_encode_array(data, 2);
+	data = mp_encode_array(data, 3);
+	data = mp_encode_str(data, "+", 1);
+	data = mp_encode_uint(data, 1);
+	data = mat_view_encode_delta(data, count_delta);
+	data = mp_encode_array(data, 3);
+	data = mp_encode_str(data, "+", 1);
+	data = mp_encode_uint(data, 2);
+	data = mat_view_encode_delta(data, sum_delta);
+	const char *ops_end = data;
+	if (box_upsert(view->target_id, 0, tuple, tuple_end, ops, ops_end,
+		       0, NULL) != 0)
+		return -1;
+	if (count_delta >= 0) {
+		region_truncate(gc, svp);
+		return 0;
+	}
+	/* The group may have just lost its last tuple. */
+	size = mp_sizeof_array(1) + key_len;
+	char *index_key = region_alloc(gc, size);
+	if (index_key == NULL) {
+		diag_set(OutOfMemory, size, "region", "mat_view key");
+		return -1;
+	}
+	data = mp_encode_array(index_key, 1);
+	memcpy(data, key, key_len);
+	const char *index_key_end = data + key_len;
+	struct tuple *row;
+	if (box_index_get(view->target_id, 0, index_key, index_key_end,
+			  &row) != 0)
+		return -1;
+	if (row != NULL) {
+		const char *count = tuple_field(row, 1);
+		if (count != NULL && mp_typeof(*count) == MP_UINT &&
+		    mp_decode_uint(&count) == 0 &&
+		    box_delete(view->target_id, 0, index_key, index_key_end,
+			       NULL) != 0)
+			return -1;
+	}
+	region_truncate(gc, svp);
+	return 0;
+}
+
+/** Fold the current statement's delta into the view. */
+static int
+mat_view_on_replace(struct trigger *trigger, void *event)
+{
+	struct mat_view *view = (struct mat_view *) trigger->data;
+	struct txn *txn = (struct txn *) event;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	assert(stmt != NULL);
+	const char *key;
+	uint32_t key_len;
+	int64_t sum;
+	if (stmt->old_tuple != NULL) {
+		if (mat_view_tuple_key(view, stmt->old_tuple, &key,
+				       &key_len) != 0 ||
+		    mat_view_tuple_sum(view, stmt->old_tuple, &sum) != 0 ||
+		    mat_view_apply(view, key, key_len, -1, -sum) != 0)
+			return -1;
+	}
+	if (stmt->new_tuple != NULL) {
+		if (mat_view_tuple_key(view, stmt->new_tuple, &key,
+				       &key_len) != 0 ||
+		    mat_view_tuple_sum(view, stmt->new_tuple, &sum) != 0 ||
+		    mat_view_apply(view, key, key_len, 1, sum) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/** Look up a registered view by its space pair. */
+static struct mat_view *
+mat_view_find(uint32_t source_id, uint32_t target_id)
+{
+	struct mat_view *view;
+	rlist_foreach_entry(view, &mat_views, link) {
+		if (view->source_id == source_id &&
+		    view->target_id == target_id)
+			return view;
+	}
+	return NULL;
+}
+
+int
+mat_view_create(uint32_t source_id, uint32_t target_id,
+		uint32_t key_fieldno, uint32_t sum_fieldno)
+{
+	if (source_id == target_id) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "materialized view must target another space");
+		return -1;
+	}
+	struct space *source = space_cache_find(source_id);
+	if (source == NULL)
+		return -1;
+	if (space_cache_find(target_id) == NULL)
+		return -1;
+	if (mat_view_find(source_id, target_id) != NULL) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "materialized view is already registered");
+		return -1;
+	}
+	struct mat_view *view = (struct mat_view *) malloc(sizeof(*view));
+	if (view == NULL) {
+		diag_set(OutOfMemory, sizeof(*view), "malloc",
+			 "struct mat_view");
+		return -1;
+	}
+	view->source_id = source_id;
+	view->target_id = target_id;
+	view->key_fieldno = key_fieldno;
+	view->sum_fieldno = sum_fieldno;
+	trigger_create(&view->on_replace, mat_view_on_replace, view, NULL);
+	trigger_add(&source->on_replace, &view->on_replace);
+	rlist_add_tail_entry(&mat_views, view, link);
+	return 0;
+}
+
+/** Unregister a view and free its memory. */
+static void
+mat_view_delete(struct mat_view *view)
+{
+	trigger_clear(&view->on_replace);
+	rlist_del_entry(view, link);
+	free(view);
+}
+
+int
+mat_view_drop(uint32_t source_id, uint32_t target_id)
+{
+	struct mat_view *view = mat_view_find(source_id, target_id);
+	if (view == NULL) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 "no such materialized view");
+		return -1;
+	}
+	mat_view_delete(view);
+	return 0;
+}
+
+void
+mat_view_free(void)
+{
+	while (!rlist_empty(&mat_views)) {
+		struct mat_view *view = rlist_first_entry(&mat_views,
+							  struct mat_view,
+							  link);
+		mat_view_delete(view);
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef TARANTOOL_BOX_MAT_VIEW_H_INCLUDED
+#define TARANTOOL_BOX_MAT_VIEW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Materialized aggregate views.
+ *
+ * A view maintains one row per distinct group key of a source
+ * space in a target space, in the format {key, count, sum}:
+ * the number of source tuples in the group and the sum of an
+ * integer measure field. Maintenance is incremental: an
+ * on_replace trigger on the source space folds each statement's
+ * delta into the target with an upsert, inside the same
+ * transaction, so the view commits, rolls back, is journaled and
+ * replicated together with the source rows. A group whose count
+ * drops to zero is removed from the target.
+ *
+ * The registration itself is not persisted: re-register views
+ * after box.cfg(), like Lua on_replace triggers. Since the
+ * maintenance rows travel through the WAL and replication, the
+ * target space stays consistent across restarts without the
+ * trigger, and replicas must not register the view themselves.
+ */
+
+/**
+ * Register a materialized aggregate view.
+ *
+ * @param source_id space to aggregate
+ * @param target_id space receiving {key, count, sum} rows; its
+ *                  primary index must be over the first field
+ * @param key_fieldno zero-based source field to group by
+ * @param sum_fieldno zero-based source field to sum, must hold
+ *                    integers
+ *
+ * @retval 0 success
+ * @retval -1 error, see diag
+ */
+int
+mat_view_create(uint32_t source_id, uint32_t target_id,
+		uint32_t key_fieldno, uint32_t sum_fieldno);
+
+/**
+ * Unregister a materialized aggregate view. The target space and
+ * its rows are left intact.
+ *
+ * @retval 0 success
+ * @retval -1 no such view registered
+ */
+int
+mat_view_drop(uint32_t source_id, uint32_t target_id);
+
+/** Unregister all views. Called at shutdown. */
+void
+mat_view_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MAT_VIEW_H_INCLUDED */
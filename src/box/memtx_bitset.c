@@ -486,7 +486,9 @@ static const struct index_vtab memtx_bitset_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_bitset_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ generic_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ memtx_bitset_index_replace,
 	/* .create_iterator = */ memtx_bitset_index_create_iterator,
 	/* .create_snapshot_iterator = */
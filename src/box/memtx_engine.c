@@ -31,16 +31,28 @@
 #include "memtx_engine.h"
 #include "memtx_space.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 #include <small/quota.h>
 #include <small/small.h>
 #include <small/mempool.h>
 
 #include "fiber.h"
 #include "errinj.h"
+#include "mempool_registry.h"
 #include "coio_file.h"
+#include "fio.h"
 #include "tuple.h"
+#include "tuple_value_dict.h"
 #include "txn.h"
 #include "memtx_tree.h"
+#include "memtx_tx.h"
 #include "iproto_constants.h"
 #include "xrow.h"
 #include "xstream.h"
@@ -48,10 +60,24 @@
 #include "replication.h"
 #include "schema.h"
 #include "gc.h"
+#include "wal.h"
+#include "salad/stailq.h"
+#include "assoc.h"
 
 /* sync snapshot every 16MB */
 #define SNAP_SYNC_INTERVAL	(1 << 24)
 
+enum {
+	/**
+	 * Maximum number of incremental snapshots stacked on top
+	 * of a full one. When the chain grows this long, the
+	 * next checkpoint is forced to be a full snapshot, to
+	 * bound both recovery time and the number of files a
+	 * checkpoint consists of.
+	 */
+	MEMTX_SNAP_CHAIN_MAX = 8,
+};
+
 static void
 checkpoint_cancel(struct checkpoint *ckpt);
 
@@ -74,6 +100,12 @@ enum {
 	OBJSIZE_MIN = 16,
 	SLAB_SIZE = 16 * 1024 * 1024,
 	MAX_TUPLE_SIZE = 1 * 1024 * 1024,
+	/**
+	 * Tuples bigger than this are allocated in dedicated
+	 * malloc()ed blocks instead of the slab arena, see
+	 * memtx_huge_tuple_alloc().
+	 */
+	HUGE_TUPLE_THRESHOLD = 128 * 1024,
 };
 
 static int
@@ -84,16 +116,32 @@ memtx_end_build_primary_key(struct space *space, void *param)
 	    memtx_space->replace == memtx_space_replace_all_keys)
 		return 0;
 
-	index_end_build(space->index[0]);
+	if (index_end_build(space->index[0]) != 0)
+		return -1;
 	memtx_space->replace = memtx_space_replace_primary_key;
 	return 0;
 }
 
+/** Build one secondary index, see memtx_build_secondary_keys(). */
+static int
+memtx_build_secondary_f(va_list ap)
+{
+	struct index *index = va_arg(ap, struct index *);
+	struct index *pk = va_arg(ap, struct index *);
+	return index_build(index, pk);
+}
+
 /**
  * Secondary indexes are built in bulk after all data is
  * recovered. This function enables secondary keys on a space.
  * Data dictionary spaces are an exception, they are fully
  * built right from the start.
+ *
+ * Each index is built in its own fiber. Filling a build array
+ * and constructing a tree from it happen in the tx thread
+ * anyway, but a tree index yields while its sort runs in a
+ * sorter thread, so the sorts of all secondary indexes of the
+ * space - the lion's share of the build time - run in parallel.
  */
 static int
 memtx_build_secondary_keys(struct space *space, void *param)
@@ -113,10 +161,29 @@ memtx_build_secondary_keys(struct space *space, void *param)
 				 space_name(space));
 		}
 
-		for (uint32_t j = 1; j < space->index_count; j++) {
-			if (index_build(space->index[j], pk) < 0)
-				return -1;
+		struct fiber *builders[BOX_INDEX_MAX];
+		uint32_t builder_count = 0;
+		int rc = 0;
+		for (uint32_t j = 1; j < space->index_count && rc == 0; j++) {
+			struct fiber *builder =
+				fiber_new("memtx.index.build",
+					  memtx_build_secondary_f);
+			if (builder == NULL) {
+				/* Can't start a fiber - build inline. */
+				diag_clear(diag_get());
+				rc = index_build(space->index[j], pk);
+				continue;
+			}
+			fiber_set_joinable(builder, true);
+			fiber_start(builder, space->index[j], pk);
+			builders[builder_count++] = builder;
+		}
+		for (uint32_t j = 0; j < builder_count; j++) {
+			if (fiber_join(builders[j]) != 0)
+				rc = -1;
 		}
+		if (rc != 0)
+			return -1;
 
 		if (n_tuples > 0) {
 			say_info("Space '%s': done", space_name(space));
@@ -134,6 +201,8 @@ memtx_engine_shutdown(struct engine *engine)
 		checkpoint_cancel(memtx->checkpoint);
 	if (memtx->replica_join_cord != NULL)
 		replica_join_cancel(memtx->replica_join_cord);
+	mempool_registry_remove(&memtx->iterator_pool);
+	mempool_registry_remove(&memtx->index_extent_pool);
 	mempool_destroy(&memtx->iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
 		mempool_destroy(&memtx->rtree_iterator_pool);
@@ -148,19 +217,260 @@ memtx_engine_shutdown(struct engine *engine)
 
 static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
-				  struct xrow_header *row);
+				  struct xrow_header *row,
+				  struct mh_i32ptr_t *seen, uint32_t file_no);
 
-int
-memtx_engine_recover_snapshot(struct memtx_engine *memtx,
-			      const struct vclock *vclock)
+enum {
+	/** Max rows per batch handed from the reader thread to tx. */
+	SNAP_RECOVERY_BATCH_ROWS = 1024,
+	/** Default capacity of a batch row body buffer. */
+	SNAP_RECOVERY_BATCH_DATA = 512 * 1024,
+	/** Max batches in flight before the reader thread blocks. */
+	SNAP_RECOVERY_QUEUE_MAX = 8,
+};
+
+/** A read-only memory mapping of a snapshot file. */
+struct snap_map {
+	/** Mapped bytes, NULL if the file is not mapped. */
+	char *data;
+	/** Size of the mapping. */
+	size_t size;
+};
+
+/**
+ * Map a snapshot read-only. The pages come in on demand, so
+ * recovery does not wait for the whole file and leaves cold
+ * parts of it to the OS page cache.
+ */
+static int
+snap_map_open(struct snap_map *map, const char *filename)
 {
-	/* Process existing snapshot */
-	say_info("recovery start");
-	int64_t signature = vclock_sum(vclock);
-	const char *filename = xdir_format_filename(&memtx->snap_dir,
-						    signature, NONE);
+	map->data = NULL;
+	map->size = 0;
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s' file", filename);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		diag_set(SystemError, "failed to stat '%s' file", filename);
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		diag_set(SystemError, "failed to mmap '%s' file", filename);
+		return -1;
+	}
+	/* Recovery reads the file front to back. */
+	(void) madvise(data, st.st_size, MADV_SEQUENTIAL);
+	map->data = data;
+	map->size = st.st_size;
+	return 0;
+}
 
-	say_info("recovering from `%s'", filename);
+/** Unmap a snapshot file. */
+static void
+snap_map_close(struct snap_map *map)
+{
+	if (map->data != NULL)
+		munmap(map->data, map->size);
+	map->data = NULL;
+}
+
+/** True if @a data points into the mapped file. */
+static inline bool
+snap_map_contains(struct snap_map *map, const void *data)
+{
+	return map->data != NULL && (const char *) data >= map->data &&
+	       (const char *) data < map->data + map->size;
+}
+
+/**
+ * A bunch of snapshot rows read, checksummed and decoded by the
+ * reader thread, ready to be applied in tx.
+ */
+struct snap_recovery_batch {
+	/** Link in snap_recovery::queue. */
+	struct stailq_entry next;
+	/** Number of decoded rows in the batch. */
+	int row_count;
+	/** Decoded headers. Row bodies point into @a data. */
+	struct xrow_header rows[SNAP_RECOVERY_BATCH_ROWS];
+	/** Capacity of the body buffer. */
+	size_t data_capacity;
+	/** Used part of the body buffer. */
+	size_t data_size;
+	/** Copies of row bodies. */
+	char data[0];
+};
+
+/**
+ * State of pipelined snapshot recovery: a reader thread reads the
+ * snapshot, verifies checksums, inflates compressed blocks and
+ * decodes row headers, while tx drains ready batches and applies
+ * the rows to spaces. The queue length is capped so that the
+ * reader can not run too far ahead of tx.
+ */
+struct snap_recovery {
+	/** Path to the snapshot file. */
+	const char *filename;
+	/** Copy of memtx_engine::force_recovery. */
+	bool force_recovery;
+	/** The reader thread. */
+	struct cord cord;
+	/** Guards all the fields below. */
+	pthread_mutex_t mutex;
+	/** Signalled when a batch is added to the queue. */
+	pthread_cond_t tx_cond;
+	/** Signalled when tx takes a batch off the queue. */
+	pthread_cond_t reader_cond;
+	/** Batches ready to be applied, in file order. */
+	struct stailq queue;
+	/** Number of batches in the queue. */
+	int queue_len;
+	/** Set when the reader has no more rows to hand over. */
+	bool is_eof;
+	/** Set by tx to stop the reader early on an error. */
+	bool is_aborted;
+	/** The snapshot had a proper EOF marker. */
+	bool has_eof_marker;
+	/**
+	 * Memory mapping of the snapshot, if mapping succeeded.
+	 * Owned by tx: batches may reference mapped bytes, so
+	 * the file is unmapped only after the last batch is
+	 * applied.
+	 */
+	struct snap_map map;
+};
+
+static struct snap_recovery_batch *
+snap_recovery_batch_new(size_t data_capacity)
+{
+	if (data_capacity < SNAP_RECOVERY_BATCH_DATA)
+		data_capacity = SNAP_RECOVERY_BATCH_DATA;
+	struct snap_recovery_batch *batch =
+		malloc(sizeof(*batch) + data_capacity);
+	if (batch == NULL) {
+		diag_set(OutOfMemory, sizeof(*batch) + data_capacity,
+			 "malloc", "snap_recovery_batch");
+		return NULL;
+	}
+	batch->row_count = 0;
+	batch->data_capacity = data_capacity;
+	batch->data_size = 0;
+	return batch;
+}
+
+/**
+ * Hand a complete batch over to tx, blocking if too many batches
+ * are already in flight. Returns -1 if tx aborted the recovery;
+ * the batch is freed in this case.
+ */
+static int
+snap_recovery_submit(struct snap_recovery *snap,
+		     struct snap_recovery_batch *batch)
+{
+	tt_pthread_mutex_lock(&snap->mutex);
+	while (snap->queue_len >= SNAP_RECOVERY_QUEUE_MAX &&
+	       !snap->is_aborted)
+		tt_pthread_cond_wait(&snap->reader_cond, &snap->mutex);
+	if (snap->is_aborted) {
+		tt_pthread_mutex_unlock(&snap->mutex);
+		free(batch);
+		return -1;
+	}
+	stailq_add_tail_entry(&snap->queue, batch, next);
+	snap->queue_len++;
+	tt_pthread_cond_signal(&snap->tx_cond);
+	tt_pthread_mutex_unlock(&snap->mutex);
+	return 0;
+}
+
+static int
+snap_recovery_reader_f(va_list ap)
+{
+	struct snap_recovery *snap = va_arg(ap, struct snap_recovery *);
+	int rc = 0;
+	struct xlog_cursor cursor;
+	struct snap_recovery_batch *batch = NULL;
+	if (snap->map.data != NULL) {
+		if (xlog_cursor_openmem(&cursor, snap->map.data,
+					snap->map.size, snap->filename) < 0) {
+			rc = -1;
+			goto done;
+		}
+	} else if (xlog_cursor_open(&cursor, snap->filename) < 0) {
+		rc = -1;
+		goto done;
+	}
+	struct xrow_header row;
+	while ((rc = xlog_cursor_next(&cursor, &row,
+				      snap->force_recovery)) == 0) {
+		assert(row.bodycnt == 1); /* always 1 for read */
+		size_t body_len = row.body[0].iov_len;
+		if (batch != NULL &&
+		    (batch->row_count == SNAP_RECOVERY_BATCH_ROWS ||
+		     batch->data_size + body_len > batch->data_capacity)) {
+			if (snap_recovery_submit(snap, batch) != 0) {
+				/* Aborted by tx - quit silently. */
+				batch = NULL;
+				rc = 1;
+				break;
+			}
+			batch = NULL;
+		}
+		if (batch == NULL) {
+			batch = snap_recovery_batch_new(body_len);
+			if (batch == NULL) {
+				rc = -1;
+				break;
+			}
+		}
+		struct xrow_header *dst = &batch->rows[batch->row_count++];
+		*dst = row;
+		if (!snap_map_contains(&snap->map, row.body[0].iov_base)) {
+			/*
+			 * The cursor owns the memory the row body
+			 * points at and may reuse it for the next
+			 * compressed block, so copy the body into
+			 * the batch. Bodies of uncompressed blocks
+			 * of a mapped snapshot point into the
+			 * mapping, which outlives all batches, and
+			 * are left in place.
+			 */
+			dst->body[0].iov_base = batch->data +
+				batch->data_size;
+			memcpy(batch->data + batch->data_size,
+			       row.body[0].iov_base, body_len);
+			batch->data_size += body_len;
+		}
+	}
+	if (rc >= 0 && batch != NULL && batch->row_count > 0) {
+		if (snap_recovery_submit(snap, batch) == 0)
+			batch = NULL;
+	}
+	free(batch);
+	snap->has_eof_marker = xlog_cursor_is_eof(&cursor);
+	xlog_cursor_close(&cursor, false);
+done:
+	tt_pthread_mutex_lock(&snap->mutex);
+	snap->is_eof = true;
+	tt_pthread_cond_signal(&snap->tx_cond);
+	tt_pthread_mutex_unlock(&snap->mutex);
+	return rc < 0 ? -1 : 0;
+}
+
+/** The old fully serial recovery, used if a thread can't start. */
+static int
+memtx_engine_recover_snapshot_serial(struct memtx_engine *memtx,
+				     int64_t signature,
+				     const char *filename,
+				     struct mh_i32ptr_t *seen,
+				     uint32_t file_no)
+{
 	struct xlog_cursor cursor;
 	if (xlog_cursor_open(&cursor, filename) < 0)
 		return -1;
@@ -171,7 +481,8 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	while ((rc = xlog_cursor_next(&cursor, &row,
 				      memtx->force_recovery)) == 0) {
 		row.lsn = signature;
-		rc = memtx_engine_recover_snapshot_row(memtx, &row);
+		rc = memtx_engine_recover_snapshot_row(memtx, &row, seen,
+						       file_no);
 		if (rc < 0) {
 			if (!memtx->force_recovery)
 				break;
@@ -200,9 +511,224 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	return 0;
 }
 
+/** Recover a single snapshot file, either full or incremental. */
+static int
+memtx_engine_recover_snap_file(struct memtx_engine *memtx, int64_t signature,
+			       const char *filename,
+			       struct mh_i32ptr_t *seen, uint32_t file_no)
+{
+	say_info("recovering from `%s'", filename);
+
+	struct snap_recovery snap;
+	snap.filename = filename;
+	snap.force_recovery = memtx->force_recovery;
+	stailq_create(&snap.queue);
+	snap.queue_len = 0;
+	snap.is_eof = false;
+	snap.is_aborted = false;
+	snap.has_eof_marker = false;
+	tt_pthread_mutex_init(&snap.mutex, NULL);
+	tt_pthread_cond_init(&snap.tx_cond, NULL);
+	tt_pthread_cond_init(&snap.reader_cond, NULL);
+	/*
+	 * Map the snapshot if possible: pages come in on demand
+	 * and uncompressed row bodies are served straight from
+	 * the mapping without a copy. Plain reads are the
+	 * fallback.
+	 */
+	if (snap_map_open(&snap.map, filename) != 0) {
+		diag_log();
+		say_warn("failed to mmap `%s', falling back to reads",
+			 filename);
+	}
+
+	if (cord_costart(&snap.cord, "snapshot.reader",
+			 snap_recovery_reader_f, &snap) != 0) {
+		diag_log();
+		say_warn("failed to start a snapshot reader thread, "
+			 "falling back to serial recovery");
+		snap_map_close(&snap.map);
+		tt_pthread_cond_destroy(&snap.reader_cond);
+		tt_pthread_cond_destroy(&snap.tx_cond);
+		tt_pthread_mutex_destroy(&snap.mutex);
+		return memtx_engine_recover_snapshot_serial(memtx, signature,
+							    filename, seen,
+							    file_no);
+	}
+
+	int rc = 0;
+	uint64_t row_count = 0;
+	while (true) {
+		tt_pthread_mutex_lock(&snap.mutex);
+		while (snap.queue_len == 0 && !snap.is_eof)
+			tt_pthread_cond_wait(&snap.tx_cond, &snap.mutex);
+		struct snap_recovery_batch *batch = NULL;
+		if (snap.queue_len > 0) {
+			batch = stailq_shift_entry(&snap.queue,
+					struct snap_recovery_batch, next);
+			snap.queue_len--;
+			tt_pthread_cond_signal(&snap.reader_cond);
+		}
+		tt_pthread_mutex_unlock(&snap.mutex);
+		if (batch == NULL)
+			break;
+		for (int i = 0; i < batch->row_count && rc == 0; i++) {
+			struct xrow_header *row = &batch->rows[i];
+			row->lsn = signature;
+			rc = memtx_engine_recover_snapshot_row(memtx, row,
+							       seen, file_no);
+			if (rc < 0) {
+				if (!memtx->force_recovery)
+					break;
+				rc = 0;
+				say_error("can't apply row: ");
+				diag_log();
+			}
+			++row_count;
+			if (row_count % 100000 == 0) {
+				say_info("%.1fM rows processed",
+					 row_count / 1000000.);
+			}
+		}
+		free(batch);
+		if (rc < 0)
+			break;
+		/* Let other fibers run between batches. */
+		fiber_yield_timeout(0);
+	}
+
+	tt_pthread_mutex_lock(&snap.mutex);
+	snap.is_aborted = true;
+	tt_pthread_cond_signal(&snap.reader_cond);
+	tt_pthread_mutex_unlock(&snap.mutex);
+	if (cord_cojoin(&snap.cord) != 0 && rc == 0)
+		rc = -1;
+
+	struct snap_recovery_batch *batch, *next_batch;
+	stailq_foreach_entry_safe(batch, next_batch, &snap.queue, next)
+		free(batch);
+	snap_map_close(&snap.map);
+	tt_pthread_cond_destroy(&snap.reader_cond);
+	tt_pthread_cond_destroy(&snap.tx_cond);
+	tt_pthread_mutex_destroy(&snap.mutex);
+
+	if (rc < 0)
+		return -1;
+
+	/**
+	 * We should never try to read snapshots with no EOF
+	 * marker - such snapshots are very likely corrupted and
+	 * should not be trusted.
+	 */
+	if (!snap.has_eof_marker)
+		panic("snapshot `%s' has no EOF marker", filename);
+
+	return 0;
+}
+
+/**
+ * Read the base checkpoint signature of a snapshot from its meta.
+ * On success sets @a base to the signature of the base checkpoint
+ * or to -1 if the snapshot is a full one.
+ *
+ * @retval 0 success
+ * @retval -1 the file could not be read or its meta is invalid
+ */
+static int
+memtx_snap_base_signature(struct memtx_engine *memtx, int64_t signature,
+			  int64_t *base)
+{
+	const char *filename = xdir_format_filename(&memtx->snap_dir,
+						    signature, NONE);
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, filename) < 0)
+		return -1;
+	*base = -1;
+	if (vclock_is_set(&cursor.meta.prev_vclock))
+		*base = vclock_sum(&cursor.meta.prev_vclock);
+	xlog_cursor_close(&cursor, false);
+	if (*base >= signature) {
+		diag_set(XlogError, "snapshot `%s' has invalid base "
+			 "checkpoint %lld", filename, (long long)*base);
+		return -1;
+	}
+	return 0;
+}
+
+int
+memtx_engine_recover_snapshot(struct memtx_engine *memtx,
+			      const struct vclock *vclock)
+{
+	say_info("recovery start");
+	/*
+	 * Collect the chain of incremental snapshots leading to
+	 * the requested checkpoint, the newest file first. A
+	 * full snapshot makes a chain of length one.
+	 */
+	int64_t signatures[MEMTX_SNAP_CHAIN_MAX + 1];
+	int chain_len = 0;
+	int64_t signature = vclock_sum(vclock);
+	while (true) {
+		if (chain_len > MEMTX_SNAP_CHAIN_MAX) {
+			diag_set(XlogError, "incremental snapshot chain "
+				 "is too long");
+			return -1;
+		}
+		signatures[chain_len++] = signature;
+		int64_t base;
+		if (memtx_snap_base_signature(memtx, signature, &base) != 0)
+			return -1;
+		if (base < 0)
+			break;
+		signature = base;
+	}
+
+	struct mh_i32ptr_t *seen = NULL;
+	if (chain_len > 1) {
+		seen = mh_i32ptr_new();
+		if (seen == NULL) {
+			diag_set(OutOfMemory, sizeof(*seen), "malloc",
+				 "snap chain space set");
+			return -1;
+		}
+	}
+	int rc = 0;
+	for (int i = 0; i < chain_len && rc == 0; i++) {
+		const char *filename =
+			xdir_format_filename(&memtx->snap_dir, signatures[i],
+					     NONE);
+		rc = memtx_engine_recover_snap_file(memtx, signatures[i],
+						    filename, seen,
+						    (uint32_t)i);
+	}
+	if (seen != NULL)
+		mh_i32ptr_delete(seen);
+	if (rc != 0)
+		return -1;
+	/*
+	 * The recovered chain tells how many incremental
+	 * snapshots are already stacked on the last full one.
+	 */
+	memtx->checkpoint_chain_len = chain_len - 1;
+	return 0;
+}
+
+int
+memtx_engine_recover_snapshot_file(struct memtx_engine *memtx,
+				   const struct vclock *vclock,
+				   const char *filename)
+{
+	if (memtx_engine_recover_snap_file(memtx, vclock_sum(vclock),
+					   filename, NULL, 0) != 0)
+		return -1;
+	memtx->checkpoint_chain_len = 0;
+	return 0;
+}
+
 static int
 memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
-				  struct xrow_header *row)
+				  struct xrow_header *row,
+				  struct mh_i32ptr_t *seen, uint32_t file_no)
 {
 	assert(row->bodycnt == 1); /* always 1 for read */
 	if (row->type != IPROTO_INSERT) {
@@ -214,6 +740,37 @@ memtx_engine_recover_snapshot_row(struct memtx_engine *memtx,
 	struct request request;
 	if (xrow_decode_dml(row, &request, dml_request_key_map(row->type)) != 0)
 		return -1;
+	if (seen != NULL) {
+		/*
+		 * In a chain of incremental snapshots each space
+		 * is recovered from the newest file containing
+		 * it: rows of spaces already recovered from a
+		 * newer file are skipped, as are rows of spaces
+		 * that no longer exist in the newest schema.
+		 */
+		mh_int_t k = mh_i32ptr_find(seen, request.space_id, NULL);
+		if (k != mh_end(seen)) {
+			uint32_t owner = (uint32_t)(uintptr_t)
+				mh_i32ptr_node(seen, k)->val;
+			if (owner != file_no)
+				return 0;
+		} else {
+			struct mh_i32ptr_node_t node;
+			node.key = request.space_id;
+			node.val = (void *)(uintptr_t)file_no;
+			if (mh_i32ptr_put(seen, &node, NULL, NULL) ==
+			    mh_end(seen)) {
+				diag_set(OutOfMemory, sizeof(node),
+					 "malloc", "snap chain space set");
+				return -1;
+			}
+		}
+		if (file_no > 0) {
+			struct space *sp = space_by_id(request.space_id);
+			if (sp == NULL || !space_is_memtx(sp))
+				return 0;
+		}
+	}
 	struct space *space = space_cache_find(request.space_id);
 	if (space == NULL)
 		return -1;
@@ -280,7 +837,8 @@ memtx_engine_begin_final_recovery(struct engine *engine)
 
 	assert(memtx->state == MEMTX_INITIAL_RECOVERY);
 	/* End of the fast path: loaded the primary key. */
-	space_foreach(memtx_end_build_primary_key, memtx);
+	if (space_foreach(memtx_end_build_primary_key, memtx) != 0)
+		return -1;
 
 	if (!memtx->force_recovery) {
 		/*
@@ -333,10 +891,39 @@ memtx_engine_create_space(struct engine *engine, struct space_def *def,
 
 static int
 memtx_engine_begin(struct engine *engine, struct txn *txn)
+{
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	if (!memtx->use_mvcc) {
+		txn_can_yield(txn, false);
+		return 0;
+	}
+	/*
+	 * In the optimistic mode yields are allowed. Instead,
+	 * the transaction collects its read set and is validated
+	 * against it on commit, see memtx_tx.h.
+	 */
+	return memtx_tx_begin(txn);
+}
+
+static int
+memtx_engine_prepare(struct engine *engine, struct txn *txn)
 {
 	(void)engine;
-	txn_can_yield(txn, false);
-	return 0;
+	return memtx_tx_prepare(txn);
+}
+
+static void
+memtx_engine_commit(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	memtx_tx_end(txn);
+}
+
+static void
+memtx_engine_rollback(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	memtx_tx_end(txn);
 }
 
 static void
@@ -399,7 +986,7 @@ memtx_engine_bootstrap(struct engine *engine)
 	int rc;
 	struct xrow_header row;
 	while ((rc = xlog_cursor_next(&cursor, &row, true)) == 0) {
-		rc = memtx_engine_recover_snapshot_row(memtx, &row);
+		rc = memtx_engine_recover_snapshot_row(memtx, &row, NULL, 0);
 		if (rc < 0)
 			break;
 	}
@@ -464,6 +1051,58 @@ struct checkpoint_entry {
 	uint32_t group_id;
 	struct snapshot_iterator *iterator;
 	struct rlist link;
+	/**
+	 * Batches of rows encoded by a worker thread, written
+	 * to the snapshot file by the main checkpoint thread.
+	 * Guarded by checkpoint::mutex. Unused in the serial
+	 * mode.
+	 */
+	struct stailq batches;
+	/**
+	 * Set when a worker thread has read up the space to the
+	 * end. Guarded by checkpoint::mutex.
+	 */
+	bool is_done;
+	/**
+	 * Columnar segment writer fed by the same read view, NULL
+	 * unless box.cfg.checkpoint_columnar is set. Used only by
+	 * the snapshot thread.
+	 */
+	struct colseg_writer *colseg;
+};
+
+enum {
+	/** Target size of a batch produced by a worker thread. */
+	CHECKPOINT_BATCH_SIZE = 256 * 1024,
+	/**
+	 * Limit on the total size of batches buffered in memory.
+	 * When it is reached, worker threads stall until the
+	 * writer catches up.
+	 */
+	CHECKPOINT_MAX_MEM_USED = 16 * 1024 * 1024,
+};
+
+/**
+ * A batch of raw tuples read from a read view iterator by a
+ * worker thread. The data is a sequence of records, each one
+ * a uint32_t size followed by size bytes of msgpack.
+ */
+struct checkpoint_batch {
+	/** Link in checkpoint_entry::batches. */
+	struct stailq_entry next;
+	/** Used size of data. */
+	size_t size;
+	/** Allocated size of data. */
+	size_t capacity;
+	char data[0];
+};
+
+/** A worker thread encoding its share of spaces. */
+struct checkpoint_worker {
+	struct cord cord;
+	struct checkpoint *ckpt;
+	/** Ordinal number of the worker. */
+	int id;
 };
 
 struct checkpoint {
@@ -482,10 +1121,479 @@ struct checkpoint {
 	 * checkpoint already exists.
 	 */
 	bool touch;
+	/**
+	 * True if the checkpoint is written as an incremental
+	 * snapshot: only spaces modified since the base
+	 * checkpoint plus the system spaces are included.
+	 */
+	bool is_delta;
+	/** Base checkpoint of an incremental snapshot. */
+	struct vclock base_vclock;
+	/**
+	 * Emit per-space columnar segment files next to the
+	 * snapshot, box.cfg.checkpoint_columnar.
+	 */
+	bool columnar;
+	/**
+	 * Number of worker threads reading the spaces, 0 for
+	 * the serial mode where the snapshot thread does
+	 * everything itself.
+	 */
+	int worker_count;
+	struct checkpoint_worker *workers;
+	/** Guards the fields below and per-entry batch queues. */
+	pthread_mutex_t mutex;
+	/** Signaled when buffered memory is released. */
+	pthread_cond_t worker_cond;
+	/** Signaled when a batch is produced or on an error. */
+	pthread_cond_t writer_cond;
+	/** Total size of batches buffered in memory. */
+	size_t mem_used;
+	/** Set when a worker thread has failed. */
+	bool failed;
+	/** Set to terminate worker threads prematurely. */
+	bool aborted;
+	/** The error of the first failed worker thread. */
+	struct diag diag;
+	/**
+	 * WAL flush latency sampled before the checkpoint
+	 * started, the uncontended baseline the throttle
+	 * compares against, see checkpoint_throttle().
+	 */
+	double wal_latency_base;
+	/** Snapshot offset of the last throttle check. */
+	off_t throttle_offset;
+};
+
+/* {{{ Columnar snapshot segments */
+
+/*
+ * When box.cfg.checkpoint_columnar is set, every checkpoint
+ * additionally produces a <lsn>.<space_id>.colseg file per space
+ * next to the .snap, fed by the same read view iteration. The
+ * indexed top-level fields of the space are written out as typed
+ * contiguous arrays so that analytics can scan a column
+ * sequentially instead of decoding the snapshot row by row.
+ *
+ * A segment is a plain msgpack stream: a header map
+ * {"space_id": id, "columns": [{"field": fieldno, "type": str}]}
+ * followed by record batch maps {"rows": n, "columns": [...]},
+ * where each column is an array of MP_BIN blobs: a validity
+ * bitmap, cumulative value end offsets (string columns only) and
+ * the values themselves in host byte order. See
+ * tools/colseg-dump.lua for a reader.
+ *
+ * The segments are auxiliary: any failure only drops the segment
+ * with a warning and never fails the checkpoint itself.
+ */
+
+enum {
+	/** Number of rows accumulated before a batch is flushed. */
+	COLSEG_BATCH_ROWS = 8192,
+	/** At most this many columns are exported per space. */
+	COLSEG_MAX_COLUMNS = 8,
+};
+
+/** Storage class of an exported column. */
+enum colseg_type {
+	COLSEG_UNSIGNED,
+	COLSEG_INTEGER,
+	COLSEG_DOUBLE,
+	COLSEG_STRING,
+};
+
+static const char *colseg_type_strs[] = {
+	"unsigned", "integer", "double", "string",
+};
+
+/** A growable buffer accumulating one blob of a record batch. */
+struct colseg_buf {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+struct colseg_column {
+	/** Zero-based tuple field the column is read from. */
+	uint32_t fieldno;
+	enum colseg_type type;
+	/** One bit per row: whether the row has a value. */
+	struct colseg_buf validity;
+	/** Cumulative value end offsets, string columns only. */
+	struct colseg_buf offsets;
+	/** Fixed-width values or concatenated string bytes. */
+	struct colseg_buf data;
+};
+
+struct colseg_writer {
+	uint32_t space_id;
+	int column_count;
+	/** Exported columns, sorted by fieldno. */
+	struct colseg_column columns[COLSEG_MAX_COLUMNS];
+	/** Rows accumulated in the current batch. */
+	uint32_t rows;
+	/** Segment file, -1 until the first tuple arrives. */
+	int fd;
+	/** Path of the .inprogress file being written. */
+	char path[PATH_MAX];
+	/** Set when the end of the space has been reached. */
+	bool is_done;
+	/** Set on the first error: the segment is abandoned. */
+	bool failed;
+	/** Set once the file is renamed to its final name. */
+	bool committed;
 };
 
+static int
+colseg_buf_append(struct colseg_buf *buf, const void *data, size_t size)
+{
+	if (buf->size + size > buf->capacity) {
+		size_t capacity = MAX(buf->capacity * 2, (size_t)4096);
+		while (capacity < buf->size + size)
+			capacity *= 2;
+		char *ptr = realloc(buf->data, capacity);
+		if (ptr == NULL)
+			return -1;
+		buf->data = ptr;
+		buf->capacity = capacity;
+	}
+	memcpy(buf->data + buf->size, data, size);
+	buf->size += size;
+	return 0;
+}
+
+static int
+colseg_buf_append_bit(struct colseg_buf *buf, uint32_t row, bool value)
+{
+	if (row % 8 == 0) {
+		char zero = 0;
+		if (colseg_buf_append(buf, &zero, 1) != 0)
+			return -1;
+	}
+	if (value)
+		buf->data[row / 8] |= 1 << (row % 8);
+	return 0;
+}
+
+/**
+ * Create a columnar segment writer for a space. The exported
+ * columns are the top-level fields used by the space indexes -
+ * those are typed and are what analytics filters on. Returns
+ * NULL if the space has no exportable columns or on OOM: the
+ * segment is simply not written then.
+ */
+static struct colseg_writer *
+colseg_writer_new(struct space *sp)
+{
+	struct colseg_column columns[COLSEG_MAX_COLUMNS];
+	int column_count = 0;
+	for (uint32_t i = 0; i < sp->index_count; i++) {
+		struct key_def *key_def = sp->index[i]->def->key_def;
+		for (uint32_t j = 0; j < key_def->part_count; j++) {
+			const struct key_part *part = &key_def->parts[j];
+			if (part->path != NULL)
+				continue;
+			enum colseg_type type;
+			switch (part->type) {
+			case FIELD_TYPE_UNSIGNED:
+				type = COLSEG_UNSIGNED;
+				break;
+			case FIELD_TYPE_INTEGER:
+				type = COLSEG_INTEGER;
+				break;
+			case FIELD_TYPE_NUMBER:
+			case FIELD_TYPE_DOUBLE:
+				type = COLSEG_DOUBLE;
+				break;
+			case FIELD_TYPE_STRING:
+				type = COLSEG_STRING;
+				break;
+			default:
+				continue;
+			}
+			int k;
+			for (k = 0; k < column_count; k++) {
+				if (columns[k].fieldno >= part->fieldno)
+					break;
+			}
+			if (k < column_count &&
+			    columns[k].fieldno == part->fieldno)
+				continue;
+			if (column_count == COLSEG_MAX_COLUMNS)
+				continue;
+			memmove(&columns[k + 1], &columns[k],
+				(column_count - k) * sizeof(columns[0]));
+			memset(&columns[k], 0, sizeof(columns[0]));
+			columns[k].fieldno = part->fieldno;
+			columns[k].type = type;
+			column_count++;
+		}
+	}
+	if (column_count == 0)
+		return NULL;
+	struct colseg_writer *w = calloc(1, sizeof(*w));
+	if (w == NULL)
+		return NULL;
+	w->space_id = space_id(sp);
+	w->column_count = column_count;
+	memcpy(w->columns, columns, column_count * sizeof(columns[0]));
+	w->fd = -1;
+	return w;
+}
+
+static int
+colseg_write(struct colseg_writer *w, const void *data, size_t size)
+{
+	if (fio_writen(w->fd, data, size) < 0) {
+		say_syserror("failed to write columnar segment `%s'", w->path);
+		return -1;
+	}
+	return 0;
+}
+
+/** Write out the accumulated record batch and reset it. */
+static int
+colseg_flush(struct colseg_writer *w)
+{
+	if (w->rows == 0)
+		return 0;
+	char buf[64];
+	char *pos = mp_encode_map(buf, 2);
+	pos = mp_encode_str(pos, "rows", strlen("rows"));
+	pos = mp_encode_uint(pos, w->rows);
+	pos = mp_encode_str(pos, "columns", strlen("columns"));
+	pos = mp_encode_array(pos, w->column_count);
+	if (colseg_write(w, buf, pos - buf) != 0)
+		return -1;
+	for (int i = 0; i < w->column_count; i++) {
+		struct colseg_column *col = &w->columns[i];
+		bool is_str = col->type == COLSEG_STRING;
+		pos = mp_encode_array(buf, is_str ? 3 : 2);
+		pos = mp_encode_binl(pos, (uint32_t)col->validity.size);
+		if (colseg_write(w, buf, pos - buf) != 0 ||
+		    colseg_write(w, col->validity.data,
+				 col->validity.size) != 0)
+			return -1;
+		if (is_str) {
+			pos = mp_encode_binl(buf, (uint32_t)col->offsets.size);
+			if (colseg_write(w, buf, pos - buf) != 0 ||
+			    colseg_write(w, col->offsets.data,
+					 col->offsets.size) != 0)
+				return -1;
+		}
+		pos = mp_encode_binl(buf, (uint32_t)col->data.size);
+		if (colseg_write(w, buf, pos - buf) != 0 ||
+		    colseg_write(w, col->data.data, col->data.size) != 0)
+			return -1;
+		col->validity.size = 0;
+		col->offsets.size = 0;
+		col->data.size = 0;
+	}
+	w->rows = 0;
+	return 0;
+}
+
+/**
+ * Create the segment file and write the header. Delayed until
+ * the first tuple because the checkpoint vclock is not known yet
+ * when the read views are taken.
+ */
+static int
+colseg_open(struct colseg_writer *w, struct checkpoint *ckpt)
+{
+	snprintf(w->path, sizeof(w->path), "%s/%020lld.%u.colseg%s",
+		 ckpt->dir.dirname, (long long)vclock_sum(&ckpt->vclock),
+		 (unsigned)w->space_id, inprogress_suffix);
+	w->fd = open(w->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (w->fd < 0) {
+		say_syserror("failed to create columnar segment `%s'",
+			     w->path);
+		return -1;
+	}
+	char buf[512];
+	char *pos = mp_encode_map(buf, 2);
+	pos = mp_encode_str(pos, "space_id", strlen("space_id"));
+	pos = mp_encode_uint(pos, w->space_id);
+	pos = mp_encode_str(pos, "columns", strlen("columns"));
+	pos = mp_encode_array(pos, w->column_count);
+	for (int i = 0; i < w->column_count; i++) {
+		struct colseg_column *col = &w->columns[i];
+		const char *type = colseg_type_strs[col->type];
+		pos = mp_encode_map(pos, 2);
+		pos = mp_encode_str(pos, "field", strlen("field"));
+		pos = mp_encode_uint(pos, col->fieldno);
+		pos = mp_encode_str(pos, "type", strlen("type"));
+		pos = mp_encode_str(pos, type, strlen(type));
+	}
+	return colseg_write(w, buf, pos - buf);
+}
+
+/**
+ * Append the exported fields of a tuple to the current record
+ * batch, flushing it to disk when it is full. Runs in the
+ * snapshot thread for both the serial and the parallel mode, so
+ * no locking is needed.
+ */
+static void
+colseg_write_tuple(struct colseg_writer *w, struct checkpoint *ckpt,
+		   const char *data)
+{
+	if (w->failed)
+		return;
+	if (w->fd < 0 && colseg_open(w, ckpt) != 0)
+		goto fail;
+	const char *pos = data;
+	if (mp_typeof(*pos) != MP_ARRAY)
+		goto fail;
+	uint32_t field_count = mp_decode_array(&pos);
+	uint32_t fieldno = 0;
+	for (int i = 0; i < w->column_count; i++) {
+		struct colseg_column *col = &w->columns[i];
+		while (fieldno < col->fieldno && fieldno < field_count) {
+			mp_next(&pos);
+			fieldno++;
+		}
+		bool valid = false;
+		union {
+			uint64_t u;
+			int64_t i;
+			double d;
+		} num = { 0 };
+		const char *str = NULL;
+		uint32_t str_len = 0;
+		if (fieldno < field_count) {
+			const char *f = pos;
+			switch (col->type) {
+			case COLSEG_UNSIGNED:
+				if (mp_typeof(*f) == MP_UINT) {
+					num.u = mp_decode_uint(&f);
+					valid = true;
+				}
+				break;
+			case COLSEG_INTEGER:
+				if (mp_typeof(*f) == MP_UINT) {
+					uint64_t u = mp_decode_uint(&f);
+					if (u <= (uint64_t)INT64_MAX) {
+						num.i = (int64_t)u;
+						valid = true;
+					}
+				} else if (mp_typeof(*f) == MP_INT) {
+					num.i = mp_decode_int(&f);
+					valid = true;
+				}
+				break;
+			case COLSEG_DOUBLE:
+				switch (mp_typeof(*f)) {
+				case MP_DOUBLE:
+					num.d = mp_decode_double(&f);
+					valid = true;
+					break;
+				case MP_FLOAT:
+					num.d = mp_decode_float(&f);
+					valid = true;
+					break;
+				case MP_UINT:
+					num.d = (double)mp_decode_uint(&f);
+					valid = true;
+					break;
+				case MP_INT:
+					num.d = (double)mp_decode_int(&f);
+					valid = true;
+					break;
+				default:
+					break;
+				}
+				break;
+			case COLSEG_STRING:
+				if (mp_typeof(*f) == MP_STR) {
+					str = mp_decode_str(&f, &str_len);
+					valid = true;
+				}
+				break;
+			}
+		}
+		if (colseg_buf_append_bit(&col->validity, w->rows,
+					  valid) != 0)
+			goto fail;
+		if (col->type == COLSEG_STRING) {
+			/* The 32-bit batch-local offsets must not wrap. */
+			if (valid &&
+			    (str_len > UINT32_MAX - col->data.size ||
+			     colseg_buf_append(&col->data, str,
+					       str_len) != 0))
+				goto fail;
+			uint32_t end = (uint32_t)col->data.size;
+			if (colseg_buf_append(&col->offsets, &end,
+					      sizeof(end)) != 0)
+				goto fail;
+		} else {
+			if (colseg_buf_append(&col->data, &num,
+					      sizeof(num)) != 0)
+				goto fail;
+		}
+	}
+	if (++w->rows >= COLSEG_BATCH_ROWS && colseg_flush(w) != 0)
+		goto fail;
+	return;
+fail:
+	say_warn("skipping columnar segment for space %u",
+		 (unsigned)w->space_id);
+	w->failed = true;
+}
+
+/** Flush the last batch and close the file. */
+static void
+colseg_writer_finish(struct colseg_writer *w)
+{
+	if (w->failed || w->fd < 0)
+		return;
+	if (colseg_flush(w) != 0) {
+		w->failed = true;
+		return;
+	}
+	close(w->fd);
+	w->fd = -1;
+	w->is_done = true;
+}
+
+/** Rename a finished segment to its final name. */
+static void
+colseg_writer_commit(struct colseg_writer *w)
+{
+	if (w == NULL || !w->is_done)
+		return;
+	char to[PATH_MAX];
+	int len = strlen(w->path) - strlen(inprogress_suffix);
+	snprintf(to, sizeof(to), "%.*s", len, w->path);
+	if (coio_rename(w->path, to) != 0)
+		say_syserror("failed to rename columnar segment `%s'",
+			     w->path);
+	else
+		w->committed = true;
+}
+
+static void
+colseg_writer_delete(struct colseg_writer *w)
+{
+	if (w == NULL)
+		return;
+	if (w->fd >= 0)
+		close(w->fd);
+	if (w->path[0] != '\0' && !w->committed)
+		coio_unlink(w->path);
+	for (int i = 0; i < w->column_count; i++) {
+		free(w->columns[i].validity.data);
+		free(w->columns[i].offsets.data);
+		free(w->columns[i].data.data);
+	}
+	free(w);
+}
+
+/* }}} */
+
 static struct checkpoint *
-checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
+checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit,
+	       int checkpoint_threads, bool direct_write)
 {
 	struct checkpoint *ckpt = malloc(sizeof(*ckpt));
 	if (ckpt == NULL) {
@@ -499,9 +1607,25 @@ checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
 	opts.rate_limit = snap_io_rate_limit;
 	opts.sync_interval = SNAP_SYNC_INTERVAL;
 	opts.free_cache = true;
+	opts.direct_write = direct_write;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID, &opts);
 	vclock_create(&ckpt->vclock);
 	ckpt->touch = false;
+	ckpt->is_delta = false;
+	vclock_clear(&ckpt->base_vclock);
+	ckpt->columnar = false;
+	/* One thread works on the snapshot file itself. */
+	ckpt->worker_count = checkpoint_threads - 1;
+	ckpt->workers = NULL;
+	tt_pthread_mutex_init(&ckpt->mutex, NULL);
+	tt_pthread_cond_init(&ckpt->worker_cond, NULL);
+	tt_pthread_cond_init(&ckpt->writer_cond, NULL);
+	ckpt->mem_used = 0;
+	ckpt->failed = false;
+	ckpt->aborted = false;
+	diag_create(&ckpt->diag);
+	ckpt->wal_latency_base = wal_flush_latency();
+	ckpt->throttle_offset = 0;
 	return ckpt;
 }
 
@@ -510,9 +1634,19 @@ checkpoint_delete(struct checkpoint *ckpt)
 {
 	struct checkpoint_entry *entry, *tmp;
 	rlist_foreach_entry_safe(entry, &ckpt->entries, link, tmp) {
+		struct checkpoint_batch *batch, *batch_tmp;
+		stailq_foreach_entry_safe(batch, batch_tmp,
+					  &entry->batches, next)
+			free(batch);
+		colseg_writer_delete(entry->colseg);
 		entry->iterator->free(entry->iterator);
 		free(entry);
 	}
+	diag_destroy(&ckpt->diag);
+	tt_pthread_cond_destroy(&ckpt->writer_cond);
+	tt_pthread_cond_destroy(&ckpt->worker_cond);
+	tt_pthread_mutex_destroy(&ckpt->mutex);
+	free(ckpt->workers);
 	xdir_destroy(&ckpt->dir);
 	free(ckpt);
 }
@@ -528,6 +1662,19 @@ checkpoint_cancel(struct checkpoint *ckpt)
 	if (ckpt->waiting_for_snap_thread) {
 		tt_pthread_cancel(ckpt->cord.id);
 		tt_pthread_join(ckpt->cord.id, NULL);
+		if (ckpt->workers != NULL) {
+			/*
+			 * The cancelled writer can not wake the
+			 * workers up anymore, terminate them
+			 * explicitly.
+			 */
+			tt_pthread_mutex_lock(&ckpt->mutex);
+			ckpt->aborted = true;
+			tt_pthread_cond_broadcast(&ckpt->worker_cond);
+			tt_pthread_mutex_unlock(&ckpt->mutex);
+			for (int i = 0; i < ckpt->worker_count; i++)
+				cord_join(&ckpt->workers[i].cord);
+		}
 	}
 	checkpoint_delete(ckpt);
 }
@@ -545,38 +1692,289 @@ replica_join_cancel(struct cord *replica_join_cord)
 }
 
 static int
-checkpoint_add_space(struct space *sp, void *data)
+checkpoint_add_space(struct space *sp, void *data)
+{
+	if (space_is_temporary(sp))
+		return 0;
+	if (!space_is_memtx(sp))
+		return 0;
+	struct index *pk = space_index(sp, 0);
+	if (!pk)
+		return 0;
+	struct checkpoint *ckpt = (struct checkpoint *)data;
+	struct memtx_space *memtx_space = (struct memtx_space *)sp;
+	/*
+	 * An incremental snapshot only contains spaces modified
+	 * since the base checkpoint. System spaces are always
+	 * included so that a delta alone carries the complete
+	 * schema and can be recovered before its base.
+	 */
+	if (ckpt->is_delta && !memtx_space->is_dirty &&
+	    space_id(sp) > BOX_SYSTEM_ID_MAX)
+		return 0;
+	struct checkpoint_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		diag_set(OutOfMemory, sizeof(*entry),
+			 "malloc", "struct checkpoint_entry");
+		return -1;
+	}
+	rlist_add_tail_entry(&ckpt->entries, entry, link);
+
+	stailq_create(&entry->batches);
+	entry->is_done = false;
+	entry->space_id = space_id(sp);
+	entry->group_id = space_group_id(sp);
+	entry->colseg = ckpt->columnar ? colseg_writer_new(sp) : NULL;
+	entry->iterator = index_create_snapshot_iterator(pk);
+	if (entry->iterator == NULL)
+		return -1;
+	/*
+	 * The read view has captured the space content, so the
+	 * space is clean relative to this checkpoint from now
+	 * on. If the checkpoint is aborted, the flags are set
+	 * back, see memtx_engine_abort_checkpoint().
+	 */
+	memtx_space->is_dirty = false;
+
+	return 0;
+};
+
+static struct checkpoint_batch *
+checkpoint_batch_new(size_t capacity)
+{
+	struct checkpoint_batch *batch = malloc(sizeof(*batch) + capacity);
+	if (batch == NULL) {
+		diag_set(OutOfMemory, sizeof(*batch) + capacity,
+			 "malloc", "struct checkpoint_batch");
+		return NULL;
+	}
+	batch->size = 0;
+	batch->capacity = capacity;
+	return batch;
+}
+
+/**
+ * Hand a complete batch over to the writer, stalling if too much
+ * data is buffered. A NULL batch marks the end of the space.
+ */
+static void
+checkpoint_entry_submit(struct checkpoint *ckpt,
+			struct checkpoint_entry *entry,
+			struct checkpoint_batch *batch, bool is_last)
+{
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	while (ckpt->mem_used >= CHECKPOINT_MAX_MEM_USED &&
+	       !ckpt->aborted && !ckpt->failed)
+		tt_pthread_cond_wait(&ckpt->worker_cond, &ckpt->mutex);
+	if (batch != NULL) {
+		stailq_add_tail_entry(&entry->batches, batch, next);
+		ckpt->mem_used += sizeof(*batch) + batch->capacity;
+	}
+	if (is_last)
+		entry->is_done = true;
+	tt_pthread_cond_broadcast(&ckpt->writer_cond);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+}
+
+/**
+ * Read a space up via its read view iterator, copying the tuples
+ * into batches for the writer. Runs in a worker thread.
+ */
+static int
+checkpoint_encode_entry(struct checkpoint *ckpt,
+			struct checkpoint_entry *entry)
+{
+	struct checkpoint_batch *batch = NULL;
+	struct snapshot_iterator *it = entry->iterator;
+	int rc;
+	uint32_t size;
+	const char *data;
+	while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
+		size_t record_size = sizeof(uint32_t) + size;
+		if (batch != NULL &&
+		    batch->size + record_size > batch->capacity) {
+			checkpoint_entry_submit(ckpt, entry, batch, false);
+			batch = NULL;
+		}
+		if (batch == NULL) {
+			batch = checkpoint_batch_new(MAX(record_size,
+					(size_t)CHECKPOINT_BATCH_SIZE));
+			if (batch == NULL)
+				return -1;
+		}
+		memcpy(batch->data + batch->size, &size, sizeof(uint32_t));
+		memcpy(batch->data + batch->size + sizeof(uint32_t),
+		       data, size);
+		batch->size += record_size;
+		if (ckpt->aborted || ckpt->failed) {
+			free(batch);
+			return 0;
+		}
+	}
+	if (rc != 0) {
+		free(batch);
+		return -1;
+	}
+	checkpoint_entry_submit(ckpt, entry, batch, true);
+	return 0;
+}
+
+static int
+checkpoint_worker_f(va_list ap)
+{
+	struct checkpoint_worker *worker =
+		va_arg(ap, struct checkpoint_worker *);
+	struct checkpoint *ckpt = worker->ckpt;
+	struct checkpoint_entry *entry;
+	int idx = 0;
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (idx++ % ckpt->worker_count != worker->id)
+			continue;
+		if (checkpoint_encode_entry(ckpt, entry) != 0) {
+			tt_pthread_mutex_lock(&ckpt->mutex);
+			if (!ckpt->failed) {
+				ckpt->failed = true;
+				diag_move(diag_get(), &ckpt->diag);
+			}
+			tt_pthread_cond_broadcast(&ckpt->writer_cond);
+			tt_pthread_cond_broadcast(&ckpt->worker_cond);
+			tt_pthread_mutex_unlock(&ckpt->mutex);
+			tuple_compress_cache_free();
+			return -1;
+		}
+		if (ckpt->aborted || ckpt->failed)
+			break;
+	}
+	tuple_compress_cache_free();
+	return 0;
+}
+
+enum {
+	/** Re-check the WAL flush latency every so many bytes. */
+	CHECKPOINT_THROTTLE_UNIT = 4 * 1024 * 1024,
+};
+
+/** WAL flush latency below which contention is ignored. */
+static const double CHECKPOINT_THROTTLE_LATENCY_MIN = 0.0005;
+/** Longest single backoff sleep, in seconds. */
+static const double CHECKPOINT_THROTTLE_SLEEP_MAX = 0.1;
+
+/**
+ * Latency-coupled checkpoint throttling. snap_io_rate_limit is a
+ * fixed number that can not track device contention, so on top of
+ * it the writer compares the current WAL flush latency with the
+ * value sampled when the checkpoint started. Once WAL commits
+ * become visibly slower than that baseline, every
+ * CHECKPOINT_THROTTLE_UNIT of snapshot data is followed by one
+ * flush worth of sleep, giving the WAL uncontended disk time.
+ */
+static void
+checkpoint_throttle(struct checkpoint *ckpt, struct xlog *snap)
+{
+	if (snap->offset - ckpt->throttle_offset <
+	    (off_t)CHECKPOINT_THROTTLE_UNIT)
+		return;
+	ckpt->throttle_offset = snap->offset;
+	double latency = wal_flush_latency();
+	if (latency < CHECKPOINT_THROTTLE_LATENCY_MIN ||
+	    latency <= 2 * ckpt->wal_latency_base)
+		return;
+	ev_sleep(MIN(latency, CHECKPOINT_THROTTLE_SLEEP_MAX));
+}
+
+/**
+ * Lower the I/O priority of the snapshot thread so that its
+ * writes yield to WAL fsyncs in the kernel I/O scheduler. A
+ * best-effort hint: not every platform or scheduler honors it.
+ */
+static void
+checkpoint_lower_io_priority(void)
+{
+#ifdef __linux__
+	/* IOPRIO_WHO_PROCESS, this thread, best-effort class 7. */
+	if (syscall(SYS_ioprio_set, 1, 0, (2 << 13) | 7) != 0)
+		say_debug("ioprio_set: %s", strerror(errno));
+#endif
+}
+
+/**
+ * Write a space to the snapshot from the batches produced by the
+ * worker threads, popping them in order as they become ready.
+ */
+static int
+checkpoint_write_entry(struct checkpoint *ckpt,
+		       struct checkpoint_entry *entry, struct xlog *snap)
 {
-	if (space_is_temporary(sp))
-		return 0;
-	if (!space_is_memtx(sp))
-		return 0;
-	struct index *pk = space_index(sp, 0);
-	if (!pk)
-		return 0;
-	struct checkpoint *ckpt = (struct checkpoint *)data;
-	struct checkpoint_entry *entry = malloc(sizeof(*entry));
-	if (entry == NULL) {
-		diag_set(OutOfMemory, sizeof(*entry),
-			 "malloc", "struct checkpoint_entry");
-		return -1;
+	bool done = false;
+	while (!done) {
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		while (stailq_empty(&entry->batches) && !entry->is_done &&
+		       !ckpt->failed)
+			tt_pthread_cond_wait(&ckpt->writer_cond, &ckpt->mutex);
+		if (ckpt->failed) {
+			tt_pthread_mutex_unlock(&ckpt->mutex);
+			diag_move(&ckpt->diag, diag_get());
+			return -1;
+		}
+		struct stailq batches;
+		stailq_create(&batches);
+		stailq_concat(&batches, &entry->batches);
+		done = entry->is_done;
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+
+		size_t freed = 0;
+		int rc = 0;
+		struct checkpoint_batch *batch, *tmp;
+		stailq_foreach_entry_safe(batch, tmp, &batches, next) {
+			for (const char *pos = batch->data;
+			     rc == 0 && pos < batch->data + batch->size;) {
+				uint32_t size;
+				memcpy(&size, pos, sizeof(uint32_t));
+				pos += sizeof(uint32_t);
+				if (entry->colseg != NULL)
+					colseg_write_tuple(entry->colseg,
+							   ckpt, pos);
+				rc = checkpoint_write_tuple(snap,
+						entry->space_id,
+						entry->group_id, pos, size);
+				pos += size;
+			}
+			freed += sizeof(*batch) + batch->capacity;
+			free(batch);
+			checkpoint_throttle(ckpt, snap);
+		}
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		ckpt->mem_used -= freed;
+		if (rc != 0)
+			ckpt->failed = true;
+		tt_pthread_cond_broadcast(&ckpt->worker_cond);
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+		if (rc != 0)
+			return -1;
 	}
-	rlist_add_tail_entry(&ckpt->entries, entry, link);
-
-	entry->space_id = space_id(sp);
-	entry->group_id = space_group_id(sp);
-	entry->iterator = index_create_snapshot_iterator(pk);
-	if (entry->iterator == NULL)
-		return -1;
-
+	if (entry->colseg != NULL)
+		colseg_writer_finish(entry->colseg);
 	return 0;
-};
+}
+
+/** Stop and join the worker threads, started ones only. */
+static void
+checkpoint_join_workers(struct checkpoint *ckpt, int worker_count)
+{
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	tt_pthread_cond_broadcast(&ckpt->worker_cond);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	for (int i = 0; i < worker_count; i++)
+		cord_join(&ckpt->workers[i].cord);
+}
 
 static int
 checkpoint_f(va_list ap)
 {
 	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
 
+	checkpoint_lower_io_priority();
+
 	if (ckpt->touch) {
 		if (xdir_touch_xlog(&ckpt->dir, &ckpt->vclock) == 0)
 			return 0;
@@ -587,34 +1985,91 @@ checkpoint_f(va_list ap)
 		ckpt->touch = false;
 	}
 
+	int started_workers = 0;
+	if (ckpt->worker_count > 0) {
+		ckpt->workers = calloc(ckpt->worker_count,
+				       sizeof(*ckpt->workers));
+		if (ckpt->workers == NULL) {
+			diag_set(OutOfMemory, ckpt->worker_count *
+				 sizeof(*ckpt->workers), "calloc",
+				 "checkpoint workers");
+			return -1;
+		}
+		for (int i = 0; i < ckpt->worker_count; i++) {
+			struct checkpoint_worker *worker = &ckpt->workers[i];
+			worker->ckpt = ckpt;
+			worker->id = i;
+			if (cord_costart(&worker->cord, "snapshot.worker",
+					 checkpoint_worker_f, worker) != 0)
+				break;
+			started_workers++;
+		}
+		if (started_workers == 0) {
+			/* Fall back to the serial mode. */
+			ckpt->worker_count = 0;
+		} else {
+			ckpt->worker_count = started_workers;
+		}
+	}
+
 	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, &ckpt->vclock) != 0)
+	if (ckpt->is_delta)
+		vclock_copy(&ckpt->dir.base_vclock, &ckpt->base_vclock);
+	if (xdir_create_xlog(&ckpt->dir, &snap, &ckpt->vclock) != 0) {
+		if (started_workers > 0) {
+			ckpt->aborted = true;
+			checkpoint_join_workers(ckpt, started_workers);
+		}
 		return -1;
+	}
 
 	say_info("saving snapshot `%s'", snap.filename);
+	if (ckpt->is_delta) {
+		say_info("incremental snapshot, based on checkpoint %lld",
+			 (long long)vclock_sum(&ckpt->base_vclock));
+	}
+	if (started_workers > 0)
+		say_info("using %d snapshot worker threads", started_workers);
 	ERROR_INJECT_SLEEP(ERRINJ_SNAP_WRITE_DELAY);
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (ckpt->worker_count > 0) {
+			if (checkpoint_write_entry(ckpt, entry, &snap) != 0)
+				goto fail;
+			continue;
+		}
 		int rc;
 		uint32_t size;
 		const char *data;
 		struct snapshot_iterator *it = entry->iterator;
 		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
+			if (entry->colseg != NULL)
+				colseg_write_tuple(entry->colseg, ckpt, data);
 			if (checkpoint_write_tuple(&snap, entry->space_id,
 					entry->group_id, data, size) != 0)
 				goto fail;
+			checkpoint_throttle(ckpt, &snap);
 		}
 		if (rc != 0)
 			goto fail;
+		if (entry->colseg != NULL)
+			colseg_writer_finish(entry->colseg);
 	}
 	if (xlog_flush(&snap) < 0)
 		goto fail;
 
 	xlog_close(&snap, false);
+	checkpoint_join_workers(ckpt, started_workers);
+	tuple_compress_cache_free();
 	say_info("done");
 	return 0;
 fail:
 	xlog_close(&snap, false);
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	ckpt->aborted = true;
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	checkpoint_join_workers(ckpt, started_workers);
+	tuple_compress_cache_free();
 	return -1;
 }
 
@@ -625,10 +2080,25 @@ memtx_engine_begin_checkpoint(struct engine *engine)
 
 	assert(memtx->checkpoint == NULL);
 	memtx->checkpoint = checkpoint_new(memtx->snap_dir.dirname,
-					   memtx->snap_io_rate_limit);
+					   memtx->snap_io_rate_limit,
+					   memtx->checkpoint_threads,
+					   memtx->snap_direct_write);
 	if (memtx->checkpoint == NULL)
 		return -1;
 
+	/*
+	 * Write an incremental snapshot if it is allowed, there
+	 * is a checkpoint to base it on and the chain on top of
+	 * the last full snapshot is not too long yet.
+	 */
+	if (memtx->checkpoint_incremental &&
+	    memtx->checkpoint_chain_len < MEMTX_SNAP_CHAIN_MAX &&
+	    xdir_last_vclock(&memtx->snap_dir,
+			     &memtx->checkpoint->base_vclock) >= 0)
+		memtx->checkpoint->is_delta = true;
+
+	memtx->checkpoint->columnar = memtx->checkpoint_columnar;
+
 	if (space_foreach(checkpoint_add_space, memtx->checkpoint) != 0) {
 		checkpoint_delete(memtx->checkpoint);
 		memtx->checkpoint = NULL;
@@ -693,6 +2163,14 @@ memtx_engine_commit_checkpoint(struct engine *engine,
 		int rc = coio_rename(from, to);
 		if (rc != 0)
 			panic("can't rename .snap.inprogress");
+		if (memtx->checkpoint->is_delta)
+			memtx->checkpoint_chain_len++;
+		else
+			memtx->checkpoint_chain_len = 0;
+		/* Expose the finished columnar segments, if any. */
+		struct checkpoint_entry *entry;
+		rlist_foreach_entry(entry, &memtx->checkpoint->entries, link)
+			colseg_writer_commit(entry->colseg);
 	}
 
 	struct vclock last;
@@ -706,6 +2184,16 @@ memtx_engine_commit_checkpoint(struct engine *engine,
 	memtx->checkpoint = NULL;
 }
 
+/** Set the dirty flag back on a memtx space, @sa space_foreach(). */
+static int
+memtx_space_mark_dirty(struct space *sp, void *data)
+{
+	(void)data;
+	if (space_is_memtx(sp))
+		((struct memtx_space *)sp)->is_dirty = true;
+	return 0;
+}
+
 static void
 memtx_engine_abort_checkpoint(struct engine *engine)
 {
@@ -728,6 +2216,14 @@ memtx_engine_abort_checkpoint(struct engine *engine)
 				     INPROGRESS);
 	(void) coio_unlink(filename);
 
+	/*
+	 * The dirty flags were cleared when the read views were
+	 * taken, but the snapshot was not written: mark all the
+	 * spaces dirty again so that the next incremental
+	 * checkpoint does not miss their data.
+	 */
+	space_foreach(memtx_space_mark_dirty, NULL);
+
 	checkpoint_delete(memtx->checkpoint);
 	memtx->checkpoint = NULL;
 }
@@ -736,8 +2232,24 @@ static void
 memtx_engine_collect_garbage(struct engine *engine, const struct vclock *vclock)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	xdir_collect_garbage(&memtx->snap_dir, vclock_sum(vclock),
-			     XDIR_GC_ASYNC);
+	/*
+	 * The oldest checkpoint to keep may be an incremental
+	 * snapshot: spare the full snapshot it is based on along
+	 * with all intermediate deltas. If a file in the chain
+	 * can not be read, err on the side of keeping files.
+	 */
+	int64_t signature = vclock_sum(vclock);
+	for (int i = 0; i < MEMTX_SNAP_CHAIN_MAX; i++) {
+		int64_t base;
+		if (memtx_snap_base_signature(memtx, signature, &base) != 0) {
+			diag_log();
+			break;
+		}
+		if (base < 0)
+			break;
+		signature = base;
+	}
+	xdir_collect_garbage(&memtx->snap_dir, signature, XDIR_GC_ASYNC);
 	xdir_collect_inprogress(&memtx->snap_dir);
 }
 
@@ -746,9 +2258,25 @@ memtx_engine_backup(struct engine *engine, const struct vclock *vclock,
 		    engine_backup_cb cb, void *cb_arg)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
-	const char *filename = xdir_format_filename(&memtx->snap_dir,
-						    vclock_sum(vclock), NONE);
-	return cb(filename, cb_arg);
+	/*
+	 * An incremental snapshot is unusable without its base:
+	 * hand out the whole chain.
+	 */
+	int64_t signature = vclock_sum(vclock);
+	for (int i = 0; i <= MEMTX_SNAP_CHAIN_MAX; i++) {
+		const char *filename =
+			xdir_format_filename(&memtx->snap_dir, signature,
+					     NONE);
+		if (cb(filename, cb_arg) != 0)
+			return -1;
+		int64_t base;
+		if (memtx_snap_base_signature(memtx, signature, &base) != 0)
+			return -1;
+		if (base < 0)
+			break;
+		signature = base;
+	}
+	return 0;
 }
 
 struct memtx_join_entry {
@@ -913,10 +2441,10 @@ static const struct engine_vtab memtx_engine_vtab = {
 	/* .complete_join = */ memtx_engine_complete_join,
 	/* .begin = */ memtx_engine_begin,
 	/* .begin_statement = */ generic_engine_begin_statement,
-	/* .prepare = */ generic_engine_prepare,
-	/* .commit = */ generic_engine_commit,
+	/* .prepare = */ memtx_engine_prepare,
+	/* .commit = */ memtx_engine_commit,
 	/* .rollback_statement = */ memtx_engine_rollback_statement,
-	/* .rollback = */ generic_engine_rollback,
+	/* .rollback = */ memtx_engine_rollback,
 	/* .switch_to_ro = */ generic_engine_switch_to_ro,
 	/* .bootstrap = */ memtx_engine_bootstrap,
 	/* .begin_initial_recovery = */ memtx_engine_begin_initial_recovery,
@@ -975,6 +2503,347 @@ memtx_engine_gc_f(va_list va)
 	return 0;
 }
 
+/* {{{ Tuple compaction */
+
+/*
+ * A long-lived instance fragments the small allocator: after
+ * enough churn many slabs hold only a few live tuples each, yet
+ * a slab is only returned to the arena when it is completely
+ * empty. The compaction fiber finds size classes where the gap
+ * between allocated and used memory is large and relocates live
+ * tuples of those classes into fresh allocations, which the
+ * allocator packs densely, so the sparse slabs drain and get
+ * reclaimed.
+ */
+
+enum {
+	/** Period between fragmentation checks, in seconds. */
+	MEMTX_COMPACT_CHECK_PERIOD = 60,
+	/** Class waste percentage that triggers compaction. */
+	MEMTX_COMPACT_WASTE_PCT = 25,
+	/** Don't compact a class wasting less than this, bytes. */
+	MEMTX_COMPACT_WASTE_MIN = 1024 * 1024,
+	/** Max tuples relocated between yields. */
+	MEMTX_COMPACT_BATCH = 128,
+	/** Max tuples inspected between yields. */
+	MEMTX_COMPACT_SCAN_BATCH = 1024,
+	/** Relocation rate limit, bytes per second. */
+	MEMTX_COMPACT_RATE = 32 * 1024 * 1024,
+	/** Max size classes tracked in one pass. */
+	MEMTX_COMPACT_CLASS_MAX = 256,
+};
+
+/** A small allocator size class as seen by one pass. */
+struct memtx_compact_class {
+	/** Object size of the class. */
+	uint32_t objsize;
+	/** True if the class is worth compacting. */
+	bool fragmented;
+};
+
+struct memtx_compact_ctx {
+	struct memtx_engine *memtx;
+	/** All size classes, ascending by objsize. */
+	struct memtx_compact_class classes[MEMTX_COMPACT_CLASS_MAX];
+	int class_count;
+	/** Set if at least one class is fragmented. */
+	bool has_fragmented;
+	/** Tuples relocated by this pass. */
+	uint64_t moved;
+	/** Bytes relocated by this pass. */
+	uint64_t moved_bytes;
+};
+
+static int
+memtx_compact_stats_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	struct memtx_compact_ctx *ctx = cb_ctx;
+	if (ctx->class_count >= MEMTX_COMPACT_CLASS_MAX)
+		return 1;
+	struct memtx_compact_class *class = &ctx->classes[ctx->class_count++];
+	size_t waste = stats->totals.total - stats->totals.used;
+	class->objsize = stats->objsize;
+	class->fragmented = stats->objcount > 0 &&
+		waste > MEMTX_COMPACT_WASTE_MIN &&
+		waste * 100 > stats->totals.total * MEMTX_COMPACT_WASTE_PCT;
+	if (class->fragmented)
+		ctx->has_fragmented = true;
+	return 0;
+}
+
+static int
+memtx_compact_class_cmp(const void *lhs, const void *rhs)
+{
+	uint32_t l = ((const struct memtx_compact_class *)lhs)->objsize;
+	uint32_t r = ((const struct memtx_compact_class *)rhs)->objsize;
+	return l < r ? -1 : l > r;
+}
+
+/**
+ * Check whether @a tuple lives in a fragmented size class. The
+ * allocator rounds a request up to the smallest class that fits
+ * it, so the tuple's class is the first one >= its total
+ * allocation size.
+ */
+static bool
+memtx_compact_tuple_match(struct memtx_compact_ctx *ctx, struct tuple *tuple)
+{
+	size_t total = tuple_size(tuple) + offsetof(struct memtx_tuple, base);
+	int lo = 0;
+	int hi = ctx->class_count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (ctx->classes[mid].objsize < total)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	/* Oversized tuples bypass the class pools. */
+	if (lo == ctx->class_count)
+		return false;
+	return ctx->classes[lo].fragmented;
+}
+
+/**
+ * Relocate a single tuple: allocate a fresh copy and swap it in
+ * all space indexes through the regular replace path.
+ */
+static int
+memtx_compact_tuple(struct memtx_compact_ctx *ctx, struct space *space,
+		    struct tuple *tuple)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	uint32_t bsize;
+	const char *data = tuple_data_range(tuple, &bsize);
+	struct tuple *copy = memtx_tuple_new(tuple_format(tuple), data,
+					     data + bsize);
+	if (copy == NULL)
+		return -1;
+	tuple_ref(copy);
+	struct tuple *unused;
+	if (memtx_space->replace(space, tuple, copy, DUP_REPLACE,
+				 &unused) != 0) {
+		tuple_unref(copy);
+		return -1;
+	}
+	assert(unused == tuple);
+	/* Release the index reference of the old incarnation. */
+	tuple_unref(tuple);
+	ctx->moved++;
+	ctx->moved_bytes += tuple_size(copy) +
+		offsetof(struct memtx_tuple, base);
+	/* Drop our creation reference, the indexes keep theirs. */
+	tuple_unref(copy);
+	return 0;
+}
+
+/**
+ * Compact one space, yielding between batches. The iterator is
+ * re-created from the last processed primary key after every
+ * yield, so concurrent DML and even drop of the space are fine.
+ */
+static int
+memtx_compact_space(struct memtx_compact_ctx *ctx, uint32_t space_id)
+{
+	struct memtx_engine *memtx = ctx->memtx;
+	char *last_key = NULL;
+	bool done = false;
+	int rc = 0;
+	while (!done && rc == 0 && !fiber_is_cancelled()) {
+		/*
+		 * A snapshot or join started meanwhile: stop,
+		 * relocation would only inflate the amount of
+		 * delayed-free memory pinned by the read view.
+		 */
+		if (memtx->delayed_free_mode > 0)
+			break;
+		struct space *space = space_by_id(space_id);
+		if (space == NULL || space->engine != &memtx->base)
+			break;
+		struct index *pk = space_index(space, 0);
+		if (pk == NULL)
+			break;
+		/*
+		 * An in-progress index build or format check
+		 * tracks concurrent changes with an on_replace
+		 * trigger, but our relocation bypasses triggers,
+		 * so stay clear of such spaces. This errs on the
+		 * safe side for plain user triggers too.
+		 */
+		if (!rlist_empty(&space->on_replace))
+			break;
+		struct iterator *it;
+		if (last_key == NULL) {
+			it = index_create_iterator(pk, ITER_ALL, NULL, 0);
+		} else {
+			const char *key = last_key;
+			uint32_t part_count = mp_decode_array(&key);
+			it = index_create_iterator(pk, ITER_GT, key,
+						   part_count);
+		}
+		if (it == NULL) {
+			rc = -1;
+			break;
+		}
+		/*
+		 * Collect a batch of candidates first, then
+		 * relocate: this way the iterator never sees the
+		 * tree being modified under it. No yields until
+		 * the batch is done, so the pointers stay valid.
+		 */
+		struct tuple *batch[MEMTX_COMPACT_BATCH];
+		struct tuple *tuple = NULL;
+		struct tuple *last = NULL;
+		int batch_count = 0;
+		int scanned = 0;
+		while (batch_count < MEMTX_COMPACT_BATCH &&
+		       scanned < MEMTX_COMPACT_SCAN_BATCH) {
+			if (iterator_next(it, &tuple) != 0) {
+				rc = -1;
+				break;
+			}
+			if (tuple == NULL) {
+				done = true;
+				break;
+			}
+			last = tuple;
+			scanned++;
+			/*
+			 * A tuple with extra references is held
+			 * by an in-flight transaction statement,
+			 * an iterator or an application: it must
+			 * not be freed from under them, skip it.
+			 */
+			if (tuple->refs != 1)
+				continue;
+			if (memtx_compact_tuple_match(ctx, tuple))
+				batch[batch_count++] = tuple;
+		}
+		/* Remember where to resume before relocating. */
+		free(last_key);
+		last_key = NULL;
+		if (rc == 0 && !done && last != NULL) {
+			struct region *region = &fiber()->gc;
+			size_t region_svp = region_used(region);
+			uint32_t key_size;
+			char *key = tuple_extract_key(last, pk->def->key_def,
+						      MULTIKEY_NONE,
+						      &key_size);
+			if (key != NULL) {
+				last_key = malloc(key_size);
+				if (last_key != NULL)
+					memcpy(last_key, key, key_size);
+			}
+			region_truncate(region, region_svp);
+			if (last_key == NULL)
+				done = true;
+		}
+		iterator_delete(it);
+		uint64_t batch_bytes = ctx->moved_bytes;
+		for (int i = 0; i < batch_count && rc == 0; i++)
+			rc = memtx_compact_tuple(ctx, space, batch[i]);
+		batch_bytes = ctx->moved_bytes - batch_bytes;
+		/*
+		 * Pace the relocation the way checkpointing is
+		 * paced by snap_io_rate_limit: sleep long enough
+		 * to keep the configured bytes per second.
+		 */
+		fiber_sleep((double)batch_bytes / MEMTX_COMPACT_RATE);
+	}
+	free(last_key);
+	return rc;
+}
+
+struct memtx_compact_collect_ctx {
+	struct memtx_engine *memtx;
+	uint32_t *ids;
+	int count;
+	int capacity;
+};
+
+static int
+memtx_compact_collect_cb(struct space *space, void *udata)
+{
+	struct memtx_compact_collect_ctx *collect = udata;
+	if (space->engine != &collect->memtx->base ||
+	    space_index(space, 0) == NULL)
+		return 0;
+	if (collect->count == collect->capacity) {
+		int capacity = collect->capacity == 0 ?
+			       256 : collect->capacity * 2;
+		uint32_t *ids = realloc(collect->ids,
+					capacity * sizeof(*ids));
+		if (ids == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*ids),
+				 "malloc", "compaction space list");
+			return -1;
+		}
+		collect->ids = ids;
+		collect->capacity = capacity;
+	}
+	collect->ids[collect->count++] = space_id(space);
+	return 0;
+}
+
+/** Run one compaction pass over all memtx spaces. */
+static void
+memtx_engine_compact(struct memtx_engine *memtx)
+{
+	struct memtx_compact_ctx ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.memtx = memtx;
+	struct small_stats totals;
+	small_stats(&memtx->alloc, &totals, memtx_compact_stats_cb, &ctx);
+	if (!ctx.has_fragmented)
+		return;
+	qsort(ctx.classes, ctx.class_count, sizeof(*ctx.classes),
+	      memtx_compact_class_cmp);
+	/*
+	 * Snapshot the list of space ids first: space_foreach()
+	 * must not yield, while compaction does.
+	 */
+	struct memtx_compact_collect_ctx collect;
+	memset(&collect, 0, sizeof(collect));
+	collect.memtx = memtx;
+	if (space_foreach(memtx_compact_collect_cb, &collect) != 0) {
+		free(collect.ids);
+		return;
+	}
+	for (int i = 0; i < collect.count && !fiber_is_cancelled(); i++) {
+		if (memtx_compact_space(&ctx, collect.ids[i]) != 0) {
+			say_warn("memtx compaction: %s",
+				 diag_last_error(diag_get())->errmsg);
+			diag_clear(diag_get());
+			break;
+		}
+	}
+	free(collect.ids);
+	if (ctx.moved > 0) {
+		memtx->compact_moved += ctx.moved;
+		memtx->compact_moved_bytes += ctx.moved_bytes;
+		say_info("memtx compaction: relocated %llu tuples "
+			 "(%llu bytes)", (unsigned long long)ctx.moved,
+			 (unsigned long long)ctx.moved_bytes);
+	}
+}
+
+static int
+memtx_engine_compact_f(va_list va)
+{
+	struct memtx_engine *memtx = va_arg(va, struct memtx_engine *);
+	while (!fiber_is_cancelled()) {
+		fiber_sleep(MEMTX_COMPACT_CHECK_PERIOD);
+		if (memtx->state != MEMTX_OK)
+			continue;
+		if (memtx->delayed_free_mode > 0)
+			continue;
+		memtx_engine_compact(memtx);
+	}
+	return 0;
+}
+
+/* }}} Tuple compaction */
+
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
@@ -1026,6 +2895,11 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	if (memtx->gc_fiber == NULL)
 		goto fail;
 
+	memtx->compact_fiber = fiber_new("memtx.compaction",
+					 memtx_engine_compact_f);
+	if (memtx->compact_fiber == NULL)
+		goto fail;
+
 	/* Apply lowest allowed objsize bound. */
 	if (objsize_min < OBJSIZE_MIN)
 		objsize_min = OBJSIZE_MIN;
@@ -1044,12 +2918,18 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		       MEMTX_EXTENT_SIZE);
 	mempool_create(&memtx->iterator_pool, cord_slab_cache(),
 		       MEMTX_ITERATOR_SIZE);
+	mempool_registry_add(&memtx->index_extent_pool, "memtx.index_extent");
+	mempool_registry_add(&memtx->iterator_pool, "memtx.iterator");
 	memtx->num_reserved_extents = 0;
 	memtx->reserved_extents = NULL;
 
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->max_tuple_size = MAX_TUPLE_SIZE;
 	memtx->force_recovery = force_recovery;
+	memtx->checkpoint_threads = 1;
+	memtx->checkpoint_incremental = false;
+	memtx->checkpoint_columnar = false;
+	memtx->checkpoint_chain_len = 0;
 
 	memtx->replica_join_cord = NULL;
 
@@ -1057,6 +2937,7 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 	memtx->base.name = "memtx";
 
 	fiber_start(memtx->gc_fiber, memtx);
+	fiber_start(memtx->compact_fiber, memtx);
 	return memtx;
 fail:
 	xdir_destroy(&memtx->snap_dir);
@@ -1078,6 +2959,38 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_snap_direct_write(struct memtx_engine *memtx, bool direct)
+{
+	memtx->snap_direct_write = direct;
+}
+
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int threads)
+{
+	assert(threads >= 1);
+	memtx->checkpoint_threads = threads;
+}
+
+void
+memtx_engine_set_checkpoint_incremental(struct memtx_engine *memtx,
+					bool incremental)
+{
+	memtx->checkpoint_incremental = incremental;
+}
+
+void
+memtx_engine_set_checkpoint_columnar(struct memtx_engine *memtx, bool columnar)
+{
+	memtx->checkpoint_columnar = columnar;
+}
+
+void
+memtx_engine_set_use_mvcc(struct memtx_engine *memtx, bool use_mvcc)
+{
+	memtx->use_mvcc = use_mvcc;
+}
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size)
 {
@@ -1108,8 +3021,72 @@ void
 memtx_leave_delayed_free_mode(struct memtx_engine *memtx)
 {
 	assert(memtx->delayed_free_mode > 0);
-	if (--memtx->delayed_free_mode == 0)
+	if (--memtx->delayed_free_mode == 0) {
 		small_alloc_setopt(&memtx->alloc, SMALL_DELAYED_FREE_MODE, false);
+		void *ptr = memtx->huge_tuple_delayed;
+		memtx->huge_tuple_delayed = NULL;
+		while (ptr != NULL) {
+			struct memtx_tuple *memtx_tuple = ptr;
+			ptr = *(void **)ptr;
+			size_t total = tuple_size(&memtx_tuple->base) +
+				offsetof(struct memtx_tuple, base);
+			memtx_huge_tuple_free(memtx, memtx_tuple, total);
+		}
+	}
+}
+
+/**
+ * Allocate a huge tuple in a dedicated malloc()ed block.
+ *
+ * An allocation above the small allocator object size limit is
+ * served by a slab rounded up to the next power of two, so a
+ * multi-MB tuple pins up to twice its size of arena memory, and
+ * the oversized slab is only reusable by an allocation of the
+ * same order. Such tuples used to be the main source of arena
+ * fragmentation. A dedicated block is returned to the system the
+ * moment the tuple dies. The block is charged to the common memtx
+ * quota, so the configured memory limit still holds.
+ */
+static struct memtx_tuple *
+memtx_huge_tuple_alloc(struct memtx_engine *memtx, size_t total)
+{
+	if (quota_use(&memtx->quota, total) < 0)
+		return NULL;
+	struct memtx_tuple *memtx_tuple = malloc(total);
+	if (memtx_tuple == NULL) {
+		quota_release(&memtx->quota, total);
+		return NULL;
+	}
+	memtx->huge_tuple_mem += total;
+	return memtx_tuple;
+}
+
+static void
+memtx_huge_tuple_free(struct memtx_engine *memtx,
+		      struct memtx_tuple *memtx_tuple, size_t total)
+{
+	assert(memtx->huge_tuple_mem >= total);
+	memtx->huge_tuple_mem -= total;
+	free(memtx_tuple);
+	quota_release(&memtx->quota, total);
+}
+
+/**
+ * A snapshot in progress may still read a deleted tuple from a
+ * frozen index view, so, like smfree_delayed(), deletion of a
+ * huge tuple during a snapshot only stashes the block on a list
+ * drained in memtx_leave_delayed_free_mode(). Like the small
+ * allocator free list, the link pointer overwrites the first
+ * bytes of the tuple header; bsize and data_offset survive, which
+ * is all that is needed to recompute the block size on actual
+ * free.
+ */
+static void
+memtx_huge_tuple_free_delayed(struct memtx_engine *memtx,
+			      struct memtx_tuple *memtx_tuple)
+{
+	*(void **)memtx_tuple = memtx->huge_tuple_delayed;
+	memtx->huge_tuple_delayed = memtx_tuple;
 }
 
 struct tuple *
@@ -1127,6 +3104,42 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 
 	size_t tuple_len = end - data;
 	size_t total = sizeof(struct memtx_tuple) + field_map_size + tuple_len;
+	/*
+	 * For a space with a value dictionary or compression
+	 * enabled try to shrink the body before allocating: first
+	 * replace frequent string values with their codes, then
+	 * compress what is left. A tuple that does not shrink by
+	 * at least the size header is stored raw.
+	 */
+	const char *body = data;
+	uint32_t body_size = tuple_len;
+	uint32_t body_flags = 0;
+	if (format->value_dict != NULL) {
+		uint32_t coded_size;
+		char *coded = tuple_value_dict_encode(format->value_dict,
+						      data, tuple_len,
+						      &coded_size);
+		if (coded != NULL) {
+			body = coded;
+			body_size = coded_size;
+			body_flags |= TUPLE_BODY_DICT;
+		}
+	}
+	if (format->is_compressed &&
+	    body_size >= TUPLE_COMPRESSION_THRESHOLD) {
+		uint32_t comp_size;
+		char *comp_data = tuple_compress(body, body_size, &comp_size);
+		if (comp_data != NULL) {
+			body = comp_data;
+			body_size = comp_size;
+			body_flags |= TUPLE_BODY_ZSTD;
+		}
+	}
+	if (body_flags != 0 && body_size + sizeof(uint32_t) < tuple_len)
+		total = sizeof(struct memtx_tuple) + field_map_size +
+			sizeof(uint32_t) + body_size;
+	else
+		body_flags = 0;
 
 	ERROR_INJECT(ERRINJ_TUPLE_ALLOC, {
 		diag_set(OutOfMemory, total, "slab allocator", "memtx_tuple");
@@ -1139,11 +3152,21 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	}
 
 	struct memtx_tuple *memtx_tuple;
-	while ((memtx_tuple = smalloc(&memtx->alloc, total)) == NULL) {
-		bool stop;
-		memtx_engine_run_gc(memtx, &stop);
-		if (stop)
-			break;
+	if (total > HUGE_TUPLE_THRESHOLD) {
+		while ((memtx_tuple = memtx_huge_tuple_alloc(memtx,
+							     total)) == NULL) {
+			bool stop;
+			memtx_engine_run_gc(memtx, &stop);
+			if (stop)
+				break;
+		}
+	} else {
+		while ((memtx_tuple = smalloc(&memtx->alloc, total)) == NULL) {
+			bool stop;
+			memtx_engine_run_gc(memtx, &stop);
+			if (stop)
+				break;
+		}
 	}
 	if (memtx_tuple == NULL) {
 		diag_set(OutOfMemory, total, "slab allocator", "memtx_tuple");
@@ -1161,10 +3184,20 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	 * tuple base, not from memtx_tuple, because the struct
 	 * tuple is not the first field of the memtx_tuple.
 	 */
+	/* data_offset is a 15-bit field, see struct tuple. */
+	assert(sizeof(struct tuple) + field_map_size <= INT16_MAX);
 	tuple->data_offset = sizeof(struct tuple) + field_map_size;
+	tuple->is_compressed = body_flags != 0;
 	char *raw = (char *) tuple + tuple->data_offset;
 	field_map_build(&builder, raw - field_map_size);
-	memcpy(raw, data, tuple_len);
+	if (body_flags != 0) {
+		uint32_t header = body_size << TUPLE_BODY_FLAG_BITS |
+				  body_flags;
+		memcpy(raw, &header, sizeof(header));
+		memcpy(raw + sizeof(header), body, body_size);
+	} else {
+		memcpy(raw, data, tuple_len);
+	}
 	say_debug("%s(%zu) = %p", __func__, tuple_len, memtx_tuple);
 end:
 	region_truncate(region, region_svp);
@@ -1179,13 +3212,38 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	assert(tuple->refs == 0);
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
-	size_t total = tuple_size(tuple) + offsetof(struct memtx_tuple, base);
-	if (memtx->alloc.free_mode != SMALL_DELAYED_FREE ||
-	    memtx_tuple->version == memtx->snapshot_version ||
-	    format->is_temporary)
+	size_t total;
+	if (unlikely(tuple->is_compressed)) {
+		/*
+		 * bsize of a transformed tuple is the original
+		 * length, so recover the real allocation size from
+		 * the body header and drop the cached expanded
+		 * copy before the memory is reused.
+		 */
+		tuple_compress_cache_evict(tuple);
+		uint32_t header;
+		memcpy(&header, (char *)tuple + tuple->data_offset,
+		       sizeof(header));
+		total = offsetof(struct memtx_tuple, base) +
+			tuple->data_offset + sizeof(uint32_t) +
+			(header >> TUPLE_BODY_FLAG_BITS);
+	} else {
+		total = tuple_size(tuple) +
+			offsetof(struct memtx_tuple, base);
+	}
+	bool free_now = memtx->alloc.free_mode != SMALL_DELAYED_FREE ||
+			memtx_tuple->version == memtx->snapshot_version ||
+			format->is_temporary;
+	if (total > HUGE_TUPLE_THRESHOLD) {
+		if (free_now)
+			memtx_huge_tuple_free(memtx, memtx_tuple, total);
+		else
+			memtx_huge_tuple_free_delayed(memtx, memtx_tuple);
+	} else if (free_now) {
 		smfree(&memtx->alloc, memtx_tuple, total);
-	else
+	} else {
 		smfree_delayed(&memtx->alloc, memtx_tuple, total);
+	}
 	tuple_format_unref(format);
 }
 
@@ -117,6 +117,46 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * If set, snapshot files are written with O_DIRECT when
+	 * the filesystem supports it, so checkpoint writes do not
+	 * pollute the page cache, box.cfg.snap_direct_write.
+	 */
+	bool snap_direct_write;
+	/**
+	 * Number of threads used to write a checkpoint: one
+	 * writer thread plus checkpoint_threads - 1 worker
+	 * threads reading the spaces. 1 means the old serial
+	 * mode.
+	 */
+	int checkpoint_threads;
+	/**
+	 * If set, checkpoints may be written as incremental
+	 * (delta) snapshots that only contain spaces modified
+	 * since the previous checkpoint,
+	 * box.cfg.checkpoint_incremental.
+	 */
+	bool checkpoint_incremental;
+	/**
+	 * If set, every checkpoint additionally emits per-space
+	 * columnar segment files (.colseg) with the indexed
+	 * fields laid out as typed contiguous arrays, for
+	 * downstream analytics, box.cfg.checkpoint_columnar.
+	 */
+	bool checkpoint_columnar;
+	/**
+	 * Number of delta snapshots stacked on top of the last
+	 * full snapshot. When the chain grows too long, a full
+	 * snapshot is forced to bound recovery time.
+	 */
+	int checkpoint_chain_len;
+	/**
+	 * If set, multi-statement transactions may yield and are
+	 * validated against their read set on commit instead of
+	 * being aborted on the first yield, see memtx_tx.h,
+	 * box.cfg.memtx_use_mvcc_engine.
+	 */
+	bool use_mvcc;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
 	/**
@@ -160,6 +200,19 @@ struct memtx_engine {
 	 * memtx_leave_delayed_free_mode() is called.
 	 */
 	uint32_t delayed_free_mode;
+	/**
+	 * Head of the list of deleted huge tuples whose actual
+	 * freeing is delayed until the snapshot in progress is
+	 * done. The link pointer is stored in the first bytes of
+	 * the tuple itself, like in the small allocator free list.
+	 */
+	void *huge_tuple_delayed;
+	/**
+	 * Total size of huge tuples, i.e. tuples allocated in
+	 * dedicated malloc()ed blocks outside the slab arena.
+	 * Reported in box.slab.info().
+	 */
+	size_t huge_tuple_mem;
 	/** Memory pool for rtree index iterator. */
 	struct mempool rtree_iterator_pool;
 	/**
@@ -178,6 +231,16 @@ struct memtx_engine {
 	 * memtx_gc_task::link.
 	 */
 	struct stailq gc_queue;
+	/**
+	 * Background compaction fiber. Relocates tuples out of
+	 * sparsely populated slabs so that the slabs can be
+	 * returned to the arena, see memtx_engine_compact_f().
+	 */
+	struct fiber *compact_fiber;
+	/** Tuples relocated by compaction since start. */
+	uint64_t compact_moved;
+	/** Bytes relocated by compaction since start. */
+	uint64_t compact_moved_bytes;
 };
 
 struct memtx_gc_task;
@@ -219,9 +282,36 @@ int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 			      const struct vclock *vclock);
 
+/**
+ * Recover from a single full snapshot file at an explicit path,
+ * e.g. one downloaded from the master during join. @a vclock is
+ * the vclock of the checkpoint the file belongs to.
+ */
+int
+memtx_engine_recover_snapshot_file(struct memtx_engine *memtx,
+				   const struct vclock *vclock,
+				   const char *filename);
+
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+void
+memtx_engine_set_snap_direct_write(struct memtx_engine *memtx, bool direct);
+
+void
+memtx_engine_set_checkpoint_threads(struct memtx_engine *memtx, int threads);
+
+void
+memtx_engine_set_checkpoint_incremental(struct memtx_engine *memtx,
+					bool incremental);
+
+void
+memtx_engine_set_checkpoint_columnar(struct memtx_engine *memtx,
+				     bool columnar);
+
+void
+memtx_engine_set_use_mvcc(struct memtx_engine *memtx, bool use_mvcc);
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size);
 
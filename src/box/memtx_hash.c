@@ -196,6 +196,23 @@ static const struct memtx_gc_task_vtab memtx_hash_index_gc_vtab = {
 	.free = memtx_hash_index_gc_free,
 };
 
+/**
+ * A secondary index does not hold tuple references, so the only
+ * work left to the background fiber is returning the hash table
+ * blocks to the slab arena, which is done by the free callback.
+ */
+static void
+memtx_hash_index_gc_run_blocks(struct memtx_gc_task *task, bool *done)
+{
+	(void)task;
+	*done = true;
+}
+
+static const struct memtx_gc_task_vtab memtx_hash_index_gc_blocks_vtab = {
+	.run = memtx_hash_index_gc_run_blocks,
+	.free = memtx_hash_index_gc_free,
+};
+
 static void
 memtx_hash_index_destroy(struct index *base)
 {
@@ -211,10 +228,19 @@ memtx_hash_index_destroy(struct index *base)
 		light_index_iterator_begin(&index->hash_table,
 					   &index->gc_iterator);
 		memtx_engine_schedule_gc(memtx, &index->gc_task);
+	} else if (index->hash_table.count > 0) {
+		/*
+		 * Secondary index. Tuples are owned by the primary
+		 * index, but a big hash table still takes a while
+		 * to return its blocks to the arena, so hand it
+		 * over to the background fiber as well.
+		 */
+		index->gc_task.vtab = &memtx_hash_index_gc_blocks_vtab;
+		memtx_engine_schedule_gc(memtx, &index->gc_task);
 	} else {
 		/*
-		 * Secondary index. Destruction is fast, no need to
-		 * hand over to background fiber.
+		 * An empty secondary index. Destruction is fast,
+		 * no need to hand over to background fiber.
 		 */
 		memtx_hash_index_free(index);
 	}
@@ -378,6 +404,15 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 			it->base.next = hash_iterator_ge;
 		}
 		break;
+	case ITER_GE:
+		/*
+		 * A GE request without a key is simply a full scan:
+		 * SQL rewinds its hash-backed ephemeral cursors this
+		 * way. A keyed GE is still meaningless on a hash.
+		 */
+		if (part_count != 0)
+			goto unsupported;
+		/* Fallthrough. */
 	case ITER_ALL:
 		light_index_iterator_begin(&index->hash_table, &it->iterator);
 		it->base.next = hash_iterator_ge;
@@ -389,6 +424,7 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 		it->base.next = hash_iterator_eq;
 		break;
 	default:
+unsupported:
 		diag_set(UnsupportedIndexFeature, base->def,
 			 "requested iterator type");
 		mempool_free(&memtx->iterator_pool, it);
@@ -487,7 +523,9 @@ static const struct index_vtab memtx_hash_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_hash_index_random,
 	/* .count = */ memtx_hash_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_hash_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ memtx_hash_index_replace,
 	/* .create_iterator = */ memtx_hash_index_create_iterator,
 	/* .create_snapshot_iterator = */
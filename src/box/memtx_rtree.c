@@ -47,6 +47,13 @@ struct memtx_rtree_index {
 	struct index base;
 	unsigned dimension;
 	struct rtree tree;
+	/**
+	 * Entries accumulated between begin_build and end_build
+	 * for bulk loading, see memtx_rtree_index_build_next().
+	 */
+	struct rtree_bulk_entry *build_array;
+	size_t build_array_size;
+	size_t build_array_alloc_size;
 };
 
 /* {{{ Utilities. *************************************************/
@@ -160,10 +167,78 @@ static void
 memtx_rtree_index_destroy(struct index *base)
 {
 	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	free(index->build_array);
 	rtree_destroy(&index->tree);
 	free(index);
 }
 
+/**
+ * Accumulate tuples in a plain array instead of inserting them
+ * one by one: end_build packs the whole dataset with
+ * sort-tile-recursive bulk load, which produces full, spatially
+ * tight pages where incremental insertion leaves loosely packed
+ * ones. Queries over a bulk loaded tree touch considerably fewer
+ * pages, nearest-neighbor scans included - the neighbor priority
+ * queue inspects page covers, and tight covers prune earlier.
+ */
+static int
+memtx_rtree_index_build_next(struct index *base, struct tuple *tuple)
+{
+	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	struct rtree_rect rect;
+	if (extract_rectangle(&rect, tuple, base->def) != 0)
+		return -1;
+	if (index->build_array == NULL) {
+		index->build_array = malloc(MEMTX_EXTENT_SIZE);
+		if (index->build_array == NULL) {
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_rtree_index", "build_next");
+			return -1;
+		}
+		index->build_array_alloc_size =
+			MEMTX_EXTENT_SIZE / sizeof(index->build_array[0]);
+	}
+	assert(index->build_array_size <= index->build_array_alloc_size);
+	if (index->build_array_size == index->build_array_alloc_size) {
+		index->build_array_alloc_size = index->build_array_alloc_size +
+				DIV_ROUND_UP(index->build_array_alloc_size, 2);
+		struct rtree_bulk_entry *tmp =
+			realloc(index->build_array,
+				index->build_array_alloc_size * sizeof(*tmp));
+		if (tmp == NULL) {
+			diag_set(OutOfMemory, index->build_array_alloc_size *
+				 sizeof(*tmp), "memtx_rtree_index",
+				 "build_next");
+			return -1;
+		}
+		index->build_array = tmp;
+	}
+	struct rtree_bulk_entry *entry =
+		&index->build_array[index->build_array_size++];
+	entry->rect = rect;
+	entry->obj = tuple;
+	return 0;
+}
+
+static int
+memtx_rtree_index_end_build(struct index *base)
+{
+	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	int rc = 0;
+	if (index->build_array != NULL) {
+		rc = rtree_bulk_load(&index->tree, index->build_array,
+				     index->build_array_size);
+		if (rc != 0)
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_rtree_index", "end_build");
+	}
+	free(index->build_array);
+	index->build_array = NULL;
+	index->build_array_size = 0;
+	index->build_array_alloc_size = 0;
+	return rc;
+}
+
 static bool
 memtx_rtree_index_def_change_requires_rebuild(struct index *index,
 					      const struct index_def *new_def)
@@ -342,7 +417,9 @@ static const struct index_vtab memtx_rtree_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_rtree_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_rtree_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ memtx_rtree_index_replace,
 	/* .create_iterator = */ memtx_rtree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -352,8 +429,8 @@ static const struct index_vtab memtx_rtree_index_vtab = {
 	/* .reset_stat = */ generic_index_reset_stat,
 	/* .begin_build = */ generic_index_begin_build,
 	/* .reserve = */ memtx_rtree_index_reserve,
-	/* .build_next = */ generic_index_build_next,
-	/* .end_build = */ generic_index_end_build,
+	/* .build_next = */ memtx_rtree_index_build_next,
+	/* .end_build = */ memtx_rtree_index_end_build,
 };
 
 struct index *
@@ -33,6 +33,7 @@
 #include "iproto_constants.h"
 #include "txn.h"
 #include "tuple.h"
+#include "tuple_value_dict.h"
 #include "xrow_update.h"
 #include "xrow.h"
 #include "memtx_hash.h"
@@ -42,6 +43,8 @@
 #include "memtx_engine.h"
 #include "column_mask.h"
 #include "sequence.h"
+#include "ck_constraint.h"
+#include "schema_def.h"
 
 /*
  * Yield every 1K tuples while building a new index or checking
@@ -129,6 +132,7 @@ memtx_space_replace_build_next(struct space *space, struct tuple *old_tuple,
 	if (index_build_next(space->index[0], new_tuple) != 0)
 		return -1;
 	memtx_space_update_bsize(space, NULL, new_tuple);
+	((struct memtx_space *)space)->is_dirty = true;
 	tuple_ref(new_tuple);
 	return 0;
 }
@@ -147,8 +151,11 @@ memtx_space_replace_primary_key(struct space *space, struct tuple *old_tuple,
 			  new_tuple, mode, &old_tuple) != 0)
 		return -1;
 	memtx_space_update_bsize(space, old_tuple, new_tuple);
-	if (new_tuple != NULL)
+	((struct memtx_space *)space)->is_dirty = true;
+	if (new_tuple != NULL) {
 		tuple_ref(new_tuple);
+		index_distinct_est_update(space->index[0], new_tuple);
+	}
 	*result = old_tuple;
 	return 0;
 }
@@ -267,19 +274,54 @@ memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
 	if (index_replace(pk, old_tuple, new_tuple, mode, &old_tuple) != 0)
 		return -1;
 	assert(old_tuple || new_tuple);
+	i++;
+
+	/*
+	 * Decide which partial indexes the old and the new tuple
+	 * belong to before updating any secondary key: the
+	 * rollback path below must not fail, so it reuses the
+	 * flags instead of re-evaluating the predicates.
+	 */
+	bool old_in[BOX_INDEX_MAX], new_in[BOX_INDEX_MAX];
+	for (uint32_t k = i; k < space->index_count; k++) {
+		struct index *index = space->index[k];
+		old_in[k] = old_tuple != NULL;
+		new_in[k] = new_tuple != NULL;
+		if (index->predicate == NULL)
+			continue;
+		uint32_t field_count = space->def->field_count;
+		if ((old_in[k] &&
+		     ck_constraint_test(index->predicate, old_tuple,
+					field_count, &old_in[k]) != 0) ||
+		    (new_in[k] &&
+		     ck_constraint_test(index->predicate, new_tuple,
+					field_count, &new_in[k]) != 0))
+			goto rollback;
+	}
 
 	/* Update secondary keys. */
-	for (i++; i < space->index_count; i++) {
+	for (; i < space->index_count; i++) {
 		struct tuple *unused;
 		struct index *index = space->index[i];
-		if (index_replace(index, old_tuple, new_tuple,
+		struct tuple *old = old_in[i] ? old_tuple : NULL;
+		struct tuple *new = new_in[i] ? new_tuple : NULL;
+		if (old == NULL && new == NULL)
+			continue;
+		if (index_replace(index, old, new,
 				  DUP_INSERT, &unused) != 0)
 			goto rollback;
 	}
 
 	memtx_space_update_bsize(space, old_tuple, new_tuple);
-	if (new_tuple != NULL)
+	((struct memtx_space *)space)->is_dirty = true;
+	if (new_tuple != NULL) {
 		tuple_ref(new_tuple);
+		for (uint32_t j = 0; j < space->index_count; j++) {
+			if (j > 0 && !new_in[j])
+				continue;
+			index_distinct_est_update(space->index[j], new_tuple);
+		}
+	}
 	*result = old_tuple;
 	return 0;
 
@@ -287,8 +329,16 @@ rollback:
 	for (; i > 0; i--) {
 		struct tuple *unused;
 		struct index *index = space->index[i - 1];
+		struct tuple *delete = new_tuple;
+		struct tuple *insert = old_tuple;
+		if (i - 1 > 0) {
+			delete = new_in[i - 1] ? new_tuple : NULL;
+			insert = old_in[i - 1] ? old_tuple : NULL;
+			if (delete == NULL && insert == NULL)
+				continue;
+		}
 		/* Rollback must not fail. */
-		if (index_replace(index, new_tuple, old_tuple,
+		if (index_replace(index, delete, insert,
 				  DUP_INSERT, &unused) != 0) {
 			diag_log();
 			unreachable();
@@ -351,6 +401,126 @@ memtx_space_execute_delete(struct space *space, struct txn *txn,
 	return 0;
 }
 
+/** Undo record of an in-place update, for statement rollback. */
+struct memtx_inplace_undo {
+	/** Rollback trigger, restores the saved bytes. */
+	struct trigger on_rollback;
+	/** Patched data inside the tuple allocation. */
+	char *data;
+	/** Size of the saved copy. */
+	uint32_t size;
+	/** Original tuple data. */
+	char saved[0];
+};
+
+static int
+memtx_inplace_update_rollback(struct trigger *trigger, void *event)
+{
+	(void)event;
+	struct memtx_inplace_undo *undo = trigger->data;
+	memcpy(undo->data, undo->saved, undo->size);
+	return 0;
+}
+
+/**
+ * Try to execute an update by patching the tuple body in place.
+ * A counter-style update - same-width scalar assignment or
+ * increment of non-indexed fields - does not move a single byte
+ * offset, so the tuple does not have to be rebuilt and reindexed
+ * and no reader can tell the difference. The statement is still
+ * WAL-logged normally from the request; only the tuple churn is
+ * gone.
+ *
+ * Qualifying is deliberately conservative: the space must have
+ * no replace triggers (they expect a distinct old tuple), no
+ * snapshot or join may be in progress (read views must keep
+ * seeing the old bytes), and nothing else may reference the
+ * tuple.
+ *
+ * @retval 0 Done, *result is set, nothing else to do.
+ * @retval -1 Not applicable, fall back to the generic path.
+ */
+static int
+memtx_space_try_inplace_update(struct space *space, struct txn *txn,
+			       struct request *request,
+			       struct tuple *old_tuple, struct tuple **result)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	if (memtx_space->replace != memtx_space_replace_all_keys)
+		return -1;
+	if (memtx->delayed_free_mode > 0)
+		return -1;
+	if (!rlist_empty(&space->on_replace) ||
+	    !rlist_empty(&space->before_replace))
+		return -1;
+	if (old_tuple->is_compressed || old_tuple->is_bigref ||
+	    old_tuple->refs != 1)
+		return -1;
+	uint64_t forbidden_mask = 0;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		/*
+		 * A partial index predicate may reference fields
+		 * outside any key_def, so a patched field could
+		 * flip the tuple's membership with no index
+		 * maintenance done here - bail out.
+		 */
+		if (index->predicate != NULL)
+			return -1;
+		forbidden_mask |= index->def->key_def->column_mask;
+	}
+	/*
+	 * The patch bypasses tuple_field_map_create(), so a field
+	 * with a declared type could be overwritten with a
+	 * same-width value the format forbids, e.g. a boolean over
+	 * an unsigned. The master would accept it, while the same
+	 * WAL row replayed through the generic path on a replica
+	 * or during recovery would raise ER_FIELD_TYPE. Forbid
+	 * patching any format-typed field.
+	 */
+	struct tuple_format *format = space->format;
+	uint32_t format_field_count = tuple_format_field_count(format);
+	for (uint32_t i = 0; i < format_field_count; i++) {
+		if (tuple_format_field(format, i)->type != FIELD_TYPE_ANY)
+			column_mask_set_fieldno(&forbidden_mask, i);
+	}
+	char *data = (char *)old_tuple + old_tuple->data_offset;
+	uint32_t bsize = old_tuple->bsize;
+	struct memtx_inplace_undo *undo =
+		region_alloc(&txn->region, sizeof(*undo) + bsize);
+	if (undo == NULL)
+		return -1;
+	undo->data = data;
+	undo->size = bsize;
+	memcpy(undo->saved, data, bsize);
+	uint64_t column_mask = 0;
+	if (xrow_update_try_inplace(data, data + bsize, request->tuple,
+				    request->tuple_end, request->index_base,
+				    forbidden_mask, &column_mask) != 0) {
+		/* The data may be partially patched - restore. */
+		memcpy(data, undo->saved, bsize);
+		return -1;
+	}
+	trigger_create(&undo->on_rollback, memtx_inplace_update_rollback,
+		       undo, NULL);
+	txn_stmt_on_rollback(stmt, &undo->on_rollback);
+	/*
+	 * No old/new tuple: the engine rollback is a no-op, the
+	 * trigger above undoes the patch. The redo row is built
+	 * from the request as usual.
+	 */
+	stmt->engine_savepoint = stmt;
+	/*
+	 * The space content changed, so it must get into the next
+	 * delta checkpoint like after any other mutation.
+	 */
+	memtx_space->is_dirty = true;
+	*result = old_tuple;
+	return 0;
+}
+
 static int
 memtx_space_execute_update(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
@@ -374,6 +544,10 @@ memtx_space_execute_update(struct space *space, struct txn *txn,
 		return 0;
 	}
 
+	if (memtx_space_try_inplace_update(space, txn, request, old_tuple,
+					   result) == 0)
+		return 0;
+
 	/* Update the tuple; legacy, request ops are in request->tuple */
 	uint32_t new_size = 0, bsize;
 	struct tuple_format *format = space->format;
@@ -813,14 +987,34 @@ struct memtx_ddl_state {
 	struct index *index;
 	/* New format to be enforced. */
 	struct tuple_format *format;
-	/* Operation cursor. Marks the last processed tuple to date */
+	/*
+	 * Operation cursor. Marks the last processed tuple to date.
+	 * NULL once the build scan is complete but the build itself
+	 * is still in progress (bulk build only).
+	 */
 	struct tuple *cursor;
 	/* Primary key key_def to compare new tuples with cursor. */
 	struct key_def *cmp_def;
+	/*
+	 * DML statements executed while an index was being bulk
+	 * built. Applied on top of the index when the build is
+	 * complete.
+	 */
+	struct stailq build_log;
 	struct diag diag;
 	int rc;
 };
 
+/** A single DML statement in memtx_ddl_state::build_log. */
+struct memtx_build_log_entry {
+	/** Link in the log. */
+	struct stailq_entry link;
+	/** Replaced tuple, NULL on INSERT. */
+	struct tuple *old_tuple;
+	/** New tuple, NULL on DELETE. */
+	struct tuple *new_tuple;
+};
+
 static int
 memtx_check_on_replace(struct trigger *trigger, void *event)
 {
@@ -869,7 +1063,10 @@ memtx_space_check_format(struct space *space, struct tuple_format *format)
 	if (txn_check_singlestatement(txn, "space format check") != 0)
 		return -1;
 
-	txn_can_yield(txn, true);
+	/* Yields are already allowed if MVCC is enabled. */
+	bool yield_disabled = !txn_has_flag(txn, TXN_CAN_YIELD);
+	if (yield_disabled)
+		txn_can_yield(txn, true);
 
 	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
 	struct memtx_ddl_state state;
@@ -913,7 +1110,8 @@ memtx_space_check_format(struct space *space, struct tuple_format *format)
 	iterator_delete(it);
 	diag_destroy(&state.diag);
 	trigger_clear(&on_replace);
-	txn_can_yield(txn, false);
+	if (yield_disabled)
+		txn_can_yield(txn, false);
 	return rc;
 }
 
@@ -945,6 +1143,41 @@ memtx_init_ephemeral_space(struct space *space)
 	memtx_space_add_primary_key(space);
 }
 
+/**
+ * Apply the partial index predicate of the index being built to
+ * the statement tuples: a tuple the predicate rejects is neither
+ * inserted into nor deleted from the new index, so the
+ * corresponding pointer is reset to NULL. No-op for a regular
+ * index.
+ * @retval 0 On success.
+ * @retval -1 On predicate evaluation error. The diag message is
+ *         set.
+ */
+static int
+memtx_ddl_filter_tuples(struct index *index, struct space *space,
+			struct tuple **old_tuple, struct tuple **new_tuple)
+{
+	if (index->predicate == NULL)
+		return 0;
+	uint32_t field_count = space->def->field_count;
+	bool match;
+	if (*old_tuple != NULL) {
+		if (ck_constraint_test(index->predicate, *old_tuple,
+				       field_count, &match) != 0)
+			return -1;
+		if (!match)
+			*old_tuple = NULL;
+	}
+	if (*new_tuple != NULL) {
+		if (ck_constraint_test(index->predicate, *new_tuple,
+				       field_count, &match) != 0)
+			return -1;
+		if (!match)
+			*new_tuple = NULL;
+	}
+	return 0;
+}
+
 static int
 memtx_build_on_replace(struct trigger *trigger, void *event)
 {
@@ -969,12 +1202,23 @@ memtx_build_on_replace(struct trigger *trigger, void *event)
 		return 0;
 	}
 
+	struct tuple *old_tuple = stmt->old_tuple;
+	struct tuple *new_tuple = stmt->new_tuple;
+	if (memtx_ddl_filter_tuples(state->index, stmt->space,
+				    &old_tuple, &new_tuple) != 0) {
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+		return 0;
+	}
+	if (old_tuple == NULL && new_tuple == NULL)
+		return 0;
+
 	struct tuple *delete = NULL;
 	enum dup_replace_mode mode =
 		state->index->def->opts.is_unique ? DUP_INSERT :
 						    DUP_REPLACE_OR_INSERT;
-	state->rc = index_replace(state->index, stmt->old_tuple,
-				  stmt->new_tuple, mode, &delete);
+	state->rc = index_replace(state->index, old_tuple,
+				  new_tuple, mode, &delete);
 
 	if (state->rc != 0) {
 		diag_move(diag_get(), &state->diag);
@@ -982,6 +1226,101 @@ memtx_build_on_replace(struct trigger *trigger, void *event)
 	return 0;
 }
 
+/**
+ * The bulk build counterpart of memtx_build_on_replace. A bulk
+ * built index must stay empty until index_end_build() loads the
+ * whole sorted key array into it at once, so instead of updating
+ * the index right away the trigger records the statement in the
+ * build log. The log is replayed on top of the index when the
+ * build is complete.
+ */
+static int
+memtx_bulk_build_on_replace(struct trigger *trigger, void *event)
+{
+	struct txn *txn = event;
+	struct memtx_ddl_state *state = trigger->data;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+
+	/* We have already failed. */
+	if (state->rc != 0)
+		return 0;
+
+	struct tuple *cmp_tuple = stmt->new_tuple != NULL ? stmt->new_tuple :
+							    stmt->old_tuple;
+	/*
+	 * Tuples above the cursor will be seen by the build scan.
+	 * Once the scan is complete, the cursor is reset to NULL
+	 * and every statement is logged.
+	 */
+	if (state->cursor != NULL &&
+	    tuple_compare(state->cursor, HINT_NONE, cmp_tuple, HINT_NONE,
+			  state->cmp_def) < 0)
+		return 0;
+
+	if (stmt->new_tuple != NULL &&
+	    tuple_validate(state->format, stmt->new_tuple) != 0) {
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+		return 0;
+	}
+
+	struct tuple *old_tuple = stmt->old_tuple;
+	struct tuple *new_tuple = stmt->new_tuple;
+	if (memtx_ddl_filter_tuples(state->index, stmt->space,
+				    &old_tuple, &new_tuple) != 0) {
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+		return 0;
+	}
+	if (old_tuple == NULL && new_tuple == NULL)
+		return 0;
+
+	struct memtx_build_log_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		diag_set(OutOfMemory, sizeof(*entry), "malloc",
+			 "build log entry");
+		state->rc = -1;
+		diag_move(diag_get(), &state->diag);
+		return 0;
+	}
+	entry->old_tuple = old_tuple;
+	entry->new_tuple = new_tuple;
+	if (entry->old_tuple != NULL)
+		tuple_ref(entry->old_tuple);
+	if (entry->new_tuple != NULL)
+		tuple_ref(entry->new_tuple);
+	stailq_add_tail_entry(&state->build_log, entry, link);
+	return 0;
+}
+
+/**
+ * Replay the build log on top of a freshly built index and
+ * destroy the log. No-op on an empty log. Yields are not allowed
+ * at this point: the log must not grow under our feet.
+ */
+static int
+memtx_build_log_apply(struct memtx_ddl_state *state, int rc)
+{
+	enum dup_replace_mode mode =
+		state->index->def->opts.is_unique ? DUP_INSERT :
+						    DUP_REPLACE_OR_INSERT;
+	struct memtx_build_log_entry *entry, *next;
+	stailq_foreach_entry_safe(entry, next, &state->build_log, link) {
+		if (rc == 0) {
+			struct tuple *delete = NULL;
+			rc = index_replace(state->index, entry->old_tuple,
+					   entry->new_tuple, mode, &delete);
+		}
+		if (entry->old_tuple != NULL)
+			tuple_unref(entry->old_tuple);
+		if (entry->new_tuple != NULL)
+			tuple_unref(entry->new_tuple);
+		free(entry);
+	}
+	stailq_create(&state->build_log);
+	return rc;
+}
+
 static int
 memtx_space_build_index(struct space *src_space, struct index *new_index,
 			struct tuple_format *new_format,
@@ -1013,6 +1352,26 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 		return -1;
 	}
 
+	/*
+	 * The primary key must reference every tuple it returns, so
+	 * it is built one tuple at a time. Unique nullable and
+	 * unique functional indexes rely on the tree's own duplicate
+	 * detection on insertion, which the bulk loader can not
+	 * provide, so they take the one-by-one path too. Everything
+	 * else is collected into a sorted array and loaded into the
+	 * index at once, see index_end_build().
+	 */
+	bool bulk = new_index->def->iid != 0 &&
+		    (!new_index->def->opts.is_unique ||
+		     (!new_index->def->key_def->is_nullable &&
+		      !new_index->def->key_def->for_func_index));
+	if (bulk) {
+		index_begin_build(new_index);
+		uint32_t estimated_tuples = index_size(pk) * 1.2;
+		if (index_reserve(new_index, estimated_tuples) != 0)
+			return -1;
+	}
+
 	/* Now deal with any kind of add index during normal operation. */
 	struct iterator *it = index_create_iterator(pk, ITER_ALL, NULL, 0);
 	if (it == NULL)
@@ -1021,18 +1380,24 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 	if (txn_check_singlestatement(txn, "index build") != 0)
 		return -1;
 
-	txn_can_yield(txn, true);
+	/* Yields are already allowed if MVCC is enabled. */
+	bool yield_disabled = !txn_has_flag(txn, TXN_CAN_YIELD);
+	if (yield_disabled)
+		txn_can_yield(txn, true);
 
 	struct memtx_engine *memtx = (struct memtx_engine *)src_space->engine;
 	struct memtx_ddl_state state;
 	state.index = new_index;
 	state.format = new_format;
 	state.cmp_def = pk->def->key_def;
+	stailq_create(&state.build_log);
 	state.rc = 0;
 	diag_create(&state.diag);
 
 	struct trigger on_replace;
-	trigger_create(&on_replace, memtx_build_on_replace, &state, NULL);
+	trigger_create(&on_replace, bulk ? memtx_bulk_build_on_replace :
+					   memtx_build_on_replace,
+		       &state, NULL);
 	trigger_add(&src_space->on_replace, &on_replace);
 
 	/*
@@ -1055,15 +1420,34 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 		if (rc != 0)
 			break;
 		/*
-		 * @todo: better message if there is a duplicate.
+		 * A partial index stores only the tuples its
+		 * predicate is satisfied for. The rest are still
+		 * scanned to keep the yield cadence and the
+		 * on_replace cursor in order.
 		 */
-		struct tuple *old_tuple;
-		rc = index_replace(new_index, NULL, tuple,
-				   DUP_INSERT, &old_tuple);
+		bool match = true;
+		if (new_index->predicate != NULL) {
+			rc = ck_constraint_test(new_index->predicate, tuple,
+						src_space->def->field_count,
+						&match);
+			if (rc != 0)
+				break;
+		}
+		if (match && bulk) {
+			rc = index_build_next(new_index, tuple);
+		} else if (match) {
+			/*
+			 * @todo: better message if there is a duplicate.
+			 */
+			struct tuple *old_tuple;
+			rc = index_replace(new_index, NULL, tuple,
+					   DUP_INSERT, &old_tuple);
+			/* Guaranteed by DUP_INSERT. */
+			assert(rc != 0 || old_tuple == NULL);
+			(void) old_tuple;
+		}
 		if (rc != 0)
 			break;
-		assert(old_tuple == NULL); /* Guaranteed by DUP_INSERT. */
-		(void) old_tuple;
 		/*
 		 * All tuples stored in a memtx space must be
 		 * referenced by the primary index.
@@ -1097,9 +1481,28 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 		}
 	}
 	iterator_delete(it);
+	if (bulk) {
+		/*
+		 * The whole space has been scanned - every statement
+		 * must be logged from now on.
+		 */
+		state.cursor = NULL;
+		if (rc == 0)
+			rc = index_end_build(new_index);
+		/*
+		 * The trigger may have failed while end_build was
+		 * waiting for the sorter thread.
+		 */
+		if (rc == 0 && state.rc != 0) {
+			rc = -1;
+			diag_move(&state.diag, diag_get());
+		}
+		rc = memtx_build_log_apply(&state, rc);
+	}
 	diag_destroy(&state.diag);
 	trigger_clear(&on_replace);
-	txn_can_yield(txn, false);
+	if (yield_disabled)
+		txn_can_yield(txn, false);
 	return rc;
 }
 
@@ -1168,12 +1571,22 @@ memtx_space_new(struct memtx_engine *memtx,
 		tuple_format_new(&memtx_tuple_format_vtab, memtx, keys, key_count,
 				 def->fields, def->field_count,
 				 def->exact_field_count, def->dict,
-				 def->opts.is_temporary, def->opts.is_ephemeral);
+				 def->opts.is_temporary, def->opts.is_ephemeral,
+				 def->opts.is_scan_optimized);
 	if (format == NULL) {
 		free(memtx_space);
 		return NULL;
 	}
+	format->is_compressed = def->opts.is_compressed;
 	tuple_format_ref(format);
+	if (def->opts.is_dictionary && format->value_dict == NULL) {
+		format->value_dict = tuple_value_dict_new();
+		if (format->value_dict == NULL) {
+			tuple_format_unref(format);
+			free(memtx_space);
+			return NULL;
+		}
+	}
 
 	if (space_create((struct space *)memtx_space, (struct engine *)memtx,
 			 &memtx_space_vtab, def, key_list, format) != 0) {
@@ -1188,5 +1601,11 @@ memtx_space_new(struct memtx_engine *memtx,
 	memtx_space->bsize = 0;
 	memtx_space->rowid = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
+	/*
+	 * A new space object must make it into the next delta
+	 * snapshot even if space alter only moved old tuples
+	 * into it, bypassing replace().
+	 */
+	memtx_space->is_dirty = true;
 	return (struct space *)memtx_space;
 }
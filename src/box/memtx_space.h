@@ -55,6 +55,14 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/**
+	 * Set whenever the space data is modified and cleared
+	 * when a checkpoint takes a read view of the space.
+	 * An incremental checkpoint does not write clean spaces
+	 * to the delta snapshot - their content is taken from
+	 * the base checkpoint on recovery.
+	 */
+	bool is_dirty;
 };
 
 /**
@@ -174,6 +174,41 @@ tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
 	return 0;
 }
 
+static void
+tree_iterator_prefetch(struct iterator *iterator)
+{
+	struct memtx_tree_index *index =
+		(struct memtx_tree_index *)iterator->index;
+	struct tree_iterator *it = tree_iterator(iterator);
+	if (it->current.tuple == NULL)
+		return;
+	/*
+	 * A scan known to be point-like does not benefit from
+	 * looking one element ahead - skip the peek overhead.
+	 */
+	if (iterator->scan_estimate != 0 && iterator->scan_estimate <= 2)
+		return;
+	/*
+	 * Peek at the following position without advancing the
+	 * iterator. If the tree has changed underneath, drop the
+	 * hint - the next() call restarts from a bound lookup
+	 * anyway.
+	 */
+	struct memtx_tree_data *check =
+		memtx_tree_iterator_get_elem(&index->tree, &it->tree_iterator);
+	if (check == NULL || !memtx_tree_data_is_equal(check, &it->current))
+		return;
+	struct memtx_tree_iterator peek = it->tree_iterator;
+	if (iterator_type_is_reverse(it->type))
+		memtx_tree_iterator_prev(&index->tree, &peek);
+	else
+		memtx_tree_iterator_next(&index->tree, &peek);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(&index->tree, &peek);
+	if (res != NULL)
+		prefetch(res->tuple, 0, 1);
+}
+
 static int
 tree_iterator_next(struct iterator *iterator, struct tuple **ret)
 {
@@ -448,6 +483,23 @@ static const struct memtx_gc_task_vtab memtx_tree_index_gc_vtab = {
 	.free = memtx_tree_index_gc_free,
 };
 
+/**
+ * A secondary index does not hold tuple references, so the only
+ * work left to the background fiber is returning the tree blocks
+ * to the slab arena, which is done by the free callback.
+ */
+static void
+memtx_tree_index_gc_run_blocks(struct memtx_gc_task *task, bool *done)
+{
+	(void)task;
+	*done = true;
+}
+
+static const struct memtx_gc_task_vtab memtx_tree_index_gc_blocks_vtab = {
+	.run = memtx_tree_index_gc_run_blocks,
+	.free = memtx_tree_index_gc_free,
+};
+
 static void
 memtx_tree_index_destroy(struct index *base)
 {
@@ -462,10 +514,19 @@ memtx_tree_index_destroy(struct index *base)
 		index->gc_task.vtab = &memtx_tree_index_gc_vtab;
 		index->gc_iterator = memtx_tree_iterator_first(&index->tree);
 		memtx_engine_schedule_gc(memtx, &index->gc_task);
+	} else if (memtx_tree_size(&index->tree) > 0) {
+		/*
+		 * Secondary index. Tuples are owned by the primary
+		 * index, but a big tree still takes a while to
+		 * return its blocks to the arena, so hand it over
+		 * to the background fiber as well.
+		 */
+		index->gc_task.vtab = &memtx_tree_index_gc_blocks_vtab;
+		memtx_engine_schedule_gc(memtx, &index->gc_task);
 	} else {
 		/*
-		 * Secondary index. Destruction is fast, no need to
-		 * hand over to background fiber.
+		 * An empty secondary index. Destruction is fast,
+		 * no need to hand over to background fiber.
 		 */
 		memtx_tree_index_free(index);
 	}
@@ -526,6 +587,30 @@ memtx_tree_index_count(struct index *base, enum iterator_type type,
 	return generic_index_count(base, type, key, part_count);
 }
 
+static ssize_t
+memtx_tree_index_split(struct index *base, uint32_t count,
+		       struct tuple **result)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	/* Tree positions are 16 bit, see bps_tree_pos_t. */
+	if (count > (uint32_t)INT16_MAX)
+		count = INT16_MAX;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	struct memtx_tree_data *elems =
+		region_alloc(region, (count - 1) * sizeof(*elems));
+	if (elems == NULL) {
+		diag_set(OutOfMemory, (count - 1) * sizeof(*elems),
+			 "region", "split elems");
+		return -1;
+	}
+	ssize_t n = memtx_tree_estimate_splits(&index->tree, count, elems);
+	for (ssize_t i = 0; i < n; i++)
+		result[i] = elems[i].tuple;
+	region_truncate(region, region_svp);
+	return n;
+}
+
 static int
 memtx_tree_index_get(struct index *base, const char *key,
 		     uint32_t part_count, struct tuple **result)
@@ -543,6 +628,46 @@ memtx_tree_index_get(struct index *base, const char *key,
 	return 0;
 }
 
+static int
+memtx_tree_index_get_multi(struct index *base, const char **keys,
+			   const uint32_t *part_counts, uint32_t key_count,
+			   struct tuple **results)
+{
+	assert(base->def->opts.is_unique);
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	/*
+	 * Lookups are pipelined in chunks: bps_tree_find_multi
+	 * descends the tree for a whole chunk in lock step and
+	 * overlaps the cache misses of the descents.
+	 */
+	enum { GET_MULTI_CHUNK = 16 };
+	struct memtx_tree_key_data key_datas[GET_MULTI_CHUNK];
+	struct memtx_tree_key_data *key_ptrs[GET_MULTI_CHUNK];
+	struct memtx_tree_data *elems[GET_MULTI_CHUNK];
+	for (uint32_t first = 0; first < key_count;
+	     first += GET_MULTI_CHUNK) {
+		uint32_t n = key_count - first;
+		if (n > GET_MULTI_CHUNK)
+			n = GET_MULTI_CHUNK;
+		for (uint32_t i = 0; i < n; i++) {
+			assert(part_counts[first + i] ==
+			       base->def->key_def->part_count);
+			key_datas[i].key = keys[first + i];
+			key_datas[i].part_count = part_counts[first + i];
+			key_datas[i].hint = key_hint(key_datas[i].key,
+						     key_datas[i].part_count,
+						     cmp_def);
+			key_ptrs[i] = &key_datas[i];
+		}
+		memtx_tree_find_multi(&index->tree, key_ptrs, n, elems);
+		for (uint32_t i = 0; i < n; i++)
+			results[first + i] =
+				elems[i] != NULL ? elems[i]->tuple : NULL;
+	}
+	return 0;
+}
+
 static int
 memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 			 struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -1004,6 +1129,7 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 	iterator_create(&it->base, base);
 	it->pool = &memtx->iterator_pool;
 	it->base.next = tree_iterator_start;
+	it->base.prefetch = tree_iterator_prefetch;
 	it->base.free = tree_iterator_free;
 	it->type = type;
 	it->key_data.key = key;
@@ -1040,10 +1166,13 @@ memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
 	return 0;
 }
 
-/** Initialize the next element of the index build_array. */
+/**
+ * Make sure the build_array can accommodate @a count more
+ * elements, growing it exponentially when it can not.
+ */
 static int
-memtx_tree_index_build_array_append(struct memtx_tree_index *index,
-				    struct tuple *tuple, hint_t hint)
+memtx_tree_index_build_array_ensure(struct memtx_tree_index *index,
+				    uint32_t count)
 {
 	if (index->build_array == NULL) {
 		index->build_array = malloc(MEMTX_EXTENT_SIZE);
@@ -1056,19 +1185,32 @@ memtx_tree_index_build_array_append(struct memtx_tree_index *index,
 			MEMTX_EXTENT_SIZE / sizeof(index->build_array[0]);
 	}
 	assert(index->build_array_size <= index->build_array_alloc_size);
-	if (index->build_array_size == index->build_array_alloc_size) {
+	if (index->build_array_size + count <= index->build_array_alloc_size)
+		return 0;
+	while (index->build_array_size + count >
+	       index->build_array_alloc_size) {
 		index->build_array_alloc_size = index->build_array_alloc_size +
 				DIV_ROUND_UP(index->build_array_alloc_size, 2);
-		struct memtx_tree_data *tmp =
-			realloc(index->build_array,
-				index->build_array_alloc_size * sizeof(*tmp));
-		if (tmp == NULL) {
-			diag_set(OutOfMemory, index->build_array_alloc_size *
-				 sizeof(*tmp), "memtx_tree_index", "build_next");
-			return -1;
-		}
-		index->build_array = tmp;
 	}
+	struct memtx_tree_data *tmp =
+		realloc(index->build_array,
+			index->build_array_alloc_size * sizeof(*tmp));
+	if (tmp == NULL) {
+		diag_set(OutOfMemory, index->build_array_alloc_size *
+			 sizeof(*tmp), "memtx_tree_index", "build_next");
+		return -1;
+	}
+	index->build_array = tmp;
+	return 0;
+}
+
+/** Initialize the next element of the index build_array. */
+static int
+memtx_tree_index_build_array_append(struct memtx_tree_index *index,
+				    struct tuple *tuple, hint_t hint)
+{
+	if (memtx_tree_index_build_array_ensure(index, 1) != 0)
+		return -1;
 	struct memtx_tree_data *elem =
 		&index->build_array[index->build_array_size++];
 	elem->tuple = tuple;
@@ -1090,13 +1232,24 @@ memtx_tree_index_build_next_multikey(struct index *base, struct tuple *tuple)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	/*
+	 * The multikey array is resolved through the field map
+	 * once, for the count; the entries themselves carry only
+	 * the array index as a hint, so they can be emitted in
+	 * one tight loop with a single capacity check for the
+	 * whole batch.
+	 */
 	uint32_t multikey_count = tuple_multikey_count(tuple, cmp_def);
+	if (memtx_tree_index_build_array_ensure(index, multikey_count) != 0)
+		return -1;
+	struct memtx_tree_data *elem =
+		&index->build_array[index->build_array_size];
 	for (uint32_t multikey_idx = 0; multikey_idx < multikey_count;
-	     multikey_idx++) {
-		if (memtx_tree_index_build_array_append(index, tuple,
-							multikey_idx) != 0)
-			return -1;
+	     multikey_idx++, elem++) {
+		elem->tuple = tuple;
+		elem->hint = multikey_idx;
 	}
+	index->build_array_size += multikey_count;
 	return 0;
 }
 
@@ -1174,13 +1327,71 @@ memtx_tree_index_build_array_deduplicate(struct memtx_tree_index *index,
 	index->build_array_size = w_idx + 1;
 }
 
-static void
+/*
+ * Build arrays at least this big are sorted in a separate thread.
+ * Sorting is by far the most expensive part of a bulk index build
+ * and it only reads the tuples, so there is no point in blocking
+ * the tx thread for seconds while it is in progress. Smaller
+ * arrays are not worth the thread start overhead.
+ */
+enum { MEMTX_TREE_SORT_THREAD_THRESHOLD = 128 * 1024 };
+
+/** Sort task shipped to the sorter thread. */
+struct memtx_tree_sort_task {
+	/** The build array to sort. */
+	struct memtx_tree_data *build_array;
+	/** Number of elements in the array. */
+	size_t build_array_size;
+	/** Definition to order the array by. */
+	struct key_def *cmp_def;
+};
+
+static int
+memtx_tree_sort_f(va_list ap)
+{
+	struct memtx_tree_sort_task *task =
+		va_arg(ap, struct memtx_tree_sort_task *);
+	qsort_arg(task->build_array, task->build_array_size,
+		  sizeof(task->build_array[0]), memtx_tree_qcompare,
+		  task->cmp_def);
+	return 0;
+}
+
+static int
 memtx_tree_index_end_build(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
-	qsort_arg(index->build_array, index->build_array_size,
-		  sizeof(index->build_array[0]), memtx_tree_qcompare, cmp_def);
+	bool is_sorted = false;
+	if (index->build_array_size >= MEMTX_TREE_SORT_THREAD_THRESHOLD) {
+		/*
+		 * Offload sorting to a separate thread. Tuple
+		 * comparators only read the tuples and don't touch
+		 * any tx thread state, and the build array itself
+		 * is frozen - DML arriving while we are yielding in
+		 * cord_cojoin() is recorded by the build trigger and
+		 * applied on top of the tree afterwards, see
+		 * memtx_space_build_index(). During recovery there
+		 * is no DML at all, and yielding here lets the build
+		 * fibers of the other secondary indexes run, so the
+		 * sorts overlap, see memtx_build_secondary_keys().
+		 */
+		struct memtx_tree_sort_task task = {
+			index->build_array, index->build_array_size, cmp_def,
+		};
+		struct cord cord;
+		if (cord_costart(&cord, "memtx.index.sort",
+				 memtx_tree_sort_f, &task) == 0) {
+			if (cord_cojoin(&cord) != 0)
+				return -1;
+			is_sorted = true;
+		}
+	}
+	if (!is_sorted) {
+		qsort_arg(index->build_array, index->build_array_size,
+			  sizeof(index->build_array[0]), memtx_tree_qcompare,
+			  cmp_def);
+	}
 	if (cmp_def->is_multikey) {
 		/*
 		 * Multikey index may have equal(in terms of
@@ -1194,13 +1405,44 @@ memtx_tree_index_end_build(struct index *base)
 		memtx_tree_index_build_array_deduplicate(index,
 							 tuple_chunk_delete);
 	}
-	memtx_tree_build(&index->tree, index->build_array,
-			 index->build_array_size);
+	if (base->def->opts.is_unique && !base->def->key_def->is_nullable &&
+	    !cmp_def->for_func_index) {
+		/*
+		 * The one-by-one build path detects unique constraint
+		 * violations on insertion into the tree. Here all keys
+		 * go into the tree at once, so check the sorted array
+		 * instead: tuples with equal unique key parts are
+		 * neighbors in it, because cmp_def extends key_def
+		 * with the primary key parts.
+		 */
+		struct key_def *key_def = base->def->key_def;
+		for (size_t i = 1; i < index->build_array_size; i++) {
+			struct memtx_tree_data *prev =
+				&index->build_array[i - 1];
+			struct memtx_tree_data *curr =
+				&index->build_array[i];
+			if (tuple_compare(prev->tuple, prev->hint,
+					  curr->tuple, curr->hint,
+					  key_def) == 0) {
+				struct space *sp =
+					space_cache_find(base->def->space_id);
+				if (sp == NULL)
+					return -1;
+				diag_set(ClientError, ER_TUPLE_FOUND,
+					 base->def->name, space_name(sp));
+				return -1;
+			}
+		}
+	}
+	if (memtx_tree_build(&index->tree, index->build_array,
+			     index->build_array_size) != 0)
+		return -1;
 
 	free(index->build_array);
 	index->build_array = NULL;
 	index->build_array_size = 0;
 	index->build_array_alloc_size = 0;
+	return 0;
 }
 
 struct tree_snapshot_iterator {
@@ -1284,7 +1526,9 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .split = */ memtx_tree_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_multi = */ memtx_tree_index_get_multi,
 	/* .replace = */ memtx_tree_index_replace,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1314,7 +1558,9 @@ static const struct index_vtab memtx_tree_index_multikey_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_multi = */ memtx_tree_index_get_multi,
 	/* .replace = */ memtx_tree_index_replace_multikey,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1344,7 +1590,9 @@ static const struct index_vtab memtx_tree_func_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_multi = */ memtx_tree_index_get_multi,
 	/* .replace = */ memtx_tree_func_index_replace,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1380,7 +1628,9 @@ static const struct index_vtab memtx_tree_disabled_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ generic_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ disabled_index_replace,
 	/* .create_iterator = */ generic_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_tx.h"
+
+#include <msgpuck.h>
+#include <small/region.h>
+
+#include "diag.h"
+#include "errcode.h"
+#include "index.h"
+#include "key_def.h"
+#include "schema.h"
+#include "space.h"
+#include "tuple.h"
+#include "txn.h"
+
+/** A tuple read by a transaction statement. */
+struct memtx_tx_read {
+	/** Link in memtx_tx::read_set. */
+	struct stailq_entry next;
+	/** ID of the space the tuple was read from. */
+	uint32_t space_id;
+	/** The tuple. Referenced until the transaction ends. */
+	struct tuple *tuple;
+};
+
+/**
+ * Conflict tracker of a memtx transaction,
+ * struct txn::engine_tx. Allocated on the transaction region.
+ */
+struct memtx_tx {
+	/** List of memtx_tx_read records. */
+	struct stailq read_set;
+	/** Last tracked tuple, to cheaply dedup iterator reads. */
+	struct tuple *last_read;
+};
+
+int
+memtx_tx_begin(struct txn *txn)
+{
+	assert(txn->engine_tx == NULL);
+	struct memtx_tx *tx = region_alloc_object(&txn->region,
+						  struct memtx_tx);
+	if (tx == NULL) {
+		diag_set(OutOfMemory, sizeof(*tx), "region",
+			 "struct memtx_tx");
+		return -1;
+	}
+	stailq_create(&tx->read_set);
+	tx->last_read = NULL;
+	txn->engine_tx = tx;
+	return 0;
+}
+
+/**
+ * True if @a txn is a memtx transaction with a conflict tracker
+ * attached. A vinyl transaction also has engine_tx set, hence
+ * the engine check.
+ */
+static bool
+memtx_tx_is_active(struct txn *txn, struct space *space)
+{
+	return txn->engine_tx != NULL && txn->engine == space->engine &&
+	       space_is_memtx(space);
+}
+
+int
+memtx_tx_track_read(struct txn *txn, struct space *space,
+		    struct tuple *tuple)
+{
+	if (txn == NULL || tuple == NULL || !memtx_tx_is_active(txn, space))
+		return 0;
+	struct memtx_tx *tx = txn->engine_tx;
+	if (tx->last_read == tuple)
+		return 0;
+	struct memtx_tx_read *read = region_alloc_object(&txn->region,
+							 struct memtx_tx_read);
+	if (read == NULL) {
+		diag_set(OutOfMemory, sizeof(*read), "region",
+			 "struct memtx_tx_read");
+		return -1;
+	}
+	read->space_id = space_id(space);
+	read->tuple = tuple;
+	tuple_ref(tuple);
+	stailq_add_tail_entry(&tx->read_set, read, next);
+	tx->last_read = tuple;
+	return 0;
+}
+
+/**
+ * Check if the transaction itself replaced or deleted @a tuple.
+ * Then the tuple is gone from the indexes for a good reason and
+ * the read is still valid: if another transaction had changed
+ * the tuple between the read and the write, the write statement
+ * would have seen that other tuple as its old one, not ours.
+ */
+static bool
+memtx_tx_is_own_write(struct txn *txn, struct tuple *tuple)
+{
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->old_tuple == tuple)
+			return true;
+	}
+	return false;
+}
+
+int
+memtx_tx_prepare(struct txn *txn)
+{
+	struct memtx_tx *tx = txn->engine_tx;
+	if (tx == NULL)
+		return 0;
+	struct memtx_tx_read *read;
+	stailq_foreach_entry(read, &tx->read_set, next) {
+		if (memtx_tx_is_own_write(txn, read->tuple))
+			continue;
+		/*
+		 * The space may have been dropped or truncated
+		 * while the transaction was yielding - that is a
+		 * conflict, too.
+		 */
+		struct space *space = space_by_id(read->space_id);
+		if (space == NULL || space->index_count == 0)
+			goto conflict;
+		struct index *pk = space->index[0];
+		uint32_t key_size;
+		const char *key = tuple_extract_key(read->tuple,
+						    pk->def->key_def,
+						    MULTIKEY_NONE, &key_size);
+		if (key == NULL)
+			return -1;
+		uint32_t part_count = mp_decode_array(&key);
+		struct tuple *found;
+		if (index_get(pk, key, part_count, &found) != 0)
+			return -1;
+		if (found != read->tuple)
+			goto conflict;
+	}
+	return 0;
+conflict:
+	diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+	return -1;
+}
+
+void
+memtx_tx_end(struct txn *txn)
+{
+	struct memtx_tx *tx = txn->engine_tx;
+	if (tx == NULL)
+		return;
+	struct memtx_tx_read *read;
+	stailq_foreach_entry(read, &tx->read_set, next)
+		tuple_unref(read->tuple);
+	txn->engine_tx = NULL;
+}
@@ -0,0 +1,102 @@
+#ifndef TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct txn;
+struct space;
+struct tuple;
+
+/**
+ * Optimistic conflict detection for multi-statement memtx
+ * transactions, box.cfg.memtx_use_mvcc_engine.
+ *
+ * Normally a memtx transaction is aborted if its fiber yields:
+ * statements are applied to the indexes right away, so a yield
+ * would expose uncommitted changes to other fibers and let them
+ * change the data the transaction has already seen. When the
+ * optimistic mode is enabled, a transaction is allowed to yield
+ * and proceed. Instead, it collects a read set - the tuples its
+ * statements returned - and on commit verifies that each of them
+ * is still in its primary index. If a concurrent transaction has
+ * replaced or deleted any of them in the meantime, the commit
+ * fails with ER_TRANSACTION_CONFLICT and the transaction is
+ * rolled back.
+ *
+ * This is conflict detection, not isolation: uncommitted changes
+ * of a yielding transaction are visible to other fibers, and
+ * reads that returned nothing (gap reads) are not tracked. It is
+ * enough to make read-modify-write patterns safe, which is what
+ * multi-statement transactions are usually about.
+ */
+
+/**
+ * Attach a conflict tracker to a starting memtx transaction.
+ * Called instead of disabling yields when the optimistic mode
+ * is enabled.
+ */
+int
+memtx_tx_begin(struct txn *txn);
+
+/**
+ * Record a tuple read by a transaction statement. No-op unless
+ * @a txn is a memtx transaction with a conflict tracker
+ * attached. The tuple is referenced until the transaction ends.
+ */
+int
+memtx_tx_track_read(struct txn *txn, struct space *space,
+		    struct tuple *tuple);
+
+/**
+ * Validate the read set on commit: check that every read tuple
+ * is still in the primary index of its space, unless the
+ * transaction itself removed it. Returns -1 and sets
+ * ER_TRANSACTION_CONFLICT diagnostics on a conflict.
+ */
+int
+memtx_tx_prepare(struct txn *txn);
+
+/**
+ * Release the read set references. Called on both commit and
+ * rollback.
+ */
+void
+memtx_tx_end(struct txn *txn);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_TX_H_INCLUDED */
@@ -32,14 +32,14 @@
 #include "box/merger.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
-
-#define HEAP_FORWARD_DECLARATION
-#include "salad/heap.h"
+#include <string.h>
 
 #include "diag.h"             /* diag_set() */
+#include "trivia/util.h"      /* MIN(), SWAP() */
 #include "box/tuple.h"        /* tuple_ref(), tuple_unref(),
 				 tuple_validate() */
 #include "box/tuple_format.h" /* box_tuple_format_new(),
@@ -49,45 +49,67 @@
 
 /* {{{ Merger */
 
+enum {
+	/**
+	 * Size of the normalized key prefix cached per source, in
+	 * bytes. Big enough to make most comparisons of multi-part
+	 * string keys a single memcmp(), small enough to keep a
+	 * 64-way merge state within a couple of cache lines.
+	 */
+	MERGER_NORM_KEY_SIZE = 32,
+};
+
 /**
- * Holds a source to fetch next tuples and a last fetched tuple to
- * compare the node against other nodes.
- *
- * The main reason why this structure is separated from a merge
- * source is that a heap node can not be a member of several
- * heaps.
- *
- * The second reason is that it allows to encapsulate all heap
- * related logic inside this compilation unit, without any traces
- * in externally visible structures.
+ * Normalized key field tags. Their order must follow the scalar
+ * type order: nil < boolean < number < string.
  */
-struct merger_heap_node {
+enum {
+	MERGER_NORM_TAG_NIL = 0x01,
+	MERGER_NORM_TAG_BOOL = 0x02,
+	MERGER_NORM_TAG_NUMBER = 0x03,
+	MERGER_NORM_TAG_STR = 0x04,
+};
+
+/**
+ * Holds a source to fetch next tuples and the last fetched tuple
+ * along with its cached normalized key to compare the node
+ * against other nodes.
+ */
+struct merger_node {
 	/* A source of tuples. */
 	struct merge_source *source;
 	/*
 	 * A last fetched (refcounted) tuple to compare against
-	 * other nodes.
+	 * other nodes, NULL when the source is exhausted.
 	 */
 	struct tuple *tuple;
-	/* An anchor to make the structure a merger heap node. */
-	struct heap_node in_merger;
+	/*
+	 * The key of @tuple, normalized so that memcmp() over the
+	 * common valid length of two keys gives the same order as
+	 * tuple_compare(): each encoded byte extends an
+	 * order-preserving prefix of the key. See
+	 * merger_node_encode_key().
+	 */
+	uint8_t norm_key[MERGER_NORM_KEY_SIZE];
+	/* Number of valid bytes in @norm_key. */
+	uint8_t norm_key_len;
+	/*
+	 * Set when @norm_key covers the entire key, in which case
+	 * equal keys of equal length mean equal tuples and no
+	 * comparator fallback is needed.
+	 */
+	bool norm_key_exact;
 };
 
-static bool
-merge_source_less(const heap_t *heap, const struct merger_heap_node *left,
-		  const struct merger_heap_node *right);
-#define HEAP_NAME merger_heap
-#define HEAP_LESS merge_source_less
-#define heap_value_t struct merger_heap_node
-#define heap_value_attr in_merger
-#include "salad/heap.h"
-#undef HEAP_NAME
-#undef HEAP_LESS
-#undef heap_value_t
-#undef heap_value_attr
-
 /**
- * Holds a heap, parameters of a merge process and utility fields.
+ * Holds a loser tree of sources, parameters of a merge process
+ * and utility fields.
+ *
+ * Unlike a binary heap, a tournament (loser) tree replays only
+ * the path from the changed leaf to the root after a pop - one
+ * comparison per level, no sift with two comparisons per level -
+ * which matters for wide merges where a pop happens per output
+ * tuple.
  */
 struct merger {
 	/* A merger is a source. */
@@ -95,8 +117,8 @@ struct merger {
 	/*
 	 * Whether a merge process started.
 	 *
-	 * The merger postpones charging of heap nodes until a
-	 * first output tuple is acquired.
+	 * The merger postpones charging of the tree until a first
+	 * output tuple is acquired.
 	 */
 	bool started;
 	/* A key_def to compare tuples. */
@@ -104,52 +126,241 @@ struct merger {
 	/* A format to acquire compatible tuples from sources. */
 	struct tuple_format *format;
 	/*
-	 * A heap of sources (of nodes that contains a source to
-	 * be exact).
+	 * Internal nodes of the loser tree: tree[i], i >= 1,
+	 * holds the index of the leaf that lost the match at this
+	 * node; leaf indexes >= node_count denote virtual,
+	 * infinitely large leaves padding the tree to a power of
+	 * two. The overall winner is kept in @winner.
 	 */
-	heap_t heap;
-	/* An array of heap nodes. */
+	uint32_t *tree;
+	/* Number of leaves, a power of two, >= node_count. */
+	uint32_t tree_size;
+	/* The current overall winner leaf. */
+	uint32_t winner;
+	/* An array of leaves. */
 	uint32_t node_count;
-	struct merger_heap_node *nodes;
+	struct merger_node *nodes;
+	/*
+	 * Set when the key can not be normalized at all (multikey
+	 * or functional key_def): every comparison goes through
+	 * tuple_compare() then.
+	 */
+	bool norm_keys_disabled;
 	/* Ascending (false) / descending (true) order. */
 	bool reverse;
 };
 
 /* Helpers */
 
+/** Append a double in an order-preserving big-endian form. */
+static inline void
+merger_norm_key_put_double(uint8_t *out, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	if (bits & (UINT64_C(1) << 63))
+		bits = ~bits;
+	else
+		bits |= UINT64_C(1) << 63;
+	for (int i = 7; i >= 0; i--) {
+		out[i] = bits & 0xff;
+		bits >>= 8;
+	}
+}
+
 /**
- * Data comparing function to construct a heap of sources.
+ * Normalize the key of node->tuple into node->norm_key.
+ *
+ * The invariant provided: for any two nodes, memcmp() over the
+ * common valid length of their normalized keys is either the
+ * tuple_compare() order or zero. Whatever can not be encoded in
+ * an order-preserving byte form - a collated string, an integer
+ * that does not fit a double exactly, a NaN, an exotic type -
+ * simply ends the normalized prefix, leaving the decision to the
+ * comparator fallback.
+ */
+static void
+merger_node_encode_key(struct merger *merger, struct merger_node *node)
+{
+	node->norm_key_len = 0;
+	node->norm_key_exact = false;
+	if (merger->norm_keys_disabled)
+		return;
+
+	uint8_t *out = node->norm_key;
+	uint8_t *end = out + MERGER_NORM_KEY_SIZE;
+	struct key_def *key_def = merger->key_def;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		struct key_part *part = &key_def->parts[i];
+		/* Binary order is not the collation order. */
+		if (part->coll != NULL)
+			goto done;
+		if (out >= end)
+			goto done;
+		const char *field = tuple_field_by_part(node->tuple, part,
+							MULTIKEY_NONE);
+		enum mp_type type = field != NULL ? mp_typeof(*field) : MP_NIL;
+		switch (type) {
+		case MP_NIL:
+			*out++ = MERGER_NORM_TAG_NIL;
+			break;
+		case MP_BOOL:
+			if (end - out < 2)
+				goto done;
+			*out++ = MERGER_NORM_TAG_BOOL;
+			*out++ = mp_decode_bool(&field) ? 1 : 0;
+			break;
+		case MP_UINT: {
+			uint64_t value = mp_decode_uint(&field);
+			/* A collapsing encoding would lie on order. */
+			if (value > (UINT64_C(1) << 53) ||
+			    end - out < 9)
+				goto done;
+			*out++ = MERGER_NORM_TAG_NUMBER;
+			merger_norm_key_put_double(out, (double)value);
+			out += 8;
+			break;
+		}
+		case MP_INT: {
+			int64_t value = mp_decode_int(&field);
+			if (value < -(INT64_C(1) << 53) ||
+			    value > (INT64_C(1) << 53) ||
+			    end - out < 9)
+				goto done;
+			*out++ = MERGER_NORM_TAG_NUMBER;
+			merger_norm_key_put_double(out, (double)value);
+			out += 8;
+			break;
+		}
+		case MP_FLOAT:
+		case MP_DOUBLE: {
+			double value = type == MP_FLOAT ?
+				       mp_decode_float(&field) :
+				       mp_decode_double(&field);
+			if (isnan(value) || end - out < 9)
+				goto done;
+			*out++ = MERGER_NORM_TAG_NUMBER;
+			merger_norm_key_put_double(out, value);
+			out += 8;
+			break;
+		}
+		case MP_STR: {
+			uint32_t len;
+			const char *str = mp_decode_str(&field, &len);
+			*out++ = MERGER_NORM_TAG_STR;
+			/*
+			 * Escape zero bytes and terminate with a
+			 * zero pair so that "ab" sorts before
+			 * "ab\0" and a next field can not bleed
+			 * into the comparison of this one.
+			 */
+			for (uint32_t k = 0; k < len; k++) {
+				if (end - out < 2) {
+					node->norm_key_len = out -
+						node->norm_key;
+					return;
+				}
+				uint8_t c = (uint8_t)str[k];
+				*out++ = c;
+				if (c == 0)
+					*out++ = 0xff;
+			}
+			if (end - out < 2) {
+				node->norm_key_len = out - node->norm_key;
+				return;
+			}
+			*out++ = 0;
+			*out++ = 0;
+			break;
+		}
+		default:
+			goto done;
+		}
+	}
+	node->norm_key_exact = true;
+done:
+	node->norm_key_len = out - node->norm_key;
+}
+
+/**
+ * Leaf ordering function of the loser tree. Exhausted sources
+ * and virtual leaves compare as infinitely large.
  */
 static bool
-merge_source_less(const heap_t *heap, const struct merger_heap_node *left,
-		  const struct merger_heap_node *right)
+merger_node_less(const struct merger *merger, uint32_t a, uint32_t b)
 {
-	assert(left->tuple != NULL);
-	assert(right->tuple != NULL);
-	struct merger *merger = container_of(heap, struct merger, heap);
-	int cmp = tuple_compare(left->tuple, HINT_NONE, right->tuple, HINT_NONE,
-				merger->key_def);
+	bool a_inf = a >= merger->node_count ||
+		     merger->nodes[a].tuple == NULL;
+	bool b_inf = b >= merger->node_count ||
+		     merger->nodes[b].tuple == NULL;
+	if (a_inf || b_inf)
+		return !a_inf && b_inf;
+	const struct merger_node *na = &merger->nodes[a];
+	const struct merger_node *nb = &merger->nodes[b];
+	uint32_t len = MIN(na->norm_key_len, nb->norm_key_len);
+	int cmp = memcmp(na->norm_key, nb->norm_key, len);
+	if (cmp == 0 && !(na->norm_key_exact && nb->norm_key_exact &&
+			  na->norm_key_len == nb->norm_key_len)) {
+		cmp = tuple_compare(na->tuple, HINT_NONE, nb->tuple,
+				    HINT_NONE, merger->key_def);
+	}
 	return merger->reverse ? cmp >= 0 : cmp < 0;
 }
 
 /**
- * Initialize a new merger heap node.
+ * Build the loser tree: fill in the losers of the subtree rooted
+ * at @node and return its winner. Leaves of the implicit binary
+ * tree are numbered tree_size .. 2 * tree_size - 1.
+ */
+static uint32_t
+merger_tree_build(struct merger *merger, uint32_t node)
+{
+	if (node >= merger->tree_size)
+		return node - merger->tree_size;
+	uint32_t left = merger_tree_build(merger, 2 * node);
+	uint32_t right = merger_tree_build(merger, 2 * node + 1);
+	if (merger_node_less(merger, left, right)) {
+		merger->tree[node] = right;
+		return left;
+	}
+	merger->tree[node] = left;
+	return right;
+}
+
+/**
+ * Replay the matches on the path from @leaf to the root after
+ * the leaf has changed, updating the overall winner.
+ */
+static void
+merger_tree_replay(struct merger *merger, uint32_t leaf)
+{
+	uint32_t winner = leaf;
+	for (uint32_t node = (merger->tree_size + leaf) / 2; node >= 1;
+	     node /= 2) {
+		if (merger_node_less(merger, merger->tree[node], winner))
+			SWAP(merger->tree[node], winner);
+	}
+	merger->winner = winner;
+}
+
+/**
+ * Initialize a new merger node.
  */
 static void
-merger_heap_node_create(struct merger_heap_node *node,
-			struct merge_source *source)
+merger_node_create(struct merger_node *node, struct merge_source *source)
 {
 	node->source = source;
 	merge_source_ref(node->source);
 	node->tuple = NULL;
-	heap_node_create(&node->in_merger);
+	node->norm_key_len = 0;
+	node->norm_key_exact = false;
 }
 
 /**
- * Free a merger heap node.
+ * Free a merger node.
  */
 static void
-merger_heap_node_delete(struct merger_heap_node *node)
+merger_node_delete(struct merger_node *node)
 {
 	merge_source_unref(node->source);
 	if (node->tuple != NULL)
@@ -157,35 +368,18 @@ merger_heap_node_delete(struct merger_heap_node *node)
 }
 
 /**
- * The helper to add a new heap node to a merger heap.
+ * Fetch a next tuple into a leaf and re-normalize its key.
  *
  * Return -1 at an error and set a diag.
- *
- * Otherwise store a next tuple in node->tuple, add the node to
- * merger->heap and return 0.
  */
 static int
-merger_add_heap_node(struct merger *merger, struct merger_heap_node *node)
+merger_node_fetch(struct merger *merger, struct merger_node *node)
 {
-	struct tuple *tuple = NULL;
-
-	/* Acquire a next tuple. */
-	struct merge_source *source = node->source;
-	if (merge_source_next(source, merger->format, &tuple) != 0)
-		return -1;
-
-	/* Don't add an empty source to a heap. */
-	if (tuple == NULL)
-		return 0;
-
-	node->tuple = tuple;
-
-	/* Add a node to a heap. */
-	if (merger_heap_insert(&merger->heap, node) != 0) {
-		diag_set(OutOfMemory, 0, "malloc", "merger->heap");
+	if (merge_source_next(node->source, merger->format,
+			      &node->tuple) != 0)
 		return -1;
-	}
-
+	if (node->tuple != NULL)
+		merger_node_encode_key(merger, node);
 	return 0;
 }
 
@@ -210,20 +404,33 @@ static int
 merger_set_sources(struct merger *merger, struct merge_source **sources,
 		   uint32_t source_count)
 {
-	const size_t nodes_size = sizeof(struct merger_heap_node) *
-		source_count;
-	struct merger_heap_node *nodes = malloc(nodes_size);
+	const size_t nodes_size = sizeof(struct merger_node) * source_count;
+	struct merger_node *nodes = malloc(nodes_size);
 	if (nodes == NULL) {
 		diag_set(OutOfMemory, nodes_size, "malloc",
-			 "merger heap nodes");
+			 "merger nodes");
+		return -1;
+	}
+
+	uint32_t tree_size = 1;
+	while (tree_size < source_count)
+		tree_size *= 2;
+	uint32_t *tree = malloc(sizeof(*tree) * tree_size);
+	if (tree == NULL) {
+		diag_set(OutOfMemory, sizeof(*tree) * tree_size, "malloc",
+			 "merger tree");
+		free(nodes);
 		return -1;
 	}
 
 	for (uint32_t i = 0; i < source_count; ++i)
-		merger_heap_node_create(&nodes[i], sources[i]);
+		merger_node_create(&nodes[i], sources[i]);
 
 	merger->node_count = source_count;
 	merger->nodes = nodes;
+	merger->tree = tree;
+	merger->tree_size = tree_size;
+	merger->winner = UINT32_MAX;
 	return 0;
 }
 
@@ -266,15 +473,18 @@ merger_new(struct key_def *key_def, struct merge_source **sources,
 	merger->started = false;
 	merger->key_def = key_def;
 	merger->format = format;
-	merger_heap_create(&merger->heap);
+	merger->tree = NULL;
+	merger->tree_size = 0;
+	merger->winner = UINT32_MAX;
 	merger->node_count = 0;
 	merger->nodes = NULL;
+	merger->norm_keys_disabled = key_def->is_multikey ||
+				     key_def->for_func_index;
 	merger->reverse = reverse;
 
 	if (merger_set_sources(merger, sources, source_count) != 0) {
 		key_def_delete(merger->key_def);
 		tuple_format_unref(merger->format);
-		merger_heap_destroy(&merger->heap);
 		free(merger);
 		return NULL;
 	}
@@ -291,13 +501,14 @@ merger_delete(struct merge_source *base)
 
 	key_def_delete(merger->key_def);
 	tuple_format_unref(merger->format);
-	merger_heap_destroy(&merger->heap);
 
 	for (uint32_t i = 0; i < merger->node_count; ++i)
-		merger_heap_node_delete(&merger->nodes[i]);
+		merger_node_delete(&merger->nodes[i]);
 
 	if (merger->nodes != NULL)
 		free(merger->nodes);
+	if (merger->tree != NULL)
+		free(merger->tree);
 
 	free(merger);
 }
@@ -309,26 +520,28 @@ merger_next(struct merge_source *base, struct tuple_format *format,
 	struct merger *merger = container_of(base, struct merger, base);
 
 	/*
-	 * Fetch a first tuple for each source and add all heap
-	 * nodes to a merger heap.
+	 * Fetch a first tuple for each source and build the
+	 * loser tree.
 	 */
 	if (!merger->started) {
 		for (uint32_t i = 0; i < merger->node_count; ++i) {
-			struct merger_heap_node *node = &merger->nodes[i];
-			if (merger_add_heap_node(merger, node) != 0)
+			struct merger_node *node = &merger->nodes[i];
+			if (merger_node_fetch(merger, node) != 0)
 				return -1;
 		}
+		merger->winner = merger_tree_build(merger, 1);
 		merger->started = true;
 	}
 
 	/* Get a next tuple. */
-	struct merger_heap_node *node = merger_heap_top(&merger->heap);
-	if (node == NULL) {
+	uint32_t winner = merger->winner;
+	if (winner >= merger->node_count ||
+	    merger->nodes[winner].tuple == NULL) {
 		*out = NULL;
 		return 0;
 	}
+	struct merger_node *node = &merger->nodes[winner];
 	struct tuple *tuple = node->tuple;
-	assert(tuple != NULL);
 
 	/* Validate the tuple. */
 	if (format != NULL && tuple_validate(format, tuple) != 0)
@@ -339,15 +552,11 @@ merger_next(struct merge_source *base, struct tuple_format *format,
 	 * *out as refcounted tuple, so we don't unreference it
 	 * here.
 	 */
-	struct merge_source *source = node->source;
-	if (merge_source_next(source, merger->format, &node->tuple) != 0)
+	if (merger_node_fetch(merger, node) != 0)
 		return -1;
 
-	/* Update a heap. */
-	if (node->tuple == NULL)
-		merger_heap_delete(&merger->heap, node);
-	else
-		merger_heap_update(&merger->heap, node);
+	/* Replay the path from the changed leaf to the root. */
+	merger_tree_replay(merger, winner);
 
 	*out = tuple;
 	return 0;
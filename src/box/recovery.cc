@@ -291,6 +291,22 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 	}
 }
 
+/**
+ * Total bytes of WAL data replayed by this instance and the wall
+ * time spent on it. Used to estimate the local recovery speed,
+ * see recovery_throughput().
+ */
+static double recovery_total_bytes = 0;
+static double recovery_total_time = 0;
+
+double
+recovery_throughput(void)
+{
+	if (recovery_total_time <= 0)
+		return 0;
+	return recovery_total_bytes / recovery_total_time;
+}
+
 /**
  * Find out if there are new .xlog files since the current
  * LSN, and read them all up.
@@ -348,7 +364,22 @@ recover_remaining_wals(struct recovery *r, struct xstream *stream,
 		say_info("recover from `%s'", r->cursor.name);
 
 recover_current_wal:
-		recover_xlog(r, stream, stop_vclock);
+		{
+			double start = ev_monotonic_now(loop());
+			off_t pos = xlog_cursor_pos(&r->cursor);
+			recover_xlog(r, stream, stop_vclock);
+			off_t bytes = xlog_cursor_pos(&r->cursor) - pos;
+			/*
+			 * In hot standby mode this function polls
+			 * the directory, so empty passes must not
+			 * dilute the throughput estimate.
+			 */
+			if (bytes > 0) {
+				recovery_total_bytes += bytes;
+				recovery_total_time +=
+					ev_monotonic_now(loop()) - start;
+			}
+		}
 	}
 
 	if (xlog_cursor_is_eof(&r->cursor))
@@ -88,6 +88,15 @@ recovery_stop_local(struct recovery *r);
 void
 recovery_finalize(struct recovery *r);
 
+/**
+ * Average speed at which this instance has been replaying WAL
+ * files, in bytes per second, or 0 if nothing has been replayed
+ * yet. Used to convert a recovery time target to a WAL size
+ * threshold, see box.cfg.checkpoint_recovery_target.
+ */
+double
+recovery_throughput(void);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
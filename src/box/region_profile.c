@@ -0,0 +1,126 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "region_profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fiber.h"
+#include "rmean.h"
+
+static const char *region_profile_stat_strings[REGION_PROFILE_STAT_MAX] = {
+	"ALLOC",
+	"FALLBACK",
+};
+
+/** All created profiles, to be shown by box.stat.region(). */
+static RLIST_HEAD(region_profiles);
+
+void
+region_profile_create(struct region_profile *profile, const char *name,
+		      int percentile, size_t reserve_max)
+{
+	if (profile->name != NULL)
+		return; /* already created */
+	memset(profile, 0, sizeof(*profile));
+	profile->name = name;
+	profile->percentile = percentile;
+	profile->reserve_max = reserve_max;
+	/*
+	 * Best effort: without the rmean the profile still sizes
+	 * the retention target, only the rates are not shown.
+	 */
+	profile->rmean = rmean_new(region_profile_stat_strings,
+				   REGION_PROFILE_STAT_MAX);
+	rlist_add_tail_entry(&region_profiles, profile, in_profiles);
+}
+
+static int
+region_profile_footprint_cmp(const void *a, const void *b)
+{
+	size_t lhs = *(const size_t *)a;
+	size_t rhs = *(const size_t *)b;
+	return lhs < rhs ? -1 : lhs > rhs;
+}
+
+void
+region_profile_account(struct region_profile *profile, size_t footprint)
+{
+	if (profile->rmean != NULL) {
+		rmean_collect(profile->rmean, REGION_PROFILE_ALLOC, 1);
+		if (footprint > profile->reserve)
+			rmean_collect(profile->rmean,
+				      REGION_PROFILE_FALLBACK, 1);
+	}
+	if (footprint > profile->max_footprint)
+		profile->max_footprint = footprint;
+	profile->window[profile->pos++] = footprint;
+	if (profile->pos < REGION_PROFILE_WINDOW)
+		return;
+	profile->pos = 0;
+	size_t sorted[REGION_PROFILE_WINDOW];
+	memcpy(sorted, profile->window, sizeof(sorted));
+	qsort(sorted, REGION_PROFILE_WINDOW, sizeof(*sorted),
+	      region_profile_footprint_cmp);
+	size_t target = sorted[REGION_PROFILE_WINDOW *
+			       profile->percentile / 100];
+	if (target > profile->reserve_max)
+		target = profile->reserve_max;
+	profile->reserve = target;
+}
+
+void
+region_profile_fiber_gc(void)
+{
+	struct region_profile *profile = fiber()->gc_profile;
+	if (profile == NULL) {
+		fiber_gc();
+		return;
+	}
+	size_t footprint = region_used(&fiber()->gc);
+	region_profile_account(profile, footprint);
+	if (footprint <= profile->reserve)
+		region_reset(&fiber()->gc);
+	else
+		region_free(&fiber()->gc);
+}
+
+int
+region_profile_foreach(region_profile_cb cb, void *ctx)
+{
+	struct region_profile *profile;
+	rlist_foreach_entry(profile, &region_profiles, in_profiles) {
+		int rc = cb(profile, ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef TARANTOOL_BOX_REGION_PROFILE_H_INCLUDED
+#define TARANTOOL_BOX_REGION_PROFILE_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "small/rlist.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct rmean;
+
+/**
+ * Region retention profile.
+ *
+ * Several subsystems allocate short-lived memory on a region -
+ * the fiber gc region for iproto requests and applier rows, the
+ * txn region for transactions - and reset it after every cycle.
+ * How much of the allocated slabs to retain for the next cycle
+ * used to be a single global constant, so a workload mixing tiny
+ * and huge cycles thrashed between freeing everything and
+ * pulling slabs from the slab cache again.
+ *
+ * A profile sizes the retention target per consumer: it keeps a
+ * ring of recent cycle footprints and retargets the retained
+ * size to a configured percentile of them, bounded by a
+ * configured cap. It also keeps rmean counters of cycles and of
+ * fallbacks - cycles whose footprint exceeded the retained size
+ * and had to go to the slab cache (or further to malloc) for
+ * more slabs. The counters are shown by box.stat.region().
+ */
+
+enum {
+	/** Number of recent footprints the target is sized by. */
+	REGION_PROFILE_WINDOW = 64,
+};
+
+/** Rolling counters of a profile, box.stat.region() rows. */
+enum region_profile_stat {
+	REGION_PROFILE_ALLOC = 0,
+	REGION_PROFILE_FALLBACK = 1,
+	REGION_PROFILE_STAT_MAX = 2,
+};
+
+struct region_profile {
+	/** Link in the global list of profiles. */
+	struct rlist in_profiles;
+	/** Name shown in box.stat.region(), NULL until created. */
+	const char *name;
+	/** The target covers this percentile of recent cycles. */
+	int percentile;
+	/** Hard cap on the retention target, in bytes. */
+	size_t reserve_max;
+	/** Ring of recent cycle footprints. */
+	size_t window[REGION_PROFILE_WINDOW];
+	/** Next write position in the ring. */
+	int pos;
+	/** Current retention target, in bytes. */
+	size_t reserve;
+	/** High-water mark of a single cycle footprint. */
+	size_t max_footprint;
+	/** ALLOC/FALLBACK rates, see region_profile_stat. */
+	struct rmean *rmean;
+};
+
+/**
+ * Initialize a profile. May be called repeatedly: subsystems
+ * without a single init point call it from their entry path.
+ * Must be called from the cord that accounts into the profile.
+ */
+void
+region_profile_create(struct region_profile *profile, const char *name,
+		      int percentile, size_t reserve_max);
+
+/**
+ * Account a finished cycle of @a footprint bytes and retarget
+ * the retained size once enough new samples are collected.
+ */
+void
+region_profile_account(struct region_profile *profile, size_t footprint);
+
+/**
+ * Collect the fiber gc region like fiber_gc() does, but size
+ * the retained part by the profile attached to the fiber, see
+ * fiber::gc_profile. Falls back to fiber_gc() if there is none.
+ */
+void
+region_profile_fiber_gc(void);
+
+typedef int (*region_profile_cb)(struct region_profile *profile, void *ctx);
+
+/** Iterate over all created profiles, for box.stat.region(). */
+int
+region_profile_foreach(region_profile_cb cb, void *ctx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_REGION_PROFILE_H_INCLUDED */
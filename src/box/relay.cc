@@ -30,6 +30,10 @@
  */
 #include "relay.h"
 
+#include <zstd.h>
+
+#include <small/ibuf.h>
+
 #include "trivia/config.h"
 #include "tt_static.h"
 #include "scoped_guard.h"
@@ -47,12 +51,22 @@
 #include "recovery.h"
 #include "replication.h"
 #include "trigger.h"
+#include "txn_limbo.h"
 #include "vclock.h"
 #include "version.h"
+#include "msgpuck/msgpuck.h"
 #include "xrow.h"
 #include "xrow_io.h"
 #include "xstream.h"
 #include "wal.h"
+#include "wal_mem.h"
+
+enum {
+	/** Compression level of a negotiated subscribe stream. */
+	RELAY_ZSTD_LEVEL = 3,
+	/** Granularity of compressed output buffer growth. */
+	RELAY_ZSTD_BUF_SIZE = 16384,
+};
 
 /**
  * Cbus message to send status updates from relay to tx thread.
@@ -101,6 +115,8 @@ struct relay {
 	struct replica *replica;
 	/** WAL event watcher. */
 	struct wal_watcher wal_watcher;
+	/** Batch of rows fetched from the in-memory WAL buffer. */
+	struct wal_mem_batch mem_batch;
 	/** Relay reader cond. */
 	struct fiber_cond reader_cond;
 	/** Relay diagnostics. */
@@ -122,6 +138,35 @@ struct relay {
 	 */
 	struct vclock local_vclock_at_subscribe;
 
+	/**
+	 * Whether the replica negotiated a zstd-compressed
+	 * stream in the subscribe handshake.
+	 */
+	bool compress;
+	/**
+	 * zstd compression stream for the subscribe channel,
+	 * NULL when compression was not negotiated. Owned by
+	 * the relay cord.
+	 */
+	ZSTD_CStream *zstream;
+	/** Buffer of pending compressed output bytes. */
+	struct ibuf zbuf;
+	/** Raw payload bytes fed into the compressor. */
+	uint64_t zbytes_raw;
+	/** Compressed bytes written to the socket. */
+	uint64_t zbytes_out;
+	/**
+	 * Byte rate cap for initial join streaming, 0 means
+	 * unlimited. A join reads the whole dataset through a
+	 * read view, and without pacing it competes with the
+	 * regular workload for disk and network bandwidth.
+	 */
+	double join_rate_limit;
+	/** Bytes streamed since the join started. */
+	double join_bytes;
+	/** When the join streaming started. */
+	double join_start_time;
+
 	/** Relay endpoint */
 	struct cbus_endpoint endpoint;
 	/** A pipe from 'relay' thread to 'tx' */
@@ -293,12 +338,16 @@ relay_set_cord_name(int fd)
 }
 
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   double rate_limit)
 {
 	struct relay *relay = relay_new(NULL);
 	if (relay == NULL)
 		diag_raise();
 
+	relay->join_rate_limit = rate_limit * 1024 * 1024;
+	relay->join_bytes = 0;
+	relay->join_start_time = ev_monotonic_now(loop());
 	relay_start(relay, fd, sync, relay_send_initial_join_row);
 	auto relay_guard = make_scoped_guard([=] {
 		relay_stop(relay);
@@ -363,6 +412,11 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 
 	relay->r = recovery_new(cfg_gets("wal_dir"), false,
 			       start_vclock);
+	/*
+	 * Joining replicas read the same xlog range, share the
+	 * decoded transactions between the relays.
+	 */
+	relay->r->wal_dir.tx_cache = true;
 	vclock_copy(&relay->stop_vclock, stop_vclock);
 
 	int rc = cord_costart(&relay->cord, "final_join",
@@ -399,6 +453,17 @@ tx_status_update(struct cmsg *msg)
 {
 	struct relay_status_msg *status = (struct relay_status_msg *)msg;
 	vclock_copy(&status->relay->tx.vclock, &status->vclock);
+	/*
+	 * A batched replica acknowledgement: everything of this
+	 * instance up to the reported LSN is applied on the
+	 * replica, so one status message may confirm many queued
+	 * synchronous transactions at once.
+	 */
+	struct replica *replica = status->relay->replica;
+	if (replica != NULL) {
+		txn_limbo_ack(replica->id,
+			      vclock_get(&status->vclock, instance_id));
+	}
 	static const struct cmsg_hop route[] = {
 		{relay_status_update, NULL}
 	};
@@ -464,7 +529,16 @@ relay_schedule_pending_gc(struct relay *relay, const struct vclock *vclock)
 		 * the greater signatures is due to changes pulled
 		 * from other members of the cluster.
 		 */
-		if (vclock_compare(&curr->vclock, vclock) > 0)
+		/*
+		 * The signature is the memoized sum of all vclock
+		 * components. When the WAL vclock sum exceeds the
+		 * acknowledged sum, the WAL can't be less than or
+		 * equal to the acked vclock, so the full comparison
+		 * could only answer "greater" or "incomparable" -
+		 * both break, no need to run it.
+		 */
+		if (vclock_sum(&curr->vclock) > vclock_sum(vclock) ||
+		    vclock_compare(&curr->vclock, vclock) > 0)
 			break;
 		stailq_shift(&relay->pending_gc);
 		free(gc_msg);
@@ -482,6 +556,39 @@ relay_set_error(struct relay *relay, struct error *e)
 		diag_set_error(&relay->diag, e);
 }
 
+/**
+ * Feed the replica from the in-memory WAL buffer.
+ *
+ * @retval  0 The relay position was served from memory, possibly
+ *            with no new rows to send.
+ * @retval -1 The buffer does not retain the rows the replica
+ *            needs, read the xlog files instead.
+ */
+static int
+relay_recover_from_mem(struct relay *relay)
+{
+	struct recovery *r = relay->r;
+	do {
+		/*
+		 * Fetch with a copy of the vclock: if a send
+		 * fails mid-batch, the recovery position must
+		 * reflect the sent rows only, so that the disk
+		 * fallback does not lose the rest.
+		 */
+		struct vclock vclock;
+		vclock_copy(&vclock, &r->vclock);
+		if (wal_mem_fetch(&vclock, &relay->mem_batch) != 0)
+			return -1;
+		for (uint32_t i = 0; i < relay->mem_batch.row_count; i++) {
+			struct xrow_header *row = &relay->mem_batch.rows[i];
+			vclock_follow_xrow(&r->vclock, row);
+			if (xstream_write(&relay->stream, row) != 0)
+				diag_raise();
+		}
+	} while (relay->mem_batch.row_count > 0);
+	return 0;
+}
+
 static void
 relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 {
@@ -499,6 +606,19 @@ relay_process_wal_event(struct wal_watcher *watcher, unsigned events)
 		return;
 	}
 	try {
+		/*
+		 * In the steady state the rows are served from the
+		 * in-memory WAL buffer without touching the xlog
+		 * files. On rotation fall through to the files so
+		 * that the cursor catches up and closes the old
+		 * logs - that is what drives the gc consumer
+		 * forward. The rows sent from memory have already
+		 * advanced the recovery vclock, so the rescan
+		 * skips them.
+		 */
+		if ((events & WAL_EVENT_ROTATE) == 0 &&
+		    relay_recover_from_mem(relay) == 0)
+			return;
 		recover_remaining_wals(relay->r, &relay->stream, NULL,
 				       (events & WAL_EVENT_ROTATE) != 0);
 	} catch (Exception *e) {
@@ -569,6 +689,20 @@ relay_subscribe_f(va_list ap)
 	coio_enable();
 	relay_set_cord_name(relay->io.fd);
 
+	if (relay->compress) {
+		relay->zstream = ZSTD_createCStream();
+		if (relay->zstream == NULL)
+			tnt_raise(OutOfMemory, sizeof(ZSTD_CStream),
+				  "ZSTD_createCStream", "zstream");
+		ZSTD_initCStream(relay->zstream, RELAY_ZSTD_LEVEL);
+		ibuf_create(&relay->zbuf, &cord()->slabc,
+			    RELAY_ZSTD_BUF_SIZE);
+		relay->zbytes_raw = 0;
+		relay->zbytes_out = 0;
+	}
+
+	wal_mem_batch_create(&relay->mem_batch);
+
 	/* Create cpipe to tx for propagating vclock. */
 	cbus_endpoint_create(&relay->endpoint, tt_sprintf("relay_%p", relay),
 			     fiber_schedule_cb, fiber());
@@ -676,6 +810,20 @@ relay_subscribe_f(va_list ap)
 		    NULL, NULL, cbus_process);
 	cbus_endpoint_destroy(&relay->endpoint, cbus_process);
 
+	wal_mem_batch_destroy(&relay->mem_batch);
+
+	if (relay->zstream != NULL) {
+		say_info("compressed relay stream: %llu raw, %llu sent "
+			 "(%.2fx ratio)",
+			 (unsigned long long) relay->zbytes_raw,
+			 (unsigned long long) relay->zbytes_out,
+			 relay->zbytes_out > 0 ?
+			 (double) relay->zbytes_raw / relay->zbytes_out : 0.);
+		ZSTD_freeCStream(relay->zstream);
+		relay->zstream = NULL;
+		ibuf_destroy(&relay->zbuf);
+	}
+
 	relay_exit(relay);
 	return -1;
 }
@@ -684,7 +832,7 @@ relay_subscribe_f(va_list ap)
 void
 relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		struct vclock *replica_clock, uint32_t replica_version_id,
-		uint32_t replica_id_filter)
+		uint32_t replica_id_filter, bool compress)
 {
 	assert(replica->anon || replica->id != REPLICA_ID_NIL);
 	struct relay *relay = replica->relay;
@@ -710,10 +858,18 @@ relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 	vclock_copy(&relay->local_vclock_at_subscribe, &replicaset.vclock);
 	relay->r = recovery_new(cfg_gets("wal_dir"), false,
 			        replica_clock);
+	/*
+	 * Several relays often stream the same xlog tail, e.g.
+	 * when all replicas resubscribe after a master restart.
+	 * Share the decoded transactions between them instead of
+	 * re-reading the files once per replica.
+	 */
+	relay->r->wal_dir.tx_cache = true;
 	vclock_copy(&relay->tx.vclock, replica_clock);
 	relay->version_id = replica_version_id;
 
 	relay->id_filter = replica_id_filter;
+	relay->compress = compress;
 
 	int rc = cord_costart(&relay->cord, "subscribe",
 			      relay_subscribe_f, relay);
@@ -723,6 +879,68 @@ relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		diag_raise();
 }
 
+/** Feed a chunk of raw output to the compression stream. */
+static void
+relay_zstream_feed(struct relay *relay, const void *data, size_t size)
+{
+	ZSTD_inBuffer in = { data, size, 0 };
+	while (in.pos < in.size) {
+		if (ibuf_reserve(&relay->zbuf, RELAY_ZSTD_BUF_SIZE) == NULL)
+			tnt_raise(OutOfMemory, RELAY_ZSTD_BUF_SIZE,
+				  "ibuf", "compressed output");
+		ZSTD_outBuffer out = { relay->zbuf.wpos,
+				       ibuf_unused(&relay->zbuf), 0 };
+		size_t rc = ZSTD_compressStream(relay->zstream, &out, &in);
+		relay->zbuf.wpos += out.pos;
+		if (ZSTD_isError(rc))
+			tnt_raise(ClientError, ER_SYSTEM,
+				  ZSTD_getErrorName(rc));
+	}
+	relay->zbytes_raw += size;
+}
+
+/**
+ * Compressing flavour of coio_write_xrow(): the encoded row is
+ * fed into the subscribe channel zstd stream and the stream is
+ * flushed so the replica never waits for bytes stuck inside the
+ * compressor. Flushing per row costs some ratio, but the
+ * compression window is retained across rows, which is where
+ * most of the win on msgpack-heavy rows comes from.
+ */
+static void
+relay_write_compressed(struct relay *relay, const struct xrow_header *row)
+{
+	assert(mp_sizeof_uint(UINT32_MAX) == 5);
+	char buf[5 + XROW_HEADER_LEN_MAX];
+	size_t hdr_len = xrow_header_encode_buf(row, row->sync, buf + 5);
+	size_t len = hdr_len;
+	for (int i = 0; i < row->bodycnt; i++)
+		len += row->body[i].iov_len;
+	buf[0] = 0xce; /* MP_UINT32 */
+	*(uint32_t *) (buf + 1) = mp_bswap_u32(len);
+	relay_zstream_feed(relay, buf, 5 + hdr_len);
+	for (int i = 0; i < row->bodycnt; i++)
+		relay_zstream_feed(relay, row->body[i].iov_base,
+				   row->body[i].iov_len);
+	size_t rc;
+	do {
+		if (ibuf_reserve(&relay->zbuf, RELAY_ZSTD_BUF_SIZE) == NULL)
+			tnt_raise(OutOfMemory, RELAY_ZSTD_BUF_SIZE,
+				  "ibuf", "compressed output");
+		ZSTD_outBuffer out = { relay->zbuf.wpos,
+				       ibuf_unused(&relay->zbuf), 0 };
+		rc = ZSTD_flushStream(relay->zstream, &out);
+		relay->zbuf.wpos += out.pos;
+		if (ZSTD_isError(rc))
+			tnt_raise(ClientError, ER_SYSTEM,
+				  ZSTD_getErrorName(rc));
+	} while (rc != 0);
+	size_t zlen = ibuf_used(&relay->zbuf);
+	coio_write(&relay->io, relay->zbuf.rpos, zlen);
+	relay->zbytes_out += zlen;
+	ibuf_reset(&relay->zbuf);
+}
+
 static void
 relay_send(struct relay *relay, struct xrow_header *packet)
 {
@@ -730,7 +948,10 @@ relay_send(struct relay *relay, struct xrow_header *packet)
 
 	packet->sync = relay->sync;
 	relay->last_row_time = ev_monotonic_now(loop());
-	coio_write_xrow(&relay->io, packet);
+	if (relay->zstream != NULL)
+		relay_write_compressed(relay, packet);
+	else
+		coio_write_xrow(&relay->io, packet);
 	fiber_gc();
 
 	struct errinj *inj = errinj(ERRINJ_RELAY_TIMEOUT, ERRINJ_DOUBLE);
@@ -746,8 +967,21 @@ relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 	 * Ignore replica local requests as we don't need to promote
 	 * vclock while sending a snapshot.
 	 */
-	if (row->group_id != GROUP_LOCAL)
-		relay_send(relay, row);
+	if (row->group_id == GROUP_LOCAL)
+		return;
+	relay_send(relay, row);
+	if (relay->join_rate_limit <= 0)
+		return;
+	/*
+	 * Pace the stream to the configured byte rate: sleep off
+	 * the lead over the time the bytes sent so far should
+	 * have taken.
+	 */
+	relay->join_bytes += xrow_approx_len(row);
+	double elapsed = ev_monotonic_now(loop()) - relay->join_start_time;
+	double expected = relay->join_bytes / relay->join_rate_limit;
+	if (expected > elapsed)
+		fiber_sleep(expected - elapsed);
 }
 
 /** Send a single row to the client. */
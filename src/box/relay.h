@@ -103,9 +103,12 @@ relay_last_row_time(const struct relay *relay);
  * @param fd        client connection
  * @param sync      sync from incoming JOIN request
  * @param vclock[out] vclock of the read view sent to the replica
+ * @param rate_limit cap on the streaming byte rate in MB/s,
+ *                   0 means unlimited
  */
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock);
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   double rate_limit);
 
 /**
  * Send final JOIN rows to the replica.
@@ -120,11 +123,13 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 /**
  * Subscribe a replica to updates.
  *
+ * @param compress Send the stream through a zstd compression
+ *        context, as negotiated in the subscribe handshake.
  * @return none.
  */
 void
 relay_subscribe(struct replica *replica, int fd, uint64_t sync,
 		struct vclock *replica_vclock, uint32_t replica_version_id,
-		uint32_t replica_id_filter);
+		uint32_t replica_id_filter, bool compress);
 
 #endif /* TARANTOOL_REPLICATION_RELAY_H_INCLUDED */
@@ -54,6 +54,9 @@ double replication_sync_lag = 10.0; /* seconds */
 double replication_sync_timeout = 300.0; /* seconds */
 bool replication_skip_conflict = false;
 bool replication_anon = false;
+bool replication_compression = false;
+int replication_synchro_quorum = 1;
+double replication_synchro_timeout = 5.0; /* seconds */
 
 struct replicaset replicaset;
 
@@ -88,6 +91,7 @@ replication_init(void)
 	replica_hash_new(&replicaset.hash);
 	rlist_create(&replicaset.anon);
 	vclock_create(&replicaset.vclock);
+	fiber_cond_create(&replicaset.vclock_cond);
 	fiber_cond_create(&replicaset.applier.cond);
 	replicaset.replica_by_id = (struct replica **)calloc(VCLOCK_MAX, sizeof(struct replica *));
 	latch_create(&replicaset.applier.order_latch);
@@ -112,6 +116,7 @@ replication_free(void)
 		relay_cancel(replica->relay);
 
 	diag_destroy(&replicaset.applier.diag);
+	fiber_cond_destroy(&replicaset.vclock_cond);
 	free(replicaset.replica_by_id);
 }
 
@@ -891,6 +896,22 @@ replicaset_check_quorum(void)
 		box_set_orphan(false);
 }
 
+int
+replicaset_wait_vclock(const struct vclock *vclock, double timeout)
+{
+	double deadline = ev_monotonic_now(loop()) + timeout;
+	/*
+	 * Both 1 and VCLOCK_ORDER_UNDEFINED mean the target has a
+	 * component this instance has not reached yet.
+	 */
+	while (vclock_compare(vclock, &replicaset.vclock) > 0) {
+		if (fiber_cond_wait_deadline(&replicaset.vclock_cond,
+					     deadline) != 0)
+			return -1;
+	}
+	return 0;
+}
+
 void
 replica_on_relay_stop(struct replica *replica)
 {
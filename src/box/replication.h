@@ -143,6 +143,27 @@ extern bool replication_skip_conflict;
  */
 extern bool replication_anon;
 
+/**
+ * Whether this replica asks masters for a zstd-compressed
+ * replication stream. The actual compression is negotiated in
+ * the SUBSCRIBE handshake, so an old master simply ignores the
+ * request and sends raw rows.
+ */
+extern bool replication_compression;
+
+/**
+ * Number of instances, this one included, which must have
+ * written a synchronous transaction before it is reported as
+ * committed to the client. 1 means no synchronous waiting.
+ */
+extern int replication_synchro_quorum;
+
+/**
+ * How long a synchronous transaction may wait for the quorum
+ * before degrading to an asynchronous commit.
+ */
+extern double replication_synchro_timeout;
+
 /**
  * Wait for the given period of time before trying to reconnect
  * to a master.
@@ -198,6 +219,13 @@ struct replicaset {
 	 * of the cluster as maintained by appliers.
 	 */
 	struct vclock vclock;
+	/**
+	 * Signaled each time @a vclock advances. Requests
+	 * carrying a causal read token park on this condition
+	 * until the instance catches up with the token, see
+	 * replicaset_wait_vclock().
+	 */
+	struct fiber_cond vclock_cond;
 	/**
 	 * This flag is set while the instance is bootstrapping
 	 * from a remote master.
@@ -433,6 +461,22 @@ replicaset_sync(void);
 void
 replicaset_check_quorum(void);
 
+/**
+ * Wait until this instance reaches @a vclock, i.e. its own
+ * vclock is greater than or equal to the given one in every
+ * component. Is used for causal reads: a client attaches the
+ * commit vclock it saw to a read request, and a replica parks
+ * the request here until the appliers catch up.
+ *
+ * @param vclock Vclock to reach.
+ * @param timeout Maximum time to wait.
+ *
+ * @retval  0 The vclock is reached.
+ * @retval -1 Timeout or the waiting fiber is cancelled.
+ */
+int
+replicaset_wait_vclock(const struct vclock *vclock, double timeout);
+
 #endif /* defined(__cplusplus) */
 
 #endif
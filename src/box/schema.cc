@@ -38,6 +38,7 @@
 #include "user.h"
 #include "vclock.h"
 #include "fiber.h"
+#include <pmatomic.h>
 
 /**
  * @module Data Dictionary
@@ -77,6 +78,82 @@ struct rlist on_alter_func = RLIST_HEAD_INITIALIZER(on_alter_func);
 
 struct entity_access entity_access;
 
+/**
+ * A read-optimized mirror of the @spaces cache: a flat open
+ * addressed table keyed by space id, rebuilt from scratch on
+ * every DDL change. Requests look their space up here on the hot
+ * path, so the table shares no cache lines with any mutation
+ * state. It is published under an epoch counter: the epoch is
+ * made odd before a new table is swapped in and incremented once
+ * more afterwards, so a reader that loads an even epoch, probes
+ * the table and reads the same epoch back has seen a consistent
+ * snapshot. The tx thread is the only writer; today it is also
+ * the only reader, but the validation protocol is what a future
+ * multi-threaded reader needs (modulo deferred reclamation of
+ * replaced tables, see space_fast_cache_rebuild()).
+ */
+struct space_fast_cache_slot {
+	/** Space id, undefined while @space is NULL. */
+	uint32_t id;
+	/** The space, NULL for a free slot. */
+	struct space *space;
+};
+static struct space_fast_cache_slot *space_fast_cache;
+/** Capacity of @space_fast_cache minus one, for masking. */
+static uint32_t space_fast_cache_mask;
+static uint32_t space_fast_cache_epoch;
+
+/** Scatter clustered space ids over the fast cache. */
+static inline uint32_t
+space_fast_cache_hash(uint32_t id)
+{
+	return id * 2654435761U;
+}
+
+/** Rebuild the fast space cache after a DDL change. */
+static void
+space_fast_cache_rebuild(void)
+{
+	uint32_t count = mh_size(spaces);
+	/* Keep the load factor at 0.5 or better. */
+	uint32_t capacity = 64;
+	while (capacity < count * 2)
+		capacity *= 2;
+	struct space_fast_cache_slot *slots = (struct space_fast_cache_slot *)
+		calloc(capacity, sizeof(*slots));
+	if (slots != NULL) {
+		uint32_t mask = capacity - 1;
+		mh_int_t i;
+		mh_foreach(spaces, i) {
+			struct space *space = (struct space *)
+				mh_i32ptr_node(spaces, i)->val;
+			uint32_t k = space_fast_cache_hash(space_id(space)) &
+				mask;
+			while (slots[k].space != NULL)
+				k = (k + 1) & mask;
+			slots[k].id = space_id(space);
+			slots[k].space = space;
+		}
+	}
+	/*
+	 * On allocation failure publish the NULL table: lookups
+	 * simply fall through to the authoritative hash.
+	 */
+	struct space_fast_cache_slot *old = space_fast_cache;
+	uint32_t epoch = space_fast_cache_epoch;
+	pm_atomic_store_explicit(&space_fast_cache_epoch, epoch + 1,
+				 memory_order_release);
+	space_fast_cache = slots;
+	space_fast_cache_mask = capacity - 1;
+	pm_atomic_store_explicit(&space_fast_cache_epoch, epoch + 2,
+				 memory_order_release);
+	/*
+	 * Once readers live in other threads the old table has to
+	 * go through deferred reclamation instead.
+	 */
+	free(old);
+}
+
 bool
 space_is_system(struct space *space)
 {
@@ -88,10 +165,34 @@ space_is_system(struct space *space)
 struct space *
 space_by_id(uint32_t id)
 {
-	mh_int_t space = mh_i32ptr_find(spaces, id, NULL);
-	if (space == mh_end(spaces))
+	/*
+	 * Hot path: probe the read-optimized flat table. The
+	 * epoch is re-checked after the probe to detect a rebuild
+	 * racing with the lookup, in which case fall through to
+	 * the authoritative hash.
+	 */
+	uint32_t epoch = pm_atomic_load_explicit(&space_fast_cache_epoch,
+						 memory_order_acquire);
+	struct space_fast_cache_slot *slots = space_fast_cache;
+	if (likely(slots != NULL && epoch % 2 == 0)) {
+		uint32_t mask = space_fast_cache_mask;
+		uint32_t k = space_fast_cache_hash(id) & mask;
+		struct space *space = NULL;
+		while (slots[k].space != NULL) {
+			if (slots[k].id == id) {
+				space = slots[k].space;
+				break;
+			}
+			k = (k + 1) & mask;
+		}
+		if (pm_atomic_load_explicit(&space_fast_cache_epoch,
+					    memory_order_acquire) == epoch)
+			return space;
+	}
+	mh_int_t k = mh_i32ptr_find(spaces, id, NULL);
+	if (k == mh_end(spaces))
 		return NULL;
-	return (struct space *) mh_i32ptr_node(spaces, space)->val;
+	return (struct space *) mh_i32ptr_node(spaces, k)->val;
 }
 
 /** Return space by its name */
@@ -248,6 +349,7 @@ space_cache_replace(struct space *old_space, struct space *new_space)
 		mh_strnptr_del(spaces_by_name, k, NULL);
 	}
 	space_cache_version++;
+	space_fast_cache_rebuild();
 
 	if (trigger_run(&on_alter_space, new_space != NULL ?
 					 new_space : old_space) != 0) {
@@ -523,6 +625,8 @@ schema_free(void)
 	}
 	mh_i32ptr_delete(spaces);
 	mh_strnptr_delete(spaces_by_name);
+	free(space_fast_cache);
+	space_fast_cache = NULL;
 	while (mh_size(funcs) > 0) {
 		mh_int_t i = mh_first(funcs);
 
@@ -33,6 +33,7 @@
 
 #include <stdint.h>
 #include <stdio.h> /* snprintf */
+#include <string.h> /* memset */
 #include "error.h"
 #include "space.h"
 
@@ -71,14 +72,25 @@ box_schema_version();
 static inline struct space *
 space_cache_find(uint32_t id)
 {
+	/*
+	 * A small direct-mapped memo in front of the space hash.
+	 * A single remembered space used to be enough, but Lua
+	 * code alternating point lookups between a few spaces
+	 * thrashed it and paid for a hash lookup on every call.
+	 */
+	enum { SPACE_CACHE_MEMO_SIZE = 8 };
 	static uint32_t prev_space_cache_version = 0;
-	static struct space *space = NULL;
-	if (prev_space_cache_version != space_cache_version)
-		space = NULL;
-	if (space && space->def->id == id)
-		return space;
-	if ((space = space_by_id(id))) {
+	static struct space *memo[SPACE_CACHE_MEMO_SIZE];
+	struct space **slot = &memo[id % SPACE_CACHE_MEMO_SIZE];
+	if (prev_space_cache_version != space_cache_version) {
+		memset(memo, 0, sizeof(memo));
 		prev_space_cache_version = space_cache_version;
+	}
+	if (*slot != NULL && (*slot)->def->id == id)
+		return *slot;
+	struct space *space = space_by_id(id);
+	if (space != NULL) {
+		*slot = space;
 		return space;
 	}
 	diag_set(ClientError, ER_NO_SUCH_SPACE, int2str(id));
@@ -148,9 +148,16 @@ sequence_delete(struct sequence *seq)
 	free(seq);
 }
 
+void
+sequence_lease_discard(struct sequence *seq)
+{
+	seq->lease_is_active = false;
+}
+
 void
 sequence_reset(struct sequence *seq)
 {
+	sequence_lease_discard(seq);
 	uint32_t key = seq->def->id;
 	uint32_t hash = sequence_hash(key);
 	uint32_t pos = light_sequence_find_key(&sequence_data_index, hash, key);
@@ -161,6 +168,13 @@ sequence_reset(struct sequence *seq)
 int
 sequence_set(struct sequence *seq, int64_t value)
 {
+	/*
+	 * Persisting a lease echoes back here via the trigger on
+	 * _sequence_data - don't let it discard the fresh lease.
+	 * Any other value makes the leased range stale.
+	 */
+	if (!seq->lease_is_active || value != seq->lease_last)
+		sequence_lease_discard(seq);
 	uint32_t key = seq->def->id;
 	uint32_t hash = sequence_hash(key);
 	struct sequence_data new_data, old_data;
@@ -188,6 +202,8 @@ sequence_update(struct sequence *seq, int64_t value)
 		data = light_sequence_get(&sequence_data_index, pos);
 		if ((seq->def->step > 0 && value > data.value) ||
 		    (seq->def->step < 0 && value < data.value)) {
+			/* The value overtook the leased range. */
+			sequence_lease_discard(seq);
 			if (light_sequence_replace(&sequence_data_index, hash,
 					new_data, &data) == light_sequence_end)
 				unreachable();
@@ -260,6 +276,56 @@ overflow:
 	goto done;
 }
 
+int
+sequence_lease(struct sequence *seq, int64_t count, int64_t *result,
+	       int64_t *last)
+{
+	assert(count > 0);
+	struct sequence_def *def = seq->def;
+	int64_t first;
+	if (sequence_next(seq, &first) != 0)
+		return -1;
+	/*
+	 * Extend the range up to count values, stopping at the
+	 * sequence boundary so that the lease never wraps.
+	 */
+	int64_t value = first;
+	for (int64_t n = 1; n < count; n++) {
+		if (def->step > 0) {
+			if (value >= 0 && def->step > INT64_MAX - value)
+				break;
+			if (value + def->step > def->max)
+				break;
+		} else {
+			assert(def->step < 0);
+			if (value < 0 && def->step < INT64_MIN - value)
+				break;
+			if (value + def->step < def->min)
+				break;
+		}
+		value += def->step;
+	}
+	if (value != first && sequence_set(seq, value) != 0)
+		return -1;
+	/* Activate the cache only after sequence_set(). */
+	seq->lease_value = first;
+	seq->lease_last = value;
+	seq->lease_is_active = true;
+	*result = first;
+	*last = value;
+	return 0;
+}
+
+bool
+sequence_lease_next(struct sequence *seq, int64_t *result)
+{
+	if (!seq->lease_is_active || seq->lease_value == seq->lease_last)
+		return false;
+	seq->lease_value += seq->def->step;
+	*result = seq->lease_value;
+	return true;
+}
+
 int
 access_check_sequence(struct sequence *seq)
 {
@@ -370,6 +436,15 @@ sequence_data_iterator_create(void)
 int
 sequence_get_value(struct sequence *seq, int64_t *result)
 {
+	/*
+	 * While a lease is active the shared state is ahead of
+	 * the last value actually dispensed to a user - report
+	 * the latter.
+	 */
+	if (seq->lease_is_active) {
+		*result = seq->lease_value;
+		return 0;
+	}
 	uint32_t key = seq->def->id;
 	uint32_t hash = sequence_hash(key);
 	uint32_t pos = light_sequence_find_key(&sequence_data_index, hash, key);
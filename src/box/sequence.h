@@ -82,6 +82,19 @@ struct sequence {
 	struct sequence_def *def;
 	/** Set if the sequence is automatically generated. */
 	bool is_generated;
+	/**
+	 * Last value dispensed to a user from the leased value
+	 * range, see sequence_lease(). Only meaningful while
+	 * lease_is_active is set.
+	 */
+	int64_t lease_value;
+	/**
+	 * The last value of the leased range. This is the value
+	 * recorded in _sequence_data while the lease is active.
+	 */
+	int64_t lease_last;
+	/** Set if a leased value range is active. */
+	bool lease_is_active;
 	/** Cached runtime access information. */
 	struct access access[BOX_USER_MAX];
 };
@@ -150,6 +163,43 @@ sequence_update(struct sequence *seq, int64_t value);
 int
 sequence_next(struct sequence *seq, int64_t *result);
 
+/**
+ * Lease a range of up to @count values of a sequence: advance
+ * the sequence by count steps in one go and remember the range
+ * so that subsequent values can be dispensed by
+ * sequence_lease_next() without touching the shared sequence
+ * state. The range is clamped at the sequence boundary - a lease
+ * never wraps, cycling goes through the regular one-at-a-time
+ * path.
+ *
+ * On success, return 0, assign the first value of the range to
+ * @result and the last one to @last. The caller is supposed to
+ * persist @last in _sequence_data: values preceding it are
+ * dispensed from the lease without any footprint on disk, at
+ * the price of a gap in case of restart.
+ *
+ * Fails for the same reasons as sequence_next().
+ */
+int
+sequence_lease(struct sequence *seq, int64_t count, int64_t *result,
+	       int64_t *last);
+
+/**
+ * Dispense the next value from the leased range, if any.
+ *
+ * Return true on success and assign the value to @result,
+ * false if no lease is active or the range is exhausted.
+ */
+bool
+sequence_lease_next(struct sequence *seq, int64_t *result);
+
+/**
+ * Discard the leased value range, if any. Undispensed values of
+ * the range are lost (they become a gap).
+ */
+void
+sequence_lease_discard(struct sequence *seq);
+
 /**
  * Check whether or not the current user can be granted
  * access to the sequence.
@@ -31,6 +31,7 @@
 #include "session.h"
 #include "fiber.h"
 #include "memory.h"
+#include "mempool_registry.h"
 #include "assoc.h"
 #include "trigger.h"
 #include "user.h"
@@ -143,6 +144,7 @@ session_create(enum session_type type)
 	session->sql_flags = default_flags;
 	session->sql_default_engine = SQL_STORAGE_ENGINE_MEMTX;
 	session->sql_stmts = NULL;
+	session->is_low_priority = false;
 
 	/* For on_connect triggers. */
 	credentials_create(&session->credentials, guest_user);
@@ -282,6 +284,7 @@ session_init()
 	if (session_registry == NULL)
 		panic("out of memory");
 	mempool_create(&session_pool, &cord()->slabc, sizeof(struct session));
+	mempool_registry_add(&session_pool, "session");
 	credentials_create(&admin_credentials, admin_user);
 }
 
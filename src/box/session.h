@@ -108,6 +108,12 @@ struct session {
 	struct mh_i32ptr_t *sql_stmts;
 	/** Session user id and global grants */
 	struct credentials credentials;
+	/**
+	 * Set if requests of this session may be deferred when
+	 * the tx thread is congested, see net_defer_latency in
+	 * box.cfg. Configured with box.session.priority().
+	 */
+	bool is_low_priority;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
 	struct trigger fiber_on_stop;
 };
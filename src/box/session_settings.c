@@ -296,7 +296,9 @@ static const struct index_vtab session_settings_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ session_settings_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ generic_index_replace,
 	/* .create_iterator = */ session_settings_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -140,6 +140,7 @@ space_create(struct space *space, struct engine *engine,
 	space->index_id_max = index_id_max;
 	rlist_create(&space->before_replace);
 	rlist_create(&space->on_replace);
+	rlist_create(&space->on_replace_batch);
 	space->run_triggers = true;
 
 	space->format = format;
@@ -170,6 +171,32 @@ space_create(struct space *space, struct engine *engine,
 		struct index *index = space_create_index(space, index_def);
 		if (index == NULL)
 			goto fail_free_indexes;
+		if (index_def->opts.predicate != NULL) {
+			/*
+			 * Compile the partial index predicate with
+			 * the check constraint machinery: the
+			 * program tests an arbitrary tuple against
+			 * the expression, see ck_constraint_test().
+			 */
+			struct ck_constraint_def *pred_def =
+				ck_constraint_def_new(index_def->name,
+					strlen(index_def->name),
+					index_def->opts.predicate,
+					strlen(index_def->opts.predicate),
+					def->id, CK_CONSTRAINT_LANGUAGE_SQL,
+					true);
+			if (pred_def == NULL) {
+				index_unref(index);
+				goto fail_free_indexes;
+			}
+			index->predicate = ck_constraint_new(pred_def,
+							     space->def);
+			if (index->predicate == NULL) {
+				ck_constraint_def_delete(pred_def);
+				index_unref(index);
+				goto fail_free_indexes;
+			}
+		}
 		space->index_map[index_def->iid] = index;
 		if (index_def->opts.is_unique)
 			bit_set(space->check_unique_constraint_map,
@@ -264,6 +291,7 @@ space_delete(struct space *space)
 		tuple_format_unref(space->format);
 	trigger_destroy(&space->before_replace);
 	trigger_destroy(&space->on_replace);
+	trigger_destroy(&space->on_replace_batch);
 	space_def_delete(space->def);
 	/*
 	 * SQL triggers and constraints should be deleted with
@@ -163,6 +163,21 @@ struct space {
 	struct rlist before_replace;
 	/** Triggers fired after space_replace() -- see txn_commit_stmt(). */
 	struct rlist on_replace;
+	/**
+	 * Batched replace triggers. Unlike @a on_replace, fired
+	 * once per committed transaction with the whole
+	 * transaction as the event, no matter how many statements
+	 * changed the space. Cuts trigger dispatch overhead to
+	 * one call per transaction, which matters on replicas
+	 * catching up on replication.
+	 */
+	struct rlist on_replace_batch;
+	/**
+	 * Id of the last transaction which ran the batched
+	 * replace triggers. Is used to fire them only once per
+	 * transaction, however many statements touched the space.
+	 */
+	int64_t on_replace_batch_txn_id;
 	/** SQL Trigger list. */
 	struct sql_trigger *sql_triggers;
 	/**
@@ -265,6 +280,13 @@ space_is_temporary(struct space *space)
 	return space->def->opts.is_temporary;
 }
 
+/** Return true if changes to the space bypass the WAL. */
+static inline bool
+space_is_wal_disabled(struct space *space)
+{
+	return space->def->opts.wal_disabled;
+}
+
 /** Return replication group id of a space. */
 static inline uint32_t
 space_group_id(struct space *space)
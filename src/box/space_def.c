@@ -39,15 +39,26 @@
 const struct space_opts space_opts_default = {
 	/* .group_id = */ 0,
 	/* .is_temporary = */ false,
+	/* .wal_disabled = */ false,
 	/* .is_ephemeral = */ false,
 	/* .view = */ false,
+	/* .is_scan_optimized = */ false,
+	/* .is_compressed = */ false,
+	/* .is_dictionary = */ false,
+	/* .is_sync = */ false,
 	/* .sql        = */ NULL,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("group_id", OPT_UINT32, struct space_opts, group_id),
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, is_temporary),
+	OPT_DEF("wal_disabled", OPT_BOOL, struct space_opts, wal_disabled),
 	OPT_DEF("view", OPT_BOOL, struct space_opts, is_view),
+	OPT_DEF("scan_optimized", OPT_BOOL, struct space_opts,
+		is_scan_optimized),
+	OPT_DEF("compression", OPT_BOOL, struct space_opts, is_compressed),
+	OPT_DEF("dictionary", OPT_BOOL, struct space_opts, is_dictionary),
+	OPT_DEF("is_sync", OPT_BOOL, struct space_opts, is_sync),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
 	OPT_DEF_LEGACY("checks"),
 	OPT_END,
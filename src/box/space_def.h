@@ -56,6 +56,18 @@ struct space_opts {
          *   does not require manual release.
 	 */
 	bool is_temporary;
+	/**
+	 * The space has no durability guarantee:
+	 * - changes are not written to WAL and so are lost on
+	 *   crash; after restart the space holds the content of
+	 *   the last snapshot
+	 * - changes are not replicated, since the relay reads
+	 *   them from WAL
+	 * Unlike a temporary space, the space is a part of a
+	 * snapshot. Intended for caches where losing the data
+	 * between checkpoints is acceptable.
+	 */
+	bool wal_disabled;
 	/**
 	 * This flag is set if space is ephemeral and hence
 	 * its format might be re-used.
@@ -67,6 +79,33 @@ struct space_opts {
 	 * this flag can't be changed after space creation.
 	 */
 	bool is_view;
+	/**
+	 * The space is optimized for full scans of single
+	 * fields: every field defined in the space format gets
+	 * an offset slot in the tuple field map, so reading a
+	 * field does not decode the fields preceding it. Costs
+	 * extra memory per tuple. Only honored by memtx.
+	 */
+	bool is_scan_optimized;
+	/**
+	 * Store tuple bodies compressed and decompress them
+	 * transparently on access, trading CPU for memory.
+	 * Only honored by memtx.
+	 */
+	bool is_compressed;
+	/**
+	 * Keep a per-space dictionary of repeated string values
+	 * and store codes instead of the strings in tuple bodies.
+	 * Only honored by memtx.
+	 */
+	bool is_dictionary;
+	/**
+	 * Transactions changing the space are synchronous: they
+	 * are reported as committed only after a quorum of
+	 * replicas (box.cfg.replication_synchro_quorum) has
+	 * acknowledged them, see txn_limbo.h.
+	 */
+	bool is_sync;
 	/** SQL statement that produced this space. */
 	char *sql;
 };
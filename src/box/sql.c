@@ -321,7 +321,8 @@ tarantoolsqlCount(struct BtCursor *pCur)
 }
 
 struct space *
-sql_ephemeral_space_create(uint32_t field_count, struct sql_key_info *key_info)
+sql_ephemeral_space_create(uint32_t field_count, struct sql_key_info *key_info,
+			   bool is_hash)
 {
 	struct key_def *def = NULL;
 	if (key_info != NULL) {
@@ -358,9 +359,16 @@ sql_ephemeral_space_create(uint32_t field_count, struct sql_key_info *key_info)
 	if (ephemer_key_def == NULL)
 		return NULL;
 
+	/*
+	 * Tables probed for equality only (IN membership) go to a
+	 * hash index: O(1) lookups and no comparator descent on
+	 * insert. Everything that is iterated in key order keeps
+	 * the tree.
+	 */
 	struct index_def *ephemer_index_def =
-		index_def_new(0, 0, "ephemer_idx", strlen("ephemer_idx"), TREE,
-			      &index_opts_default, ephemer_key_def, NULL);
+		index_def_new(0, 0, "ephemer_idx", strlen("ephemer_idx"),
+			      is_hash ? HASH : TREE, &index_opts_default,
+			      ephemer_key_def, NULL);
 	key_def_delete(ephemer_key_def);
 	if (ephemer_index_def == NULL)
 		return NULL;
@@ -737,7 +745,8 @@ tarantoolsqlIdxKeyCompare(struct BtCursor *cursor,
 				uint32_t field_offset =
 					field_map_get_offset(field_map,
 							     field->offset_slot,
-							     MULTIKEY_NONE);
+							     MULTIKEY_NONE,
+							     format->is_compact_field_map);
 				p = base + field_offset;
 			}
 		}
@@ -875,6 +884,8 @@ cursor_seek(BtCursor *pCur, int *pRes)
 	}
 	if (txn != NULL)
 		txn_commit_ro_stmt(txn);
+	/* Forward the planner's scan length hint to the engine. */
+	it->scan_estimate = pCur->scan_estimate;
 	pCur->iter = it;
 	pCur->eState = CURSOR_VALID;
 
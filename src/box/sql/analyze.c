@@ -1597,7 +1597,25 @@ index_field_tuple_est(const struct index_def *idx_def, uint32_t field)
 		if (field == idx_def->key_def->part_count &&
 		    idx_def->opts.is_unique)
 			return 0;
-		return default_tuple_est[field + 1 >= 6 ? 6 : field];
+		/*
+		 * No ANALYZE data. Use the live statistics the
+		 * index maintains itself: the actual tuple count
+		 * and the incremental distinct-prefix estimators,
+		 * see index_distinct_est(). The estimators only
+		 * account insertions, so clamp them by the
+		 * current tuple count.
+		 */
+		ssize_t count = tnt_idx->vtab->size(tnt_idx);
+		if (field == 0)
+			return sqlLogEst(count);
+		ssize_t distinct = index_distinct_est(tnt_idx, field);
+		if (distinct < 0)
+			return default_tuple_est[field + 1 >= 6 ? 6 : field];
+		if (distinct > count)
+			distinct = count;
+		if (distinct < 1)
+			distinct = 1;
+		return sqlLogEst(count / distinct > 1 ? count / distinct : 1);
 	}
 	return tnt_idx->def->opts.stat->tuple_log_est[field];
 }
@@ -48,6 +48,12 @@ struct BtCursor {
 	struct index *index;
 	struct iterator *iter;
 	enum iterator_type iter_type;
+	/**
+	 * Planner's estimate of the number of rows the scan will
+	 * visit, 0 when unknown. Set by OP_ScanHint and forwarded
+	 * to the storage iterator, see iterator::scan_estimate.
+	 */
+	uint64_t scan_estimate;
 	struct tuple *last_tuple;
 	char *key;		/* Saved key that was cursor last known position */
 };
@@ -657,7 +657,7 @@ static int
 exprCodeSubselect(Parse * pParse, Expr * pExpr)
 {
 	if (pExpr->op == TK_SELECT)
-		return sqlCodeSubselect(pParse, pExpr, 0);
+		return sqlCodeSubselect(pParse, pExpr, 0, false);
 	else
 		return 0;
 }
@@ -2659,7 +2659,8 @@ sqlFindInIndex(Parse * pParse,	/* Parsing context */
 		} else if (prRhsHasNull) {
 			*prRhsHasNull = rMayHaveNull = ++pParse->nMem;
 		}
-		sqlCodeSubselect(pParse, pX, rMayHaveNull);
+		sqlCodeSubselect(pParse, pX, rMayHaveNull,
+				 (inFlags & IN_INDEX_LOOP) != 0);
 		pParse->nQueryLoop = savedNQueryLoop;
 	} else {
 		pX->iTable = iTab;
@@ -2737,7 +2738,8 @@ expr_in_type(Parse *pParse, Expr *pExpr)
 int
 sqlCodeSubselect(Parse * pParse,	/* Parsing context */
 		     Expr * pExpr,	/* The IN, SELECT, or EXISTS operator */
-		     int rHasNullFlag	/* Register that records whether NULLs exist in RHS */
+		     int rHasNullFlag,	/* Register that records whether NULLs exist in RHS */
+		     bool inLoop	/* IN table is iterated, not just probed */
     )
 {
 	int jmpIfDynamic = -1;	/* One-time test address */
@@ -2796,6 +2798,13 @@ sqlCodeSubselect(Parse * pParse,	/* Parsing context */
 			int reg_eph = ++pParse->nMem;
 			addr = sqlVdbeAddOp2(v, OP_OpenTEphemeral,
 						 reg_eph, nVal);
+			/*
+			 * A membership-only table is never iterated
+			 * in key order, so it can live in a hash
+			 * index with O(1) probes instead of a tree.
+			 */
+			if (!inLoop)
+				sqlVdbeChangeP5(v, OPFLAG_EPH_HASH);
 			sqlVdbeAddOp3(v, OP_IteratorOpen, pExpr->iTable, 0,
 					  reg_eph);
 			struct sql_key_info *key_info = sql_key_info_new(pParse->db, nVal);
@@ -3641,7 +3650,7 @@ exprCodeVector(Parse * pParse, Expr * p, int *piFreeable)
 	} else {
 		*piFreeable = 0;
 		if (p->op == TK_SELECT) {
-			iResult = sqlCodeSubselect(pParse, p, 0);
+			iResult = sqlCodeSubselect(pParse, p, 0, false);
 		} else {
 			int i;
 			iResult = pParse->nMem + 1;
@@ -4153,7 +4162,8 @@ sqlExprCodeTarget(Parse * pParse, Expr * pExpr, int target)
 					 nCol, 1);
 				pParse->is_aborted = true;
 			} else {
-				return sqlCodeSubselect(pParse, pExpr, 0);
+				return sqlCodeSubselect(pParse, pExpr, 0,
+							false);
 			}
 			break;
 		}
@@ -4161,7 +4171,8 @@ sqlExprCodeTarget(Parse * pParse, Expr * pExpr, int target)
 			int n;
 			if (pExpr->pLeft->iTable == 0) {
 				pExpr->pLeft->iTable =
-				    sqlCodeSubselect(pParse, pExpr->pLeft, 0);
+				    sqlCodeSubselect(pParse, pExpr->pLeft, 0,
+						     false);
 			}
 			assert(pExpr->iTable == 0
 			       || pExpr->pLeft->op == TK_SELECT);
@@ -59,7 +59,15 @@ char *sql_temp_directory = 0;
 char *sql_data_directory = 0;
 
 enum {
-	LOOKASIDE_SLOT_NUMBER = 125,
+	/*
+	 * 125 slots used to be enough before parse tree nodes of
+	 * concurrently prepared statements started competing for
+	 * them: once the freelist is empty every Expr/Select node
+	 * falls back to malloc. 512 slots (256KB for the single
+	 * instance-wide connection) keep a typical short DML
+	 * statement entirely within lookaside.
+	 */
+	LOOKASIDE_SLOT_NUMBER = 512,
 	LOOKASIDE_SLOT_SIZE = 512,
 };
 
@@ -4463,6 +4463,65 @@ is_simple_count(struct Select *select, struct AggInfo *agg_info)
 	return space;
 }
 
+/**
+ * The second argument is the associated aggregate-info object.
+ * This function tests if the SELECT is of the form:
+ *
+ *   SELECT func(col) FROM <tbl>
+ *
+ * where func is a single built-in aggregate taking one plain
+ * column argument, there is no WHERE, GROUP BY, HAVING or
+ * DISTINCT clause and the table is not a sub-select or view.
+ * Such a query can be executed by a single OP_AggScan which
+ * runs the whole table scan in a tight C loop instead of a
+ * generic per-row opcode loop.
+ *
+ * @param select The select statement in form of aggregate query.
+ * @param agg_info The associated aggregate-info object.
+ * @param[out] column Number of the column passed to the
+ *             aggregate.
+ * @retval Pointer to space representing the table,
+ *         if the query matches this pattern. NULL otherwise.
+ */
+static struct space *
+is_simple_agg_scan(struct Select *select, struct AggInfo *agg_info,
+		   int *column)
+{
+	assert(select->pGroupBy == NULL);
+	if (select->pWhere != NULL || select->pHaving != NULL ||
+	    select->pEList->nExpr != 1 || select->pSrc->nSrc != 1 ||
+	    select->pSrc->a[0].pSelect != NULL)
+		return NULL;
+	struct space *space = select->pSrc->a[0].space;
+	assert(space != NULL && !space->def->opts.is_view);
+	struct Expr *expr = select->pEList->a[0].pExpr;
+	assert(expr != NULL);
+	if (expr->op != TK_AGG_FUNCTION)
+		return NULL;
+	if (agg_info->nFunc != 1 || agg_info->nAccumulator != 0)
+		return NULL;
+	struct AggInfo_func *agg_func = &agg_info->aFunc[0];
+	assert(agg_func->func->def->language == FUNC_LANGUAGE_SQL_BUILTIN);
+	if (agg_func->iDistinct >= 0)
+		return NULL;
+	/*
+	 * min() and max() are handled by the ordered index
+	 * optimization below, which is O(1) when a suitable
+	 * index exists. Don't steal them from it.
+	 */
+	if (sql_func_flag_is_set(agg_func->func, SQL_FUNC_NEEDCOLL))
+		return NULL;
+	struct ExprList *args = agg_func->pExpr->x.pList;
+	if (args == NULL || args->nExpr != 1)
+		return NULL;
+	struct Expr *arg = args->a[0].pExpr;
+	if ((arg->op != TK_AGG_COLUMN && arg->op != TK_COLUMN) ||
+	    arg->iColumn < 0)
+		return NULL;
+	*column = arg->iColumn;
+	return space;
+}
+
 /*
  * If the source-list item passed as an argument was augmented with an
  * INDEXED BY clause, then try to locate the specified index. If there
@@ -5466,6 +5525,24 @@ explain_simple_count(struct Parse *parse_context, const char *table_name)
 	}
 }
 
+/**
+ * Add explanation of the fused aggregate scan to the query plan.
+ * @param parse_context Current parsing context.
+ * @param table_name Name of table being scanned.
+ */
+static void
+explain_agg_scan(struct Parse *parse_context, const char *table_name)
+{
+	if (parse_context->explain == 2) {
+		char *zEqp = sqlMPrintf(parse_context->db,
+					    "fused aggregate scan %s",
+					    table_name);
+		sqlVdbeAddOp4(parse_context->pVdbe, OP_Explain,
+				  parse_context->iSelectId, 0, 0, zEqp,
+				  P4_DYNAMIC);
+	}
+}
+
 /**
  * Generate VDBE code that HALT program when subselect returned
  * more than one row (determined as LIMIT 1 overflow).
@@ -6312,6 +6389,7 @@ sqlSelect(Parse * pParse,		/* The parser context */
 
 		} /* endif pGroupBy.  Begin aggregate queries without GROUP BY: */
 		else {
+			int scan_column = -1;
 			struct space *space = is_simple_count(p, &sAggInfo);
 			if (space != NULL) {
 				/*
@@ -6336,6 +6414,27 @@ sqlSelect(Parse * pParse,		/* The parser context */
 						  sAggInfo.aFunc[0].iMem);
 				sqlVdbeAddOp1(v, OP_Close, cursor);
 				explain_simple_count(pParse, space->def->name);
+			} else if ((space = is_simple_agg_scan(p, &sAggInfo,
+						&scan_column)) != NULL) {
+				/*
+				 * A single aggregate over a bare
+				 * column with no WHERE clause: run
+				 * the whole scan inside one
+				 * OP_AggScan instead of a generic
+				 * per-row opcode loop.
+				 */
+				const int cursor = pParse->nTab++;
+				struct AggInfo_func *agg_func =
+					&sAggInfo.aFunc[0];
+				resetAccumulator(pParse, &sAggInfo);
+				vdbe_emit_open_cursor(pParse, cursor, 0,
+						      space);
+				sqlVdbeAddOp3(v, OP_AggScan, cursor,
+						  scan_column, agg_func->iMem);
+				sqlVdbeAppendP4(v, agg_func->func, P4_FUNC);
+				sqlVdbeAddOp1(v, OP_Close, cursor);
+				finalizeAggFunctions(pParse, &sAggInfo);
+				explain_agg_scan(pParse, space->def->name);
 			} else
 			{
 				/* Check if the query is of one of the following forms:
@@ -2288,6 +2288,7 @@ struct Parse {
 #define OPFLAG_LENGTHARG     0x40	/* OP_Column only used for length() */
 #define OPFLAG_TYPEOFARG     0x80	/* OP_Column only used for typeof() */
 #define OPFLAG_SEEKEQ        0x02	/* OP_Open** cursor uses EQ seek only */
+#define OPFLAG_EPH_HASH      0x20	/* OP_OpenTEphemeral: use a hash index */
 #define OPFLAG_FORDELETE     0x08	/* OP_Open should use BTREE_FORDELETE */
 #define OPFLAG_P2ISREG       0x10	/* P2 to OP_Open** is a register number */
 #define OPFLAG_PERMUTE       0x01	/* OP_Compare: use the permutation */
@@ -4046,7 +4047,7 @@ int
 sql_token(const char *z, int *type, bool *is_reserved);
 
 void sqlExpirePreparedStatements(sql *);
-int sqlCodeSubselect(Parse *, Expr *, int);
+int sqlCodeSubselect(Parse *, Expr *, int, bool);
 void sqlSelectPrep(Parse *, Select *, NameContext *);
 
 /**
@@ -4232,6 +4233,15 @@ sql_stat4_column(struct sql *db, const char *record, uint32_t col_num,
  */
 void *sqlParserAlloc(void *(*)(u64));
 void sqlParserFree(void *, void (*)(void *));
+/**
+ * Initialize a parser engine in caller-provided storage of at
+ * least sqlParserObjectSize() bytes, e.g. on the parse region so
+ * the memory is released wholesale with the rest of the parse.
+ * Pair with sqlParserFinalize() instead of sqlParserFree().
+ */
+void sqlParserInit(void *);
+void sqlParserFinalize(void *);
+u64 sqlParserObjectSize(void);
 void sqlParser(void *, int, Token, Parse *);
 #ifdef YYTRACKMAXSTACKDEPTH
 int sqlParserStackPeak(void *);
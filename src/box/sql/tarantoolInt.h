@@ -71,7 +71,8 @@ int tarantoolsqlRenameTrigger(const char *zTriggerName,
  * @retval Pointer to created space, NULL if error.
  */
 struct space *
-sql_ephemeral_space_create(uint32_t filed_count, struct sql_key_info *key_info);
+sql_ephemeral_space_create(uint32_t filed_count, struct sql_key_info *key_info,
+			   bool is_hash);
 
 /**
  * Insert tuple into ephemeral space.
@@ -472,11 +472,20 @@ sqlRunParser(Parse * pParse, const char *zSql)
 	pParse->zTail = zSql;
 	i = 0;
 	/* sqlParserTrace(stdout, "parser: "); */
-	pEngine = sqlParserAlloc(sqlMalloc);
+	/*
+	 * Place the parser engine on the parse region instead of
+	 * the heap: short DML statements create and drop a parser
+	 * per statement and the region is reset wholesale after
+	 * code generation anyway.
+	 */
+	pEngine = region_aligned_alloc(&pParse->region,
+				       sqlParserObjectSize(),
+				       alignof(uint64_t));
 	if (pEngine == 0) {
 		sqlOomFault(db);
 		return -1;
 	}
+	sqlParserInit(pEngine);
 	assert(pParse->create_table_def.new_space == NULL);
 	assert(pParse->parsed_ast.trigger == NULL);
 	assert(pParse->nVar == 0);
@@ -532,7 +541,7 @@ sqlRunParser(Parse * pParse, const char *zSql)
 		pParse->line_pos += pParse->sLastToken.n;
 	}
 	pParse->zTail = &zSql[i];
-	sqlParserFree(pEngine, sql_free);
+	sqlParserFinalize(pEngine);
 	if (db->mallocFailed)
 		pParse->is_aborted = true;
 	if (pParse->pVdbe != NULL && pParse->is_aborted) {
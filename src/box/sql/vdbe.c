@@ -3130,12 +3130,31 @@ open_cursor_set_hints:
 	break;
 }
 
+/* Opcode: ScanHint P1 P2 * * *
+ * Synopsis: cursor id = P1, estimated rows = P2
+ *
+ * Annotate the cursor P1 with the planner's estimate of the
+ * number of rows the upcoming scan will visit. The hint is
+ * forwarded to the storage engine iterator so that it can choose
+ * bulk paths up front, see iterator::scan_estimate. Purely an
+ * optimization: the estimate does not affect the result.
+ */
+case OP_ScanHint: {
+	struct VdbeCursor *cur = p->apCsr[pOp->p1];
+	assert(cur != NULL && cur->eCurType == CURTYPE_TARANTOOL);
+	cur->uc.pCursor->scan_estimate = pOp->p2;
+	break;
+}
+
 /**
- * Opcode: OpenTEphemeral P1 P2 * P4 *
+ * Opcode: OpenTEphemeral P1 P2 * P4 P5
  * Synopsis:
  * @param P1 register, where pointer to new space is stored.
  * @param P2 number of columns in a new table.
  * @param P4 key def for new table, NULL is allowed.
+ * @param P5 OPFLAG_EPH_HASH backs the table with a hash index
+ *        instead of a tree: only equality probes and unordered
+ *        scans, but cheaper inserts and lookups.
  *
  * This opcode creates Tarantool's ephemeral table and stores pointer
  * to it into P1 register.
@@ -3146,7 +3165,9 @@ case OP_OpenTEphemeral: {
 	assert(pOp->p4type != P4_KEYINFO || pOp->p4.key_info != NULL);
 
 	struct space *space = sql_ephemeral_space_create(pOp->p2,
-							 pOp->p4.key_info);
+							 pOp->p4.key_info,
+							 (pOp->p5 &
+							  OPFLAG_EPH_HASH) != 0);
 
 	if (space == NULL)
 		goto abort_due_to_error;
@@ -5152,6 +5173,87 @@ case OP_AggFinal: {
 	break;
 }
 
+/* Opcode: AggScan P1 P2 P3 P4 *
+ * Synopsis: accum=r[P3] step(column P2 of cursor P1)
+ *
+ * Execute the step function of the aggregate given by the
+ * FuncDef P4 for every row of the table opened by cursor P1,
+ * passing the P2-th column of the row as the only argument.
+ * Register P3 is the accumulator.
+ *
+ * This is a fused equivalent of the
+ * OP_Rewind/OP_Column/OP_AggStep/OP_Next loop emitted for a
+ * simple aggregate scan: the whole table is traversed in a
+ * single tight C loop, decoding only the aggregated field of
+ * each tuple and avoiding per-row opcode dispatch.
+ */
+case OP_AggScan: {
+	VdbeCursor *pC;
+	BtCursor *pCrsr;
+	Mem *pAccum;
+	Mem arg;
+	Mem t;
+	sql_context ctx;
+	enum field_type field_type;
+	int res;
+
+	assert(pOp->p1 >= 0 && pOp->p1 < p->nCursor);
+	pC = p->apCsr[pOp->p1];
+	assert(pC != 0);
+	assert(pC->eCurType == CURTYPE_TARANTOOL);
+	pCrsr = pC->uc.pCursor;
+	assert(pCrsr != 0);
+	assert(pCrsr->curFlags & BTCF_TaCursor);
+	assert(pOp->p2 >= 0 && pOp->p2 < pC->nField);
+	assert(pOp->p3 > 0 && pOp->p3 <= (p->nMem + 1 - p->nCursor));
+	assert(pOp->p4type == P4_FUNC);
+	pAccum = &aMem[pOp->p3];
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.pMem = pAccum;
+	ctx.func = pOp->p4.func;
+	ctx.iOp = (int)(pOp - aOp);
+	ctx.pVdbe = p;
+	ctx.argc = 1;
+	ctx.argv[0] = &arg;
+	assert(ctx.func->def->language == FUNC_LANGUAGE_SQL_BUILTIN);
+	struct func_sql_builtin *func = (struct func_sql_builtin *)ctx.func;
+	field_type = pCrsr->space->def->fields[pOp->p2].type;
+	sqlVdbeMemInit(&arg, db, MEM_Null);
+	if (tarantoolsqlFirst(pCrsr, &res) != 0)
+		goto abort_due_to_error;
+	while (res == 0) {
+		sqlVdbeMemSetNull(&arg);
+		arg.field_type = field_type_MAX;
+		vdbe_field_ref_prepare_tuple(&pC->field_ref,
+					     pCrsr->last_tuple);
+		if (vdbe_field_ref_fetch(&pC->field_ref, pOp->p2, &arg) != 0) {
+			sqlVdbeMemRelease(&arg);
+			goto abort_due_to_error;
+		}
+		arg.field_type = field_type;
+		pAccum->n++;
+		sqlVdbeMemInit(&t, db, MEM_Null);
+		ctx.pOut = &t;
+		ctx.is_aborted = false;
+		ctx.skipFlag = 0;
+		func->call(&ctx, ctx.argc, ctx.argv);
+		if (ctx.is_aborted) {
+			sqlVdbeMemRelease(&t);
+			sqlVdbeMemRelease(&arg);
+			goto abort_due_to_error;
+		}
+		assert(t.flags == MEM_Null);
+		if (sqlCursorNext(pCrsr, &res) != 0) {
+			sqlVdbeMemRelease(&arg);
+			goto abort_due_to_error;
+		}
+	}
+	sqlVdbeMemRelease(&arg);
+	pC->cacheStatus = CACHE_STALE;
+	pC->nullRow = 1;
+	break;
+}
+
 /* Opcode: Expire P1 * * * *
  *
  * Cause precompiled statements to expire.
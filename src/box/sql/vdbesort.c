@@ -153,6 +153,11 @@
  */
 #include "sqlInt.h"
 #include "vdbeInt.h"
+#include "trivia/config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#include "third_party/qsort_arg.h"
+#endif
 
 /*
  * Hard-coded maximum amount of data to accumulate in memory before flushing
@@ -1116,6 +1121,116 @@ vdbeSorterGetCompare(VdbeSorter * p)
 	return vdbeSorterCompare;
 }
 
+#ifdef HAVE_OPENMP
+
+/*
+ * Minimum number of in-memory records before a parallel sort pays
+ * off. Matches the threshold above which qsort_arg() itself
+ * switches to the multi-threaded implementation, so below it the
+ * array conversion would buy nothing.
+ */
+#define SORTER_PARALLEL_SORT_MIN (128*1024)
+
+/* Context passed to vdbeSorterQCompare() through qsort_arg(). */
+struct SorterSortCtx {
+	/* Sorter the records belong to, for the key_def. */
+	VdbeSorter *pSorter;
+	/* One unpacked-record scratch per sorting thread. */
+	UnpackedRecord **aUnpacked;
+};
+
+/*
+ * qsort_arg() comparison callback for an array of SorterRecord
+ * pointers. It runs concurrently on OpenMP worker threads, so
+ * each thread unpacks the right-hand key into its own scratch
+ * record. Unpacking and comparison only read the records and the
+ * key_def and do not allocate, which is what makes the parallel
+ * sort safe.
+ */
+static int
+vdbeSorterQCompare(const void *a, const void *b, void *arg)
+{
+	struct SorterSortCtx *pCtx = (struct SorterSortCtx *)arg;
+	SorterRecord *p1 = *(SorterRecord **)a;
+	SorterRecord *p2 = *(SorterRecord **)b;
+	UnpackedRecord *r2 = pCtx->aUnpacked[omp_get_thread_num()];
+	sqlVdbeRecordUnpackMsgpack(pCtx->pSorter->key_def, SRVAL(p2), r2);
+	return sqlVdbeRecordCompareMsgpack(SRVAL(p1), r2);
+}
+
+/* Return the record following p in the unsorted list. */
+static SorterRecord *
+vdbeSorterRecordNext(SorterList * pList, SorterRecord * p)
+{
+	if (pList->aMemory) {
+		if ((u8 *) p == pList->aMemory)
+			return 0;
+		assert(p->u.iNext < sqlMallocSize(pList->aMemory));
+		return (SorterRecord *) & pList->aMemory[p->u.iNext];
+	}
+	return p->u.pNext;
+}
+
+/*
+ * Try to sort the list with a multi-threaded qsort_arg() over an
+ * array of record pointers instead of the sequential list merge
+ * sort. On success the list is relinked in sorted order through
+ * u.pNext, exactly as the merge sort leaves it.
+ *
+ * Returns 0 on success, or 1 if the list is too small to benefit
+ * or memory could not be obtained, in which case nothing has been
+ * modified and the caller should fall back.
+ */
+static int
+vdbeSorterSortParallel(SortSubtask * pTask, SorterList * pList)
+{
+	SorterRecord *p;
+	int nRec = 0;
+	for (p = pList->pList; p; p = vdbeSorterRecordNext(pList, p))
+		nRec++;
+	if (nRec < SORTER_PARALLEL_SORT_MIN)
+		return 1;
+	int rc = 1;
+	sql *db = pTask->pSorter->db;
+	struct key_def *key_def = pTask->pSorter->key_def;
+	int nThread = omp_get_max_threads();
+	SorterRecord **aRec =
+	    (SorterRecord **) sqlMalloc(nRec * (i64) sizeof(*aRec));
+	UnpackedRecord **aUnpacked =
+	    (UnpackedRecord **) sqlMallocZero(nThread *
+					      sizeof(*aUnpacked));
+	if (aRec == 0 || aUnpacked == 0)
+		goto done;
+	int i;
+	for (i = 0; i < nThread; i++) {
+		aUnpacked[i] = sqlVdbeAllocUnpackedRecord(db, key_def);
+		if (aUnpacked[i] == 0)
+			goto done;
+		aUnpacked[i]->nField = key_def->part_count;
+	}
+	i = 0;
+	for (p = pList->pList; p; p = vdbeSorterRecordNext(pList, p))
+		aRec[i++] = p;
+	assert(i == nRec);
+	struct SorterSortCtx ctx = { pTask->pSorter, aUnpacked };
+	qsort_arg(aRec, nRec, sizeof(*aRec), vdbeSorterQCompare, &ctx);
+	for (i = 0; i < nRec - 1; i++)
+		aRec[i]->u.pNext = aRec[i + 1];
+	aRec[nRec - 1]->u.pNext = 0;
+	pList->pList = aRec[0];
+	rc = 0;
+done:
+	if (aUnpacked) {
+		for (i = 0; i < nThread; i++)
+			sqlDbFree(db, aUnpacked[i]);
+		sql_free(aUnpacked);
+	}
+	sql_free(aRec);
+	return rc;
+}
+
+#endif /* HAVE_OPENMP */
+
 /*
  * Sort the linked list of records headed at pTask->pList. Return
  * 0 if successful, or an sql error code (i.e. -1) if
@@ -1136,6 +1251,16 @@ vdbeSorterSort(SortSubtask * pTask, SorterList * pList)
 	p = pList->pList;
 	pTask->xCompare = vdbeSorterGetCompare(pTask->pSorter);
 
+#ifdef HAVE_OPENMP
+	/*
+	 * Big in-memory runs are sorted by all cores at once; the
+	 * sequential merge sort below stays as the fallback for
+	 * small runs and allocation failure.
+	 */
+	if (vdbeSorterSortParallel(pTask, pList) == 0)
+		return 0;
+#endif
+
 	aSlot =
 	    (SorterRecord **) sqlMallocZero(64 * sizeof(SorterRecord *));
 	if (!aSlot) {
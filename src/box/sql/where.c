@@ -4542,6 +4542,9 @@ sqlWhereBegin(Parse * pParse,	/* The parser context */
 			VdbeComment((v, "%s", space->def->name));
 			assert(pTabItem->iCursor == pLevel->iTabCur);
 			sqlVdbeChangeP5(v, bFordelete);
+			sqlVdbeAddOp2(v, OP_ScanHint, pTabItem->iCursor,
+				      (int)MIN(sqlLogEstToInt(pLoop->nOut),
+					       (u64)INT32_MAX));
 		}
 		if (pLoop->wsFlags & WHERE_INDEXED) {
 			struct index_def *idx_def = pLoop->index_def;
@@ -4615,6 +4618,9 @@ sqlWhereBegin(Parse * pParse,	/* The parser context */
 					wctrlFlags & WHERE_ORDERBY_MIN) == 0) {
 					sqlVdbeChangeP5(v, OPFLAG_SEEKEQ);	/* Hint to COMDB2 */
 				}
+				sqlVdbeAddOp2(v, OP_ScanHint, iIndexCur,
+					      (int)MIN(sqlLogEstToInt(pLoop->nOut),
+						       (u64)INT32_MAX));
 				VdbeComment((v, "%s", idx_def->name));
 			}
 		}
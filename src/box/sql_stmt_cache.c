@@ -30,11 +30,18 @@
  */
 #include "sql_stmt_cache.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <msgpuck.h>
+
 #include "assoc.h"
 #include "error.h"
 #include "execute.h"
 #include "diag.h"
 #include "info/info.h"
+#include "say.h"
+#include "tt_static.h"
 
 static struct sql_stmt_cache sql_stmt_cache;
 
@@ -46,7 +53,10 @@ sql_stmt_cache_init()
 		panic("out of memory");
 	sql_stmt_cache.mem_quota = 0;
 	sql_stmt_cache.mem_used = 0;
-	rlist_create(&sql_stmt_cache.gc_queue);
+	rlist_create(&sql_stmt_cache.lru);
+	sql_stmt_cache.hits = 0;
+	sql_stmt_cache.misses = 0;
+	sql_stmt_cache.evictions = 0;
 }
 
 void
@@ -60,6 +70,21 @@ sql_stmt_cache_stat(struct info_handler *h)
 	mh_foreach(sql_stmt_cache.hash, i)
 		entry_count++;
 	info_append_int(h, "stmt_count", entry_count);
+	info_append_int(h, "hits", sql_stmt_cache.hits);
+	info_append_int(h, "misses", sql_stmt_cache.misses);
+	info_append_int(h, "evictions", sql_stmt_cache.evictions);
+	info_table_end(h);
+	info_table_begin(h, "statements");
+	mh_foreach(sql_stmt_cache.hash, i) {
+		struct mh_i32ptr_node_t *node =
+			mh_i32ptr_node(sql_stmt_cache.hash, i);
+		struct stmt_cache_entry *entry = node->val;
+		info_table_begin(h, tt_sprintf("%u", node->key));
+		info_append_int(h, "refs", entry->refs);
+		info_append_int(h, "hits", entry->hits);
+		info_append_double(h, "prepare_time", entry->prepare_time);
+		info_table_end(h);
+	}
 	info_table_end(h);
 	info_end(h);
 }
@@ -81,16 +106,22 @@ sql_cache_entry_delete(struct stmt_cache_entry *entry)
 }
 
 /**
- * Remove statement entry from cache: remove from LRU list and
- * account cache size changes, then release occupied memory.
- * At the moment of calling this function, entry is already
- * removed from hash.
+ * Remove statement entry from cache: remove from hash and LRU
+ * list and account cache size changes, then release occupied
+ * memory.
  */
 static void
 sql_stmt_cache_delete(struct stmt_cache_entry *entry)
 {
-	if (sql_stmt_cache.last_found == entry)
-		sql_stmt_cache.last_found = NULL;
+	struct sql_stmt_cache *cache = &sql_stmt_cache;
+	const char *sql_str = sql_stmt_query_str(entry->stmt);
+	uint32_t stmt_id = sql_stmt_calculate_id(sql_str, strlen(sql_str));
+	mh_int_t i = mh_i32ptr_find(cache->hash, stmt_id, NULL);
+	assert(i != mh_end(cache->hash));
+	mh_i32ptr_del(cache->hash, i, NULL);
+	cache->mem_used -= sql_cache_entry_sizeof(entry->stmt);
+	if (cache->last_found == entry)
+		cache->last_found = NULL;
 	rlist_del(&entry->link);
 	sql_cache_entry_delete(entry);
 }
@@ -118,21 +149,29 @@ stmt_cache_find_entry(uint32_t stmt_id)
 	return entry;
 }
 
+/**
+ * Evict unreferenced statements starting from the least
+ * recently released one until used memory fits in @limit
+ * or there's nothing left to evict.
+ */
 static void
-sql_stmt_cache_gc()
+sql_stmt_cache_evict(size_t limit)
 {
 	struct stmt_cache_entry *entry, *next;
-	rlist_foreach_entry_safe(entry, &sql_stmt_cache.gc_queue, link, next)
+	rlist_foreach_entry_safe(entry, &sql_stmt_cache.lru, link, next) {
+		if (sql_stmt_cache.mem_used <= limit)
+			break;
 		sql_stmt_cache_delete(entry);
-	assert(rlist_empty(&sql_stmt_cache.gc_queue));
+		sql_stmt_cache.evictions++;
+	}
 }
 
 /**
  * Allocate new cache entry containing given prepared statement.
- * Add it to the LRU cache list. Account cache size enlargement.
+ * Account cache size enlargement.
  */
 static struct stmt_cache_entry *
-sql_cache_entry_new(struct sql_stmt *stmt)
+sql_cache_entry_new(struct sql_stmt *stmt, double prepare_time)
 {
 	struct stmt_cache_entry *entry = malloc(sizeof(*entry));
 	if (entry == NULL) {
@@ -141,8 +180,10 @@ sql_cache_entry_new(struct sql_stmt *stmt)
 		return NULL;
 	}
 	entry->stmt = stmt;
-	entry->link = (struct rlist) { NULL, NULL };
+	rlist_create(&entry->link);
 	entry->refs = 0;
+	entry->hits = 0;
+	entry->prepare_time = prepare_time;
 	return entry;
 }
 
@@ -162,21 +203,14 @@ sql_stmt_cache_entry_unref(struct stmt_cache_entry *entry)
 	assert((int64_t)entry->refs - 1 >= 0);
 	if (--entry->refs == 0) {
 		/*
-		 * Remove entry from hash and add it to gc queue.
-		 * Resources are to be released in the nearest
-		 * GC cycle (see sql_stmt_cache_insert()).
+		 * Keep the entry in the hash so that other
+		 * sessions preparing the same statement can
+		 * reuse the compiled plan, but make it an
+		 * eviction candidate: append to the LRU tail.
+		 * Resources are released only under memory
+		 * pressure (see sql_stmt_cache_evict()).
 		 */
-		struct sql_stmt_cache *cache = &sql_stmt_cache;
-		const char *sql_str = sql_stmt_query_str(entry->stmt);
-		uint32_t stmt_id = sql_stmt_calculate_id(sql_str,
-							 strlen(sql_str));
-		mh_int_t i = mh_i32ptr_find(cache->hash, stmt_id, NULL);
-		assert(i != mh_end(cache->hash));
-		mh_i32ptr_del(cache->hash, i, NULL);
-		rlist_add(&sql_stmt_cache.gc_queue, &entry->link);
-		sql_stmt_cache.mem_used -= sql_cache_entry_sizeof(entry->stmt);
-		if (sql_stmt_cache.last_found == entry)
-			sql_stmt_cache.last_found = NULL;
+		rlist_add_tail(&sql_stmt_cache.lru, &entry->link);
 	}
 }
 
@@ -207,7 +241,10 @@ sql_session_stmt_hash_add_id(struct mh_i32ptr_t *hash, uint32_t stmt_id)
 		return -1;
 	}
 	assert(old_node == NULL);
-	entry->refs++;
+	if (entry->refs++ == 0) {
+		/* The entry is referenced again - it can't be evicted. */
+		rlist_del(&entry->link);
+	}
 	return 0;
 }
 
@@ -226,25 +263,30 @@ sql_stmt_unref(uint32_t stmt_id)
 }
 
 int
-sql_stmt_cache_update(struct sql_stmt *old_stmt, struct sql_stmt *new_stmt)
+sql_stmt_cache_update(struct sql_stmt *old_stmt, struct sql_stmt *new_stmt,
+		      double prepare_time)
 {
 	const char *sql_str = sql_stmt_query_str(old_stmt);
 	uint32_t stmt_id = sql_stmt_calculate_id(sql_str, strlen(sql_str));
 	struct stmt_cache_entry *entry = stmt_cache_find_entry(stmt_id);
+	sql_stmt_cache.mem_used -= sql_cache_entry_sizeof(entry->stmt);
 	sql_stmt_finalize(entry->stmt);
 	entry->stmt = new_stmt;
+	entry->prepare_time = prepare_time;
+	sql_stmt_cache.mem_used += sql_cache_entry_sizeof(new_stmt);
 	return 0;
 }
 
 int
-sql_stmt_cache_insert(struct sql_stmt *stmt)
+sql_stmt_cache_insert(struct sql_stmt *stmt, double prepare_time)
 {
 	assert(stmt != NULL);
 	struct sql_stmt_cache *cache = &sql_stmt_cache;
 	size_t new_entry_size = sql_cache_entry_sizeof(stmt);
 
-	if (! sql_cache_check_new_entry_size(new_entry_size))
-		sql_stmt_cache_gc();
+	if (! sql_cache_check_new_entry_size(new_entry_size) &&
+	    new_entry_size <= cache->mem_quota)
+		sql_stmt_cache_evict(cache->mem_quota - new_entry_size);
 	/*
 	 * Test memory limit again. Raise an error if it is
 	 * still overcrowded.
@@ -256,7 +298,7 @@ sql_stmt_cache_insert(struct sql_stmt *stmt)
 		return -1;
 	}
 	struct mh_i32ptr_t *hash = cache->hash;
-	struct stmt_cache_entry *entry = sql_cache_entry_new(stmt);
+	struct stmt_cache_entry *entry = sql_cache_entry_new(stmt, prepare_time);
 	if (entry == NULL)
 		return -1;
 	const char *sql_str = sql_stmt_query_str(stmt);
@@ -279,16 +321,89 @@ struct sql_stmt *
 sql_stmt_cache_find(uint32_t stmt_id)
 {
 	struct stmt_cache_entry *entry = stmt_cache_find_entry(stmt_id);
-	if (entry == NULL)
+	if (entry == NULL) {
+		sql_stmt_cache.misses++;
 		return NULL;
+	}
+	sql_stmt_cache.hits++;
+	entry->hits++;
 	return entry->stmt;
 }
 
+int
+sql_stmt_cache_save(const char *path)
+{
+	struct sql_stmt_cache *cache = &sql_stmt_cache;
+	uint32_t count = 0;
+	size_t size = 0;
+	mh_int_t i;
+	mh_foreach(cache->hash, i) {
+		struct stmt_cache_entry *entry = (struct stmt_cache_entry *)
+			mh_i32ptr_node(cache->hash, i)->val;
+		const char *sql_str = sql_stmt_query_str(entry->stmt);
+		size += mp_sizeof_str(strlen(sql_str));
+		count++;
+	}
+	if (count == 0) {
+		/* Nothing to warm up next time - drop a stale dump. */
+		unlink(path);
+		return 0;
+	}
+	size += mp_sizeof_array(count);
+	char *buf = malloc(size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "warmup dump");
+		return -1;
+	}
+	char *p = mp_encode_array(buf, count);
+	mh_foreach(cache->hash, i) {
+		struct stmt_cache_entry *entry = (struct stmt_cache_entry *)
+			mh_i32ptr_node(cache->hash, i)->val;
+		const char *sql_str = sql_stmt_query_str(entry->stmt);
+		p = mp_encode_str(p, sql_str, strlen(sql_str));
+	}
+	assert(p == buf + size);
+	/*
+	 * Write to a temporary file first so that a crash in the
+	 * middle can not leave a truncated dump behind.
+	 */
+	const char *tmp_path = tt_sprintf("%s.inprogress", path);
+	int fd = open(tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s' file", tmp_path);
+		free(buf);
+		return -1;
+	}
+	ssize_t written = write(fd, buf, size);
+	free(buf);
+	close(fd);
+	if (written != (ssize_t)size || rename(tmp_path, path) != 0) {
+		diag_set(SystemError, "failed to write '%s' file", path);
+		unlink(tmp_path);
+		return -1;
+	}
+	say_info("saved %u prepared statements to '%s'", count, path);
+	return 0;
+}
+
+int
+sql_stmt_cache_warmup_insert(struct sql_stmt *stmt, double prepare_time)
+{
+	if (sql_stmt_cache_insert(stmt, prepare_time) != 0)
+		return -1;
+	const char *sql_str = sql_stmt_query_str(stmt);
+	uint32_t stmt_id = sql_stmt_calculate_id(sql_str, strlen(sql_str));
+	struct stmt_cache_entry *entry = stmt_cache_find_entry(stmt_id);
+	assert(entry != NULL && entry->refs == 0);
+	rlist_add_tail(&sql_stmt_cache.lru, &entry->link);
+	return 0;
+}
+
 int
 sql_stmt_cache_set_size(size_t size)
 {
 	if (sql_stmt_cache.mem_used > size)
-		sql_stmt_cache_gc();
+		sql_stmt_cache_evict(size);
 	if (sql_stmt_cache.mem_used > size) {
 		diag_set(ClientError, ER_SQL_PREPARE, "Can't reduce memory "\
 			 "limit for SQL prepared statements: please, deallocate "\
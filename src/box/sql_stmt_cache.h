@@ -47,15 +47,22 @@ struct stmt_cache_entry {
 	/** Prepared statement itself. */
 	struct sql_stmt *stmt;
 	/**
-	 * Link to the next entry. All statements are to be
-	 * evicted on the next gc cycle.
+	 * Link in the LRU list of unreferenced entries. While
+	 * an entry is referenced by at least one session the
+	 * link is detached; once the last reference is gone the
+	 * entry is appended to the LRU tail and becomes an
+	 * eviction candidate.
 	 */
 	struct rlist link;
 	/**
-	 * Reference counter. If it is == 0, entry gets
-	 * into GC queue.
+	 * Reference counter. If it is == 0, entry is kept in
+	 * the cache but may be evicted under memory pressure.
 	 */
 	uint32_t refs;
+	/** Number of times the statement was found in the cache. */
+	uint64_t hits;
+	/** Time (in seconds) spent compiling the statement. */
+	double prepare_time;
 };
 
 /**
@@ -70,11 +77,19 @@ struct sql_stmt_cache {
 	struct mh_i32ptr_t *hash;
 	/**
 	 * After deallocation statements are not deleted, but
-	 * moved to this list. GC process is triggered only
-	 * when memory limit has reached. It allows to reduce
-	 * workload on session's disconnect.
+	 * moved to this LRU list (and remain reachable via the
+	 * hash). Eviction is triggered only when the memory
+	 * limit has been reached and proceeds from the list
+	 * head, so a statement prepared by one session can be
+	 * picked up by another without re-running the parser.
 	 */
-	struct rlist gc_queue;
+	struct rlist lru;
+	/** Number of successful cache lookups. */
+	uint64_t hits;
+	/** Number of failed cache lookups. */
+	uint64_t misses;
+	/** Number of statements evicted under memory pressure. */
+	uint64_t evictions;
 	/**
 	 * Last result of sql_stmt_cache_find() invocation.
 	 * Since during processing prepared statement it
@@ -92,8 +107,9 @@ void
 sql_stmt_cache_init();
 
 /**
- * Store statistics concerning cache (current size and number
- * of statements in it) into info handler @h.
+ * Store statistics concerning cache (current size, number of
+ * statements, hit/miss counters and per-statement details) into
+ * info handler @h.
  */
 void
 sql_stmt_cache_stat(struct info_handler *h);
@@ -125,22 +141,47 @@ sql_stmt_calculate_id(const char *sql_str, size_t len);
 void
 sql_stmt_unref(uint32_t stmt_id);
 
+/**
+ * Replace statement in the cache entry with its re-compiled
+ * version (as a result of a schema change). @prepare_time is
+ * the time spent on re-compilation.
+ */
 int
-sql_stmt_cache_update(struct sql_stmt *old_stmt, struct sql_stmt *new_stmt);
+sql_stmt_cache_update(struct sql_stmt *old_stmt, struct sql_stmt *new_stmt,
+		      double prepare_time);
 
 /**
  * Save prepared statement to the prepared statement cache.
  * Account cache size change. If the cache is full (i.e. memory
  * quota is exceeded) diag error is raised. In case of success
  * return id of prepared statement via output parameter @id.
+ * @prepare_time is the time spent compiling the statement; it
+ * is kept for statistics.
  */
 int
-sql_stmt_cache_insert(struct sql_stmt *stmt);
+sql_stmt_cache_insert(struct sql_stmt *stmt, double prepare_time);
 
 /** Find entry by SQL string. In case of search fails it returns NULL. */
 struct sql_stmt *
 sql_stmt_cache_find(uint32_t stmt_id);
 
+/**
+ * Dump the SQL texts of all cached statements to a file at
+ * @a path, so that the next start can re-prepare them before
+ * serving requests, see sql_warmup().
+ */
+int
+sql_stmt_cache_save(const char *path);
+
+/**
+ * Save a statement compiled during warmup to the cache. Unlike
+ * a statement prepared by a session the new entry is not
+ * referenced by anyone, so it goes straight to the LRU list and
+ * is the first eviction candidate under memory pressure.
+ */
+int
+sql_stmt_cache_warmup_insert(struct sql_stmt *stmt, double prepare_time);
+
 
 /** Set prepared cache size limit. */
 int
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "stat_snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "fiber.h"
+#include "iproto.h"
+#include "mpstream.h"
+#include "rmean.h"
+#include "small/region.h"
+#include "txn.h"
+#include "wal.h"
+
+extern struct rmean *rmean_box;
+extern struct rmean *rmean_error;
+
+/** Snapshot rendering period, in seconds. */
+static const double STAT_SNAPSHOT_INTERVAL = 1.0;
+
+static struct {
+	/** The rendered msgpack map, malloced. */
+	char *data;
+	/** Size of the buffer, in bytes. */
+	uint32_t size;
+	/** Incremented on every render, starts from 1. */
+	uint64_t version;
+	/** The rendering fiber. */
+	struct fiber *worker;
+} stat_snapshot;
+
+static void
+snapshot_encode_error(void *error_ctx)
+{
+	*(bool *)error_ctx = true;
+}
+
+/** An rmean_foreach() callback counting the entries. */
+static int
+snapshot_count_item(const char *name, int rps, int64_t total, void *cb_ctx)
+{
+	(void)name;
+	(void)rps;
+	(void)total;
+	++*(uint32_t *)cb_ctx;
+	return 0;
+}
+
+/** An rmean_foreach() callback encoding one {total, rps} item. */
+static int
+snapshot_encode_item(const char *name, int rps, int64_t total, void *cb_ctx)
+{
+	struct mpstream *stream = cb_ctx;
+	mpstream_encode_str(stream, name);
+	mpstream_encode_map(stream, 2);
+	mpstream_encode_str(stream, "total");
+	mpstream_encode_uint(stream, total);
+	mpstream_encode_str(stream, "rps");
+	mpstream_encode_uint(stream, rps);
+	return 0;
+}
+
+/**
+ * Render the full statistics set into a fresh buffer and publish
+ * it. The stream writes to the fiber region, the result is then
+ * joined and copied into a malloced buffer so that it outlives
+ * the region truncation.
+ */
+static int
+stat_snapshot_render(void)
+{
+	struct region *region = &fiber()->gc;
+	size_t svp = region_used(region);
+	bool is_error = false;
+	struct mpstream stream;
+	mpstream_init(&stream, region, region_reserve_cb, region_alloc_cb,
+		      snapshot_encode_error, &is_error);
+
+	uint32_t box_count = 0;
+	rmean_foreach(rmean_box, snapshot_count_item, &box_count);
+	rmean_foreach(rmean_error, snapshot_count_item, &box_count);
+	uint32_t net_count = 0;
+	iproto_rmean_foreach(snapshot_count_item, &net_count);
+
+	mpstream_encode_map(&stream, 6);
+
+	mpstream_encode_str(&stream, "version");
+	mpstream_encode_uint(&stream, stat_snapshot.version + 1);
+	mpstream_encode_str(&stream, "timestamp");
+	mpstream_encode_double(&stream, fiber_time());
+
+	/* box.stat(): request and error counters. */
+	mpstream_encode_str(&stream, "box");
+	mpstream_encode_map(&stream, box_count);
+	rmean_foreach(rmean_box, snapshot_encode_item, &stream);
+	rmean_foreach(rmean_error, snapshot_encode_item, &stream);
+
+	/* box.stat.net(): network counters and current gauges. */
+	mpstream_encode_str(&stream, "net");
+	mpstream_encode_map(&stream, net_count + 2);
+	iproto_rmean_foreach(snapshot_encode_item, &stream);
+	mpstream_encode_str(&stream, "connections");
+	mpstream_encode_uint(&stream, iproto_connection_count());
+	mpstream_encode_str(&stream, "requests");
+	mpstream_encode_uint(&stream, iproto_request_count());
+
+	/* box.stat.wal(): group commit metrics. */
+	struct wal_stat wal_st;
+	wal_stat(&wal_st);
+	mpstream_encode_str(&stream, "wal");
+	mpstream_encode_map(&stream, 5);
+	mpstream_encode_str(&stream, "flushes");
+	mpstream_encode_uint(&stream, wal_st.flush_count);
+	mpstream_encode_str(&stream, "entries");
+	mpstream_encode_uint(&stream, wal_st.entry_count);
+	mpstream_encode_str(&stream, "flush_latency");
+	mpstream_encode_double(&stream, wal_st.flush_latency);
+	mpstream_encode_str(&stream, "flush_delay");
+	mpstream_encode_double(&stream, wal_st.flush_delay);
+	mpstream_encode_str(&stream, "batch_size_hist");
+	mpstream_encode_array(&stream, WAL_BATCH_HIST_BUCKETS);
+	for (int i = 0; i < WAL_BATCH_HIST_BUCKETS; i++)
+		mpstream_encode_uint(&stream, wal_st.batch_size_hist[i]);
+
+	/* box.stat.txn(): transaction memory metrics. */
+	struct txn_mem_stat txn_st;
+	txn_mem_stat(&txn_st);
+	mpstream_encode_str(&stream, "txn");
+	mpstream_encode_map(&stream, 3);
+	mpstream_encode_str(&stream, "txns");
+	mpstream_encode_uint(&stream, txn_st.txn_count);
+	mpstream_encode_str(&stream, "max_footprint");
+	mpstream_encode_uint(&stream, txn_st.max_footprint);
+	mpstream_encode_str(&stream, "arena_reserve");
+	mpstream_encode_uint(&stream, txn_st.arena_reserve);
+
+	mpstream_flush(&stream);
+	if (is_error) {
+		diag_set(OutOfMemory, stream.pos - stream.buf, "region",
+			 "stat snapshot");
+		region_truncate(region, svp);
+		return -1;
+	}
+	uint32_t size = region_used(region) - svp;
+	char *raw = region_join(region, size);
+	if (raw == NULL) {
+		diag_set(OutOfMemory, size, "region_join", "stat snapshot");
+		region_truncate(region, svp);
+		return -1;
+	}
+	char *copy = malloc(size);
+	if (copy == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "stat snapshot");
+		region_truncate(region, svp);
+		return -1;
+	}
+	memcpy(copy, raw, size);
+	region_truncate(region, svp);
+
+	free(stat_snapshot.data);
+	stat_snapshot.data = copy;
+	stat_snapshot.size = size;
+	stat_snapshot.version++;
+	return 0;
+}
+
+static int
+stat_snapshot_fiber_f(va_list ap)
+{
+	(void)ap;
+	while (!fiber_is_cancelled()) {
+		if (stat_snapshot_render() != 0) {
+			/*
+			 * A failed render is a monitoring hiccup,
+			 * not an instance problem: keep the
+			 * previous buffer and try again later.
+			 */
+			diag_log();
+		}
+		fiber_sleep(STAT_SNAPSHOT_INTERVAL);
+	}
+	return 0;
+}
+
+void
+stat_snapshot_init(void)
+{
+	stat_snapshot.worker = fiber_new("stat_snapshot",
+					 stat_snapshot_fiber_f);
+	if (stat_snapshot.worker == NULL) {
+		/* Degraded monitoring only - do not fail the box. */
+		diag_log();
+		diag_clear(diag_get());
+		return;
+	}
+	fiber_start(stat_snapshot.worker);
+}
+
+void
+stat_snapshot_free(void)
+{
+	if (stat_snapshot.worker != NULL) {
+		fiber_cancel(stat_snapshot.worker);
+		stat_snapshot.worker = NULL;
+	}
+	free(stat_snapshot.data);
+	stat_snapshot.data = NULL;
+	stat_snapshot.size = 0;
+}
+
+int
+stat_snapshot_get(const char **data, uint32_t *size)
+{
+	if (stat_snapshot.data == NULL)
+		return -1;
+	*data = stat_snapshot.data;
+	*size = stat_snapshot.size;
+	return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef TARANTOOL_BOX_STAT_SNAPSHOT_H_INCLUDED
+#define TARANTOOL_BOX_STAT_SNAPSHOT_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Periodically rendered statistics snapshot.
+ *
+ * Monitoring collectors tend to poll box.stat()/box.stat.net()
+ * at a fixed rate each, and every call used to walk all the
+ * counters from scratch in the tx thread. The snapshot daemon
+ * renders the whole statistics set into a msgpack buffer once
+ * per second, so serving a collector costs a buffer lookup
+ * instead of a full walk, no matter how many collectors are
+ * attached. The buffer is versioned: the version grows with
+ * every render, letting a collector detect a stale snapshot
+ * after a restart or a long stall.
+ */
+
+/** Start the snapshot rendering fiber. */
+void
+stat_snapshot_init(void);
+
+/** Stop the rendering fiber and release the buffer. */
+void
+stat_snapshot_free(void);
+
+/**
+ * Get the current snapshot buffer.
+ * @param[out] data The rendered msgpack map.
+ * @param[out] size Size of the buffer, in bytes.
+ * @retval 0 On success.
+ * @retval -1 If no snapshot has been rendered yet.
+ *
+ * The buffer stays valid until the next yield: the renderer
+ * replaces it from a fiber, never in the middle of a consumer.
+ */
+int
+stat_snapshot_get(const char **data, uint32_t *size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_STAT_SNAPSHOT_H_INCLUDED */
@@ -192,7 +192,9 @@ static const struct index_vtab sysview_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ sysview_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ generic_index_replace,
 	/* .create_iterator = */ sysview_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -546,7 +548,7 @@ sysview_engine_create_space(struct engine *engine, struct space_def *def,
 		tuple_format_new(NULL, NULL, keys, key_count, def->fields,
 				 def->field_count, def->exact_field_count,
 				 def->dict, def->opts.is_temporary,
-				 def->opts.is_ephemeral);
+				 def->opts.is_ephemeral, false);
 	if (format == NULL) {
 		free(space);
 		return NULL;
@@ -30,9 +30,12 @@
  */
 #include "tuple.h"
 
+#include <sys/mman.h>
+
 #include "trivia/util.h"
 #include "memory.h"
 #include "fiber.h"
+#include "mempool_registry.h"
 #include "small/quota.h"
 #include "small/small.h"
 #include "xrow_update.h"
@@ -97,7 +100,10 @@ runtime_tuple_new(struct tuple_format *format, const char *data, const char *end
 	tuple->bsize = data_len;
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format);
+	/* data_offset is a 15-bit field, see struct tuple. */
+	assert(sizeof(struct tuple) + field_map_size <= INT16_MAX);
 	tuple->data_offset = sizeof(struct tuple) + field_map_size;
+	tuple->is_compressed = false;
 	char *raw = (char *) tuple + tuple->data_offset;
 	field_map_build(&builder, raw - field_map_size);
 	memcpy(raw, data, data_len);
@@ -286,6 +292,98 @@ tuple_unref_slow(struct tuple *tuple)
 
 /* }}} Bigref */
 
+/* {{{ Tuple pin epochs - batch tuple frees on read paths */
+
+enum {
+	EPOCH_MIN_CAPACITY = 128,
+	/**
+	 * Hard cap on the deferred free list. Past it tuples are
+	 * freed in place: an epoch only batches frees, it is not
+	 * a liveness contract, so this is always safe.
+	 */
+	EPOCH_MAX_CAPACITY = 16384,
+};
+
+uint32_t tuple_epoch_depth = 0;
+
+/**
+ * Tuples which dropped their last reference inside an epoch.
+ * Each entry holds one reference on behalf of the epoch, to be
+ * released when the outermost epoch is left.
+ */
+static struct tuple_epoch_list {
+	/** Deferred tuples. */
+	struct tuple **tuples;
+	/** Number of deferred tuples. */
+	uint32_t count;
+	/** Capacity of the array. */
+	uint32_t capacity;
+} tuple_epoch_list;
+
+/** Initialize the deferred free list. */
+static inline void
+tuple_epoch_list_create(void)
+{
+	memset(&tuple_epoch_list, 0, sizeof(tuple_epoch_list));
+}
+
+/** Destroy the deferred free list and free its memory. */
+static inline void
+tuple_epoch_list_destroy(void)
+{
+	assert(tuple_epoch_depth == 0 && tuple_epoch_list.count == 0);
+	free(tuple_epoch_list.tuples);
+}
+
+void
+tuple_epoch_defer(struct tuple *tuple)
+{
+	assert(tuple_epoch_depth > 0);
+	assert(tuple->refs == 0 && !tuple->is_bigref);
+	struct tuple_epoch_list *list = &tuple_epoch_list;
+	if (list->count == list->capacity) {
+		uint32_t capacity = list->capacity == 0 ?
+			EPOCH_MIN_CAPACITY : list->capacity * 2;
+		struct tuple **tuples = capacity > EPOCH_MAX_CAPACITY ?
+			NULL : (struct tuple **)
+			realloc(list->tuples, capacity * sizeof(*tuples));
+		if (tuples == NULL) {
+			/* The batch is full - free in place. */
+			tuple_delete(tuple);
+			return;
+		}
+		list->tuples = tuples;
+		list->capacity = capacity;
+	}
+	tuple->refs = 1;
+	list->tuples[list->count++] = tuple;
+}
+
+void
+tuple_epoch_enter(void)
+{
+	++tuple_epoch_depth;
+}
+
+void
+tuple_epoch_leave(void)
+{
+	assert(tuple_epoch_depth > 0);
+	if (--tuple_epoch_depth > 0)
+		return;
+	struct tuple_epoch_list *list = &tuple_epoch_list;
+	/*
+	 * Drop the references taken by tuple_epoch_defer().
+	 * Tuples re-referenced since they were deferred survive,
+	 * the rest are freed in one cache-friendly batch.
+	 */
+	for (uint32_t i = 0; i < list->count; ++i)
+		tuple_unref(list->tuples[i]);
+	list->count = 0;
+}
+
+/* }}} Tuple pin epochs */
+
 int
 tuple_init(field_name_hash_f hash)
 {
@@ -298,7 +396,7 @@ tuple_init(field_name_hash_f hash)
 	 */
 	tuple_format_runtime = tuple_format_new(&tuple_format_runtime_vtab, NULL,
 						NULL, 0, NULL, 0, 0, NULL, false,
-						false);
+						false, false);
 	if (tuple_format_runtime == NULL)
 		return -1;
 
@@ -310,11 +408,14 @@ tuple_init(field_name_hash_f hash)
 
 	mempool_create(&tuple_iterator_pool, &cord()->slabc,
 		       sizeof(struct tuple_iterator));
+	mempool_registry_add(&tuple_iterator_pool, "tuple.iterator");
 
 	box_tuple_last = NULL;
 
 	bigref_list_create();
 
+	tuple_epoch_list_create();
+
 	if (coll_id_cache_init() != 0)
 		return -1;
 
@@ -355,6 +456,23 @@ tuple_arena_create(struct slab_arena *arena, struct quota *quota,
 
 	say_debug("tuple arena %s: addr %p size %zu flags %#x dontdump %d",
 		  arena_name, arena->arena, prealloc, flags, dontdump);
+
+#ifdef MADV_HUGEPAGE
+	/*
+	 * Ask the kernel to back the arena with huge pages. The
+	 * arena is preallocated in one contiguous mapping and
+	 * slabs are large, so huge pages cut TLB pressure on the
+	 * allocation-heavy paths (memtx tuples, vinyl statements
+	 * and tree extents) at no fragmentation cost. This is
+	 * just a hint: ignore errors.
+	 */
+	if (arena->arena != NULL && prealloc > 0 &&
+	    madvise(arena->arena, prealloc, MADV_HUGEPAGE) != 0 &&
+	    errno != EINVAL) {
+		say_syserror("tuple arena %s: madvise(MADV_HUGEPAGE) failed",
+			     arena_name);
+	}
+#endif
 }
 
 void
@@ -372,6 +490,7 @@ tuple_free(void)
 		box_tuple_last = NULL;
 	}
 
+	mempool_registry_remove(&tuple_iterator_pool);
 	mempool_destroy(&tuple_iterator_pool);
 	small_alloc_destroy(&runtime_alloc);
 
@@ -380,6 +499,8 @@ tuple_free(void)
 	coll_id_cache_destroy();
 
 	bigref_list_destroy();
+
+	tuple_epoch_list_destroy();
 }
 
 /* {{{ tuple_field_* getters */
@@ -477,6 +598,36 @@ tuple_go_to_path(const char **data, const char *path, uint32_t path_len,
 	return rc != 0 ? -1 : 0;
 }
 
+int
+tuple_go_to_path_tokens(const char **data, const struct json_token *tokens,
+			uint32_t token_count, int multikey_idx)
+{
+	for (uint32_t i = 0; i < token_count; i++) {
+		const struct json_token *token = &tokens[i];
+		int rc;
+		switch (token->type) {
+		case JSON_TOKEN_ANY:
+			if (multikey_idx == MULTIKEY_NONE)
+				return -1;
+			rc = tuple_field_go_to_index(data, multikey_idx);
+			break;
+		case JSON_TOKEN_NUM:
+			rc = tuple_field_go_to_index(data, token->num);
+			break;
+		default:
+			assert(token->type == JSON_TOKEN_STR);
+			rc = tuple_field_go_to_key(data, token->str,
+						   token->len);
+			break;
+		}
+		if (rc != 0) {
+			*data = NULL;
+			return 0;
+		}
+	}
+	return 0;
+}
+
 const char *
 tuple_field_raw_by_full_path(struct tuple_format *format, const char *tuple,
 			     const uint32_t *field_map, const char *path,
@@ -529,7 +680,7 @@ tuple_field_raw_by_full_path(struct tuple_format *format, const char *tuple,
 	return tuple_field_raw_by_path(format, tuple, field_map, fieldno,
 				       path + lexer.offset,
 				       path_len - lexer.offset,
-				       NULL, MULTIKEY_NONE);
+				       NULL, 0, NULL, MULTIKEY_NONE);
 }
 
 uint32_t
@@ -543,7 +694,7 @@ tuple_raw_multikey_count(struct tuple_format *format, const char *data,
 					key_def->multikey_fieldno,
 					key_def->multikey_path,
 					key_def->multikey_path_len,
-					NULL, MULTIKEY_NONE);
+					NULL, 0, NULL, MULTIKEY_NONE);
 	if (array_raw == NULL)
 		return 0;
 	assert(mp_typeof(*array_raw) == MP_ARRAY);
@@ -566,7 +717,7 @@ box_tuple_format_new(struct key_def **keys, uint16_t key_count)
 	box_tuple_format_t *format =
 		tuple_format_new(&tuple_format_runtime_vtab, NULL,
 				 keys, key_count, NULL, 0, 0, NULL, false,
-				 false);
+				 false, false);
 	if (format != NULL)
 		tuple_format_ref(format);
 	return format;
@@ -633,6 +784,17 @@ box_tuple_field(box_tuple_t *tuple, uint32_t fieldno)
 	return tuple_field(tuple, fieldno);
 }
 
+int
+box_tuple_fieldno_by_name(box_tuple_t *tuple, const char *name,
+			  uint32_t name_len, uint32_t *fieldno)
+{
+	assert(tuple != NULL);
+	struct tuple_format *format = tuple_format(tuple);
+	return tuple_fieldno_by_name(format->dict, name, name_len,
+				     field_name_hash(name, name_len),
+				     fieldno);
+}
+
 typedef struct tuple_iterator box_tuple_iterator_t;
 
 box_tuple_iterator_t *
@@ -37,6 +37,7 @@
 #include "uuid/tt_uuid.h" /* tuple_field_uuid */
 #include "tt_static.h"
 #include "tuple_format.h"
+#include "tuple_compression.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -170,6 +171,21 @@ box_tuple_format(box_tuple_t *tuple);
 const char *
 box_tuple_field(box_tuple_t *tuple, uint32_t fieldno);
 
+/**
+ * Resolve a field name to a zero-based field number using the
+ * format dictionary of the tuple.
+ *
+ * \param tuple a tuple
+ * \param name field name
+ * \param name_len length of \a name
+ * \param[out] fieldno zero-based field number, set on success
+ * \retval 0 field is found
+ * \retval -1 no such field
+ */
+int
+box_tuple_fieldno_by_name(box_tuple_t *tuple, const char *name,
+			  uint32_t name_len, uint32_t *fieldno);
+
 /**
  * Tuple iterator
  */
@@ -319,7 +335,14 @@ struct PACKED tuple
 	/**
 	 * Offset to the MessagePack from the begin of the tuple.
 	 */
-	uint16_t data_offset;
+	uint16_t data_offset : 15;
+	/**
+	 * The MessagePack data is stored zstd-compressed: the
+	 * bytes at data_offset are a 4-byte compressed size
+	 * followed by the compressed stream, while bsize keeps
+	 * the decompressed length. See tuple_compression.h.
+	 */
+	bool is_compressed : 1;
 	/**
 	 * Engine specific fields and offsets array concatenated
 	 * with MessagePack fields array.
@@ -343,6 +366,8 @@ tuple_size(struct tuple *tuple)
 static inline const char *
 tuple_data(struct tuple *tuple)
 {
+	if (unlikely(tuple->is_compressed))
+		return tuple_decompress(tuple);
 	return (const char *) tuple + tuple->data_offset;
 }
 
@@ -365,6 +390,8 @@ static inline const char *
 tuple_data_range(struct tuple *tuple, uint32_t *p_size)
 {
 	*p_size = tuple->bsize;
+	if (unlikely(tuple->is_compressed))
+		return tuple_decompress(tuple);
 	return (const char *) tuple + tuple->data_offset;
 }
 
@@ -574,6 +601,26 @@ tuple_field_go_to_index(const char **field, uint64_t index);
 int
 tuple_field_go_to_key(const char **field, const char *key, int len);
 
+/**
+ * Propagate @a data to the JSON path compiled into a flat
+ * token array, see json_path_compile(). Works exactly like
+ * tuple_go_to_path(), but does not run a JSON lexer.
+ * @param[in][out] data Tuple field to propagate.
+ * @param tokens Compiled JSON path tokens.
+ * @param token_count Number of tokens in @a tokens.
+ * @param multikey_idx The multikey index hint - index of the
+ *                     multikey array entry to use for the
+ *                     JSON_TOKEN_ANY token.
+ *
+ * @retval 0 Success, @a data points to the field or is set to
+ *           NULL if the field doesn't exist in the tuple.
+ * @retval -1 JSON_TOKEN_ANY token was met while @a multikey_idx
+ *            is MULTIKEY_NONE.
+ */
+int
+tuple_go_to_path_tokens(const char **data, const struct json_token *tokens,
+			uint32_t token_count, int multikey_idx);
+
 /**
  * Get tuple field by field index, relative JSON path and
  * multikey_idx.
@@ -582,6 +629,11 @@ tuple_field_go_to_key(const char **field, const char *key, int len);
  * @param field_map Tuple field map.
  * @param path Relative JSON path to field.
  * @param path_len Length of @a path.
+ * @param path_tokens @a path compiled into a flat token array,
+ *                    or NULL if unavailable. When given, allows
+ *                    to locate the field without running a JSON
+ *                    lexer on @a path.
+ * @param path_token_count Number of tokens in @a path_tokens.
  * @param offset_slot_hint The pointer to a variable that contains
  *                         an offset slot. May be NULL.
  *                         If specified AND value by pointer is
@@ -597,6 +649,8 @@ static inline const char *
 tuple_field_raw_by_path(struct tuple_format *format, const char *tuple,
 			const uint32_t *field_map, uint32_t fieldno,
 			const char *path, uint32_t path_len,
+			const struct json_token *path_tokens,
+			uint32_t path_token_count,
 			int32_t *offset_slot_hint, int multikey_idx)
 {
 	int32_t offset_slot;
@@ -612,7 +666,11 @@ tuple_field_raw_by_path(struct tuple_format *format, const char *tuple,
 			mp_decode_array(&tuple);
 			return tuple;
 		}
-		field = tuple_format_field_by_path(format, fieldno, path,
+		field = path_tokens != NULL ?
+			tuple_format_field_by_path_tokens(format, fieldno,
+							  path_tokens,
+							  path_token_count) :
+			tuple_format_field_by_path(format, fieldno, path,
 						   path_len);
 		assert(field != NULL || path != NULL);
 		if (path != NULL && field == NULL)
@@ -625,7 +683,8 @@ tuple_field_raw_by_path(struct tuple_format *format, const char *tuple,
 offset_slot_access:
 		/* Indexed field */
 		offset = field_map_get_offset(field_map, offset_slot,
-					      multikey_idx);
+					      multikey_idx,
+					      format->is_compact_field_map);
 		if (offset == 0)
 			return NULL;
 		tuple += offset;
@@ -638,10 +697,16 @@ parse:
 			return NULL;
 		for (uint32_t k = 0; k < fieldno; k++)
 			mp_next(&tuple);
-		if (path != NULL &&
-		    unlikely(tuple_go_to_path(&tuple, path, path_len,
-					      multikey_idx) != 0))
+		if (path_tokens != NULL) {
+			if (unlikely(tuple_go_to_path_tokens(&tuple,
+					path_tokens, path_token_count,
+					multikey_idx) != 0))
+				return NULL;
+		} else if (path != NULL &&
+			   unlikely(tuple_go_to_path(&tuple, path, path_len,
+						     multikey_idx) != 0)) {
 			return NULL;
+		}
 	}
 	return tuple;
 }
@@ -662,7 +727,7 @@ tuple_field_raw(struct tuple_format *format, const char *tuple,
 		const uint32_t *field_map, uint32_t field_no)
 {
 	return tuple_field_raw_by_path(format, tuple, field_map, field_no,
-				       NULL, 0, NULL, MULTIKEY_NONE);
+				       NULL, 0, NULL, 0, NULL, MULTIKEY_NONE);
 }
 
 /**
@@ -726,6 +791,8 @@ tuple_field_raw_by_part(struct tuple_format *format, const char *data,
 	}
 	return tuple_field_raw_by_path(format, data, field_map, part->fieldno,
 				       part->path, part->path_len,
+				       part->path_tokens,
+				       part->path_token_count,
 				       &part->offset_slot_cache, multikey_idx);
 }
 
@@ -1070,6 +1137,36 @@ tuple_ref(struct tuple *tuple)
 void
 tuple_unref_slow(struct tuple *tuple);
 
+/**
+ * Nesting depth of tuple pin epochs, see tuple_epoch_enter().
+ */
+extern uint32_t tuple_epoch_depth;
+
+/**
+ * Defer the free of a tuple whose reference counter dropped to
+ * zero inside an epoch. Takes one reference on behalf of the
+ * epoch, to be released when the outermost epoch is left.
+ */
+void
+tuple_epoch_defer(struct tuple *tuple);
+
+/**
+ * Enter a tuple pin epoch. While at least one epoch is active a
+ * tuple dropping its last reference is not freed in place: the
+ * free is deferred and the whole batch is released when the
+ * outermost epoch is left. Read paths (e.g. a select scan) use
+ * an epoch to keep tuple_delete() churn out of the iteration
+ * loop. Epochs nest and may span yields. They only batch frees
+ * and grant no extra liveness, so holders still take references
+ * as usual.
+ */
+void
+tuple_epoch_enter(void);
+
+/** Leave a tuple pin epoch, freeing the deferred batch. */
+void
+tuple_epoch_leave(void);
+
 /**
  * Decrement tuple reference counter. If it has reached zero, free the tuple.
  *
@@ -1081,8 +1178,12 @@ tuple_unref(struct tuple *tuple)
 	assert(tuple->refs - 1 >= 0);
 	if (unlikely(tuple->is_bigref))
 		tuple_unref_slow(tuple);
-	else if (--tuple->refs == 0)
-		tuple_delete(tuple);
+	else if (--tuple->refs == 0) {
+		if (unlikely(tuple_epoch_depth > 0))
+			tuple_epoch_defer(tuple);
+		else
+			tuple_delete(tuple);
+	}
 }
 
 extern struct tuple *box_tuple_last;
@@ -31,15 +31,22 @@
 #include "tuple_bloom.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <msgpuck.h>
 #include "diag.h"
 #include "errcode.h"
+#include "error.h"
 #include "key_def.h"
+#include "schema_def.h"
 #include "tuple.h"
 #include "salad/bloom.h"
 #include "trivia/util.h"
@@ -162,6 +169,8 @@ tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
 	}
 
 	bloom->is_legacy = false;
+	bloom->map = NULL;
+	bloom->map_size = 0;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
@@ -195,8 +204,13 @@ tuple_bloom_new(struct tuple_bloom_builder *builder, double fpr)
 void
 tuple_bloom_delete(struct tuple_bloom *bloom)
 {
-	for (uint32_t i = 0; i < bloom->part_count; i++)
-		bloom_destroy(&bloom->parts[i]);
+	if (bloom->map != NULL) {
+		/* The part tables point into the mapping. */
+		munmap(bloom->map, bloom->map_size);
+	} else {
+		for (uint32_t i = 0; i < bloom->part_count; i++)
+			bloom_destroy(&bloom->parts[i]);
+	}
 	free(bloom);
 }
 
@@ -216,13 +230,25 @@ tuple_bloom_maybe_has(const struct tuple_bloom *bloom, struct tuple *tuple,
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
-
+	uint32_t hashes[BOX_INDEX_PART_MAX];
+
+	/*
+	 * Compute the hashes of all key parts and prefetch the
+	 * bloom blocks they map to before probing any of them.
+	 * The filters are too large to stay in cache, so a probe
+	 * is usually a cache miss; prefetching up front overlaps
+	 * the misses of all parts instead of taking them one by
+	 * one.
+	 */
 	for (uint32_t i = 0; i < key_def->part_count; i++) {
 		total_size += tuple_hash_key_part(&h, &carry, tuple,
 						  &key_def->parts[i],
 						  multikey_idx);
-		uint32_t hash = PMurHash32_Result(h, carry, total_size);
-		if (!bloom_maybe_has(&bloom->parts[i], hash))
+		hashes[i] = PMurHash32_Result(h, carry, total_size);
+		bloom_prefetch(&bloom->parts[i], hashes[i]);
+	}
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		if (!bloom_maybe_has(&bloom->parts[i], hashes[i]))
 			return false;
 	}
 	return true;
@@ -246,12 +272,17 @@ tuple_bloom_maybe_has_key(const struct tuple_bloom *bloom,
 	uint32_t h = HASH_SEED;
 	uint32_t carry = 0;
 	uint32_t total_size = 0;
+	uint32_t hashes[BOX_INDEX_PART_MAX];
 
+	/* See the comment in tuple_bloom_maybe_has(). */
 	for (uint32_t i = 0; i < part_count; i++) {
 		total_size += tuple_hash_field(&h, &carry, &key,
 					       key_def->parts[i].coll);
-		uint32_t hash = PMurHash32_Result(h, carry, total_size);
-		if (!bloom_maybe_has(&bloom->parts[i], hash))
+		hashes[i] = PMurHash32_Result(h, carry, total_size);
+		bloom_prefetch(&bloom->parts[i], hashes[i]);
+	}
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (!bloom_maybe_has(&bloom->parts[i], hashes[i]))
 			return false;
 	}
 	return true;
@@ -331,6 +362,8 @@ tuple_bloom_decode(const char **data)
 	}
 
 	bloom->is_legacy = false;
+	bloom->map = NULL;
+	bloom->map_size = 0;
 	bloom->part_count = 0;
 
 	for (uint32_t i = 0; i < part_count; i++) {
@@ -355,6 +388,8 @@ tuple_bloom_decode_legacy(const char **data)
 	}
 
 	bloom->is_legacy = true;
+	bloom->map = NULL;
+	bloom->map_size = 0;
 	bloom->part_count = 1;
 
 	if (mp_decode_array(data) != 4)
@@ -376,3 +411,179 @@ tuple_bloom_decode_legacy(const char **data)
 	*data += store_size;
 	return bloom;
 }
+
+/** Magic at the beginning of a bloom filter file ("blom"). */
+enum { TUPLE_BLOOM_FILE_MAGIC = 0x6d6f6c62 };
+/** Version of the bloom filter file format. */
+enum { TUPLE_BLOOM_FILE_VERSION = 0 };
+/** Alignment of filter tables in a bloom filter file. */
+enum { TUPLE_BLOOM_FILE_ALIGN = 64 };
+
+/**
+ * A bloom filter file consists of a fixed header (magic and
+ * version), a MsgPack array of [table_size, hash_count] pairs,
+ * one per key part, and the raw filter tables. The tables are
+ * laid out in the key part order, each aligned to a cache line,
+ * so both the writer and the reader derive their offsets from
+ * the header alone.
+ */
+static size_t
+tuple_bloom_file_align(size_t offset)
+{
+	return (offset + TUPLE_BLOOM_FILE_ALIGN - 1) &
+	       ~((size_t)TUPLE_BLOOM_FILE_ALIGN - 1);
+}
+
+/** Calculate the size of a bloom filter file header. */
+static size_t
+tuple_bloom_file_header_size(const struct tuple_bloom *bloom)
+{
+	size_t size = 2 * sizeof(uint32_t);
+	size += mp_sizeof_array(bloom->part_count);
+	for (uint32_t i = 0; i < bloom->part_count; i++) {
+		size += mp_sizeof_array(2);
+		size += mp_sizeof_uint(bloom->parts[i].table_size);
+		size += mp_sizeof_uint(bloom->parts[i].hash_count);
+	}
+	return size;
+}
+
+int
+tuple_bloom_store_file(const struct tuple_bloom *bloom, const char *path)
+{
+	assert(!bloom->is_legacy);
+	size_t size = tuple_bloom_file_align(tuple_bloom_file_header_size(bloom));
+	for (uint32_t i = 0; i < bloom->part_count; i++)
+		size = tuple_bloom_file_align(size +
+				bloom_store_size(&bloom->parts[i]));
+	char *buf = calloc(1, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "tuple bloom file");
+		return -1;
+	}
+	uint32_t magic = TUPLE_BLOOM_FILE_MAGIC;
+	uint32_t version = TUPLE_BLOOM_FILE_VERSION;
+	memcpy(buf, &magic, sizeof(magic));
+	memcpy(buf + sizeof(magic), &version, sizeof(version));
+	char *pos = mp_encode_array(buf + 2 * sizeof(uint32_t),
+				    bloom->part_count);
+	for (uint32_t i = 0; i < bloom->part_count; i++) {
+		pos = mp_encode_array(pos, 2);
+		pos = mp_encode_uint(pos, bloom->parts[i].table_size);
+		pos = mp_encode_uint(pos, bloom->parts[i].hash_count);
+	}
+	size_t offset = tuple_bloom_file_align(pos - buf);
+	for (uint32_t i = 0; i < bloom->part_count; i++) {
+		bloom_store(&bloom->parts[i], buf + offset);
+		offset = tuple_bloom_file_align(offset +
+				bloom_store_size(&bloom->parts[i]));
+	}
+	assert(offset == size);
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to create file '%s'", path);
+		free(buf);
+		return -1;
+	}
+	size_t written = 0;
+	while (written < size) {
+		ssize_t rc = write(fd, buf + written, size - written);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			diag_set(SystemError, "failed to write file '%s'",
+				 path);
+			close(fd);
+			free(buf);
+			return -1;
+		}
+		written += rc;
+	}
+	free(buf);
+	if (fsync(fd) != 0) {
+		diag_set(SystemError, "failed to sync file '%s'", path);
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+struct tuple_bloom *
+tuple_bloom_map_file(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open file '%s'", path);
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		diag_set(SystemError, "failed to stat file '%s'", path);
+		close(fd);
+		return NULL;
+	}
+	size_t map_size = st.st_size;
+	char *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		diag_set(SystemError, "failed to map file '%s'", path);
+		return NULL;
+	}
+	/*
+	 * Ask the kernel to prefault the whole filter: bloom probes
+	 * touch a few random cache lines per lookup and would
+	 * otherwise populate the mapping one major fault at a time.
+	 * Best effort, the mapping works without it.
+	 */
+	(void)madvise(map, map_size, MADV_WILLNEED);
+	uint32_t magic, version;
+	if (map_size < 2 * sizeof(uint32_t))
+		goto invalid;
+	memcpy(&magic, map, sizeof(magic));
+	memcpy(&version, map + sizeof(magic), sizeof(version));
+	if (magic != TUPLE_BLOOM_FILE_MAGIC ||
+	    version != TUPLE_BLOOM_FILE_VERSION)
+		goto invalid;
+	const char *pos = map + 2 * sizeof(uint32_t);
+	if (mp_check(&pos, map + map_size) != 0)
+		goto invalid;
+	pos = map + 2 * sizeof(uint32_t);
+	uint32_t part_count = mp_decode_array(&pos);
+	struct tuple_bloom *bloom = malloc(sizeof(*bloom) +
+			part_count * sizeof(*bloom->parts));
+	if (bloom == NULL) {
+		diag_set(OutOfMemory, sizeof(*bloom) +
+			 part_count * sizeof(*bloom->parts),
+			 "malloc", "tuple bloom");
+		munmap(map, map_size);
+		return NULL;
+	}
+	bloom->is_legacy = false;
+	bloom->map = map;
+	bloom->map_size = map_size;
+	bloom->part_count = part_count;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (mp_decode_array(&pos) != 2)
+			goto invalid_free;
+		bloom->parts[i].table_size = mp_decode_uint(&pos);
+		bloom->parts[i].hash_count = mp_decode_uint(&pos);
+	}
+	size_t offset = tuple_bloom_file_align(pos - map);
+	for (uint32_t i = 0; i < part_count; i++) {
+		size_t store_size = bloom_store_size(&bloom->parts[i]);
+		if (offset + store_size > map_size)
+			goto invalid_free;
+		bloom->parts[i].table = (struct bloom_block *)(map + offset);
+		offset = tuple_bloom_file_align(offset + store_size);
+	}
+	return bloom;
+
+invalid_free:
+	free(bloom);
+invalid:
+	munmap(map, map_size);
+	diag_set(ClientError, ER_INVALID_INDEX_FILE, path,
+		 "Invalid bloom filter file");
+	return NULL;
+}
@@ -58,6 +58,14 @@ struct tuple_bloom {
 	 * (see tuple_bloom_decode_legacy).
 	 */
 	bool is_legacy;
+	/**
+	 * If not NULL, the filter tables point into this read-only
+	 * file mapping instead of heap memory, see
+	 * tuple_bloom_map_file().
+	 */
+	char *map;
+	/** Size of the mapping, for munmap(). */
+	size_t map_size;
 	/** Number of key parts. */
 	uint32_t part_count;
 	/** Array of bloom filters, one per each partial key. */
@@ -232,6 +240,29 @@ tuple_bloom_decode(const char **data);
 struct tuple_bloom *
 tuple_bloom_decode_legacy(const char **data);
 
+/**
+ * Write a tuple bloom filter to a file that can later be mapped
+ * with tuple_bloom_map_file(). The filter tables are stored raw
+ * and cache line aligned so that the mapping can be used for
+ * lookups directly, without copying the tables to memory.
+ * @param bloom - bloom filter to store
+ * @param path - path to the file
+ * @return 0 on success, -1 on IO error
+ */
+int
+tuple_bloom_store_file(const struct tuple_bloom *bloom, const char *path);
+
+/**
+ * Map a file created with tuple_bloom_store_file(). The returned
+ * filter is backed by a read-only mapping of the file, so its RAM
+ * is reclaimable by the kernel, and is freed with the mapping by
+ * tuple_bloom_delete().
+ * @param path - path to the file
+ * @return the mapped bloom on success or NULL on error
+ */
+struct tuple_bloom *
+tuple_bloom_map_file(const char *path);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
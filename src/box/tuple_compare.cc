@@ -36,6 +36,7 @@
 #include "lib/core/decimal.h"
 #include "lib/core/mp_decimal.h"
 #include "lib/core/mp_extension_types.h"
+#include "lib/uuid/mp_uuid.h"
 
 /* {{{ tuple_compare */
 
@@ -74,6 +75,7 @@ enum mp_class {
 	MP_CLASS_NUMBER,
 	MP_CLASS_STR,
 	MP_CLASS_BIN,
+	MP_CLASS_UUID,
 	MP_CLASS_ARRAY,
 	MP_CLASS_MAP,
 	mp_class_max,
@@ -96,6 +98,7 @@ static enum mp_class mp_classes[] = {
 static enum mp_class mp_ext_classes[] = {
 	/* .MP_UNKNOWN_EXTENSION = */ mp_class_max, /* unsupported */
 	/* .MP_DECIMAL		 = */ MP_CLASS_NUMBER,
+	/* .MP_UUID		 = */ MP_CLASS_UUID,
 };
 
 static enum mp_class
@@ -378,6 +381,32 @@ mp_compare_bin(const char *field_a, const char *field_b)
 	return COMPARE_RESULT(size_a, size_b);
 }
 
+static inline int
+mp_compare_uuid(const char *field_a, const char *field_b)
+{
+	int8_t type_a, type_b;
+	uint32_t len_a = mp_decode_extl(&field_a, &type_a);
+	uint32_t len_b = mp_decode_extl(&field_b, &type_b);
+	assert(type_a == MP_UUID && len_a == UUID_PACKED_LEN);
+	assert(type_b == MP_UUID && len_b == UUID_PACKED_LEN);
+	(void)type_a;
+	(void)type_b;
+	(void)len_a;
+	(void)len_b;
+	/*
+	 * The payload is the RFC 4122 big-endian byte string, so
+	 * comparing two byte-swapped 64-bit words gives the same
+	 * order as tt_uuid_compare() without unpacking the struct.
+	 */
+	uint64_t a = bswap_u64(load_u64(field_a));
+	uint64_t b = bswap_u64(load_u64(field_b));
+	if (a != b)
+		return a < b ? -1 : 1;
+	a = bswap_u64(load_u64(field_a + 8));
+	b = bswap_u64(load_u64(field_b + 8));
+	return COMPARE_RESULT(a, b);
+}
+
 typedef int (*mp_compare_f)(const char *, const char *);
 static mp_compare_f mp_class_comparators[] = {
 	/* .MP_CLASS_NIL    = */ NULL,
@@ -385,6 +414,7 @@ static mp_compare_f mp_class_comparators[] = {
 	/* .MP_CLASS_NUMBER = */ mp_compare_number,
 	/* .MP_CLASS_STR    = */ mp_compare_str,
 	/* .MP_CLASS_BIN    = */ mp_compare_bin,
+	/* .MP_CLASS_UUID   = */ mp_compare_uuid,
 	/* .MP_CLASS_ARRAY  = */ NULL,
 	/* .MP_CLASS_MAP    = */ NULL,
 };
@@ -463,6 +493,8 @@ tuple_compare_field(const char *field_a, const char *field_b,
 		       mp_compare_scalar(field_a, field_b);
 	case FIELD_TYPE_DECIMAL:
 		return mp_compare_decimal(field_a, field_b);
+	case FIELD_TYPE_UUID:
+		return mp_compare_uuid(field_a, field_b);
 	default:
 		unreachable();
 		return 0;
@@ -501,12 +533,99 @@ tuple_compare_field_with_type(const char *field_a, enum mp_type a_type,
 	case FIELD_TYPE_DECIMAL:
 		return mp_compare_number_with_type(field_a, a_type,
 						   field_b, b_type);
+	case FIELD_TYPE_UUID:
+		return mp_compare_uuid(field_a, field_b);
 	default:
 		unreachable();
 		return 0;
 	}
 }
 
+/**
+ * Instantiations of tuple_compare_field() with the field type
+ * (and collation presence) fixed at compile time, so the type
+ * switch is folded away and each part of a key_def gets a flat
+ * comparator resolved once in key_def_set_compare_func().
+ */
+template<enum field_type type, bool has_coll>
+static int
+key_part_compare_fields(const char *field_a, const char *field_b,
+			struct coll *coll)
+{
+	return tuple_compare_field(field_a, field_b, type,
+				   has_coll ? coll : NULL);
+}
+
+template<enum field_type type, bool has_coll>
+static int
+key_part_compare_fields_with_type(const char *field_a, enum mp_type a_type,
+				  const char *field_b, enum mp_type b_type,
+				  struct coll *coll)
+{
+	return tuple_compare_field_with_type(field_a, a_type, field_b, b_type,
+					     type, has_coll ? coll : NULL);
+}
+
+template<enum field_type type>
+static void
+key_part_set_compare_func(struct key_part *part)
+{
+	if (part->coll != NULL) {
+		part->field_cmp = key_part_compare_fields<type, true>;
+		part->field_cmp_with_type =
+			key_part_compare_fields_with_type<type, true>;
+	} else {
+		part->field_cmp = key_part_compare_fields<type, false>;
+		part->field_cmp_with_type =
+			key_part_compare_fields_with_type<type, false>;
+	}
+}
+
+static void
+key_def_set_field_compare_func(struct key_def *def)
+{
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		struct key_part *part = &def->parts[i];
+		switch (part->type) {
+		case FIELD_TYPE_UNSIGNED:
+			key_part_set_compare_func<FIELD_TYPE_UNSIGNED>(part);
+			break;
+		case FIELD_TYPE_STRING:
+			key_part_set_compare_func<FIELD_TYPE_STRING>(part);
+			break;
+		case FIELD_TYPE_INTEGER:
+			key_part_set_compare_func<FIELD_TYPE_INTEGER>(part);
+			break;
+		case FIELD_TYPE_NUMBER:
+			key_part_set_compare_func<FIELD_TYPE_NUMBER>(part);
+			break;
+		case FIELD_TYPE_DOUBLE:
+			key_part_set_compare_func<FIELD_TYPE_DOUBLE>(part);
+			break;
+		case FIELD_TYPE_BOOLEAN:
+			key_part_set_compare_func<FIELD_TYPE_BOOLEAN>(part);
+			break;
+		case FIELD_TYPE_VARBINARY:
+			key_part_set_compare_func<FIELD_TYPE_VARBINARY>(part);
+			break;
+		case FIELD_TYPE_SCALAR:
+			key_part_set_compare_func<FIELD_TYPE_SCALAR>(part);
+			break;
+		case FIELD_TYPE_DECIMAL:
+			key_part_set_compare_func<FIELD_TYPE_DECIMAL>(part);
+			break;
+		case FIELD_TYPE_UUID:
+			key_part_set_compare_func<FIELD_TYPE_UUID>(part);
+			break;
+		default:
+			/* Invalid key definition. */
+			part->field_cmp = NULL;
+			part->field_cmp_with_type = NULL;
+			break;
+		}
+	}
+}
+
 template<bool is_nullable, bool has_optional_parts, bool has_json_paths,
 	 bool is_multikey>
 static inline int
@@ -537,8 +656,8 @@ tuple_compare_slowpath(struct tuple *tuple_a, hint_t tuple_a_hint,
 		mp_decode_array(&tuple_a_raw);
 		mp_decode_array(&tuple_b_raw);
 		if (! is_nullable) {
-			return tuple_compare_field(tuple_a_raw, tuple_b_raw,
-						   part->type, part->coll);
+			return part->field_cmp(tuple_a_raw, tuple_b_raw,
+					       part->coll);
 		}
 		enum mp_type a_type = mp_typeof(*tuple_a_raw);
 		enum mp_type b_type = mp_typeof(*tuple_b_raw);
@@ -546,9 +665,9 @@ tuple_compare_slowpath(struct tuple *tuple_a, hint_t tuple_a_hint,
 			return b_type == MP_NIL ? 0 : -1;
 		else if (b_type == MP_NIL)
 			return 1;
-		return tuple_compare_field_with_type(tuple_a_raw,  a_type,
-						     tuple_b_raw, b_type,
-						     part->type, part->coll);
+		return part->field_cmp_with_type(tuple_a_raw, a_type,
+						 tuple_b_raw, b_type,
+						 part->coll);
 	}
 
 	bool was_null_met = false;
@@ -588,8 +707,7 @@ tuple_compare_slowpath(struct tuple *tuple_a, hint_t tuple_a_hint,
 		assert(has_optional_parts ||
 		       (field_a != NULL && field_b != NULL));
 		if (! is_nullable) {
-			rc = tuple_compare_field(field_a, field_b, part->type,
-						 part->coll);
+			rc = part->field_cmp(field_a, field_b, part->coll);
 			if (rc != 0)
 				return rc;
 			else
@@ -609,10 +727,9 @@ tuple_compare_slowpath(struct tuple *tuple_a, hint_t tuple_a_hint,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			rc = tuple_compare_field_with_type(field_a, a_type,
-							   field_b, b_type,
-							   part->type,
-							   part->coll);
+			rc = part->field_cmp_with_type(field_a, a_type,
+						       field_b, b_type,
+						       part->coll);
 			if (rc != 0)
 				return rc;
 		}
@@ -656,8 +773,7 @@ tuple_compare_slowpath(struct tuple *tuple_a, hint_t tuple_a_hint,
 		 * be absent or be NULLs.
 		 */
 		assert(field_a != NULL && field_b != NULL);
-		rc = tuple_compare_field(field_a, field_b, part->type,
-					 part->coll);
+		rc = part->field_cmp(field_a, field_b, part->coll);
 		if (rc != 0)
 			return rc;
 	}
@@ -703,8 +819,7 @@ tuple_compare_with_key_slowpath(struct tuple *tuple, hint_t tuple_hint,
 						part->fieldno);
 		}
 		if (! is_nullable) {
-			return tuple_compare_field(field, key, part->type,
-						   part->coll);
+			return part->field_cmp(field, key, part->coll);
 		}
 		if (has_optional_parts)
 			a_type = field != NULL ? mp_typeof(*field) : MP_NIL;
@@ -716,9 +831,8 @@ tuple_compare_with_key_slowpath(struct tuple *tuple, hint_t tuple_hint,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			return tuple_compare_field_with_type(field, a_type, key,
-							     b_type, part->type,
-							     part->coll);
+			return part->field_cmp_with_type(field, a_type, key,
+							 b_type, part->coll);
 		}
 	}
 
@@ -738,8 +852,7 @@ tuple_compare_with_key_slowpath(struct tuple *tuple, hint_t tuple_hint,
 						part->fieldno);
 		}
 		if (! is_nullable) {
-			rc = tuple_compare_field(field, key, part->type,
-						 part->coll);
+			rc = part->field_cmp(field, key, part->coll);
 			if (rc != 0)
 				return rc;
 			else
@@ -756,9 +869,8 @@ tuple_compare_with_key_slowpath(struct tuple *tuple, hint_t tuple_hint,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			rc = tuple_compare_field_with_type(field, a_type, key,
-							   b_type, part->type,
-							   part->coll);
+			rc = part->field_cmp_with_type(field, a_type, key,
+						       b_type, part->coll);
 			if (rc != 0)
 				return rc;
 		}
@@ -776,8 +888,7 @@ key_compare_parts(const char *key_a, const char *key_b, uint32_t part_count,
 	struct key_part *part = key_def->parts;
 	if (likely(part_count == 1)) {
 		if (! is_nullable) {
-			return tuple_compare_field(key_a, key_b, part->type,
-						   part->coll);
+			return part->field_cmp(key_a, key_b, part->coll);
 		}
 		enum mp_type a_type = mp_typeof(*key_a);
 		enum mp_type b_type = mp_typeof(*key_b);
@@ -786,10 +897,9 @@ key_compare_parts(const char *key_a, const char *key_b, uint32_t part_count,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			return tuple_compare_field_with_type(key_a, a_type,
-							     key_b, b_type,
-							     part->type,
-							     part->coll);
+			return part->field_cmp_with_type(key_a, a_type,
+							 key_b, b_type,
+							 part->coll);
 		}
 	}
 
@@ -797,8 +907,7 @@ key_compare_parts(const char *key_a, const char *key_b, uint32_t part_count,
 	int rc;
 	for (; part < end; ++part, mp_next(&key_a), mp_next(&key_b)) {
 		if (! is_nullable) {
-			rc = tuple_compare_field(key_a, key_b, part->type,
-						 part->coll);
+			rc = part->field_cmp(key_a, key_b, part->coll);
 			if (rc != 0)
 				return rc;
 			else
@@ -812,9 +921,8 @@ key_compare_parts(const char *key_a, const char *key_b, uint32_t part_count,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			rc = tuple_compare_field_with_type(key_a, a_type, key_b,
-							   b_type, part->type,
-							   part->coll);
+			rc = part->field_cmp_with_type(key_a, a_type, key_b,
+						       b_type, part->coll);
 			if (rc != 0)
 				return rc;
 		}
@@ -932,9 +1040,8 @@ tuple_compare_sequential(struct tuple *tuple_a, hint_t tuple_a_hint,
 		} else if (b_type == MP_NIL) {
 			return 1;
 		} else {
-			rc = tuple_compare_field_with_type(key_a, a_type, key_b,
-							   b_type, part->type,
-							   part->coll);
+			rc = part->field_cmp_with_type(key_a, a_type, key_b,
+						       b_type, part->coll);
 			if (rc != 0)
 				return rc;
 		}
@@ -953,8 +1060,7 @@ tuple_compare_sequential(struct tuple *tuple_a, hint_t tuple_a_hint,
 		 * not be absent or be null.
 		 */
 		assert(i < fc_a && i < fc_b);
-		rc = tuple_compare_field(key_a, key_b, part->type,
-					 part->coll);
+		rc = part->field_cmp(key_a, key_b, part->coll);
 		if (rc != 0)
 			return rc;
 	}
@@ -985,6 +1091,13 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_UUID>(const char **field_a, const char **field_b)
+{
+	return mp_compare_uuid(*field_a, *field_b);
+}
+
 template <int TYPE>
 static inline int
 field_compare_and_next(const char **field_a, const char **field_b);
@@ -1016,6 +1129,92 @@ field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+/**
+ * A flag OR-ed into the field type in a precompiled comparator
+ * signature to instantiate a nullable variant of the comparator:
+ * nil compares less than any value and equal to another nil, in
+ * which case the comparison continues with the next part, same
+ * as in the generic slowpath comparators.
+ */
+enum { COMPARE_TYPE_NULLABLE = 0x8000 };
+
+/**
+ * Compare the nil prefixes of two nullable fields. Returns true
+ * and sets @a r if at least one of the fields is nil and hence
+ * the field values themselves need not be compared.
+ */
+static inline bool
+field_compare_nils(const char *field_a, const char *field_b, int *r)
+{
+	bool a_nil = mp_typeof(*field_a) == MP_NIL;
+	bool b_nil = mp_typeof(*field_b) == MP_NIL;
+	if (!a_nil && !b_nil)
+		return false;
+	*r = (int)b_nil - (int)a_nil;
+	return true;
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r))
+		return r;
+	return field_compare<FIELD_TYPE_UNSIGNED>(field_a, field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r))
+		return r;
+	return field_compare<FIELD_TYPE_STRING>(field_a, field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_UUID | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r))
+		return r;
+	return field_compare<FIELD_TYPE_UUID>(field_a, field_b);
+}
+
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_and_next<FIELD_TYPE_UNSIGNED>(field_a, field_b);
+}
+
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_and_next<FIELD_TYPE_STRING>(field_a, field_b);
+}
+
 /* Tuple comparator */
 namespace /* local symbols */ {
 
@@ -1130,6 +1329,7 @@ struct comparator_signature {
 static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UUID)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
@@ -1142,6 +1342,70 @@ static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	/*
+	 * Nullable variants for the common case of a nullable
+	 * leading part, e.g. a unique secondary index on a
+	 * nullable field extended with primary key parts.
+	 */
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE)
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE)
+	COMPARATOR(0, FIELD_TYPE_UUID | COMPARE_TYPE_NULLABLE)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  )
+	COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  )
 };
 
 #undef COMPARATOR
@@ -1204,6 +1468,58 @@ field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE>(
+	const char **field, const char **key)
+{
+	int r;
+	if (field_compare_nils(*field, *key, &r))
+		return r;
+	return field_compare_with_key<FIELD_TYPE_UNSIGNED>(field, key);
+}
+
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE>(
+	const char **field, const char **key)
+{
+	int r;
+	if (field_compare_nils(*field, *key, &r))
+		return r;
+	return field_compare_with_key<FIELD_TYPE_STRING>(field, key);
+}
+
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_with_key_and_next<FIELD_TYPE_UNSIGNED>(field_a,
+								    field_b);
+}
+
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE>(
+	const char **field_a, const char **field_b)
+{
+	int r;
+	if (field_compare_nils(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_with_key_and_next<FIELD_TYPE_STRING>(field_a,
+								  field_b);
+}
+
 /* Tuple with key comparator */
 namespace /* local symbols */ {
 
@@ -1322,6 +1638,65 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING  )
+	/* Nullable leading part, see cmp_arr. */
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE,
+		   1, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_UNSIGNED,
+		   2, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  )
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING | COMPARE_TYPE_NULLABLE, 1, FIELD_TYPE_STRING  ,
+		   2, FIELD_TYPE_STRING  )
 
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
@@ -1381,8 +1756,7 @@ func_index_compare(struct tuple *tuple_a, hint_t tuple_a_hint,
 						  field_map_b, part,
 						  MULTIKEY_NONE);
 		assert(field_a != NULL && field_b != NULL);
-		rc = tuple_compare_field(field_a, field_b, part->type,
-					 part->coll);
+		rc = part->field_cmp(field_a, field_b, part->coll);
 		if (rc != 0)
 			return rc;
 		else
@@ -1614,6 +1988,18 @@ hint_bin(const char *s, uint32_t len)
 	return hint_create(MP_CLASS_BIN, val);
 }
 
+static inline hint_t
+hint_uuid_raw(const char *data)
+{
+	/*
+	 * The UUID payload is a fixed-length big-endian byte
+	 * string, so the leading bytes order it just like a
+	 * binary field.
+	 */
+	uint64_t val = hint_str_raw(data, UUID_PACKED_LEN);
+	return hint_create(MP_CLASS_UUID, val);
+}
+
 static inline hint_t
 field_hint_boolean(const char *field)
 {
@@ -1698,6 +2084,18 @@ field_hint_decimal(const char *field)
 	}
 }
 
+static inline hint_t
+field_hint_uuid(const char *field)
+{
+	assert(mp_typeof(*field) == MP_EXT);
+	int8_t ext_type;
+	uint32_t len = mp_decode_extl(&field, &ext_type);
+	assert(ext_type == MP_UUID && len == UUID_PACKED_LEN);
+	(void)ext_type;
+	(void)len;
+	return hint_uuid_raw(field);
+}
+
 static inline hint_t
 field_hint_string(const char *field, struct coll *coll)
 {
@@ -1782,6 +2180,8 @@ field_hint(const char *field, struct coll *coll)
 		return field_hint_scalar(field, coll);
 	case FIELD_TYPE_DECIMAL:
 		return field_hint_decimal(field);
+	case FIELD_TYPE_UUID:
+		return field_hint_uuid(field);
 	default:
 		unreachable();
 	}
@@ -1893,6 +2293,9 @@ key_def_set_hint_func(struct key_def *def)
 	case FIELD_TYPE_DECIMAL:
 		key_def_set_hint_func<FIELD_TYPE_DECIMAL>(def);
 		break;
+	case FIELD_TYPE_UUID:
+		key_def_set_hint_func<FIELD_TYPE_UUID>(def);
+		break;
 	default:
 		/* Invalid key definition. */
 		def->key_hint = NULL;
@@ -1903,10 +2306,21 @@ key_def_set_hint_func(struct key_def *def)
 
 /* }}} tuple_hint */
 
+/**
+ * Type signature of a key part in the precompiled comparator
+ * tables: the field type with COMPARE_TYPE_NULLABLE OR-ed in
+ * for nullable parts.
+ */
+static inline uint32_t
+key_part_compare_type(const struct key_part *part)
+{
+	return part->type |
+	       (part->is_nullable ? (uint32_t)COMPARE_TYPE_NULLABLE : 0);
+}
+
 static void
 key_def_set_compare_func_fast(struct key_def *def)
 {
-	assert(!def->is_nullable);
 	assert(!def->has_optional_parts);
 	assert(!def->has_json_paths);
 	assert(!key_def_has_collation(def));
@@ -1923,7 +2337,8 @@ key_def_set_compare_func_fast(struct key_def *def)
 		uint32_t i = 0;
 		for (; i < def->part_count; i++)
 			if (def->parts[i].fieldno != cmp_arr[k].p[i * 2] ||
-			    def->parts[i].type != cmp_arr[k].p[i * 2 + 1])
+			    key_part_compare_type(&def->parts[i]) !=
+			    cmp_arr[k].p[i * 2 + 1])
 				break;
 		if (i == def->part_count && cmp_arr[k].p[i * 2] == UINT32_MAX) {
 			cmp = cmp_arr[k].f;
@@ -1934,7 +2349,8 @@ key_def_set_compare_func_fast(struct key_def *def)
 		uint32_t i = 0;
 		for (; i < def->part_count; i++) {
 			if (def->parts[i].fieldno != cmp_wk_arr[k].p[i * 2] ||
-			    def->parts[i].type != cmp_wk_arr[k].p[i * 2 + 1])
+			    key_part_compare_type(&def->parts[i]) !=
+			    cmp_wk_arr[k].p[i * 2 + 1])
 				break;
 		}
 		if (i == def->part_count) {
@@ -1943,15 +2359,31 @@ key_def_set_compare_func_fast(struct key_def *def)
 		}
 	}
 	if (cmp == NULL) {
-		cmp = is_sequential ?
-			tuple_compare_sequential<false, false> :
-			tuple_compare_slowpath<false, false, false, false>;
+		if (def->is_nullable) {
+			cmp = is_sequential ?
+				tuple_compare_sequential<true, false> :
+				tuple_compare_slowpath<true, false,
+						       false, false>;
+		} else {
+			cmp = is_sequential ?
+				tuple_compare_sequential<false, false> :
+				tuple_compare_slowpath<false, false,
+						       false, false>;
+		}
 	}
 	if (cmp_wk == NULL) {
-		cmp_wk = is_sequential ?
-			tuple_compare_with_key_sequential<false, false> :
-			tuple_compare_with_key_slowpath<false, false,
-							false, false>;
+		if (def->is_nullable) {
+			cmp_wk = is_sequential ?
+				tuple_compare_with_key_sequential<true, false> :
+				tuple_compare_with_key_slowpath<true, false,
+								false, false>;
+		} else {
+			cmp_wk = is_sequential ?
+				tuple_compare_with_key_sequential<false,
+								  false> :
+				tuple_compare_with_key_slowpath<false, false,
+								false, false>;
+		}
 	}
 
 	def->tuple_compare = cmp;
@@ -2006,13 +2438,19 @@ key_def_set_compare_func_for_func_index(struct key_def *def)
 void
 key_def_set_compare_func(struct key_def *def)
 {
+	key_def_set_field_compare_func(def);
 	if (def->for_func_index) {
 		if (def->is_nullable)
 			key_def_set_compare_func_for_func_index<true>(def);
 		else
 			key_def_set_compare_func_for_func_index<false>(def);
 	} else if (!key_def_has_collation(def) &&
-	    !def->is_nullable && !def->has_json_paths) {
+	    !def->has_optional_parts && !def->has_json_paths) {
+		/*
+		 * Nullable defs are accepted too: the precompiled
+		 * tables have nullable comparator variants, as
+		 * long as all the parts are present in the tuple.
+		 */
 		key_def_set_compare_func_fast(def);
 	} else if (!def->has_json_paths) {
 		if (def->is_nullable && def->has_optional_parts) {
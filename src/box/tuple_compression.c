@@ -0,0 +1,256 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_compression.h"
+
+#include <string.h>
+#include <zstd.h>
+
+#include "assoc.h"
+#include "fiber.h"
+#include "small/rlist.h"
+#include "say.h"
+#include "tuple.h"
+#include "tuple_value_dict.h"
+
+enum {
+	/** Zstd compression level, same as used for xlogs. */
+	TUPLE_COMPRESSION_LEVEL = 3,
+	/**
+	 * Total decompressed bytes a thread keeps cached. The
+	 * cache only has to absorb the working set of the
+	 * currently running requests, not the whole space.
+	 */
+	TUPLE_COMPRESSION_CACHE_MAX = 16 * 1024 * 1024,
+	/**
+	 * Never evict this many most recently used entries, no
+	 * matter how big they are: callers may hold pointers to
+	 * a few tuples at once, e.g. comparators look at two.
+	 */
+	TUPLE_COMPRESSION_CACHE_RETAIN = 8,
+};
+
+/** A decompressed copy of one tuple's MessagePack data. */
+struct tuple_cache_entry {
+	/** The compressed tuple, key of the cache hash. */
+	struct tuple *tuple;
+	/** Decompressed data, tuple->bsize bytes. */
+	char *data;
+	/** Decompressed size, for accounting. */
+	uint32_t size;
+	/** Link in the LRU list, newest first. */
+	struct rlist in_lru;
+};
+
+/*
+ * The cache is thread-local: the tx thread and the snapshot
+ * writer threads each get their own, so no locking is needed and
+ * eviction in one thread cannot dangle a pointer handed out by
+ * another.
+ */
+static __thread struct mh_i64ptr_t *cache_hash;
+static __thread struct rlist cache_lru;
+static __thread size_t cache_used;
+static __thread uint32_t cache_count;
+
+/** Reusable zstd contexts, creating one per call is expensive. */
+static __thread ZSTD_CCtx *cache_cctx;
+static __thread ZSTD_DCtx *cache_dctx;
+
+char *
+tuple_compress(const char *data, uint32_t size, uint32_t *comp_size)
+{
+	if (cache_cctx == NULL) {
+		cache_cctx = ZSTD_createCCtx();
+		if (cache_cctx == NULL)
+			return NULL;
+	}
+	size_t bound = ZSTD_compressBound(size);
+	char *dst = region_alloc(&fiber()->gc, bound);
+	if (dst == NULL)
+		return NULL;
+	size_t rc = ZSTD_compressCCtx(cache_cctx, dst, bound, data, size,
+				      TUPLE_COMPRESSION_LEVEL);
+	/*
+	 * Incompressible data is stored raw - a tuple that does
+	 * not shrink by at least the size header is not worth
+	 * the decompression cost on access.
+	 */
+	if (ZSTD_isError(rc) || rc + sizeof(uint32_t) >= size)
+		return NULL;
+	*comp_size = rc;
+	return dst;
+}
+
+/** Drop the oldest entries until the cache fits its budget. */
+static void
+tuple_compress_cache_trim(void)
+{
+	while (cache_used > TUPLE_COMPRESSION_CACHE_MAX &&
+	       cache_count > TUPLE_COMPRESSION_CACHE_RETAIN) {
+		struct tuple_cache_entry *entry =
+			rlist_last_entry(&cache_lru, struct tuple_cache_entry,
+					 in_lru);
+		mh_int_t k = mh_i64ptr_find(cache_hash,
+					    (uint64_t)(uintptr_t)entry->tuple,
+					    NULL);
+		assert(k != mh_end(cache_hash));
+		mh_i64ptr_del(cache_hash, k, NULL);
+		rlist_del_entry(entry, in_lru);
+		cache_used -= entry->size;
+		cache_count--;
+		free(entry->data);
+		free(entry);
+	}
+}
+
+const char *
+tuple_decompress(struct tuple *tuple)
+{
+	assert(tuple->is_compressed);
+	if (cache_hash == NULL) {
+		cache_hash = mh_i64ptr_new();
+		if (cache_hash == NULL)
+			panic("failed to allocate tuple decompression cache");
+		rlist_create(&cache_lru);
+		cache_used = 0;
+		cache_count = 0;
+	}
+	uint64_t key = (uint64_t)(uintptr_t)tuple;
+	mh_int_t k = mh_i64ptr_find(cache_hash, key, NULL);
+	if (k != mh_end(cache_hash)) {
+		struct tuple_cache_entry *entry =
+			mh_i64ptr_node(cache_hash, k)->val;
+		rlist_del_entry(entry, in_lru);
+		rlist_add_entry(&cache_lru, entry, in_lru);
+		return entry->data;
+	}
+	if (cache_dctx == NULL) {
+		cache_dctx = ZSTD_createDCtx();
+		if (cache_dctx == NULL)
+			panic("failed to allocate tuple decompression context");
+	}
+	const char *raw = (const char *)tuple + tuple->data_offset;
+	uint32_t header;
+	memcpy(&header, raw, sizeof(header));
+	const char *payload = raw + sizeof(header);
+	uint32_t payload_size = header >> TUPLE_BODY_FLAG_BITS;
+	struct tuple_cache_entry *entry = malloc(sizeof(*entry));
+	char *data = malloc(tuple->bsize);
+	if (entry == NULL || data == NULL)
+		panic("out of memory decompressing a tuple");
+	if ((header & TUPLE_BODY_ZSTD) != 0) {
+		/*
+		 * A dictionary-coded payload is first restored to
+		 * the coded stream, which is never longer than the
+		 * original data, and expanded from there.
+		 */
+		char *dst = data;
+		if ((header & TUPLE_BODY_DICT) != 0) {
+			dst = malloc(tuple->bsize);
+			if (dst == NULL)
+				panic("out of memory decompressing a tuple");
+		}
+		size_t rc = ZSTD_decompressDCtx(cache_dctx, dst, tuple->bsize,
+						payload, payload_size);
+		if (ZSTD_isError(rc) ||
+		    ((header & TUPLE_BODY_DICT) == 0 && rc != tuple->bsize))
+			panic("failed to decompress tuple data: %s",
+			      ZSTD_isError(rc) ? ZSTD_getErrorName(rc) :
+			      "size mismatch");
+		if (dst != data) {
+			payload = dst;
+			payload_size = rc;
+		}
+	}
+	if ((header & TUPLE_BODY_DICT) != 0) {
+		struct tuple_format *format =
+			tuple_format_by_id(tuple->format_id);
+		assert(format != NULL && format->value_dict != NULL);
+		tuple_value_dict_decode(format->value_dict, payload,
+					payload_size, data, tuple->bsize);
+		if (payload != raw + sizeof(header))
+			free((char *)payload);
+	}
+	entry->tuple = tuple;
+	entry->data = data;
+	entry->size = tuple->bsize;
+	struct mh_i64ptr_node_t node = { key, entry };
+	if (mh_i64ptr_put(cache_hash, &node, NULL, NULL) ==
+	    mh_end(cache_hash))
+		panic("failed to allocate tuple decompression cache");
+	rlist_add_entry(&cache_lru, entry, in_lru);
+	cache_used += entry->size;
+	cache_count++;
+	tuple_compress_cache_trim();
+	return entry->data;
+}
+
+void
+tuple_compress_cache_evict(struct tuple *tuple)
+{
+	if (cache_hash == NULL)
+		return;
+	mh_int_t k = mh_i64ptr_find(cache_hash, (uint64_t)(uintptr_t)tuple,
+				    NULL);
+	if (k == mh_end(cache_hash))
+		return;
+	struct tuple_cache_entry *entry = mh_i64ptr_node(cache_hash, k)->val;
+	mh_i64ptr_del(cache_hash, k, NULL);
+	rlist_del_entry(entry, in_lru);
+	cache_used -= entry->size;
+	cache_count--;
+	free(entry->data);
+	free(entry);
+}
+
+void
+tuple_compress_cache_free(void)
+{
+	if (cache_hash == NULL)
+		return;
+	struct tuple_cache_entry *entry, *tmp;
+	rlist_foreach_entry_safe(entry, &cache_lru, in_lru, tmp) {
+		free(entry->data);
+		free(entry);
+	}
+	mh_i64ptr_delete(cache_hash);
+	cache_hash = NULL;
+	cache_used = 0;
+	cache_count = 0;
+	if (cache_dctx != NULL) {
+		ZSTD_freeDCtx(cache_dctx);
+		cache_dctx = NULL;
+	}
+	if (cache_cctx != NULL) {
+		ZSTD_freeCCtx(cache_cctx);
+		cache_cctx = NULL;
+	}
+}
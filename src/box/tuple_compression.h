@@ -0,0 +1,133 @@
+#ifndef TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+#define TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct tuple;
+
+/**
+ * Compression of tuple bodies at rest.
+ *
+ * A space created with the `compression' option stores tuple
+ * MessagePack data zstd-compressed inside the tuple allocation:
+ * instead of the raw fields, the bytes following the field map
+ * are a 4-byte compressed size header and the compressed stream,
+ * and tuple->is_compressed is set. tuple->bsize still holds the
+ * decompressed length, so every consumer of tuple_data_range()
+ * sees the usual contract. Accessors decompress transparently
+ * into a small per-thread cache of hot tuples, trading CPU for
+ * the resident set: the indexes, the field maps and the tuple
+ * headers stay uncompressed, only the MessagePack body shrinks.
+ *
+ * The cache is thread-local, so no locking is needed: memtx
+ * tuples are read by the tx thread and, during a checkpoint, by
+ * the snapshot threads, which see a frozen read view and free
+ * their caches before exiting. A returned data pointer stays
+ * valid at least until the caller decompresses several other
+ * tuples, which covers comparators looking at two tuples at
+ * once.
+ */
+
+enum {
+	/**
+	 * Do not compress tuples smaller than this: the zstd
+	 * frame overhead and the size header would eat most of
+	 * the gain.
+	 */
+	TUPLE_COMPRESSION_THRESHOLD = 128,
+};
+
+/**
+ * A transformed tuple body starts with a 4-byte header: the low
+ * bits say which transforms to undo on access, the rest is the
+ * stored payload size. Dictionary coding is applied before
+ * compression, so it is undone after decompression.
+ */
+enum {
+	/** The payload is a zstd stream. */
+	TUPLE_BODY_ZSTD = 1 << 0,
+	/** The payload is dictionary-coded, see tuple_value_dict.h. */
+	TUPLE_BODY_DICT = 1 << 1,
+	/** Bits of the header taken by the flags. */
+	TUPLE_BODY_FLAG_BITS = 2,
+};
+
+/**
+ * Compress @a size bytes of tuple data into a buffer allocated
+ * on the fiber region. The caller is expected to copy the result
+ * into the tuple allocation and truncate the region.
+ *
+ * @retval not NULL Compressed data, *comp_size bytes.
+ * @retval     NULL Compression is not profitable or failed -
+ *                  store the tuple uncompressed.
+ */
+char *
+tuple_compress(const char *data, uint32_t size, uint32_t *comp_size);
+
+/**
+ * Return the decompressed MessagePack data of a compressed
+ * tuple, tuple->bsize bytes long. The result comes from a small
+ * per-thread cache of recently accessed tuples and stays valid
+ * until the entry is pushed out by later decompressions.
+ *
+ * Decompression cannot fail short of data corruption or running
+ * out of memory, both of which are fatal here: accessors have no
+ * error path.
+ */
+const char *
+tuple_decompress(struct tuple *tuple);
+
+/**
+ * Drop the cache entry of a tuple that is being deleted, if any.
+ * Must be called from the thread that owns the tuple lifecycle
+ * (tx) before the tuple memory is released for reuse.
+ */
+void
+tuple_compress_cache_evict(struct tuple *tuple);
+
+/**
+ * Release the calling thread's decompression cache. Called by
+ * threads with a bounded lifetime, e.g. snapshot writers, before
+ * exit. A later access re-creates the cache.
+ */
+void
+tuple_compress_cache_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED */
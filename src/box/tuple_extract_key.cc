@@ -458,6 +458,131 @@ key_def_set_extract_func(struct key_def *key_def)
 	}
 }
 
+enum {
+	/**
+	 * Max cached field locations in a batch extraction. The
+	 * cache is a linear-scan array, so it is kept small; all
+	 * distinct fields of a typical multi-index space fit with
+	 * a wide margin, and on overflow extra fields are simply
+	 * located again.
+	 */
+	KEY_BATCH_FIELD_CACHE = 64,
+};
+
+/** Cached location of a tuple field, see tuple_extract_key_batch(). */
+struct key_batch_field {
+	/** Field number. */
+	uint32_t fieldno;
+	/** Start of the field data. */
+	const char *data;
+	/** End of the field data. */
+	const char *end;
+};
+
+/**
+ * Locate a key part field, reusing a location found for another
+ * definition when possible. Top-level fields go through the
+ * cache; JSON path parts are resolved directly - they are rare
+ * and their cache key would have to include the path.
+ */
+static const char *
+key_batch_locate(struct tuple_format *format, const char *data,
+		 const uint32_t *field_map, const struct key_part *part,
+		 struct key_batch_field *cache, uint32_t *cache_size,
+		 const char **end)
+{
+	if (part->path != NULL) {
+		const char *field =
+			tuple_field_raw_by_part(format, data, field_map,
+						part, MULTIKEY_NONE);
+		if (field == NULL)
+			return NULL;
+		*end = field;
+		mp_next(end);
+		return field;
+	}
+	for (uint32_t i = 0; i < *cache_size; i++) {
+		if (cache[i].fieldno == part->fieldno) {
+			*end = cache[i].end;
+			return cache[i].data;
+		}
+	}
+	const char *field = tuple_field_raw(format, data, field_map,
+					    part->fieldno);
+	if (field == NULL)
+		return NULL;
+	*end = field;
+	mp_next(end);
+	if (*cache_size < KEY_BATCH_FIELD_CACHE) {
+		cache[*cache_size].fieldno = part->fieldno;
+		cache[*cache_size].data = field;
+		cache[*cache_size].end = *end;
+		(*cache_size)++;
+	}
+	return field;
+}
+
+int
+tuple_extract_key_batch(struct tuple *tuple, struct key_def **defs,
+			uint32_t def_count, char **keys, uint32_t *key_sizes)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	const char *data = tuple_data(tuple);
+	const uint32_t *field_map = tuple_field_map(tuple);
+	struct key_batch_field cache[KEY_BATCH_FIELD_CACHE];
+	uint32_t cache_size = 0;
+	/* Measure all keys first to allocate one block. */
+	size_t total = 0;
+	for (uint32_t k = 0; k < def_count; k++) {
+		struct key_def *def = defs[k];
+		assert(!def->is_multikey && !def->for_func_index);
+		uint32_t bsize = mp_sizeof_array(def->part_count);
+		for (uint32_t i = 0; i < def->part_count; i++) {
+			const char *end;
+			const char *field =
+				key_batch_locate(format, data, field_map,
+						 &def->parts[i], cache,
+						 &cache_size, &end);
+			if (field == NULL) {
+				assert(def->has_optional_parts);
+				bsize += mp_sizeof_nil();
+			} else {
+				bsize += end - field;
+			}
+		}
+		key_sizes[k] = bsize;
+		total += bsize;
+	}
+	char *block = (char *)region_alloc(&fiber()->gc, total);
+	if (block == NULL) {
+		diag_set(OutOfMemory, total, "region",
+			 "tuple_extract_key_batch");
+		return -1;
+	}
+	/* Now every lookup hits the warmed-up cache. */
+	for (uint32_t k = 0; k < def_count; k++) {
+		struct key_def *def = defs[k];
+		keys[k] = block;
+		char *key_buf = mp_encode_array(block, def->part_count);
+		for (uint32_t i = 0; i < def->part_count; i++) {
+			const char *end;
+			const char *field =
+				key_batch_locate(format, data, field_map,
+						 &def->parts[i], cache,
+						 &cache_size, &end);
+			if (field == NULL) {
+				key_buf = mp_encode_nil(key_buf);
+			} else {
+				memcpy(key_buf, field, end - field);
+				key_buf += end - field;
+			}
+		}
+		assert(key_buf == keys[k] + key_sizes[k]);
+		block += key_sizes[k];
+	}
+	return 0;
+}
+
 bool
 tuple_key_contains_null(struct tuple *tuple, struct key_def *def,
 			int multikey_idx)
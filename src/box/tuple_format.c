@@ -32,6 +32,7 @@
 #include "fiber.h"
 #include "json/json.h"
 #include "tuple_format.h"
+#include "tuple_value_dict.h"
 #include "coll_id_cache.h"
 #include "tt_static.h"
 
@@ -431,6 +432,7 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 					     field_count);
 	if (tuple_format_field_count(format) == 0) {
 		format->field_map_size = 0;
+		format->is_compact_field_map = false;
 		return 0;
 	}
 	/* Initialize defined fields */
@@ -480,7 +482,34 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 
 	assert(tuple_format_field(format, 0)->offset_slot ==
 	       TUPLE_OFFSET_SLOT_NIL);
-	size_t field_map_size = -current_slot * sizeof(uint32_t);
+	/*
+	 * A scan-optimized space pays with a bigger field map
+	 * for direct access to any field defined in the space
+	 * format, not only to indexed ones. The first field
+	 * is simply accessible anyway, so it gets no slot.
+	 */
+	if (format->is_scan_optimized) {
+		for (uint32_t i = 1; i < field_count; ++i) {
+			struct tuple_field *field =
+				tuple_format_field(format, i);
+			if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL)
+				continue;
+			current_slot = current_slot - 1;
+			field->offset_slot = current_slot;
+		}
+	}
+	/*
+	 * With many offset slots the plain 32-bit field map costs
+	 * hundreds of bytes on every tuple, so wide formats switch
+	 * to the compact 16-bit layout. Small maps stay plain:
+	 * saving a few bytes there is not worth deviating from
+	 * the simpler layout.
+	 */
+	format->is_compact_field_map = -current_slot > 4 &&
+		-current_slot * (int)sizeof(int16_t) <= INT16_MAX;
+	size_t field_map_size = -current_slot *
+		(format->is_compact_field_map ? sizeof(int16_t) :
+						sizeof(uint32_t));
 	if (field_map_size > UINT16_MAX) {
 		/** tuple->data_offset is 16 bits */
 		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
@@ -690,6 +719,8 @@ tuple_format_destroy(struct tuple_format *format)
 	free(format->required_fields);
 	tuple_format_destroy_fields(format);
 	tuple_dictionary_unref(format->dict);
+	if (format->value_dict != NULL)
+		tuple_value_dict_delete(format->value_dict);
 }
 
 /**
@@ -777,7 +808,7 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		 const struct field_def *space_fields,
 		 uint32_t space_field_count, uint32_t exact_field_count,
 		 struct tuple_dictionary *dict, bool is_temporary,
-		 bool is_ephemeral)
+		 bool is_ephemeral, bool is_scan_optimized)
 {
 	struct tuple_format *format =
 		tuple_format_alloc(keys, key_count, space_field_count, dict);
@@ -790,6 +821,9 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 	format->engine = engine;
 	format->is_temporary = is_temporary;
 	format->is_ephemeral = is_ephemeral;
+	format->is_scan_optimized = is_scan_optimized;
+	format->is_compressed = false;
+	format->value_dict = NULL;
 	format->exact_field_count = exact_field_count;
 	format->epoch = ++formats_epoch;
 	if (tuple_format_create(format, keys, key_count, space_fields,
@@ -861,6 +895,7 @@ tuple_field_map_create(struct tuple_format *format, const char *tuple,
 {
 	struct region *region = &fiber()->gc;
 	if (field_map_builder_create(builder, format->field_map_size,
+				     format->is_compact_field_map,
 				     region) != 0)
 		return -1;
 	if (tuple_format_field_count(format) == 0)
@@ -869,6 +904,17 @@ tuple_field_map_create(struct tuple_format *format, const char *tuple,
 	uint32_t field_count;
 	struct tuple_format_iterator it;
 	uint8_t flags = validate ? TUPLE_FORMAT_ITERATOR_VALIDATE : 0;
+	/*
+	 * When the data is trusted, the walk may be restricted
+	 * to the subtrees that contain key parts: only their
+	 * offsets make it to the field map, so there is no
+	 * point in parsing the structure of subdocuments that
+	 * are not indexed. A scan-optimized format is the
+	 * exception as it allocates an offset slot for every
+	 * top-level field.
+	 */
+	if (!validate && !format->is_scan_optimized)
+		flags |= TUPLE_FORMAT_ITERATOR_KEY_PARTS_ONLY;
 	if (tuple_format_iterator_create(&it, format, tuple, flags,
 					 &field_count, region) != 0)
 		return -1;
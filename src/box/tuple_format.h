@@ -66,6 +66,7 @@ enum { TUPLE_OFFSET_SLOT_NIL = INT32_MAX };
 struct tuple;
 struct tuple_chunk;
 struct tuple_format;
+struct tuple_value_dict;
 struct coll;
 
 /** Engine-specific tuple format methods. */
@@ -193,6 +194,36 @@ struct tuple_format {
 	 * be shared with other ephemeral spaces.
 	 */
 	bool is_ephemeral;
+	/**
+	 * Allocate an offset slot for every top-level field
+	 * defined in the space format, not only for indexed
+	 * fields. Makes any defined field directly addressable
+	 * at the cost of a bigger field map, which speeds up
+	 * scans that read one or two non-indexed fields.
+	 */
+	bool is_scan_optimized;
+	/**
+	 * Store tuple bodies zstd-compressed inside the tuple
+	 * allocation and decompress on access. Set from the
+	 * `compression' space option. Only honored by memtx.
+	 * \sa tuple_compression.h
+	 */
+	bool is_compressed;
+	/**
+	 * Per-space dictionary of repeated string values, set for
+	 * spaces created with the `dictionary' option, NULL
+	 * otherwise. Owned by the format. Only honored by memtx.
+	 * \sa tuple_value_dict.h
+	 */
+	struct tuple_value_dict *value_dict;
+	/**
+	 * Use the compact field map layout with 16-bit offset
+	 * slots instead of 32-bit ones. Chosen on format creation
+	 * for formats with many offset slots, where plain slots
+	 * cost hundreds of bytes on every tuple.
+	 * \sa struct field_map_builder
+	 */
+	bool is_compact_field_map;
 	/**
 	 * Size of minimal field map of tuple where each indexed
 	 * field has own offset slot (in bytes). The real tuple
@@ -277,6 +308,30 @@ tuple_format_field_by_path(struct tuple_format *format, uint32_t fieldno,
 					   struct tuple_field, token);
 }
 
+/**
+ * Return meta information of a tuple field given a format,
+ * field index and a JSON path compiled into a flat token
+ * array. Works exactly like tuple_format_field_by_path(),
+ * but does not run a JSON lexer on the path.
+ */
+static inline struct tuple_field *
+tuple_format_field_by_path_tokens(struct tuple_format *format, uint32_t fieldno,
+				  const struct json_token *tokens,
+				  uint32_t token_count)
+{
+	assert(fieldno < tuple_format_field_count(format));
+	struct json_token token;
+	token.type = JSON_TOKEN_NUM;
+	token.num = fieldno;
+	struct tuple_field *root =
+		json_tree_lookup_entry(&format->fields, &format->fields.root,
+				       &token, struct tuple_field, token);
+	assert(root != NULL);
+	return json_tree_lookup_tokens_entry(&format->fields, &root->token,
+					     tokens, token_count,
+					     struct tuple_field, token);
+}
+
 /**
  * Return meta information of a top-level tuple field given
  * a format and a field index.
@@ -332,6 +387,8 @@ tuple_format_unref(struct tuple_format *format)
  * @param exact_field_count Exact field count for format.
  * @param is_temporary Set if format belongs to temporary space.
  * @param is_ephemeral Set if format belongs to ephemeral space.
+ * @param is_scan_optimized Set to allocate an offset slot for
+ *        every field defined in the space format.
  *
  * @retval not NULL Tuple format.
  * @retval     NULL Memory error.
@@ -342,7 +399,7 @@ tuple_format_new(struct tuple_format_vtab *vtab, void *engine,
 		 const struct field_def *space_fields,
 		 uint32_t space_field_count, uint32_t exact_field_count,
 		 struct tuple_dictionary *dict, bool is_temporary,
-		 bool is_ephemeral);
+		 bool is_ephemeral, bool is_scan_optimized);
 
 /**
  * Check, if @a format1 can store any tuples of @a format2. For
@@ -410,9 +467,18 @@ box_tuple_format_unref(box_tuple_format_t *format);
 /**
  * Allocate a field map for the given tuple on the region.
  *
+ * The field map is a compact structural index of the document:
+ * it records the offsets of all indexed fields, including the
+ * leaves of JSON path indexes, so that comparators and key
+ * extractors reach any indexed subdocument in O(1) without
+ * reparsing the msgpack data.
+ *
  * @param format    Tuple format.
  * @param tuple     MessagePack array.
  * @param validate  If set, validate the tuple against the format.
+ *                  If unset, the data is considered trusted and
+ *                  only the subtrees containing key parts are
+ *                  parsed.
  * @param builder[out] The pointer to field map builder object to
  *                     be prepared.
  *
@@ -33,6 +33,8 @@
 #include "tuple.h"
 #include "third_party/PMurHash.h"
 #include "coll/coll.h"
+#include "lib/core/mp_extension_types.h"
+#include "lib/uuid/mp_uuid.h"
 #include <math.h>
 
 /* Tuple and key hasher */
@@ -128,6 +130,35 @@ struct KeyHash<FIELD_TYPE_UNSIGNED> {
 	}
 };
 
+/**
+ * A 128-bit mix for UUID keys: combine the two halves of the
+ * payload into one 64-bit word and whiten it the same way the
+ * unsigned key hasher does. Saves the PMurHash byte loop on
+ * UUID primary key lookups.
+ */
+static inline uint32_t
+uuid_hash(const char *field)
+{
+	int8_t ext_type;
+	uint32_t len = mp_decode_extl(&field, &ext_type);
+	assert(ext_type == MP_UUID && len == UUID_PACKED_LEN);
+	(void)ext_type;
+	(void)len;
+	uint64_t lo = load_u64(field);
+	uint64_t hi = load_u64(field + 8);
+	uint64_t val = lo ^ (hi * 0x9e3779b97f4a7c15ULL);
+	return ((uint32_t)((val)>>33^(val)^(val)<<11));
+}
+
+template <>
+struct KeyHash<FIELD_TYPE_UUID> {
+	static uint32_t hash(const char *key, struct key_def *key_def)
+	{
+		(void) key_def;
+		return uuid_hash(key);
+	}
+};
+
 template <int TYPE, int ...MORE_TYPES> struct TupleFieldHash { };
 
 template <int TYPE, int TYPE2, int ...MORE_TYPES>
@@ -183,6 +214,18 @@ struct TupleHash<FIELD_TYPE_UNSIGNED> {
 	}
 };
 
+template <>
+struct TupleHash<FIELD_TYPE_UUID> {
+	static uint32_t	hash(struct tuple *tuple, struct key_def *key_def)
+	{
+		assert(!key_def->is_multikey);
+		const char *field = tuple_field_by_part(tuple,
+						key_def->parts,
+						MULTIKEY_NONE);
+		return uuid_hash(field);
+	}
+};
+
 }; /* namespace { */
 
 #define HASHER(...) \
@@ -201,6 +244,7 @@ struct hasher_signature {
 static const hasher_signature hash_arr[] = {
 	HASHER(FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_STRING)
+	HASHER(FIELD_TYPE_UUID)
 	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
@@ -358,6 +402,23 @@ tuple_hash_key_part(uint32_t *ph1, uint32_t *pcarry, struct tuple *tuple,
 	return tuple_hash_field(ph1, pcarry, &field, part->coll);
 }
 
+void
+tuple_prefix_hashes(struct tuple *tuple, struct key_def *key_def,
+		    uint32_t *hashes)
+{
+	assert(!key_def->is_multikey);
+	assert(!key_def->for_func_index);
+	uint32_t h = HASH_SEED;
+	uint32_t carry = 0;
+	uint32_t total_size = 0;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		total_size += tuple_hash_key_part(&h, &carry, tuple,
+						  &key_def->parts[i],
+						  MULTIKEY_NONE);
+		hashes[i] = PMurHash32_Result(h, carry, total_size);
+	}
+}
+
 template <bool has_optional_parts, bool has_json_paths>
 uint32_t
 tuple_hash_slowpath(struct tuple *tuple, struct key_def *key_def)
@@ -35,6 +35,7 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct key_def;
+struct tuple;
 
 /**
  * Initialize tuple_hash() and key_hash() function for the key_def
@@ -43,6 +44,15 @@ struct key_def;
 void
 key_def_set_hash_func(struct key_def *def);
 
+/**
+ * Compute running hashes of all key prefixes of a tuple:
+ * hashes[k] receives the hash of the first k + 1 key parts.
+ * Multikey and functional index keys are not supported.
+ */
+void
+tuple_prefix_hashes(struct tuple *tuple, struct key_def *key_def,
+		    uint32_t *hashes);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
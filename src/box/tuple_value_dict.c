@@ -0,0 +1,313 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_value_dict.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pmatomic.h>
+#include <msgpuck.h>
+
+#include "assoc.h"
+#include "fiber.h"
+#include "say.h"
+
+enum {
+	/**
+	 * A code in a tuple body is stored as a fixext4 of this
+	 * ext type: one marker byte, one type byte, four bytes of
+	 * code. The coded body lives only inside the tuple
+	 * allocation and is expanded before anyone else sees it.
+	 */
+	TUPLE_DICT_EXT_TYPE = 1,
+	/** Bytes a code takes in a coded body. */
+	TUPLE_DICT_CODE_SIZE = 6,
+	/** Entries per code block, see tuple_value_dict::blocks. */
+	TUPLE_DICT_BLOCK = 4096,
+	/** Maximal number of code blocks: 64K codes in total. */
+	TUPLE_DICT_MAX_BLOCKS = 16,
+	/**
+	 * Stop counting new candidate values once the hash holds
+	 * this many records, to bound the memory spent on values
+	 * that never repeat.
+	 */
+	TUPLE_DICT_HASH_MAX = 65536,
+};
+
+/** The fixext4 marker byte, see mp_encode_extl-less msgpack. */
+#define TUPLE_DICT_MARKER 0xd6
+
+/** A value seen by the encoder: a candidate or a coded entry. */
+struct tuple_value_dict_rec {
+	/** The encoded field, header included, malloced. */
+	char *data;
+	/** Size of the encoded field. */
+	uint32_t size;
+	/** Times the value was seen, until promotion. */
+	uint32_t count;
+	/** Assigned code, or -1 while a candidate. */
+	int32_t code;
+};
+
+/** A published code slot, what the decoder reads. */
+struct tuple_value_dict_entry {
+	/** The encoded field to substitute for the code. */
+	const char *data;
+	/** Size of the encoded field. */
+	uint32_t size;
+};
+
+struct tuple_value_dict {
+	/**
+	 * Value bytes -> tuple_value_dict_rec. Owns the records.
+	 * Accessed only by the tx thread.
+	 */
+	struct mh_strnptr_t *hash;
+	/**
+	 * Code -> entry lookup for the decoder, organized as
+	 * fixed-size append-only blocks so that a published entry
+	 * never moves and readers in other threads need no lock:
+	 * block pointers and the entry count are published with
+	 * release stores.
+	 */
+	struct tuple_value_dict_entry *blocks[TUPLE_DICT_MAX_BLOCKS];
+	/** Number of published codes. */
+	uint32_t size;
+};
+
+struct tuple_value_dict *
+tuple_value_dict_new(void)
+{
+	struct tuple_value_dict *dict = calloc(1, sizeof(*dict));
+	if (dict == NULL) {
+		diag_set(OutOfMemory, sizeof(*dict), "malloc", "dict");
+		return NULL;
+	}
+	dict->hash = mh_strnptr_new();
+	if (dict->hash == NULL) {
+		diag_set(OutOfMemory, sizeof(*dict->hash), "malloc",
+			 "dict hash");
+		free(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+void
+tuple_value_dict_delete(struct tuple_value_dict *dict)
+{
+	mh_int_t i;
+	mh_foreach(dict->hash, i) {
+		struct tuple_value_dict_rec *rec =
+			mh_strnptr_node(dict->hash, i)->val;
+		free(rec->data);
+		free(rec);
+	}
+	mh_strnptr_delete(dict->hash);
+	for (int i = 0; i < TUPLE_DICT_MAX_BLOCKS; i++)
+		free(dict->blocks[i]);
+	free(dict);
+}
+
+/**
+ * Assign the next code to @a rec and publish it for decoders.
+ * Failure is not an error - the value simply stays a candidate.
+ */
+static void
+tuple_value_dict_promote(struct tuple_value_dict *dict,
+			 struct tuple_value_dict_rec *rec)
+{
+	uint32_t code = dict->size;
+	if (code >= TUPLE_DICT_BLOCK * TUPLE_DICT_MAX_BLOCKS)
+		return;
+	struct tuple_value_dict_entry *block =
+		dict->blocks[code / TUPLE_DICT_BLOCK];
+	if (block == NULL) {
+		block = calloc(TUPLE_DICT_BLOCK, sizeof(*block));
+		if (block == NULL)
+			return;
+		pm_atomic_store_explicit(&dict->blocks[code / TUPLE_DICT_BLOCK],
+					 block, memory_order_release);
+	}
+	struct tuple_value_dict_entry *entry = &block[code % TUPLE_DICT_BLOCK];
+	entry->data = rec->data;
+	entry->size = rec->size;
+	rec->code = code;
+	/*
+	 * The entry must be complete before a decoder in another
+	 * thread can see the new count.
+	 */
+	pm_atomic_store_explicit(&dict->size, code + 1, memory_order_release);
+}
+
+/**
+ * Look up the record of an encoded field, counting it as seen.
+ * A new value becomes a candidate, a frequent candidate gets a
+ * code. Returns NULL if the value is not worth tracking.
+ */
+static struct tuple_value_dict_rec *
+tuple_value_dict_account(struct tuple_value_dict *dict, const char *field,
+			 uint32_t field_size)
+{
+	mh_int_t k = mh_strnptr_find_inp(dict->hash, field, field_size);
+	if (k != mh_end(dict->hash)) {
+		struct tuple_value_dict_rec *rec =
+			mh_strnptr_node(dict->hash, k)->val;
+		if (rec->code < 0 && ++rec->count >= TUPLE_DICT_PROMOTE)
+			tuple_value_dict_promote(dict, rec);
+		return rec;
+	}
+	if (mh_size(dict->hash) >= TUPLE_DICT_HASH_MAX)
+		return NULL;
+	struct tuple_value_dict_rec *rec = malloc(sizeof(*rec));
+	char *data = malloc(field_size);
+	if (rec == NULL || data == NULL) {
+		free(rec);
+		free(data);
+		return NULL;
+	}
+	memcpy(data, field, field_size);
+	rec->data = data;
+	rec->size = field_size;
+	rec->count = 1;
+	rec->code = -1;
+	uint32_t hash = mh_strn_hash(data, field_size);
+	struct mh_strnptr_node_t node = { data, field_size, hash, rec };
+	if (mh_strnptr_put(dict->hash, &node, NULL, NULL) ==
+	    mh_end(dict->hash)) {
+		free(data);
+		free(rec);
+		return NULL;
+	}
+	return rec;
+}
+
+char *
+tuple_value_dict_encode(struct tuple_value_dict *dict, const char *data,
+			uint32_t size, uint32_t *coded_size)
+{
+	const char *pos = data;
+	if (mp_typeof(*pos) != MP_ARRAY)
+		return NULL;
+	uint32_t field_count = mp_decode_array(&pos);
+	char *out = region_alloc(&fiber()->gc, size);
+	if (out == NULL)
+		return NULL;
+	char *wpos = out;
+	memcpy(wpos, data, pos - data);
+	wpos += pos - data;
+	bool coded_any = false;
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		uint32_t field_size = pos - field;
+		/*
+		 * A genuine fixext4 of our ext type would be
+		 * indistinguishable from a code when expanding -
+		 * such a tuple is stored without coding.
+		 */
+		if ((unsigned char)field[0] == TUPLE_DICT_MARKER &&
+		    field[1] == TUPLE_DICT_EXT_TYPE)
+			return NULL;
+		if (mp_typeof(*field) == MP_STR) {
+			const char *str = field;
+			uint32_t len = mp_decode_strl(&str);
+			/*
+			 * The value hash compares keys with
+			 * strncmp, so a value with an embedded
+			 * NUL could alias another one - leave
+			 * such strings alone.
+			 */
+			if (len >= TUPLE_DICT_MIN_LEN &&
+			    len <= TUPLE_DICT_MAX_LEN &&
+			    memchr(str, '\0', len) == NULL) {
+				struct tuple_value_dict_rec *rec =
+					tuple_value_dict_account(dict, field,
+								 field_size);
+				if (rec != NULL && rec->code >= 0) {
+					uint32_t code = rec->code;
+					*wpos++ = (char)TUPLE_DICT_MARKER;
+					*wpos++ = TUPLE_DICT_EXT_TYPE;
+					memcpy(wpos, &code, sizeof(code));
+					wpos += sizeof(code);
+					coded_any = true;
+					continue;
+				}
+			}
+		}
+		memcpy(wpos, field, field_size);
+		wpos += field_size;
+	}
+	if (!coded_any)
+		return NULL;
+	assert(wpos - out < (ptrdiff_t)size);
+	*coded_size = wpos - out;
+	return out;
+}
+
+void
+tuple_value_dict_decode(struct tuple_value_dict *dict, const char *coded,
+			uint32_t coded_size, char *dst, uint32_t dst_size)
+{
+	const char *pos = coded;
+	uint32_t field_count = mp_decode_array(&pos);
+	char *wpos = dst;
+	memcpy(wpos, coded, pos - coded);
+	wpos += pos - coded;
+	uint32_t published = pm_atomic_load_explicit(&dict->size,
+						     memory_order_acquire);
+	for (uint32_t i = 0; i < field_count; i++) {
+		if ((unsigned char)pos[0] == TUPLE_DICT_MARKER &&
+		    pos[1] == TUPLE_DICT_EXT_TYPE) {
+			uint32_t code;
+			memcpy(&code, pos + 2, sizeof(code));
+			pos += TUPLE_DICT_CODE_SIZE;
+			if (code >= published)
+				panic("broken dictionary-coded tuple: "
+				      "unknown value code %u", (unsigned)code);
+			struct tuple_value_dict_entry *block =
+				pm_atomic_load_explicit(
+					&dict->blocks[code / TUPLE_DICT_BLOCK],
+					memory_order_acquire);
+			struct tuple_value_dict_entry *entry =
+				&block[code % TUPLE_DICT_BLOCK];
+			memcpy(wpos, entry->data, entry->size);
+			wpos += entry->size;
+		} else {
+			const char *field = pos;
+			mp_next(&pos);
+			memcpy(wpos, field, pos - field);
+			wpos += pos - field;
+		}
+	}
+	if (wpos != dst + dst_size || pos != coded + coded_size)
+		panic("broken dictionary-coded tuple: size mismatch");
+}
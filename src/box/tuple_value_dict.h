@@ -0,0 +1,123 @@
+#ifndef TARANTOOL_BOX_TUPLE_VALUE_DICT_H_INCLUDED
+#define TARANTOOL_BOX_TUPLE_VALUE_DICT_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Dictionary encoding of repeated string values.
+ *
+ * Many spaces store the same few hundred string values in
+ * millions of tuples: status names, country codes, enum-like
+ * tags. A space created with the `dictionary' option keeps a
+ * per-space value dictionary: a string field value seen often
+ * enough gets a 4-byte code, and new tuples store the code
+ * instead of the string. The substitution happens inside the
+ * tuple allocation, behind the same storage-transform layer as
+ * tuple compression, so every consumer of tuple_data() sees the
+ * original MessagePack - dictionary state never leaves the
+ * process and never hits the WAL or snapshots.
+ *
+ * The dictionary grows adaptively: the encoder counts candidate
+ * values and promotes one to a code once it has been seen
+ * TUPLE_DICT_PROMOTE times. Codes are append-only and entries
+ * are immutable once published, so snapshot threads can expand
+ * coded tuples concurrently with the tx thread adding entries -
+ * publication is a release store of the entry count. On restart
+ * the dictionary is rebuilt while the snapshot and WALs, which
+ * carry plain tuples, are replayed.
+ */
+
+struct tuple_value_dict;
+
+enum {
+	/**
+	 * Promote a value to a code once it has been seen this
+	 * many times. A lower bar would fill the dictionary with
+	 * one-off values, a higher one delays the savings.
+	 */
+	TUPLE_DICT_PROMOTE = 32,
+	/**
+	 * Only consider string payloads in this length range: a
+	 * code takes 6 bytes, shorter strings cannot shrink, and
+	 * very long ones are unlikely to repeat.
+	 */
+	TUPLE_DICT_MIN_LEN = 8,
+	TUPLE_DICT_MAX_LEN = 1024,
+};
+
+/**
+ * Create an empty value dictionary.
+ *
+ * @retval not NULL Dictionary.
+ * @retval     NULL Memory error.
+ */
+struct tuple_value_dict *
+tuple_value_dict_new(void);
+
+/** Release a dictionary and all its entries. */
+void
+tuple_value_dict_delete(struct tuple_value_dict *dict);
+
+/**
+ * Rewrite tuple MessagePack @a data of @a size bytes replacing
+ * dictionary-eligible top-level string fields with their codes.
+ * Also counts candidate values, growing the dictionary. The
+ * result is allocated on the fiber region. Must be called from
+ * the thread that owns the dictionary (tx).
+ *
+ * @retval not NULL Coded body, *coded_size bytes, smaller than
+ *                  the original.
+ * @retval     NULL No field was coded - store the tuple as is.
+ */
+char *
+tuple_value_dict_encode(struct tuple_value_dict *dict, const char *data,
+			uint32_t size, uint32_t *coded_size);
+
+/**
+ * Expand a coded body back into the original MessagePack.
+ * Exactly @a dst_size bytes are written to @a dst. Safe to call
+ * from any thread. Corruption is fatal: accessors have no error
+ * path.
+ */
+void
+tuple_value_dict_decode(struct tuple_value_dict *dict, const char *coded,
+			uint32_t coded_size, char *dst, uint32_t dst_size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TUPLE_VALUE_DICT_H_INCLUDED */
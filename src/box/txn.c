@@ -30,9 +30,13 @@
  */
 #include "txn.h"
 #include "engine.h"
+#include "txn_limbo.h"
 #include "tuple.h"
 #include "journal.h"
 #include <fiber.h>
+#include "flightrec.h"
+#include "region_profile.h"
+#include "rmean.h"
 #include "xrow.h"
 
 double too_long_threshold;
@@ -40,6 +44,31 @@ double too_long_threshold;
 /* Txn cache. */
 static struct stailq txn_cache = {NULL, &txn_cache.first};
 
+enum {
+	/** The region reserve covers this percentile of recent txns. */
+	TXN_REGION_PERCENTILE = 90,
+	/** Hard cap on the region reserve kept in a cached txn. */
+	TXN_ARENA_RESERVE_MAX = 4 * 1024 * 1024,
+};
+
+/**
+ * Retention profile of the txn region. Sizes the reserve kept in
+ * cached transactions so that typical transactions are served
+ * from an already allocated slab instead of pulling slabs from
+ * the shared slab cache one by one as they grow.
+ */
+static struct region_profile txn_region_profile;
+
+void
+txn_mem_stat(struct txn_mem_stat *stat)
+{
+	struct region_profile *profile = &txn_region_profile;
+	stat->txn_count = profile->rmean != NULL ?
+		rmean_total(profile->rmean, REGION_PROFILE_ALLOC) : 0;
+	stat->max_footprint = profile->max_footprint;
+	stat->arena_reserve = profile->reserve;
+}
+
 static int
 txn_on_stop(struct trigger *trigger, void *event);
 
@@ -169,6 +198,9 @@ txn_rollback_to_svp(struct txn *txn, struct stailq_entry *svp)
 inline static struct txn *
 txn_new(void)
 {
+	region_profile_create(&txn_region_profile, "txn",
+			      TXN_REGION_PERCENTILE, TXN_ARENA_RESERVE_MAX);
+
 	if (!stailq_empty(&txn_cache))
 		return stailq_shift_entry(&txn_cache, struct txn, in_txn_cache);
 
@@ -197,8 +229,19 @@ txn_free(struct txn *txn)
 	stailq_foreach_entry(stmt, &txn->stmts, next)
 		txn_stmt_unref_tuples(stmt);
 
+	region_profile_account(&txn_region_profile, region_used(&txn->region));
+
 	/* Truncate region up to struct txn size. */
 	region_truncate(&txn->region, sizeof(struct txn));
+	/*
+	 * Pre-reserve memory for the next transaction while the
+	 * txn sits in the cache. Best effort: the reserve is an
+	 * optimization, so on OOM just drop the diag it has set,
+	 * but never clobber an error the caller is about to read.
+	 */
+	if (txn_region_profile.reserve > 0 && diag_is_empty(diag_get()) &&
+	    region_reserve(&txn->region, txn_region_profile.reserve) == NULL)
+		diag_clear(diag_get());
 	stailq_add(&txn_cache, &txn->in_txn_cache);
 }
 
@@ -283,6 +326,8 @@ txn_begin_stmt(struct txn *txn, struct space *space)
 		goto fail;
 
 	stmt->space = space;
+	if (space->def->opts.is_sync)
+		txn_set_flag(txn, TXN_WAIT_SYNC);
 	if (engine_begin_statement(engine, txn) != 0)
 		goto fail;
 
@@ -318,10 +363,14 @@ txn_commit_stmt(struct txn *txn, struct request *request)
 	 */
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 
-	/* Create WAL record for the write requests in non-temporary spaces.
+	/* Create WAL record for the write requests in non-temporary
+	 * spaces and in spaces which did not opt out of journaling.
 	 * stmt->space can be NULL for IRPOTO_NOP.
 	 */
-	if (stmt->space == NULL || !space_is_temporary(stmt->space)) {
+	bool skip_wal = stmt->space != NULL &&
+			(space_is_temporary(stmt->space) ||
+			 space_is_wal_disabled(stmt->space));
+	if (!skip_wal) {
 		if (txn_add_redo(txn, stmt, request) != 0)
 			goto fail;
 		assert(stmt->row != NULL);
@@ -343,17 +392,22 @@ txn_commit_stmt(struct txn *txn, struct request *request)
 	 * - perhaps we should run triggers even for deletes which
 	 *   doesn't find any rows
 	 */
+	if (stmt->space != NULL && stmt->space->run_triggers &&
+	    !rlist_empty(&stmt->space->on_replace_batch) &&
+	    (stmt->old_tuple || stmt->new_tuple))
+		txn_set_flag(txn, TXN_HAS_BATCH_TRIGGERS);
 	if (stmt->space != NULL && !rlist_empty(&stmt->space->on_replace) &&
 	    stmt->space->run_triggers && (stmt->old_tuple || stmt->new_tuple)) {
 		int rc = 0;
-		if(!space_is_temporary(stmt->space)) {
+		if (!skip_wal) {
 			rc = trigger_run(&stmt->space->on_replace, txn);
 		} else {
 			/*
 			 * There is no row attached to txn_stmt for
-			 * temporary spaces, since DML operations on them
-			 * are not written to WAL. Fake a row to pass operation
-			 * type to lua on_replace triggers.
+			 * temporary and wal_disabled spaces, since DML
+			 * operations on them are not written to WAL.
+			 * Fake a row to pass operation type to lua
+			 * on_replace triggers.
 			 */
 			assert(stmt->row == NULL);
 			struct xrow_header temp_header;
@@ -394,6 +448,36 @@ txn_run_commit_triggers(struct txn *txn, struct rlist *triggers)
 	}
 }
 
+/*
+ * Run the batched on_replace triggers of every space touched by the
+ * transaction. Each space is visited exactly once no matter how many
+ * statements modified it: the space remembers the id of the last
+ * transaction it was notified about.
+ */
+static void
+txn_run_on_replace_batch_triggers(struct txn *txn)
+{
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		struct space *space = stmt->space;
+		if (space == NULL || !space->run_triggers ||
+		    rlist_empty(&space->on_replace_batch) ||
+		    (stmt->old_tuple == NULL && stmt->new_tuple == NULL))
+			continue;
+		if (space->on_replace_batch_txn_id == txn->id)
+			continue;
+		space->on_replace_batch_txn_id = txn->id;
+		if (trigger_run(&space->on_replace_batch, txn) != 0) {
+			/*
+			 * The statements are already committed so
+			 * the error can't abort anything - log it
+			 * and carry on.
+			 */
+			diag_log();
+		}
+	}
+}
+
 /*
  * A helper function to process on_rollback triggers.
  */
@@ -435,6 +519,8 @@ txn_complete(struct txn *txn)
 		/* Commit the transaction. */
 		if (txn->engine != NULL)
 			engine_commit(txn->engine, txn);
+		if (txn_has_flag(txn, TXN_HAS_BATCH_TRIGGERS))
+			txn_run_on_replace_batch_triggers(txn);
 		if (txn_has_flag(txn, TXN_HAS_TRIGGERS))
 			txn_run_commit_triggers(txn, &txn->on_commit);
 
@@ -629,7 +715,10 @@ txn_commit(struct txn *txn)
 	}
 
 	fiber_set_txn(fiber(), NULL);
-	if (journal_write(req) != 0) {
+	flightrec_record(FLIGHTREC_JOURNAL_WAIT_BEGIN, 0);
+	int rc = journal_write(req);
+	flightrec_record(FLIGHTREC_JOURNAL_WAIT_END, 0);
+	if (rc != 0) {
 		fiber_set_txn(fiber(), txn);
 		txn_rollback(txn);
 		txn_free(txn);
@@ -639,6 +728,17 @@ txn_commit(struct txn *txn)
 		return -1;
 	}
 
+	/*
+	 * A synchronous transaction is reported to the client
+	 * only after a quorum of replicas has acknowledged its
+	 * last LSN. Transactions coming from an applier are the
+	 * remote master's to account for, so only locally
+	 * originated writes wait.
+	 */
+	if (txn_has_flag(txn, TXN_WAIT_SYNC) && txn->n_applier_rows == 0 &&
+	    req->res >= 0)
+		txn_limbo_wait_quorum(req->res);
+
 	if (!txn_has_flag(txn, TXN_IS_DONE)) {
 		txn->signature = req->res;
 		txn_complete(txn);
@@ -747,7 +847,7 @@ box_txn_commit(void)
 		return -1;
 	}
 	int rc = txn_commit(txn);
-	fiber_gc();
+	region_profile_fiber_gc();
 	return rc;
 }
 
@@ -762,7 +862,7 @@ box_txn_rollback(void)
 		return -1;
 	}
 	txn_rollback(txn); /* doesn't throw */
-	fiber_gc();
+	region_profile_fiber_gc();
 	return 0;
 }
 
@@ -895,7 +995,7 @@ txn_on_stop(struct trigger *trigger, void *event)
 	(void) trigger;
 	(void) event;
 	txn_rollback(in_txn());                 /* doesn't yield or fail */
-	fiber_gc();
+	region_profile_fiber_gc();
 	return 0;
 }
 
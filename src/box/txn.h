@@ -66,6 +66,19 @@ enum txn_flag {
 	TXN_CAN_YIELD,
 	/** on_commit and/or on_rollback list is not empty. */
 	TXN_HAS_TRIGGERS,
+	/**
+	 * At least one statement changed a space with a
+	 * non-empty on_replace_batch trigger list, so the
+	 * batched triggers have to be run on commit.
+	 */
+	TXN_HAS_BATCH_TRIGGERS,
+	/**
+	 * At least one statement changed a synchronous space, so
+	 * after the WAL write the transaction waits in the limbo
+	 * for a quorum of replica acknowledgements, see
+	 * txn_limbo.h.
+	 */
+	TXN_WAIT_SYNC,
 };
 
 enum {
@@ -264,6 +277,30 @@ fiber_set_txn(struct fiber *fiber, struct txn *txn)
 	fiber->storage.txn = txn;
 }
 
+/**
+ * Transaction memory statistics, see txn_mem_stat().
+ */
+struct txn_mem_stat {
+	/** Number of transactions finished since start. */
+	uint64_t txn_count;
+	/**
+	 * Largest region footprint a single transaction ever had,
+	 * in bytes: the high-water mark of per-txn memory.
+	 */
+	size_t max_footprint;
+	/**
+	 * Current region reserve kept in cached transactions,
+	 * a moving percentile of recent transaction footprints.
+	 */
+	size_t arena_reserve;
+};
+
+/**
+ * Fill @stat with transaction memory statistics.
+ */
+void
+txn_mem_stat(struct txn_mem_stat *stat);
+
 /**
  * Start a transaction explicitly.
  * @pre no transaction is active
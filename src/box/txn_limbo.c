@@ -0,0 +1,187 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "txn_limbo.h"
+
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "say.h"
+#include "replication.h"
+#include "vclock.h"
+
+/** A single transaction waiting for a quorum. */
+struct txn_limbo_entry {
+	/** Link in txn_limbo::queue, ordered by lsn. */
+	struct rlist in_queue;
+	/** LSN of the last row of the transaction. */
+	int64_t lsn;
+	/** Set when a quorum of replicas has acknowledged lsn. */
+	bool is_commit;
+};
+
+struct txn_limbo {
+	/** Transactions waiting for a quorum, in lsn order. */
+	struct rlist queue;
+	/**
+	 * Per-replica acknowledged LSNs of this instance's rows:
+	 * component @a replica_id holds the LSN up to which that
+	 * replica has applied our writes.
+	 */
+	struct vclock vclock;
+	/** Signaled whenever the quorum watermark advances. */
+	struct fiber_cond cond;
+	/** Transactions confirmed by a quorum, for monitoring. */
+	uint64_t confirmed_count;
+	/** Transactions degraded to async on timeout. */
+	uint64_t degraded_count;
+};
+
+static struct txn_limbo txn_limbo;
+
+void
+txn_limbo_init(void)
+{
+	rlist_create(&txn_limbo.queue);
+	vclock_create(&txn_limbo.vclock);
+	fiber_cond_create(&txn_limbo.cond);
+	txn_limbo.confirmed_count = 0;
+	txn_limbo.degraded_count = 0;
+}
+
+void
+txn_limbo_free(void)
+{
+	assert(rlist_empty(&txn_limbo.queue));
+	fiber_cond_destroy(&txn_limbo.cond);
+}
+
+/**
+ * Compute the quorum watermark: the highest LSN acknowledged by
+ * at least replication_synchro_quorum - 1 replicas (the instance
+ * itself is the remaining vote), and confirm all queued entries
+ * at or below it.
+ */
+static void
+txn_limbo_confirm(void)
+{
+	int needed = replication_synchro_quorum - 1;
+	assert(needed > 0);
+	/*
+	 * The watermark is the needed-th largest per-replica
+	 * acknowledged LSN. The replica count is bounded by
+	 * VCLOCK_MAX, so a simple selection pass is fine.
+	 */
+	int64_t acked[VCLOCK_MAX];
+	int n_acked = 0;
+	struct vclock_iterator it;
+	vclock_iterator_init(&it, &txn_limbo.vclock);
+	vclock_foreach(&it, vc)
+		acked[n_acked++] = vc.lsn;
+	if (n_acked < needed)
+		return;
+	for (int i = 0; i < needed; i++) {
+		for (int j = i + 1; j < n_acked; j++) {
+			if (acked[j] > acked[i]) {
+				int64_t tmp = acked[i];
+				acked[i] = acked[j];
+				acked[j] = tmp;
+			}
+		}
+	}
+	int64_t watermark = acked[needed - 1];
+	bool confirmed = false;
+	while (!rlist_empty(&txn_limbo.queue)) {
+		struct txn_limbo_entry *e =
+			rlist_first_entry(&txn_limbo.queue,
+					  struct txn_limbo_entry, in_queue);
+		if (e->lsn > watermark)
+			break;
+		e->is_commit = true;
+		rlist_del_entry(e, in_queue);
+		txn_limbo.confirmed_count++;
+		confirmed = true;
+	}
+	if (confirmed)
+		fiber_cond_broadcast(&txn_limbo.cond);
+}
+
+void
+txn_limbo_wait_quorum(int64_t lsn)
+{
+	if (replication_synchro_quorum <= 1)
+		return;
+	struct txn_limbo_entry entry;
+	entry.lsn = lsn;
+	entry.is_commit = false;
+	/*
+	 * WAL writes complete in LSN order, but the fibers they
+	 * wake may reach the limbo out of order, so insert at the
+	 * right position to keep the queue sorted.
+	 */
+	struct txn_limbo_entry *e;
+	rlist_foreach_entry_reverse(e, &txn_limbo.queue, in_queue) {
+		if (e->lsn <= lsn)
+			break;
+	}
+	rlist_add_entry(&e->in_queue, &entry, in_queue);
+	/* ACKs may have arrived while the WAL write was in flight. */
+	txn_limbo_confirm();
+	double deadline = ev_monotonic_now(loop()) +
+			  replication_synchro_timeout;
+	while (!entry.is_commit) {
+		double timeout = deadline - ev_monotonic_now(loop());
+		if (timeout <= 0 ||
+		    fiber_cond_wait_timeout(&txn_limbo.cond, timeout) != 0)
+			break;
+	}
+	if (!entry.is_commit) {
+		rlist_del_entry(&entry, in_queue);
+		txn_limbo.degraded_count++;
+		say_warn_ratelimited("synchronous transaction at LSN %lld "
+				     "did not collect a quorum of %d within "
+				     "%.2lf seconds, proceeding without it",
+				     (long long) lsn,
+				     replication_synchro_quorum,
+				     replication_synchro_timeout);
+	}
+}
+
+void
+txn_limbo_ack(uint32_t replica_id, int64_t lsn)
+{
+	if (replica_id == 0 || replica_id == instance_id)
+		return;
+	if (lsn <= vclock_get(&txn_limbo.vclock, replica_id))
+		return;
+	vclock_follow(&txn_limbo.vclock, replica_id, lsn);
+	if (replication_synchro_quorum > 1 &&
+	    !rlist_empty(&txn_limbo.queue))
+		txn_limbo_confirm();
+}
@@ -0,0 +1,94 @@
+#ifndef TARANTOOL_BOX_TXN_LIMBO_H_INCLUDED
+#define TARANTOOL_BOX_TXN_LIMBO_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Limbo of synchronous transactions.
+ *
+ * A transaction touching a space created with the 'is_sync'
+ * option is not reported to the client right after its WAL write.
+ * Instead it is parked in the limbo queue until a quorum of
+ * replicas (box.cfg.replication_synchro_quorum, the instance
+ * itself included) has acknowledged its LSN.
+ *
+ * Acknowledgements are not per transaction: relays periodically
+ * deliver the vclock a replica has reached, and each such vclock
+ * advances a watermark confirming every queued transaction below
+ * it at once. Hence many pipelined transactions ride on a single
+ * ACK round trip and synchronous throughput does not degrade to
+ * one round trip per commit.
+ *
+ * If the quorum is not collected within
+ * box.cfg.replication_synchro_timeout, the transaction degrades
+ * to asynchronous: it stays committed locally (it is already in
+ * the WAL and on its way to the replicas) and a warning is
+ * logged. Rolling a written transaction back would require
+ * persistent CONFIRM/ROLLBACK records and recovery support for
+ * them, which this module does not provide yet.
+ */
+
+/** Create the limbo. Called once at bootstrap. */
+void
+txn_limbo_init(void);
+
+/** Destroy the limbo. The queue must be empty. */
+void
+txn_limbo_free(void);
+
+/**
+ * Park the current fiber until @a lsn (a row of this instance)
+ * is acknowledged by a quorum of replicas or
+ * replication_synchro_timeout expires. Must be called after the
+ * WAL write of the transaction has succeeded. No-op when
+ * replication_synchro_quorum <= 1.
+ */
+void
+txn_limbo_wait_quorum(int64_t lsn);
+
+/**
+ * Account a replica acknowledgement: @a replica_id has applied
+ * everything of this instance up to @a lsn. Confirms and wakes
+ * up all queued transactions below the new quorum watermark.
+ */
+void
+txn_limbo_ack(uint32_t replica_id, int64_t lsn);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TXN_LIMBO_H_INCLUDED */
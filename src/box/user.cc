@@ -36,6 +36,7 @@
 #include "index.h"
 #include "bit/bit.h"
 #include "fiber.h"
+#include "trigger.h"
 #include "scoped_guard.h"
 #include "sequence.h"
 #include "tt_static.h"
@@ -459,6 +460,9 @@ auth_token_put(uint8_t auth_token)
 
 /* {{{ user cache */
 
+struct rlist user_cache_on_change =
+	RLIST_HEAD_INITIALIZER(user_cache_on_change);
+
 struct user *
 user_cache_replace(struct user_def *def)
 {
@@ -473,6 +477,8 @@ user_cache_replace(struct user_def *def)
 		free(user->def);
 	}
 	user->def = def;
+	if (trigger_run(&user_cache_on_change, user) != 0)
+		diag_log();
 	return user;
 }
 
@@ -495,6 +501,8 @@ user_cache_delete(uint32_t uid)
 		 * all privileges from them first.
 		 */
 		mh_i32ptr_del(user_registry, k, NULL);
+		if (trigger_run(&user_cache_on_change, NULL) != 0)
+			diag_log();
 	}
 }
 
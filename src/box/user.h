@@ -159,6 +159,14 @@ credentials_reset(struct credentials *cr, struct user *new_user)
  */
 extern struct user *guest_user, *admin_user;
 
+/**
+ * Triggers fired in the tx thread every time a user definition
+ * is inserted into, updated in or deleted from the user cache.
+ * Used by iproto to invalidate the authentication data replicas
+ * kept in the network threads.
+ */
+extern struct rlist user_cache_on_change;
+
 /*
  * Insert or update user object (a cache entry
  * for user).
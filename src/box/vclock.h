@@ -282,16 +282,26 @@ static inline int
 vclock_compare_generic(const struct vclock *a, const struct vclock *b,
 		       bool ignore_zero)
 {
+	/*
+	 * Fast path: identical clocks. When the component maps
+	 * match, a flat memcmp of the lsn arrays is vectorized by
+	 * libc and is much cheaper than the per-component loop.
+	 * It may compare garbage in unused slots, but that can
+	 * only produce a false mismatch which falls through to
+	 * the exact loop below, never a false match.
+	 */
+	if (a->map == b->map &&
+	    memcmp(a->lsn, b->lsn, sizeof(a->lsn)) == 0)
+		return 0;
+
 	bool le = true, ge = true;
 	vclock_map_t map = a->map | b->map;
-	struct bit_iterator it;
-	bit_iterator_init(&it, &map, sizeof(map), true);
-
-	size_t replica_id = bit_iterator_next(&it);
-	if (replica_id == 0 && ignore_zero)
-		replica_id = bit_iterator_next(&it);
+	if (ignore_zero)
+		map &= ~(vclock_map_t) 1;
 
-	for (; replica_id < VCLOCK_MAX; replica_id = bit_iterator_next(&it)) {
+	while (map != 0) {
+		uint32_t replica_id = bit_ctz_u32(map);
+		map &= map - 1;
 		int64_t lsn_a = vclock_get(a, replica_id);
 		int64_t lsn_b = vclock_get(b, replica_id);
 		le = le && lsn_a <= lsn_b;
@@ -50,6 +50,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <fcntl.h>
 
 #include <small/lsregion.h>
 #include <small/region.h>
@@ -57,7 +58,9 @@
 
 #include "coio_task.h"
 #include "cbus.h"
+#include "fio.h"
 #include "histogram.h"
+#include "mempool_registry.h"
 #include "xrow_update.h"
 #include "txn.h"
 #include "xrow.h"
@@ -129,6 +132,12 @@ struct vy_env {
 	double timeout;
 	/** Try to recover corrupted data if set. */
 	bool force_recovery;
+	/**
+	 * Fiber replaying the hot key set saved by the previous
+	 * incarnation of the instance, NULL when warmup is not
+	 * running. See the "Cache warmup" section.
+	 */
+	struct fiber *warmup_fiber;
 };
 
 /** Mask passed to vy_gc(). */
@@ -247,6 +256,8 @@ vy_info_append_scheduler(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "compaction_output", stat->compaction_output);
 	info_append_int(h, "compaction_queue",
 			env->lsm_env.compaction_queue_size);
+	info_append_int(h, "compaction_queue_hot",
+			env->lsm_env.compaction_queue_hot_size);
 	info_table_end(h); /* scheduler */
 }
 
@@ -434,6 +445,8 @@ vinyl_index_stat(struct index *index, struct info_handler *h)
 	vy_info_append_stmt_counter(h, "put", &cache_stat->put);
 	vy_info_append_stmt_counter(h, "invalidate", &cache_stat->invalidate);
 	vy_info_append_stmt_counter(h, "evict", &cache_stat->evict);
+	vy_info_append_stmt_counter(h, "promote", &cache_stat->promote);
+	vy_info_append_stmt_counter(h, "demote", &cache_stat->demote);
 	info_append_int(h, "index_size",
 			vy_cache_tree_mem_used(&lsm->cache.cache_tree));
 	info_table_end(h); /* cache */
@@ -496,6 +509,8 @@ vinyl_index_reset_stat(struct index *index)
 	vy_stmt_counter_reset(&cache_stat->put);
 	vy_stmt_counter_reset(&cache_stat->invalidate);
 	vy_stmt_counter_reset(&cache_stat->evict);
+	vy_stmt_counter_reset(&cache_stat->promote);
+	vy_stmt_counter_reset(&cache_stat->demote);
 }
 
 static void
@@ -582,6 +597,11 @@ vinyl_engine_check_space_def(struct space_def *def)
 			 def->name, "engine does not support temporary flag");
 		return -1;
 	}
+	if (def->opts.wal_disabled) {
+		diag_set(ClientError, ER_ALTER_SPACE, def->name,
+			 "engine does not support wal_disabled flag");
+		return -1;
+	}
 	return 0;
 }
 
@@ -669,6 +689,11 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 			 "functional index");
 		return -1;
 	}
+	if (index_def->opts.predicate != NULL) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "partial index");
+		return -1;
+	}
 	return 0;
 }
 
@@ -1266,6 +1291,39 @@ vy_get_by_secondary_tuple(struct vy_lsm *lsm, struct vy_tx *tx,
 	int rc = 0;
 	assert(lsm->index_id > 0);
 
+	/*
+	 * Fast path. A full tuple read from the secondary index
+	 * cache was once fetched from the primary index and then
+	 * cached in both indexes as the same tuple object. If the
+	 * primary index cache still holds the very same object,
+	 * the tuple cannot have been overwritten or deleted,
+	 * because any write to the primary index, including a
+	 * deferred DELETE, invalidates the cache chain on tx
+	 * prepare. In this case the tuple may be returned right
+	 * away, and a hot secondary lookup is served entirely
+	 * from memory. The path is off limits for transactions
+	 * with uncommitted writes and for old read views, which
+	 * have to see the primary index history.
+	 */
+	if (!vy_stmt_is_key(entry.stmt) && (*rv)->vlsn == INT64_MAX &&
+	    (tx == NULL || tx->write_size == 0)) {
+		struct vy_entry pk_key;
+		pk_key.stmt = entry.stmt;
+		pk_key.hint = vy_stmt_hint(entry.stmt, lsm->pk->cmp_def);
+		lsm->pk->cache.stat.lookup++;
+		struct vy_entry cached = vy_cache_get(&lsm->pk->cache, pk_key);
+		if (cached.stmt == entry.stmt) {
+			vy_stmt_counter_acct_tuple(&lsm->pk->cache.stat.get,
+						   cached.stmt);
+			if (tx != NULL &&
+			    vy_tx_track_point(tx, lsm->pk, pk_key) != 0)
+				return -1;
+			tuple_ref(entry.stmt);
+			*result = entry;
+			return 0;
+		}
+	}
+
 	/*
 	 * Lookup the full tuple by a secondary statement.
 	 * There are two cases: the secondary statement may be
@@ -1517,7 +1575,7 @@ static int
 vy_check_is_unique_secondary_one(struct vy_tx *tx, const struct vy_read_view **rv,
 				 const char *space_name, const char *index_name,
 				 struct vy_lsm *lsm, struct tuple *stmt,
-				 int multikey_idx)
+				 int multikey_idx, const char *key_raw)
 {
 	assert(lsm->index_id > 0);
 	assert(vy_stmt_type(stmt) == IPROTO_INSERT ||
@@ -1526,9 +1584,16 @@ vy_check_is_unique_secondary_one(struct vy_tx *tx, const struct vy_read_view **r
 	if (lsm->key_def->is_nullable &&
 	    tuple_key_contains_null(stmt, lsm->key_def, multikey_idx))
 		return 0;
-	struct tuple *key = vy_stmt_extract_key(stmt, lsm->key_def,
-						lsm->env->key_format,
-						multikey_idx);
+	struct tuple *key;
+	if (key_raw != NULL) {
+		/* The key was extracted in a batch by the caller. */
+		uint32_t part_count = mp_decode_array(&key_raw);
+		assert(part_count == lsm->key_def->part_count);
+		key = vy_key_new(lsm->env->key_format, key_raw, part_count);
+	} else {
+		key = vy_stmt_extract_key(stmt, lsm->key_def,
+					  lsm->env->key_format, multikey_idx);
+	}
 	if (key == NULL)
 		return -1;
 	struct tuple *found;
@@ -1570,6 +1635,9 @@ vy_check_is_unique_secondary_one(struct vy_tx *tx, const struct vy_read_view **r
  * @param index_name Index name.
  * @param lsm        LSM tree corresponding to the index.
  * @param stmt       New tuple.
+ * @param key_raw    Key of @a stmt extracted in a batch by the
+ *                   caller, or NULL to extract it here. Only for
+ *                   non-multikey indexes.
  *
  * @retval  0 Success, unique constraint is satisfied.
  * @retval -1 Duplicate is found or read error occurred.
@@ -1577,18 +1645,21 @@ vy_check_is_unique_secondary_one(struct vy_tx *tx, const struct vy_read_view **r
 static int
 vy_check_is_unique_secondary(struct vy_tx *tx, const struct vy_read_view **rv,
 			     const char *space_name, const char *index_name,
-			     struct vy_lsm *lsm, struct tuple *stmt)
+			     struct vy_lsm *lsm, struct tuple *stmt,
+			     const char *key_raw)
 {
 	assert(lsm->opts.is_unique);
 	if (!lsm->cmp_def->is_multikey) {
 		return vy_check_is_unique_secondary_one(tx, rv,
 				space_name, index_name, lsm, stmt,
-				MULTIKEY_NONE);
+				MULTIKEY_NONE, key_raw);
 	}
+	assert(key_raw == NULL);
 	int count = tuple_multikey_count(stmt, lsm->cmp_def);
 	for (int i = 0; i < count; ++i) {
 		if (vy_check_is_unique_secondary_one(tx, rv,
-				space_name, index_name, lsm, stmt, i) != 0)
+				space_name, index_name, lsm, stmt, i,
+				NULL) != 0)
 			return -1;
 	}
 	return 0;
@@ -1642,8 +1713,40 @@ vy_check_is_unique(struct vy_env *env, struct vy_tx *tx,
 
 	/*
 	 * For secondary indexes, uniqueness must be checked on both
-	 * INSERT and REPLACE.
+	 * INSERT and REPLACE. Extract the keys of all the indexes
+	 * to check in one batch first: one region allocation, and
+	 * a tuple field shared by several indexes is located once.
+	 * Multikey indexes are left to extract their keys per
+	 * multikey entry as before.
 	 */
+	struct key_def *defs[BOX_INDEX_MAX];
+	uint32_t iids[BOX_INDEX_MAX];
+	char *keys[BOX_INDEX_MAX];
+	uint32_t key_sizes[BOX_INDEX_MAX];
+	const char *raw_keys[BOX_INDEX_MAX] = {NULL};
+	uint32_t batch_count = 0;
+	for (uint32_t i = 1; i < space->index_count; i++) {
+		struct vy_lsm *lsm = vy_lsm(space->index[i]);
+		if (!space_needs_check_unique_constraint(space, lsm->index_id))
+			continue;
+		if (key_update_can_be_skipped(lsm->key_def->column_mask,
+					      column_mask))
+			continue;
+		if (lsm->cmp_def->is_multikey)
+			continue;
+		defs[batch_count] = lsm->key_def;
+		iids[batch_count] = i;
+		batch_count++;
+	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	if (batch_count > 0) {
+		if (tuple_extract_key_batch(stmt, defs, batch_count,
+					    keys, key_sizes) != 0)
+			return -1;
+		for (uint32_t k = 0; k < batch_count; k++)
+			raw_keys[iids[k]] = keys[k];
+	}
 	for (uint32_t i = 1; i < space->index_count; i++) {
 		struct vy_lsm *lsm = vy_lsm(space->index[i]);
 		if (!space_needs_check_unique_constraint(space, lsm->index_id))
@@ -1653,9 +1756,13 @@ vy_check_is_unique(struct vy_env *env, struct vy_tx *tx,
 			continue;
 		if (vy_check_is_unique_secondary(tx, rv, space_name(space),
 						 index_name_by_id(space, i),
-						 lsm, stmt) != 0)
+						 lsm, stmt,
+						 raw_keys[i]) != 0) {
+			region_truncate(region, region_svp);
 			return -1;
+		}
 	}
+	region_truncate(region, region_svp);
 	return 0;
 }
 
@@ -2551,7 +2658,7 @@ vy_squash_schedule(struct vy_lsm *lsm, struct vy_entry entry,
 		   void /* struct vy_env */ *arg);
 
 static struct vy_env *
-vy_env_new(const char *path, size_t memory,
+vy_env_new(const char *path, const char *cold_dir, size_t memory,
 	   int read_threads, int write_threads, bool force_recovery)
 {
 	struct vy_env *e = malloc(sizeof(*e));
@@ -2596,8 +2703,9 @@ vy_env_new(const char *path, size_t memory,
 	struct slab_cache *slab_cache = cord_slab_cache();
 	mempool_create(&e->iterator_pool, slab_cache,
 	               sizeof(struct vinyl_iterator));
+	mempool_registry_add(&e->iterator_pool, "vinyl.iterator");
 	vy_cache_env_create(&e->cache_env, slab_cache);
-	vy_run_env_create(&e->run_env, read_threads);
+	vy_run_env_create(&e->run_env, read_threads, write_threads, cold_dir);
 	vy_log_init(e->path);
 	return e;
 
@@ -2617,11 +2725,14 @@ error_path:
 static void
 vy_env_delete(struct vy_env *e)
 {
+	if (e->warmup_fiber != NULL)
+		fiber_cancel(e->warmup_fiber);
 	vy_regulator_destroy(&e->regulator);
 	vy_scheduler_destroy(&e->scheduler);
 	vy_squash_queue_delete(e->squash_queue);
 	tx_manager_delete(e->xm);
 	free(e->path);
+	mempool_registry_remove(&e->iterator_pool);
 	mempool_destroy(&e->iterator_pool);
 	vy_run_env_destroy(&e->run_env);
 	vy_lsm_env_destroy(&e->lsm_env);
@@ -2645,14 +2756,19 @@ vy_env_complete_recovery(struct vy_env *env)
 {
 	vy_scheduler_start(&env->scheduler);
 	vy_quota_enable(&env->quota);
+	/*
+	 * Seed the dump bandwidth estimate with the real device
+	 * bandwidth instead of the built-in guess. Best effort.
+	 */
+	vy_regulator_calibrate_bandwidth(&env->regulator, env->path);
 	vy_regulator_start(&env->regulator);
 }
 
 struct engine *
-vinyl_engine_new(const char *dir, size_t memory,
+vinyl_engine_new(const char *dir, const char *cold_dir, size_t memory,
 		 int read_threads, int write_threads, bool force_recovery)
 {
-	struct vy_env *env = vy_env_new(dir, memory, read_threads,
+	struct vy_env *env = vy_env_new(dir, cold_dir, memory, read_threads,
 					write_threads, force_recovery);
 	if (env == NULL)
 		return NULL;
@@ -2723,6 +2839,251 @@ vinyl_engine_set_snap_io_rate_limit(struct engine *engine, double limit)
 
 /** }}} Environment */
 
+/* {{{ Cache warmup */
+
+enum {
+	/** Max number of hot keys remembered per LSM tree. */
+	VY_HOTSET_KEYS_PER_LSM = 10000,
+	/** Max size of the hot set file, in bytes. */
+	VY_HOTSET_SIZE_MAX = 4 * 1024 * 1024,
+};
+
+/** Name of the hot set file, relative to the vinyl directory. */
+static const char VY_HOTSET_FILENAME[] = "hotset";
+
+/**
+ * Append a sample of the keys cached by an LSM tree to the hot
+ * set buffer, one msgpack row per key: [space_id, index_id, key].
+ * The sample is taken with an even stride over the cache tree so
+ * that it covers the whole key range, not just its beginning.
+ */
+static int
+vy_hotset_collect_lsm(struct vy_lsm *lsm, struct obuf *buf)
+{
+	struct vy_cache_tree *tree = &lsm->cache.cache_tree;
+	size_t count = vy_cache_tree_size(tree);
+	if (count == 0)
+		return 0;
+	uint32_t step = count / VY_HOTSET_KEYS_PER_LSM + 1;
+	uint32_t i = 0;
+	struct vy_cache_tree_iterator itr = vy_cache_tree_iterator_first(tree);
+	for (; !vy_cache_tree_iterator_is_invalid(&itr);
+	     vy_cache_tree_iterator_next(tree, &itr), i++) {
+		if (i % step != 0)
+			continue;
+		struct vy_cache_node **node =
+			vy_cache_tree_iterator_get_elem(tree, &itr);
+		struct tuple *key = vy_stmt_extract_key((*node)->entry.stmt,
+							lsm->cmp_def,
+							lsm->env->key_format,
+							MULTIKEY_NONE);
+		if (key == NULL)
+			return -1;
+		uint32_t key_size;
+		const char *key_data = tuple_data_range(key, &key_size);
+		size_t row_size = mp_sizeof_array(3) +
+				  mp_sizeof_uint(lsm->space_id) +
+				  mp_sizeof_uint(lsm->index_id) + key_size;
+		if (obuf_size(buf) + row_size > VY_HOTSET_SIZE_MAX) {
+			tuple_unref(key);
+			break;
+		}
+		char *p = obuf_alloc(buf, row_size);
+		if (p == NULL) {
+			diag_set(OutOfMemory, row_size, "obuf", "hot set row");
+			tuple_unref(key);
+			return -1;
+		}
+		p = mp_encode_array(p, 3);
+		p = mp_encode_uint(p, lsm->space_id);
+		p = mp_encode_uint(p, lsm->index_id);
+		memcpy(p, key_data, key_size);
+		tuple_unref(key);
+	}
+	return 0;
+}
+
+static int
+vy_hotset_collect_space(struct space *space, void *arg)
+{
+	struct obuf *buf = arg;
+	if (!space_is_vinyl(space))
+		return 0;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (vy_hotset_collect_lsm(vy_lsm(space->index[i]), buf) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Save a sample of the keys currently populating the tuple
+ * caches to a sidecar file in the vinyl directory, so that the
+ * next incarnation of the instance can rewarm the caches after
+ * restart. Failure only costs a cold start, so it is logged but
+ * never propagated to the caller.
+ */
+static void
+vy_hotset_save(struct vy_env *env)
+{
+	struct obuf buf;
+	obuf_create(&buf, &cord()->slabc, 16 * 1024);
+	if (space_foreach(vy_hotset_collect_space, &buf) != 0) {
+		say_warn("failed to collect vinyl hot keys: %s",
+			 diag_last_error(diag_get())->errmsg);
+		goto out;
+	}
+	if (obuf_size(&buf) == 0)
+		goto out;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", env->path, VY_HOTSET_FILENAME);
+	snprintf(tmp, sizeof(tmp), "%s%s", path, inprogress_suffix);
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		say_syserror("failed to create file '%s'", tmp);
+		goto out;
+	}
+	/*
+	 * The hot set is advisory, so the write is not synced:
+	 * should it get torn by a crash, the msgpack validation
+	 * on load will simply cut the replay short.
+	 */
+	if (fio_writevn(fd, buf.iov, buf.pos + 1) < 0) {
+		say_syserror("failed to write file '%s'", tmp);
+		close(fd);
+		unlink(tmp);
+		goto out;
+	}
+	close(fd);
+	if (rename(tmp, path) != 0) {
+		say_syserror("failed to rename file '%s'", tmp);
+		unlink(tmp);
+		goto out;
+	}
+	say_verbose("saved %zu bytes of vinyl hot keys to '%s'",
+		    obuf_size(&buf), path);
+out:
+	obuf_destroy(&buf);
+}
+
+/**
+ * Replay the hot key set saved by the previous incarnation of
+ * the instance: look every key up through the regular read path,
+ * which populates the tuple cache and pulls the corresponding
+ * run pages into the OS page cache. Runs in the background so
+ * that the instance is serving requests while it is warming up.
+ */
+static int
+vy_warmup_f(va_list ap)
+{
+	struct vy_env *env = va_arg(ap, struct vy_env *);
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", env->path, VY_HOTSET_FILENAME);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			say_syserror("failed to open file '%s'", path);
+		goto done;
+	}
+	char *buf = malloc(VY_HOTSET_SIZE_MAX);
+	if (buf == NULL) {
+		close(fd);
+		goto done;
+	}
+	ssize_t size = fio_read(fd, buf, VY_HOTSET_SIZE_MAX);
+	close(fd);
+	if (size < 0) {
+		say_syserror("failed to read file '%s'", path);
+		free(buf);
+		goto done;
+	}
+	int warmed = 0;
+	int loops = 0;
+	const char *p = buf;
+	const char *end = buf + size;
+	while (p < end && !fiber_is_cancelled()) {
+		const char *row = p;
+		if (mp_check(&p, end) != 0) {
+			say_warn("hot set file '%s' is truncated", path);
+			break;
+		}
+		if (mp_typeof(*row) != MP_ARRAY ||
+		    mp_decode_array(&row) != 3 ||
+		    mp_typeof(*row) != MP_UINT) {
+			say_warn("hot set file '%s' is corrupt", path);
+			break;
+		}
+		uint32_t space_id = mp_decode_uint(&row);
+		if (mp_typeof(*row) != MP_UINT) {
+			say_warn("hot set file '%s' is corrupt", path);
+			break;
+		}
+		uint32_t index_id = mp_decode_uint(&row);
+		if (mp_typeof(*row) != MP_ARRAY) {
+			say_warn("hot set file '%s' is corrupt", path);
+			break;
+		}
+		uint32_t part_count = mp_decode_array(&row);
+		/*
+		 * The schema may have changed since the hot set
+		 * was saved - quietly skip the keys that no
+		 * longer have a home.
+		 */
+		struct space *space = space_by_id(space_id);
+		if (space == NULL || !space_is_vinyl(space))
+			continue;
+		struct index *index = space_index(space, index_id);
+		if (index == NULL)
+			continue;
+		struct vy_lsm *lsm = vy_lsm(index);
+		if (part_count != lsm->cmp_def->part_count)
+			continue;
+		/* The LSM tree may be dropped while we yield. */
+		vy_lsm_ref(lsm);
+		struct tuple *result;
+		int rc = vy_get_by_raw_key(lsm, NULL,
+					   &env->xm->p_global_read_view,
+					   row, part_count, &result);
+		vy_lsm_unref(lsm);
+		if (rc != 0) {
+			say_warn("vinyl cache warmup failed: %s",
+				 diag_last_error(diag_get())->errmsg);
+			break;
+		}
+		if (result != NULL)
+			tuple_unref(result);
+		warmed++;
+		if (++loops % VY_YIELD_LOOPS == 0)
+			fiber_sleep(0);
+	}
+	free(buf);
+	say_info("vinyl cache warmup: replayed %d hot keys", warmed);
+done:
+	/*
+	 * Cancellation means the environment is being deleted,
+	 * in which case it must not be dereferenced anymore.
+	 */
+	if (!fiber_is_cancelled())
+		env->warmup_fiber = NULL;
+	return 0;
+}
+
+/** Start the cache warmup fiber upon recovery completion. */
+static void
+vy_warmup_start(struct vy_env *env)
+{
+	assert(env->warmup_fiber == NULL);
+	struct fiber *f = fiber_new("vinyl.warmup", vy_warmup_f);
+	if (f == NULL) {
+		diag_log();
+		return;
+	}
+	env->warmup_fiber = f;
+	fiber_start(f, env);
+}
+
+/* }}} Cache warmup */
+
 /* {{{ Checkpoint */
 
 static int
@@ -2763,6 +3124,7 @@ vinyl_engine_commit_checkpoint(struct engine *engine,
 	struct vy_env *env = vy_env(engine);
 	assert(env->status == VINYL_ONLINE);
 	vy_scheduler_end_checkpoint(&env->scheduler);
+	vy_hotset_save(env);
 }
 
 static void
@@ -2904,6 +3266,7 @@ vinyl_engine_end_recovery(struct engine *engine)
 		vy_run_env_enable_coio(&e->run_env);
 
 	e->status = VINYL_ONLINE;
+	vy_warmup_start(e);
 	return 0;
 }
 
@@ -3044,6 +3407,11 @@ vy_gc_run(struct vy_env *env,
 	if (vy_run_remove_files(env->path, lsm_info->space_id,
 				lsm_info->index_id, run_info->id) != 0)
 		return;
+	/* An offloaded run keeps its files in the cold directory. */
+	if (env->run_env.cold_dir != NULL &&
+	    vy_run_remove_files(env->run_env.cold_dir, lsm_info->space_id,
+				lsm_info->index_id, run_info->id) != 0)
+		return;
 
 	/* Forget the run on success. */
 	vy_log_tx_begin();
@@ -3189,13 +3557,19 @@ vinyl_engine_backup(struct engine *engine, const struct vclock *vclock,
 			char path[PATH_MAX];
 			for (int type = 0; type < vy_file_MAX; type++) {
 				if (type == VY_FILE_RUN_INPROGRESS ||
-				    type == VY_FILE_INDEX_INPROGRESS)
+				    type == VY_FILE_INDEX_INPROGRESS ||
+				    type == VY_FILE_BLOOM_INPROGRESS)
 					continue;
 				vy_run_snprint_path(path, sizeof(path),
 						    env->path,
 						    lsm_info->space_id,
 						    lsm_info->index_id,
 						    run_info->id, type);
+				if (type == VY_FILE_BLOOM &&
+				    access(path, F_OK) != 0) {
+					/* Old runs have no bloom file. */
+					continue;
+				}
 				rc = cb(path, cb_arg);
 				if (rc != 0)
 					goto out;
@@ -3526,6 +3900,12 @@ vinyl_iterator_primary_next(struct iterator *base, struct tuple **ret)
 
 	assert(base->next = vinyl_iterator_primary_next);
 	struct vinyl_iterator *it = (struct vinyl_iterator *)base;
+	/*
+	 * The scan length hint is set after the iterator has been
+	 * created, so refresh it on every step - disk sources are
+	 * (re)opened lazily and pick it up then.
+	 */
+	it->iterator.scan_estimate = base->scan_estimate;
 	struct vy_lsm *lsm = it->iterator.lsm;
 	assert(lsm->index_id == 0);
 	/*
@@ -3564,6 +3944,7 @@ vinyl_iterator_secondary_next(struct iterator *base, struct tuple **ret)
 
 	assert(base->next = vinyl_iterator_secondary_next);
 	struct vinyl_iterator *it = (struct vinyl_iterator *)base;
+	it->iterator.scan_estimate = base->scan_estimate;
 	struct vy_lsm *lsm = it->iterator.lsm;
 	assert(lsm->index_id > 0);
 	/*
@@ -3826,7 +4207,7 @@ vy_build_on_replace(struct trigger *trigger, void *event)
 	if (ctx->check_unique_constraint && stmt->new_tuple != NULL &&
 	    vy_check_is_unique_secondary(tx, vy_tx_read_view(tx),
 					 ctx->space_name, ctx->index_name,
-					 lsm, stmt->new_tuple) != 0)
+					 lsm, stmt->new_tuple, NULL) != 0)
 		goto err;
 
 	/* Forward the statement to the new LSM tree. */
@@ -3941,7 +4322,7 @@ vy_build_insert_tuple(struct vy_env *env, struct vy_lsm *lsm,
 		vy_mem_pin(mem);
 		rc = vy_check_is_unique_secondary(NULL,
 				&env->xm->p_committed_read_view,
-				space_name, index_name, lsm, stmt);
+				space_name, index_name, lsm, stmt, NULL);
 		vy_mem_unpin(mem);
 		if (rc != 0) {
 			tuple_unref(stmt);
@@ -4543,7 +4924,9 @@ static const struct index_vtab vinyl_index_vtab = {
 	/* .max = */ generic_index_max,
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
+	/* .split = */ generic_index_split,
 	/* .get = */ vinyl_index_get,
+	/* .get_multi = */ generic_index_get_multi,
 	/* .replace = */ generic_index_replace,
 	/* .create_iterator = */ vinyl_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -47,16 +47,26 @@ enum {
 	/* Flag in cache node that means that there are no values in DB
 	 * that greater than the current and less than the previous */
 	VY_CACHE_RIGHT_LINKED = 2,
+	/* Flag in cache node that means that the node is in the protected
+	 * LRU list, i.e. it was accessed repeatedly and must survive
+	 * one-off scans, which fill only the probationary LRU list */
+	VY_CACHE_PROTECTED = 4,
 	/* Max number of deletes that are made by cleanup action per one
 	 * cache operation */
 	VY_CACHE_CLEANUP_MAX_STEPS = 10,
+	/* Share of the memory quota the protected LRU list may occupy,
+	 * in percent. The rest is left to the probationary list so that
+	 * scans always have somewhere to go without evicting the hot set */
+	VY_CACHE_PROTECTED_PERCENT = 80,
 };
 
 void
 vy_cache_env_create(struct vy_cache_env *e, struct slab_cache *slab_cache)
 {
 	rlist_create(&e->cache_lru);
+	rlist_create(&e->cache_protected_lru);
 	e->mem_used = 0;
+	e->mem_used_protected = 0;
 	e->mem_quota = 0;
 	mempool_create(&e->cache_node_mempool, slab_cache,
 		       sizeof(struct vy_cache_node));
@@ -107,6 +117,10 @@ vy_cache_node_delete(struct vy_cache_env *env, struct vy_cache_node *node)
 	vy_stmt_counter_unacct_tuple(&node->cache->stat.count,
 				     node->entry.stmt);
 	assert(env->mem_used >= vy_cache_node_size(node));
+	if (node->flags & VY_CACHE_PROTECTED) {
+		assert(env->mem_used_protected >= vy_cache_node_size(node));
+		env->mem_used_protected -= vy_cache_node_size(node);
+	}
 	env->mem_used -= vy_cache_node_size(node);
 	tuple_unref(node->entry.stmt);
 	rlist_del(&node->in_lru);
@@ -114,6 +128,53 @@ vy_cache_node_delete(struct vy_cache_env *env, struct vy_cache_node *node)
 	mempool_free(&env->cache_node_mempool, node);
 }
 
+/**
+ * Move a node to the head of the protected LRU list. Nodes are
+ * only evicted from there when the probationary list is drained,
+ * so a one-off scan, which fills the probationary list only, can
+ * not push the hot working set out of the cache.
+ */
+static void
+vy_cache_node_protect(struct vy_cache_env *env, struct vy_cache_node *node)
+{
+	rlist_move(&env->cache_protected_lru, &node->in_lru);
+	if (node->flags & VY_CACHE_PROTECTED)
+		return;
+	node->flags |= VY_CACHE_PROTECTED;
+	env->mem_used_protected += vy_cache_node_size(node);
+	/*
+	 * Don't let the protected list take over the whole quota -
+	 * demote its coldest nodes back to the probationary list
+	 * so that they compete with scan data for eviction.
+	 */
+	size_t protected_quota = env->mem_quota / 100 *
+				 VY_CACHE_PROTECTED_PERCENT;
+	while (env->mem_used_protected > protected_quota) {
+		struct vy_cache_node *victim =
+			rlist_last_entry(&env->cache_protected_lru,
+					 struct vy_cache_node, in_lru);
+		victim->flags &= ~VY_CACHE_PROTECTED;
+		assert(env->mem_used_protected >= vy_cache_node_size(victim));
+		env->mem_used_protected -= vy_cache_node_size(victim);
+		rlist_move(&env->cache_lru, &victim->in_lru);
+		vy_stmt_counter_acct_tuple(&victim->cache->stat.demote,
+					   victim->entry.stmt);
+	}
+}
+
+/**
+ * Account a repeated access to a cache node and promote it to
+ * the protected LRU list.
+ */
+static void
+vy_cache_node_touch(struct vy_cache_env *env, struct vy_cache_node *node)
+{
+	if ((node->flags & VY_CACHE_PROTECTED) == 0)
+		vy_stmt_counter_acct_tuple(&node->cache->stat.promote,
+					   node->entry.stmt);
+	vy_cache_node_protect(env, node);
+}
+
 static void *
 vy_cache_tree_page_alloc(void *ctx)
 {
@@ -166,7 +227,13 @@ vy_cache_destroy(struct vy_cache *cache)
 static void
 vy_cache_gc_step(struct vy_cache_env *env)
 {
+	/*
+	 * Evict from the probationary list first and touch the
+	 * protected list only when there is nothing else left.
+	 */
 	struct rlist *lru = &env->cache_lru;
+	if (rlist_empty(lru))
+		lru = &env->cache_protected_lru;
 	struct vy_cache_node *node =
 		rlist_last_entry(lru, struct vy_cache_node, in_lru);
 	struct vy_cache *cache = node->cache;
@@ -317,9 +384,12 @@ vy_cache_add(struct vy_cache *cache, struct vy_entry curr,
 	}
 	assert(!vy_cache_tree_iterator_is_invalid(&inserted));
 	if (replaced != NULL) {
-		node->flags = replaced->flags;
+		node->flags = replaced->flags & ~VY_CACHE_PROTECTED;
 		node->left_boundary_level = replaced->left_boundary_level;
 		node->right_boundary_level = replaced->right_boundary_level;
+		/* Replacement of a hot statement keeps it hot. */
+		if (replaced->flags & VY_CACHE_PROTECTED)
+			vy_cache_node_protect(cache->env, node);
 		vy_cache_node_delete(cache->env, replaced);
 	}
 	if (direction > 0 && boundary_level < node->left_boundary_level)
@@ -403,9 +473,11 @@ vy_cache_add(struct vy_cache *cache, struct vy_entry curr,
 		return;
 	}
 	if (replaced != NULL) {
-		prev_node->flags = replaced->flags;
+		prev_node->flags = replaced->flags & ~VY_CACHE_PROTECTED;
 		prev_node->left_boundary_level = replaced->left_boundary_level;
 		prev_node->right_boundary_level = replaced->right_boundary_level;
+		if (replaced->flags & VY_CACHE_PROTECTED)
+			vy_cache_node_protect(cache->env, prev_node);
 		vy_cache_node_delete(cache->env, replaced);
 	}
 
@@ -423,6 +495,7 @@ vy_cache_get(struct vy_cache *cache, struct vy_entry key)
 		vy_cache_tree_find(&cache->cache_tree, key);
 	if (node == NULL)
 		return vy_entry_none();
+	vy_cache_node_touch(cache->env, *node);
 	return (*node)->entry;
 }
 
@@ -694,6 +767,26 @@ vy_cache_iterator_seek(struct vy_cache_iterator *itr, struct vy_entry last)
 	return vy_cache_iterator_is_stop(itr, node);
 }
 
+/**
+ * Account a cache hit on the current iterator position. Only EQ
+ * lookups promote the node to the protected LRU list: a range
+ * scan touches each node exactly once, and promoting on such
+ * accesses would let a full-index scan flush the hot set out of
+ * the protected list.
+ */
+static void
+vy_cache_iterator_acct_get(struct vy_cache_iterator *itr)
+{
+	vy_stmt_counter_acct_tuple(&itr->cache->stat.get, itr->curr.stmt);
+	if (itr->iterator_type != ITER_EQ)
+		return;
+	struct vy_cache_tree *tree = &itr->cache->cache_tree;
+	struct vy_cache_node **node =
+		vy_cache_tree_iterator_get_elem(tree, &itr->curr_pos);
+	assert(node != NULL && *node != NULL);
+	vy_cache_node_touch(itr->cache->env, *node);
+}
+
 NODISCARD int
 vy_cache_iterator_next(struct vy_cache_iterator *itr,
 		       struct vy_history *history, bool *stop)
@@ -714,8 +807,7 @@ vy_cache_iterator_next(struct vy_cache_iterator *itr,
 
 	vy_cache_iterator_skip_to_read_view(itr, stop);
 	if (itr->curr.stmt != NULL) {
-		vy_stmt_counter_acct_tuple(&itr->cache->stat.get,
-					   itr->curr.stmt);
+		vy_cache_iterator_acct_get(itr);
 		return vy_history_append_stmt(history, itr->curr);
 	}
 	return 0;
@@ -745,8 +837,7 @@ vy_cache_iterator_skip(struct vy_cache_iterator *itr, struct vy_entry last,
 	vy_cache_iterator_skip_to_read_view(itr, stop);
 
 	if (itr->curr.stmt != NULL) {
-		vy_stmt_counter_acct_tuple(&itr->cache->stat.get,
-					   itr->curr.stmt);
+		vy_cache_iterator_acct_get(itr);
 		return vy_history_append_stmt(history, itr->curr);
 	}
 	return 0;
@@ -824,8 +915,7 @@ vy_cache_iterator_restore(struct vy_cache_iterator *itr, struct vy_entry last,
 
 	vy_history_cleanup(history);
 	if (itr->curr.stmt != NULL) {
-		vy_stmt_counter_acct_tuple(&itr->cache->stat.get,
-					   itr->curr.stmt);
+		vy_cache_iterator_acct_get(itr);
 		if (vy_history_append_stmt(history, itr->curr) != 0)
 			return -1;
 	}
@@ -56,10 +56,10 @@ struct vy_cache_node {
 	struct vy_cache *cache;
 	/* Statement in cache */
 	struct vy_entry entry;
-	/* Link in LRU list */
+	/* Link in probationary or protected LRU list */
 	struct rlist in_lru;
-	/* VY_CACHE_LEFT_LINKED and/or VY_CACHE_RIGHT_LINKED, see
-	 * description of them for more information */
+	/* Combination of VY_CACHE_* flags, see description of them
+	 * for more information */
 	uint32_t flags;
 	/* Number of parts in key when the value was the first in EQ search */
 	uint8_t left_boundary_level;
@@ -115,12 +115,26 @@ vy_cache_tree_key_cmp(struct vy_cache_node *a, struct vy_entry b,
  * Environment of the cache
  */
 struct vy_cache_env {
-	/** Common LRU list of read cache. The first element is the newest */
+	/**
+	 * Common probationary LRU list of read cache. A statement
+	 * gets here when it is added to the cache and is the first
+	 * candidate for eviction, so a one-off scan can not wash
+	 * out the hot working set, which lives in the protected
+	 * list. The first element is the newest.
+	 */
 	struct rlist cache_lru;
+	/**
+	 * Common protected LRU list of read cache. A statement is
+	 * promoted here from the probationary list on repeated
+	 * access. The first element is the newest.
+	 */
+	struct rlist cache_protected_lru;
 	/** Common mempool for vy_cache_node struct */
 	struct mempool cache_node_mempool;
 	/** Size of memory occupied by cached tuples */
 	size_t mem_used;
+	/** Part of mem_used occupied by the protected list. */
+	size_t mem_used_protected;
 	/** Max memory size that can be used for cache */
 	size_t mem_quota;
 };
@@ -695,6 +695,15 @@ vy_lsm_compaction_priority(struct vy_lsm *lsm)
 	return range->compaction_priority;
 }
 
+uint64_t
+vy_lsm_compaction_weight(struct vy_lsm *lsm)
+{
+	struct vy_range *range = vy_range_heap_top(&lsm->range_heap);
+	if (range == NULL)
+		return 0;
+	return range->compaction_weight;
+}
+
 int64_t
 vy_lsm_range_size(struct vy_lsm *lsm)
 {
@@ -803,6 +812,10 @@ vy_lsm_acct_range(struct vy_lsm *lsm, struct vy_range *range)
 	vy_disk_stmt_counter_add(&lsm->stat.disk.compaction.queue,
 				 &range->compaction_queue);
 	lsm->env->compaction_queue_size += range->compaction_queue.bytes;
+	if (range->compaction_weight > (uint64_t)range->compaction_priority) {
+		lsm->env->compaction_queue_hot_size +=
+			range->compaction_queue.bytes;
+	}
 	if (!rlist_empty(&range->slices)) {
 		struct vy_slice *slice = rlist_last_entry(&range->slices,
 						struct vy_slice, in_range);
@@ -821,6 +834,10 @@ vy_lsm_unacct_range(struct vy_lsm *lsm, struct vy_range *range)
 	vy_disk_stmt_counter_sub(&lsm->stat.disk.compaction.queue,
 				 &range->compaction_queue);
 	lsm->env->compaction_queue_size -= range->compaction_queue.bytes;
+	if (range->compaction_weight > (uint64_t)range->compaction_priority) {
+		lsm->env->compaction_queue_hot_size -=
+			range->compaction_queue.bytes;
+	}
 	if (!rlist_empty(&range->slices)) {
 		struct vy_slice *slice = rlist_last_entry(&range->slices,
 						struct vy_slice, in_range);
@@ -1113,9 +1130,16 @@ vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range)
 {
 	struct tuple_format *key_format = lsm->env->key_format;
 
+	/*
+	 * If all writes funnel into the rightmost range, split it
+	 * closer to its tail so that compaction of the cold bulk
+	 * of the data doesn't serialize with the write frontier.
+	 */
+	bool tail_split = vy_lsm_is_append_mostly(lsm) &&
+			  range->end.stmt == NULL;
 	const char *split_key_raw;
 	if (!vy_range_needs_split(range, vy_lsm_range_size(lsm),
-				  &split_key_raw))
+				  tail_split, &split_key_raw))
 		return false;
 
 	/* Split a range in two parts. */
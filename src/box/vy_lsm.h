@@ -64,6 +64,12 @@ struct vy_run_env;
 typedef void
 (*vy_upsert_thresh_cb)(struct vy_lsm *lsm, struct vy_entry entry, void *arg);
 
+/**
+ * Number of tail-heavy memory dumps in a row it takes to consider
+ * an LSM tree workload append-mostly.
+ */
+enum { VY_APPEND_DUMP_STREAK = 2 };
+
 /** Common LSM tree environment. */
 struct vy_lsm_env {
 	/** Path to the data directory. */
@@ -124,6 +130,13 @@ struct vy_lsm_env {
 	 * in bytes, without taking into account disk compression.
 	 */
 	int64_t compaction_queue_size;
+	/**
+	 * Size of the part of the compaction queue that sits in
+	 * hot ranges, i.e. ranges whose scheduling weight was
+	 * boosted by lookups, in bytes. Shows how much of the
+	 * queue the scheduler considers urgent.
+	 */
+	int64_t compaction_queue_hot_size;
 	/** Memory pool for vy_history_node allocations. */
 	struct mempool history_node_pool;
 };
@@ -248,6 +261,15 @@ struct vy_lsm {
 	int range_count;
 	/** Sum dumps_per_compaction across all ranges. */
 	int sum_dumps_per_compaction;
+	/**
+	 * Number of memory dumps in a row in which almost all
+	 * statements landed in the rightmost range. Reset as soon
+	 * as a dump spreads statements more evenly. Once it
+	 * reaches VY_APPEND_DUMP_STREAK, the workload is assumed
+	 * to append monotonically growing keys and range splitting
+	 * switches to tail-biased mode, see vy_lsm_split_range().
+	 */
+	int append_dump_streak;
 	/** Heap of ranges, prioritized by compaction_priority. */
 	heap_t range_heap;
 	/**
@@ -371,6 +393,17 @@ vy_lsm_dumps_per_compaction(struct vy_lsm *lsm)
 	return lsm->sum_dumps_per_compaction / lsm->range_count;
 }
 
+/**
+ * Return true if the LSM tree writes keep landing in its rightmost
+ * range, i.e. the space is populated with monotonically growing
+ * keys. See vy_lsm::append_dump_streak.
+ */
+static inline bool
+vy_lsm_is_append_mostly(struct vy_lsm *lsm)
+{
+	return lsm->append_dump_streak >= VY_APPEND_DUMP_STREAK;
+}
+
 /**
  * Increment the reference counter of an LSM tree.
  * An LSM tree cannot be deleted if its reference
@@ -452,10 +485,14 @@ vy_lsm_recover(struct vy_lsm *lsm, struct vy_recovery *recovery,
 int64_t
 vy_lsm_generation(struct vy_lsm *lsm);
 
-/** Return max compaction_priority among ranges of an LSM tree. */
+/** Return compaction_priority of the next range to compact. */
 int
 vy_lsm_compaction_priority(struct vy_lsm *lsm);
 
+/** Return max compaction_weight among ranges of an LSM tree. */
+uint64_t
+vy_lsm_compaction_weight(struct vy_lsm *lsm);
+
 /** Return the target size of a range in an LSM tree. */
 int64_t
 vy_lsm_range_size(struct vy_lsm *lsm);
@@ -136,6 +136,23 @@ vy_point_lookup_scan_slice(struct vy_lsm *lsm, struct vy_slice *slice,
 			   const struct vy_read_view **rv, struct vy_entry key,
 			   struct vy_history *history)
 {
+	/*
+	 * Flat pre-filter on RAM-resident run metadata: a key
+	 * outside [min_key, max_key] of the run can't be in the
+	 * slice. Unlike the slice bounds, which normally coincide
+	 * with the range bounds the key was already matched
+	 * against, the run extent tells where the run actually has
+	 * data. Filtering here skips the iterator setup and, what
+	 * is more important, the bloom filter probe, which hashes
+	 * the key and may fault in pages of the bloom file mapping.
+	 */
+	struct vy_run_info *run_info = &slice->run->info;
+	assert(run_info->min_key != NULL && run_info->max_key != NULL);
+	if (vy_entry_compare_with_raw_key(key, run_info->min_key, HINT_NONE,
+					  lsm->cmp_def) < 0 ||
+	    vy_entry_compare_with_raw_key(key, run_info->max_key, HINT_NONE,
+					  lsm->cmp_def) > 0)
+		return 0;
 	/*
 	 * The format of the statement must be exactly the space
 	 * format with the same identifier to fully match the
@@ -166,6 +183,8 @@ vy_point_lookup_scan_slices(struct vy_lsm *lsm, const struct vy_read_view **rv,
 	struct vy_range *range = vy_range_tree_find_by_key(&lsm->range_tree,
 							   ITER_EQ, key);
 	assert(range != NULL);
+	/* Account the disk probes for compaction scheduling. */
+	range->lookups += range->slice_count;
 	int slice_count = range->slice_count;
 	struct vy_slice **slices = (struct vy_slice **)
 		region_alloc(&fiber()->gc, slice_count * sizeof(*slices));
@@ -261,6 +261,28 @@ vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice)
 	range->version++;
 }
 
+/**
+ * Scheduling weight of a range: the number of runs its compaction
+ * would merge, scaled by the binary logarithm of the number of run
+ * probes the range has served since its last compaction. A range
+ * nobody reads keeps its plain priority while a range serving
+ * millions of lookups gets a ~20x boost, so the scheduler removes
+ * read amplification where it is actually paid for. A range with
+ * compaction_priority <= 1 must keep zero weight: it can not be
+ * usefully compacted, and the scheduler relies on a positive top
+ * weight implying a compactable range at the heap top.
+ */
+static uint64_t
+vy_range_compaction_weight(struct vy_range *range)
+{
+	if (range->compaction_priority <= 1)
+		return 0;
+	uint64_t boost = 1;
+	for (uint64_t n = range->lookups; n > 0; n >>= 1)
+		boost++;
+	return (uint64_t)range->compaction_priority * boost;
+}
+
 /**
  * To reduce write amplification caused by compaction, we follow
  * the LSM tree design. Runs in each range are divided into groups
@@ -297,12 +319,14 @@ vy_range_update_compaction_priority(struct vy_range *range,
 	if (range->slice_count <= 1) {
 		/* Nothing to compact. */
 		range->needs_compaction = false;
+		range->compaction_weight = 0;
 		return;
 	}
 
 	if (range->needs_compaction) {
 		range->compaction_priority = range->slice_count;
 		range->compaction_queue = range->count;
+		range->compaction_weight = vy_range_compaction_weight(range);
 		return;
 	}
 
@@ -423,6 +447,29 @@ vy_range_update_compaction_priority(struct vy_range *range,
 		range->compaction_priority = total_run_count;
 		range->compaction_queue = total_stmt_count;
 	}
+	/*
+	 * Never compact a range eagerly if all its slices are
+	 * backed by runs offloaded to the cold storage tier:
+	 * compaction would read the cold files back and write
+	 * the result to the primary directory, defeating the
+	 * offload. Such a range can still be compacted by an
+	 * explicit major compaction request, which is handled
+	 * above, before this check.
+	 */
+	if (range->compaction_priority > 0) {
+		bool all_cold = true;
+		rlist_foreach_entry(slice, &range->slices, in_range) {
+			if (!slice->run->is_cold) {
+				all_cold = false;
+				break;
+			}
+		}
+		if (all_cold) {
+			range->compaction_priority = 0;
+			vy_disk_stmt_counter_reset(&range->compaction_queue);
+		}
+	}
+	range->compaction_weight = vy_range_compaction_weight(range);
 }
 
 void
@@ -449,10 +496,16 @@ vy_range_update_dumps_per_compaction(struct vy_range *range)
  * - We should split around the last run middle key.
  * - We should only split if the last run size is greater than
  *   4/3 * range_size.
+ *
+ * With @tail_split set, the split key is taken at 7/8 of the run
+ * instead of the middle: for monotonically growing keys everything
+ * below the write frontier is immutable, so the left part goes
+ * cold after one final compaction while the small right part keeps
+ * up with new writes.
  */
 bool
 vy_range_needs_split(struct vy_range *range, int64_t range_size,
-		     const char **p_split_key)
+		     bool tail_split, const char **p_split_key)
 {
 	struct vy_slice *slice;
 
@@ -468,11 +521,12 @@ vy_range_needs_split(struct vy_range *range, int64_t range_size,
 	if (slice->count.bytes < range_size * 4 / 3)
 		return false;
 
-	/* Find the median key in the oldest run (approximately). */
+	/* Find the split key in the oldest run (approximately). */
+	uint32_t page_span = slice->last_page_no - slice->first_page_no;
+	uint32_t split_page_no = slice->first_page_no +
+		(tail_split ? page_span / 8 * 7 : page_span / 2);
 	struct vy_page_info *mid_page;
-	mid_page = vy_run_page_info(slice->run, slice->first_page_no +
-				    (slice->last_page_no -
-				     slice->first_page_no) / 2);
+	mid_page = vy_run_page_info(slice->run, split_page_no);
 
 	struct vy_page_info *first_page = vy_run_page_info(slice->run,
 						slice->first_page_no);
@@ -124,6 +124,20 @@ struct vy_range {
 	 * this range, see vy_run::dump_count for more details.
 	 */
 	int dumps_per_compaction;
+	/**
+	 * Number of run probes served by the range since it was
+	 * last compacted: every point lookup or range scan that
+	 * descends to disk in this range adds slice_count. Used
+	 * to weight compaction scheduling towards hot ranges.
+	 */
+	uint64_t lookups;
+	/**
+	 * Scheduling weight of the range: compaction_priority
+	 * boosted by the access frequency, see
+	 * vy_range_update_compaction_priority(). Zero if the
+	 * range does not need to be compacted.
+	 */
+	uint64_t compaction_weight;
 	/** Link in vy_lsm->tree. */
 	rb_node(struct vy_range) tree_node;
 	/** Link in vy_lsm->range_heap. */
@@ -137,13 +151,13 @@ struct vy_range {
 
 /**
  * Heap of all ranges of the same LSM tree, prioritized by
- * vy_range->compaction_priority.
+ * vy_range->compaction_weight.
  */
 #define HEAP_NAME vy_range_heap
 static inline bool
 vy_range_heap_less(struct vy_range *r1, struct vy_range *r2)
 {
-	return r1->compaction_priority > r2->compaction_priority;
+	return r1->compaction_weight > r2->compaction_weight;
 }
 #define HEAP_LESS(h, l, r) vy_range_heap_less(l, r)
 #define heap_value_t struct vy_range
@@ -258,13 +272,18 @@ vy_range_update_dumps_per_compaction(struct vy_range *range);
  *
  * @param range             The range.
  * @param range_size        Target range size.
+ * @param tail_split        Bias the split key towards the end of
+ *                          the range. Used for the rightmost range
+ *                          of an append-mostly LSM tree so that
+ *                          the bulk of the data goes to the part
+ *                          that won't see any more writes.
  * @param[out] p_split_key  Key to split the range by.
  *
  * @retval true             If the range needs to be split.
  */
 bool
 vy_range_needs_split(struct vy_range *range, int64_t range_size,
-		     const char **p_split_key);
+		     bool tail_split, const char **p_split_key);
 
 /**
  * Check if a range needs to be coalesced with adjacent
@@ -612,6 +612,15 @@ vy_read_iterator_add_mem(struct vy_read_iterator *itr)
 	}
 }
 
+enum {
+	/**
+	 * Scan length estimate, in statements, beyond which disk
+	 * sources open their readahead window at the maximum
+	 * right away, see vy_run_iterator::bulk_scan.
+	 */
+	VY_BULK_SCAN_THRESHOLD = 1000,
+};
+
 static void
 vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 {
@@ -632,6 +641,8 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 				     iterator_type, itr->key,
 				     itr->read_view, lsm->cmp_def,
 				     lsm->key_def, lsm->disk_format);
+		sub_src->run_iterator.bulk_scan =
+			itr->scan_estimate >= VY_BULK_SCAN_THRESHOLD;
 	}
 }
 
@@ -735,6 +746,8 @@ vy_read_iterator_restore(struct vy_read_iterator *itr)
 						    itr->last.stmt != NULL ?
 						    itr->last : itr->key);
 	itr->range_version = itr->curr_range->version;
+	/* Account the disk probes for compaction scheduling. */
+	itr->curr_range->lookups += itr->curr_range->slice_count;
 
 	if (itr->tx != NULL) {
 		itr->txw_src = itr->src_count;
@@ -785,6 +798,8 @@ vy_read_iterator_next_range(struct vy_read_iterator *itr)
 	}
 	itr->curr_range = range;
 	itr->range_version = range->version;
+	/* Account the disk probes for compaction scheduling. */
+	range->lookups += range->slice_count;
 
 	for (uint32_t i = itr->disk_src; i < itr->src_count; i++) {
 		struct vy_read_src *src = &itr->src[i];
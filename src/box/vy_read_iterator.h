@@ -118,6 +118,13 @@ struct vy_read_iterator {
 	 * front_id from the previous iteration.
 	 */
 	uint32_t prev_front_id;
+	/**
+	 * Expected number of statements the scan will visit, 0
+	 * when unknown. Copied from the caller's hint, see
+	 * iterator::scan_estimate, and consulted when disk
+	 * sources are opened.
+	 */
+	uint64_t scan_estimate;
 };
 
 /**
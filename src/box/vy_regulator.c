@@ -30,6 +30,7 @@
  */
 #include "vy_regulator.h"
 
+#include <fcntl.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -37,6 +38,7 @@
 #include <string.h>
 #include <tarantool_ev.h>
 
+#include "coio_file.h"
 #include "fiber.h"
 #include "histogram.h"
 #include "say.h"
@@ -83,6 +85,37 @@ static const size_t VY_DUMP_SIZE_ACCT_MIN = 1024 * 1024;
  */
 static const int VY_RECENT_DUMP_COUNT = 100;
 
+/**
+ * Size of the test file written by the bandwidth calibration
+ * pass, and of a single write to it. The file must be large
+ * enough to get past the write-back burst of the device, yet
+ * small enough not to prolong startup noticeably.
+ */
+static const size_t VY_CALIBRATION_SIZE = 64 * 1024 * 1024;
+static const size_t VY_CALIBRATION_CHUNK = 1024 * 1024;
+
+/**
+ * The dump bandwidth estimate to use for throttling decisions.
+ *
+ * The lower-bound percentile estimate is deliberately cautious:
+ * mispredicting the dump duration when transactions write at
+ * full speed ends in an unpredictably long stall. But when the
+ * observed transaction write rate is only a fraction of the
+ * estimated bandwidth, the hard limit can not be reached before
+ * the dump completes even if the estimate is optimistic, so let
+ * the dump run against the calibrated device bandwidth instead
+ * and leave transactions unthrottled up to it.
+ */
+static size_t
+vy_regulator_burst_bandwidth(struct vy_regulator *regulator)
+{
+	size_t bandwidth = regulator->dump_bandwidth;
+	if (regulator->calibrated_bandwidth > bandwidth &&
+	    regulator->write_rate < bandwidth / 2)
+		bandwidth = regulator->calibrated_bandwidth;
+	return bandwidth;
+}
+
 static void
 vy_regulator_trigger_dump(struct vy_regulator *regulator)
 {
@@ -105,19 +138,20 @@ vy_regulator_trigger_dump(struct vy_regulator *regulator)
 	 *   write_rate    dump_bandwidth
 	 */
 	struct vy_quota *quota = regulator->quota;
+	size_t bandwidth = vy_regulator_burst_bandwidth(regulator);
 	size_t mem_left = (quota->used < quota->limit ?
 			   quota->limit - quota->used : 0);
 	size_t mem_used = quota->used;
 	size_t max_write_rate = (double)mem_left / (mem_used + 1) *
-					regulator->dump_bandwidth;
-	max_write_rate = MIN(max_write_rate, regulator->dump_bandwidth);
+					bandwidth;
+	max_write_rate = MIN(max_write_rate, bandwidth);
 	vy_quota_set_rate_limit(quota, VY_QUOTA_RESOURCE_MEMORY,
 				max_write_rate);
 
 	say_info("dumping %zu bytes, expected rate %.1f MB/s, "
 		 "ETA %.1f s, write rate (avg/max) %.1f/%.1f MB/s",
-		 quota->used, (double)regulator->dump_bandwidth / 1024 / 1024,
-		 (double)quota->used / (regulator->dump_bandwidth + 1),
+		 quota->used, (double)bandwidth / 1024 / 1024,
+		 (double)quota->used / (bandwidth + 1),
 		 (double)regulator->write_rate / 1024 / 1024,
 		 (double)regulator->write_rate_max / 1024 / 1024);
 
@@ -278,6 +312,7 @@ vy_regulator_dump_complete(struct vy_regulator *regulator,
 		 */
 		regulator->dump_bandwidth = histogram_percentile_lower(
 			regulator->dump_bandwidth_hist, VY_DUMP_BANDWIDTH_PCT);
+		regulator->dump_bandwidth_measured = true;
 	}
 
 	/*
@@ -289,7 +324,7 @@ vy_regulator_dump_complete(struct vy_regulator *regulator,
 	 * completely.
 	 */
 	vy_quota_set_rate_limit(regulator->quota, VY_QUOTA_RESOURCE_MEMORY,
-				regulator->dump_bandwidth);
+				vy_regulator_burst_bandwidth(regulator));
 
 	say_info("dumped %zu bytes in %.1f s, rate %.1f MB/s",
 		 mem_dumped, dump_duration,
@@ -308,8 +343,14 @@ vy_regulator_reset_dump_bandwidth(struct vy_regulator *regulator, size_t max)
 {
 	histogram_reset(regulator->dump_bandwidth_hist);
 	regulator->dump_bandwidth = VY_DUMP_BANDWIDTH_DEFAULT;
-	if (max > 0 && regulator->dump_bandwidth > max)
-		regulator->dump_bandwidth = max;
+	regulator->dump_bandwidth_measured = false;
+	if (max > 0) {
+		if (regulator->dump_bandwidth > max)
+			regulator->dump_bandwidth = max;
+		/* Do not let burst mode bypass snap_io_rate_limit. */
+		if (regulator->calibrated_bandwidth > max)
+			regulator->calibrated_bandwidth = max;
+	}
 	vy_quota_set_rate_limit(regulator->quota, VY_QUOTA_RESOURCE_MEMORY,
 				regulator->dump_bandwidth);
 }
@@ -321,6 +362,72 @@ vy_regulator_reset_stat(struct vy_regulator *regulator)
 	       sizeof(regulator->sched_stat_last));
 }
 
+int
+vy_regulator_calibrate_bandwidth(struct vy_regulator *regulator,
+				 const char *dirname)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/bandwidth.calibration.inprogress",
+		 dirname);
+	int fd = coio_file_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		say_warn("failed to create `%s', skipping disk bandwidth "
+			 "calibration", path);
+		return -1;
+	}
+	char *chunk = malloc(VY_CALIBRATION_CHUNK);
+	if (chunk == NULL) {
+		coio_file_close(fd);
+		coio_unlink(path);
+		return -1;
+	}
+	/*
+	 * Fill the chunk with a pattern rather than zeros so that
+	 * devices transparently compressing or eliding zero pages
+	 * do not report a fantasy number.
+	 */
+	for (size_t i = 0; i < VY_CALIBRATION_CHUNK; i++)
+		chunk[i] = i * 2654435761U >> 24;
+	double start = ev_monotonic_now(loop());
+	size_t written;
+	for (written = 0; written < VY_CALIBRATION_SIZE;
+	     written += VY_CALIBRATION_CHUNK) {
+		if (coio_write(fd, chunk, VY_CALIBRATION_CHUNK) !=
+		    (ssize_t)VY_CALIBRATION_CHUNK)
+			break;
+	}
+	bool failed = written < VY_CALIBRATION_SIZE ||
+		      coio_fdatasync(fd) != 0;
+	double duration = ev_monotonic_now(loop()) - start;
+	free(chunk);
+	coio_file_close(fd);
+	coio_unlink(path);
+	if (failed || duration <= 0) {
+		say_warn("failed to write `%s', skipping disk bandwidth "
+			 "calibration", path);
+		return -1;
+	}
+	size_t bandwidth = VY_CALIBRATION_SIZE / duration;
+	regulator->calibrated_bandwidth = bandwidth;
+	say_info("disk bandwidth calibration: %.1f MB/s sequential write",
+		 (double)bandwidth / 1024 / 1024);
+	/*
+	 * Until the first real dump is observed the bandwidth
+	 * estimate is nothing but a built-in guess. Dump output
+	 * goes through the very same write path, just with run
+	 * encoding on top, so half the sequential write bandwidth
+	 * makes a far better seed.
+	 */
+	if (!regulator->dump_bandwidth_measured &&
+	    regulator->dump_bandwidth < bandwidth / 2) {
+		regulator->dump_bandwidth = bandwidth / 2;
+		vy_quota_set_rate_limit(regulator->quota,
+					VY_QUOTA_RESOURCE_MEMORY,
+					regulator->dump_bandwidth);
+	}
+	return 0;
+}
+
 /*
  * The goal of rate limiting is to ensure LSM trees stay close to
  * their perfect shape, as defined by run_size_ratio. When dump rate
@@ -102,6 +102,22 @@ struct vy_regulator {
 	 * best result among 10% worst measurements.
 	 */
 	struct histogram *dump_bandwidth_hist;
+	/**
+	 * Set once a real dump has contributed to the bandwidth
+	 * histogram. Until then @dump_bandwidth is just a guess
+	 * and may be overridden by the calibration pass.
+	 */
+	bool dump_bandwidth_measured;
+	/**
+	 * Sequential write bandwidth of the data device measured
+	 * by vy_regulator_calibrate_bandwidth(), in bytes per
+	 * second, 0 if never calibrated. Used as the burst-mode
+	 * bandwidth estimate: when transactions write slowly,
+	 * there is no risk of hitting the hard memory limit
+	 * mid-dump, so there is no reason to throttle them down
+	 * to the cautious lower-bound percentile estimate.
+	 */
+	size_t calibrated_bandwidth;
 	/**
 	 * Memory watermark. Exceeding it does not result in
 	 * throttling new transactions, but it does trigger
@@ -175,6 +191,18 @@ vy_regulator_reset_dump_bandwidth(struct vy_regulator *regulator, size_t max);
 void
 vy_regulator_reset_stat(struct vy_regulator *regulator);
 
+/**
+ * Measure the sequential write bandwidth of the device backing
+ * @dirname by writing and removing a test file, and seed the
+ * dump bandwidth estimate with the result. Blocks the calling
+ * fiber for the duration of the pass (a fraction of a second on
+ * anything modern). Best effort: returns -1 and leaves the
+ * estimates untouched if the measurement fails.
+ */
+int
+vy_regulator_calibrate_bandwidth(struct vy_regulator *regulator,
+				 const char *dirname);
+
 /**
  * Set transaction rate limit so as to ensure that compaction
  * will keep up with dumps.
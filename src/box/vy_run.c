@@ -69,6 +69,8 @@ const char *vy_file_suffix[] = {
 	"index" inprogress_suffix, 	/* VY_FILE_INDEX_INPROGRESS */
 	"run",				/* VY_FILE_RUN */
 	"run" inprogress_suffix, 	/* VY_FILE_RUN_INPROGRESS */
+	"bloom",			/* VY_FILE_BLOOM */
+	"bloom" inprogress_suffix, 	/* VY_FILE_BLOOM_INPROGRESS */
 };
 
 /* sync run and index files very 16 MB */
@@ -111,6 +113,85 @@ struct vy_page_read_task {
 	struct vy_page *page;
 };
 
+/**
+ * Task for background readahead of run pages. Unlike
+ * vy_page_read_task, it is not a cbus call: the fiber that
+ * issues it does not wait for completion. The pages are handed
+ * over to the iterator when the message returns to tx.
+ */
+struct vy_page_readahead_task {
+	/** parent */
+	struct cmsg base;
+	/** Message route: a reader thread, then back to tx. */
+	struct cmsg_hop route[2];
+	/** Environment the task was allocated from. */
+	struct vy_run_env *env;
+	/** Run to read from. Referenced to pin the fd. */
+	struct vy_run *run;
+	/**
+	 * Iterator waiting for the pages or NULL if it was
+	 * stopped while the task was in flight.
+	 */
+	struct vy_run_iterator *itr;
+	/** Number of the first page to read. */
+	uint32_t first_page_no;
+	/** Number of pages to read. */
+	uint32_t page_count;
+	/** Pages to fill, in page number order. */
+	struct vy_page *pages[VY_RUN_READAHEAD_MAX];
+	/** [out] set if reading any of the pages failed. */
+	bool failed;
+};
+
+enum {
+	/**
+	 * Max number of pages a run writer may have in flight in
+	 * the compression worker pool. Keeps the memory held by
+	 * detached page buffers bounded.
+	 */
+	VY_RUN_ZTASK_MAX = 8,
+	/**
+	 * Pages smaller than this are compressed right in the
+	 * writer thread: the handoff overhead would eat the gain.
+	 */
+	VY_RUN_ZTASK_MIN_SIZE = 2048,
+};
+
+/** Task to compress a run page in a zworker thread. */
+struct vy_page_ztask {
+	/** Link in vy_run_env::zworker_queue. */
+	struct stailq_entry in_worker_queue;
+	/** Link in vy_run_writer::ztask_queue. */
+	struct stailq_entry in_writer_queue;
+	/** Ordinal of the page in the run. */
+	uint32_t page_no;
+	/** Number of rows in the page transaction. */
+	int row_count;
+	/** Page rows detached from the data xlog. */
+	struct obuf data;
+	/** Buffer for the compressed transaction block. */
+	char *zdata;
+	/** Capacity of @a zdata. */
+	size_t zdata_size;
+	/** Size of the compressed block or -1 on error. */
+	ssize_t zsize;
+	/** Error moved from the worker if @a zsize is -1. */
+	struct diag diag;
+	/**
+	 * Set by the worker when the task is complete, under
+	 * vy_run_env::zworker_mutex.
+	 */
+	bool is_done;
+};
+
+/** Vinyl page compression worker thread. */
+struct vy_run_zworker {
+	/** Worker thread. */
+	struct cord cord;
+	/** Environment the worker belongs to. */
+	struct vy_run_env *env;
+};
+
 /** Destructor for env->zdctx_key thread-local variable */
 static void
 vy_free_zdctx(void *arg)
@@ -172,17 +253,101 @@ vy_run_env_stop_readers(struct vy_run_env *env)
 	free(env->reader_pool);
 }
 
+/** Page compression worker thread function. */
+static int
+vy_run_zworker_f(va_list ap)
+{
+	struct vy_run_zworker *worker = va_arg(ap, struct vy_run_zworker *);
+	struct vy_run_env *env = worker->env;
+	ZSTD_CCtx *zctx = ZSTD_createCCtx();
+	if (zctx == NULL)
+		panic("failed to create ZSTD compression context");
+	tt_pthread_mutex_lock(&env->zworker_mutex);
+	while (!env->zworker_shutdown) {
+		if (stailq_empty(&env->zworker_queue)) {
+			tt_pthread_cond_wait(&env->zworker_cond,
+					     &env->zworker_mutex);
+			continue;
+		}
+		struct vy_page_ztask *task =
+			stailq_shift_entry(&env->zworker_queue,
+					   struct vy_page_ztask,
+					   in_worker_queue);
+		tt_pthread_mutex_unlock(&env->zworker_mutex);
+		task->zsize = xlog_tx_compress(task->zdata, task->zdata_size,
+					       zctx, NULL, &task->data);
+		if (task->zsize < 0)
+			diag_move(diag_get(), &task->diag);
+		tt_pthread_mutex_lock(&env->zworker_mutex);
+		task->is_done = true;
+		tt_pthread_cond_broadcast(&env->ztask_done_cond);
+	}
+	tt_pthread_mutex_unlock(&env->zworker_mutex);
+	ZSTD_freeCCtx(zctx);
+	return 0;
+}
+
+/** Start page compression worker threads. */
+static void
+vy_run_env_start_zworkers(struct vy_run_env *env)
+{
+	assert(env->zworker_pool == NULL);
+	assert(env->zworker_pool_size > 0);
+
+	env->zworker_pool = calloc(env->zworker_pool_size,
+				   sizeof(*env->zworker_pool));
+	if (env->zworker_pool == NULL)
+		panic("failed to allocate vinyl zworker thread pool");
+
+	for (int i = 0; i < env->zworker_pool_size; i++) {
+		struct vy_run_zworker *worker = &env->zworker_pool[i];
+		char name[FIBER_NAME_MAX];
+
+		worker->env = env;
+		snprintf(name, sizeof(name), "vinyl.zworker.%d", i);
+		if (cord_costart(&worker->cord, name,
+				 vy_run_zworker_f, worker) != 0)
+			panic("failed to start vinyl zworker thread");
+	}
+}
+
+/** Join page compression worker threads. */
+static void
+vy_run_env_stop_zworkers(struct vy_run_env *env)
+{
+	tt_pthread_mutex_lock(&env->zworker_mutex);
+	env->zworker_shutdown = true;
+	tt_pthread_cond_broadcast(&env->zworker_cond);
+	tt_pthread_mutex_unlock(&env->zworker_mutex);
+	for (int i = 0; i < env->zworker_pool_size; i++)
+		tt_pthread_join(env->zworker_pool[i].cord.id, NULL);
+	free(env->zworker_pool);
+}
+
 /**
  * Initialize vinyl run environment
  */
 void
-vy_run_env_create(struct vy_run_env *env, int read_threads)
+vy_run_env_create(struct vy_run_env *env, int read_threads,
+		  int compression_threads, const char *cold_dir)
 {
 	memset(env, 0, sizeof(*env));
+	if (cold_dir != NULL) {
+		env->cold_dir = strdup(cold_dir);
+		if (env->cold_dir == NULL)
+			panic("failed to allocate vinyl cold_dir path");
+	}
 	env->reader_pool_size = read_threads;
+	env->zworker_pool_size = compression_threads;
+	tt_pthread_mutex_init(&env->zworker_mutex, NULL);
+	tt_pthread_cond_init(&env->zworker_cond, NULL);
+	tt_pthread_cond_init(&env->ztask_done_cond, NULL);
+	stailq_create(&env->zworker_queue);
 	tt_pthread_key_create(&env->zdctx_key, vy_free_zdctx);
 	mempool_create(&env->read_task_pool, cord_slab_cache(),
 		       sizeof(struct vy_page_read_task));
+	mempool_create(&env->readahead_task_pool, cord_slab_cache(),
+		       sizeof(struct vy_page_readahead_task));
 }
 
 /**
@@ -193,8 +358,15 @@ vy_run_env_destroy(struct vy_run_env *env)
 {
 	if (env->reader_pool != NULL)
 		vy_run_env_stop_readers(env);
+	if (env->zworker_pool != NULL)
+		vy_run_env_stop_zworkers(env);
+	tt_pthread_cond_destroy(&env->ztask_done_cond);
+	tt_pthread_cond_destroy(&env->zworker_cond);
+	tt_pthread_mutex_destroy(&env->zworker_mutex);
 	mempool_destroy(&env->read_task_pool);
+	mempool_destroy(&env->readahead_task_pool);
 	tt_pthread_key_delete(env->zdctx_key);
+	free(env->cold_dir);
 }
 
 /**
@@ -206,6 +378,8 @@ vy_run_env_enable_coio(struct vy_run_env *env)
 	if (env->reader_pool != NULL)
 		return; /* already enabled */
 	vy_run_env_start_readers(env);
+	if (env->zworker_pool_size > 0)
+		vy_run_env_start_zworkers(env);
 }
 
 /**
@@ -283,6 +457,7 @@ vy_run_new(struct vy_run_env *env, int64_t id)
 	run->id = id;
 	run->dump_lsn = -1;
 	run->fd = -1;
+	run->last_access = ev_monotonic_now(loop());
 	run->refs = 1;
 	rlist_create(&run->in_lsm);
 	rlist_create(&run->in_unused);
@@ -305,6 +480,9 @@ vy_run_clear(struct vy_run *run)
 		tuple_bloom_delete(run->info.bloom);
 		run->info.bloom = NULL;
 	}
+	run->info.bloom_size = 0;
+	free(run->bloom_path);
+	run->bloom_path = NULL;
 	free(run->info.min_key);
 	run->info.min_key = NULL;
 	free(run->info.max_key);
@@ -325,7 +503,27 @@ vy_run_delete(struct vy_run *run)
 size_t
 vy_run_bloom_size(struct vy_run *run)
 {
-	return run->info.bloom == NULL ? 0 : tuple_bloom_size(run->info.bloom);
+	return run->info.bloom_size;
+}
+
+/**
+ * Map the on-disk bloom filter of a run on the first lookup.
+ * A mapping failure is not fatal - the lookup will simply read
+ * the disk - so the error is logged and the file is forgotten
+ * to avoid retrying on every lookup.
+ */
+static void
+vy_run_load_bloom(struct vy_run *run)
+{
+	assert(run->info.bloom == NULL);
+	assert(run->bloom_path != NULL);
+	run->info.bloom = tuple_bloom_map_file(run->bloom_path);
+	if (run->info.bloom == NULL) {
+		diag_log();
+		say_warn("failed to map bloom filter `%s'", run->bloom_path);
+	}
+	free(run->bloom_path);
+	run->bloom_path = NULL;
 }
 
 /**
@@ -627,6 +825,8 @@ vy_stmt_stat_decode(struct vy_stmt_stat *stat, const char **data)
  *
  * @param xrow xrow to decode
  * @param[out] run_info the run information
+ * @param skip_bloom Skip the bloom filter instead of decoding it,
+ *                   used when the run has a separate bloom file.
  * @param filename File name for error reporting.
  *
  * @retval  0 success
@@ -634,7 +834,7 @@ vy_stmt_stat_decode(struct vy_stmt_stat *stat, const char **data)
  */
 int
 vy_run_info_decode(struct vy_run_info *run_info,
-		   const struct xrow_header *xrow,
+		   const struct xrow_header *xrow, bool skip_bloom,
 		   const char *filename)
 {
 	assert(xrow->type == VY_INDEX_RUN_INFO);
@@ -677,11 +877,26 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			run_info->bloom = tuple_bloom_decode_legacy(&pos);
 			if (run_info->bloom == NULL)
 				return -1;
+			run_info->bloom_size =
+				tuple_bloom_size(run_info->bloom);
 			break;
 		case VY_RUN_INFO_BLOOM:
+			if (skip_bloom) {
+				/*
+				 * The filter will be mapped from
+				 * the bloom file on the first
+				 * lookup. Only account its size.
+				 */
+				tmp = pos;
+				mp_next(&pos);
+				run_info->bloom_size = pos - tmp;
+				break;
+			}
 			run_info->bloom = tuple_bloom_decode(&pos);
 			if (run_info->bloom == NULL)
 				return -1;
+			run_info->bloom_size =
+				tuple_bloom_size(run_info->bloom);
 			break;
 		case VY_RUN_INFO_STMT_STAT:
 			vy_stmt_stat_decode(&run_info->stmt_stat, &pos);
@@ -747,6 +962,59 @@ vy_page_delete(struct vy_page *page)
 	free(page);
 }
 
+/**
+ * Restore a statement row from a VY_RUN_ROW_PREFIX delta and the
+ * body of the first statement of the same page. The restored
+ * body is allocated on the fiber region.
+ */
+static int
+vy_run_row_prefix_decode(struct xrow_header *xrow, const char *anchor,
+			 size_t anchor_size)
+{
+	assert(xrow->type == VY_RUN_ROW_PREFIX);
+	assert(xrow->bodycnt == 1);
+	const char *pos = xrow->body[0].iov_base;
+	uint32_t orig_type = 0;
+	uint64_t prefix_len = 0;
+	uint32_t data_size = 0;
+	const char *data = NULL;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		uint32_t key = mp_decode_uint(&pos);
+		switch (key) {
+		case VY_ROW_PREFIX_TYPE:
+			orig_type = mp_decode_uint(&pos);
+			break;
+		case VY_ROW_PREFIX_LEN:
+			prefix_len = mp_decode_uint(&pos);
+			break;
+		case VY_ROW_PREFIX_DATA:
+			data = mp_decode_bin(&pos, &data_size);
+			break;
+		default:
+			mp_next(&pos);
+			break;
+		}
+	}
+	if (orig_type == 0 || data == NULL || prefix_len > anchor_size) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Broken prefix-compressed row");
+		return -1;
+	}
+	size_t body_size = prefix_len + data_size;
+	char *body = region_alloc(&fiber()->gc, body_size);
+	if (body == NULL) {
+		diag_set(OutOfMemory, body_size, "region", "row body");
+		return -1;
+	}
+	memcpy(body, anchor, prefix_len);
+	memcpy(body + prefix_len, data, data_size);
+	xrow->type = orig_type;
+	xrow->body[0].iov_base = body;
+	xrow->body[0].iov_len = body_size;
+	return 0;
+}
+
 static int
 vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	     struct xrow_header *xrow)
@@ -756,7 +1024,31 @@ vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	const char *data_end = stmt_no + 1 < page->row_count ?
 			       page->data + page->row_index[stmt_no + 1] :
 			       page->data + page->unpacked_size;
-	return xrow_header_decode(xrow, &data, data_end, false);
+	if (xrow_header_decode(xrow, &data, data_end, false) != 0)
+		return -1;
+	if (xrow->type != VY_RUN_ROW_PREFIX)
+		return 0;
+	/*
+	 * A delta row is restored from the first statement of its
+	 * page, which is always stored verbatim.
+	 */
+	assert(stmt_no > 0);
+	if (stmt_no == 0) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Broken prefix-compressed row");
+		return -1;
+	}
+	struct xrow_header anchor;
+	const char *anchor_pos = page->data + page->row_index[0];
+	const char *anchor_end = page->data + page->row_index[1];
+	if (xrow_header_decode(&anchor, &anchor_pos, anchor_end, false) != 0 ||
+	    anchor.bodycnt != 1) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Broken prefix-compressed row");
+		return -1;
+	}
+	return vy_run_row_prefix_decode(xrow, anchor.body[0].iov_base,
+					anchor.body[0].iov_len);
 }
 
 /* {{{ vy_run_iterator vy_run_iterator support functions */
@@ -775,11 +1067,19 @@ static struct vy_entry
 vy_page_stmt(struct vy_page *page, uint32_t stmt_no,
 	     struct key_def *cmp_def, struct tuple_format *format)
 {
+	/*
+	 * Restoring a prefix-compressed row uses the fiber region
+	 * and this function is called in tight scan loops, so
+	 * don't let the garbage pile up.
+	 */
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
 	struct xrow_header xrow;
 	if (vy_page_xrow(page, stmt_no, &xrow) != 0)
 		return vy_entry_none();
 	struct vy_entry entry;
 	entry.stmt = vy_stmt_decode(&xrow, format);
+	region_truncate(region, region_svp);
 	if (entry.stmt == NULL)
 		return vy_entry_none();
 	entry.hint = vy_stmt_hint(entry.stmt, cmp_def);
@@ -837,6 +1137,16 @@ vy_run_iterator_stop(struct vy_run_iterator *itr)
 			vy_page_delete(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
+	if (itr->readahead_task != NULL) {
+		/* Let the task clean up after itself. */
+		itr->readahead_task->itr = NULL;
+		itr->readahead_task = NULL;
+	}
+	for (uint32_t i = 0; i < itr->readahead_page_count; i++)
+		vy_page_delete(itr->readahead_pages[i]);
+	itr->readahead_page_count = 0;
+	itr->readahead_count = 0;
+	itr->last_page_no = UINT32_MAX;
 }
 
 static int
@@ -880,6 +1190,41 @@ vy_run_filename(struct vy_run *run)
 	return buf;
 }
 
+/**
+ * Decode a page from the raw bytes read from a run data file.
+ *
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_page_decode(struct vy_page *page, const struct vy_page_info *page_info,
+	       const char *data, ZSTD_DStream *zdctx)
+{
+	/* decode xlog tx */
+	const char *data_pos = data;
+	const char *data_end = data + page_info->size;
+	char *rows = page->data;
+	char *rows_end = rows + page_info->unpacked_size;
+	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
+		return -1;
+
+	struct xrow_header xrow;
+	data_pos = page->data + page_info->row_index_offset;
+	data_end = page->data + page_info->unpacked_size;
+	if (xrow_header_decode(&xrow, &data_pos, data_end, true) == -1)
+		return -1;
+	if (xrow.type != VY_RUN_ROW_INDEX) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 tt_sprintf("Wrong row index type "
+				    "(expected %d, got %u)",
+				    VY_RUN_ROW_INDEX, (unsigned)xrow.type));
+		return -1;
+	}
+	if (vy_row_index_decode(page->row_index, page->row_count, &xrow) != 0)
+		return -1;
+	return 0;
+}
+
 /**
  * Read a page requests from vinyl xlog data file.
  *
@@ -918,27 +1263,7 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
 
 	ERROR_INJECT_SLEEP(ERRINJ_VY_READ_PAGE_DELAY);
 
-	/* decode xlog tx */
-	const char *data_pos = data;
-	const char *data_end = data + readen;
-	char *rows = page->data;
-	char *rows_end = rows + page_info->unpacked_size;
-	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
-		goto error;
-
-	struct xrow_header xrow;
-	data_pos = page->data + page_info->row_index_offset;
-	data_end = page->data + page_info->unpacked_size;
-	if (xrow_header_decode(&xrow, &data_pos, data_end, true) == -1)
-		goto error;
-	if (xrow.type != VY_RUN_ROW_INDEX) {
-		diag_set(ClientError, ER_INVALID_RUN_FILE,
-			 tt_sprintf("Wrong row index type "
-				    "(expected %d, got %u)",
-				    VY_RUN_ROW_INDEX, (unsigned)xrow.type));
-		goto error;
-	}
-	if (vy_row_index_decode(page->row_index, page->row_count, &xrow) != 0)
+	if (vy_page_decode(page, page_info, data, zdctx) != 0)
 		goto error;
 	region_truncate(&fiber()->gc, region_svp);
 	ERROR_INJECT(ERRINJ_VY_READ_PAGE, {
@@ -994,6 +1319,249 @@ vy_page_read_cb(struct cbus_call_msg *base)
 	return 0;
 }
 
+/**
+ * Readahead task callback: executed in a reader thread.
+ *
+ * Pages of a run file are laid out back to back, so instead of
+ * issuing a pread() per page the whole window is fetched with a
+ * single system call spanning from the first page offset to the
+ * end of the last page and each page is then decoded at its
+ * offset within the span.
+ */
+static void
+vy_page_readahead_read(struct cmsg *base)
+{
+	struct vy_page_readahead_task *task =
+		(struct vy_page_readahead_task *)base;
+	struct vy_run *run = task->run;
+	ZSTD_DStream *zdctx = vy_env_get_zdctx(task->env);
+	if (zdctx == NULL) {
+		task->failed = true;
+		return;
+	}
+	struct vy_page_info *first_info =
+		vy_run_page_info(run, task->first_page_no);
+	struct vy_page_info *last_info =
+		vy_run_page_info(run, task->first_page_no +
+				 task->page_count - 1);
+	uint64_t span = last_info->offset + last_info->size -
+			first_info->offset;
+	size_t region_svp = region_used(&fiber()->gc);
+	char *data = (char *)region_alloc(&fiber()->gc, span);
+	if (data == NULL) {
+		diag_set(OutOfMemory, span, "region gc", "page");
+		task->failed = true;
+		return;
+	}
+	ssize_t readen = fio_pread(run->fd, data, span, first_info->offset);
+	ERROR_INJECT(ERRINJ_VYRUN_DATA_READ, {
+		readen = -1;
+		errno = EIO;});
+	if (readen < 0) {
+		diag_set(SystemError, "failed to read from file");
+		goto error;
+	}
+	if (readen != (ssize_t)span) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 "Unexpected end of file");
+		goto error;
+	}
+	for (uint32_t i = 0; i < task->page_count; i++) {
+		struct vy_page_info *page_info =
+			vy_run_page_info(run, task->first_page_no + i);
+		if (vy_page_decode(task->pages[i], page_info,
+				   data + (page_info->offset -
+					   first_info->offset), zdctx) != 0)
+			goto error;
+	}
+	region_truncate(&fiber()->gc, region_svp);
+	return;
+error:
+	region_truncate(&fiber()->gc, region_svp);
+	diag_log();
+	say_error("error reading %s@%llu:%llu", vy_run_filename(run),
+		  (unsigned long long)first_info->offset,
+		  (unsigned long long)span);
+	task->failed = true;
+}
+
+/**
+ * Readahead task completion callback: executed in tx. Hands the
+ * pages over to the iterator, unless it was stopped or the read
+ * failed, in which case the pages are simply dropped: the
+ * iterator will reread the page it needs synchronously and
+ * report the error, if it is persistent, from there.
+ */
+static void
+vy_page_readahead_complete(struct cmsg *base)
+{
+	struct vy_page_readahead_task *task =
+		(struct vy_page_readahead_task *)base;
+	struct vy_run_iterator *itr = task->itr;
+	if (itr != NULL) {
+		assert(itr->readahead_task == task);
+		itr->readahead_task = NULL;
+		fiber_cond_broadcast(&itr->readahead_cond);
+	}
+	if (itr == NULL || task->failed) {
+		for (uint32_t i = 0; i < task->page_count; i++)
+			vy_page_delete(task->pages[i]);
+	} else {
+		assert(itr->readahead_page_count == 0);
+		for (uint32_t i = 0; i < task->page_count; i++) {
+			struct vy_page *page = task->pages[i];
+			page->page_no = task->first_page_no + i;
+			itr->readahead_pages[i] = page;
+			struct vy_page_info *page_info =
+				vy_run_page_info(task->run, page->page_no);
+			itr->stat->read.rows += page_info->row_count;
+			itr->stat->read.bytes += page_info->unpacked_size;
+			itr->stat->read.bytes_compressed += page_info->size;
+			itr->stat->read.pages++;
+		}
+		itr->readahead_first_page_no = task->first_page_no;
+		itr->readahead_page_count = task->page_count;
+	}
+	vy_run_unref(task->run);
+	mempool_free(&task->env->readahead_task_pool, task);
+}
+
+/**
+ * Account a page access for readahead and, if the iterator has
+ * been walking pages sequentially, issue a background read of
+ * the next window of pages, doubling the window on each
+ * sequential hit the way the kernel readahead does. Failure to
+ * issue a readahead is not an error: the iterator will simply
+ * read the pages synchronously, one by one.
+ */
+static void
+vy_run_iterator_update_readahead(struct vy_run_iterator *itr,
+				 uint32_t page_no)
+{
+	struct vy_run *run = itr->slice->run;
+	struct vy_run_env *env = run->env;
+
+	if (page_no == itr->last_page_no)
+		return;
+	int dir = iterator_direction(itr->iterator_type);
+	/*
+	 * A forward scan that starts at the first page of the
+	 * run is considered sequential right away: the initial
+	 * UINT32_MAX + 1 wraps to 0, matching page 0.
+	 */
+	bool sequential = dir > 0 ? page_no == itr->last_page_no + 1 :
+			  page_no + 1 == itr->last_page_no;
+	itr->last_page_no = page_no;
+	if (!sequential) {
+		itr->readahead_count = 0;
+		return;
+	}
+	uint32_t start = itr->bulk_scan ? VY_RUN_READAHEAD_MAX : 1;
+	itr->readahead_count = MIN(MAX(itr->readahead_count * 2, start),
+				   (uint32_t)VY_RUN_READAHEAD_MAX);
+	/*
+	 * Do not issue a new task until the pages fetched by the
+	 * previous one have been consumed. No readahead during
+	 * WAL recovery - all reads are blocking then.
+	 */
+	if (env->reader_pool == NULL || itr->readahead_task != NULL ||
+	    itr->readahead_page_count > 0)
+		return;
+
+	uint32_t first_page_no;
+	uint32_t page_count = itr->readahead_count;
+	if (dir > 0) {
+		first_page_no = page_no + 1;
+		if (first_page_no >= run->info.page_count)
+			return;
+		page_count = MIN(page_count,
+				 run->info.page_count - first_page_no);
+	} else {
+		if (page_no == 0)
+			return;
+		page_count = MIN(page_count, page_no);
+		first_page_no = page_no - page_count;
+	}
+
+	struct vy_page_readahead_task *task =
+		mempool_alloc(&env->readahead_task_pool);
+	if (task == NULL)
+		return;
+	for (uint32_t i = 0; i < page_count; i++) {
+		struct vy_page_info *page_info =
+			vy_run_page_info(run, first_page_no + i);
+		task->pages[i] = vy_page_new(page_info);
+		if (task->pages[i] == NULL) {
+			while (i > 0)
+				vy_page_delete(task->pages[--i]);
+			mempool_free(&env->readahead_task_pool, task);
+			return;
+		}
+	}
+	task->env = env;
+	task->run = run;
+	task->itr = itr;
+	task->first_page_no = first_page_no;
+	task->page_count = page_count;
+	task->failed = false;
+	vy_run_ref(run);
+
+	struct vy_run_reader *reader = &env->reader_pool[env->next_reader++];
+	env->next_reader %= env->reader_pool_size;
+	task->route[0].f = vy_page_readahead_read;
+	task->route[0].pipe = &reader->tx_pipe;
+	task->route[1].f = vy_page_readahead_complete;
+	task->route[1].pipe = NULL;
+	cmsg_init(&task->base, task->route);
+	itr->readahead_task = task;
+	cpipe_push(&reader->reader_pipe, &task->base);
+}
+
+/**
+ * Look up a page in the iterator readahead buffer and take it
+ * out. If a background task covering the page is in flight,
+ * wait for it to complete first. Pages the iterator has passed
+ * by are dropped. Returns NULL if the page is not in the buffer.
+ */
+static struct vy_page *
+vy_run_iterator_readahead_get(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_page_readahead_task *task = itr->readahead_task;
+	if (task != NULL && page_no >= task->first_page_no &&
+	    page_no < task->first_page_no + task->page_count) {
+		/*
+		 * The fiber owning the iterator is the only one
+		 * waiting, so the task pointer cannot be reused
+		 * before the wait completes.
+		 */
+		while (itr->readahead_task == task)
+			fiber_cond_wait(&itr->readahead_cond);
+	}
+	if (itr->readahead_page_count == 0 ||
+	    page_no < itr->readahead_first_page_no ||
+	    page_no >= itr->readahead_first_page_no +
+		       itr->readahead_page_count)
+		return NULL;
+
+	uint32_t idx = page_no - itr->readahead_first_page_no;
+	struct vy_page *page = itr->readahead_pages[idx];
+	if (iterator_direction(itr->iterator_type) > 0) {
+		for (uint32_t i = 0; i < idx; i++)
+			vy_page_delete(itr->readahead_pages[i]);
+		uint32_t rest = itr->readahead_page_count - idx - 1;
+		memmove(itr->readahead_pages, itr->readahead_pages + idx + 1,
+			rest * sizeof(itr->readahead_pages[0]));
+		itr->readahead_first_page_no = page_no + 1;
+		itr->readahead_page_count = rest;
+	} else {
+		for (uint32_t i = idx + 1;
+		     i < itr->readahead_page_count; i++)
+			vy_page_delete(itr->readahead_pages[i]);
+		itr->readahead_page_count = idx;
+	}
+	return page;
+}
+
 /**
  * Read a page from disk given its number.
  * The function caches two most recently read pages.
@@ -1010,6 +1578,9 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	struct vy_slice *slice = itr->slice;
 	struct vy_run_env *env = slice->run->env;
 
+	/* Remember the access time for the offload fiber. */
+	slice->run->last_access = ev_monotonic_now(loop());
+
 	/* Check cache */
 	struct vy_page *page = NULL;
 	if (itr->curr_page != NULL &&
@@ -1029,6 +1600,22 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		return 0;
 	}
 
+	/* Check the readahead buffer */
+	page = vy_run_iterator_readahead_get(itr, page_no);
+	if (page != NULL) {
+		if (itr->prev_page != NULL)
+			vy_page_delete(itr->prev_page);
+		itr->prev_page = itr->curr_page;
+		itr->curr_page = page;
+		vy_run_iterator_update_readahead(itr, page_no);
+		if (key.stmt != NULL)
+			*pos_in_page = vy_page_find_key(page, key, itr->cmp_def,
+							itr->format, iterator_type,
+							equal_found);
+		*result = page;
+		return 0;
+	}
+
 	/* Allocate buffers */
 	struct vy_page_info *page_info = vy_run_page_info(slice->run, page_no);
 	page = vy_page_new(page_info);
@@ -1071,6 +1658,8 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	itr->curr_page = page;
 	page->page_no = page_no;
 
+	vy_run_iterator_update_readahead(itr, page_no);
+
 	/* Update read statistics. */
 	itr->stat->read.rows += page_info->row_count;
 	itr->stat->read.bytes += page_info->unpacked_size;
@@ -1340,6 +1929,8 @@ vy_run_iterator_seek(struct vy_run_iterator *itr, struct vy_entry last,
 {
 	struct key_def *cmp_def = itr->cmp_def;
 	struct vy_slice *slice = itr->slice;
+	if (slice->run->info.bloom == NULL && slice->run->bloom_path != NULL)
+		vy_run_load_bloom(slice->run);
 	struct tuple_bloom *bloom = slice->run->info.bloom;
 	struct vy_entry key = itr->key;
 	enum iterator_type iterator_type = itr->iterator_type;
@@ -1481,6 +2072,12 @@ vy_run_iterator_open(struct vy_run_iterator *itr,
 	itr->curr_pos.page_no = slice->run->info.page_count;
 	itr->curr_page = NULL;
 	itr->prev_page = NULL;
+	itr->last_page_no = UINT32_MAX;
+	itr->readahead_count = 0;
+	itr->bulk_scan = false;
+	itr->readahead_task = NULL;
+	fiber_cond_create(&itr->readahead_cond);
+	itr->readahead_page_count = 0;
 	itr->search_started = false;
 
 	/*
@@ -1634,6 +2231,7 @@ void
 vy_run_iterator_close(struct vy_run_iterator *itr)
 {
 	vy_run_iterator_stop(itr);
+	fiber_cond_destroy(&itr->readahead_cond);
 	tuple_format_unref(itr->format);
 	TRASH(itr);
 }
@@ -1654,13 +2252,46 @@ vy_run_acct_page(struct vy_run *run, struct vy_page_info *page)
 	run->count.pages++;
 }
 
+/**
+ * Build the path to a run file, preferring the primary data
+ * directory and falling back to the cold storage directory
+ * when the file is not found there. The fallback is per file
+ * so that a run interrupted half-way through an offload is
+ * still recoverable.
+ *
+ * Returns true if the cold directory path was taken.
+ */
+static bool
+vy_run_locate_file(struct vy_run *run, const char *dir, uint32_t space_id,
+		   uint32_t iid, enum vy_file_type type, char *path, int size)
+{
+	vy_run_snprint_path(path, size, dir,
+			    space_id, iid, run->id, type);
+	if (run->env->cold_dir == NULL || access(path, F_OK) == 0)
+		return false;
+	vy_run_snprint_path(path, size, run->env->cold_dir,
+			    space_id, iid, run->id, type);
+	return true;
+}
+
 int
 vy_run_recover(struct vy_run *run, const char *dir,
 	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def)
 {
 	char path[PATH_MAX];
-	vy_run_snprint_path(path, sizeof(path), dir,
-			    space_id, iid, run->id, VY_FILE_INDEX);
+	if (vy_run_locate_file(run, dir, space_id, iid,
+			       VY_FILE_INDEX, path, sizeof(path)))
+		run->is_cold = true;
+
+	/*
+	 * If the run has a bloom file, don't decode the filter
+	 * from the index file - it will be mapped lazily on the
+	 * first lookup. Old runs only have the in-index copy.
+	 */
+	char bloom_path[PATH_MAX];
+	vy_run_locate_file(run, dir, space_id, iid,
+			   VY_FILE_BLOOM, bloom_path, sizeof(bloom_path));
+	bool has_bloom_file = access(bloom_path, F_OK) == 0;
 
 	struct xlog_cursor cursor;
 	if (xlog_cursor_open(&cursor, path))
@@ -1699,9 +2330,18 @@ vy_run_recover(struct vy_run *run, const char *dir,
 		goto fail_close;
 	}
 
-	if (vy_run_info_decode(&run->info, &xrow, path) != 0)
+	if (vy_run_info_decode(&run->info, &xrow, has_bloom_file, path) != 0)
 		goto fail_close;
 
+	if (has_bloom_file) {
+		run->bloom_path = strdup(bloom_path);
+		if (run->bloom_path == NULL) {
+			diag_set(OutOfMemory, strlen(bloom_path) + 1,
+				 "strdup", "bloom path");
+			goto fail_close;
+		}
+	}
+
 	/* Allocate buffer for page info. */
 	run->page_info = calloc(run->info.page_count,
 				      sizeof(struct vy_page_info));
@@ -1751,8 +2391,9 @@ vy_run_recover(struct vy_run *run, const char *dir,
 	xlog_cursor_close(&cursor, false);
 
 	/* Prepare data file for reading. */
-	vy_run_snprint_path(path, sizeof(path), dir,
-			    space_id, iid, run->id, VY_FILE_RUN);
+	if (vy_run_locate_file(run, dir, space_id, iid,
+			       VY_FILE_RUN, path, sizeof(path)))
+		run->is_cold = true;
 	if (xlog_cursor_open(&cursor, path))
 		goto fail;
 	meta = &cursor.meta;
@@ -1774,14 +2415,72 @@ fail:
 	return -1;
 }
 
+enum {
+	/**
+	 * Statements of one page often share a long common prefix
+	 * in their encoded bodies: secondary keys carry the
+	 * indexed fields first and a page covers a narrow key
+	 * range. Prefixes shorter than this are not worth the
+	 * delta encoding overhead.
+	 */
+	VY_ROW_PREFIX_MIN = 32,
+};
+
+/**
+ * Replace @a xrow body with a VY_RUN_ROW_PREFIX delta against
+ * the page anchor if the shared prefix is long enough to pay
+ * off. The row is left intact otherwise. The delta body is
+ * allocated on the fiber region.
+ */
+static int
+vy_run_row_prefix_encode(struct xrow_header *xrow, const char *anchor,
+			 size_t anchor_size)
+{
+	assert(xrow->bodycnt == 1);
+	const char *body = xrow->body[0].iov_base;
+	size_t body_size = xrow->body[0].iov_len;
+	size_t max_len = MIN(body_size, anchor_size);
+	size_t prefix_len = 0;
+	while (prefix_len < max_len && body[prefix_len] == anchor[prefix_len])
+		prefix_len++;
+	if (prefix_len < VY_ROW_PREFIX_MIN)
+		return 0;
+	size_t data_size = body_size - prefix_len;
+	size_t size = mp_sizeof_map(3) +
+		      mp_sizeof_uint(VY_ROW_PREFIX_TYPE) +
+		      mp_sizeof_uint(xrow->type) +
+		      mp_sizeof_uint(VY_ROW_PREFIX_LEN) +
+		      mp_sizeof_uint(prefix_len) +
+		      mp_sizeof_uint(VY_ROW_PREFIX_DATA) +
+		      mp_sizeof_bin(data_size);
+	char *buf = region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region", "delta row");
+		return -1;
+	}
+	char *pos = buf;
+	pos = mp_encode_map(pos, 3);
+	pos = mp_encode_uint(pos, VY_ROW_PREFIX_TYPE);
+	pos = mp_encode_uint(pos, xrow->type);
+	pos = mp_encode_uint(pos, VY_ROW_PREFIX_LEN);
+	pos = mp_encode_uint(pos, prefix_len);
+	pos = mp_encode_uint(pos, VY_ROW_PREFIX_DATA);
+	pos = mp_encode_bin(pos, body + prefix_len, data_size);
+	assert(pos == buf + size);
+	xrow->type = VY_RUN_ROW_PREFIX;
+	xrow->body[0].iov_base = buf;
+	xrow->body[0].iov_len = size;
+	return 0;
+}
+
 /* dump statement to the run page buffers (stmt header and data) */
 static int
-vy_run_dump_stmt(struct vy_entry entry, struct xlog *data_xlog,
-		 struct vy_page_info *info, struct key_def *key_def,
-		 bool is_primary)
+vy_run_dump_stmt(struct vy_run_writer *writer, struct vy_entry entry,
+		 struct vy_page_info *info)
 {
+	struct key_def *key_def = writer->cmp_def;
 	struct xrow_header xrow;
-	int rc = (is_primary ?
+	int rc = (writer->iid == 0 ?
 		  vy_stmt_encode_primary(entry.stmt, key_def, 0, &xrow) :
 		  vy_stmt_encode_secondary(entry.stmt, key_def,
 					   vy_entry_multikey_idx(entry, key_def),
@@ -1789,8 +2488,34 @@ vy_run_dump_stmt(struct vy_entry entry, struct xlog *data_xlog,
 	if (rc != 0)
 		return -1;
 
+	if (info->row_count == 0) {
+		/*
+		 * The first statement of a page is always stored
+		 * verbatim: it is the anchor the following
+		 * statements are delta-encoded against.
+		 */
+		ibuf_reset(&writer->page_prefix_buf);
+		if (xrow.bodycnt == 1) {
+			void *anchor = ibuf_alloc(&writer->page_prefix_buf,
+						  xrow.body[0].iov_len);
+			if (anchor == NULL) {
+				diag_set(OutOfMemory, xrow.body[0].iov_len,
+					 "ibuf", "page prefix");
+				return -1;
+			}
+			memcpy(anchor, xrow.body[0].iov_base,
+			       xrow.body[0].iov_len);
+		}
+	} else if (xrow.bodycnt == 1 &&
+		   ibuf_used(&writer->page_prefix_buf) > 0 &&
+		   vy_run_row_prefix_encode(&xrow,
+					    writer->page_prefix_buf.rpos,
+					    ibuf_used(&writer->page_prefix_buf)) != 0) {
+		return -1;
+	}
+
 	ssize_t row_size;
-	if ((row_size = xlog_write_row(data_xlog, &xrow)) < 0)
+	if ((row_size = xlog_write_row(&writer->data_xlog, &xrow)) < 0)
 		return -1;
 
 	info->unpacked_size += row_size;
@@ -2036,6 +2761,58 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 
 /* vy_run_info }}} */
 
+/**
+ * Write the run bloom filter to a separate file, so that on
+ * recovery it can be mapped lazily on the first lookup instead
+ * of being decoded from the index file into memory.
+ */
+static int
+vy_run_write_bloom(struct vy_run *run, const char *dirpath,
+		   uint32_t space_id, uint32_t iid)
+{
+	assert(run->info.bloom != NULL);
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	vy_run_snprint_path(path, sizeof(path), dirpath,
+			    space_id, iid, run->id, VY_FILE_BLOOM);
+	vy_run_snprint_path(tmp_path, sizeof(tmp_path), dirpath,
+			    space_id, iid, run->id, VY_FILE_BLOOM_INPROGRESS);
+
+	say_info("writing `%s'", path);
+
+	if (tuple_bloom_store_file(run->info.bloom, tmp_path) != 0) {
+		unlink(tmp_path);
+		return -1;
+	}
+	if (rename(tmp_path, path) != 0) {
+		diag_set(SystemError, "failed to rename file '%s'", tmp_path);
+		unlink(tmp_path);
+		return -1;
+	}
+	free(run->bloom_path);
+	run->bloom_path = strdup(path);
+	if (run->bloom_path == NULL) {
+		diag_set(OutOfMemory, strlen(path) + 1, "strdup", "bloom path");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Drop the in-memory bloom filter of a freshly written run once
+ * both the index and the bloom files are flushed. The filter is
+ * mapped back lazily from the bloom file on the first lookup, as
+ * after recovery, so the run does not pin the filter in RAM.
+ */
+static void
+vy_run_unload_bloom(struct vy_run *run)
+{
+	assert(run->info.bloom != NULL);
+	assert(run->bloom_path != NULL);
+	tuple_bloom_delete(run->info.bloom);
+	run->info.bloom = NULL;
+}
+
 /**
  * Write run index to file.
  */
@@ -2125,8 +2902,11 @@ vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 			return -1;
 	}
 	xlog_clear(&writer->data_xlog);
+	stailq_create(&writer->ztask_queue);
+	writer->ztask_count = 0;
 	ibuf_create(&writer->row_index_buf, &cord()->slabc,
 		    4096 * sizeof(uint32_t));
+	ibuf_create(&writer->page_prefix_buf, &cord()->slabc, 4096);
 	run->info.min_lsn = INT64_MAX;
 	run->info.max_lsn = -1;
 	assert(run->page_info == NULL);
@@ -2225,8 +3005,7 @@ vy_run_writer_write_to_page(struct vy_run_writer *writer, struct vy_entry entry)
 		return -1;
 	}
 	*offset = page->unpacked_size;
-	if (vy_run_dump_stmt(entry, &writer->data_xlog, page,
-			     writer->cmp_def, writer->iid == 0) != 0)
+	if (vy_run_dump_stmt(writer, entry, page) != 0)
 		return -1;
 	int64_t lsn = vy_stmt_lsn(entry.stmt);
 	run->info.min_lsn = MIN(run->info.min_lsn, lsn);
@@ -2235,6 +3014,126 @@ vy_run_writer_write_to_page(struct vy_run_writer *writer, struct vy_entry entry)
 	return 0;
 }
 
+/**
+ * Wait for the oldest compression task of @a writer, write the
+ * compressed page to the data xlog and free the task. Must be
+ * called in submission order, the data file is append-only.
+ */
+static int
+vy_run_writer_reap_ztask(struct vy_run_writer *writer)
+{
+	struct vy_run *run = writer->run;
+	struct vy_run_env *env = run->env;
+	struct vy_page_ztask *task =
+		stailq_shift_entry(&writer->ztask_queue,
+				   struct vy_page_ztask, in_writer_queue);
+	writer->ztask_count--;
+	tt_pthread_mutex_lock(&env->zworker_mutex);
+	while (!task->is_done)
+		tt_pthread_cond_wait(&env->ztask_done_cond,
+				     &env->zworker_mutex);
+	tt_pthread_mutex_unlock(&env->zworker_mutex);
+	int rc = -1;
+	if (task->zsize >= 0) {
+		struct vy_page_info *page = run->page_info + task->page_no;
+		page->offset = writer->data_xlog.offset;
+		ssize_t written = xlog_write_compressed_tx(&writer->data_xlog,
+							   task->zdata,
+							   task->zsize,
+							   task->row_count);
+		if (written >= 0) {
+			page->size = written;
+			vy_run_acct_page(run, page);
+			rc = 0;
+		}
+	} else {
+		diag_move(&task->diag, diag_get());
+	}
+	diag_destroy(&task->diag);
+	obuf_destroy(&task->data);
+	free(task->zdata);
+	free(task);
+	return rc;
+}
+
+/**
+ * Write out compressed pages completed by worker threads until
+ * no more than @a max_in_flight tasks remain in the queue.
+ */
+static int
+vy_run_writer_reap_ztasks(struct vy_run_writer *writer, int max_in_flight)
+{
+	while (writer->ztask_count > max_in_flight) {
+		if (vy_run_writer_reap_ztask(writer) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Wait for and free all pending compression tasks without
+ * writing the results. Used on abort.
+ */
+static void
+vy_run_writer_discard_ztasks(struct vy_run_writer *writer)
+{
+	struct vy_run_env *env = writer->run->env;
+	while (!stailq_empty(&writer->ztask_queue)) {
+		struct vy_page_ztask *task =
+			stailq_shift_entry(&writer->ztask_queue,
+					   struct vy_page_ztask,
+					   in_writer_queue);
+		writer->ztask_count--;
+		tt_pthread_mutex_lock(&env->zworker_mutex);
+		while (!task->is_done)
+			tt_pthread_cond_wait(&env->ztask_done_cond,
+					     &env->zworker_mutex);
+		tt_pthread_mutex_unlock(&env->zworker_mutex);
+		diag_destroy(&task->diag);
+		obuf_destroy(&task->data);
+		free(task->zdata);
+		free(task);
+	}
+}
+
+/**
+ * Detach the current page transaction from the data xlog and
+ * hand it over to the compression worker pool. The compressed
+ * page is written to the file by vy_run_writer_reap_ztask().
+ */
+static int
+vy_run_writer_submit_ztask(struct vy_run_writer *writer)
+{
+	struct vy_run_env *env = writer->run->env;
+	struct vy_page_ztask *task = malloc(sizeof(*task));
+	if (task == NULL) {
+		diag_set(OutOfMemory, sizeof(*task), "malloc",
+			 "vy_page_ztask");
+		return -1;
+	}
+	task->page_no = writer->run->info.page_count;
+	task->row_count = xlog_tx_detach(&writer->data_xlog, &task->data);
+	task->zdata_size = xlog_tx_compress_bound(&task->data);
+	task->zdata = malloc(task->zdata_size);
+	if (task->zdata == NULL) {
+		diag_set(OutOfMemory, task->zdata_size, "malloc",
+			 "vy_page_ztask zdata");
+		obuf_destroy(&task->data);
+		free(task);
+		return -1;
+	}
+	task->zsize = -1;
+	diag_create(&task->diag);
+	task->is_done = false;
+	stailq_add_tail_entry(&writer->ztask_queue, task, in_writer_queue);
+	writer->ztask_count++;
+	tt_pthread_mutex_lock(&env->zworker_mutex);
+	stailq_add_tail_entry(&env->zworker_queue, task, in_worker_queue);
+	tt_pthread_cond_signal(&env->zworker_cond);
+	tt_pthread_mutex_unlock(&env->zworker_mutex);
+	return 0;
+}
+
 /**
  * Finish a current page.
  * @param writer Run writer.
@@ -2261,14 +3160,32 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 	page->row_index_offset = page->unpacked_size;
 	page->unpacked_size += written;
 
-	written = xlog_tx_commit(&writer->data_xlog);
-	if (written == 0)
-		written = xlog_flush(&writer->data_xlog);
-	if (written < 0)
-		return -1;
-	page->size = written;
+	if (run->env->zworker_pool != NULL && !writer->no_compression &&
+	    obuf_size(&writer->data_xlog.obuf) >= VY_RUN_ZTASK_MIN_SIZE) {
+		if (vy_run_writer_reap_ztasks(writer,
+					      VY_RUN_ZTASK_MAX - 1) != 0)
+			return -1;
+		if (vy_run_writer_submit_ztask(writer) != 0)
+			return -1;
+		/* page->offset, size and accounting are set on reap. */
+	} else {
+		/*
+		 * The data file is append-only, so pages handed
+		 * over to the workers must hit the disk before
+		 * this one is written right after them.
+		 */
+		if (vy_run_writer_reap_ztasks(writer, 0) != 0)
+			return -1;
+		page->offset = writer->data_xlog.offset;
+		written = xlog_tx_commit(&writer->data_xlog);
+		if (written == 0)
+			written = xlog_flush(&writer->data_xlog);
+		if (written < 0)
+			return -1;
+		page->size = written;
+		vy_run_acct_page(run, page);
+	}
 	run->info.page_count++;
-	vy_run_acct_page(run, page);
 	ibuf_reset(&writer->row_index_buf);
 	return 0;
 }
@@ -2304,6 +3221,7 @@ out:
 static void
 vy_run_writer_destroy(struct vy_run_writer *writer, bool reuse_fd)
 {
+	vy_run_writer_discard_ztasks(writer);
 	if (writer->last.stmt != NULL)
 		vy_stmt_unref_if_possible(writer->last.stmt);
 	if (xlog_is_open(&writer->data_xlog))
@@ -2311,6 +3229,7 @@ vy_run_writer_destroy(struct vy_run_writer *writer, bool reuse_fd)
 	if (writer->bloom != NULL)
 		tuple_bloom_builder_delete(writer->bloom);
 	ibuf_destroy(&writer->row_index_buf);
+	ibuf_destroy(&writer->page_prefix_buf);
 }
 
 int
@@ -2323,6 +3242,9 @@ vy_run_writer_commit(struct vy_run_writer *writer)
 	    vy_run_writer_end_page(writer) != 0)
 		goto out;
 
+	if (vy_run_writer_reap_ztasks(writer, 0) != 0)
+		goto out;
+
 	struct vy_run *run = writer->run;
 	if (vy_run_is_empty(run)) {
 		vy_run_writer_destroy(writer, false);
@@ -2360,10 +3282,16 @@ vy_run_writer_commit(struct vy_run_writer *writer)
 						  writer->bloom_fpr);
 		if (run->info.bloom == NULL)
 			goto out;
+		run->info.bloom_size = tuple_bloom_size(run->info.bloom);
+		if (vy_run_write_bloom(run, writer->dirpath,
+				       writer->space_id, writer->iid) != 0)
+			goto out;
 	}
 	if (vy_run_write_index(run, writer->dirpath,
 			       writer->space_id, writer->iid) != 0)
 		goto out;
+	if (run->info.bloom != NULL)
+		vy_run_unload_bloom(run);
 
 	run->fd = writer->data_xlog.fd;
 	vy_run_writer_destroy(writer, true);
@@ -2427,6 +3355,8 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		uint32_t page_row_count = 0;
 		uint64_t page_row_index_offset = 0;
 		uint64_t row_offset = xlog_cursor_tx_pos(&cursor);
+		const char *page_anchor = NULL;
+		size_t page_anchor_size = 0;
 
 		struct xrow_header xrow;
 		while ((rc = xlog_cursor_next_row(&cursor, &xrow)) == 0) {
@@ -2435,6 +3365,25 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 				row_offset = xlog_cursor_tx_pos(&cursor);
 				continue;
 			}
+			if (xrow.type == VY_RUN_ROW_PREFIX) {
+				if (page_anchor == NULL) {
+					diag_set(ClientError,
+						 ER_INVALID_RUN_FILE,
+						 "Broken prefix-compressed "
+						 "row");
+					goto close_err;
+				}
+				if (vy_run_row_prefix_decode(&xrow, page_anchor,
+							page_anchor_size) != 0)
+					goto close_err;
+			} else if (page_anchor == NULL && xrow.bodycnt == 1) {
+				/*
+				 * The first statement of the page:
+				 * delta rows are restored from it.
+				 */
+				page_anchor = xrow.body[0].iov_base;
+				page_anchor_size = xrow.body[0].iov_len;
+			}
 			++page_row_count;
 			struct tuple *tuple = vy_stmt_decode(&xrow, format);
 			if (tuple == NULL)
@@ -2508,8 +3457,11 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 						  opts->bloom_fpr);
 		if (run->info.bloom == NULL)
 			goto close_err;
+		run->info.bloom_size = tuple_bloom_size(run->info.bloom);
 		tuple_bloom_builder_delete(bloom_builder);
 		bloom_builder = NULL;
+		if (vy_run_write_bloom(run, dir, space_id, iid) != 0)
+			goto close_err;
 	}
 
 	/* New run index is ready for write, unlink old file if exists */
@@ -2522,6 +3474,8 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 	}
 	if (vy_run_write_index(run, dir, space_id, iid) != 0)
 		goto close_err;
+	if (run->info.bloom != NULL)
+		vy_run_unload_bloom(run);
 	return 0;
 close_err:
 	vy_run_clear(run);
@@ -2560,6 +3514,136 @@ vy_run_remove_files(const char *dir, uint32_t space_id,
 	return ret;
 }
 
+/**
+ * Create the cold storage directory of an LSM tree,
+ * recursively, the same way vy_lsm_create() does for
+ * the primary one.
+ */
+static int
+vy_run_make_cold_dir(const char *cold_dir, uint32_t space_id, uint32_t iid)
+{
+	char path[PATH_MAX];
+	vy_lsm_snprint_path(path, sizeof(path), cold_dir, space_id, iid);
+	char *path_sep = path;
+	while (*path_sep == '/') {
+		/* Don't create root */
+		++path_sep;
+	}
+	while ((path_sep = strchr(path_sep, '/'))) {
+		/* Recursively create path hierarchy */
+		*path_sep = '\0';
+		if (mkdir(path, 0777) == -1 && errno != EEXIST) {
+			diag_set(SystemError, "failed to create directory '%s'",
+				 path);
+			*path_sep = '/';
+			return -1;
+		}
+		*path_sep = '/';
+		++path_sep;
+	}
+	if (mkdir(path, 0777) == -1 && errno != EEXIST) {
+		diag_set(SystemError, "failed to create directory '%s'",
+			 path);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Move one run file to the cold storage directory. Uses
+ * rename() when the cold directory is on the same device and
+ * falls back to copy + unlink when it is not. Silently
+ * succeeds if the source file does not exist: a run may have
+ * no bloom file and an interrupted offload may have already
+ * moved some of the files.
+ */
+static int
+vy_run_offload_file(struct vy_run *run, const char *dir, uint32_t space_id,
+		    uint32_t iid, enum vy_file_type type)
+{
+	char path[PATH_MAX];
+	char cold_path[PATH_MAX];
+	vy_run_snprint_path(path, sizeof(path), dir,
+			    space_id, iid, run->id, type);
+	vy_run_snprint_path(cold_path, sizeof(cold_path), run->env->cold_dir,
+			    space_id, iid, run->id, type);
+	if (coio_rename(path, cold_path) == 0) {
+		say_info("moved %s to %s", path, cold_path);
+		return 0;
+	}
+	if (errno == ENOENT)
+		return 0;
+	if (errno != EXDEV) {
+		diag_set(SystemError, "failed to rename '%s' to '%s'",
+			 path, cold_path);
+		return -1;
+	}
+	/* The cold directory is on another device. */
+	if (coio_copyfile(path, cold_path) != 0) {
+		diag_set(SystemError, "failed to copy '%s' to '%s'",
+			 path, cold_path);
+		return -1;
+	}
+	if (coio_unlink(path) != 0) {
+		diag_set(SystemError, "failed to unlink file '%s'", path);
+		return -1;
+	}
+	say_info("moved %s to %s", path, cold_path);
+	return 0;
+}
+
+int
+vy_run_offload(struct vy_run *run, const char *dir,
+	       uint32_t space_id, uint32_t iid)
+{
+	struct vy_run_env *env = run->env;
+	assert(env->cold_dir != NULL);
+	assert(!run->is_cold);
+
+	/*
+	 * Prepare the new bloom file path upfront so that the
+	 * run object is fully updated once the files are moved.
+	 */
+	char *new_bloom_path = NULL;
+	if (run->bloom_path != NULL) {
+		char bloom_path[PATH_MAX];
+		vy_run_snprint_path(bloom_path, sizeof(bloom_path),
+				    env->cold_dir, space_id, iid,
+				    run->id, VY_FILE_BLOOM);
+		new_bloom_path = strdup(bloom_path);
+		if (new_bloom_path == NULL) {
+			diag_set(OutOfMemory, strlen(bloom_path) + 1,
+				 "strdup", "bloom path");
+			return -1;
+		}
+	}
+
+	if (vy_run_make_cold_dir(env->cold_dir, space_id, iid) != 0)
+		goto fail;
+
+	/*
+	 * On recovery the location of each file is looked up
+	 * independently, so a partially offloaded run remains
+	 * recoverable whatever the order. Move the data file
+	 * first - it is by far the largest, so even a failed
+	 * offload frees most of the space.
+	 */
+	if (vy_run_offload_file(run, dir, space_id, iid, VY_FILE_RUN) != 0 ||
+	    vy_run_offload_file(run, dir, space_id, iid, VY_FILE_INDEX) != 0 ||
+	    vy_run_offload_file(run, dir, space_id, iid, VY_FILE_BLOOM) != 0)
+		goto fail;
+
+	if (new_bloom_path != NULL) {
+		free(run->bloom_path);
+		run->bloom_path = new_bloom_path;
+	}
+	run->is_cold = true;
+	return 0;
+fail:
+	free(new_bloom_path);
+	return -1;
+}
+
 /**
  * Read a page with stream->page_no from the run and save it in stream->page.
  * Support function of slice stream.
@@ -33,6 +33,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "fiber_cond.h"
 #include "iterator_type.h"
@@ -42,6 +43,7 @@
 #include "vy_stat.h"
 #include "index_def.h"
 #include "xlog.h"
+#include "salad/stailq.h"
 
 #include "small/mempool.h"
 
@@ -51,13 +53,33 @@ extern "C" {
 
 struct vy_history;
 struct vy_run_reader;
+struct vy_run_zworker;
+struct vy_page_readahead_task;
+
+enum {
+	/**
+	 * Max size of the run iterator readahead window, in
+	 * pages. Together with the page size it bounds the
+	 * memory held by prefetched pages of one iterator.
+	 */
+	VY_RUN_READAHEAD_MAX = 8,
+};
 
 /** Part of vinyl environment for run read/write */
 struct vy_run_env {
 	/** Write rate limit, in bytes per second. */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Path to the cold storage directory. Files of runs that
+	 * have not been read for a long time are moved there to
+	 * free up space on the primary storage device. NULL if
+	 * cold storage is not configured.
+	 */
+	char *cold_dir;
 	/** Mempool for struct vy_page_read_task */
 	struct mempool read_task_pool;
+	/** Mempool for struct vy_page_readahead_task */
+	struct mempool readahead_task_pool;
 	/** Key for thread-local ZSTD context */
 	pthread_key_t zdctx_key;
 	/** Pool of threads used for reading run files. */
@@ -69,6 +91,20 @@ struct vy_run_env {
 	 * processing the next read request.
 	 */
 	int next_reader;
+	/** Pool of threads used for compressing run pages. */
+	struct vy_run_zworker *zworker_pool;
+	/** Number of threads in the zworker pool. */
+	int zworker_pool_size;
+	/** Mutex protecting the compression task queue. */
+	pthread_mutex_t zworker_mutex;
+	/** Signaled when a new compression task is queued. */
+	pthread_cond_t zworker_cond;
+	/** Signaled when a compression task is done. */
+	pthread_cond_t ztask_done_cond;
+	/** Queue of pending compression tasks (vy_page_ztask). */
+	struct stailq zworker_queue;
+	/** Set to stop the zworker pool. */
+	bool zworker_shutdown;
 };
 
 /**
@@ -87,6 +123,12 @@ struct vy_run_info {
 	uint32_t page_count;
 	/** Bloom filter of all tuples in run */
 	struct tuple_bloom *bloom;
+	/**
+	 * Size of the bloom filter when encoded, in bytes. Known
+	 * even when the filter itself is not loaded, so that the
+	 * statistics do not change when it is mapped lazily.
+	 */
+	size_t bloom_size;
 	/** Statement statistics. */
 	struct vy_stmt_stat stmt_stat;
 };
@@ -123,6 +165,25 @@ struct vy_run {
 	struct vy_page_info *page_info;
 	/** Run data file. */
 	int fd;
+	/**
+	 * Path to the on-disk bloom filter file. Set on recovery
+	 * when the run has one: the filter is then mapped lazily
+	 * on the first lookup instead of being decoded from the
+	 * index file into memory.
+	 */
+	char *bloom_path;
+	/**
+	 * Set if the run files live in the cold storage
+	 * directory, see vy_run_env::cold_dir.
+	 */
+	bool is_cold;
+	/**
+	 * Monotonic time of the last lookup in this run. Set to
+	 * the creation time when the run object is allocated.
+	 * Used by the offload fiber to tell cold runs from hot
+	 * ones.
+	 */
+	double last_access;
 	/** Unique ID of this run. */
 	int64_t id;
 	/** Number of statements in this run. */
@@ -279,6 +340,38 @@ struct vy_run_iterator {
 	 */
 	struct vy_page *curr_page;
 	struct vy_page *prev_page;
+	/**
+	 * Number of the last page fetched from disk or from the
+	 * readahead buffer. UINT32_MAX until the first fetch.
+	 * Used to detect sequential page access.
+	 */
+	uint32_t last_page_no;
+	/**
+	 * Current readahead window, in pages. Doubled on each
+	 * sequential page access up to VY_RUN_READAHEAD_MAX,
+	 * reset to zero on a random access.
+	 */
+	uint32_t readahead_count;
+	/**
+	 * Set when the caller expects a long scan, see
+	 * iterator::scan_estimate: the readahead window opens at
+	 * VY_RUN_READAHEAD_MAX on the first sequential access
+	 * instead of ramping up from one page.
+	 */
+	bool bulk_scan;
+	/** Background readahead task or NULL if none in flight. */
+	struct vy_page_readahead_task *readahead_task;
+	/** Signaled when the readahead task completes. */
+	struct fiber_cond readahead_cond;
+	/**
+	 * Pages fetched by the last readahead task, in page
+	 * number order, starting at readahead_first_page_no.
+	 */
+	struct vy_page *readahead_pages[VY_RUN_READAHEAD_MAX];
+	/** Number of pages in the readahead buffer. */
+	uint32_t readahead_page_count;
+	/** Number of the first page in the readahead buffer. */
+	uint32_t readahead_first_page_no;
 	/** Is false until first .._get or .._next_.. method is called */
 	bool search_started;
 };
@@ -305,9 +398,16 @@ struct vy_page {
  * @param read_threads - max number of background threads to
  * use for disk reads; note background threads are not used
  * until vy_run_env_enable_coio() is called.
+ * @param compression_threads - number of background threads
+ * used by run writers to compress pages; 0 means compress
+ * pages in the writer thread. Like reader threads, they are
+ * not started until vy_run_env_enable_coio() is called.
+ * @param cold_dir - path to the cold storage directory runs
+ * are offloaded to, or NULL if cold storage is not configured.
  */
 void
-vy_run_env_create(struct vy_run_env *env, int read_threads);
+vy_run_env_create(struct vy_run_env *env, int read_threads,
+		  int compression_threads, const char *cold_dir);
 
 /**
  * Destroy vinyl run environment
@@ -383,6 +483,25 @@ int
 vy_run_recover(struct vy_run *run, const char *dir,
 	       uint32_t space_id, uint32_t iid, struct key_def *cmp_def);
 
+/**
+ * Move the files of a run to the cold storage directory,
+ * see vy_run_env::cold_dir. The run file descriptor stays
+ * open so readers are not affected. May yield.
+ *
+ * Note, files moved to the cold directory are still part of
+ * the instance data: they must be preserved along with the
+ * primary data directory by backup procedures.
+ *
+ * @param run - run to offload; must have been recovered
+ * @param dir - path to the vinyl directory
+ * @param space_id - space id
+ * @param iid - index id
+ * @return - 0 on success, -1 on fail
+ */
+int
+vy_run_offload(struct vy_run *run, const char *dir,
+	       uint32_t space_id, uint32_t iid);
+
 /**
  * Rebuild run index
  * @param run - run to rebuild index for
@@ -407,6 +526,8 @@ enum vy_file_type {
 	VY_FILE_INDEX_INPROGRESS,
 	VY_FILE_RUN,
 	VY_FILE_RUN_INPROGRESS,
+	VY_FILE_BLOOM,
+	VY_FILE_BLOOM_INPROGRESS,
 	vy_file_MAX,
 };
 
@@ -622,11 +743,26 @@ struct vy_run_writer {
 	struct tuple_bloom_builder *bloom;
 	/** Buffer of a current page row offsets. */
 	struct ibuf row_index_buf;
+	/**
+	 * Encoded body of the first statement of a current page.
+	 * Subsequent statements sharing a long prefix with it are
+	 * stored as deltas, see VY_RUN_ROW_PREFIX. Empty if the
+	 * anchor is not suitable for prefix compression.
+	 */
+	struct ibuf page_prefix_buf;
 	/**
 	 * Remember a last written statement to use it as a source
 	 * of max key of a finished run.
 	 */
 	struct vy_entry last;
+	/**
+	 * Pages being compressed by zworker threads, oldest
+	 * first. They are written to the run file in this order
+	 * once compression completes, see vy_page_ztask.
+	 */
+	struct stailq ztask_queue;
+	/** Number of pages in ztask_queue. */
+	int ztask_count;
 };
 
 /** Create a run writer to fill a run with statements. */
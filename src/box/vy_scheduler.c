@@ -63,8 +63,14 @@
 #define VY_SCHEDULER_TIMEOUT_MIN	1
 #define VY_SCHEDULER_TIMEOUT_MAX	60
 
+/* Interval between cold run offload scans, in seconds. */
+#define VY_OFFLOAD_SCAN_INTERVAL	60
+/* Minimal time a run must stay unread to be offloaded, in seconds. */
+#define VY_OFFLOAD_COLD_AGE		600
+
 static int vy_worker_f(va_list);
 static int vy_scheduler_f(va_list);
+static int vy_offload_f(va_list);
 static void vy_task_execute_f(struct cmsg *);
 static void vy_task_complete_f(struct cmsg *);
 static void vy_deferred_delete_batch_process_f(struct cmsg *);
@@ -317,10 +323,11 @@ static bool
 vy_compaction_heap_less(struct vy_lsm *i1, struct vy_lsm *i2)
 {
 	/*
-	 * Prefer LSM trees whose read amplification will be reduced
-	 * most as a result of compaction.
+	 * Prefer LSM trees whose compaction will save the most
+	 * run probes: the weight scales the number of runs to be
+	 * merged by how often the range is actually read.
 	 */
-	return vy_lsm_compaction_priority(i1) > vy_lsm_compaction_priority(i2);
+	return vy_lsm_compaction_weight(i1) > vy_lsm_compaction_weight(i2);
 }
 
 #define HEAP_NAME vy_compaction_heap
@@ -469,10 +476,99 @@ vy_scheduler_create(struct vy_scheduler *scheduler, int write_threads,
 	fiber_cond_create(&scheduler->dump_cond);
 }
 
+/**
+ * Return true if the files of the given run may be moved
+ * to the cold storage directory.
+ */
+static bool
+vy_run_needs_offload(struct vy_run *run, double now)
+{
+	/* Already offloaded. */
+	if (run->is_cold)
+		return false;
+	/* Skip runs that are not backed by files yet. */
+	if (run->fd < 0)
+		return false;
+	/* Skip runs that are about to be deleted. */
+	if (run->slice_count == 0)
+		return false;
+	return now - run->last_access > VY_OFFLOAD_COLD_AGE;
+}
+
+/**
+ * Background fiber that periodically scans all LSM trees for
+ * runs that have not been read for a long time and moves their
+ * files to the cold storage directory. Read iterators are not
+ * affected - run file descriptors stay open across the move.
+ */
+static int
+vy_offload_f(va_list va)
+{
+	struct vy_scheduler *scheduler = va_arg(va, struct vy_scheduler *);
+
+	while (!fiber_is_cancelled()) {
+		/*
+		 * Look for an eligible run. The dump heap may
+		 * change while we are yielding in file system
+		 * operations, so offload at most one run per
+		 * pass and rescan from scratch afterwards.
+		 */
+		struct vy_lsm *target = NULL;
+		struct vy_run *run = NULL;
+		double now = ev_monotonic_now(loop());
+		struct heap_iterator it;
+		vy_dump_heap_iterator_init(&scheduler->dump_heap, &it);
+		struct vy_lsm *lsm;
+		while (target == NULL &&
+		       (lsm = vy_dump_heap_iterator_next(&it)) != NULL) {
+			if (lsm->is_dropped)
+				continue;
+			struct vy_run *r;
+			rlist_foreach_entry(r, &lsm->runs, in_lsm) {
+				if (vy_run_needs_offload(r, now)) {
+					target = lsm;
+					run = r;
+					break;
+				}
+			}
+		}
+		if (target == NULL) {
+			fiber_sleep(VY_OFFLOAD_SCAN_INTERVAL);
+			continue;
+		}
+		/*
+		 * Pin the objects so that they can't be freed
+		 * while we are waiting for the file system.
+		 */
+		vy_lsm_ref(target);
+		vy_run_ref(run);
+		int rc = vy_run_offload(run, target->env->path,
+					target->space_id, target->index_id);
+		vy_run_unref(run);
+		vy_lsm_unref(target);
+		if (rc != 0) {
+			/*
+			 * Don't retry the failed run immediately -
+			 * the disk error is likely to persist.
+			 */
+			diag_log();
+			fiber_sleep(VY_OFFLOAD_SCAN_INTERVAL);
+		}
+	}
+	return 0;
+}
+
 void
 vy_scheduler_start(struct vy_scheduler *scheduler)
 {
 	fiber_start(scheduler->scheduler_fiber, scheduler);
+	if (scheduler->run_env->cold_dir != NULL) {
+		scheduler->offload_fiber = fiber_new("vinyl.offload",
+						     vy_offload_f);
+		if (scheduler->offload_fiber == NULL)
+			panic("failed to allocate vinyl offload fiber");
+		fiber_start(scheduler->offload_fiber, scheduler);
+	}
 }
 
 void
@@ -483,6 +579,8 @@ vy_scheduler_destroy(struct vy_scheduler *scheduler)
 	/* Sic: fiber_cancel() can't be used here. */
 	fiber_cond_signal(&scheduler->dump_cond);
 	fiber_cond_signal(&scheduler->scheduler_cond);
+	if (scheduler->offload_fiber != NULL)
+		fiber_cancel(scheduler->offload_fiber);
 
 	vy_worker_pool_destroy(&scheduler->dump_pool);
 	vy_worker_pool_destroy(&scheduler->compaction_pool);
@@ -1205,10 +1303,14 @@ vy_task_dump_complete(struct vy_task *task)
 	 * LSM tree state, when the same statement is present twice,
 	 * in memory and on disk.
 	 */
+	uint64_t dumped_rows = 0, last_range_rows = 0;
 	for (range = begin_range, i = 0; range != end_range;
 	     range = vy_range_tree_next(&lsm->range_tree, range), i++) {
 		assert(i < lsm->range_count);
 		slice = new_slices[i];
+		dumped_rows += slice->count.rows;
+		if (range->end.stmt == NULL)
+			last_range_rows = slice->count.rows;
 		vy_lsm_unacct_range(lsm, range);
 		vy_range_add_slice(range, slice);
 		vy_range_update_compaction_priority(range, &lsm->opts);
@@ -1218,6 +1320,21 @@ vy_task_dump_complete(struct vy_task *task)
 	vy_range_heap_update_all(&lsm->range_heap);
 	free(new_slices);
 
+	/*
+	 * Detect an append-mostly workload: if almost all dumped
+	 * statements keep landing in the rightmost range, the keys
+	 * grow monotonically and that range is the only compaction
+	 * hot spot. A single range doesn't count - there is nowhere
+	 * else the statements could land.
+	 */
+	if (lsm->range_count > 1 && dumped_rows > 0 &&
+	    last_range_rows >= dumped_rows - dumped_rows / 8) {
+		if (lsm->append_dump_streak < VY_APPEND_DUMP_STREAK)
+			lsm->append_dump_streak++;
+	} else {
+		lsm->append_dump_streak = 0;
+	}
+
 delete_mems:
 	/*
 	 * Delete dumped in-memory trees and account dump in
@@ -1554,6 +1671,11 @@ vy_task_compaction_complete(struct vy_task *task)
 			break;
 	}
 	range->n_compactions++;
+	/*
+	 * The read amplification the accumulated probes were
+	 * paying for is gone, let the range earn its heat anew.
+	 */
+	range->lookups = 0;
 	vy_range_update_compaction_priority(range, &lsm->opts);
 	vy_range_update_dumps_per_compaction(range);
 	vy_lsm_acct_range(lsm, range);
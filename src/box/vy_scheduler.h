@@ -71,6 +71,12 @@ struct vy_worker_pool {
 struct vy_scheduler {
 	/** Scheduler fiber. */
 	struct fiber *scheduler_fiber;
+	/**
+	 * Fiber that moves files of long unread runs to the cold
+	 * storage directory. Started only if the latter is
+	 * configured, see vy_run_env::cold_dir.
+	 */
+	struct fiber *offload_fiber;
 	/** Used to wake up the scheduler fiber from TX. */
 	struct fiber_cond scheduler_cond;
 	/** Pool of threads for performing background dumps. */
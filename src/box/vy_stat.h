@@ -201,6 +201,16 @@ struct vy_cache_stat {
 	 * due to memory shortage.
 	 */
 	struct vy_stmt_counter evict;
+	/**
+	 * Number of statements promoted to the protected
+	 * LRU list on repeated access.
+	 */
+	struct vy_stmt_counter promote;
+	/**
+	 * Number of statements demoted back to the
+	 * probationary LRU list on protected list overflow.
+	 */
+	struct vy_stmt_counter demote;
 };
 
 /** Transaction statistics. */
@@ -141,7 +141,7 @@ vy_stmt_format_new(struct vy_stmt_env *env, struct key_def *const *keys,
 {
 	return tuple_format_new(&env->tuple_format_vtab, env, keys, key_count,
 				fields, field_count, exact_field_count, dict,
-				false, false);
+				false, false, false);
 }
 
 /**
@@ -159,6 +159,8 @@ static struct tuple *
 vy_stmt_alloc(struct tuple_format *format, uint32_t data_offset, uint32_t bsize)
 {
 	assert(data_offset >= sizeof(struct vy_stmt) + format->field_map_size);
+	/* data_offset is a 15-bit field, see struct tuple. */
+	assert(data_offset <= INT16_MAX);
 	struct vy_stmt_env *env = format->engine;
 	uint32_t total_size = data_offset + bsize;
 	if (unlikely(total_size > env->max_tuple_size)) {
@@ -180,6 +182,7 @@ vy_stmt_alloc(struct tuple_format *format, uint32_t data_offset, uint32_t bsize)
 		tuple_format_ref(format);
 	tuple->bsize = bsize;
 	tuple->data_offset = data_offset;
+	tuple->is_compressed = false;
 	vy_stmt_set_lsn(tuple, 0);
 	vy_stmt_set_type(tuple, 0);
 	vy_stmt_set_flags(tuple, 0);
@@ -421,6 +424,7 @@ vy_stmt_new_surrogate_delete_raw(struct tuple_format *format,
 	}
 	struct field_map_builder builder;
 	if (field_map_builder_create(&builder, format->field_map_size,
+				     format->is_compact_field_map,
 				     region) != 0)
 		goto out;
 	/*
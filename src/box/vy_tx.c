@@ -42,6 +42,7 @@
 #include "diag.h"
 #include "errcode.h"
 #include "fiber.h"
+#include "mempool_registry.h"
 #include "iproto_constants.h"
 #include "iterator_type.h"
 #include "salad/stailq.h"
@@ -62,6 +63,15 @@
 #include "vy_read_view.h"
 #include "vy_point_lookup.h"
 
+/**
+ * Maximum number of intervals in a transaction read set. When
+ * a transaction exceeds this threshold, a newly tracked interval
+ * is merged with its nearest neighbor in the same LSM tree even
+ * if the two do not intersect. This bounds the cost of conflict
+ * tracking for long scans at the price of rare false conflicts.
+ */
+enum { VY_TX_READ_SET_MAX_INTERVALS = 4096 };
+
 int
 write_set_cmp(struct txv *a, struct txv *b)
 {
@@ -124,12 +134,21 @@ tx_manager_new(void)
 		       sizeof(struct vy_read_interval));
 	mempool_create(&xm->read_view_mempool, slab_cache,
 		       sizeof(struct vy_read_view));
+	mempool_registry_add(&xm->tx_mempool, "vinyl.tx");
+	mempool_registry_add(&xm->txv_mempool, "vinyl.txv");
+	mempool_registry_add(&xm->read_interval_mempool,
+			     "vinyl.read_interval");
+	mempool_registry_add(&xm->read_view_mempool, "vinyl.read_view");
 	return xm;
 }
 
 void
 tx_manager_delete(struct tx_manager *xm)
 {
+	mempool_registry_remove(&xm->read_view_mempool);
+	mempool_registry_remove(&xm->read_interval_mempool);
+	mempool_registry_remove(&xm->txv_mempool);
+	mempool_registry_remove(&xm->tx_mempool);
 	mempool_destroy(&xm->read_view_mempool);
 	mempool_destroy(&xm->read_interval_mempool);
 	mempool_destroy(&xm->txv_mempool);
@@ -328,6 +347,7 @@ vy_tx_create(struct tx_manager *xm, struct vy_tx *tx)
 	tx->is_applier_session = false;
 	tx->read_view = (struct vy_read_view *)xm->p_global_read_view;
 	vy_tx_read_set_new(&tx->read_set);
+	tx->read_set_count = 0;
 	tx->psn = 0;
 	rlist_create(&tx->on_destroy);
 	rlist_create(&tx->in_writers);
@@ -952,6 +972,7 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 	struct stailq merge;
 	stailq_create(&merge);
 
+	struct vy_read_interval *prev = NULL;
 	struct vy_tx_read_set_iterator it;
 	vy_tx_read_set_isearch_le(&tx->read_set, new_interval, &it);
 
@@ -968,6 +989,8 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 		}
 		if (vy_read_interval_should_merge(interval, new_interval))
 			stailq_add_tail_entry(&merge, interval, in_merge);
+		else
+			prev = interval;
 	}
 
 	if (interval == NULL)
@@ -978,6 +1001,21 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 	       vy_read_interval_should_merge(new_interval, interval))
 		stailq_add_tail_entry(&merge, interval, in_merge);
 
+	/*
+	 * The read set has grown too big - coarsen the tracking.
+	 * Merge the new interval with its nearest neighbor in the
+	 * same LSM tree even though the two do not intersect. The
+	 * widened interval may yield false conflicts, but it keeps
+	 * the cost of tracking long scans bounded.
+	 */
+	if (stailq_empty(&merge) &&
+	    tx->read_set_count >= VY_TX_READ_SET_MAX_INTERVALS) {
+		if (prev != NULL)
+			stailq_add_entry(&merge, prev, in_merge);
+		else if (interval != NULL && interval->lsm == lsm)
+			stailq_add_tail_entry(&merge, interval, in_merge);
+	}
+
 	/*
 	 * Merge intersecting intervals with the new interval and
 	 * remove them from the transaction and LSM tree read sets.
@@ -1006,12 +1044,14 @@ vy_tx_track(struct vy_tx *tx, struct vy_lsm *lsm,
 			vy_tx_read_set_remove(&tx->read_set, interval);
 			vy_lsm_read_set_remove(&lsm->read_set, interval);
 			vy_read_interval_delete(interval);
+			tx->read_set_count--;
 		}
 		vy_read_interval_acct(new_interval);
 	}
 
 	vy_tx_read_set_insert(&tx->read_set, new_interval);
 	vy_lsm_read_set_insert(&lsm->read_set, new_interval);
+	tx->read_set_count++;
 	return 0;
 }
 
@@ -193,6 +193,12 @@ struct vy_tx {
 	 * intervals.
 	 */
 	vy_tx_read_set_t read_set;
+	/**
+	 * Number of intervals in the read set. Once it exceeds
+	 * a threshold, read tracking is coarsened, see
+	 * vy_tx_track().
+	 */
+	uint32_t read_set_count;
 	/**
 	 * Prepare sequence number or -1 if the transaction
 	 * is not prepared.
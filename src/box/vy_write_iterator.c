@@ -58,6 +58,14 @@ struct vy_write_src {
 	 * key, regardless of LSN.
 	 */
 	bool is_end_of_key;
+	/**
+	 * Set for a mem source when the write iterator is
+	 * allowed to drop statements shadowed by a newer
+	 * statement of the same key coming from the same
+	 * source, before they ever enter the merge heap.
+	 * @sa vy_write_iterator_merge_step().
+	 */
+	bool can_dedup;
 	/** An iterator over the source */
 	union {
 		struct vy_slice_stream slice_stream;
@@ -266,6 +274,7 @@ vy_write_iterator_new_src(struct vy_write_iterator *stream)
 	heap_node_create(&res->heap_node);
 	res->entry = vy_entry_none();
 	res->is_end_of_key = false;
+	res->can_dedup = false;
 	rlist_add(&stream->src_list, &res->in_src_list);
 	return res;
 }
@@ -466,6 +475,16 @@ vy_write_iterator_new_mem(struct vy_stmt_stream *vstream, struct vy_mem *mem)
 	struct vy_write_src *src = vy_write_iterator_new_src(stream);
 	if (src == NULL)
 		return -1;
+	/*
+	 * A mem keeps all versions of a key adjacent, newest
+	 * first, so shadowed versions can be dropped right at
+	 * the source. This is only possible when there are no
+	 * read views which could see an older version and no
+	 * deferred DELETE handler which would consume the
+	 * overwritten statements.
+	 */
+	src->can_dedup = stream->rv_count == 1 &&
+			 stream->deferred_delete_handler == NULL;
 	vy_mem_stream_open(&src->mem_stream, mem);
 	return 0;
 }
@@ -497,9 +516,42 @@ vy_write_iterator_merge_step(struct vy_write_iterator *stream)
 {
 	struct vy_write_src *src = vy_source_heap_top(&stream->src_heap);
 	assert(src != NULL);
+	struct vy_entry prev = src->entry;
 	int rc = src->stream.iface->next(&src->stream, &src->entry);
 	if (rc != 0)
 		return rc;
+	/*
+	 * Optimization #6: drop statements shadowed by a newer
+	 * REPLACE or DELETE of the same key from the same source
+	 * before they reach the heap. For queue-like spaces,
+	 * where the same keys are rewritten thousands of times
+	 * between dumps, this saves a heap comparison and a full
+	 * history building round per shadowed statement.
+	 *
+	 * The shadowing statement must not be an INSERT: dropping
+	 * statements below an INSERT could make the key's history
+	 * look like it starts from the INSERT and erroneously
+	 * trigger optimization #5 on a later compaction. For the
+	 * same reason a secondary index REPLACE produced by an
+	 * update is not allowed to shadow, and statements marked
+	 * for deferred DELETE generation are never dropped.
+	 */
+	if (src->can_dedup && src->entry.stmt != NULL &&
+	    (vy_stmt_type(prev.stmt) == IPROTO_REPLACE ||
+	     vy_stmt_type(prev.stmt) == IPROTO_DELETE) &&
+	    (stream->is_primary ||
+	     (vy_stmt_flags(prev.stmt) & VY_STMT_UPDATE) == 0)) {
+		while (src->entry.stmt != NULL &&
+		       (vy_stmt_flags(src->entry.stmt) &
+			VY_STMT_DEFERRED_DELETE) == 0 &&
+		       vy_entry_compare(prev, src->entry,
+					stream->cmp_def) == 0) {
+			rc = src->stream.iface->next(&src->stream,
+						     &src->entry);
+			if (rc != 0)
+				return rc;
+		}
+	}
 	if (src->entry.stmt != NULL)
 		vy_source_heap_update(&stream->src_heap, src);
 	else
@@ -190,6 +190,22 @@
  * also turn the first INSERT in the resulting key's history to a
  * REPLACE in case the oldest statement among all sources is not
  * an INSERT.
+ *
+ * ---------------------------------------------------------------
+ * Optimization #6: when dumping a mem and there are no read
+ * views except the current one, drop statements shadowed by a
+ * newer REPLACE or DELETE of the same key right at the source,
+ * before they enter the merge heap. A mem stores all versions
+ * of a key adjacent, newest first, so this is a simple streaming
+ * filter. It produces exactly the same output as optimization #2
+ * would, but skips the per-statement heap siftings and history
+ * building, which matters for queue-like spaces where the same
+ * keys are rewritten thousands of times between dumps.
+ *
+ * Statements marked with VY_STMT_DEFERRED_DELETE are never
+ * dropped, and an INSERT is not allowed to shadow, so that
+ * optimization #5 sees the same key history start as without
+ * the filter.
  */
 
 struct vy_write_iterator;
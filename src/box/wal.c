@@ -30,6 +30,8 @@
  */
 #include "wal.h"
 
+#include <sys/stat.h>
+
 #include "vclock.h"
 #include "fiber.h"
 #include "fio.h"
@@ -39,6 +41,7 @@
 
 #include "xlog.h"
 #include "xrow.h"
+#include "wal_mem.h"
 #include "vy_log.h"
 #include "cbus.h"
 #include "coio_task.h"
@@ -146,6 +149,14 @@ struct wal_writer
 	 * is in progress.
 	 */
 	bool checkpoint_triggered;
+	/**
+	 * WAL retention budget: when the total size of WAL files
+	 * on disk exceeds this value, the WAL thread removes the
+	 * oldest files not needed for recovery and notifies TX so
+	 * that it can deactivate the consumers that still needed
+	 * them. INT64_MAX means the budget is unlimited.
+	 */
+	int64_t retention_size;
 	/** The current WAL file. */
 	struct xlog current_wal;
 	/**
@@ -154,6 +165,38 @@ struct wal_writer
 	 * queue, until the tx thread has recovered.
 	 */
 	struct cmsg in_rollback;
+	/**
+	 * Group commit queue: messages whose entries are
+	 * buffered in the current xlog, waiting for the next
+	 * flush. The messages are handed back to tx by
+	 * wal_flush_group().
+	 */
+	struct stailq group_pending;
+	/**
+	 * Messages whose entries have already reached the disk
+	 * because the xlog buffer hit the autocommit threshold
+	 * mid-group. They are completed together with the rest
+	 * of the group, but survive a flush error.
+	 */
+	struct stailq group_durable;
+	/** Number of journal entries buffered in the group. */
+	int group_entries;
+	/** LSN changes accumulated by the buffered entries. */
+	struct vclock group_vclock_diff;
+	/** Fires when it is time to flush the group. */
+	struct ev_timer flush_timer;
+	/** Moving average of xlog_flush() duration, seconds. */
+	double flush_latency;
+	/** Total number of xlog flushes, for box.stat.wal(). */
+	int64_t flush_count;
+	/** Total number of entries written, for box.stat.wal(). */
+	int64_t entry_count;
+	/**
+	 * Histogram of entries per flush: bucket i counts
+	 * flushes of [2^i, 2^(i+1)) entries, the last bucket is
+	 * open-ended.
+	 */
+	int64_t batch_size_hist[WAL_BATCH_HIST_BUCKETS];
 	/**
 	 * WAL watchers, i.e. threads that should be alerted
 	 * whenever there are new records appended to the journal.
@@ -175,6 +218,13 @@ struct wal_msg {
 	struct stailq rollback;
 	/** vclock after the batch processed. */
 	struct vclock vclock;
+	/**
+	 * WAL thread bookkeeping: the last entry of this
+	 * message that has reached the disk, NULL if none have.
+	 * Entries after it are rolled back if the group commit
+	 * this message is part of fails to flush.
+	 */
+	struct stailq_entry *last_durable;
 };
 
 /**
@@ -188,20 +238,58 @@ struct vy_log_writer {
 static struct vy_log_writer vy_log_writer;
 static struct wal_writer wal_writer_singleton;
 
+/** Upper bound on the artificial group commit delay, seconds. */
+static const double wal_flush_delay_max = 0.002;
+
 enum wal_mode
 wal_mode()
 {
 	return wal_writer_singleton.wal_mode;
 }
 
+void
+wal_stat(struct wal_stat *stat)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	/*
+	 * The counters are updated by the WAL thread without any
+	 * synchronization. They are only used for monitoring, so
+	 * slightly stale values are fine and not worth a bus
+	 * round trip.
+	 */
+	stat->flush_count = writer->flush_count;
+	stat->entry_count = writer->entry_count;
+	stat->flush_latency = writer->flush_latency;
+	double delay = writer->flush_latency / 2;
+	if (delay > wal_flush_delay_max)
+		delay = wal_flush_delay_max;
+	stat->flush_delay = delay;
+	memcpy(stat->batch_size_hist, writer->batch_size_hist,
+	       sizeof(stat->batch_size_hist));
+}
+
+double
+wal_flush_latency(void)
+{
+	return wal_writer_singleton.flush_latency;
+}
+
 static void
 wal_write_to_disk(struct cmsg *msg);
 
+static void
+wal_flush_group(struct wal_writer *writer);
+
 static void
 tx_schedule_commit(struct cmsg *msg);
 
+/*
+ * The first hop has a NULL pipe: wal_write_to_disk() only buffers
+ * the entries and parks the message in the group commit queue.
+ * The message is dispatched to tx by hand, see wal_msg_complete().
+ */
 static struct cmsg_hop wal_request_route[] = {
-	{wal_write_to_disk, &wal_writer_singleton.tx_prio_pipe},
+	{wal_write_to_disk, NULL},
 	{tx_schedule_commit, NULL},
 };
 
@@ -213,6 +301,7 @@ wal_msg_create(struct wal_msg *batch)
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
 	vclock_create(&batch->vclock);
+	batch->last_durable = NULL;
 }
 
 static struct wal_msg *
@@ -238,13 +327,18 @@ xlog_write_entry(struct xlog *l, struct journal_entry *entry)
 			say_warn("injected broken lsn: %lld",
 				 (long long) (*row)->lsn);
 		}
-		if (xlog_write_row(l, *row) < 0) {
-			/*
-			 * Rollback all un-written rows
-			 */
-			xlog_tx_rollback(l);
-			return -1;
-		}
+	}
+	/*
+	 * Encode the whole statement batch in one pass: for
+	 * multi-statement transactions this replaces a per-row
+	 * obuf round trip with a single reservation.
+	 */
+	if (xlog_write_rows(l, entry->rows, entry->n_rows) < 0) {
+		/*
+		 * Rollback all un-written rows
+		 */
+		xlog_tx_rollback(l);
+		return -1;
 	}
 	return xlog_tx_commit(l);
 }
@@ -287,6 +381,7 @@ tx_schedule_commit(struct cmsg *msg)
 	}
 	/* Update the tx vclock to the latest written by wal. */
 	vclock_copy(&replicaset.vclock, &batch->vclock);
+	fiber_cond_broadcast(&replicaset.vclock_cond);
 	tx_schedule_queue(&batch->commit);
 	mempool_free(&writer->msg_pool, container_of(msg, struct wal_msg, base));
 }
@@ -349,6 +444,7 @@ tx_notify_checkpoint(struct cmsg *msg)
  */
 static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
+		  bool use_uring, bool direct_write,
 		  void (*wall_async_cb)(struct journal_entry *entry),
 		  const char *wal_dirname,
 		  int64_t wal_max_size, const struct tt_uuid *instance_uuid,
@@ -368,16 +464,36 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	struct xlog_opts opts = xlog_opts_default;
 	opts.sync_is_async = true;
+	opts.use_uring = use_uring;
+	opts.direct_write = direct_write;
+	/*
+	 * With io_uring the fsync required by wal_mode = 'fsync'
+	 * is submitted as an SQE linked to the write instead of
+	 * opening the file with O_SYNC, so that the write and
+	 * the sync together cost a single system call.
+	 */
+	if (wal_mode == WAL_FSYNC && use_uring)
+		opts.sync_each_write = true;
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid, &opts);
 	xlog_clear(&writer->current_wal);
-	if (wal_mode == WAL_FSYNC)
+	if (wal_mode == WAL_FSYNC && !use_uring)
 		writer->wal_dir.open_wflags |= O_SYNC;
 
 	stailq_create(&writer->rollback);
 	cmsg_init(&writer->in_rollback, NULL);
 
+	stailq_create(&writer->group_pending);
+	stailq_create(&writer->group_durable);
+	writer->group_entries = 0;
+	vclock_create(&writer->group_vclock_diff);
+	writer->flush_latency = 0;
+	writer->flush_count = 0;
+	writer->entry_count = 0;
+	memset(writer->batch_size_hist, 0, sizeof(writer->batch_size_hist));
+
 	writer->checkpoint_wal_size = 0;
 	writer->checkpoint_threshold = INT64_MAX;
+	writer->retention_size = INT64_MAX;
 	writer->checkpoint_triggered = false;
 
 	vclock_create(&writer->vclock);
@@ -472,15 +588,18 @@ wal_open(struct wal_writer *writer)
 }
 
 int
-wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
+wal_init(enum wal_mode wal_mode, bool use_uring, bool direct_write,
+	 void (*wall_async_cb)(struct journal_entry *entry),
 	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
 	/* Initialize the state. */
+	wal_mem_init();
 	struct wal_writer *writer = &wal_writer_singleton;
-	wal_writer_create(writer, wal_mode, wall_async_cb, wal_dirname,
-			  wal_max_size, instance_uuid, on_garbage_collection,
+	wal_writer_create(writer, wal_mode, use_uring, direct_write,
+			  wall_async_cb, wal_dirname, wal_max_size,
+			  instance_uuid, on_garbage_collection,
 			  on_checkpoint_threshold);
 
 	/* Start WAL thread. */
@@ -501,6 +620,9 @@ wal_enable(void)
 	/* Initialize the writer vclock from the recovery state. */
 	vclock_copy(&writer->vclock, &replicaset.vclock);
 
+	/* Start retaining committed rows for in-memory relaying. */
+	wal_mem_enable(&writer->vclock);
+
 	/*
 	 * Scan the WAL directory to build an index of all
 	 * existing WAL files. Required for garbage collection,
@@ -531,6 +653,7 @@ wal_free(void)
 	}
 
 	wal_writer_destroy(writer);
+	wal_mem_free();
 }
 
 struct wal_vclock_msg {
@@ -543,6 +666,8 @@ wal_sync_f(struct cbus_call_msg *data)
 {
 	struct wal_vclock_msg *msg = (struct wal_vclock_msg *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	/* A sync must cover the buffered group commit, if any. */
+	wal_flush_group(writer);
 	if (writer->in_rollback.route != NULL) {
 		/* We're rolling back a failed write. */
 		diag_set(ClientError, ER_WAL_IO);
@@ -586,6 +711,8 @@ wal_begin_checkpoint_f(struct cbus_call_msg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	/* The checkpoint vclock must cover the buffered group. */
+	wal_flush_group(writer);
 	if (writer->in_rollback.route != NULL) {
 		/*
 		 * We're rolling back a failed write and so
@@ -709,6 +836,41 @@ wal_set_checkpoint_threshold(int64_t threshold)
 	fiber_set_cancellable(cancellable);
 }
 
+struct wal_set_retention_size_msg {
+	struct cbus_call_msg base;
+	int64_t retention_size;
+};
+
+static void
+wal_enforce_retention(struct wal_writer *writer);
+
+static int
+wal_set_retention_size_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_retention_size_msg *msg;
+	msg = (struct wal_set_retention_size_msg *)data;
+	writer->retention_size = msg->retention_size;
+	/* A lowered budget takes effect right away. */
+	wal_enforce_retention(writer);
+	return 0;
+}
+
+void
+wal_set_retention_size(int64_t size)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	struct wal_set_retention_size_msg msg;
+	msg.retention_size = size > 0 ? size : INT64_MAX;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_retention_size_f, NULL,
+		  TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
 struct wal_gc_msg
 {
 	struct cbus_call_msg base;
@@ -760,6 +922,86 @@ wal_collect_garbage(const struct vclock *vclock)
 static void
 wal_notify_watchers(struct wal_writer *writer, unsigned events);
 
+/**
+ * Notify the TX thread that the WAL thread removed some WAL
+ * files on its own so that TX can shoot off WAL consumers that
+ * still need those files.
+ *
+ * We allocate the message with malloc() and we ignore
+ * allocation failures, because this is a pretty rare event and
+ * a failure to send this message isn't really critical.
+ */
+static void
+wal_gc_notify_tx(struct wal_writer *writer)
+{
+	static struct cmsg_hop route[] = {
+		{ tx_notify_gc, NULL },
+	};
+	struct tx_notify_gc_msg *msg = malloc(sizeof(*msg));
+	if (msg != NULL) {
+		if (xdir_first_vclock(&writer->wal_dir, &msg->vclock) < 0)
+			vclock_copy(&msg->vclock, &writer->vclock);
+		cmsg_init(&msg->base, route);
+		cpipe_push(&writer->tx_prio_pipe, &msg->base);
+	} else
+		say_warn("failed to allocate gc notification message");
+}
+
+/**
+ * Enforce the WAL retention budget: while the total size of the
+ * files in the WAL directory exceeds box.cfg.wal_retention_size,
+ * remove the oldest file that is not needed to recover from the
+ * last checkpoint and notify TX, which deactivates the consumers
+ * that still needed it. Runs in the WAL thread on file rotation,
+ * one file at a time, so neither the directory scan nor the
+ * removals ever block the TX loop.
+ */
+static void
+wal_enforce_retention(struct wal_writer *writer)
+{
+	if (writer->retention_size == INT64_MAX)
+		return;
+	/*
+	 * Same rule as on ENOSPC: never delete WALs necessary
+	 * to recover from the last checkpoint.
+	 */
+	int64_t gc_lsn = vclock_sum(&writer->checkpoint_vclock);
+	int64_t total = 0;
+	struct vclock *vclock;
+	for (vclock = vclockset_first(&writer->wal_dir.index);
+	     vclock != NULL;
+	     vclock = vclockset_next(&writer->wal_dir.index, vclock)) {
+		struct stat st;
+		const char *path =
+			xdir_format_filename(&writer->wal_dir,
+					     vclock_sum(vclock), NONE);
+		if (stat(path, &st) == 0)
+			total += st.st_size;
+	}
+	bool notify_gc = false;
+	while (total > writer->retention_size &&
+	       xdir_has_garbage(&writer->wal_dir, gc_lsn)) {
+		vclock = vclockset_first(&writer->wal_dir.index);
+		struct stat st;
+		const char *path =
+			xdir_format_filename(&writer->wal_dir,
+					     vclock_sum(vclock), NONE);
+		int64_t size = stat(path, &st) == 0 ? st.st_size : 0;
+		if (!notify_gc) {
+			say_warn("WAL retention budget exceeded "
+				 "(%lld of %lld bytes), removing old "
+				 "WAL files", (long long)total,
+				 (long long)writer->retention_size);
+		}
+		xdir_collect_garbage(&writer->wal_dir, gc_lsn,
+				     XDIR_GC_REMOVE_ONE | XDIR_GC_ASYNC);
+		notify_gc = true;
+		total -= size;
+	}
+	if (notify_gc)
+		wal_gc_notify_tx(writer);
+}
+
 /**
  * If there is no current WAL, try to open it, and close the
  * previous WAL. We close the previous WAL only after opening
@@ -783,6 +1025,11 @@ wal_opt_rotate(struct wal_writer *writer)
 	 */
 	if (xlog_is_open(&writer->current_wal) &&
 	    writer->current_wal.offset >= writer->wal_max_size) {
+		/*
+		 * Never seal the old WAL with a group commit
+		 * still buffered in it.
+		 */
+		wal_flush_group(writer);
 		/*
 		 * We can not handle xlog_close()
 		 * failure in any reasonable way.
@@ -806,6 +1053,7 @@ wal_opt_rotate(struct wal_writer *writer)
 	xdir_add_vclock(&writer->wal_dir, &writer->vclock);
 
 	wal_notify_watchers(writer, WAL_EVENT_ROTATE);
+	wal_enforce_retention(writer);
 	return 0;
 }
 
@@ -869,29 +1117,55 @@ out:
 	 * Notify the TX thread if the WAL thread had to delete
 	 * some WAL files to proceed so that TX can shoot off WAL
 	 * consumers that still need those files.
-	 *
-	 * We allocate the message with malloc() and we ignore
-	 * allocation failures, because this is a pretty rare
-	 * event and a failure to send this message isn't really
-	 * critical.
 	 */
-	if (notify_gc) {
-		static struct cmsg_hop route[] = {
-			{ tx_notify_gc, NULL },
-		};
-		struct tx_notify_gc_msg *msg = malloc(sizeof(*msg));
-		if (msg != NULL) {
-			if (xdir_first_vclock(&writer->wal_dir,
-					      &msg->vclock) < 0)
-				vclock_copy(&msg->vclock, &writer->vclock);
-			cmsg_init(&msg->base, route);
-			cpipe_push(&writer->tx_prio_pipe, &msg->base);
-		} else
-			say_warn("failed to allocate gc notification message");
-	}
+	if (notify_gc)
+		wal_gc_notify_tx(writer);
 	return rc;
 }
 
+/** WAL thread side of wal_warmup(). */
+static void
+wal_warmup_f(struct cmsg *msg)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->in_rollback.route == NULL &&
+	    wal_opt_rotate(writer) == 0) {
+		/*
+		 * Preallocate a minimal amount of disk space so
+		 * that the first commit after promotion doesn't
+		 * have to pay for the initial fallocate() either.
+		 * Errors are ignored - they will resurface with
+		 * proper handling on the first real write.
+		 */
+		wal_fallocate(writer, 1);
+	}
+	free(msg);
+}
+
+void
+wal_warmup(void)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	static struct cmsg_hop route[] = {
+		{ wal_warmup_f, NULL },
+	};
+	/*
+	 * The warmup is fire-and-forget: we allocate the message
+	 * with malloc() and let the WAL thread free it. A failure
+	 * to warm up only costs extra latency on the first write,
+	 * so allocation errors are not critical.
+	 */
+	struct cmsg *msg = (struct cmsg *)malloc(sizeof(*msg));
+	if (msg == NULL) {
+		say_warn("failed to allocate wal warmup message");
+		return;
+	}
+	cmsg_init(msg, route);
+	cpipe_push(&writer->wal_pipe, msg);
+}
+
 static void
 wal_writer_clear_bus(struct cmsg *msg)
 {
@@ -983,6 +1257,176 @@ wal_assign_lsn(struct vclock *vclock_diff, struct vclock *base,
 	}
 }
 
+enum {
+	/** Max number of entries to buffer before forcing a flush. */
+	WAL_GROUP_MAX_ENTRIES = 1024,
+};
+
+/**
+ * Hand a processed message back to tx. Mirrors cmsg_dispatch():
+ * the first hop of wal_request_route has a NULL pipe, so cbus
+ * doesn't dispatch the message when wal_write_to_disk() returns
+ * and it can be parked until its group is flushed.
+ */
+static void
+wal_msg_complete(struct wal_writer *writer, struct wal_msg *msg)
+{
+	msg->base.hop++;
+	cpipe_push(&writer->tx_prio_pipe, &msg->base);
+}
+
+/** Complete messages whose entries have all reached the disk. */
+static void
+wal_complete_durable(struct wal_writer *writer)
+{
+	struct wal_msg *msg, *next;
+	stailq_foreach_entry_safe(msg, next, &writer->group_durable,
+				  base.fifo) {
+		vclock_copy(&msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, msg);
+	}
+	stailq_create(&writer->group_durable);
+}
+
+/**
+ * Roll back the entries buffered but not yet flushed and
+ * complete their messages. A message may have a durable prefix
+ * if the xlog buffer overflowed in the middle of it - those
+ * entries stay committed.
+ */
+static void
+wal_rollback_pending(struct wal_writer *writer)
+{
+	struct wal_msg *msg, *next;
+	stailq_foreach_entry_safe(msg, next, &writer->group_pending,
+				  base.fifo) {
+		struct stailq rollback;
+		stailq_cut_tail(&msg->commit, msg->last_durable, &rollback);
+		struct journal_entry *entry;
+		stailq_foreach_entry(entry, &rollback, fifo)
+			entry->res = -1;
+		stailq_concat(&msg->rollback, &rollback);
+		vclock_copy(&msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, msg);
+	}
+	stailq_create(&writer->group_pending);
+}
+
+/** Account a completed flush in the batch statistics. */
+static void
+wal_flush_account(struct wal_writer *writer, double latency)
+{
+	/* EWMA with 1/8 gain, in the spirit of TCP RTT tuning. */
+	writer->flush_latency += (latency - writer->flush_latency) / 8;
+	writer->flush_count++;
+	writer->entry_count += writer->group_entries;
+	int bucket = 0;
+	while ((1 << (bucket + 1)) <= writer->group_entries &&
+	       bucket < WAL_BATCH_HIST_BUCKETS - 1)
+		bucket++;
+	writer->batch_size_hist[bucket]++;
+}
+
+/**
+ * The group commit point: flush the xlog buffer and hand all
+ * the accumulated messages back to tx, committed or, if the
+ * flush failed, rolled back.
+ */
+static void
+wal_flush_group(struct wal_writer *writer)
+{
+	if (stailq_empty(&writer->group_pending) &&
+	    stailq_empty(&writer->group_durable))
+		return;
+	ev_timer_stop(loop(), &writer->flush_timer);
+	double start = ev_monotonic_time();
+	ssize_t rc = xlog_flush(&writer->current_wal);
+	wal_flush_account(writer, ev_monotonic_time() - start);
+	if (rc >= 0) {
+		writer->checkpoint_wal_size += rc;
+		vclock_merge(&writer->vclock, &writer->group_vclock_diff);
+		stailq_concat(&writer->group_durable,
+			      &writer->group_pending);
+		wal_mem_commit();
+		wal_complete_durable(writer);
+		/*
+		 * Notify TX if the checkpoint threshold has been
+		 * exceeded. Use malloc() for allocating the
+		 * notification message and don't panic on error,
+		 * because if we fail to send the message now, we
+		 * will retry next time we process a request.
+		 */
+		if (!writer->checkpoint_triggered &&
+		    writer->checkpoint_wal_size >
+		    writer->checkpoint_threshold) {
+			static struct cmsg_hop route[] = {
+				{ tx_notify_checkpoint, NULL },
+			};
+			struct cmsg *msg = malloc(sizeof(*msg));
+			if (msg != NULL) {
+				cmsg_init(msg, route);
+				cpipe_push(&writer->tx_prio_pipe, msg);
+				writer->checkpoint_triggered = true;
+			} else {
+				say_warn("failed to allocate checkpoint "
+					 "notification message");
+			}
+		}
+	} else {
+		struct error *error = diag_last_error(diag_get());
+		if (error) {
+			/*
+			 * Until we can pass the error to tx, log
+			 * it and clear.
+			 */
+			error_log(error);
+			diag_clear(diag_get());
+		}
+		wal_mem_rollback();
+		wal_complete_durable(writer);
+		wal_rollback_pending(writer);
+		wal_writer_begin_rollback(writer);
+	}
+	writer->group_entries = 0;
+	vclock_create(&writer->group_vclock_diff);
+	wal_notify_watchers(writer, WAL_EVENT_WRITE);
+	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
+}
+
+static void
+wal_flush_timer_cb(ev_loop *loop, ev_timer *timer, int events)
+{
+	(void)loop;
+	(void)events;
+	wal_flush_group((struct wal_writer *)timer->data);
+}
+
+/**
+ * Arm the group commit timer. The delay tracks the recent flush
+ * latency: while the disk is busy for about that long anyway,
+ * waiting comparably long for more entries halves the number of
+ * flushes without a noticeable latency cost. The delay is
+ * bounded both by wal_flush_delay_max and, implicitly, by zero
+ * flush latency: a zero delay still coalesces all messages
+ * delivered in one cbus batch, because the timer can only fire
+ * after the whole batch has been processed.
+ */
+static void
+wal_schedule_flush(struct wal_writer *writer)
+{
+	if (writer->group_entries >= WAL_GROUP_MAX_ENTRIES) {
+		wal_flush_group(writer);
+		return;
+	}
+	if (ev_is_active(&writer->flush_timer))
+		return;
+	double delay = writer->flush_latency / 2;
+	if (delay > wal_flush_delay_max)
+		delay = wal_flush_delay_max;
+	ev_timer_set(&writer->flush_timer, delay, 0.);
+	ev_timer_start(loop(), &writer->flush_timer);
+}
+
 static void
 wal_write_to_disk(struct cmsg *msg)
 {
@@ -990,20 +1434,13 @@ wal_write_to_disk(struct cmsg *msg)
 	struct wal_msg *wal_msg = (struct wal_msg *) msg;
 	struct error *error;
 
-	/*
-	 * Track all vclock changes made by this batch into
-	 * vclock_diff variable and then apply it into writers'
-	 * vclock after each xlog flush.
-	 */
-	struct vclock vclock_diff;
-	vclock_create(&vclock_diff);
-
 	ERROR_INJECT_SLEEP(ERRINJ_WAL_DELAY);
 
 	if (writer->in_rollback.route != NULL) {
 		/* We're rolling back a failed write. */
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
+		wal_msg_complete(writer, wal_msg);
 		return;
 	}
 
@@ -1011,14 +1448,23 @@ wal_write_to_disk(struct cmsg *msg)
 	if (wal_opt_rotate(writer) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
-		return wal_writer_begin_rollback(writer);
+		/*
+		 * The group flush done before rotation may have
+		 * already failed and started a rollback.
+		 */
+		if (writer->in_rollback.route == NULL)
+			wal_writer_begin_rollback(writer);
+		wal_msg_complete(writer, wal_msg);
+		return;
 	}
 
 	/* Ensure there's enough disk space before writing anything. */
 	if (wal_fallocate(writer, wal_msg->approx_len) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
 		vclock_copy(&wal_msg->vclock, &writer->vclock);
-		return wal_writer_begin_rollback(writer);
+		wal_writer_begin_rollback(writer);
+		wal_msg_complete(writer, wal_msg);
+		return;
 	}
 
 	/*
@@ -1047,61 +1493,74 @@ wal_write_to_disk(struct cmsg *msg)
 	/*
 	 * Iterate over requests (transactions)
 	 */
-	int rc;
+	int rc = 0;
+	int n_entries = 0;
 	struct journal_entry *entry;
 	struct stailq_entry *last_committed = NULL;
 	stailq_foreach_entry(entry, &wal_msg->commit, fifo) {
-		wal_assign_lsn(&vclock_diff, &writer->vclock,
+		wal_assign_lsn(&writer->group_vclock_diff, &writer->vclock,
 			       entry->rows, entry->rows + entry->n_rows);
-		entry->res = vclock_sum(&vclock_diff) +
+		entry->res = vclock_sum(&writer->group_vclock_diff) +
 			     vclock_sum(&writer->vclock);
 		rc = xlog_write_entry(l, entry);
 		if (rc < 0)
-			goto done;
+			goto fail;
+		/*
+		 * Retain the rows in memory for the relays. They
+		 * stay invisible to them until the flush makes
+		 * them durable.
+		 */
+		wal_mem_write(entry->rows, entry->rows + entry->n_rows);
 		if (rc > 0) {
+			/*
+			 * The xlog buffer overflowed and
+			 * everything buffered so far, including
+			 * the previously parked messages, has
+			 * reached the disk.
+			 */
 			writer->checkpoint_wal_size += rc;
 			last_committed = &entry->fifo;
-			vclock_merge(&writer->vclock, &vclock_diff);
+			vclock_merge(&writer->vclock,
+				     &writer->group_vclock_diff);
+			stailq_concat(&writer->group_durable,
+				      &writer->group_pending);
+			wal_mem_commit();
 		}
 		/* rc == 0: the write is buffered in xlog_tx */
+		n_entries++;
 	}
-	rc = xlog_flush(l);
-	if (rc < 0)
-		goto done;
-
-	writer->checkpoint_wal_size += rc;
-	last_committed = stailq_last(&wal_msg->commit);
-	vclock_merge(&writer->vclock, &vclock_diff);
 
 	/*
-	 * Notify TX if the checkpoint threshold has been exceeded.
-	 * Use malloc() for allocating the notification message and
-	 * don't panic on error, because if we fail to send the
-	 * message now, we will retry next time we process a request.
+	 * Park the message until the group it belongs to is
+	 * flushed - that's where it is completed and handed
+	 * back to tx, see wal_flush_group().
 	 */
-	if (!writer->checkpoint_triggered &&
-	    writer->checkpoint_wal_size > writer->checkpoint_threshold) {
-		static struct cmsg_hop route[] = {
-			{ tx_notify_checkpoint, NULL },
-		};
-		struct cmsg *msg = malloc(sizeof(*msg));
-		if (msg != NULL) {
-			cmsg_init(msg, route);
-			cpipe_push(&writer->tx_prio_pipe, msg);
-			writer->checkpoint_triggered = true;
-		} else {
-			say_warn("failed to allocate checkpoint "
-				 "notification message");
-		}
-	}
+	wal_msg->last_durable = last_committed;
+	stailq_add_tail(&writer->group_pending, &msg->fifo);
+	writer->group_entries += n_entries;
+	fiber_gc();
+	wal_schedule_flush(writer);
+	return;
 
-done:
+fail:
 	error = diag_last_error(diag_get());
 	if (error) {
 		/* Until we can pass the error to tx, log it and clear. */
 		error_log(error);
 		diag_clear(diag_get());
 	}
+	/*
+	 * Everything buffered after the last physical write is
+	 * lost, so the parked messages have to be completed
+	 * right now: the fully durable ones as committed, the
+	 * rest as rolled back.
+	 */
+	wal_mem_rollback();
+	wal_complete_durable(writer);
+	wal_rollback_pending(writer);
+	writer->group_entries = 0;
+	vclock_create(&writer->group_vclock_diff);
+	ev_timer_stop(loop(), &writer->flush_timer);
 	/*
 	 * Remember the vclock of the last successfully written row so
 	 * that we can update replicaset.vclock once this message gets
@@ -1124,11 +1583,11 @@ done:
 			entry->res = -1;
 		/* Rollback unprocessed requests */
 		stailq_concat(&wal_msg->rollback, &rollback);
-		wal_writer_begin_rollback(writer);
 	}
+	wal_writer_begin_rollback(writer);
+	wal_msg_complete(writer, wal_msg);
 	fiber_gc();
 	wal_notify_watchers(writer, WAL_EVENT_WRITE);
-	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
 }
 
 /** WAL writer main loop.  */
@@ -1141,6 +1600,9 @@ wal_writer_f(va_list ap)
 	/** Initialize eio in this thread */
 	coio_enable();
 
+	ev_timer_init(&writer->flush_timer, wal_flush_timer_cb, 0., 0.);
+	writer->flush_timer.data = writer;
+
 	struct cbus_endpoint endpoint;
 	cbus_endpoint_create(&endpoint, "wal", fiber_schedule_cb, fiber());
 	/*
@@ -1152,6 +1614,9 @@ wal_writer_f(va_list ap)
 
 	cbus_loop(&endpoint);
 
+	wal_flush_group(writer);
+	ev_timer_stop(loop(), &writer->flush_timer);
+
 	/*
 	 * Create a new empty WAL on shutdown so that we don't
 	 * have to rescan the last WAL to find the instance vclock.
@@ -1267,6 +1732,7 @@ wal_write_none_async(struct journal *journal,
 		       entry->rows + entry->n_rows);
 	vclock_merge(&writer->vclock, &vclock_diff);
 	vclock_copy(&replicaset.vclock, &writer->vclock);
+	fiber_cond_broadcast(&replicaset.vclock_cond);
 	entry->res = vclock_sum(&writer->vclock);
 
 	return 0;
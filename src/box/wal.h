@@ -79,9 +79,16 @@ typedef void (*wal_on_checkpoint_threshold_f)(void);
 
 /**
  * Start WAL thread and initialize WAL writer.
+ *
+ * If @a use_uring is set, WAL files are written through io_uring
+ * when the kernel supports it, see xlog_opts::use_uring.
+ *
+ * If @a direct_write is set, WAL files are written with O_DIRECT
+ * when the filesystem supports it, see xlog_opts::direct_write.
  */
 int
-wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
+wal_init(enum wal_mode wal_mode, bool use_uring, bool direct_write,
+	 void (*wall_async_cb)(struct journal_entry *entry),
 	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
 	 wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold);
@@ -92,6 +99,21 @@ wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *ent
 int
 wal_enable(void);
 
+/**
+ * Warm up the WAL writer in anticipation of the first write:
+ * make sure the current WAL file is open, creating the next one
+ * if necessary, and preallocate some disk space in it. Called on
+ * read-only instances and on promotion to master so that the
+ * first write after a failover doesn't stall on file creation
+ * and fallocate() system calls.
+ *
+ * The work is done asynchronously in the WAL thread. Errors are
+ * ignored - they will resurface on the first real write, which
+ * knows how to handle them.
+ */
+void
+wal_warmup(void);
+
 /**
  * Stop WAL thread and free WAL writer resources.
  */
@@ -179,6 +201,42 @@ wal_atfork();
 enum wal_mode
 wal_mode();
 
+enum {
+	/** Number of buckets in the batch size histogram. */
+	WAL_BATCH_HIST_BUCKETS = 11,
+};
+
+/** WAL group commit statistics, see box.stat.wal(). */
+struct wal_stat {
+	/** Number of xlog flushes since start. */
+	int64_t flush_count;
+	/** Number of journal entries written since start. */
+	int64_t entry_count;
+	/** Moving average of a flush duration, in seconds. */
+	double flush_latency;
+	/** Current artificial group commit delay, in seconds. */
+	double flush_delay;
+	/**
+	 * Histogram of entries per flush: bucket i counts
+	 * flushes of [2^i, 2^(i+1)) entries, the last bucket is
+	 * open-ended.
+	 */
+	int64_t batch_size_hist[WAL_BATCH_HIST_BUCKETS];
+};
+
+/** Fill @a stat with the current group commit statistics. */
+void
+wal_stat(struct wal_stat *stat);
+
+/**
+ * Moving average of the WAL flush duration, in seconds. Updated
+ * by the WAL thread and read without synchronization, so only
+ * suitable for heuristics and monitoring. May be called from any
+ * thread.
+ */
+double
+wal_flush_latency(void);
+
 /**
  * Wait until all submitted writes are successfully flushed
  * to disk. Returns 0 on success, -1 if write failed.
@@ -230,6 +288,16 @@ wal_commit_checkpoint(struct wal_checkpoint *checkpoint);
 void
 wal_set_checkpoint_threshold(int64_t threshold);
 
+/**
+ * Set the WAL retention budget: the total size of WAL files kept
+ * on disk for lagging consumers. Exceeding it makes the WAL
+ * thread remove the oldest files not needed for recovery and
+ * deactivate the consumers that still needed them. A value less
+ * than or equal to zero means the budget is unlimited.
+ */
+void
+wal_set_retention_size(int64_t size);
+
 /**
  * Remove WAL files that are not needed by consumers reading
  * rows at @vclock or newer.
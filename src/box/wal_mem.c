@@ -0,0 +1,470 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "wal_mem.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fiber.h"
+#include "tt_pthread.h"
+#include "vclock.h"
+#include "xrow.h"
+
+enum {
+	/** Number of chunks in the ring. */
+	WAL_MEM_CHUNK_COUNT = 8,
+	/**
+	 * Size of the row body storage of a single chunk. The
+	 * whole buffer retains up to WAL_MEM_CHUNK_COUNT of
+	 * these, i.e. 16 MB of encoded payload by default, plus
+	 * the row headers.
+	 */
+	WAL_MEM_CHUNK_SIZE = 2 * 1024 * 1024,
+	/** Initial capacity of a chunk row header array. */
+	WAL_MEM_CHUNK_ROWS_MIN = 1024,
+	/**
+	 * A single fetch copies at most this many body bytes, so
+	 * that a relay catching up from the buffer does not stall
+	 * the WAL thread on the buffer mutex. The relay drains
+	 * the rest with repeated fetches.
+	 */
+	WAL_MEM_FETCH_MAX = 1024 * 1024,
+};
+
+/**
+ * A contiguous run of retained rows. Chunks are recycled in FIFO
+ * order: when the ring is full, the oldest chunk is dropped to
+ * make room for new rows.
+ */
+struct wal_mem_chunk {
+	/**
+	 * Monotonically growing chunk id, never reused. Used to
+	 * tell the committed part of the ring from the appended
+	 * but not yet flushed tail.
+	 */
+	uint64_t id;
+	/** Vclock before the first row of the chunk. */
+	struct vclock vclock;
+	/** Row headers. Row bodies point into @a data. */
+	struct xrow_header *rows;
+	/** Number of rows in the chunk. */
+	uint32_t row_count;
+	/** Capacity of the @a rows array. */
+	uint32_t row_capacity;
+	/** Row body storage, WAL_MEM_CHUNK_SIZE bytes. */
+	char *data;
+	/** Bytes of @a data in use. */
+	uint32_t used;
+};
+
+struct wal_mem {
+	/**
+	 * Protects the buffer from concurrent access: the WAL
+	 * thread appends, relay threads fetch. The lock is all
+	 * but uncontended - fetches are short and happen about
+	 * once per group commit.
+	 */
+	pthread_mutex_t mutex;
+	/** Set by wal_mem_enable(). */
+	bool is_enabled;
+	/**
+	 * Set when a row could not be retained (too big to fit a
+	 * chunk or out of memory). Appends are discarded until
+	 * the next commit restarts the buffer past the gap.
+	 */
+	bool is_discarding;
+	/** The chunk ring. */
+	struct wal_mem_chunk chunks[WAL_MEM_CHUNK_COUNT];
+	/** Index of the oldest chunk in use. */
+	uint32_t first;
+	/** Number of chunks in use. */
+	uint32_t count;
+	/** Id to assign to the next chunk. */
+	uint64_t next_id;
+	/** Vclock before the oldest retained row. */
+	struct vclock begin_vclock;
+	/** Vclock after the last committed row. */
+	struct vclock vclock;
+	/** Vclock after the last appended row. */
+	struct vclock append_vclock;
+	/**
+	 * Position of the last committed row, used to hide the
+	 * uncommitted tail from readers and to rewind on
+	 * rollback.
+	 */
+	struct {
+		uint64_t chunk_id;
+		uint32_t row_count;
+		uint32_t used;
+	} committed;
+};
+
+static struct wal_mem wal_mem_singleton;
+
+void
+wal_mem_batch_create(struct wal_mem_batch *batch)
+{
+	batch->rows = NULL;
+	batch->row_count = 0;
+	batch->row_capacity = 0;
+	ibuf_create(&batch->data, &cord()->slabc, WAL_MEM_FETCH_MAX);
+}
+
+void
+wal_mem_batch_destroy(struct wal_mem_batch *batch)
+{
+	free(batch->rows);
+	ibuf_destroy(&batch->data);
+}
+
+static struct wal_mem_chunk *
+wal_mem_chunk_at(struct wal_mem *mem, uint32_t pos)
+{
+	return &mem->chunks[(mem->first + pos) % WAL_MEM_CHUNK_COUNT];
+}
+
+/** Remember the current append position as committed. */
+static void
+wal_mem_save_committed(struct wal_mem *mem)
+{
+	if (mem->count > 0) {
+		struct wal_mem_chunk *chunk =
+			wal_mem_chunk_at(mem, mem->count - 1);
+		mem->committed.chunk_id = chunk->id;
+		mem->committed.row_count = chunk->row_count;
+		mem->committed.used = chunk->used;
+	} else {
+		/* No chunk will ever match this id. */
+		mem->committed.chunk_id = mem->next_id - 1;
+		mem->committed.row_count = 0;
+		mem->committed.used = 0;
+	}
+}
+
+/** Drop all retained rows and restart the buffer at @a vclock. */
+static void
+wal_mem_restart(struct wal_mem *mem, const struct vclock *vclock)
+{
+	for (uint32_t i = 0; i < mem->count; i++) {
+		struct wal_mem_chunk *chunk = wal_mem_chunk_at(mem, i);
+		chunk->row_count = 0;
+		chunk->used = 0;
+	}
+	mem->count = 0;
+	vclock_copy(&mem->begin_vclock, vclock);
+	vclock_copy(&mem->vclock, vclock);
+	vclock_copy(&mem->append_vclock, vclock);
+	mem->is_discarding = false;
+	wal_mem_save_committed(mem);
+}
+
+void
+wal_mem_init(void)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	memset(mem, 0, sizeof(*mem));
+	tt_pthread_mutex_init(&mem->mutex, NULL);
+	mem->next_id = 1;
+}
+
+void
+wal_mem_free(void)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	for (uint32_t i = 0; i < WAL_MEM_CHUNK_COUNT; i++) {
+		free(mem->chunks[i].rows);
+		free(mem->chunks[i].data);
+	}
+	tt_pthread_mutex_destroy(&mem->mutex);
+}
+
+void
+wal_mem_enable(const struct vclock *vclock)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	tt_pthread_mutex_lock(&mem->mutex);
+	wal_mem_restart(mem, vclock);
+	mem->is_enabled = true;
+	tt_pthread_mutex_unlock(&mem->mutex);
+}
+
+/**
+ * Open a new chunk for appending, dropping the oldest one if the
+ * ring is full. Returns NULL on allocation failure.
+ */
+static struct wal_mem_chunk *
+wal_mem_add_chunk(struct wal_mem *mem)
+{
+	if (mem->count == WAL_MEM_CHUNK_COUNT) {
+		/*
+		 * Recycle the oldest chunk. Readers that were
+		 * relying on it will fall back to the xlog
+		 * files.
+		 */
+		struct wal_mem_chunk *oldest = wal_mem_chunk_at(mem, 0);
+		oldest->row_count = 0;
+		oldest->used = 0;
+		mem->first = (mem->first + 1) % WAL_MEM_CHUNK_COUNT;
+		mem->count--;
+		vclock_copy(&mem->begin_vclock,
+			    &wal_mem_chunk_at(mem, 0)->vclock);
+	}
+	struct wal_mem_chunk *chunk = wal_mem_chunk_at(mem, mem->count);
+	if (chunk->data == NULL) {
+		chunk->data = malloc(WAL_MEM_CHUNK_SIZE);
+		if (chunk->data == NULL)
+			return NULL;
+	}
+	if (chunk->rows == NULL) {
+		chunk->rows = malloc(WAL_MEM_CHUNK_ROWS_MIN *
+				     sizeof(*chunk->rows));
+		if (chunk->rows == NULL)
+			return NULL;
+		chunk->row_capacity = WAL_MEM_CHUNK_ROWS_MIN;
+	}
+	chunk->id = mem->next_id++;
+	vclock_copy(&chunk->vclock, &mem->append_vclock);
+	chunk->row_count = 0;
+	chunk->used = 0;
+	mem->count++;
+	return chunk;
+}
+
+void
+wal_mem_write(struct xrow_header **begin, struct xrow_header **end)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	tt_pthread_mutex_lock(&mem->mutex);
+	if (!mem->is_enabled)
+		goto done;
+	for (struct xrow_header **row = begin; row < end; row++) {
+		if (mem->is_discarding) {
+			vclock_follow_xrow(&mem->append_vclock, *row);
+			continue;
+		}
+		size_t size = 0;
+		for (int i = 0; i < (*row)->bodycnt; i++)
+			size += (*row)->body[i].iov_len;
+		if (size > WAL_MEM_CHUNK_SIZE) {
+			/*
+			 * Too big to retain. Stop buffering: the
+			 * gap makes the tail useless until the
+			 * next commit restarts the buffer past
+			 * it.
+			 */
+			mem->is_discarding = true;
+			vclock_follow_xrow(&mem->append_vclock, *row);
+			continue;
+		}
+		struct wal_mem_chunk *chunk = mem->count > 0 ?
+			wal_mem_chunk_at(mem, mem->count - 1) : NULL;
+		if (chunk != NULL && chunk->row_count == chunk->row_capacity) {
+			uint32_t capacity = chunk->row_capacity * 2;
+			struct xrow_header *rows =
+				realloc(chunk->rows,
+					capacity * sizeof(*rows));
+			if (rows != NULL) {
+				chunk->rows = rows;
+				chunk->row_capacity = capacity;
+			} else {
+				/* Spill over to a new chunk. */
+				chunk = NULL;
+			}
+		}
+		if (chunk == NULL || chunk->used + size > WAL_MEM_CHUNK_SIZE) {
+			chunk = wal_mem_add_chunk(mem);
+			if (chunk == NULL) {
+				mem->is_discarding = true;
+				vclock_follow_xrow(&mem->append_vclock, *row);
+				continue;
+			}
+		}
+		struct xrow_header *copy = &chunk->rows[chunk->row_count];
+		*copy = **row;
+		if (size > 0) {
+			char *data = chunk->data + chunk->used;
+			for (int i = 0; i < (*row)->bodycnt; i++) {
+				memcpy(data, (*row)->body[i].iov_base,
+				       (*row)->body[i].iov_len);
+				data += (*row)->body[i].iov_len;
+			}
+			copy->bodycnt = 1;
+			copy->body[0].iov_base = chunk->data + chunk->used;
+			copy->body[0].iov_len = size;
+			chunk->used += size;
+		} else {
+			copy->bodycnt = 0;
+		}
+		chunk->row_count++;
+		vclock_follow_xrow(&mem->append_vclock, *row);
+	}
+done:
+	tt_pthread_mutex_unlock(&mem->mutex);
+}
+
+void
+wal_mem_commit(void)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	tt_pthread_mutex_lock(&mem->mutex);
+	if (!mem->is_enabled)
+		goto done;
+	if (mem->is_discarding) {
+		/* Restart the buffer right after the gap. */
+		wal_mem_restart(mem, &mem->append_vclock);
+		goto done;
+	}
+	vclock_copy(&mem->vclock, &mem->append_vclock);
+	wal_mem_save_committed(mem);
+done:
+	tt_pthread_mutex_unlock(&mem->mutex);
+}
+
+void
+wal_mem_rollback(void)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	tt_pthread_mutex_lock(&mem->mutex);
+	if (!mem->is_enabled)
+		goto done;
+	/* Find the chunk holding the last committed row. */
+	uint32_t pos;
+	for (pos = 0; pos < mem->count; pos++) {
+		if (wal_mem_chunk_at(mem, pos)->id == mem->committed.chunk_id)
+			break;
+	}
+	if (pos == mem->count) {
+		/*
+		 * The committed position has been recycled by the
+		 * rolled back tail. Restart from the committed
+		 * vclock.
+		 */
+		wal_mem_restart(mem, &mem->vclock);
+		goto done;
+	}
+	struct wal_mem_chunk *chunk = wal_mem_chunk_at(mem, pos);
+	chunk->row_count = mem->committed.row_count;
+	chunk->used = mem->committed.used;
+	for (uint32_t i = pos + 1; i < mem->count; i++) {
+		struct wal_mem_chunk *next = wal_mem_chunk_at(mem, i);
+		next->row_count = 0;
+		next->used = 0;
+	}
+	mem->count = pos + 1;
+	mem->is_discarding = false;
+	vclock_copy(&mem->append_vclock, &mem->vclock);
+done:
+	tt_pthread_mutex_unlock(&mem->mutex);
+}
+
+int
+wal_mem_fetch(struct vclock *vclock, struct wal_mem_batch *batch)
+{
+	struct wal_mem *mem = &wal_mem_singleton;
+	int rc = -1;
+	batch->row_count = 0;
+	ibuf_reset(&batch->data);
+	tt_pthread_mutex_lock(&mem->mutex);
+	if (!mem->is_enabled || mem->is_discarding)
+		goto done;
+	/*
+	 * The buffer can serve the reader only if it retains all
+	 * rows following the reader's vclock, i.e. the reader is
+	 * not behind the buffer start.
+	 */
+	if (vclock_compare(&mem->begin_vclock, vclock) > 0)
+		goto done;
+	rc = 0;
+	size_t copied = 0;
+	for (uint32_t pos = 0; pos < mem->count; pos++) {
+		struct wal_mem_chunk *chunk = wal_mem_chunk_at(mem, pos);
+		if (chunk->id > mem->committed.chunk_id)
+			break;
+		uint32_t row_count = chunk->id == mem->committed.chunk_id ?
+			mem->committed.row_count : chunk->row_count;
+		for (uint32_t i = 0; i < row_count; i++) {
+			struct xrow_header *row = &chunk->rows[i];
+			if (row->lsn <= vclock_get(vclock, row->replica_id))
+				continue; /* already seen, skip */
+			if (batch->row_count == batch->row_capacity) {
+				uint32_t capacity = batch->row_capacity > 0 ?
+					batch->row_capacity * 2 :
+					WAL_MEM_CHUNK_ROWS_MIN;
+				struct xrow_header *rows =
+					realloc(batch->rows,
+						capacity * sizeof(*rows));
+				if (rows == NULL) {
+					rc = -1;
+					goto done;
+				}
+				batch->rows = rows;
+				batch->row_capacity = capacity;
+			}
+			struct xrow_header *copy =
+				&batch->rows[batch->row_count];
+			*copy = *row;
+			if (row->bodycnt > 0) {
+				size_t size = row->body[0].iov_len;
+				void *data = ibuf_alloc(&batch->data, size);
+				if (data == NULL) {
+					rc = -1;
+					goto done;
+				}
+				memcpy(data, row->body[0].iov_base, size);
+				/*
+				 * The ibuf may move when it grows -
+				 * remember the offset and fix the
+				 * pointers up once the batch is
+				 * complete.
+				 */
+				copy->body[0].iov_base = (void *)(uintptr_t)
+					((char *)data - batch->data.rpos);
+				copied += size;
+			}
+			batch->row_count++;
+			vclock_follow_xrow(vclock, row);
+			if (copied >= WAL_MEM_FETCH_MAX)
+				goto done;
+		}
+	}
+done:
+	tt_pthread_mutex_unlock(&mem->mutex);
+	if (rc == 0) {
+		for (uint32_t i = 0; i < batch->row_count; i++) {
+			struct xrow_header *row = &batch->rows[i];
+			if (row->bodycnt > 0) {
+				row->body[0].iov_base = batch->data.rpos +
+					(uintptr_t)row->body[0].iov_base;
+			}
+		}
+	}
+	return rc;
+}
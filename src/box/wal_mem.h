@@ -0,0 +1,143 @@
+#ifndef TARANTOOL_WAL_MEM_H_INCLUDED
+#define TARANTOOL_WAL_MEM_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <small/ibuf.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct vclock;
+struct xrow_header;
+
+/**
+ * In-memory WAL buffer.
+ *
+ * The WAL thread retains the tail of the write ahead log - row
+ * headers plus row bodies of the most recently committed
+ * transactions - in a ring of memory chunks. A relay serving an
+ * in-sync replica streams rows straight from the buffer instead
+ * of reading them back from the xlog files, which removes the
+ * disk (page cache) reads, the full row decode and the recovery
+ * cursor bookkeeping from the steady-state replication path. A
+ * relay that has fallen behind the buffered tail falls back to
+ * the xlog files as before.
+ *
+ * The buffer only ever contains rows that have been made durable
+ * by a successful xlog flush: rows of a buffered group commit are
+ * appended right away but stay invisible to readers until the
+ * group is flushed, and are discarded if the flush fails.
+ */
+
+/**
+ * A batch of rows fetched from the in-memory WAL buffer.
+ * The batch owns copies of the rows, so it stays valid after
+ * the buffer rotates. Created and used in a relay thread.
+ */
+struct wal_mem_batch {
+	/** Row headers. Row bodies point into @a data. */
+	struct xrow_header *rows;
+	/** Number of fetched rows. */
+	uint32_t row_count;
+	/** Capacity of the @a rows array. */
+	uint32_t row_capacity;
+	/** Copied row bodies. */
+	struct ibuf data;
+};
+
+/** Initialize a batch. Uses the slab cache of the calling cord. */
+void
+wal_mem_batch_create(struct wal_mem_batch *batch);
+
+/** Free the batch memory. */
+void
+wal_mem_batch_destroy(struct wal_mem_batch *batch);
+
+/** Initialize the in-memory WAL buffer. Called from wal_init(). */
+void
+wal_mem_init(void);
+
+/** Free the in-memory WAL buffer. Called from wal_free(). */
+void
+wal_mem_free(void);
+
+/**
+ * Start retaining rows. @a vclock is the position the first
+ * appended row will follow, i.e. the WAL writer vclock at the
+ * moment journalling is enabled.
+ */
+void
+wal_mem_enable(const struct vclock *vclock);
+
+/**
+ * Append rows to the buffer. Called by the WAL thread after the
+ * rows have been written to the xlog buffer. The appended rows
+ * are invisible to readers until wal_mem_commit().
+ */
+void
+wal_mem_write(struct xrow_header **begin, struct xrow_header **end);
+
+/**
+ * Make all appended rows visible to readers. Called by the WAL
+ * thread when an xlog flush has made them durable.
+ */
+void
+wal_mem_commit(void);
+
+/**
+ * Discard the rows appended since the last wal_mem_commit().
+ * Called by the WAL thread when an xlog flush has failed.
+ */
+void
+wal_mem_rollback(void);
+
+/**
+ * Fetch the rows following @a vclock into @a batch and advance
+ * @a vclock accordingly. The result may be capped: iterate until
+ * an empty batch is returned to drain the buffer.
+ *
+ * Returns 0 if the buffer covers @a vclock (the batch may be
+ * empty if the reader is up to date), -1 if it does not - because
+ * the reader is too far behind, the buffer has been restarted or
+ * memory for the copies could not be allocated - and the caller
+ * must read the xlog files instead. May be called from any
+ * thread.
+ */
+int
+wal_mem_fetch(struct vclock *vclock, struct wal_mem_batch *batch);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_WAL_MEM_H_INCLUDED */
@@ -32,11 +32,13 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include "fiber.h"
 #include "exception.h"
 #include "crc32.h"
 #include "fio.h"
+#include "iouring.h"
 #include "third_party/tarantool_eio.h"
 #include <msgpuck.h>
 
@@ -46,6 +48,8 @@
 #include "xrow.h"
 #include "iproto_constants.h"
 #include "errinj.h"
+#include "third_party/base64.h"
+#include <zdict.h>
 
 /*
  * FALLOC_FL_KEEP_SIZE flag has existed since fallocate() was
@@ -87,6 +91,14 @@ enum {
 	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/**
+	 * Alignment unit of O_DIRECT writes: the file offset,
+	 * the write size and the buffer address must all be
+	 * multiples of it. 4K covers both 512e and 4Kn devices.
+	 */
+	XLOG_DIRECT_ALIGN = 4096,
+	/** Size of the O_DIRECT staging buffer. */
+	XLOG_DIRECT_BUF_SIZE = 256 * 1024,
 };
 
 const struct xlog_opts xlog_opts_default = {
@@ -100,12 +112,25 @@ const struct xlog_opts xlog_opts_default = {
 /* {{{ struct xlog_meta */
 
 enum {
+	/** zstd compression level of xlog tx blocks. */
+	XLOG_ZSTD_LEVEL = 3,
+	/** Hard limit on the size of a trained zstd dictionary. */
+	XLOG_ZDICT_SIZE_MAX = 4096,
+	/** Base64 representation bound for XLOG_ZDICT_SIZE_MAX. */
+	XLOG_ZDICT_BASE64_LEN_MAX = (XLOG_ZDICT_SIZE_MAX + 2) / 3 * 4 + 4,
+	/** Cap on the size of a single training sample. */
+	XLOG_ZDICT_SAMPLE_MAX = 4096,
+	/** Total size of the training sample buffer. */
+	XLOG_ZDICT_SAMPLES_BUF_SIZE = 256 * 1024,
+	/** Don't bother training on less samples than this. */
+	XLOG_ZDICT_TRAIN_MIN_SAMPLES = 64,
 	/*
 	 * The maximum length of xlog meta
 	 *
 	 * @sa xlog_meta_parse()
 	 */
-	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX
+	XLOG_META_LEN_MAX = 1024 + VCLOCK_STR_LEN_MAX +
+			    XLOG_ZDICT_BASE64_LEN_MAX
 };
 
 #define INSTANCE_UUID_KEY "Instance"
@@ -113,6 +138,7 @@ enum {
 #define VCLOCK_KEY "VClock"
 #define VERSION_KEY "Version"
 #define PREV_VCLOCK_KEY "PrevVClock"
+#define ZDICT_KEY "Dictionary"
 
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
@@ -133,6 +159,8 @@ xlog_meta_create(struct xlog_meta *meta, const char *filetype,
 		vclock_copy(&meta->prev_vclock, prev_vclock);
 	else
 		vclock_clear(&meta->prev_vclock);
+	meta->zdict = NULL;
+	meta->zdict_size = 0;
 }
 
 /**
@@ -166,6 +194,15 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		SNPRINT(total, snprintf, buf, size, PREV_VCLOCK_KEY ": %s\n",
 			vclock_to_string(&meta->prev_vclock));
 	}
+	if (meta->zdict != NULL) {
+		char zdict_b64[XLOG_ZDICT_BASE64_LEN_MAX];
+		assert(meta->zdict_size <= XLOG_ZDICT_SIZE_MAX);
+		int b64_len = base64_encode(meta->zdict, meta->zdict_size,
+					    zdict_b64, sizeof(zdict_b64),
+					    BASE64_NOWRAP);
+		SNPRINT(total, snprintf, buf, size, ZDICT_KEY ": %.*s\n",
+			b64_len, zdict_b64);
+	}
 	SNPRINT(total, snprintf, buf, size, "\n");
 	assert(total > 0);
 	return total;
@@ -307,6 +344,25 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 			 */
 			if (parse_vclock(val, val_end, &meta->prev_vclock) != 0)
 				return -1;
+		} else if (xlog_meta_key_equal(key, key_end, ZDICT_KEY)) {
+			/*
+			 * Dictionary: <base64 zstd dictionary>
+			 */
+			if (val_end - val > XLOG_ZDICT_BASE64_LEN_MAX) {
+				diag_set(XlogError, "too large zstd "
+					 "dictionary");
+				return -1;
+			}
+			free(meta->zdict);
+			meta->zdict = (char *)malloc(XLOG_ZDICT_SIZE_MAX);
+			if (meta->zdict == NULL) {
+				diag_set(OutOfMemory, XLOG_ZDICT_SIZE_MAX,
+					 "malloc", "xlog zstd dictionary");
+				return -1;
+			}
+			meta->zdict_size = base64_decode(val, val_end - val,
+							 meta->zdict,
+							 XLOG_ZDICT_SIZE_MAX);
 		} else if (xlog_meta_key_equal(key, key_end, VERSION_KEY)) {
 			/* Ignore Version: for now */
 		} else {
@@ -332,6 +388,7 @@ xdir_create(struct xdir *dir, const char *dirname, enum xdir_type type,
 	memset(dir, 0, sizeof(*dir));
 	dir->opts = *opts;
 	vclockset_new(&dir->index);
+	vclock_clear(&dir->base_vclock);
 	/* Default mode. */
 	dir->mode = 0660;
 	dir->instance_uuid = instance_uuid;
@@ -383,6 +440,80 @@ xdir_destroy(struct xdir *dir)
 {
 	/** Free vclock objects allocated in xdir_scan(). */
 	vclockset_reset(&dir->index);
+	free(dir->zdict_samples);
+	free(dir->zdict);
+}
+
+/**
+ * Collect the payload of a transaction block into the zstd
+ * dictionary sample buffer of @a dir. @a src is the xlog output
+ * buffer with the fixheader gap at the start. Samples are
+ * silently dropped once the buffer is full; it is drained by
+ * xdir_zdict_train() on the next file rotation. Failure to
+ * sample is not an error - the worst outcome is a less fit
+ * dictionary.
+ */
+static void
+xdir_zdict_sample(struct xdir *dir, const struct obuf *src)
+{
+	if (dir->zdict_sample_count >= XLOG_ZDICT_SAMPLES_MAX)
+		return;
+	if (dir->zdict_samples == NULL) {
+		dir->zdict_samples =
+			(char *)malloc(XLOG_ZDICT_SAMPLES_BUF_SIZE);
+		if (dir->zdict_samples == NULL)
+			return;
+	}
+	size_t left = XLOG_ZDICT_SAMPLES_BUF_SIZE - dir->zdict_samples_size;
+	size_t max = left < XLOG_ZDICT_SAMPLE_MAX ? left :
+		     XLOG_ZDICT_SAMPLE_MAX;
+	char *dst = dir->zdict_samples + dir->zdict_samples_size;
+	size_t size = 0;
+	size_t offset = XLOG_FIXHEADER_SIZE;
+	const struct iovec *iov;
+	for (iov = src->iov; iov->iov_len != 0 && size < max; ++iov) {
+		size_t chunk = iov->iov_len - offset;
+		if (chunk > max - size)
+			chunk = max - size;
+		memcpy(dst + size, (char *)iov->iov_base + offset, chunk);
+		size += chunk;
+		offset = 0;
+	}
+	if (size == 0)
+		return;
+	dir->zdict_sample_sizes[dir->zdict_sample_count++] = size;
+	dir->zdict_samples_size += size;
+}
+
+/**
+ * Train a zstd dictionary from the collected samples and make
+ * it the dictionary of subsequently created files. Called on
+ * file rotation. Keeps the previous dictionary if there is not
+ * enough new material or training fails.
+ */
+static void
+xdir_zdict_train(struct xdir *dir)
+{
+	if (dir->zdict_sample_count < XLOG_ZDICT_TRAIN_MIN_SAMPLES)
+		return;
+	char *zdict = (char *)malloc(XLOG_ZDICT_SIZE_MAX);
+	if (zdict == NULL)
+		return;
+	size_t zdict_size = ZDICT_trainFromBuffer(zdict, XLOG_ZDICT_SIZE_MAX,
+						  dir->zdict_samples,
+						  dir->zdict_sample_sizes,
+						  dir->zdict_sample_count);
+	dir->zdict_samples_size = 0;
+	dir->zdict_sample_count = 0;
+	if (ZDICT_isError(zdict_size)) {
+		say_debug("%s: zstd dictionary training failed: %s",
+			  dir->dirname, ZDICT_getErrorName(zdict_size));
+		free(zdict);
+		return;
+	}
+	free(dir->zdict);
+	dir->zdict = zdict;
+	dir->zdict_size = zdict_size;
 }
 
 /**
@@ -472,6 +603,10 @@ xdir_open_cursor(struct xdir *dir, int64_t signature,
 		diag_set(XlogError, "%s: signature check failed", filename);
 		return -1;
 	}
+	if (dir->tx_cache)
+		xlog_cursor_enable_tx_cache(cursor);
+	if (dir->prefetch)
+		xlog_cursor_enable_prefetch(cursor);
 	return 0;
 }
 
@@ -781,6 +916,27 @@ xlog_init(struct xlog *xlog, const struct xlog_opts *opts)
 	return 0;
 }
 
+/**
+ * Digest the dictionary from xlog meta for use by the
+ * compression context. No-op if the file has no dictionary or
+ * compression is disabled.
+ */
+static int
+xlog_zdict_digest(struct xlog *xlog)
+{
+	if (xlog->meta.zdict == NULL || xlog->opts.no_compression)
+		return 0;
+	xlog->zcdict = ZSTD_createCDict(xlog->meta.zdict,
+					xlog->meta.zdict_size,
+					XLOG_ZSTD_LEVEL);
+	if (xlog->zcdict == NULL) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 "failed to digest dictionary");
+		return -1;
+	}
+	return 0;
+}
+
 void
 xlog_clear(struct xlog *l)
 {
@@ -796,10 +952,95 @@ xlog_destroy(struct xlog *xlog)
 	obuf_destroy(&xlog->obuf);
 	obuf_destroy(&xlog->zbuf);
 	ZSTD_freeCCtx(xlog->zctx);
+	ZSTD_freeCDict(xlog->zcdict);
+	free(xlog->meta.zdict);
+	iouring_delete(xlog->ring);
+	free(xlog->dbuf);
 	TRASH(xlog);
 	xlog->fd = -1;
 }
 
+/**
+ * Set up an io_uring for the log file if requested. Failure is
+ * not an error: the log falls back to write(2), and to a
+ * separate fdatasync(2) if opts.sync_each_write is set.
+ */
+static void
+xlog_uring_create(struct xlog *xlog)
+{
+	if (!xlog->opts.use_uring)
+		return;
+	/* O_DIRECT writes go through their own pwrite(2) path. */
+	if (xlog->dbuf != NULL)
+		return;
+	xlog->ring = iouring_new();
+	if (xlog->ring == NULL)
+		say_warn("%s: io_uring is unavailable, falling back "
+			 "to write(2)", xlog->filename);
+}
+
+/**
+ * Switch the log file to O_DIRECT and set up the aligned
+ * staging buffer, if requested. Must be called when the meta
+ * has been written (or read back) with buffered io and
+ * xlog->offset points at the end of the data. Failure is not
+ * an error: the log falls back to buffered writes.
+ */
+static void
+xlog_direct_create(struct xlog *xlog)
+{
+	if (!xlog->opts.direct_write)
+		return;
+#ifdef O_DIRECT
+	void *dbuf;
+	if (posix_memalign(&dbuf, XLOG_DIRECT_ALIGN,
+			   XLOG_DIRECT_BUF_SIZE) != 0) {
+		say_warn("%s: failed to allocate the O_DIRECT staging "
+			 "buffer, falling back to buffered writes",
+			 xlog->filename);
+		return;
+	}
+	/*
+	 * The staging buffer head must mirror the partial last
+	 * block of the file so that the next flush can rewrite
+	 * the whole block.
+	 */
+	size_t tail = xlog->offset & (XLOG_DIRECT_ALIGN - 1);
+	if (tail > 0 && fio_pread(xlog->fd, dbuf, tail,
+				  xlog->offset - tail) != (ssize_t)tail) {
+		say_warn("%s: failed to read the log tail, falling back "
+			 "to buffered writes", xlog->filename);
+		free(dbuf);
+		return;
+	}
+	/*
+	 * Everything written so far went through the page cache;
+	 * push it to disk and drop the pages so that they can't
+	 * shadow the upcoming direct writes.
+	 */
+	if (fdatasync(xlog->fd) != 0) {
+		say_warn("%s: fdatasync() failed, falling back to "
+			 "buffered writes", xlog->filename);
+		free(dbuf);
+		return;
+	}
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise(xlog->fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	int flags = fcntl(xlog->fd, F_GETFL);
+	if (flags < 0 || fcntl(xlog->fd, F_SETFL, flags | O_DIRECT) != 0) {
+		say_warn("%s: O_DIRECT is not supported, falling back "
+			 "to buffered writes", xlog->filename);
+		free(dbuf);
+		return;
+	}
+	xlog->dbuf = (char *)dbuf;
+#else
+	say_warn("%s: O_DIRECT is not supported on this platform, "
+		 "falling back to buffered writes", xlog->filename);
+#endif /* O_DIRECT */
+}
+
 int
 xlog_create(struct xlog *xlog, const char *name, int flags,
 	    const struct xlog_meta *meta, const struct xlog_opts *opts)
@@ -821,6 +1062,18 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 		goto err;
 
 	xlog->meta = *meta;
+	/* The xlog owns its copy of the dictionary. */
+	if (meta->zdict != NULL) {
+		xlog->meta.zdict = (char *)malloc(meta->zdict_size);
+		if (xlog->meta.zdict == NULL) {
+			diag_set(OutOfMemory, meta->zdict_size, "malloc",
+				 "xlog zstd dictionary");
+			goto err_open;
+		}
+		memcpy(xlog->meta.zdict, meta->zdict, meta->zdict_size);
+		if (xlog_zdict_digest(xlog) != 0)
+			goto err_open;
+	}
 	xlog->is_inprogress = true;
 	snprintf(xlog->filename, PATH_MAX, "%s%s", name, inprogress_suffix);
 
@@ -859,6 +1112,8 @@ xlog_create(struct xlog *xlog, const char *name, int flags,
 	}
 
 	xlog->offset = meta_len; /* first log starts after meta */
+	xlog_direct_create(xlog);
+	xlog_uring_create(xlog);
 	return 0;
 err_write:
 	close(xlog->fd);
@@ -903,6 +1158,9 @@ xlog_open(struct xlog *xlog, const char *name, const struct xlog_opts *opts)
 		diag_set(XlogError, "Unexpected end of file");
 		goto err_read;
 	}
+	/* Appended rows must use the same dictionary. */
+	if (xlog_zdict_digest(xlog) != 0)
+		goto err_read;
 
 	/* Check if the file has EOF marker. */
 	xlog->offset = fio_lseek(xlog->fd, -(off_t)sizeof(magic), SEEK_END);
@@ -931,6 +1189,8 @@ no_eof:
 			goto err_read;
 		}
 	}
+	xlog_direct_create(xlog);
+	xlog_uring_create(xlog);
 	return 0;
 err_read:
 	close(xlog->fd);
@@ -974,19 +1234,40 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	/*
 	 * For WAL dir: store vclock of the previous xlog file
 	 * to check for gaps on recovery.
+	 *
+	 * For SNAP dir: store vclock of the base checkpoint of
+	 * an incremental snapshot, so that recovery can find the
+	 * rest of the chain.
 	 */
 	const struct vclock *prev_vclock = NULL;
 	if (dir->type == XLOG && !vclockset_empty(&dir->index))
 		prev_vclock = vclockset_last(&dir->index);
+	else if (dir->type == SNAP && vclock_is_set(&dir->base_vclock))
+		prev_vclock = &dir->base_vclock;
 
 	struct xlog_meta meta;
 	xlog_meta_create(&meta, dir->filetype, dir->instance_uuid,
 			 vclock, prev_vclock);
 
+	/*
+	 * For WAL dir: train a dictionary on the payloads
+	 * sampled from the previous file and compress the new
+	 * file with it. Small transactions share most of their
+	 * msgpack key and field name encoding, which compresses
+	 * poorly without cross-transaction context.
+	 */
+	if (dir->type == XLOG) {
+		xdir_zdict_train(dir);
+		meta.zdict = dir->zdict;
+		meta.zdict_size = dir->zdict_size;
+	}
+
 	const char *filename = xdir_format_filename(dir, signature, NONE);
 	if (xlog_create(xlog, filename, dir->open_wflags, &meta,
 			&dir->opts) != 0)
 		return -1;
+	if (dir->type == XLOG)
+		xlog->zdict_dir = dir;
 
 	/* Rename xlog file */
 	if (dir->suffix != INPROGRESS && xlog_rename(xlog)) {
@@ -1034,6 +1315,82 @@ xlog_fallocate(struct xlog *log, size_t len)
 #endif /* HAVE_FALLOCATE */
 }
 
+/**
+ * Write a block-aligned chunk of the staging buffer at a
+ * block-aligned file offset, restarting on EINTR and short
+ * writes.
+ */
+static ssize_t
+xlog_direct_pwrite(struct xlog *log, size_t size, off_t offset)
+{
+	assert(size % XLOG_DIRECT_ALIGN == 0);
+	assert(offset % XLOG_DIRECT_ALIGN == 0);
+	size_t pos = 0;
+	while (pos < size) {
+		ssize_t n = pwrite(log->fd, log->dbuf + pos, size - pos,
+				   offset + pos);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		pos += n;
+	}
+	return size;
+}
+
+/**
+ * Copy a vector of buffers into the aligned staging buffer and
+ * flush it to the file with block-aligned pwrite(2) calls,
+ * bypassing the page cache. The partial last block is padded
+ * with zeros on disk and kept at the head of the staging buffer
+ * to be rewritten by the next flush; the padding is trimmed by
+ * xlog_write_eof() when the file is closed.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of payload bytes written
+ */
+static ssize_t
+xlog_tx_write_direct(struct xlog *log, const struct iovec *iov, int iovcnt)
+{
+	off_t base = log->offset & ~((off_t)XLOG_DIRECT_ALIGN - 1);
+	size_t used = log->offset & (XLOG_DIRECT_ALIGN - 1);
+	ssize_t total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		const char *src = (const char *)iov[i].iov_base;
+		size_t len = iov[i].iov_len;
+		total += len;
+		while (len > 0) {
+			size_t chunk = MIN(len, XLOG_DIRECT_BUF_SIZE - used);
+			memcpy(log->dbuf + used, src, chunk);
+			used += chunk;
+			src += chunk;
+			len -= chunk;
+			if (used < XLOG_DIRECT_BUF_SIZE)
+				continue;
+			if (xlog_direct_pwrite(log, used, base) < 0)
+				return -1;
+			base += used;
+			used = 0;
+		}
+	}
+	if (used > 0) {
+		size_t padded = (used + XLOG_DIRECT_ALIGN - 1) &
+				~((size_t)XLOG_DIRECT_ALIGN - 1);
+		memset(log->dbuf + used, 0, padded - used);
+		if (xlog_direct_pwrite(log, padded, base) < 0)
+			return -1;
+		/*
+		 * Move the partial last block to the head of the
+		 * staging buffer for the next flush.
+		 */
+		size_t full = used & ~((size_t)XLOG_DIRECT_ALIGN - 1);
+		if (full > 0)
+			memmove(log->dbuf, log->dbuf + full, used - full);
+	}
+	return total;
+}
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -1084,7 +1441,18 @@ xlog_tx_write_plain(struct xlog *log)
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
+	ssize_t written;
+	if (log->dbuf != NULL)
+		written = xlog_tx_write_direct(log, log->obuf.iov,
+					       log->obuf.pos + 1);
+	else if (log->ring != NULL)
+		written = iouring_writevn_sync(log->ring, log->fd,
+					       log->obuf.iov,
+					       log->obuf.pos + 1, log->offset,
+					       log->opts.sync_each_write);
+	else
+		written = fio_writevn(log->fd, log->obuf.iov,
+				      log->obuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
@@ -1093,56 +1461,55 @@ xlog_tx_write_plain(struct xlog *log)
 	return obuf_size(&log->obuf);
 }
 
-/**
- * Write a compressed block of xrow objects.
- * @retval -1  error
- * @retval >= 0 the number of bytes written
- */
-static off_t
-xlog_tx_write_zstd(struct xlog *log)
+size_t
+xlog_tx_compress_bound(const struct obuf *src)
 {
-	char *fixheader = (char *)obuf_alloc(&log->zbuf,
-					     XLOG_FIXHEADER_SIZE);
+	size_t bound = XLOG_FIXHEADER_SIZE;
+	size_t offset = XLOG_FIXHEADER_SIZE;
+	const struct iovec *iov;
+	for (iov = src->iov; iov->iov_len; ++iov) {
+		bound += ZSTD_compressBound(iov->iov_len - offset);
+		offset = 0;
+	}
+	return bound;
+}
 
+ssize_t
+xlog_tx_compress(char *dst, size_t dst_size, ZSTD_CCtx *zctx,
+		 const ZSTD_CDict *zcdict, const struct obuf *src)
+{
+	char *fixheader = dst;
+	char *zdst = dst + XLOG_FIXHEADER_SIZE;
+	char *zend = dst + dst_size;
 	uint32_t crc32c = 0;
-	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	const struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
-	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
-		/* Estimate max output buffer size. */
-		size_t zmax_size = ZSTD_compressBound(iov->iov_len - offset);
-		/* Allocate a destination buffer. */
-		void *zdst = obuf_reserve(&log->zbuf, zmax_size);
-		if (!zdst) {
-			diag_set(OutOfMemory, zmax_size, "runtime arena",
-				  "compression buffer");
-			goto error;
-		}
+	if (zcdict != NULL)
+		ZSTD_compressBegin_usingCDict(zctx, zcdict);
+	else
+		ZSTD_compressBegin(zctx, XLOG_ZSTD_LEVEL);
+	for (iov = src->iov; iov->iov_len; ++iov) {
 		size_t (*fcompress)(ZSTD_CCtx *, void *, size_t,
 				    const void *, size_t);
 		/*
-		 * If it's the last iov or the last
-		 * log has 0 bytes, end the stream.
+		 * If it's the last iov or the next one
+		 * has 0 bytes, end the stream.
 		 */
-		if (iov == log->obuf.iov + log->obuf.pos ||
-		    !(iov + 1)->iov_len) {
+		if (iov == src->iov + src->pos || !(iov + 1)->iov_len)
 			fcompress = ZSTD_compressEnd;
-		} else {
+		else
 			fcompress = ZSTD_compressContinue;
-		}
-		size_t zsize = fcompress(log->zctx, zdst, zmax_size,
+		size_t zsize = fcompress(zctx, zdst, zend - zdst,
 					 (char *)iov->iov_base + offset,
 					 iov->iov_len - offset);
 		if (ZSTD_isError(zsize)) {
 			diag_set(ClientError, ER_COMPRESSION,
 				 ZSTD_getErrorName(zsize));
-			goto error;
+			return -1;
 		}
-		/* Advance output buffer to the end of compressed data. */
-		obuf_alloc(&log->zbuf, zsize);
 		/* Update crc32c */
-		crc32c = crc32_calc(crc32c, (char *)zdst, zsize);
+		crc32c = crc32_calc(crc32c, zdst, zsize);
+		zdst += zsize;
 		/* Discount fixheader size for all iovs after first. */
 		offset = 0;
 	}
@@ -1150,8 +1517,7 @@ xlog_tx_write_zstd(struct xlog *log)
 	*(log_magic_t *)fixheader = zrow_marker;
 	char *data;
 	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
+	data = mp_encode_uint(data, zdst - dst - XLOG_FIXHEADER_SIZE);
 	/* Encode crc32 for previous row */
 	data = mp_encode_uint(data, 0);
 	/* Encode crc32 for current row */
@@ -1166,6 +1532,29 @@ xlog_tx_write_zstd(struct xlog *log)
 			data += padding - 1;
 		}
 	}
+	return zdst - dst;
+}
+
+/**
+ * Write a compressed block of xrow objects.
+ * @retval -1  error
+ * @retval >= 0 the number of bytes written
+ */
+static off_t
+xlog_tx_write_zstd(struct xlog *log)
+{
+	size_t zmax_size = xlog_tx_compress_bound(&log->obuf);
+	char *zdst = (char *)obuf_reserve(&log->zbuf, zmax_size);
+	if (zdst == NULL) {
+		diag_set(OutOfMemory, zmax_size, "runtime arena",
+			  "compression buffer");
+		goto error;
+	}
+	ssize_t zsize = xlog_tx_compress(zdst, zmax_size, log->zctx,
+					 log->zcdict, &log->obuf);
+	if (zsize < 0)
+		goto error;
+	obuf_alloc(&log->zbuf, zsize);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
@@ -1174,8 +1563,17 @@ xlog_tx_write_zstd(struct xlog *log)
 	});
 
 	ssize_t written;
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
+	if (log->dbuf != NULL)
+		written = xlog_tx_write_direct(log, log->zbuf.iov,
+					       log->zbuf.pos + 1);
+	else if (log->ring != NULL)
+		written = iouring_writevn_sync(log->ring, log->fd,
+					       log->zbuf.iov,
+					       log->zbuf.pos + 1, log->offset,
+					       log->opts.sync_each_write);
+	else
+		written = fio_writevn(log->fd, log->zbuf.iov,
+				      log->zbuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
@@ -1193,6 +1591,9 @@ error:
 #define SYNC_ROUND_DOWN(size)	((size) & ~(4096 - 1))
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
+static ssize_t
+xlog_tx_finish_write(struct xlog *log, ssize_t written);
+
 /**
  * Writes xlog batch to file
  */
@@ -1203,8 +1604,16 @@ xlog_tx_write(struct xlog *log)
 		return 0;
 	ssize_t written;
 
+	if (log->zdict_dir != NULL)
+		xdir_zdict_sample(log->zdict_dir, &log->obuf);
+	/*
+	 * A trained dictionary pays off precisely on the small
+	 * transactions the plain threshold would skip, so with
+	 * a dictionary at hand compress everything.
+	 */
 	if (!log->opts.no_compression &&
-	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+	    (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD ||
+	     log->zcdict != NULL)) {
 		written = xlog_tx_write_zstd(log);
 	} else {
 		written = xlog_tx_write_plain(log);
@@ -1215,6 +1624,31 @@ xlog_tx_write(struct xlog *log)
 	});
 
 	obuf_reset(&log->obuf);
+	return xlog_tx_finish_write(log, written);
+}
+
+/**
+ * Account a transaction write: advance the log offset, handle a
+ * write error by truncating the file back to the last known good
+ * position, sync and throttle according to the log options.
+ *
+ * @retval -1  error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_tx_finish_write(struct xlog *log, ssize_t written)
+{
+	/*
+	 * Without io_uring the sync part of sync_each_write is
+	 * done with a separate system call.
+	 */
+	if (written > 0 && log->opts.sync_each_write && log->ring == NULL &&
+	    fdatasync(log->fd) < 0) {
+		diag_set(SystemError, "failed to sync file '%s'",
+			 log->filename);
+		written = -1;
+	}
+
 	/*
 	 * Simplify recovery after a temporary write failure:
 	 * truncate the file to the best known good write
@@ -1224,6 +1658,16 @@ xlog_tx_write(struct xlog *log)
 		if (lseek(log->fd, log->offset, SEEK_SET) < 0 ||
 		    ftruncate(log->fd, log->offset) != 0)
 			panic_syserror("failed to truncate xlog after write error");
+		/*
+		 * The failed flush may have clobbered the partial
+		 * last block kept at the staging buffer head -
+		 * re-mirror it from the file.
+		 */
+		size_t tail = log->offset & (XLOG_DIRECT_ALIGN - 1);
+		if (log->dbuf != NULL && tail > 0 &&
+		    fio_pread(log->fd, log->dbuf, XLOG_DIRECT_ALIGN,
+			      log->offset - tail) < (ssize_t)tail)
+			panic_syserror("failed to reread xlog after write error");
 		log->allocated = 0;
 		return -1;
 	}
@@ -1299,14 +1743,17 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 
 	struct obuf_svp svp = obuf_create_svp(&log->obuf);
 	size_t page_offset = obuf_size(&log->obuf);
-	/** encode row into iovec */
+	/*
+	 * Encode the row header into an on-stack buffer and chain
+	 * the body up via iovec - nothing is allocated here.
+	 * Don't write sync to the disk.
+	 */
+	char hdr_buf[XROW_HEADER_LEN_MAX];
 	struct iovec iov[XROW_IOVMAX];
-	/** don't write sync to the disk */
-	int iovcnt = xrow_header_encode(packet, 0, iov, 0);
-	if (iovcnt < 0) {
-		obuf_rollback_to_svp(&log->obuf, &svp);
-		return -1;
-	}
+	iov[0].iov_base = hdr_buf;
+	iov[0].iov_len = xrow_header_encode_buf(packet, 0, hdr_buf);
+	memcpy(iov + 1, packet->body, sizeof(iov[0]) * packet->bodycnt);
+	int iovcnt = 1 + packet->bodycnt;
 	for (int i = 0; i < iovcnt; ++i) {
 		struct errinj *inj = errinj(ERRINJ_WAL_WRITE_PARTIAL,
 					    ERRINJ_INT);
@@ -1337,6 +1784,73 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	return row_size;
 }
 
+/*
+ * Add a batch of rows to a log in one pass and possibly flush
+ * the log. Equivalent to calling xlog_write_row() per row, but
+ * the headers and bodies of the whole batch are encoded into a
+ * single contiguous output reservation, so a multi-statement
+ * transaction pays one obuf round trip instead of one per row.
+ *
+ * @retval  -1 error, check diag.
+ * @retval >=0 the number of bytes written to buffer.
+ */
+ssize_t
+xlog_write_rows(struct xlog *log, struct xrow_header **rows, int n_rows)
+{
+	/* @sa xlog_write_row(). */
+	if (obuf_size(&log->obuf) == 0) {
+		if (!obuf_alloc(&log->obuf, XLOG_FIXHEADER_SIZE)) {
+			diag_set(OutOfMemory, XLOG_FIXHEADER_SIZE,
+				  "runtime arena", "xlog tx output buffer");
+			return -1;
+		}
+	}
+
+	struct obuf_svp svp = obuf_create_svp(&log->obuf);
+	size_t page_offset = obuf_size(&log->obuf);
+	size_t size = 0;
+	for (int i = 0; i < n_rows; ++i) {
+		size += XROW_HEADER_LEN_MAX;
+		for (int j = 0; j < rows[i]->bodycnt; ++j)
+			size += rows[i]->body[j].iov_len;
+	}
+	char *data = (char *) obuf_reserve(&log->obuf, size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "runtime arena",
+			 "xlog tx output buffer");
+		return -1;
+	}
+	char *pos = data;
+	for (int i = 0; i < n_rows; ++i) {
+		pos += xrow_header_encode_buf(rows[i], 0, pos);
+		for (int j = 0; j < rows[i]->bodycnt; ++j) {
+			memcpy(pos, rows[i]->body[j].iov_base,
+			       rows[i]->body[j].iov_len);
+			pos += rows[i]->body[j].iov_len;
+		}
+		struct errinj *inj = errinj(ERRINJ_WAL_WRITE_PARTIAL,
+					    ERRINJ_INT);
+		if (inj != NULL && inj->iparam >= 0 &&
+		    page_offset + (size_t) (pos - data) >
+		    (size_t) inj->iparam) {
+			diag_set(ClientError, ER_INJECTION,
+				 "xlog write injection");
+			obuf_rollback_to_svp(&log->obuf, &svp);
+			return -1;
+		};
+	}
+	obuf_alloc(&log->obuf, pos - data);
+	log->tx_rows += n_rows;
+
+	size_t row_size = obuf_size(&log->obuf) - page_offset;
+	if (log->is_autocommit &&
+	    obuf_size(&log->obuf) >= XLOG_TX_AUTOCOMMIT_THRESHOLD &&
+	    xlog_tx_write(log) < 0)
+		return -1;
+
+	return row_size;
+}
+
 /**
  * Begin a multi-statement xlog transaction. All xrow objects
  * of a single transaction share the same header and checksum
@@ -1377,6 +1891,51 @@ xlog_tx_rollback(struct xlog *log)
 	obuf_reset(&log->obuf);
 }
 
+int
+xlog_tx_detach(struct xlog *log, struct obuf *data)
+{
+	assert(!log->is_autocommit);
+	assert(log->obuf.slabc == &cord()->slabc);
+	*data = log->obuf;
+	obuf_create(&log->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	int tx_rows = log->tx_rows;
+	log->tx_rows = 0;
+	log->is_autocommit = true;
+	return tx_rows;
+}
+
+ssize_t
+xlog_write_compressed_tx(struct xlog *log, const char *data, size_t size,
+			 int row_count)
+{
+	/*
+	 * The caller may have another transaction buffered in
+	 * log->obuf - it must not be disturbed, so stash its row
+	 * counter for the duration of the write.
+	 */
+	int tx_rows = log->tx_rows;
+	log->tx_rows = row_count;
+	struct iovec iov;
+	iov.iov_base = (void *)data;
+	iov.iov_len = size;
+	ssize_t written;
+	if (log->dbuf != NULL)
+		written = xlog_tx_write_direct(log, &iov, 1);
+	else if (log->ring != NULL)
+		written = iouring_writevn_sync(log->ring, log->fd, &iov, 1,
+					       log->offset,
+					       log->opts.sync_each_write);
+	else
+		written = fio_writevn(log->fd, &iov, 1);
+	if (written < 0) {
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+	}
+	written = xlog_tx_finish_write(log, written);
+	log->tx_rows = tx_rows;
+	return written;
+}
+
 /**
  * Flush any outstanding xlog_tx transactions at the end of
  * a WAL write batch.
@@ -1430,15 +1989,43 @@ xlog_write_eof(struct xlog *l)
 	});
 
 	/*
-	 * Free disk space preallocated with xlog_fallocate().
+	 * Free disk space preallocated with xlog_fallocate()
+	 * and trim the block padding left by O_DIRECT writes.
 	 * Don't write the eof marker if this fails, otherwise
 	 * we'll get "data after eof marker" error on recovery.
 	 */
-	if (l->allocated > 0 && ftruncate(l->fd, l->offset) < 0) {
+	if ((l->allocated > 0 || l->dbuf != NULL) &&
+	    ftruncate(l->fd, l->offset) < 0) {
 		diag_set(SystemError, "ftruncate() failed");
 		return -1;
 	}
 
+#ifdef O_DIRECT
+	/*
+	 * The EOF marker is tiny and the file is closing down,
+	 * so write it buffered: clear O_DIRECT first.
+	 */
+	if (l->dbuf != NULL) {
+		int flags = fcntl(l->fd, F_GETFL);
+		if (flags < 0 ||
+		    fcntl(l->fd, F_SETFL, flags & ~O_DIRECT) != 0) {
+			diag_set(SystemError, "fcntl() failed");
+			return -1;
+		}
+	}
+#endif /* O_DIRECT */
+
+	/*
+	 * Writes through io_uring or O_DIRECT pwrite don't move
+	 * the file position, so seek to the end of the data
+	 * explicitly before appending the EOF marker.
+	 */
+	if ((l->ring != NULL || l->dbuf != NULL) &&
+	    lseek(l->fd, l->offset, SEEK_SET) < 0) {
+		diag_set(SystemError, "lseek() failed");
+		return -1;
+	}
+
 	if (fio_writen(l->fd, &eof_marker, sizeof(eof_marker)) < 0) {
 		diag_set(SystemError, "write() failed");
 		return -1;
@@ -1490,6 +2077,412 @@ xlog_atfork(struct xlog *xlog)
 
 /* }}} */
 
+/* {{{ xlog tx cache */
+
+enum {
+	/** Number of entries in the shared xlog tx cache. */
+	XLOG_TX_CACHE_SIZE = 128,
+	/**
+	 * Do not cache decoded transactions larger than this:
+	 * a few huge transactions would wash the whole cache
+	 * out.
+	 */
+	XLOG_TX_CACHE_ENTRY_MAX = 256 * 1024,
+};
+
+/**
+ * An entry of the shared xlog tx cache: a single decoded
+ * (verified and decompressed) xlog transaction.
+ */
+struct xlog_tx_cache_entry {
+	/** Device id of the file the tx was read from. */
+	uint64_t dev;
+	/** Inode of the file the tx was read from. */
+	uint64_t ino;
+	/** Signature of the file the tx was read from. */
+	int64_t signature;
+	/** File offset of the tx fixheader. */
+	off_t offset;
+	/** Size of the raw tx in the file, with the fixheader. */
+	size_t raw_size;
+	/** Decoded rows, NULL if the entry is unused. */
+	char *data;
+	/** Size of the decoded rows. */
+	size_t size;
+};
+
+/**
+ * A ring of recently decoded xlog transactions shared between all
+ * threads reading xlogs. When several relays stream the same WAL
+ * tail to resubscribed replicas, all but the first one find the
+ * transactions here instead of re-reading and re-decompressing
+ * them from the file. Round-robin eviction is as good as LRU for
+ * readers trailing each other through the same files.
+ */
+static struct xlog_tx_cache_entry xlog_tx_cache[XLOG_TX_CACHE_SIZE];
+/** Write position in the xlog_tx_cache ring. */
+static int xlog_tx_cache_next;
+/** A lock protecting the xlog tx cache: relays run in threads. */
+static pthread_mutex_t xlog_tx_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Look up a decoded tx in the shared cache and set up
+ * @a tx_cursor from it on a hit.
+ *
+ * @retval 0 hit, @a raw_size is set to the raw tx size
+ * @retval 1 miss
+ * @retval -1 error, check diag
+ */
+static int
+xlog_tx_cache_find(struct xlog_cursor *cursor, off_t offset,
+		   struct xlog_tx_cursor *tx_cursor, size_t *raw_size)
+{
+	int rc = 1;
+	tt_pthread_mutex_lock(&xlog_tx_cache_lock);
+	for (int i = 0; i < XLOG_TX_CACHE_SIZE; i++) {
+		struct xlog_tx_cache_entry *e = &xlog_tx_cache[i];
+		if (e->data == NULL || e->dev != cursor->cache_dev ||
+		    e->ino != cursor->cache_ino ||
+		    e->signature != cursor->cache_signature ||
+		    e->offset != offset)
+			continue;
+		ibuf_create(&tx_cursor->rows, &cord()->slabc,
+			    XLOG_TX_AUTOCOMMIT_THRESHOLD);
+		void *dst = ibuf_alloc(&tx_cursor->rows, e->size);
+		if (dst == NULL) {
+			ibuf_destroy(&tx_cursor->rows);
+			diag_set(OutOfMemory, e->size, "runtime",
+				 "xlog rows buffer");
+			rc = -1;
+			break;
+		}
+		memcpy(dst, e->data, e->size);
+		tx_cursor->size = e->size;
+		*raw_size = e->raw_size;
+		rc = 0;
+		break;
+	}
+	tt_pthread_mutex_unlock(&xlog_tx_cache_lock);
+	return rc;
+}
+
+/**
+ * Add a decoded tx to the shared cache, evicting the oldest
+ * entry. Errors are ignored: the cache is an optimization.
+ */
+static void
+xlog_tx_cache_add(struct xlog_cursor *cursor, off_t offset, size_t raw_size,
+		  const struct xlog_tx_cursor *tx_cursor)
+{
+	size_t size = ibuf_used(&tx_cursor->rows);
+	if (size > XLOG_TX_CACHE_ENTRY_MAX)
+		return;
+	char *data = (char *)malloc(size);
+	if (data == NULL)
+		return;
+	memcpy(data, tx_cursor->rows.rpos, size);
+	tt_pthread_mutex_lock(&xlog_tx_cache_lock);
+	struct xlog_tx_cache_entry *e = &xlog_tx_cache[xlog_tx_cache_next];
+	xlog_tx_cache_next = (xlog_tx_cache_next + 1) % XLOG_TX_CACHE_SIZE;
+	free(e->data);
+	e->dev = cursor->cache_dev;
+	e->ino = cursor->cache_ino;
+	e->signature = cursor->cache_signature;
+	e->offset = offset;
+	e->raw_size = raw_size;
+	e->data = data;
+	e->size = size;
+	tt_pthread_mutex_unlock(&xlog_tx_cache_lock);
+}
+
+void
+xlog_cursor_enable_tx_cache(struct xlog_cursor *cursor)
+{
+	struct stat st;
+	if (cursor->fd < 0 || fstat(cursor->fd, &st) != 0)
+		return;
+	/*
+	 * Identify the file by device and inode rather than by
+	 * name so that all cursors reading the same log share
+	 * the entries. The signature guards against inode reuse
+	 * after the log is deleted by garbage collection.
+	 */
+	cursor->cache_dev = st.st_dev;
+	cursor->cache_ino = st.st_ino;
+	cursor->cache_signature = vclock_sum(&cursor->meta.vclock);
+	cursor->tx_cache = true;
+}
+
+/* }}} */
+
+/* {{{ xlog_cursor prefetch thread */
+
+enum {
+	/**
+	 * Maximum number of decoded transactions queued ahead of
+	 * the consumer, so that the prefetch thread can not run
+	 * arbitrarily far ahead of it.
+	 */
+	XLOG_PREFETCH_QUEUE_MAX = 64,
+};
+
+/**
+ * A single decoded (verified and decompressed) xlog transaction
+ * produced by the prefetch thread.
+ */
+struct xlog_prefetch_tx {
+	/** Link in xlog_prefetch::queue. */
+	struct stailq_entry next;
+	/** File offset of the tx fixheader. */
+	off_t offset;
+	/** Size of the raw tx in the file, with the fixheader. */
+	size_t raw_size;
+	/** Size of the decoded rows. */
+	size_t size;
+	/** Decoded rows. */
+	char data[0];
+};
+
+/**
+ * State of pipelined xlog reading: a prefetch thread reads the
+ * file ahead, verifies tx checksums and decompresses tx blocks,
+ * while the consumer takes ready transactions off the queue in
+ * file order.
+ */
+struct xlog_prefetch {
+	/** The prefetch thread. */
+	struct cord cord;
+	/** Duplicated file descriptor owned by the thread. */
+	int fd;
+	/** File name, points at the consumer cursor name. */
+	const char *name;
+	/** Guards all the fields below. */
+	pthread_mutex_t mutex;
+	/** Signalled when a tx is added to the queue. */
+	pthread_cond_t consumer_cond;
+	/** Signalled when the consumer takes a tx off the queue. */
+	pthread_cond_t reader_cond;
+	/** Decoded transactions, in file order. */
+	struct stailq queue;
+	/** Number of transactions in the queue. */
+	int queue_len;
+	/** Set when the thread has no more transactions to hand over. */
+	bool is_eof;
+	/** Set by the consumer to stop the thread early. */
+	bool is_aborted;
+	/** Thread status: 1 on end of file, -1 on error. */
+	int status;
+	/** The error if @a status is -1. */
+	struct diag diag;
+	/** The file ended with a proper eof marker. */
+	bool has_eof_marker;
+};
+
+/**
+ * Hand a decoded tx over to the consumer, blocking if too many
+ * transactions are already in flight. Returns -1 if the consumer
+ * shut the prefetch down; the tx is freed in this case.
+ */
+static int
+xlog_prefetch_submit(struct xlog_prefetch *pf, struct xlog_prefetch_tx *tx)
+{
+	tt_pthread_mutex_lock(&pf->mutex);
+	while (pf->queue_len >= XLOG_PREFETCH_QUEUE_MAX && !pf->is_aborted)
+		tt_pthread_cond_wait(&pf->reader_cond, &pf->mutex);
+	if (pf->is_aborted) {
+		tt_pthread_mutex_unlock(&pf->mutex);
+		free(tx);
+		return -1;
+	}
+	stailq_add_tail_entry(&pf->queue, tx, next);
+	pf->queue_len++;
+	tt_pthread_cond_signal(&pf->consumer_cond);
+	tt_pthread_mutex_unlock(&pf->mutex);
+	return 0;
+}
+
+static int
+xlog_prefetch_reader_f(va_list ap)
+{
+	struct xlog_prefetch *pf = va_arg(ap, struct xlog_prefetch *);
+	int rc;
+	struct xlog_cursor cursor;
+	if (xlog_cursor_openfd(&cursor, pf->fd, pf->name) < 0) {
+		close(pf->fd);
+		rc = -1;
+		goto done;
+	}
+	while (true) {
+		off_t offset = xlog_cursor_pos(&cursor);
+		rc = xlog_cursor_next_tx(&cursor);
+		if (rc != 0)
+			break;
+		size_t size = ibuf_used(&cursor.tx_cursor.rows);
+		struct xlog_prefetch_tx *tx = malloc(sizeof(*tx) + size);
+		if (tx == NULL) {
+			diag_set(OutOfMemory, sizeof(*tx) + size,
+				 "malloc", "xlog prefetch tx");
+			rc = -1;
+			break;
+		}
+		tx->offset = offset;
+		tx->raw_size = xlog_cursor_pos(&cursor) - offset;
+		tx->size = size;
+		memcpy(tx->data, cursor.tx_cursor.rows.rpos, size);
+		/* The rows are copied out, drop the tx. */
+		cursor.state = XLOG_CURSOR_ACTIVE;
+		xlog_tx_cursor_destroy(&cursor.tx_cursor);
+		if (xlog_prefetch_submit(pf, tx) != 0) {
+			/* Shut down by the consumer - quit silently. */
+			rc = 1;
+			break;
+		}
+	}
+	pf->has_eof_marker = xlog_cursor_is_eof(&cursor);
+	xlog_cursor_close(&cursor, false);
+done:
+	if (rc < 0)
+		diag_move(diag_get(), &pf->diag);
+	tt_pthread_mutex_lock(&pf->mutex);
+	pf->status = rc < 0 ? -1 : 1;
+	pf->is_eof = true;
+	tt_pthread_cond_signal(&pf->consumer_cond);
+	tt_pthread_mutex_unlock(&pf->mutex);
+	return 0;
+}
+
+/**
+ * Stop the prefetch thread and free all associated state. The
+ * cursor continues to read serially from its current position.
+ */
+static void
+xlog_cursor_prefetch_stop(struct xlog_cursor *i)
+{
+	struct xlog_prefetch *pf = i->prefetch;
+	tt_pthread_mutex_lock(&pf->mutex);
+	pf->is_aborted = true;
+	tt_pthread_cond_signal(&pf->reader_cond);
+	tt_pthread_mutex_unlock(&pf->mutex);
+	cord_cojoin(&pf->cord);
+	struct xlog_prefetch_tx *tx, *next_tx;
+	stailq_foreach_entry_safe(tx, next_tx, &pf->queue, next)
+		free(tx);
+	diag_destroy(&pf->diag);
+	tt_pthread_cond_destroy(&pf->reader_cond);
+	tt_pthread_cond_destroy(&pf->consumer_cond);
+	tt_pthread_mutex_destroy(&pf->mutex);
+	free(pf);
+	i->prefetch = NULL;
+}
+
+/**
+ * Take the next decoded tx from the prefetch thread and set up
+ * the cursor tx from it.
+ *
+ * @retval  0 success
+ * @retval  1 end of file, the eof marker was seen
+ * @retval -1 error, check diag
+ * @retval  2 the thread stopped short of an eof marker, e.g. the
+ *            log is still being appended to; the prefetch is shut
+ *            down and the caller should continue serially
+ */
+static int
+xlog_cursor_prefetch_next_tx(struct xlog_cursor *i)
+{
+	struct xlog_prefetch *pf = i->prefetch;
+	struct xlog_prefetch_tx *tx = NULL;
+	tt_pthread_mutex_lock(&pf->mutex);
+	while (pf->queue_len == 0 && !pf->is_eof)
+		tt_pthread_cond_wait(&pf->consumer_cond, &pf->mutex);
+	if (pf->queue_len > 0) {
+		tx = stailq_shift_entry(&pf->queue,
+					struct xlog_prefetch_tx, next);
+		pf->queue_len--;
+		tt_pthread_cond_signal(&pf->reader_cond);
+	}
+	tt_pthread_mutex_unlock(&pf->mutex);
+	if (tx == NULL) {
+		/* The thread is done - collect its status. */
+		int status = pf->status;
+		bool has_eof_marker = pf->has_eof_marker;
+		if (status < 0)
+			diag_move(&pf->diag, diag_get());
+		xlog_cursor_prefetch_stop(i);
+		if (status < 0)
+			return -1;
+		if (has_eof_marker) {
+			i->state = XLOG_CURSOR_EOF;
+			return 1;
+		}
+		return 2;
+	}
+	ibuf_create(&i->tx_cursor.rows, &cord()->slabc,
+		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
+	void *dst = ibuf_alloc(&i->tx_cursor.rows, tx->size);
+	if (dst == NULL) {
+		diag_set(OutOfMemory, tx->size, "runtime",
+			 "xlog rows buffer");
+		ibuf_destroy(&i->tx_cursor.rows);
+		free(tx);
+		return -1;
+	}
+	memcpy(dst, tx->data, tx->size);
+	i->tx_cursor.size = tx->size;
+	/*
+	 * Skip the raw tx in the file without reading it: drop the
+	 * read buffer and continue from past the tx, so a fallback
+	 * to serial reading picks up at the right position.
+	 */
+	ibuf_reset(&i->rbuf);
+	i->read_offset = tx->offset + tx->raw_size;
+	free(tx);
+	i->state = XLOG_CURSOR_TX;
+	return 0;
+}
+
+void
+xlog_cursor_enable_prefetch(struct xlog_cursor *cursor)
+{
+	if (cursor->fd < 0 || cursor->prefetch != NULL)
+		return;
+	int fd = dup(cursor->fd);
+	if (fd < 0)
+		return;
+	struct xlog_prefetch *pf = malloc(sizeof(*pf));
+	if (pf == NULL) {
+		close(fd);
+		return;
+	}
+	pf->fd = fd;
+	pf->name = cursor->name;
+	stailq_create(&pf->queue);
+	pf->queue_len = 0;
+	pf->is_eof = false;
+	pf->is_aborted = false;
+	pf->status = 0;
+	pf->has_eof_marker = false;
+	diag_create(&pf->diag);
+	tt_pthread_mutex_init(&pf->mutex, NULL);
+	tt_pthread_cond_init(&pf->consumer_cond, NULL);
+	tt_pthread_cond_init(&pf->reader_cond, NULL);
+	if (cord_costart(&pf->cord, "xlog.prefetch",
+			 xlog_prefetch_reader_f, pf) != 0) {
+		diag_log();
+		say_warn("failed to start an xlog prefetch thread, "
+			 "falling back to serial reading");
+		diag_destroy(&pf->diag);
+		tt_pthread_cond_destroy(&pf->reader_cond);
+		tt_pthread_cond_destroy(&pf->consumer_cond);
+		tt_pthread_mutex_destroy(&pf->mutex);
+		close(fd);
+		free(pf);
+		return;
+	}
+	cursor->prefetch = pf;
+}
+
+/* }}} */
+
 /* {{{ struct xlog_cursor */
 
 #define XLOG_READ_AHEAD		(1 << 14)
@@ -1724,7 +2717,8 @@ xlog_tx_decode(const char *data, const char *data_end,
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx)
+		      ZSTD_DStream *zdctx, const char *zdict,
+		      uint32_t zdict_size, bool copy)
 {
 	const char *rpos = *data;
 	struct xlog_fixheader fixheader;
@@ -1751,6 +2745,23 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	ibuf_create(&tx_cursor->rows, &cord()->slabc,
 		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	if (fixheader.magic == row_marker) {
+		if (!copy) {
+			/*
+			 * The source buffer outlives the cursor
+			 * (e.g. it is an mmap of the whole file),
+			 * so reference the plain rows in place.
+			 * rows.buf stays NULL, which makes the
+			 * destroy a no-op.
+			 */
+			tx_cursor->rows.rpos = (char *) rpos;
+			tx_cursor->rows.wpos = (char *) rpos +
+				fixheader.len;
+			tx_cursor->rows.end = tx_cursor->rows.wpos;
+			*data = (char *) rpos + fixheader.len;
+			assert(*data <= data_end);
+			tx_cursor->size = ibuf_used(&tx_cursor->rows);
+			return 0;
+		}
 		void *dst = ibuf_alloc(&tx_cursor->rows, fixheader.len);
 		if (dst == NULL) {
 			diag_set(OutOfMemory, fixheader.len,
@@ -1766,7 +2777,8 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	};
 
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	/* A NULL dictionary makes this a plain init. */
+	ZSTD_initDStream_usingDict(zdctx, zdict, zdict_size);
 	int rc;
 	do {
 		if (ibuf_reserve(&tx_cursor->rows,
@@ -1849,7 +2861,34 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	int rc;
 	assert(xlog_cursor_is_open(i));
 
+	if (i->prefetch != NULL) {
+		rc = xlog_cursor_prefetch_next_tx(i);
+		if (rc <= 1)
+			return rc;
+		/* The prefetch is over, continue serially. */
+	}
+
 	/* load at least magic to check eof */
+	off_t tx_offset = xlog_cursor_pos(i);
+	if (i->tx_cache) {
+		size_t raw_size;
+		rc = xlog_tx_cache_find(i, tx_offset, &i->tx_cursor,
+					&raw_size);
+		if (rc < 0)
+			return -1;
+		if (rc == 0) {
+			/*
+			 * Skip the raw tx in the file without
+			 * reading it: drop the read buffer and
+			 * continue from past the tx.
+			 */
+			ibuf_reset(&i->rbuf);
+			i->read_offset = tx_offset + raw_size;
+			i->state = XLOG_CURSOR_TX;
+			return 0;
+		}
+	}
+
 	rc = xlog_cursor_ensure(i, sizeof(log_magic_t));
 	if (rc < 0)
 		return -1;
@@ -1863,7 +2902,10 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
 						(const char **)&i->rbuf.rpos,
-						i->rbuf.wpos, i->zdctx)) > 0) {
+						i->rbuf.wpos, i->zdctx,
+						i->meta.zdict,
+						i->meta.zdict_size,
+						i->fd >= 0)) > 0) {
 		/* not enough data in read buffer */
 		int rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
 		if (rc < 0)
@@ -1874,6 +2916,11 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	if (to_load < 0)
 		return -1;
 
+	if (i->tx_cache) {
+		xlog_tx_cache_add(i, tx_offset,
+				  xlog_cursor_pos(i) - tx_offset,
+				  &i->tx_cursor);
+	}
 	i->state = XLOG_CURSOR_TX;
 	return 0;
 eof_found:
@@ -1979,6 +3026,7 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 	return 0;
 error:
 	ibuf_destroy(&i->rbuf);
+	free(i->meta.zdict);
 	return -1;
 }
 
@@ -2006,14 +3054,16 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 	i->fd = -1;
 	ibuf_create(&i->rbuf, &cord()->slabc,
 		    XLOG_TX_AUTOCOMMIT_THRESHOLD << 1);
-
-	void *dst = ibuf_alloc(&i->rbuf, size);
-	if (dst == NULL) {
-		diag_set(OutOfMemory, size, "runtime",
-			  "xlog cursor read buffer");
-		goto error;
-	}
-	memcpy(dst, data, size);
+	/*
+	 * Reference the caller's memory instead of copying it -
+	 * it must stay alive while the cursor is open. rbuf.buf
+	 * stays NULL, so closing the cursor does not try to free
+	 * the caller's memory, and an in-memory cursor never
+	 * grows the buffer, see xlog_cursor_ensure().
+	 */
+	i->rbuf.rpos = (char *) data;
+	i->rbuf.wpos = (char *) data + size;
+	i->rbuf.end = i->rbuf.wpos;
 	i->read_offset = size;
 	int rc;
 	rc = xlog_meta_parse(&i->meta,
@@ -2036,6 +3086,7 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 	return 0;
 error:
 	ibuf_destroy(&i->rbuf);
+	free(i->meta.zdict);
 	return -1;
 }
 
@@ -2043,6 +3094,8 @@ void
 xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 {
 	assert(xlog_cursor_is_open(i));
+	if (i->prefetch != NULL)
+		xlog_cursor_prefetch_stop(i);
 	if (i->fd >= 0 && !reuse_fd)
 		close(i->fd);
 	assert(i->rbuf.slabc == &cord()->slabc);
@@ -2050,6 +3103,8 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 	if (i->state == XLOG_CURSOR_TX)
 		xlog_tx_cursor_destroy(&i->tx_cursor);
 	ZSTD_freeDStream(i->zdctx);
+	free(i->meta.zdict);
+	i->meta.zdict = NULL;
 	i->state = (i->state == XLOG_CURSOR_EOF ?
 		    XLOG_CURSOR_EOF_CLOSED : XLOG_CURSOR_CLOSED);
 	/*
@@ -49,6 +49,8 @@ struct xrow_header;
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+struct iouring;
+
 /**
  * This structure combines all xlog write options set on xlog
  * creation.
@@ -82,6 +84,29 @@ struct xlog_opts {
 	 * to be read frequently, e.g. L1 run files in Vinyl.
 	 */
 	bool no_compression;
+	/**
+	 * If this flag is set, writes are submitted through
+	 * io_uring rather than write(2), when the kernel
+	 * supports it.
+	 */
+	bool use_uring;
+	/**
+	 * If this flag is set, every write batch is followed by
+	 * fdatasync. Used together with use_uring instead of
+	 * opening the file with O_SYNC, so that the write and
+	 * the sync can be submitted as a pair of linked SQEs
+	 * with a single system call.
+	 */
+	bool sync_each_write;
+	/**
+	 * If this flag is set, the file is written with O_DIRECT,
+	 * bypassing the page cache: the data is staged in an
+	 * aligned buffer and flushed in block-sized units, which
+	 * roughly halves the device write volume on journaling
+	 * filesystems. Falls back to buffered writes when the
+	 * filesystem does not support O_DIRECT.
+	 */
+	bool direct_write;
 };
 
 extern const struct xlog_opts xlog_opts_default;
@@ -111,6 +136,14 @@ enum log_suffix { NONE, INPROGRESS };
  */
 #define inprogress_suffix ".inprogress"
 
+enum {
+	/**
+	 * Maximum number of transaction payload samples collected
+	 * in a directory for zstd dictionary training.
+	 */
+	XLOG_ZDICT_SAMPLES_MAX = 1024,
+};
+
 /**
  * A handle for a data directory with write ahead logs, snapshots,
  * vylogs.
@@ -128,6 +161,17 @@ struct xdir {
 	 * are skipped.
 	 */
 	bool force_recovery;
+	/**
+	 * Enable the shared transaction cache for cursors opened
+	 * through this directory, see
+	 * xlog_cursor_enable_tx_cache().
+	 */
+	bool tx_cache;
+	/**
+	 * Enable pipelined reading for cursors opened through
+	 * this directory, see xlog_cursor_enable_prefetch().
+	 */
+	bool prefetch;
 	/* Default filename suffix for a new file. */
 	enum log_suffix suffix;
 	/**
@@ -159,6 +203,34 @@ struct xdir {
 	 * empty, must be initialized with xdir_scan().
 	 */
 	vclockset_t index;
+	/**
+	 * Base checkpoint of the next created file. Only used
+	 * for SNAP dirs: when set, the new snapshot is written
+	 * as an incremental one and records the base checkpoint
+	 * vclock in its PrevVClock meta key. Cleared by default.
+	 */
+	struct vclock base_vclock;
+	/**
+	 * Sample buffer for zstd dictionary training: payloads
+	 * of recently written transaction blocks, concatenated
+	 * back to back. Only maintained for XLOG dirs. Allocated
+	 * on first use, NULL otherwise.
+	 */
+	char *zdict_samples;
+	/** Used bytes in zdict_samples. */
+	size_t zdict_samples_size;
+	/** Number of samples collected in zdict_samples. */
+	uint32_t zdict_sample_count;
+	/** Size of each collected sample, in bytes. */
+	size_t zdict_sample_sizes[XLOG_ZDICT_SAMPLES_MAX];
+	/**
+	 * The last trained zstd dictionary, attached to the meta
+	 * of every new file created in this directory. Malloc'ed,
+	 * NULL until enough samples have been collected.
+	 */
+	char *zdict;
+	/** Size of zdict, in bytes. */
+	uint32_t zdict_size;
 	/**
 	 * Directory path.
 	 */
@@ -311,6 +383,17 @@ struct xlog_meta {
 	 * directory for missing WALs.
 	 */
 	struct vclock prev_vclock;
+	/**
+	 * Text file header: zstd dictionary the compressed
+	 * transaction blocks of this file were produced with,
+	 * base64-encoded in the file. Trained on payloads of
+	 * transactions preceding the file, see
+	 * xdir_create_xlog(). Malloc'ed, NULL if the file
+	 * doesn't use a dictionary.
+	 */
+	char *zdict;
+	/** Size of zdict, in bytes. */
+	uint32_t zdict_size;
 };
 
 /**
@@ -383,6 +466,16 @@ struct xlog {
 	struct obuf obuf;
 	/** The context of zstd compression */
 	ZSTD_CCtx *zctx;
+	/**
+	 * Digested form of meta.zdict used by the compression
+	 * context, NULL if the file has no dictionary.
+	 */
+	ZSTD_CDict *zcdict;
+	/**
+	 * Directory collecting transaction payload samples for
+	 * zstd dictionary training, NULL if sampling is off.
+	 */
+	struct xdir *zdict_dir;
 	/**
 	 * Compressed output buffer
 	 */
@@ -393,6 +486,19 @@ struct xlog {
 	uint64_t synced_size;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * The io_uring writes go through, when opts.use_uring
+	 * is set and the kernel supports it, NULL otherwise.
+	 */
+	struct iouring *ring;
+	/**
+	 * Block-aligned staging buffer for O_DIRECT writes, when
+	 * opts.direct_write is set and the filesystem supports
+	 * it, NULL otherwise. The head of the buffer always
+	 * holds the partial last block of the file, which is
+	 * rewritten by the next flush.
+	 */
+	char *dbuf;
 };
 
 /**
@@ -501,6 +607,16 @@ xlog_fallocate(struct xlog *log, size_t size);
 ssize_t
 xlog_write_row(struct xlog *log, const struct xrow_header *packet);
 
+/**
+ * Write a batch of rows to xlog in one encode pass. Cheaper
+ * than a per-row loop for multi-statement transactions.
+ *
+ * @retval count of written bytes
+ * @retval -1 for error
+ */
+ssize_t
+xlog_write_rows(struct xlog *log, struct xrow_header **rows, int n_rows);
+
 /**
  * Prevent xlog row buffer offloading, should be use
  * at transaction start to write transaction in one xlog tx
@@ -524,6 +640,56 @@ xlog_tx_commit(struct xlog *log);
 void
 xlog_tx_rollback(struct xlog *log);
 
+/**
+ * Finish a multi-statement transaction by detaching the
+ * accumulated data instead of writing it: @a data receives the
+ * transaction contents (with the fixheader gap at the start) and
+ * the log returns to autocommit mode with an empty buffer. The
+ * caller is supposed to compress the data with
+ * xlog_tx_compress(), possibly in another thread, and write the
+ * result with xlog_write_compressed_tx().
+ *
+ * @retval the number of detached rows
+ */
+int
+xlog_tx_detach(struct xlog *log, struct obuf *data);
+
+/**
+ * An upper bound on the size of a compressed transaction block
+ * produced by xlog_tx_compress() from @a src.
+ */
+size_t
+xlog_tx_compress_bound(const struct obuf *src);
+
+/**
+ * Compress transaction data detached with xlog_tx_detach() into
+ * @a dst as a complete on-disk transaction block: a fixheader
+ * with the zrow marker followed by the zstd compressed payload.
+ * @a dst_size must be at least xlog_tx_compress_bound() bytes.
+ * If @a zcdict is not NULL, the data is compressed with this
+ * dictionary and can only be read back with the same one.
+ * The function does not touch any xlog state and is safe to call
+ * from another thread provided @a zctx is not shared.
+ *
+ * @retval the size of the compressed block
+ * @retval -1 if error
+ */
+ssize_t
+xlog_tx_compress(char *dst, size_t dst_size, ZSTD_CCtx *zctx,
+		 const ZSTD_CDict *zcdict, const struct obuf *src);
+
+/**
+ * Write a transaction block formed by xlog_tx_compress() to the
+ * log file. May be called while another transaction is being
+ * buffered - the buffer is left untouched.
+ *
+ * @retval count of written bytes
+ * @retval -1 if error
+ */
+ssize_t
+xlog_write_compressed_tx(struct xlog *log, const char *data, size_t size,
+			 int row_count);
+
 /**
  * Flush buffered rows and sync file
  */
@@ -574,6 +740,14 @@ struct xlog_tx_cursor
  * Create xlog tx iterator from memory data.
  * *data will be adjusted to end of tx
  *
+ * @a zdict is the zstd dictionary from the file meta the tx was
+ * read from, NULL if the file has none.
+ *
+ * If @a copy is false, plain (uncompressed) rows are referenced
+ * in the source buffer instead of being copied out, so the
+ * buffer must outlive the cursor. Pass true unless the source
+ * is stable memory, e.g. an mmap of the whole file.
+ *
  * @retval 0 for Ok
  * @retval -1 for error
  * @retval >0 how many additional bytes should be read to parse tx
@@ -581,7 +755,8 @@ struct xlog_tx_cursor
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx);
+		      ZSTD_DStream *zdctx, const char *zdict,
+		      uint32_t zdict_size, bool copy);
 
 /**
  * Destroy xlog tx cursor and free all associated memory
@@ -631,6 +806,8 @@ xlog_tx_decode(const char *data, const char *data_end,
 
 /* {{{ xlog_cursor - read rows from a log file */
 
+struct xlog_prefetch;
+
 enum xlog_cursor_state {
 	/* The cursor was never opened. */
 	XLOG_CURSOR_NEW = 0,
@@ -666,8 +843,48 @@ struct xlog_cursor
 	struct xlog_tx_cursor tx_cursor;
 	/** ZSTD context for decompression */
 	ZSTD_DStream *zdctx;
+	/** Use the shared tx cache, see xlog_cursor_enable_tx_cache(). */
+	bool tx_cache;
+	/**
+	 * Prefetch thread state, NULL unless enabled with
+	 * xlog_cursor_enable_prefetch().
+	 */
+	struct xlog_prefetch *prefetch;
+	/** Device id of the file, for the shared tx cache key. */
+	uint64_t cache_dev;
+	/** Inode of the file, for the shared tx cache key. */
+	uint64_t cache_ino;
+	/** Signature of the file, for the shared tx cache key. */
+	int64_t cache_signature;
 };
 
+/**
+ * Enable the shared cache of decoded transactions for the cursor.
+ *
+ * When several cursors stream the same log, e.g. relays sending
+ * the same WAL tail to replicas that resubscribed after a restart,
+ * all but the first one find the transactions in the cache instead
+ * of re-reading and re-decompressing them from the file. No-op for
+ * in-memory cursors.
+ */
+void
+xlog_cursor_enable_tx_cache(struct xlog_cursor *cursor);
+
+/**
+ * Enable pipelined reading for the cursor.
+ *
+ * A dedicated thread reads the file ahead, verifies tx checksums
+ * and decompresses tx blocks, while the consumer takes ready
+ * decoded transactions off a bounded queue in file order. If the
+ * thread reaches the end of the file without finding an eof
+ * marker, e.g. the log is still being appended to, it is shut
+ * down and the cursor transparently switches back to serial
+ * reading, so following a growing log keeps working. No-op for
+ * in-memory cursors and on thread start failure.
+ */
+void
+xlog_cursor_enable_prefetch(struct xlog_cursor *cursor);
+
 /**
  * Return true if the cursor was opened and has not
  * been closed yet.
@@ -713,7 +930,10 @@ int
 xlog_cursor_open(struct xlog_cursor *cursor, const char *name);
 
 /**
- * Open cursor from memory
+ * Open cursor from memory. The memory block is referenced, not
+ * copied, and must stay alive until the cursor is closed. Rows
+ * of uncompressed transactions point into the block as well, so
+ * an mmap of a log file can be read without copying cold pages.
  * @param cursor cursor
  * @param data pointer to memory block
  * @param size memory block size
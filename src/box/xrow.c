@@ -36,6 +36,7 @@
 #include "third_party/base64.h"
 
 #include "fiber.h"
+#include "mp_fast_check.h"
 #include "version.h"
 #include "tt_static.h"
 #include "error.h"
@@ -68,7 +69,7 @@ mp_encode_vclock(char *data, const struct vclock *vclock)
 	return data;
 }
 
-static int
+int
 mp_decode_vclock(const char **data, struct vclock *vclock)
 {
 	vclock_create(vclock);
@@ -195,7 +196,7 @@ error:
 	/* Nop requests aren't supposed to have a body. */
 	if (*pos < end && header->type != IPROTO_NOP) {
 		const char *body = *pos;
-		if (mp_check(pos, end)) {
+		if (mp_fast_check(pos, end)) {
 			xrow_on_decode_err(start, end, ER_INVALID_MSGPACK, "packet body");
 			return -1;
 		}
@@ -225,20 +226,10 @@ xrow_decode_uuid(const char **pos, struct tt_uuid *out)
 	return 0;
 }
 
-int
-xrow_header_encode(const struct xrow_header *header, uint64_t sync,
-		   struct iovec *out, size_t fixheader_len)
+size_t
+xrow_header_encode_buf(const struct xrow_header *header, uint64_t sync,
+		       char *data)
 {
-	/* allocate memory for sign + header */
-	out->iov_base = region_alloc(&fiber()->gc, XROW_HEADER_LEN_MAX +
-				     fixheader_len);
-	if (out->iov_base == NULL) {
-		diag_set(OutOfMemory, XROW_HEADER_LEN_MAX + fixheader_len,
-			 "gc arena", "xrow header encode");
-		return -1;
-	}
-	char *data = (char *) out->iov_base + fixheader_len;
-
 	/* Header */
 	char *d = data + 1; /* Skip 1 byte for MP_MAP */
 	int map_size = 0;
@@ -313,7 +304,24 @@ xrow_header_encode(const struct xrow_header *header, uint64_t sync,
 	}
 	assert(d <= data + XROW_HEADER_LEN_MAX);
 	mp_encode_map(data, map_size);
-	out->iov_len = d - (char *) out->iov_base;
+	return d - data;
+}
+
+int
+xrow_header_encode(const struct xrow_header *header, uint64_t sync,
+		   struct iovec *out, size_t fixheader_len)
+{
+	/* allocate memory for sign + header */
+	out->iov_base = region_alloc(&fiber()->gc, XROW_HEADER_LEN_MAX +
+				     fixheader_len);
+	if (out->iov_base == NULL) {
+		diag_set(OutOfMemory, XROW_HEADER_LEN_MAX + fixheader_len,
+			 "gc arena", "xrow header encode");
+		return -1;
+	}
+	char *data = (char *) out->iov_base + fixheader_len;
+	out->iov_len = fixheader_len +
+		xrow_header_encode_buf(header, sync, data);
 	out++;
 
 	memcpy(out, header->body, sizeof(*out) * header->bodycnt);
@@ -436,6 +444,36 @@ iproto_reply_vclock(struct obuf *out, const struct vclock *vclock,
 	return 0;
 }
 
+int
+iproto_reply_auth(struct obuf *out, const char *ticket, uint32_t ticket_size,
+		  uint64_t sync, uint32_t schema_version)
+{
+	size_t max_size = IPROTO_HEADER_LEN + mp_sizeof_map(1) +
+		mp_sizeof_uint(UINT32_MAX) + mp_sizeof_bin(ticket_size);
+
+	char *buf = obuf_reserve(out, max_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, max_size,
+			 "obuf_alloc", "buf");
+		return -1;
+	}
+
+	char *data = buf + IPROTO_HEADER_LEN;
+	data = mp_encode_map(data, 1);
+	data = mp_encode_uint(data, IPROTO_AUTH_TICKET);
+	data = mp_encode_bin(data, ticket, ticket_size);
+	size_t size = data - buf;
+	assert(size <= max_size);
+
+	iproto_header_encode(buf, IPROTO_OK, sync, schema_version,
+			     size - IPROTO_HEADER_LEN);
+
+	char *ptr = obuf_alloc(out, size);
+	(void) ptr;
+	assert(ptr == buf);
+	return 0;
+}
+
 int
 iproto_reply_vote(struct obuf *out, const struct ballot *ballot,
 		  uint64_t sync, uint32_t schema_version)
@@ -478,6 +516,43 @@ iproto_reply_vote(struct obuf *out, const struct ballot *ballot,
 	return 0;
 }
 
+int
+iproto_reply_event(struct obuf *out, uint64_t sync, uint32_t schema_version,
+		   uint32_t space_id, const char *key, const char *key_end)
+{
+	size_t key_size = key != NULL ? key_end - key : 0;
+	size_t max_size = IPROTO_HEADER_LEN + mp_sizeof_map(2) +
+		mp_sizeof_uint(UINT32_MAX) + mp_sizeof_uint(space_id) +
+		mp_sizeof_uint(UINT32_MAX) + key_size;
+
+	char *buf = obuf_reserve(out, max_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, max_size,
+			 "obuf_alloc", "buf");
+		return -1;
+	}
+
+	char *data = buf + IPROTO_HEADER_LEN;
+	data = mp_encode_map(data, key != NULL ? 2 : 1);
+	data = mp_encode_uint(data, IPROTO_SPACE_ID);
+	data = mp_encode_uint(data, space_id);
+	if (key != NULL) {
+		data = mp_encode_uint(data, IPROTO_KEY);
+		memcpy(data, key, key_size);
+		data += key_size;
+	}
+	size_t size = data - buf;
+	assert(size <= max_size);
+
+	iproto_header_encode(buf, IPROTO_EVENT, sync, schema_version,
+			     size - IPROTO_HEADER_LEN);
+
+	char *ptr = obuf_alloc(out, size);
+	(void) ptr;
+	assert(ptr == buf);
+	return 0;
+}
+
 int
 iproto_reply_error(struct obuf *out, const struct error *e, uint64_t sync,
 		   uint32_t schema_version)
@@ -539,19 +614,54 @@ iproto_prepare_header(struct obuf *buf, struct obuf_svp *svp, size_t size)
 	return 0;
 }
 
+void
+iproto_reply_select_spliced(struct obuf *buf, struct obuf_svp *svp,
+			    uint64_t sync, uint32_t schema_version,
+			    uint32_t count, size_t spliced_len)
+{
+	char *pos = (char *) obuf_svp_to_ptr(buf, svp);
+	iproto_header_encode(pos, IPROTO_OK, sync, schema_version,
+			        obuf_size(buf) - svp->used -
+				IPROTO_HEADER_LEN + spliced_len);
+
+	struct iproto_body_bin body = iproto_body_bin;
+	body.v_data_len = mp_bswap_u32(count);
+
+	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
+}
+
 void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count)
 {
+	iproto_reply_select_spliced(buf, svp, sync, schema_version, count, 0);
+}
+
+int
+iproto_reply_select_with_vclock(struct obuf *buf, struct obuf_svp *svp,
+				uint64_t sync, uint32_t schema_version,
+				uint32_t count, const struct vclock *vclock)
+{
+	size_t size = mp_sizeof_uint(IPROTO_VCLOCK) + mp_sizeof_vclock(vclock);
+	char *data = (char *) obuf_alloc(buf, size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "obuf_alloc", "data");
+		return -1;
+	}
+	data = mp_encode_uint(data, IPROTO_VCLOCK);
+	data = mp_encode_vclock(data, vclock);
+
 	char *pos = (char *) obuf_svp_to_ptr(buf, svp);
 	iproto_header_encode(pos, IPROTO_OK, sync, schema_version,
-			        obuf_size(buf) - svp->used -
-				IPROTO_HEADER_LEN);
+			     obuf_size(buf) - svp->used - IPROTO_HEADER_LEN);
 
 	struct iproto_body_bin body = iproto_body_bin;
+	/* A two key map: IPROTO_DATA and IPROTO_VCLOCK. */
+	body.m_body = 0x82;
 	body.v_data_len = mp_bswap_u32(count);
 
 	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
+	return 0;
 }
 
 int
@@ -577,10 +687,12 @@ error:
 	request->sql_text = NULL;
 	request->bind = NULL;
 	request->stmt_id = NULL;
+	request->metadata_version = NULL;
 	for (uint32_t i = 0; i < map_size; ++i) {
 		uint8_t key = *data;
 		if (key != IPROTO_SQL_BIND && key != IPROTO_SQL_TEXT &&
-		    key != IPROTO_STMT_ID) {
+		    key != IPROTO_STMT_ID &&
+		    key != IPROTO_METADATA_VERSION) {
 			mp_check(&data, end);   /* skip the key */
 			mp_check(&data, end);   /* skip the value */
 			continue;
@@ -592,6 +704,8 @@ error:
 			request->bind = value;
 		else if (key == IPROTO_SQL_TEXT)
 			request->sql_text = value;
+		else if (key == IPROTO_METADATA_VERSION)
+			request->metadata_version = value;
 		else
 			request->stmt_id = value;
 	}
@@ -695,6 +809,9 @@ error:
 		case IPROTO_ITERATOR:
 			request->iterator = mp_decode_uint(&value);
 			break;
+		case IPROTO_TIMEOUT:
+			request->timeout = mp_decode_double(&value);
+			break;
 		case IPROTO_TUPLE:
 			request->tuple = value;
 			request->tuple_end = data;
@@ -711,6 +828,10 @@ error:
 			request->tuple_meta = value;
 			request->tuple_meta_end = data;
 			break;
+		case IPROTO_VCLOCK:
+			request->vclock = value;
+			request->vclock_end = data;
+			break;
 		default:
 			break;
 		}
@@ -1004,6 +1125,124 @@ error:
 	return 0;
 }
 
+int
+xrow_decode_watch(const struct xrow_header *row, struct watch_request *request)
+{
+	if (row->bodycnt == 0) {
+		diag_set(ClientError, ER_INVALID_MSGPACK,
+			 "missing request body");
+		return -1;
+	}
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet body");
+		return -1;
+	}
+
+	memset(request, 0, sizeof(*request));
+	bool has_space_id = false;
+
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+
+		switch (key) {
+		case IPROTO_SPACE_ID:
+			if (mp_typeof(*value) != MP_UINT)
+				goto error;
+			request->space_id = mp_decode_uint(&value);
+			has_space_id = true;
+			break;
+		case IPROTO_INDEX_ID:
+			if (mp_typeof(*value) != MP_UINT)
+				goto error;
+			request->index_id = mp_decode_uint(&value);
+			break;
+		case IPROTO_KEY:
+			if (mp_typeof(*value) != MP_ARRAY)
+				goto error;
+			request->key = value;
+			request->key_end = data;
+			break;
+		default:
+			continue; /* unknown key */
+		}
+	}
+	if (data != end) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet end");
+		return -1;
+	}
+	if (!has_space_id) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_MISSING_REQUEST_FIELD,
+				   iproto_key_name(IPROTO_SPACE_ID));
+		return -1;
+	}
+	return 0;
+}
+
+int
+xrow_decode_compression(const struct xrow_header *row, const char **algo,
+			uint32_t *algo_len)
+{
+	*algo = NULL;
+	*algo_len = 0;
+	if (row->bodycnt == 0)
+		return 0;
+
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	assert((end - data) > 0);
+
+	if (mp_typeof(*data) != MP_MAP || mp_check_map(data, end) > 0) {
+error:
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet body");
+		return -1;
+	}
+
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; ++i) {
+		if ((end - data) < 1 || mp_typeof(*data) != MP_UINT)
+			goto error;
+
+		uint64_t key = mp_decode_uint(&data);
+		const char *value = data;
+		if (mp_check(&data, end) != 0)
+			goto error;
+
+		switch (key) {
+		case IPROTO_COMPRESSION_ALGO:
+			if (mp_typeof(*value) != MP_STR)
+				goto error;
+			*algo = mp_decode_str(&value, algo_len);
+			break;
+		default:
+			continue; /* unknown key */
+		}
+	}
+	if (data != end) {
+		xrow_on_decode_err(row->body[0].iov_base, end, ER_INVALID_MSGPACK,
+				   "packet end");
+		return -1;
+	}
+	return 0;
+}
+
 int
 xrow_encode_auth(struct xrow_header *packet, const char *salt, size_t salt_len,
 		 const char *login, size_t login_len,
@@ -1195,7 +1434,7 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter)
+		      uint32_t id_filter, bool compress)
 {
 	memset(row, 0, sizeof(*row));
 	size_t size = XROW_BODY_LEN_MAX + mp_sizeof_vclock(vclock);
@@ -1206,7 +1445,12 @@ xrow_encode_subscribe(struct xrow_header *row,
 	}
 	char *data = buf;
 	int filter_size = bit_count_u32(id_filter);
-	data = mp_encode_map(data, filter_size != 0 ? 6 : 5);
+	uint32_t map_size = 5 + (filter_size != 0) + (compress ? 1 : 0);
+	data = mp_encode_map(data, map_size);
+	if (compress) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION_ALGO);
+		data = mp_encode_str(data, "zstd", 4);
+	}
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
@@ -1343,21 +1587,77 @@ id_filter_decode_err:		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
 }
 
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
+xrow_decode_compression(struct xrow_header *row, bool *zstd)
+{
+	*zstd = false;
+	if (row->bodycnt == 0)
+		return 0;
+	const char * const data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP) {
+		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+				   "request body");
+		return -1;
+	}
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&d);
+		if (key != IPROTO_COMPRESSION_ALGO) {
+			mp_next(&d); /* value */
+			continue;
+		}
+		if (mp_typeof(*d) != MP_STR) {
+			xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+					   "invalid COMPRESSION_ALGO");
+			return -1;
+		}
+		uint32_t len;
+		const char *algo = mp_decode_str(&d, &len);
+		*zstd = len == 4 && memcmp(algo, "zstd", 4) == 0;
+	}
+	return 0;
+}
+
+int
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 const struct vclock *snap_vclock, uint64_t snap_offset)
 {
 	memset(row, 0, sizeof(*row));
 
 	size_t size = 64;
+	if (snap_vclock != NULL)
+		size += mp_sizeof_vclock(snap_vclock);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	data = mp_encode_map(data, snap_vclock != NULL ? 4 : 2);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
 	/* Greet the remote replica with our replica UUID */
 	data = xrow_encode_uuid(data, instance_uuid);
+	/*
+	 * Announce that we can take a raw snapshot file instead
+	 * of the row-by-row initial stream. An old master simply
+	 * skips the unknown key.
+	 */
+	data = mp_encode_uint(data, IPROTO_SNAP_FILE);
+	data = mp_encode_bool(data, true);
+	if (snap_vclock != NULL) {
+		/* Resume an interrupted snapshot file download. */
+		data = mp_encode_uint(data, IPROTO_VCLOCK);
+		data = mp_encode_vclock(data, snap_vclock);
+		data = mp_encode_uint(data, IPROTO_OFFSET);
+		data = mp_encode_uint(data, snap_offset);
+	}
 	assert(data <= buf + size);
 
 	row->body[0].iov_base = buf;
@@ -1367,6 +1667,108 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 	return 0;
 }
 
+int
+xrow_encode_join_snap_response(struct xrow_header *row,
+			       const struct vclock *vclock,
+			       uint64_t snap_size, uint64_t snap_offset)
+{
+	memset(row, 0, sizeof(*row));
+
+	size_t size = 32 + mp_sizeof_vclock(vclock);
+	char *buf = (char *) region_alloc(&fiber()->gc, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "buf");
+		return -1;
+	}
+	char *data = buf;
+	data = mp_encode_map(data, 3);
+	data = mp_encode_uint(data, IPROTO_VCLOCK);
+	data = mp_encode_vclock(data, vclock);
+	data = mp_encode_uint(data, IPROTO_SNAP_FILE);
+	data = mp_encode_uint(data, snap_size);
+	data = mp_encode_uint(data, IPROTO_OFFSET);
+	data = mp_encode_uint(data, snap_offset);
+	assert(data <= buf + size);
+
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = (data - buf);
+	row->bodycnt = 1;
+	row->type = IPROTO_OK;
+	return 0;
+}
+
+int
+xrow_decode_join_snap(struct xrow_header *row, bool *has_snap,
+		      uint64_t *snap_size, uint64_t *snap_offset,
+		      struct vclock *vclock)
+{
+	*has_snap = false;
+	*snap_size = 0;
+	*snap_offset = 0;
+	if (row->bodycnt == 0)
+		return 0;
+	assert(row->bodycnt == 1);
+	const char * const data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP) {
+		xrow_on_decode_err(data, end, ER_INVALID_MSGPACK,
+				   "request body");
+		return -1;
+	}
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint8_t key = mp_decode_uint(&d);
+		switch (key) {
+		case IPROTO_SNAP_FILE:
+			/*
+			 * A boolean in a request (capability
+			 * flag), a byte count in a response.
+			 */
+			if (mp_typeof(*d) == MP_BOOL) {
+				*has_snap = mp_decode_bool(&d);
+			} else if (mp_typeof(*d) == MP_UINT) {
+				*has_snap = true;
+				*snap_size = mp_decode_uint(&d);
+			} else {
+				xrow_on_decode_err(data, end,
+						   ER_INVALID_MSGPACK,
+						   "invalid SNAP_FILE");
+				return -1;
+			}
+			break;
+		case IPROTO_OFFSET:
+			if (mp_typeof(*d) != MP_UINT) {
+				xrow_on_decode_err(data, end,
+						   ER_INVALID_MSGPACK,
+						   "invalid OFFSET");
+				return -1;
+			}
+			*snap_offset = mp_decode_uint(&d);
+			break;
+		case IPROTO_VCLOCK:
+			if (vclock == NULL)
+				goto skip;
+			if (mp_decode_vclock(&d, vclock) != 0) {
+				xrow_on_decode_err(data, end,
+						   ER_INVALID_MSGPACK,
+						   "invalid VCLOCK");
+				return -1;
+			}
+			break;
+		default: skip:
+			mp_next(&d); /* value */
+		}
+	}
+	return 0;
+}
+
 int
 xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 {
@@ -1394,24 +1796,30 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			       const struct tt_uuid *replicaset_uuid,
-			       const struct vclock *vclock)
+			       const struct vclock *vclock, bool compress)
 {
 	memset(row, 0, sizeof(*row));
-	size_t size = mp_sizeof_map(2) +
+	size_t size = mp_sizeof_map(3) +
 		      mp_sizeof_uint(IPROTO_VCLOCK) + mp_sizeof_vclock(vclock) +
 		      mp_sizeof_uint(IPROTO_CLUSTER_UUID) +
-		      mp_sizeof_str(UUID_STR_LEN);
+		      mp_sizeof_str(UUID_STR_LEN) +
+		      mp_sizeof_uint(IPROTO_COMPRESSION_ALGO) +
+		      mp_sizeof_str(4);
 	char *buf = (char *) region_alloc(&fiber()->gc, size);
 	if (buf == NULL) {
 		diag_set(OutOfMemory, size, "region_alloc", "buf");
 		return -1;
 	}
 	char *data = buf;
-	data = mp_encode_map(data, 2);
+	data = mp_encode_map(data, compress ? 3 : 2);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_vclock(data, vclock);
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
+	if (compress) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION_ALGO);
+		data = mp_encode_str(data, "zstd", 4);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -107,6 +107,20 @@ xrow_approx_len(struct xrow_header *row)
 	return len;
 }
 
+/**
+ * Encode xrow header into a caller-provided buffer. Unlike
+ * xrow_header_encode(), doesn't allocate anything and can't fail.
+ *
+ * @param header xrow
+ * @param sync sync to encode, 0 to omit
+ * @param data buffer of at least XROW_HEADER_LEN_MAX bytes
+ *
+ * @return the number of bytes written
+ */
+size_t
+xrow_header_encode_buf(const struct xrow_header *header, uint64_t sync,
+		       char *data);
+
 /**
  * Encode xrow into a binary packet
  *
@@ -172,6 +186,20 @@ struct request {
 	/** Tuple metadata. */
 	const char *tuple_meta;
 	const char *tuple_meta_end;
+	/**
+	 * Causal read token: a vclock the client saw in a
+	 * previous response. The request is parked until this
+	 * instance reaches it, so read-your-writes holds even
+	 * when reads go to a replica. NULL when not attached.
+	 */
+	const char *vclock;
+	const char *vclock_end;
+	/**
+	 * Relative timeout of the request in seconds, 0 when the
+	 * client did not set one. An expired request is aborted
+	 * with ER_TIMEOUT at the next cooperative deadline check.
+	 */
+	double timeout;
 	/** Base field offset for UPDATE/UPSERT, e.g. 0 for C and 1 for Lua. */
 	int index_base;
 };
@@ -253,6 +281,44 @@ struct auth_request {
 int
 xrow_decode_auth(const struct xrow_header *row, struct auth_request *request);
 
+/**
+ * WATCH/UNWATCH request.
+ */
+struct watch_request {
+	/** Identifier of the watched space. */
+	uint32_t space_id;
+	/** Identifier of the index the key applies to. */
+	uint32_t index_id;
+	/** Watched key prefix, MessagePack Array, or NULL. */
+	const char *key;
+	const char *key_end;
+};
+
+/**
+ * Decode WATCH/UNWATCH request from MessagePack.
+ * @param row Request header.
+ * @param[out] request Request to decode.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_watch(const struct xrow_header *row, struct watch_request *request);
+
+/**
+ * Decode a COMPRESSION request, which negotiates transparent
+ * compression of responses on a connection.
+ * @param row Request header.
+ * @param[out] algo Requested algorithm name, not zero-terminated,
+ *             of @a algo_len bytes. Set to NULL when the body is
+ *             empty, which stands for the default algorithm.
+ * @param[out] algo_len Length of @a algo.
+ * @retval  0 on success
+ * @retval -1 on error
+ */
+int
+xrow_decode_compression(const struct xrow_header *row, const char **algo,
+			uint32_t *algo_len);
+
 /**
  * Encode AUTH command.
  * @param[out] Row.
@@ -324,6 +390,8 @@ xrow_encode_register(struct xrow_header *row,
  * @param anon Whether it is an anonymous subscribe request or not.
  * @param id_filter A List of replica ids to skip rows from
  *		    when feeding a replica.
+ * @param compress Advertise that the replica can read a
+ *        zstd-compressed replication stream.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
@@ -333,7 +401,21 @@ xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
 		      const struct vclock *vclock, bool anon,
-		      uint32_t id_filter);
+		      uint32_t id_filter, bool compress);
+
+/**
+ * Decode the optional compression negotiation key of a SUBSCRIBE
+ * request or response. Its absence means the peer does not speak
+ * stream compression.
+ * @param row Row to decode.
+ * @param[out] zstd Set iff IPROTO_COMPRESSION_ALGO was present
+ *             with the value "zstd".
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error.
+ */
+int
+xrow_decode_compression(struct xrow_header *row, bool *zstd);
 
 /**
  * Decode SUBSCRIBE command.
@@ -359,12 +441,53 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
  * Encode JOIN command.
  * @param[out] row Row to encode into.
  * @param instance_uuid.
+ * @param snap_vclock Checkpoint vclock of a partially downloaded
+ *        snapshot file to resume, or NULL to start from scratch.
+ * @param snap_offset Number of snapshot file bytes the replica
+ *        already has. Ignored when @a snap_vclock is NULL.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
  */
 int
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid);
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 const struct vclock *snap_vclock, uint64_t snap_offset);
+
+/**
+ * Encode a JOIN response announcing a raw snapshot file: the
+ * master will send @a snap_size bytes of the checkpoint file
+ * right after this packet, starting at @a snap_offset.
+ * @param[out] row Row to encode into.
+ * @param vclock Checkpoint vclock.
+ * @param snap_size Number of file bytes that follow.
+ * @param snap_offset Offset the transfer starts at.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+xrow_encode_join_snap_response(struct xrow_header *row,
+			       const struct vclock *vclock,
+			       uint64_t snap_size, uint64_t snap_offset);
+
+/**
+ * Decode the snapshot file transfer keys of a JOIN request or
+ * response. The keys are optional: their absence means the peer
+ * does not speak the file transfer protocol.
+ * @param row Row to decode.
+ * @param[out] has_snap Whether IPROTO_SNAP_FILE was present.
+ * @param[out] snap_size Value of IPROTO_SNAP_FILE, 0 for a
+ *             boolean capability flag.
+ * @param[out] snap_offset Transfer offset, 0 if absent.
+ * @param[out] vclock Resume checkpoint vclock, may be NULL.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or format error.
+ */
+int
+xrow_decode_join_snap(struct xrow_header *row, bool *has_snap,
+		      uint64_t *snap_size, uint64_t *snap_offset,
+		      struct vclock *vclock);
 
 /**
  * Decode JOIN command.
@@ -422,11 +545,25 @@ xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
 	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL, NULL, NULL);
 }
 
+/**
+ * Decode a vclock from raw MessagePack data.
+ * @param[in][out] data MessagePack buffer, advanced past the
+ *        decoded vclock map.
+ * @param[out] vclock.
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error.
+ */
+int
+mp_decode_vclock(const char **data, struct vclock *vclock);
+
 /**
  * Encode a response to subscribe request.
  * @param row[out] Row to encode into.
  * @param replicaset_uuid.
  * @param vclock.
+ * @param compress Confirm that the following replication stream
+ *        is zstd-compressed.
  *
  * @retval 0 Success.
  * @retval -1 Memory error.
@@ -434,7 +571,7 @@ xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
 int
 xrow_encode_subscribe_response(struct xrow_header *row,
 			      const struct tt_uuid *replicaset_uuid,
-			      const struct vclock *vclock);
+			      const struct vclock *vclock, bool compress);
 
 /**
  * Decode a response to subscribe request.
@@ -517,6 +654,31 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count);
 
+/**
+ * Same as iproto_reply_select(), but the response body is known
+ * to continue for @a spliced_len more bytes which are stored
+ * outside the output buffer and spliced into the socket output
+ * by the sender.
+ */
+void
+iproto_reply_select_spliced(struct obuf *buf, struct obuf_svp *svp,
+			    uint64_t sync, uint32_t schema_version,
+			    uint32_t count, size_t spliced_len);
+
+/**
+ * Same as iproto_reply_select(), but additionally appends
+ * @a vclock to the response body as an IPROTO_VCLOCK key. Is used
+ * to return the commit vclock to clients doing causal reads, see
+ * struct request::vclock.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_select_with_vclock(struct obuf *buf, struct obuf_svp *svp,
+				uint64_t sync, uint32_t schema_version,
+				uint32_t count, const struct vclock *vclock);
+
 /**
  * Encode iproto header with IPROTO_OK response code.
  * @param out Encode to.
@@ -544,6 +706,22 @@ int
 iproto_reply_vclock(struct obuf *out, const struct vclock *vclock,
 		    uint64_t sync, uint32_t schema_version);
 
+/**
+ * Encode a reply to a successful IPROTO_AUTH request carrying
+ * a session resumption ticket.
+ * @param out Encode to.
+ * @param ticket Ticket issued by authenticate_ticket_issue().
+ * @param ticket_size Byte size of @a ticket.
+ * @param sync Request sync.
+ * @param schema_version.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_auth(struct obuf *out, const char *ticket, uint32_t ticket_size,
+		  uint64_t sync, uint32_t schema_version);
+
 /**
  * Encode a reply to an IPROTO_VOTE request.
  * @param out Buffer to write to.
@@ -558,6 +736,23 @@ int
 iproto_reply_vote(struct obuf *out, const struct ballot *ballot,
 		  uint64_t sync, uint32_t schema_version);
 
+/**
+ * Encode an IPROTO_EVENT watcher notification.
+ * @param out Buffer to write to.
+ * @param sync Sync of the WATCH request being notified.
+ * @param schema_version Actual schema version.
+ * @param space_id Identifier of the changed space.
+ * @param key Primary key of the changed tuple, MessagePack
+ *        Array, or NULL when notifications were coalesced.
+ * @param key_end End of @a key.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_event(struct obuf *out, uint64_t sync, uint32_t schema_version,
+		   uint32_t space_id, const char *key, const char *key_end);
+
 /**
  * Write an error packet int output buffer. Doesn't throw if out
  * of memory
@@ -574,6 +769,11 @@ struct sql_request {
 	const char *bind;
 	/** ID of prepared statement. In this case @sql_text == NULL. */
 	const char *stmt_id;
+	/**
+	 * Version of the statement metadata cached by the
+	 * client. NULL if the client does not cache metadata.
+	 */
+	const char *metadata_version;
 };
 
 /**
@@ -827,10 +1027,10 @@ xrow_encode_subscribe_xc(struct xrow_header *row,
 			 const struct tt_uuid *replicaset_uuid,
 			 const struct tt_uuid *instance_uuid,
 			 const struct vclock *vclock, bool anon,
-			 uint32_t id_filter)
+			 uint32_t id_filter, bool compress)
 {
 	if (xrow_encode_subscribe(row, replicaset_uuid, instance_uuid,
-				  vclock, anon, id_filter) != 0)
+				  vclock, anon, id_filter, compress) != 0)
 		diag_raise();
 }
 
@@ -851,9 +1051,22 @@ xrow_decode_subscribe_xc(struct xrow_header *row,
 /** @copydoc xrow_encode_join. */
 static inline void
 xrow_encode_join_xc(struct xrow_header *row,
-		    const struct tt_uuid *instance_uuid)
+		    const struct tt_uuid *instance_uuid,
+		    const struct vclock *snap_vclock, uint64_t snap_offset)
 {
-	if (xrow_encode_join(row, instance_uuid) != 0)
+	if (xrow_encode_join(row, instance_uuid, snap_vclock,
+			     snap_offset) != 0)
+		diag_raise();
+}
+
+/** @copydoc xrow_encode_join_snap_response. */
+static inline void
+xrow_encode_join_snap_response_xc(struct xrow_header *row,
+				  const struct vclock *vclock,
+				  uint64_t snap_size, uint64_t snap_offset)
+{
+	if (xrow_encode_join_snap_response(row, vclock, snap_size,
+					   snap_offset) != 0)
 		diag_raise();
 }
 
@@ -865,6 +1078,17 @@ xrow_decode_join_xc(struct xrow_header *row, struct tt_uuid *instance_uuid)
 		diag_raise();
 }
 
+/** @copydoc xrow_decode_join_snap. */
+static inline void
+xrow_decode_join_snap_xc(struct xrow_header *row, bool *has_snap,
+			 uint64_t *snap_size, uint64_t *snap_offset,
+			 struct vclock *vclock)
+{
+	if (xrow_decode_join_snap(row, has_snap, snap_size, snap_offset,
+				  vclock) != 0)
+		diag_raise();
+}
+
 /** @copydoc xrow_decode_register. */
 static inline void
 xrow_decode_register_xc(struct xrow_header *row, struct tt_uuid *instance_uuid,
@@ -894,9 +1118,10 @@ xrow_decode_vclock_xc(struct xrow_header *row, struct vclock *vclock)
 static inline void
 xrow_encode_subscribe_response_xc(struct xrow_header *row,
 				  const struct tt_uuid *replicaset_uuid,
-				  const struct vclock *vclock)
+				  const struct vclock *vclock, bool compress)
 {
-	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock) != 0)
+	if (xrow_encode_subscribe_response(row, replicaset_uuid, vclock,
+					   compress) != 0)
 		diag_raise();
 }
 
@@ -927,6 +1152,17 @@ iproto_reply_vclock_xc(struct obuf *out, const struct vclock *vclock,
 		diag_raise();
 }
 
+/** @copydoc iproto_reply_auth. */
+static inline void
+iproto_reply_auth_xc(struct obuf *out, const char *ticket,
+		     uint32_t ticket_size, uint64_t sync,
+		     uint32_t schema_version)
+{
+	if (iproto_reply_auth(out, ticket, ticket_size, sync,
+			      schema_version) != 0)
+		diag_raise();
+}
+
 /** @copydoc iproto_reply_vote. */
 static inline void
 iproto_reply_vote_xc(struct obuf *out, const struct ballot *ballot,
@@ -29,6 +29,9 @@
  * SUCH DAMAGE.
  */
 #include "xrow_io.h"
+
+#include <assert.h>
+
 #include "xrow.h"
 #include "coio.h"
 #include "coio_buf.h"
@@ -98,8 +101,24 @@ coio_read_xrow_timeout_xc(struct ev_io *coio, struct ibuf *in,
 void
 coio_write_xrow(struct ev_io *coio, const struct xrow_header *row)
 {
+	/*
+	 * Encode the length prefix and the header into an on-stack
+	 * buffer and chain the body up via iovec - the write path
+	 * doesn't allocate anything.
+	 */
+	assert(mp_sizeof_uint(UINT32_MAX) == 5);
+	char buf[5 + XROW_HEADER_LEN_MAX];
 	struct iovec iov[XROW_IOVMAX];
-	int iovcnt = xrow_to_iovec_xc(row, iov);
-	coio_writev(coio, iov, iovcnt, 0);
+	size_t hdr_len = xrow_header_encode_buf(row, row->sync, buf + 5);
+	size_t len = hdr_len;
+	for (int i = 0; i < row->bodycnt; i++) {
+		iov[1 + i] = row->body[i];
+		len += row->body[i].iov_len;
+	}
+	buf[0] = 0xce; /* MP_UINT32 */
+	*(uint32_t *) (buf + 1) = mp_bswap_u32(len);
+	iov[0].iov_base = buf;
+	iov[0].iov_len = 5 + hdr_len;
+	coio_writev(coio, iov, 1 + row->bodycnt, 0);
 }
 
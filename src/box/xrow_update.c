@@ -39,6 +39,7 @@
 #include "fiber.h"
 #include "xrow_update_field.h"
 #include "tuple_format.h"
+#include "third_party/PMurHash.h"
 
 /**
  * UPDATE is represented by a sequence of operations, each
@@ -279,6 +280,197 @@ xrow_update_read_ops(struct xrow_update *update, const char *expr,
 	return 0;
 }
 
+/* {{{ Compiled update programs */
+
+/**
+ * Workloads like counters send the same small update expression
+ * millions of times. Decoding and validating it anew on every
+ * call is pure waste, so parsed op sequences are cached keyed by
+ * the expression bytes, the same way sql_stmt_cache.c caches
+ * prepared SQL.
+ *
+ * A cached program owns a copy of the expression: decoded op
+ * arguments are MessagePack pointers into it, so the entry stays
+ * self-contained no matter what happens to the request buffer.
+ * The ops themselves are mutated during execution (the JSON
+ * lexer state, new_field_len), hence each execution runs on a
+ * fresh region copy of the op array - a memcpy instead of a full
+ * decode and validation.
+ *
+ * Only expressions with plain non-negative numeric field numbers
+ * are cacheable: field names would tie an entry to a space
+ * dictionary lifetime, and negative numbers make the column mask
+ * depend on the tuple being updated.
+ */
+
+enum {
+	/** Direct-mapped cache size, must be a power of two. */
+	XROW_UPDATE_PROG_CACHE_SIZE = 1024,
+	/** Do not cache expressions longer than this. */
+	XROW_UPDATE_PROG_EXPR_MAX = 256,
+};
+
+struct xrow_update_prog {
+	/** Hash of the expression, to cheapen comparison. */
+	uint32_t hash;
+	/** Length of the expression in bytes. */
+	uint32_t expr_len;
+	/** Index base the ops were decoded with. */
+	int index_base;
+	/** Number of decoded operations. */
+	uint32_t op_count;
+	/** Column mask of the expression, tuple-independent. */
+	uint64_t column_mask;
+	/** Copy of the expression, ops point into it. */
+	char *expr;
+	/** Decoded and validated operations, pristine. */
+	struct xrow_update_op *ops;
+};
+
+/**
+ * The cache is per thread: updates run in tx, but vinyl squashes
+ * upserts in worker fibers of other cords as well.
+ */
+static __thread struct xrow_update_prog **xrow_update_prog_cache;
+
+/**
+ * Check that every operation is {op, field_no, ...} with a
+ * non-negative numeric field, and measure the expression.
+ */
+static bool
+xrow_update_expr_is_cacheable(const char *expr, const char *expr_end,
+			      uint32_t *expr_len)
+{
+	const char *p = expr;
+	if (mp_typeof(*p) != MP_ARRAY)
+		return false;
+	uint32_t op_count = mp_decode_array(&p);
+	for (uint32_t i = 0; i < op_count; i++) {
+		if (p >= expr_end || mp_typeof(*p) != MP_ARRAY)
+			return false;
+		uint32_t arg_count = mp_decode_array(&p);
+		if (arg_count < 2 || mp_typeof(*p) != MP_STR)
+			return false;
+		mp_next(&p);
+		if (mp_typeof(*p) != MP_UINT)
+			return false;
+		for (uint32_t j = 1; j < arg_count; j++) {
+			if (mp_check(&p, expr_end) != 0)
+				return false;
+		}
+	}
+	if (p > expr_end || p - expr > XROW_UPDATE_PROG_EXPR_MAX)
+		return false;
+	*expr_len = p - expr;
+	return true;
+}
+
+/**
+ * Decode and validate @a expr into a new cache entry. NULL on
+ * decode error or OOM; the caller falls back to the plain path,
+ * which rediscovers the error if there was one.
+ */
+static struct xrow_update_prog *
+xrow_update_prog_build(const char *expr, uint32_t expr_len, uint32_t hash,
+		       int index_base, struct tuple_dictionary *dict)
+{
+	const char *p = expr;
+	uint32_t op_count = mp_decode_array(&p);
+	size_t ops_size = op_count * sizeof(struct xrow_update_op);
+	struct xrow_update_prog *prog =
+		malloc(sizeof(*prog) + ops_size + expr_len);
+	if (prog == NULL)
+		return NULL;
+	prog->hash = hash;
+	prog->expr_len = expr_len;
+	prog->index_base = index_base;
+	prog->op_count = op_count;
+	prog->ops = (struct xrow_update_op *) (prog + 1);
+	prog->expr = (char *) prog->ops + ops_size;
+	memcpy(prog->expr, expr, expr_len);
+	/*
+	 * Decode against the private copy, not the request
+	 * buffer: the op arguments are pointers into the
+	 * expression and must not outlive the request the entry
+	 * was built from.
+	 */
+	struct xrow_update update;
+	memset(&update, 0, sizeof(update));
+	update.index_base = index_base;
+	size_t region_svp = region_used(&fiber()->gc);
+	if (xrow_update_read_ops(&update, prog->expr, prog->expr + expr_len,
+				 dict, 0) != 0) {
+		free(prog);
+		region_truncate(&fiber()->gc, region_svp);
+		return NULL;
+	}
+	assert(update.op_count == op_count);
+	memcpy(prog->ops, update.ops, ops_size);
+	prog->column_mask = update.column_mask;
+	region_truncate(&fiber()->gc, region_svp);
+	return prog;
+}
+
+/**
+ * Find a compiled program for @a expr, building and caching one
+ * on a miss. NULL when the expression is not cacheable.
+ */
+static struct xrow_update_prog *
+xrow_update_prog_find(const char *expr, const char *expr_end, int index_base,
+		      struct tuple_dictionary *dict)
+{
+	uint32_t expr_len;
+	if (!xrow_update_expr_is_cacheable(expr, expr_end, &expr_len))
+		return NULL;
+	if (xrow_update_prog_cache == NULL) {
+		xrow_update_prog_cache =
+			calloc(XROW_UPDATE_PROG_CACHE_SIZE,
+			       sizeof(xrow_update_prog_cache[0]));
+		if (xrow_update_prog_cache == NULL)
+			return NULL;
+	}
+	uint32_t hash = PMurHash32(index_base, expr, expr_len);
+	struct xrow_update_prog **slot =
+		&xrow_update_prog_cache[hash &
+					(XROW_UPDATE_PROG_CACHE_SIZE - 1)];
+	struct xrow_update_prog *prog = *slot;
+	if (prog != NULL && prog->hash == hash &&
+	    prog->expr_len == expr_len && prog->index_base == index_base &&
+	    memcmp(prog->expr, expr, expr_len) == 0)
+		return prog;
+	prog = xrow_update_prog_build(expr, expr_len, hash, index_base, dict);
+	if (prog == NULL)
+		return NULL;
+	free(*slot);
+	*slot = prog;
+	return prog;
+}
+
+/**
+ * Set up @a update from a compiled program: the op array is
+ * copied to the region since execution mutates it.
+ */
+static int
+xrow_update_prog_load(struct xrow_update *update,
+		      const struct xrow_update_prog *prog)
+{
+	int size = prog->op_count * sizeof(update->ops[0]);
+	update->ops = (struct xrow_update_op *)
+		region_aligned_alloc(&fiber()->gc, size,
+				     alignof(struct xrow_update_op));
+	if (update->ops == NULL) {
+		diag_set(OutOfMemory, size, "region_aligned_alloc",
+			 "update->ops");
+		return -1;
+	}
+	memcpy(update->ops, prog->ops, size);
+	update->op_count = prog->op_count;
+	update->column_mask = prog->column_mask;
+	return 0;
+}
+
+/* }}} Compiled update programs */
+
 /**
  * Apply update operations to the concrete tuple.
  *
@@ -381,9 +573,16 @@ xrow_update_execute(const char *expr,const char *expr_end,
 	const char *header = old_data;
 	uint32_t field_count = mp_decode_array(&old_data);
 
-	if (xrow_update_read_ops(&update, expr, expr_end, format->dict,
-				 field_count) != 0)
+	struct xrow_update_prog *prog =
+		xrow_update_prog_find(expr, expr_end, index_base,
+				      format->dict);
+	if (prog != NULL) {
+		if (xrow_update_prog_load(&update, prog) != 0)
+			return NULL;
+	} else if (xrow_update_read_ops(&update, expr, expr_end, format->dict,
+					field_count) != 0) {
 		return NULL;
+	}
 	if (xrow_update_do_ops(&update, header, old_data, old_data_end,
 			       field_count) != 0)
 		return NULL;
@@ -393,6 +592,124 @@ xrow_update_execute(const char *expr,const char *expr_end,
 	return xrow_update_finish(&update, format, p_tuple_len);
 }
 
+int
+xrow_update_try_inplace(char *old_data, const char *old_data_end,
+			const char *expr, const char *expr_end,
+			int index_base, uint64_t forbidden_mask,
+			uint64_t *column_mask)
+{
+	(void)old_data_end;
+	const char *p = expr;
+	if (mp_typeof(*p) != MP_ARRAY)
+		return -1;
+	uint32_t op_count = mp_decode_array(&p);
+	const char *fields = old_data;
+	if (mp_typeof(*fields) != MP_ARRAY)
+		return -1;
+	uint32_t field_count = mp_decode_array(&fields);
+	uint64_t mask = 0;
+	for (uint32_t i = 0; i < op_count; i++) {
+		if (p >= expr_end || mp_typeof(*p) != MP_ARRAY)
+			return -1;
+		if (mp_decode_array(&p) != 3)
+			return -1;
+		if (mp_typeof(*p) != MP_STR)
+			return -1;
+		uint32_t len;
+		const char *op = mp_decode_str(&p, &len);
+		if (len != 1 || (*op != '=' && *op != '+' && *op != '-'))
+			return -1;
+		/*
+		 * JSON paths and negative field numbers go to the
+		 * generic implementation.
+		 */
+		if (mp_typeof(*p) != MP_UINT)
+			return -1;
+		uint64_t field_no = mp_decode_uint(&p);
+		if (field_no < (uint64_t)index_base)
+			return -1;
+		field_no -= index_base;
+		if (field_no >= field_count)
+			return -1;
+		uint64_t op_mask = 0;
+		column_mask_set_fieldno(&op_mask, field_no);
+		if ((op_mask & forbidden_mask) != 0)
+			return -1;
+		char *field = (char *)fields;
+		for (uint64_t j = 0; j < field_no; j++)
+			mp_next((const char **)&field);
+		const char *field_end = field;
+		mp_next(&field_end);
+		uint32_t field_size = field_end - field;
+		const char *arg = p;
+		mp_next(&p);
+		uint32_t arg_size = p - arg;
+		if (*op == '=') {
+			enum mp_type type = mp_typeof(*arg);
+			if (type != MP_UINT && type != MP_INT &&
+			    type != MP_FLOAT && type != MP_DOUBLE &&
+			    type != MP_BOOL)
+				return -1;
+			if (arg_size != field_size)
+				return -1;
+			memcpy(field, arg, field_size);
+		} else {
+			/*
+			 * Stick to the int64 range: anything
+			 * wider is left to the int96 arithmetic
+			 * of the generic implementation, which
+			 * also owns the overflow diagnostics.
+			 */
+			int64_t old_val, arg_val, new_val;
+			const char *reader = field;
+			if (mp_typeof(*reader) == MP_UINT) {
+				uint64_t val = mp_decode_uint(&reader);
+				if (val > (uint64_t)INT64_MAX)
+					return -1;
+				old_val = val;
+			} else if (mp_typeof(*reader) == MP_INT) {
+				old_val = mp_decode_int(&reader);
+			} else {
+				return -1;
+			}
+			reader = arg;
+			if (mp_typeof(*reader) == MP_UINT) {
+				uint64_t val = mp_decode_uint(&reader);
+				if (val > (uint64_t)INT64_MAX)
+					return -1;
+				arg_val = val;
+			} else if (mp_typeof(*reader) == MP_INT) {
+				arg_val = mp_decode_int(&reader);
+			} else {
+				return -1;
+			}
+			bool overflow;
+			if (*op == '+')
+				overflow = __builtin_add_overflow(
+					old_val, arg_val, &new_val);
+			else
+				overflow = __builtin_sub_overflow(
+					old_val, arg_val, &new_val);
+			if (overflow)
+				return -1;
+			uint32_t new_size = new_val >= 0 ?
+				mp_sizeof_uint(new_val) :
+				mp_sizeof_int(new_val);
+			if (new_size != field_size)
+				return -1;
+			if (new_val >= 0)
+				mp_encode_uint(field, new_val);
+			else
+				mp_encode_int(field, new_val);
+		}
+		mask |= op_mask;
+	}
+	if (p != expr_end)
+		return -1;
+	*column_mask = mask;
+	return 0;
+}
+
 const char *
 xrow_upsert_execute(const char *expr,const char *expr_end,
 		    const char *old_data, const char *old_data_end,
@@ -416,6 +733,19 @@ xrow_upsert_execute(const char *expr,const char *expr_end,
 	return xrow_update_finish(&update, format, p_tuple_len);
 }
 
+/**
+ * An update operation together with its raw msgpack, ordered by
+ * field number for the merge in xrow_upsert_squash().
+ */
+struct xrow_upsert_squash_op {
+	/** Decoded operation. */
+	struct xrow_update_op *op;
+	/** Msgpack encoding of the operation. */
+	const char *raw;
+	/** Size of the encoding. */
+	uint32_t raw_size;
+};
+
 const char *
 xrow_upsert_squash(const char *expr1, const char *expr1_end,
 		   const char *expr2, const char *expr2_end,
@@ -426,13 +756,20 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 	const char *expr_end[2] = {expr1_end, expr2_end};
 	struct xrow_update update[2];
 	struct tuple_dictionary *dict = format->dict;
+	struct xrow_upsert_squash_op *sorted[2];
 	for (int j = 0; j < 2; j++) {
 		xrow_update_init(&update[j], index_base);
 		if (xrow_update_read_ops(&update[j], expr[j], expr_end[j],
 					 dict, 0) != 0)
 			return NULL;
 		mp_decode_array(&expr[j]);
-		int32_t prev_field_no = index_base - 1;
+		size_t size = update[j].op_count * sizeof(*sorted[j]);
+		sorted[j] = (struct xrow_upsert_squash_op *)
+			region_alloc(&fiber()->gc, size);
+		if (sorted[j] == NULL) {
+			diag_set(OutOfMemory, size, "region_alloc", "sorted");
+			return NULL;
+		}
 		for (uint32_t i = 0; i < update[j].op_count; i++) {
 			struct xrow_update_op *op = &update[j].ops[i];
 			if (op->opcode != '+' && op->opcode != '-' &&
@@ -447,9 +784,38 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 			 */
 			if (!xrow_update_op_is_term(op))
 				return NULL;
-			if (op->field_no <= prev_field_no)
+			/*
+			 * A negative field number addresses a field
+			 * relative to the tuple end, so it can alias
+			 * an absolute field number. Don't try to
+			 * match such operations by field.
+			 */
+			if (op->field_no < 0)
 				return NULL;
-			prev_field_no = op->field_no;
+			const char *raw = expr[j];
+			mp_next(&expr[j]);
+			/*
+			 * Operations on distinct fields commute,
+			 * so they can be merged in field order no
+			 * matter in which order they were written.
+			 * Sort them by field number (insertion
+			 * sort - series are short). Same-field
+			 * operations within one upsert do not
+			 * commute, leave such series to the
+			 * generic execution path.
+			 */
+			uint32_t k = i;
+			while (k > 0 && sorted[j][k - 1].op->field_no >
+					op->field_no) {
+				sorted[j][k] = sorted[j][k - 1];
+				k--;
+			}
+			if (k > 0 &&
+			    sorted[j][k - 1].op->field_no == op->field_no)
+				return NULL;
+			sorted[j][k].op = op;
+			sorted[j][k].raw = raw;
+			sorted[j][k].raw_size = expr[j] - raw;
 		}
 	}
 	size_t possible_size = expr1_end - expr1 + expr2_end - expr2;
@@ -473,8 +839,12 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 	token.type = JSON_TOKEN_NUM;
 	while (op_no[0] < op_count[0] || op_no[1] < op_count[1]) {
 		res_count++;
-		struct xrow_update_op *op[2] = {update[0].ops + op_no[0],
-						update[1].ops + op_no[1]};
+		struct xrow_upsert_squash_op *sop[2] = {sorted[0] + op_no[0],
+							sorted[1] + op_no[1]};
+		uint32_t has[2] = {op_no[0] < op_count[0], op_no[1] < op_count[1]};
+		assert(has[0] || has[1]);
+		struct xrow_update_op *op[2] = {has[0] ? sop[0]->op : NULL,
+						has[1] ? sop[1]->op : NULL};
 		/*
 		 * from:
 		 * 0 - take op from first update,
@@ -482,8 +852,6 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 		 * 2 - merge both ops
 		 */
 		uint32_t from;
-		uint32_t has[2] = {op_no[0] < op_count[0], op_no[1] < op_count[1]};
-		assert(has[0] || has[1]);
 		if (has[0] && has[1]) {
 			from = op[0]->field_no < op[1]->field_no ? 0 :
 			       op[0]->field_no > op[1]->field_no ? 1 : 2;
@@ -498,17 +866,13 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 			 * So we just skip op from the first upsert and
 			 * copy op from the second
 			 */
-			mp_next(&expr[0]);
 			op_no[0]++;
 			from = 1;
 		}
 		if (from < 2) {
 			/* take op from one of upserts */
-			const char *copy = expr[from];
-			mp_next(&expr[from]);
-			size_t copy_size = expr[from] - copy;
-			memcpy(res_ops, copy, copy_size);
-			res_ops += copy_size;
+			memcpy(res_ops, sop[from]->raw, sop[from]->raw_size);
+			res_ops += sop[from]->raw_size;
 			op_no[from]++;
 			continue;
 		}
@@ -533,8 +897,6 @@ xrow_upsert_squash(const char *expr1, const char *expr1_end,
 		xrow_update_op_store_arith(&res, format_tree, this_node, NULL,
 					   res_ops);
 		res_ops += xrow_update_arg_arith_sizeof(&res.arg.arith);
-		mp_next(&expr[0]);
-		mp_next(&expr[1]);
 		op_no[0]++;
 		op_no[1]++;
 	}
@@ -56,6 +56,28 @@ xrow_update_execute(const char *expr,const char *expr_end,
 		    struct tuple_format *format, uint32_t *p_new_size,
 		    int index_base, uint64_t *column_mask);
 
+/**
+ * Try to apply an update expression by patching the tuple data
+ * in place, without materializing a new tuple. Only the narrow
+ * case that keeps every byte offset intact qualifies: '=', '+'
+ * and '-' on top-level scalar fields where the new value encodes
+ * to exactly the same width, with int64-range arithmetic and no
+ * field covered by @a forbidden_mask. Everything else, including
+ * anything that would raise an error, is left to
+ * xrow_update_execute(), so this function never sets diag.
+ *
+ * On failure @a old_data may be left partially patched: the
+ * caller must hold a copy and restore it before falling back.
+ *
+ * @retval 0 Patched, @a column_mask is set.
+ * @retval -1 Not applicable, use the generic implementation.
+ */
+int
+xrow_update_try_inplace(char *old_data, const char *old_data_end,
+			const char *expr, const char *expr_end,
+			int index_base, uint64_t forbidden_mask,
+			uint64_t *column_mask);
+
 const char *
 xrow_upsert_execute(const char *expr, const char *expr_end,
 		    const char *old_data, const char *old_data_end,
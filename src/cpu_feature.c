@@ -33,59 +33,48 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "cpu_feature.h"
 
-#if defined(HAVE_CPUID) && (defined (__x86_64__) || defined (__i386__))
+#if (defined(HAVE_CPUID) && (defined (__x86_64__) || defined (__i386__))) || \
+    defined(__aarch64__)
+#define HAVE_CRC32C_HW 1
+#endif
 
-#include <cpuid.h>
+#if defined(HAVE_CRC32C_HW)
 
 #define SCALE_F		sizeof(unsigned long)
 
+#if defined(HAVE_CPUID) && (defined (__x86_64__) || defined (__i386__))
+
+#include <cpuid.h>
+
 #if defined (__x86_64__)
 	#define REX_PRE "0x48, "
 #elif defined (__i386__)
 	#define REX_PRE
 #endif
 
-
-static uint32_t
-crc32c_hw_byte(uint32_t crc, unsigned char const *data, unsigned int length)
+static inline uint32_t
+crc32c_hw_byte(uint32_t crc, unsigned char data)
 {
-	while (length--) {
-		__asm__ __volatile__(
-			".byte 0xf2, 0xf, 0x38, 0xf0, 0xf1"
-			:"=S"(crc)
-			:"0"(crc), "c"(*data)
-		);
-		data++;
-	}
-
+	__asm__ __volatile__(
+		".byte 0xf2, 0xf, 0x38, 0xf0, 0xf1"
+		:"=S"(crc)
+		:"0"(crc), "c"(data)
+	);
 	return crc;
 }
 
-
-uint32_t
-crc32c_hw(uint32_t crc, const char *buf, unsigned int len)
+static inline unsigned long
+crc32c_hw_word(unsigned long crc, unsigned long data)
 {
-	unsigned int iquotient = len / SCALE_F;
-	unsigned int iremainder = len % SCALE_F;
-	unsigned long *ptmp = (unsigned long *)buf;
-
-	while (iquotient--) {
-		__asm__ __volatile__(
-			".byte 0xf2, " REX_PRE "0xf, 0x38, 0xf1, 0xf1;"
-			:"=S"(crc)
-			:"0"(crc), "c"(*ptmp)
-		);
-		ptmp++;
-	}
-
-	if (iremainder) {
-		crc = crc32c_hw_byte(crc, (unsigned char const*)ptmp,
-							iremainder);
-	}
-
+	__asm__ __volatile__(
+		".byte 0xf2, " REX_PRE "0xf, 0x38, 0xf1, 0xf1;"
+		:"=S"(crc)
+		:"0"(crc), "c"(data)
+	);
 	return crc;
 }
 
@@ -100,7 +89,242 @@ sse42_enabled_cpu()
 	return (cx & (1 << 20)) != 0;
 }
 
-#else /* !(defined (__x86_64__) || defined (__i386__)) */
+#elif defined(__aarch64__)
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+static inline uint32_t
+crc32c_hw_byte(uint32_t crc, unsigned char data)
+{
+	uint32_t ret;
+	__asm__ __volatile__(
+		".arch_extension crc\n"
+		"crc32cb %w0, %w1, %w2"
+		:"=r"(ret)
+		:"r"(crc), "r"(data)
+	);
+	return ret;
+}
+
+static inline unsigned long
+crc32c_hw_word(unsigned long crc, unsigned long data)
+{
+	uint32_t ret;
+	__asm__ __volatile__(
+		".arch_extension crc\n"
+		"crc32cx %w0, %w1, %2"
+		:"=r"(ret)
+		:"r"((uint32_t)crc), "r"(data)
+	);
+	return ret;
+}
+
+bool
+crc32c_enabled_cpu()
+{
+#if defined(__linux__) && defined(HWCAP_CRC32)
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif /* defined(__aarch64__) */
+
+enum {
+	/** Long block length for the interleaved computation. */
+	CRC32C_LONG = 8192,
+	/** Short block length for the interleaved computation. */
+	CRC32C_SHORT = 256,
+};
+
+/** CRC-32C (Castagnoli) polynomial, reflected. */
+#define CRC32C_POLY 0x82f63b78
+
+/*
+ * Tables with the operators applying CRC32C_LONG and CRC32C_SHORT
+ * zero bytes to a crc, used to stitch together independently
+ * computed streams. Filled in crc32c_hw_init().
+ */
+static uint32_t crc32c_long_zeros[4][256];
+static uint32_t crc32c_short_zeros[4][256];
+
+/* Multiply a matrix times a vector over GF(2). */
+static uint32_t
+gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	while (vec) {
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+/* Multiply a matrix by itself over GF(2). */
+static void
+gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	for (int n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+/*
+ * Construct an operator to apply @a len zero bytes to a crc by
+ * repeated squaring of the one-zero-bit operator.
+ */
+static void
+crc32c_zeros_op(uint32_t *even, size_t len)
+{
+	uint32_t odd[32];
+	uint32_t row = 1;
+
+	/* Operator for one zero bit. */
+	odd[0] = CRC32C_POLY;
+	for (int n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	/* Operator for two zero bits. */
+	gf2_matrix_square(even, odd);
+
+	/* Operator for four zero bits. */
+	gf2_matrix_square(odd, even);
+
+	/*
+	 * The first square below puts the operator for one zero
+	 * byte (eight zero bits) in even. Each following square
+	 * doubles the number of zero bytes until len is consumed.
+	 */
+	do {
+		gf2_matrix_square(even, odd);
+		len >>= 1;
+		if (len == 0)
+			return;
+		gf2_matrix_square(odd, even);
+		len >>= 1;
+	} while (len);
+
+	/* The answer ended up in odd - copy it to even. */
+	for (int n = 0; n < 32; n++)
+		even[n] = odd[n];
+}
+
+/*
+ * Expand the operator for @a len zero bytes into four tables
+ * which together apply it to a crc one byte at a time.
+ */
+static void
+crc32c_zeros(uint32_t zeros[][256], size_t len)
+{
+	uint32_t op[32];
+
+	crc32c_zeros_op(op, len);
+	for (uint32_t n = 0; n < 256; n++) {
+		zeros[0][n] = gf2_matrix_times(op, n);
+		zeros[1][n] = gf2_matrix_times(op, n << 8);
+		zeros[2][n] = gf2_matrix_times(op, n << 16);
+		zeros[3][n] = gf2_matrix_times(op, n << 24);
+	}
+}
+
+/* Apply a zeros operator table to a crc. */
+static inline uint32_t
+crc32c_shift(const uint32_t zeros[][256], unsigned long crc)
+{
+	return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+	       zeros[2][(crc >> 16) & 0xff] ^ zeros[3][(crc >> 24) & 0xff];
+}
+
+void
+crc32c_hw_init()
+{
+	crc32c_zeros(crc32c_long_zeros, CRC32C_LONG);
+	crc32c_zeros(crc32c_short_zeros, CRC32C_SHORT);
+}
+
+uint32_t
+crc32c_hw(uint32_t crc, const char *buf, unsigned int len)
+{
+	const unsigned char *next = (const unsigned char *)buf;
+	unsigned long crc0 = crc;
+
+	/* Align the input to a word boundary. */
+	while (len > 0 && ((uintptr_t)next & (SCALE_F - 1)) != 0) {
+		crc0 = crc32c_hw_byte(crc0, *next++);
+		len--;
+	}
+
+	/*
+	 * Compute the crc of sets of three LONG blocks in
+	 * parallel: the crc32 instruction has a throughput of one
+	 * per cycle but a latency of three cycles, so three
+	 * independent streams saturate the pipeline where a single
+	 * scalar loop stalls on the dependency chain. The partial
+	 * crcs are recombined with the precomputed zeros
+	 * operators.
+	 */
+	while (len >= 3 * CRC32C_LONG) {
+		unsigned long crc1 = 0;
+		unsigned long crc2 = 0;
+		const unsigned char *end = next + CRC32C_LONG;
+		do {
+			crc0 = crc32c_hw_word(crc0,
+					      *(unsigned long *)next);
+			crc1 = crc32c_hw_word(crc1, *(unsigned long *)
+					      (next + CRC32C_LONG));
+			crc2 = crc32c_hw_word(crc2, *(unsigned long *)
+					      (next + 2 * CRC32C_LONG));
+			next += SCALE_F;
+		} while (next < end);
+		crc0 = crc32c_shift(crc32c_long_zeros, crc0) ^ crc1;
+		crc0 = crc32c_shift(crc32c_long_zeros, crc0) ^ crc2;
+		next += 2 * CRC32C_LONG;
+		len -= 3 * CRC32C_LONG;
+	}
+
+	/* The same for sets of three SHORT blocks. */
+	while (len >= 3 * CRC32C_SHORT) {
+		unsigned long crc1 = 0;
+		unsigned long crc2 = 0;
+		const unsigned char *end = next + CRC32C_SHORT;
+		do {
+			crc0 = crc32c_hw_word(crc0,
+					      *(unsigned long *)next);
+			crc1 = crc32c_hw_word(crc1, *(unsigned long *)
+					      (next + CRC32C_SHORT));
+			crc2 = crc32c_hw_word(crc2, *(unsigned long *)
+					      (next + 2 * CRC32C_SHORT));
+			next += SCALE_F;
+		} while (next < end);
+		crc0 = crc32c_shift(crc32c_short_zeros, crc0) ^ crc1;
+		crc0 = crc32c_shift(crc32c_short_zeros, crc0) ^ crc2;
+		next += 2 * CRC32C_SHORT;
+		len -= 3 * CRC32C_SHORT;
+	}
+
+	/* Finish the tail one word at a time. */
+	while (len >= SCALE_F) {
+		crc0 = crc32c_hw_word(crc0, *(unsigned long *)next);
+		next += SCALE_F;
+		len -= SCALE_F;
+	}
+	while (len-- > 0)
+		crc0 = crc32c_hw_byte(crc0, *next++);
+
+	return (uint32_t)crc0;
+}
+
+#endif /* defined(HAVE_CRC32C_HW) */
+
+#if !(defined(HAVE_CPUID) && (defined (__x86_64__) || defined (__i386__)))
 
 bool
 sse42_enabled_cpu()
@@ -42,7 +42,17 @@
  */
 bool sse42_enabled_cpu();
 
-#if defined (__x86_64__) || defined (__i386__)
+#if defined(__aarch64__)
+/* Check whether CPU supports the ARMv8 CRC32 instructions. */
+bool crc32c_enabled_cpu();
+#endif
+
+#if defined (__x86_64__) || defined (__i386__) || defined(__aarch64__)
+/* Fill the stream recombination tables used by crc32c_hw().
+ * Must be called once before the first crc32c_hw() call.
+ */
+void crc32c_hw_init();
+
 /* Hardware-calculate CRC32 for the given data buffer.
  *
  * @param	crc 		initial CRC
@@ -43,8 +43,17 @@ void
 crc32_init()
 {
 #if defined(HAVE_CPUID) && (defined (__x86_64__) || defined (__i386__))
-	crc32_calc = sse42_enabled_cpu() ? &crc32c_hw : &crc32c;
-#else
-	crc32_calc = &crc32c;
+	if (sse42_enabled_cpu()) {
+		crc32c_hw_init();
+		crc32_calc = &crc32c_hw;
+		return;
+	}
+#elif defined(__aarch64__)
+	if (crc32c_enabled_cpu()) {
+		crc32c_hw_init();
+		crc32_calc = &crc32c_hw;
+		return;
+	}
 #endif
+	crc32_calc = &crc32c;
 }
@@ -260,6 +260,8 @@ void
 curl_env_destroy(struct curl_env *env)
 {
 	assert(env);
+	for (int i = 0; i < env->easy_cache_size; i++)
+		curl_easy_cleanup(env->easy_cache[i]);
 	if (env->multi != NULL)
 		curl_multi_cleanup(env->multi);
 
@@ -267,12 +269,22 @@ curl_env_destroy(struct curl_env *env)
 }
 
 int
-curl_request_create(struct curl_request *curl_request)
+curl_request_create(struct curl_request *curl_request, struct curl_env *env)
 {
-	curl_request->easy = curl_easy_init();
-	if (curl_request->easy == NULL) {
-		diag_set(OutOfMemory, 0, "curl", "easy");
-		return -1;
+	if (env->easy_cache_size > 0) {
+		/*
+		 * Reset wipes all options but keeps the live
+		 * connections and the session caches tied to the
+		 * handle.
+		 */
+		curl_request->easy = env->easy_cache[--env->easy_cache_size];
+		curl_easy_reset(curl_request->easy);
+	} else {
+		curl_request->easy = curl_easy_init();
+		if (curl_request->easy == NULL) {
+			diag_set(OutOfMemory, 0, "curl", "easy");
+			return -1;
+		}
 	}
 	curl_request->in_progress = false;
 	curl_request->code = CURLE_OK;
@@ -281,46 +293,70 @@ curl_request_create(struct curl_request *curl_request)
 }
 
 void
-curl_request_destroy(struct curl_request *curl_request)
+curl_request_destroy(struct curl_request *curl_request, struct curl_env *env)
 {
-	if (curl_request->easy != NULL)
-		curl_easy_cleanup(curl_request->easy);
+	if (curl_request->easy != NULL) {
+		if (env->easy_cache_size < CURL_EASY_CACHE_SIZE)
+			env->easy_cache[env->easy_cache_size++] =
+				curl_request->easy;
+		else
+			curl_easy_cleanup(curl_request->easy);
+	}
 	fiber_cond_destroy(&curl_request->cond);
 }
 
+/** Convert a multi error to diag and pass the code through. */
+static CURLMcode
+curl_merror(CURLMcode mcode)
+{
+	switch (mcode) {
+	case CURLM_OUT_OF_MEMORY:
+		diag_set(OutOfMemory, 0, "curl", "internal");
+		break;
+	default:
+		errno = EINVAL;
+		diag_set(SystemError, "curl_multi_error: %s",
+			 curl_multi_strerror(mcode));
+	}
+	return mcode;
+}
+
+CURLMcode
+curl_request_start(struct curl_request *curl_request, struct curl_env *env)
+{
+	curl_request->in_progress = true;
+	CURLMcode mcode = curl_multi_add_handle(env->multi,
+						curl_request->easy);
+	if (mcode != CURLM_OK)
+		return curl_merror(mcode);
+	++env->stat.active_requests;
+	return CURLM_OK;
+}
+
+CURLMcode
+curl_request_finish(struct curl_request *curl_request, struct curl_env *env)
+{
+	--env->stat.active_requests;
+	CURLMcode mcode = curl_multi_remove_handle(env->multi,
+						   curl_request->easy);
+	if (mcode != CURLM_OK)
+		return curl_merror(mcode);
+	return CURLM_OK;
+}
+
 CURLMcode
 curl_execute(struct curl_request *curl_request, struct curl_env *env,
 	     double timeout)
 {
-	CURLMcode mcode;
-	curl_request->in_progress = true;
-	mcode = curl_multi_add_handle(env->multi, curl_request->easy);
+	CURLMcode mcode = curl_request_start(curl_request, env);
 	if (mcode != CURLM_OK)
-		goto curl_merror;
+		return mcode;
 	ERROR_INJECT_YIELD(ERRINJ_HTTP_RESPONSE_ADD_WAIT);
 	/* Don't wait on a cond if request has already failed or finished. */
 	if (curl_request->code == CURLE_OK && curl_request->in_progress) {
-		++env->stat.active_requests;
 		int rc = fiber_cond_wait_timeout(&curl_request->cond, timeout);
 		if (rc < 0 || fiber_is_cancelled())
 			curl_request->code = CURLE_OPERATION_TIMEDOUT;
-		--env->stat.active_requests;
 	}
-	mcode = curl_multi_remove_handle(env->multi, curl_request->easy);
-	if (mcode != CURLM_OK)
-		goto curl_merror;
-
-	return CURLM_OK;
-
-curl_merror:
-	switch (mcode) {
-	case CURLM_OUT_OF_MEMORY:
-		diag_set(OutOfMemory, 0, "curl", "internal");
-		break;
-	default:
-		errno = EINVAL;
-		diag_set(SystemError, "curl_multi_error: %s",
-			 curl_multi_strerror(mcode));
-	}
-	return mcode;
+	return curl_request_finish(curl_request, env);
 }
@@ -48,6 +48,12 @@ struct curl_stat {
 	uint64_t active_requests;
 };
 
+/**
+ * Max number of idle easy handles cached in a curl environment
+ * for reuse by later requests.
+ */
+enum { CURL_EASY_CACHE_SIZE = 16 };
+
 /**
  * CURL Environment
  */
@@ -58,6 +64,15 @@ struct curl_env {
 	struct mempool sock_pool;
 	/** libev timer watcher. */
 	struct ev_timer timer_event;
+	/**
+	 * Cache of idle easy handles. Creating an easy handle is
+	 * not free and the multi connection cache is keyed off the
+	 * handles, so finished requests park their handles here
+	 * instead of destroying them.
+	 */
+	CURL *easy_cache[CURL_EASY_CACHE_SIZE];
+	/** Number of handles in easy_cache. */
+	int easy_cache_size;
 	/** Statistics. */
 	struct curl_stat stat;
 };
@@ -97,20 +112,38 @@ void
 curl_env_destroy(struct curl_env *env);
 
 /**
- * Initialize a new CURL request
+ * Initialize a new CURL request. Reuses a cached easy handle of
+ * the environment when one is available.
  * @param curl_request request
+ * @param env environment
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
-curl_request_create(struct curl_request *curl_request);
+curl_request_create(struct curl_request *curl_request, struct curl_env *env);
 
 /**
- * Cleanup CURL request
+ * Cleanup CURL request. The easy handle is returned to the
+ * environment cache unless the cache is full.
  * @param curl_request request
+ * @param env environment
  */
 void
-curl_request_destroy(struct curl_request *curl_request);
+curl_request_destroy(struct curl_request *curl_request, struct curl_env *env);
+
+/**
+ * Hand a request over to the multi handle and start the transfer.
+ * The caller is supposed to wait on curl_request->cond until
+ * in_progress is cleared and then call curl_request_finish().
+ */
+CURLMcode
+curl_request_start(struct curl_request *curl_request, struct curl_env *env);
+
+/**
+ * Detach a finished (or timed out) request from the multi handle.
+ */
+CURLMcode
+curl_request_finish(struct curl_request *curl_request, struct curl_env *env);
 
 /**
  * Execute CURL request
@@ -47,6 +47,12 @@ static_assert(MAX_HEADER_LEN < SMALL_STATIC_SIZE,
 #define HTTP_CONNECTION_HEADER	"Connection:"
 #define HTTP_KEEP_ALIVE_HEADER	"Keep-Alive:"
 
+/**
+ * Max number of body bytes buffered ahead of the consumer in
+ * streaming mode before the transfer is paused.
+ */
+enum { HTTPC_STREAM_BUF_CAP = 1024 * 1024 };
+
 /**
  * libcurl callback for CURLOPT_WRITEFUNCTION
  * @see https://curl.haxx.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
@@ -57,6 +63,28 @@ curl_easy_write_cb(char *ptr, size_t size, size_t nmemb, void *ctx)
 	struct httpc_request *req = (struct httpc_request *) ctx;
 	const size_t bytes = size * nmemb;
 
+	if (req->on_body != NULL) {
+		/*
+		 * Streaming mode: land the chunk into a buffer
+		 * drained by the requesting fiber. If the consumer
+		 * doesn't keep up, pause the transfer instead of
+		 * buffering without a limit - libcurl redelivers
+		 * the chunk after curl_easy_pause(CURLPAUSE_CONT).
+		 */
+		if (ibuf_used(&req->stream_buf) >= HTTPC_STREAM_BUF_CAP) {
+			req->is_paused = true;
+			return CURL_WRITEFUNC_PAUSE;
+		}
+		char *p = ibuf_alloc(&req->stream_buf, bytes);
+		if (p == NULL) {
+			diag_set(OutOfMemory, bytes, "ibuf", "httpc body");
+			return 0;
+		}
+		memcpy(p, ptr, bytes);
+		fiber_cond_signal(&req->curl_request.cond);
+		return bytes;
+	}
+
 	char *p = region_alloc(&req->resp_body, bytes);
 	if (p == NULL) {
 		diag_set(OutOfMemory, bytes, "ibuf", "httpc body");
@@ -120,8 +148,9 @@ httpc_request_new(struct httpc_env *env, const char *method,
 	req->set_keep_alive_header = true;
 	region_create(&req->resp_headers, &cord()->slabc);
 	region_create(&req->resp_body, &cord()->slabc);
+	ibuf_create(&req->stream_buf, &cord()->slabc, 1);
 
-	if (curl_request_create(&req->curl_request) != 0)
+	if (curl_request_create(&req->curl_request, &env->curl_env) != 0)
 		return NULL;
 
 	if (strcmp(method, "GET") == 0) {
@@ -169,9 +198,10 @@ httpc_request_delete(struct httpc_request *req)
 	if (req->headers != NULL)
 		curl_slist_free_all(req->headers);
 
-	curl_request_destroy(&req->curl_request);
+	curl_request_destroy(&req->curl_request, &req->env->curl_env);
 
 	ibuf_destroy(&req->body);
+	ibuf_destroy(&req->stream_buf);
 	region_destroy(&req->resp_headers);
 	region_destroy(&req->resp_body);
 
@@ -377,6 +407,72 @@ httpc_set_accept_encoding(struct httpc_request *req, const char *encoding)
 #endif
 }
 
+void
+httpc_set_on_body(struct httpc_request *req, httpc_body_f cb, void *ctx)
+{
+	req->on_body = cb;
+	req->on_body_ctx = ctx;
+}
+
+/**
+ * Run a transfer in streaming mode: wait for body chunks on the
+ * request cond and hand them to the consumer callback from this
+ * fiber. The completion path signals the same cond, so a single
+ * wait covers both events.
+ */
+static int
+httpc_execute_streaming(struct httpc_request *req, double timeout)
+{
+	struct curl_request *curl_request = &req->curl_request;
+	struct curl_env *curl_env = &req->env->curl_env;
+	double deadline = ev_monotonic_now(loop()) + timeout;
+	int rc = 0;
+
+	if (curl_request_start(curl_request, curl_env) != CURLM_OK)
+		return -1;
+	while (true) {
+		while (ibuf_used(&req->stream_buf) > 0) {
+			char *chunk = req->stream_buf.rpos;
+			size_t len = ibuf_used(&req->stream_buf);
+			/*
+			 * Consume before the call: chunks arriving
+			 * while the consumer yields are appended
+			 * after rpos and picked up by the next
+			 * iteration.
+			 */
+			req->stream_buf.rpos += len;
+			if (req->on_body(req->on_body_ctx, chunk, len) != 0) {
+				rc = -1;
+				goto out;
+			}
+		}
+		ibuf_reset(&req->stream_buf);
+		if (req->is_paused) {
+			req->is_paused = false;
+			curl_easy_pause(curl_request->easy, CURLPAUSE_CONT);
+			continue;
+		}
+		if (curl_request->code != CURLE_OK ||
+		    !curl_request->in_progress)
+			break;
+		if (fiber_cond_wait_deadline(&curl_request->cond,
+					     deadline) < 0 &&
+		    ibuf_used(&req->stream_buf) == 0 &&
+		    curl_request->in_progress) {
+			curl_request->code = CURLE_OPERATION_TIMEDOUT;
+			break;
+		}
+		if (fiber_is_cancelled()) {
+			curl_request->code = CURLE_OPERATION_TIMEDOUT;
+			break;
+		}
+	}
+out:
+	if (curl_request_finish(curl_request, curl_env) != CURLM_OK)
+		return -1;
+	return rc;
+}
+
 int
 httpc_execute(struct httpc_request *req, double timeout)
 {
@@ -401,8 +497,13 @@ httpc_execute(struct httpc_request *req, double timeout)
 
 	++env->stat.total_requests;
 
-	if (curl_execute(&req->curl_request, &env->curl_env, timeout) != CURLM_OK)
+	if (req->on_body != NULL) {
+		if (httpc_execute_streaming(req, timeout) != 0)
+			return -1;
+	} else if (curl_execute(&req->curl_request, &env->curl_env,
+				timeout) != CURLM_OK) {
 		return -1;
+	}
 	ERROR_INJECT_RETURN(ERRINJ_HTTPC_EXECUTE);
 	long longval = 0;
 	switch (req->curl_request.code) {
@@ -89,6 +89,17 @@ httpc_env_destroy(struct httpc_env *env);
 
 /** {{{ Request */
 
+/**
+ * Body streaming callback. Invoked in the context of the fiber
+ * that runs httpc_execute() with each received chunk of the
+ * response body. The chunk points into an internal buffer and is
+ * valid only until the callback returns or yields - consume or
+ * copy it before doing either. Returning non-zero aborts the
+ * transfer.
+ */
+typedef int
+(*httpc_body_f)(void *ctx, const char *chunk, size_t len);
+
 /**
  * HTTP request
  */
@@ -109,6 +120,22 @@ struct httpc_request {
 	struct region resp_headers;
 	/** buffer of body */
 	struct region resp_body;
+	/**
+	 * Body streaming callback. When set, response body chunks
+	 * are handed to it as they arrive instead of being
+	 * accumulated in resp_body.
+	 */
+	httpc_body_f on_body;
+	/** Opaque context passed to on_body. */
+	void *on_body_ctx;
+	/** Landing buffer for body chunks in streaming mode. */
+	struct ibuf stream_buf;
+	/**
+	 * True if the transfer was paused because the consumer
+	 * doesn't keep up with the network, see
+	 * HTTPC_STREAM_BUF_CAP.
+	 */
+	bool is_paused;
 	/**
 	 * Idle delay, in seconds, that the operating system will
 	 * wait while the connection is idle before sending
@@ -402,6 +429,17 @@ httpc_set_follow_location(struct httpc_request *req, long follow);
 void
 httpc_set_accept_encoding(struct httpc_request *req, const char *encoding);
 
+/**
+ * Switch the request into body streaming mode: deliver response
+ * body chunks to the given callback from the fiber that runs
+ * httpc_execute() instead of buffering the whole body.
+ * @param req request
+ * @param cb chunk consumer
+ * @param ctx opaque context passed to the consumer
+ */
+void
+httpc_set_on_body(struct httpc_request *req, httpc_body_f cb, void *ctx);
+
 /**
  * This function does async HTTP request
  * @param request - reference to request object with filled fields
@@ -80,7 +80,69 @@ tt_bitset_test(struct tt_bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(tt_bitset_page_data(page), pos - page->first_pos);
+	return tt_bitset_page_test_bit(page, pos - page->first_pos);
+}
+
+/**
+ * @brief Replace \a page with a new one of a different capacity,
+ * converting the representation if needed. \a new_capacity of zero
+ * means a dense bitmap page.
+ * @retval the new page on success
+ * @retval NULL on memory error, the old page is left intact
+ */
+static struct tt_bitset_page *
+tt_bitset_page_convert(struct tt_bitset *bitset, struct tt_bitset_page *page,
+		       uint16_t new_capacity)
+{
+	assert(new_capacity == 0 || page->cardinality <= new_capacity);
+
+	size_t size = new_capacity != 0 ?
+		      tt_bitset_page_sparse_alloc_size(new_capacity) :
+		      tt_bitset_page_alloc_size(bitset->realloc);
+	struct tt_bitset_page *new_page = bitset->realloc(NULL, size);
+	if (new_page == NULL)
+		return NULL;
+
+	memset(new_page, 0, size);
+	new_page->first_pos = page->first_pos;
+	new_page->cardinality = page->cardinality;
+	new_page->capacity = new_capacity;
+
+	if (tt_bitset_page_is_sparse(page)) {
+		uint16_t *vals = tt_bitset_page_sparse_data(page);
+		if (new_capacity != 0) {
+			/* Array to (larger) array */
+			memcpy(tt_bitset_page_sparse_data(new_page), vals,
+			       page->cardinality * sizeof(*vals));
+		} else {
+			/* Array to bitmap */
+			for (size_t i = 0; i < page->cardinality; i++)
+				bit_set(tt_bitset_page_data(new_page),
+					vals[i]);
+		}
+	} else {
+		/* Bitmap to array */
+		assert(new_capacity != 0);
+		uint16_t *vals = tt_bitset_page_sparse_data(new_page);
+		size_t i = 0;
+		size_t offset;
+		struct bit_iterator bit_it;
+		bit_iterator_init(&bit_it, tt_bitset_page_data(page),
+				  BITSET_PAGE_DATA_SIZE, true);
+		while ((offset = bit_iterator_next(&bit_it)) != SIZE_MAX)
+			vals[i++] = offset;
+		assert(i == page->cardinality);
+	}
+
+	/*
+	 * A page can not be reallocated in place because it is
+	 * linked into the pages tree - replace it.
+	 */
+	tt_bitset_pages_remove(&bitset->pages, page);
+	tt_bitset_pages_insert(&bitset->pages, new_page);
+	tt_bitset_page_destroy(page);
+	bitset->realloc(page, 0);
+	return new_page;
 }
 
 int
@@ -93,14 +155,16 @@ tt_bitset_set(struct tt_bitset *bitset, size_t pos)
 	struct tt_bitset_page *page =
 		tt_bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
-		/* Allocate a new page */
-		size_t size = tt_bitset_page_alloc_size(bitset->realloc);
+		/* Allocate a new sparse page */
+		size_t size = tt_bitset_page_sparse_alloc_size(
+					BITSET_PAGE_SPARSE_MIN_CAPACITY);
 		page = bitset->realloc(NULL, size);
 		if (page == NULL)
 			return -1;
 
-		tt_bitset_page_create(page);
+		memset(page, 0, size);
 		page->first_pos = key.first_pos;
+		page->capacity = BITSET_PAGE_SPARSE_MIN_CAPACITY;
 
 		/* Insert the page into pages tree */
 		tt_bitset_pages_insert(&bitset->pages, page);
@@ -108,6 +172,37 @@ tt_bitset_set(struct tt_bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
+	if (tt_bitset_page_is_sparse(page)) {
+		uint16_t offset = pos - page->first_pos;
+		uint16_t i = tt_bitset_page_sparse_lower_bound(page, offset);
+		uint16_t *vals = tt_bitset_page_sparse_data(page);
+		if (i < page->cardinality && vals[i] == offset) {
+			/* Value has not changed */
+			return 1;
+		}
+
+		if (page->cardinality == page->capacity) {
+			/* Grow the array or convert to a bitmap */
+			uint16_t new_capacity = page->capacity * 2;
+			if (new_capacity > BITSET_PAGE_SPARSE_MAX_CAPACITY)
+				new_capacity = 0;
+			page = tt_bitset_page_convert(bitset, page,
+						      new_capacity);
+			if (page == NULL)
+				return -1;
+		}
+		if (tt_bitset_page_is_sparse(page)) {
+			/* The insertion point is not affected by growth */
+			vals = tt_bitset_page_sparse_data(page);
+			memmove(vals + i + 1, vals + i,
+				(page->cardinality - i) * sizeof(*vals));
+			vals[i] = offset;
+			page->cardinality++;
+			bitset->cardinality++;
+			return 0;
+		}
+	}
+
 	bool prev = bit_set(tt_bitset_page_data(page), pos - page->first_pos);
 	if (prev) {
 		/* Value has not changed */
@@ -134,9 +229,21 @@ tt_bitset_clear(struct tt_bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(tt_bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
-		return 0;
+	if (tt_bitset_page_is_sparse(page)) {
+		uint16_t offset = pos - page->first_pos;
+		uint16_t i = tt_bitset_page_sparse_lower_bound(page, offset);
+		uint16_t *vals = tt_bitset_page_sparse_data(page);
+		if (i == page->cardinality || vals[i] != offset)
+			return 0;
+
+		memmove(vals + i, vals + i + 1,
+			(page->cardinality - i - 1) * sizeof(*vals));
+	} else {
+		bool prev = bit_clear(tt_bitset_page_data(page),
+				      pos - page->first_pos);
+		if (!prev) {
+			return 0;
+		}
 	}
 
 	assert(bitset->cardinality > 0);
@@ -150,6 +257,15 @@ tt_bitset_clear(struct tt_bitset *bitset, size_t pos)
 		/* Free the page */
 		tt_bitset_page_destroy(page);
 		bitset->realloc(page, 0);
+	} else if (!tt_bitset_page_is_sparse(page) && page->cardinality ==
+		   BITSET_PAGE_SPARSE_DEMOTE_CARDINALITY) {
+		/*
+		 * The page got sparse enough to be stored as a
+		 * value array again. Best effort: on memory error
+		 * keep the bitmap, it is still correct.
+		 */
+		tt_bitset_page_convert(bitset, page,
+				       BITSET_PAGE_SPARSE_MAX_CAPACITY);
 	}
 
 	return 1;
@@ -170,6 +286,12 @@ tt_bitset_info(struct tt_bitset *bitset, struct tt_bitset_info *info)
 	struct tt_bitset_page *page = tt_bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		if (tt_bitset_page_is_sparse(page)) {
+			info->pages_sparse++;
+			info->mem_sparse +=
+				tt_bitset_page_sparse_alloc_size(
+					page->capacity);
+		}
 		cardinality_check += page->cardinality;
 		page = tt_bitset_pages_next(&bitset->pages, page);
 	}
@@ -69,6 +69,14 @@ struct tt_bitset_page {
 	size_t first_pos;
 	rb_node(struct tt_bitset_page) node;
 	size_t cardinality;
+	/**
+	 * Number of uint16_t value slots allocated in a sparse
+	 * page. Zero means the page is dense - \a data holds a
+	 * plain bitmap of BITSET_PAGE_DATA_SIZE bytes. Non-zero
+	 * means the page is sparse - \a data holds a sorted array
+	 * of \a cardinality bit offsets within the page.
+	 */
+	uint16_t capacity;
 	uint8_t data[0];
 };
 
@@ -151,9 +159,13 @@ tt_bitset_cardinality(const struct tt_bitset *bitset) {
 struct tt_bitset_info {
 	/** Number of allocated pages */
 	size_t pages;
-	/** Data (payload) size of one page (in bytes) */
+	/** Number of pages stored as sorted value arrays */
+	size_t pages_sparse;
+	/** Total size of sparse pages (in bytes, including tree data) */
+	size_t mem_sparse;
+	/** Data (payload) size of one dense page (in bytes) */
 	size_t page_data_size;
-	/** Full size of one page (in bytes, including padding and tree data) */
+	/** Full size of one dense page (in bytes, including padding and tree data) */
 	size_t page_total_size;
 	/** A multiplier by which an address of page data is aligned **/
 	size_t page_data_alignment;
@@ -386,7 +386,9 @@ tt_bitset_index_bsize(const struct tt_bitset_index *index)
 			continue;
 		struct tt_bitset_info info;
 		tt_bitset_info(index->bitsets[b], &info);
-		result += info.page_total_size * info.pages;
+		result += info.page_total_size *
+			  (info.pages - info.pages_sparse);
+		result += info.mem_sparse;
 	}
 	return result;
 }
@@ -311,6 +311,63 @@ tt_bitset_iterator_conj_prepare_page(struct tt_bitset_iterator_conj *conj,
 	assert(conj->size > 0);
 	assert(conj->page_first_pos != SIZE_MAX);
 
+	/*
+	 * Sparse fast path: if some positive operand is stored as
+	 * a sorted value array, evaluate the conjunction in the
+	 * array domain - probe every value of the smallest such
+	 * operand against the other operands instead of ANDing
+	 * full bitmaps. The result can not contain values missing
+	 * from a positive operand, so this is exact.
+	 */
+	struct tt_bitset_page *pivot = NULL;
+	size_t pivot_b = 0;
+	for (size_t b = 0; b < conj->size; b++) {
+		if (conj->pre_nots[b] ||
+		    !tt_bitset_page_is_sparse(conj->pages[b]))
+			continue;
+		if (pivot == NULL ||
+		    conj->pages[b]->cardinality < pivot->cardinality) {
+			pivot = conj->pages[b];
+			pivot_b = b;
+		}
+	}
+	if (pivot != NULL) {
+		tt_bitset_page_set_zeros(dst);
+		uint16_t *vals = tt_bitset_page_sparse_data(pivot);
+		for (size_t i = 0; i < pivot->cardinality; i++) {
+			uint16_t offset = vals[i];
+			bool match = true;
+			for (size_t b = 0; b < conj->size; b++) {
+				if (b == pivot_b)
+					continue;
+				struct tt_bitset_page *page = conj->pages[b];
+				if (conj->pre_nots[b]) {
+					/*
+					 * A missing or mismatched
+					 * page is all zeros, see
+					 * the NAND comment below.
+					 */
+					if (page == NULL ||
+					    page->first_pos !=
+					    conj->page_first_pos)
+						continue;
+					if (tt_bitset_page_test_bit(page,
+								    offset)) {
+						match = false;
+						break;
+					}
+				} else if (!tt_bitset_page_test_bit(page,
+								    offset)) {
+					match = false;
+					break;
+				}
+			}
+			if (match)
+				bit_set(tt_bitset_page_data(dst), offset);
+		}
+		return;
+	}
+
 	tt_bitset_page_set_ones(dst);
 	for (size_t b = 0; b < conj->size; b++) {
 		if (!conj->pre_nots[b]) {
@@ -35,9 +35,25 @@
 extern inline size_t
 tt_bitset_page_alloc_size(void *(*realloc_arg)(void *ptr, size_t size));
 
+extern inline bool
+tt_bitset_page_is_sparse(const struct tt_bitset_page *page);
+
 extern inline void *
 tt_bitset_page_data(struct tt_bitset_page *page);
 
+extern inline uint16_t *
+tt_bitset_page_sparse_data(struct tt_bitset_page *page);
+
+extern inline size_t
+tt_bitset_page_sparse_alloc_size(uint16_t capacity);
+
+extern inline uint16_t
+tt_bitset_page_sparse_lower_bound(struct tt_bitset_page *page,
+				  uint16_t offset);
+
+extern inline bool
+tt_bitset_page_test_bit(struct tt_bitset_page *page, uint16_t offset);
+
 extern inline void
 tt_bitset_page_create(struct tt_bitset_page *page);
 
@@ -58,6 +58,24 @@ enum {
 	BITSET_PAGE_DATA_SIZE = 160
 };
 
+enum {
+	/** Initial capacity of a sparse page, in values. */
+	BITSET_PAGE_SPARSE_MIN_CAPACITY = 8,
+	/**
+	 * Maximal capacity of a sparse page, in values. A sparse
+	 * page that outgrows it is converted to a dense bitmap.
+	 */
+	BITSET_PAGE_SPARSE_MAX_CAPACITY = 64,
+	/**
+	 * A dense page whose cardinality drops to this value is
+	 * converted back to a sparse array. Kept well below
+	 * BITSET_PAGE_SPARSE_MAX_CAPACITY so that a page
+	 * oscillating around a threshold is not converted back
+	 * and forth on every change.
+	 */
+	BITSET_PAGE_SPARSE_DEMOTE_CARDINALITY = 32,
+};
+
 #if defined(ENABLE_AVX)
 typedef __m256i tt_bitset_word_t;
 #define BITSET_PAGE_DATA_ALIGNMENT 32
@@ -107,16 +125,69 @@ tt_bitset_page_alloc_size(void *(*realloc_arg)(void *ptr, size_t size))
 
 #undef MALLOC_ALIGNMENT
 
+inline bool
+tt_bitset_page_is_sparse(const struct tt_bitset_page *page)
+{
+	return page->capacity != 0;
+}
+
 inline void *
 tt_bitset_page_data(struct tt_bitset_page *page)
 {
+	assert(!tt_bitset_page_is_sparse(page));
 	uintptr_t r = (uintptr_t) (page->data + BITSET_PAGE_DATA_ALIGNMENT - 1);
 	return (void *) (r & ~((uintptr_t) BITSET_PAGE_DATA_ALIGNMENT - 1));
 }
 
+inline uint16_t *
+tt_bitset_page_sparse_data(struct tt_bitset_page *page)
+{
+	assert(tt_bitset_page_is_sparse(page));
+	return (uint16_t *) page->data;
+}
+
+inline size_t
+tt_bitset_page_sparse_alloc_size(uint16_t capacity)
+{
+	return sizeof(struct tt_bitset_page) + capacity * sizeof(uint16_t);
+}
+
+/**
+ * @brief Find \a offset in the sorted value array of a sparse page
+ * @retval index of the first value >= \a offset (insertion point)
+ */
+inline uint16_t
+tt_bitset_page_sparse_lower_bound(struct tt_bitset_page *page, uint16_t offset)
+{
+	const uint16_t *vals = tt_bitset_page_sparse_data(page);
+	uint16_t begin = 0;
+	uint16_t end = page->cardinality;
+	while (begin != end) {
+		uint16_t mid = (begin + end) / 2;
+		if (vals[mid] < offset)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+/** @brief Test a bit in either page representation */
+inline bool
+tt_bitset_page_test_bit(struct tt_bitset_page *page, uint16_t offset)
+{
+	if (!tt_bitset_page_is_sparse(page))
+		return bit_test(tt_bitset_page_data(page), offset);
+	uint16_t i = tt_bitset_page_sparse_lower_bound(page, offset);
+	return i < page->cardinality &&
+	       tt_bitset_page_sparse_data(page)[i] == offset;
+}
+
 inline void
 tt_bitset_page_create(struct tt_bitset_page *page)
 {
+	/* The data accessor needs to know the page is dense. */
+	page->capacity = 0;
 	size_t size = ((char *) tt_bitset_page_data(page) - (char *) page)
 			+ BITSET_PAGE_DATA_SIZE;
 	memset(page, 0, size);
@@ -151,6 +222,11 @@ tt_bitset_page_set_ones(struct tt_bitset_page *page)
 inline void
 tt_bitset_page_and(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 {
+	/*
+	 * A conjunction with a sparse operand is evaluated in the
+	 * array domain, see tt_bitset_iterator_conj_prepare_page().
+	 */
+	assert(!tt_bitset_page_is_sparse(src));
 	tt_bitset_word_t *d = (tt_bitset_word_t *) tt_bitset_page_data(dst);
 	tt_bitset_word_t *s = (tt_bitset_word_t *) tt_bitset_page_data(src);
 
@@ -164,6 +240,12 @@ tt_bitset_page_and(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 inline void
 tt_bitset_page_nand(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 {
+	if (tt_bitset_page_is_sparse(src)) {
+		uint16_t *vals = tt_bitset_page_sparse_data(src);
+		for (size_t i = 0; i < src->cardinality; i++)
+			bit_clear(tt_bitset_page_data(dst), vals[i]);
+		return;
+	}
 	tt_bitset_word_t *d = (tt_bitset_word_t *) tt_bitset_page_data(dst);
 	tt_bitset_word_t *s = (tt_bitset_word_t *) tt_bitset_page_data(src);
 
@@ -177,6 +259,12 @@ tt_bitset_page_nand(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 inline void
 tt_bitset_page_or(struct tt_bitset_page *dst, struct tt_bitset_page *src)
 {
+	if (tt_bitset_page_is_sparse(src)) {
+		uint16_t *vals = tt_bitset_page_sparse_data(src);
+		for (size_t i = 0; i < src->cardinality; i++)
+			bit_set(tt_bitset_page_data(dst), vals[i]);
+		return;
+	}
 	tt_bitset_word_t *d = (tt_bitset_word_t *) tt_bitset_page_data(dst);
 	tt_bitset_word_t *s = (tt_bitset_word_t *) tt_bitset_page_data(src);
 
@@ -108,6 +108,145 @@ coll_bin_cmp(const char *s, size_t slen, const char *t, size_t tlen,
 	return res;
 }
 
+/* {{{ ICU sort key cache */
+
+enum {
+	/** Number of slots in the per-thread sort key cache. */
+	COLL_SORTKEY_CACHE_SIZE = 2048,
+	/** Longest cacheable source string. */
+	COLL_SORTKEY_STR_MAX = 64,
+	/** Capacity reserved for one cached sort key. */
+	COLL_SORTKEY_KEY_MAX = 128,
+};
+
+/** A cached ICU sort key of one (collation, string) pair. */
+struct coll_sortkey_entry {
+	/** Collation the key was built with. */
+	const struct coll *coll;
+	/** Value of coll_generation at fill time. */
+	uint64_t generation;
+	/** Hash of the source string, seeded by the collation. */
+	uint32_t hash;
+	/** Source string length. */
+	uint32_t str_len;
+	/** Sort key length. */
+	uint32_t key_len;
+	/** Source string bytes, to verify a hit exactly. */
+	char str[COLL_SORTKEY_STR_MAX];
+	/** The sort key. */
+	char key[COLL_SORTKEY_KEY_MAX];
+};
+
+/**
+ * Direct-mapped per-thread cache of ICU sort keys. Comparisons
+ * run in the tx thread and in vinyl worker threads, so the cache
+ * is thread-local rather than locked.
+ */
+static __thread struct coll_sortkey_entry *coll_sortkey_cache = NULL;
+
+/**
+ * Bumped whenever a collation is freed. Entries remember the
+ * value they were filled under, so a new collation reusing the
+ * freed address cannot produce a stale hit in any thread.
+ */
+static uint64_t coll_generation = 0;
+
+/**
+ * Build the complete sort key of a UTF8 string.
+ * @retval >= 0 sort key length.
+ * @retval -1 the key does not fit into @a buf_len or ICU failed;
+ *         the caller should fall back to ucol_strcoll.
+ */
+static int
+coll_icu_sort_key(const struct coll *coll, const char *s, size_t s_len,
+		  char *buf, size_t buf_len)
+{
+	UCharIterator itr;
+	uiter_setUTF8(&itr, s, s_len);
+	uint32_t state[2] = {0, 0};
+	UErrorCode status = U_ZERO_ERROR;
+	int32_t got = ucol_nextSortKeyPart(coll->collator, &itr, state,
+					   (uint8_t *) buf, buf_len, &status);
+	if (U_FAILURE(status) || got >= (int32_t) buf_len)
+		return -1;
+	return got;
+}
+
+/**
+ * Look up the sort key of a string, filling the slot on a miss.
+ * @retval NULL the string is not cacheable, fall back to
+ *         ucol_strcoll.
+ */
+static struct coll_sortkey_entry *
+coll_sortkey_cache_get(const struct coll *coll, const char *s, size_t s_len)
+{
+	if (s_len > COLL_SORTKEY_STR_MAX)
+		return NULL;
+	if (coll_sortkey_cache == NULL) {
+		coll_sortkey_cache = calloc(COLL_SORTKEY_CACHE_SIZE,
+					    sizeof(*coll_sortkey_cache));
+		if (coll_sortkey_cache == NULL)
+			return NULL;
+	}
+	uint32_t hash = PMurHash32((uint32_t) (uintptr_t) coll, s, s_len);
+	struct coll_sortkey_entry *entry =
+		&coll_sortkey_cache[hash & (COLL_SORTKEY_CACHE_SIZE - 1)];
+	if (entry->coll == coll && entry->generation == coll_generation &&
+	    entry->hash == hash && entry->str_len == s_len &&
+	    memcmp(entry->str, s, s_len) == 0)
+		return entry;
+	int key_len = coll_icu_sort_key(coll, s, s_len, entry->key,
+					sizeof(entry->key));
+	if (key_len < 0) {
+		entry->coll = NULL;
+		return NULL;
+	}
+	entry->coll = coll;
+	entry->generation = coll_generation;
+	entry->hash = hash;
+	entry->str_len = s_len;
+	entry->key_len = key_len;
+	memcpy(entry->str, s, s_len);
+	return entry;
+}
+
+/**
+ * Compare two strings by their cached ICU sort keys: after the
+ * keys are built once, a comparison is a memcmp. Index descent
+ * compares the same pivot strings over and over, which is where
+ * the cache pays for itself. Falls back to ucol_strcoll for
+ * strings too long to cache.
+ */
+static int
+coll_icu_cmp_cached(const char *s, size_t slen, const char *t, size_t tlen,
+		    const struct coll *coll)
+{
+	struct coll_sortkey_entry *entry =
+		coll_sortkey_cache_get(coll, s, slen);
+	if (entry == NULL)
+		return coll_icu_cmp(s, slen, t, tlen, coll);
+	/*
+	 * The cache is direct-mapped, so the second lookup may
+	 * evict the first entry - keep a copy of the first key.
+	 */
+	char skey[COLL_SORTKEY_KEY_MAX];
+	uint32_t skey_len = entry->key_len;
+	memcpy(skey, entry->key, skey_len);
+	entry = coll_sortkey_cache_get(coll, t, tlen);
+	if (entry == NULL)
+		return coll_icu_cmp(s, slen, t, tlen, coll);
+	int res = memcmp(skey, entry->key,
+			 skey_len < entry->key_len ? skey_len :
+			 entry->key_len);
+	if (res != 0)
+		return res < 0 ? -1 : 1;
+	if (skey_len != entry->key_len)
+		return skey_len < entry->key_len ? -1 : 1;
+	return 0;
+}
+
+/* }}} ICU sort key cache */
+
 /** Get a hash of a string using ICU collation. */
 static uint32_t
 coll_icu_hash(const char *s, size_t s_len, uint32_t *ph, uint32_t *pcarry,
@@ -269,7 +408,7 @@ coll_icu_init_cmp(struct coll *coll, const struct coll_def *def)
 			return -1;
 		}
 	}
-	coll->cmp = coll_icu_cmp;
+	coll->cmp = coll_icu_cmp_cached;
 	coll->hash = coll_icu_hash;
 	coll->hint = coll_icu_hint;
 	return 0;
@@ -412,6 +551,8 @@ coll_unref(struct coll *coll)
 		};
 		mh_coll_remove(coll_cache, &node, NULL);
 		ucol_close(coll->collator);
+		/* Invalidate cached sort keys built with this coll. */
+		++coll_generation;
 		free(coll);
 	}
 }
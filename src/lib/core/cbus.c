@@ -31,7 +31,9 @@
 #include "cbus.h"
 
 #include <limits.h>
+#include <pmatomic.h>
 #include "fiber.h"
+#include "flightrec.h"
 #include "trigger.h"
 
 /**
@@ -56,6 +58,23 @@ const char *cbus_stat_strings[CBUS_STAT_LAST] = {
 	"LOCKS",
 };
 
+enum {
+	/** Lower bound for the adaptive cpipe flush threshold. */
+	CPIPE_MAX_INPUT_MIN = 8,
+	/**
+	 * Bounds for the adaptive consumer poll budget, in event
+	 * loop iterations. The floor keeps the cost of a wrong
+	 * guess at a couple of list probes, the cap keeps a
+	 * saturated consumer from monopolizing the loop forever
+	 * without re-checking the timers and the sockets.
+	 */
+	CBUS_ENDPOINT_POLL_MIN = 2,
+	CBUS_ENDPOINT_POLL_MAX = 1024,
+};
+
+/** Period of adaptive max_input re-tuning, in seconds. */
+static const double CPIPE_ADJUST_PERIOD = 1.0;
+
 /**
  * Find a joined cbus endpoint by name.
  * This is an internal helper method which should be called
@@ -94,6 +113,12 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 
 	pipe->n_input = 0;
 	pipe->max_input = INT_MAX;
+	pipe->max_input_cap = INT_MAX;
+	pipe->batch_avg = 0;
+	pipe->adjust_time = 0;
+	pipe->stat_flushes = 0;
+	pipe->stat_messages = 0;
+	pipe->stat_wakeups = 0;
 	pipe->producer = cord()->loop;
 
 	ev_async_init(&pipe->flush_input, cpipe_flush_cb);
@@ -112,6 +137,185 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 	tt_pthread_mutex_unlock(&cbus.mutex);
 }
 
+/**
+ * Append a chain of messages linked from @a first to @a last to
+ * the lock-free ready list of the endpoint. Safe to call from any
+ * producer thread concurrently with other producers and with the
+ * consumer draining the list.
+ */
+static void
+cbus_endpoint_ready_link(struct cbus_endpoint *endpoint,
+			 struct stailq_entry *first,
+			 struct stailq_entry *last)
+{
+	pm_atomic_store_explicit(&last->next, (struct stailq_entry *)NULL,
+				 memory_order_relaxed);
+	struct stailq_entry *prev =
+		pm_atomic_exchange_explicit(&endpoint->ready_last, last,
+					    memory_order_acq_rel);
+	/*
+	 * Publish the new tail. Until this store is done the list
+	 * is torn at @a prev - the consumer handles it by stopping
+	 * the drain and waiting for the notification sent below.
+	 */
+	pm_atomic_store_explicit(&prev->next, first, memory_order_release);
+}
+
+/**
+ * Push a chain of messages to the endpoint and wake up the
+ * consumer unless it has a wakeup pending already. Return true
+ * if the consumer was actually woken up.
+ */
+static bool
+cbus_endpoint_ready_push(struct cbus_endpoint *endpoint,
+			 struct stailq_entry *first,
+			 struct stailq_entry *last)
+{
+	cbus_endpoint_ready_link(endpoint, first, last);
+	if (!pm_atomic_exchange(&endpoint->ready_notified, true)) {
+		/* Count statistics */
+		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
+
+		ev_async_send(endpoint->consumer, &endpoint->async);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Check if the ready list has no messages. Only the stub node is
+ * left in the list once it is fully drained.
+ */
+static bool
+cbus_endpoint_ready_is_empty(struct cbus_endpoint *endpoint)
+{
+	return endpoint->ready_first == &endpoint->ready_stub &&
+	       pm_atomic_load_explicit(&endpoint->ready_stub.next,
+				       memory_order_acquire) == NULL &&
+	       pm_atomic_load_explicit(&endpoint->ready_last,
+				       memory_order_acquire) ==
+	       &endpoint->ready_stub;
+}
+
+/**
+ * Invoked on every loop iteration while the consumer stays in
+ * polling mode, i.e. between a drain and the moment the poll
+ * budget runs out. Re-checks the ready list and either hands the
+ * new messages over to the endpoint callback or, once the budget
+ * expires empty, puts the endpoint back to sleep on the async
+ * watcher.
+ */
+static void
+cbus_endpoint_poll_cb(ev_loop *loop, ev_idle *watcher, int events)
+{
+	(void)events;
+	struct cbus_endpoint *endpoint = watcher->data;
+	if (!cbus_endpoint_ready_is_empty(endpoint)) {
+		/*
+		 * The poll paid off: an eventfd write and an epoll
+		 * wakeup were saved. Raise the budget - the traffic
+		 * is dense enough for polling - unless the current
+		 * grant has not been spent on a single empty
+		 * iteration yet, which means it is already ample.
+		 */
+		if (endpoint->poll_budget < endpoint->poll_budget_max &&
+		    endpoint->poll_budget_max < CBUS_ENDPOINT_POLL_MAX)
+			endpoint->poll_budget_max *= 2;
+		ev_invoke(loop, &endpoint->async, EV_CUSTOM);
+		return;
+	}
+	if (--endpoint->poll_budget > 0)
+		return;
+	/* The budget expired empty: the traffic has dried up. */
+	endpoint->poll_budget_max /= 2;
+	if (endpoint->poll_budget_max < CBUS_ENDPOINT_POLL_MIN)
+		endpoint->poll_budget_max = CBUS_ENDPOINT_POLL_MIN;
+	ev_idle_stop(loop, watcher);
+	/*
+	 * Producers have been skipping the wakeup syscall while
+	 * the poll was active. Clear the flag and re-check the
+	 * list: a message linked in after the emptiness check
+	 * above would otherwise be stranded until an unrelated
+	 * wakeup.
+	 */
+	(void)pm_atomic_exchange(&endpoint->ready_notified, false);
+	if (!cbus_endpoint_ready_is_empty(endpoint))
+		ev_invoke(loop, &endpoint->async, EV_CUSTOM);
+}
+
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	bool fetched = false;
+	/*
+	 * Consume the pending wakeup before draining the list: a
+	 * producer pushing right after this point will send a new
+	 * one. The exchange also synchronizes with the exchange in
+	 * cbus_endpoint_ready_push() and so makes the pushed
+	 * messages visible to this thread.
+	 */
+	(void)pm_atomic_exchange(&endpoint->ready_notified, false);
+	while (true) {
+		struct stailq_entry *first = endpoint->ready_first;
+		struct stailq_entry *next =
+			pm_atomic_load_explicit(&first->next,
+						memory_order_acquire);
+		if (first == &endpoint->ready_stub) {
+			/* The list is empty. */
+			if (next == NULL)
+				break;
+			/* Skip the stub node. */
+			endpoint->ready_first = next;
+			continue;
+		}
+		if (next != NULL) {
+			endpoint->ready_first = next;
+			stailq_add_tail(output, first);
+			fetched = true;
+			continue;
+		}
+		if (first != pm_atomic_load_explicit(&endpoint->ready_last,
+						     memory_order_acquire)) {
+			/*
+			 * A producer has updated the tail, but has
+			 * not linked its chain in yet. It will send
+			 * a wakeup once it is done, so the message
+			 * is not lost - bail out for now.
+			 */
+			break;
+		}
+		/*
+		 * The last message: push the stub back so the list
+		 * never becomes empty, then pop the message.
+		 */
+		cbus_endpoint_ready_link(endpoint, &endpoint->ready_stub,
+					 &endpoint->ready_stub);
+		next = pm_atomic_load_explicit(&first->next,
+					       memory_order_acquire);
+		if (next == NULL)
+			break;
+		endpoint->ready_first = next;
+		stailq_add_tail(output, first);
+		fetched = true;
+	}
+	if (!fetched)
+		return;
+	/*
+	 * Messages have just arrived, so more are likely on the
+	 * way - keep polling the ready list for a while instead of
+	 * going straight back to sleep: under heavy traffic the
+	 * next batch lands sooner than the eventfd + epoll wakeup
+	 * round trip costs. Leave ready_notified set so producers
+	 * skip the wakeup syscall meanwhile - the poll watcher
+	 * re-checks the list itself and restores the flag when the
+	 * budget runs out (see cbus_endpoint_poll_cb()).
+	 */
+	pm_atomic_store(&endpoint->ready_notified, true);
+	endpoint->poll_budget = endpoint->poll_budget_max;
+	if (!ev_is_active(&endpoint->poll))
+		ev_idle_start(endpoint->consumer, &endpoint->poll);
+}
+
 struct cmsg_poison {
 	struct cmsg msg;
 	struct cbus_endpoint *endpoint;
@@ -156,20 +360,17 @@ cpipe_destroy(struct cpipe *pipe)
 	 * delivered.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
-	/* Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
-	pipe->n_input = 0;
 	/* Add the pipe shutdown message as the last one. */
-	stailq_add_tail_entry(&endpoint->output, poison, msg.fifo);
-	/* Count statistics */
-	rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
+	stailq_add_tail_entry(&pipe->input, poison, msg.fifo);
+	pipe->n_input = 0;
 	/*
 	 * Keep the lock for the duration of ev_async_send():
 	 * this will avoid a race condition between
 	 * ev_async_send() and execution of the poison
 	 * message, after which the endpoint may disappear.
 	 */
-	ev_async_send(endpoint->consumer, &endpoint->async);
+	cbus_endpoint_ready_push(endpoint, stailq_first(&pipe->input),
+				 stailq_last(&pipe->input));
 	tt_pthread_mutex_unlock(&endpoint->mutex);
 
 	tt_pthread_setcancelstate(old_cancel_state, NULL);
@@ -227,11 +428,18 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	endpoint->n_pipes = 0;
 	fiber_cond_create(&endpoint->cond);
 	tt_pthread_mutex_init(&endpoint->mutex, NULL);
-	stailq_create(&endpoint->output);
+	endpoint->ready_stub.next = NULL;
+	endpoint->ready_first = &endpoint->ready_stub;
+	endpoint->ready_last = &endpoint->ready_stub;
+	endpoint->ready_notified = false;
 	ev_async_init(&endpoint->async,
 		      (void (*)(ev_loop *, struct ev_async *, int)) fetch_cb);
 	endpoint->async.data = fetch_data;
 	ev_async_start(endpoint->consumer, &endpoint->async);
+	ev_idle_init(&endpoint->poll, cbus_endpoint_poll_cb);
+	endpoint->poll.data = endpoint;
+	endpoint->poll_budget = 0;
+	endpoint->poll_budget_max = CBUS_ENDPOINT_POLL_MIN;
 
 	rlist_add_tail(&cbus.endpoints, &endpoint->in_cbus);
 	tt_pthread_mutex_unlock(&cbus.mutex);
@@ -261,7 +469,8 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	while (true) {
 		if (process_cb)
 			process_cb(endpoint);
-		if (endpoint->n_pipes == 0 && stailq_empty(&endpoint->output))
+		if (endpoint->n_pipes == 0 &&
+		    cbus_endpoint_ready_is_empty(endpoint))
 			break;
 		 fiber_cond_wait(&endpoint->cond);
 	}
@@ -273,6 +482,7 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
 	tt_pthread_mutex_destroy(&endpoint->mutex);
+	ev_idle_stop(endpoint->consumer, &endpoint->poll);
 	ev_async_stop(endpoint->consumer, &endpoint->async);
 	fiber_cond_destroy(&endpoint->cond);
 	TRASH(endpoint);
@@ -282,7 +492,6 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 static void
 cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 {
-	(void) loop;
 	(void) events;
 	struct cpipe *pipe = (struct cpipe *) watcher->data;
 	struct cbus_endpoint *endpoint = pipe->endpoint;
@@ -290,8 +499,6 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 		return;
 
 	trigger_run(&pipe->on_flush, pipe);
-	/* Trigger task processing when the queue becomes non-empty. */
-	bool output_was_empty;
 
 	/*
 	 * We need to set a thread cancellation guard, because
@@ -304,21 +511,50 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	int old_cancel_state;
 	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancel_state);
 
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	output_was_empty = stailq_empty(&endpoint->output);
 	/** Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-
+	int n_input = pipe->n_input;
+	if (cbus_endpoint_ready_push(endpoint, stailq_first(&pipe->input),
+				     stailq_last(&pipe->input)))
+		pipe->stat_wakeups++;
+	stailq_create(&pipe->input);
 	pipe->n_input = 0;
-	if (output_was_empty) {
-		/* Count statistics */
-		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 
-		ev_async_send(endpoint->consumer, &endpoint->async);
+	tt_pthread_setcancelstate(old_cancel_state, NULL);
+
+	pipe->stat_flushes++;
+	pipe->stat_messages += n_input;
+	/*
+	 * Re-tune the immediate flush threshold from the batch
+	 * sizes observed on this pipe: heavy traffic raises the
+	 * threshold so that messages are delivered in larger
+	 * batches with fewer consumer wakeups, light traffic
+	 * lowers it back towards the floor to keep the latency
+	 * of occasional messages low. The once-per-loop flush
+	 * (see cpipe_push()) bounds the staging delay in either
+	 * case.
+	 */
+	pipe->batch_avg += ((double)n_input - pipe->batch_avg) / 4;
+	if (pipe->max_input_cap != INT_MAX) {
+		double now = ev_monotonic_now(loop);
+		if (now - pipe->adjust_time >= CPIPE_ADJUST_PERIOD) {
+			pipe->adjust_time = now;
+			int max_input = (int)(pipe->batch_avg * 2);
+			if (max_input < CPIPE_MAX_INPUT_MIN)
+				max_input = CPIPE_MAX_INPUT_MIN;
+			if (max_input > pipe->max_input_cap)
+				max_input = pipe->max_input_cap;
+			pipe->max_input = max_input;
+		}
 	}
+}
 
-	tt_pthread_setcancelstate(old_cancel_state, NULL);
+void
+cpipe_stat(struct cpipe *pipe, struct cpipe_stat *stat)
+{
+	stat->flushes = pipe->stat_flushes;
+	stat->messages = pipe->stat_messages;
+	stat->wakeups = pipe->stat_wakeups;
+	stat->max_input = pipe->max_input;
 }
 
 void
@@ -652,9 +888,16 @@ cbus_process(struct cbus_endpoint *endpoint)
 	struct stailq output;
 	stailq_create(&output);
 	cbus_endpoint_fetch(endpoint, &output);
+	if (stailq_empty(&output))
+		return;
+	flightrec_record(FLIGHTREC_CBUS_PROCESS_BEGIN, 0);
+	uint64_t count = 0;
 	struct cmsg *msg, *msg_next;
-	stailq_foreach_entry_safe(msg, msg_next, &output, fifo)
+	stailq_foreach_entry_safe(msg, msg_next, &output, fifo) {
 		cmsg_deliver(msg);
+		count++;
+	}
+	flightrec_record(FLIGHTREC_CBUS_PROCESS_END, count);
 }
 
 void
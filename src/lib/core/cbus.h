@@ -121,6 +121,24 @@ struct cpipe {
 	 * latency, while still keeping the bus mutex cold enough).
 	 */
 	int max_input;
+	/**
+	 * Upper bound for the adaptive @a max_input, as set by
+	 * cpipe_set_max_input(). INT_MAX disables adaptation.
+	 */
+	int max_input_cap;
+	/**
+	 * Moving average of messages per input flush, used to
+	 * re-tune @a max_input once a second.
+	 */
+	double batch_avg;
+	/** Time of the last max_input adjustment. */
+	double adjust_time;
+	/** Number of input flushes since creation. */
+	uint64_t stat_flushes;
+	/** Number of messages flushed since creation. */
+	uint64_t stat_messages;
+	/** Number of consumer wakeups paid by this pipe. */
+	uint64_t stat_wakeups;
 	/**
 	 * Rather than flushing input into the pipe
 	 * whenever a single message or a batch is
@@ -158,6 +176,26 @@ cpipe_create(struct cpipe *pipe, const char *consumer);
 void
 cpipe_destroy(struct cpipe *pipe);
 
+/** Delivery statistics of a cpipe. */
+struct cpipe_stat {
+	/** Number of input flushes since creation. */
+	uint64_t flushes;
+	/** Number of messages flushed since creation. */
+	uint64_t messages;
+	/** Number of consumer wakeups paid by this pipe. */
+	uint64_t wakeups;
+	/** Current adaptive flush threshold. */
+	int max_input;
+};
+
+/**
+ * Fetch delivery statistics of @a pipe into @a stat. May be
+ * called from any thread: the counters are read without locks
+ * and may be slightly stale.
+ */
+void
+cpipe_stat(struct cpipe *pipe, struct cpipe_stat *stat);
+
 /**
  * Set pipe max size of staged push area. The default is infinity.
  * If staged push cap is set, the pushed messages are flushed
@@ -165,15 +203,16 @@ cpipe_destroy(struct cpipe *pipe);
  * per event loop.
  * Otherwise, the messages flushed once per event loop iteration.
  *
- * @todo: collect bus stats per second and adjust max_input once
- * a second to keep the mutex cold regardless of the message load,
- * while still keeping the latency low if there are few
- * long-to-process messages.
+ * Setting a cap also enables adaptive batching: the effective
+ * flush threshold is re-tuned once a second from the average
+ * batch size observed on the pipe, never exceeding the cap (see
+ * cpipe_flush_cb()).
  */
 static inline void
 cpipe_set_max_input(struct cpipe *pipe, int max_input)
 {
 	pipe->max_input = max_input;
+	pipe->max_input_cap = max_input;
 }
 
 static inline void
@@ -258,14 +297,49 @@ struct cbus_endpoint {
 	char name[FIBER_NAME_MAX];
 	/** Member of cbus->endpoints */
 	struct rlist in_cbus;
-	/** The lock around the pipe. */
+	/**
+	 * The lock around pipe shutdown. The hot path -
+	 * cpipe_flush_cb() - appends messages to the ready list
+	 * below with a lock-free exchange and never takes it.
+	 */
 	pthread_mutex_t mutex;
-	/** A queue with incoming messages. */
-	struct stailq output;
+	/**
+	 * Lock-free multi-producer/single-consumer list of
+	 * incoming messages, linked via cmsg->fifo. ready_last
+	 * points to the most recently pushed entry, ready_first
+	 * is the consumer position. The list is never left empty:
+	 * when it is drained, ready_stub is pushed back to it.
+	 */
+	struct stailq_entry *ready_last;
+	struct stailq_entry *ready_first;
+	struct stailq_entry ready_stub;
+	/**
+	 * Set when the consumer has a pending wakeup to drain the
+	 * ready list, cleared when a drain starts. Keeps it down
+	 * to one wakeup per drain instead of one per batch.
+	 */
+	bool ready_notified;
 	/** Consumer cord loop */
 	ev_loop *consumer;
 	/** Async to notify the consumer */
 	ev_async async;
+	/**
+	 * Keeps the consumer loop from blocking for a while after
+	 * a drain so that the next batch can be picked up without
+	 * an eventfd + epoll round trip. While it is active
+	 * producers skip the wakeup syscall: ready_notified stays
+	 * set and the watcher re-checks the list itself.
+	 */
+	ev_idle poll;
+	/** Empty poll iterations left before going back to sleep. */
+	int poll_budget;
+	/**
+	 * Poll budget granted after a drain. Self-tuned: grows
+	 * while polling keeps finding messages, decays back to
+	 * the floor when the budget expires empty, so an idle
+	 * endpoint pays almost nothing for the fast path.
+	 */
+	int poll_budget_max;
 	/** Count of connected pipes */
 	uint32_t n_pipes;
 	/** Condition for endpoint destroy */
@@ -275,13 +349,8 @@ struct cbus_endpoint {
 /**
  * Fetch incomming messages to output
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
 
 /** Initialize the global singleton bus. */
 void
@@ -93,6 +93,140 @@ decimal_check_status(decimal_t *dec, decContext *context)
 	return status || !decNumberIsFinite(dec) ? NULL : dec;
 }
 
+/* {{{ Fixed-point fast path.
+ *
+ * decNumber keeps the coefficient in a radix-10^DECDPUN digit
+ * array and runs a school-book loop over it for every operation,
+ * which dominates profiles of workloads doing millions of small
+ * decimal adds and compares. A decimal whose coefficient fits 18
+ * digits is exactly representable as a scaled int64, so addition,
+ * subtraction, multiplication and comparison can run as native
+ * integer arithmetic. Any overflow - of the coefficient, of the
+ * exponent alignment shift - falls back to the generic decNumber
+ * code, so results are bit for bit the same as without the fast
+ * path: with at most 19 significant digits no rounding can occur
+ * at DECIMAL_MAX_DIGITS precision.
+ */
+
+/** Max digits of a coefficient taken on the fast path. */
+enum { DECIMAL_FIXED_DIGITS_MAX = 18 };
+
+static const int64_t decimal_pow10[DECIMAL_FIXED_DIGITS_MAX + 1] = {
+	1LL,
+	10LL,
+	100LL,
+	1000LL,
+	10000LL,
+	100000LL,
+	1000000LL,
+	10000000LL,
+	100000000LL,
+	1000000000LL,
+	10000000000LL,
+	100000000000LL,
+	1000000000000LL,
+	10000000000000LL,
+	100000000000000LL,
+	1000000000000000LL,
+	10000000000000000LL,
+	100000000000000000LL,
+	1000000000000000000LL,
+};
+
+/**
+ * Read a decimal coefficient into a signed 64 bit integer.
+ * @retval false the coefficient has too many digits to fit.
+ */
+static inline bool
+decimal_fixed_get(const decimal_t *dec, int64_t *coeff)
+{
+	if (dec->digits > DECIMAL_FIXED_DIGITS_MAX)
+		return false;
+	int nunits = (dec->digits + DECDPUN - 1) / DECDPUN;
+	int64_t c = 0;
+	for (int i = nunits - 1; i >= 0; i--)
+		c = c * decimal_pow10[DECDPUN] + dec->lsu[i];
+	/* Keep -0 on the generic path: its sign must survive. */
+	if (c == 0 && decNumberIsNegative(dec))
+		return false;
+	*coeff = decNumberIsNegative(dec) ? -c : c;
+	return true;
+}
+
+/** Assemble a decimal from a signed coefficient and an exponent. */
+static void
+decimal_fixed_set(decimal_t *dec, int64_t coeff, int32_t exponent)
+{
+	uint64_t c;
+	if (coeff < 0) {
+		dec->bits = DECNEG;
+		c = (uint64_t)-coeff;
+	} else {
+		dec->bits = 0;
+		c = (uint64_t)coeff;
+	}
+	dec->exponent = exponent;
+	uint64_t base = (uint64_t)decimal_pow10[DECDPUN];
+	int nunits = 0;
+	do {
+		dec->lsu[nunits++] = (decNumberUnit)(c % base);
+		c /= base;
+	} while (c != 0);
+	int32_t top = dec->lsu[nunits - 1];
+	int topdigits = 1;
+	while (top >= 10) {
+		top /= 10;
+		topdigits++;
+	}
+	dec->digits = DECDPUN * (nunits - 1) + topdigits;
+}
+
+/**
+ * Bring two scaled integers to a common exponent, which is the
+ * smaller of the two. @retval false if the required shift does
+ * not fit an int64, fall back to decNumber then.
+ */
+static inline bool
+decimal_fixed_align(int64_t *a, int32_t ea, int64_t *b, int32_t eb)
+{
+	int32_t shift = ea - eb;
+	if (shift > 0) {
+		if (shift > DECIMAL_FIXED_DIGITS_MAX ||
+		    __builtin_mul_overflow(*a, decimal_pow10[shift], a))
+			return false;
+	} else if (shift < 0) {
+		if (-shift > DECIMAL_FIXED_DIGITS_MAX ||
+		    __builtin_mul_overflow(*b, decimal_pow10[-shift], b))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Try to compute lhs + rhs natively, with rhs negated for
+ * subtraction. @retval false on any overflow, the caller
+ * falls back to decNumber.
+ */
+static bool
+decimal_fixed_add(decimal_t *res, const decimal_t *lhs,
+		  const decimal_t *rhs, bool negate_rhs)
+{
+	int64_t a, b;
+	if (!decimal_fixed_get(lhs, &a) || !decimal_fixed_get(rhs, &b))
+		return false;
+	if (negate_rhs)
+		b = -b;
+	if (!decimal_fixed_align(&a, lhs->exponent, &b, rhs->exponent))
+		return false;
+	int64_t sum;
+	if (__builtin_add_overflow(a, b, &sum))
+		return false;
+	decimal_fixed_set(res, sum, MIN(lhs->exponent, rhs->exponent));
+	return true;
+}
+
+/* }}} */
+
 int decimal_precision(const decimal_t *dec) {
 	return dec->exponent <= 0 ? MAX(dec->digits, -dec->exponent) :
 				    dec->digits + dec->exponent;
@@ -199,6 +333,10 @@ decimal_to_uint64(const decimal_t *dec, uint64_t *num)
 int
 decimal_compare(const decimal_t *lhs, const decimal_t *rhs)
 {
+	int64_t a, b;
+	if (decimal_fixed_get(lhs, &a) && decimal_fixed_get(rhs, &b) &&
+	    decimal_fixed_align(&a, lhs->exponent, &b, rhs->exponent))
+		return a < b ? -1 : a > b;
 	decNumber res;
 	decNumberCompare(&res, lhs, rhs, &decimal_context);
 	int r = decNumberToInt32(&res, &decimal_context);
@@ -297,6 +435,8 @@ decimal_minus(decimal_t *res, const decimal_t *dec)
 decimal_t *
 decimal_add(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	if (decimal_fixed_add(res, lhs, rhs, false))
+		return res;
 	decNumberAdd(res, lhs, rhs, &decimal_context);
 	return decimal_check_status(res, &decimal_context);
 }
@@ -304,6 +444,8 @@ decimal_add(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 decimal_t *
 decimal_sub(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	if (decimal_fixed_add(res, lhs, rhs, true))
+		return res;
 	decNumberSubtract(res, lhs, rhs, &decimal_context);
 
 	return decimal_check_status(res, &decimal_context);
@@ -312,6 +454,17 @@ decimal_sub(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 decimal_t *
 decimal_mul(decimal_t *res, const decimal_t *lhs, const decimal_t *rhs)
 {
+	int64_t a, b, product;
+	if (decimal_fixed_get(lhs, &a) && decimal_fixed_get(rhs, &b) &&
+	    !__builtin_mul_overflow(a, b, &product)) {
+		decimal_fixed_set(res, product,
+				  lhs->exponent + rhs->exponent);
+		/* decNumber gives a multiplicative zero the xored sign. */
+		if (product == 0 &&
+		    decNumberIsNegative(lhs) != decNumberIsNegative(rhs))
+			res->bits = DECNEG;
+		return res;
+	}
 	decNumberMultiply(res, lhs, rhs, &decimal_context);
 
 	return decimal_check_status(res, &decimal_context);
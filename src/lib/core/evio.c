@@ -401,6 +401,41 @@ evio_service_bind(struct evio_service *service, const char *uri)
 	return -1;
 }
 
+void
+evio_service_attach(struct evio_service *service,
+		    const struct evio_service *master)
+{
+	assert(!ev_is_active(&service->ev));
+	assert(evio_service_is_active(master));
+	strcpy(service->host, master->host);
+	strcpy(service->serv, master->serv);
+	service->addrstorage = master->addrstorage;
+	service->addr_len = master->addr_len;
+	/*
+	 * Duplicate the acceptor socket: each event loop needs
+	 * its own file descriptor so that stopping one watcher
+	 * does not affect the others.
+	 */
+	int fd = dup(master->ev.fd);
+	if (fd < 0)
+		panic_syserror("failed to duplicate acceptor socket");
+	ev_io_set(&service->ev, fd, EV_READ);
+	ev_io_start(service->loop, &service->ev);
+}
+
+void
+evio_service_detach(struct evio_service *service)
+{
+	if (ev_is_active(&service->ev)) {
+		ev_io_stop(service->loop, &service->ev);
+		service->addr_len = 0;
+	}
+	if (service->ev.fd >= 0) {
+		close(service->ev.fd);
+		ev_io_set(&service->ev, -1, 0);
+	}
+}
+
 /** It's safe to stop a service which is not started yet. */
 void
 evio_service_stop(struct evio_service *service)
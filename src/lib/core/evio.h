@@ -117,6 +117,24 @@ evio_service_bind(struct evio_service *service, const char *uri);
 int
 evio_service_listen(struct evio_service *service);
 
+/**
+ * Share the acceptor socket of a bound and listening master
+ * service. The service starts accepting connections on its own
+ * event loop using a duplicate of the master's file descriptor.
+ * Use evio_service_detach() to stop such a service: the bound
+ * address is owned by the master.
+ */
+void
+evio_service_attach(struct evio_service *service,
+		    const struct evio_service *master);
+
+/**
+ * Stop accepting and close the duplicated acceptor socket without
+ * releasing the bound address (no unix socket path unlink).
+ */
+void
+evio_service_detach(struct evio_service *service);
+
 /** If started, stop event flow and close the acceptor socket. */
 void
 evio_service_stop(struct evio_service *service);
@@ -93,12 +93,57 @@ static const struct method_info exception_methods[] = {
 const struct type_info type_Exception = make_type("Exception", NULL,
 	exception_methods);
 
+enum {
+	/**
+	 * Unified capacity of a pooled exception block. All
+	 * exception classes are the bare struct error plus a
+	 * few scalar members, so one kilobyte covers any of
+	 * them.
+	 */
+	EXC_POOL_OBJ_SIZE = 1024,
+	/**
+	 * Flow control errors like ER_TUPLE_NOT_FOUND are
+	 * created and destroyed millions of times per hour,
+	 * but only a handful of them is alive at any moment.
+	 */
+	EXC_POOL_CAPACITY = 16,
+};
+
+/**
+ * Block header remembering the allocation capacity, padded so
+ * that the object behind it stays suitably aligned.
+ */
+union exc_block_header {
+	size_t capacity;
+	long double pad;
+};
+
+/**
+ * A thread-local free list of exception blocks. Blocks are
+ * pushed by whichever thread destroys the error, so they may
+ * migrate between cords, but both malloc() and free() are
+ * thread-safe and the pool itself is never shared.
+ */
+static __thread void *exc_pool[EXC_POOL_CAPACITY];
+static __thread int exc_pool_count = 0;
+
 void *
 Exception::operator new(size_t size)
 {
-	void *buf = malloc(size);
-	if (buf != NULL)
-		return buf;
+	union exc_block_header *header;
+	if (size <= EXC_POOL_OBJ_SIZE) {
+		if (exc_pool_count > 0) {
+			header = (union exc_block_header *)
+				exc_pool[--exc_pool_count];
+			return header + 1;
+		}
+		size = EXC_POOL_OBJ_SIZE;
+	}
+	header = (union exc_block_header *) malloc(sizeof(*header) + size);
+	if (header != NULL) {
+		header->capacity = size;
+		return header + 1;
+	}
 	diag_set_error(diag_get(), &out_of_memory);
 	throw &out_of_memory;
 }
@@ -106,7 +151,15 @@ Exception::operator new(size_t size)
 void
 Exception::operator delete(void *ptr)
 {
-	free(ptr);
+	if (ptr == (void *) &out_of_memory)
+		return;
+	union exc_block_header *header = (union exc_block_header *) ptr - 1;
+	if (header->capacity == EXC_POOL_OBJ_SIZE &&
+	    exc_pool_count < EXC_POOL_CAPACITY) {
+		exc_pool[exc_pool_count++] = header;
+		return;
+	}
+	free(header);
 }
 
 Exception::~Exception()
@@ -39,6 +39,7 @@
 #include <pmatomic.h>
 
 #include "assoc.h"
+#include "flightrec.h"
 #include "memory.h"
 #include "trigger.h"
 #include "errinj.h"
@@ -221,6 +222,7 @@ static inline void
 clock_set_on_csw(struct fiber *caller)
 {
 	caller->csw++;
+	flightrec_csw();
 
 #if ENABLE_FIBER_TOP
 	if (!fiber_top_enabled)
@@ -556,6 +558,20 @@ fiber_is_cancelled()
 	return fiber()->flags & FIBER_IS_CANCELLED;
 }
 
+void
+fiber_set_deadline(double deadline)
+{
+	fiber()->deadline = deadline;
+}
+
+bool
+fiber_deadline_is_reached(void)
+{
+	struct fiber *f = fiber();
+	return f->deadline != 0 &&
+	       ev_monotonic_now(loop()) > f->deadline;
+}
+
 void
 fiber_set_joinable(struct fiber *fiber, bool yesno)
 {
@@ -828,6 +844,7 @@ fiber_reset(struct fiber *fiber)
 	rlist_create(&fiber->on_yield);
 	rlist_create(&fiber->on_stop);
 	fiber->flags = FIBER_DEFAULT_FLAGS;
+	fiber->deadline = 0;
 #if ENABLE_FIBER_TOP
 	clock_stat_reset(&fiber->clock_stat);
 #endif /* ENABLE_FIBER_TOP */
@@ -850,6 +867,7 @@ fiber_recycle(struct fiber *fiber)
 	memset(&fiber->storage, 0, sizeof(fiber->storage));
 	unregister_fid(fiber);
 	fiber->fid = 0;
+	fiber->gc_profile = NULL;
 	region_free(&fiber->gc);
 	if (!has_custom_stack) {
 		rlist_move_entry(&cord()->dead, fiber, link);
@@ -1010,11 +1028,18 @@ fiber_stack_recycle(struct fiber *fiber)
 	}
 
 	/*
-	 * Ignore errors on MADV_DONTNEED because this is
-	 * just a hint for OS and not critical for
-	 * functionality.
+	 * Ignore madvise() errors because this is just a hint
+	 * for OS and not critical for functionality. Prefer
+	 * MADV_FREE where available: the kernel then reclaims
+	 * the pages lazily, under memory pressure only, so a
+	 * recycled fiber that dirties its stack again does not
+	 * pay for a fresh zero page per touched page.
 	 */
+#ifdef HAVE_MADV_FREE
+	fiber_madvise(start, end - start, MADV_FREE);
+#else
 	fiber_madvise(start, end - start, MADV_DONTNEED);
+#endif
 	stack_put_watermark(fiber->stack_watermark);
 }
 
@@ -1162,6 +1187,18 @@ fiber_stack_create(struct fiber *fiber, struct slab_cache *slabc,
 		return -1;
 	}
 
+#ifdef MADV_NOHUGEPAGE
+	/*
+	 * Keep transparent huge pages off fiber stacks even when
+	 * the system runs with transparent_hugepage=always: stacks
+	 * are small, split by the guard page and recycled with
+	 * MADV_DONTNEED/MADV_FREE, so a 2MB page here only wastes
+	 * memory and defeats the recycling. Just a hint, ignore
+	 * errors.
+	 */
+	fiber_madvise(fiber->stack, fiber->stack_size, MADV_NOHUGEPAGE);
+#endif
+
 	fiber_stack_watermark_create(fiber);
 	return 0;
 }
@@ -1400,6 +1437,21 @@ cord_create(struct cord *cord, const char *name)
 	}
 #endif /* ENABLE_FIBER_TOP */
 	cord_set_name(name);
+	flightrec_cord_create(name);
+
+	/*
+	 * A cord mostly works with memory it faulted in itself:
+	 * the tx thread touches the memtx arena, WAL and net
+	 * threads touch their own slab caches over the runtime
+	 * arena. Local binding makes those pages node-local on
+	 * NUMA machines instead of landing wherever the first
+	 * toucher happened to run.
+	 */
+	memory_bind_local();
+	int numa_node = memory_numa_node();
+	if (numa_node >= 0)
+		say_debug("cord '%s' is running on NUMA node %d",
+			  name, numa_node);
 
 #if ENABLE_ASAN
 	/* Record stack extents */
@@ -1418,6 +1470,7 @@ cord_create(struct cord *cord, const char *name)
 void
 cord_destroy(struct cord *cord)
 {
+	flightrec_cord_destroy();
 	slab_cache_set_thread(&cord->slabc);
 	if (cord->loop)
 		ev_loop_destroy(cord->loop);
@@ -1748,3 +1801,16 @@ int fiber_stat(fiber_stat_cb cb, void *cb_ctx)
 	}
 	return 0;
 }
+
+void
+fiber_cache_stat(struct fiber_cache_stat *stat)
+{
+	struct fiber *fiber;
+	struct cord *cord = cord();
+	stat->idle = 0;
+	stat->stack_size = 0;
+	rlist_foreach_entry(fiber, &cord->dead, link) {
+		stat->idle++;
+		stat->stack_size += fiber->stack_size;
+	}
+}
@@ -348,6 +348,22 @@ fiber_sleep(double s);
 API_EXPORT bool
 fiber_is_cancelled();
 
+/**
+ * Set a deadline for the current fiber: a monotonic time after
+ * which fiber_deadline_is_reached() starts returning true. Pass 0
+ * to clear it. The deadline is purely cooperative - long running
+ * loops are expected to poll it and abort their work, nothing
+ * interrupts the fiber by force.
+ */
+API_EXPORT void
+fiber_set_deadline(double deadline);
+
+/**
+ * True if the current fiber has a deadline and it has passed.
+ */
+API_EXPORT bool
+fiber_deadline_is_reached(void);
+
 /**
  * Report loop begin time as double (cheap).
  * Uses real time clock.
@@ -417,6 +433,7 @@ struct txn;
 struct credentials;
 struct lua_State;
 struct ipc_wait_pad;
+struct region_profile;
 
 struct fiber {
 	coro_context ctx;
@@ -443,6 +460,12 @@ struct fiber {
 	unsigned int stack_id;
 	/* A garbage-collected memory pool. */
 	struct region gc;
+	/**
+	 * Region retention profile of the gc region, set by the
+	 * subsystem the fiber works for. NULL means the default
+	 * fiber_gc() policy. See box/region_profile.h.
+	 */
+	struct region_profile *gc_profile;
 	/**
 	 * The fiber which should be scheduled when
 	 * this fiber yields.
@@ -515,6 +538,13 @@ struct fiber {
 	} storage;
 	/** An object to wait for incoming message or a reader. */
 	struct ipc_wait_pad *wait_pad;
+	/**
+	 * Monotonic time after which the fiber should give up on
+	 * its current piece of work, 0 if none. Like cancellation,
+	 * the deadline is cooperative: it has effect only where
+	 * the code checks fiber_deadline_is_reached().
+	 */
+	double deadline;
 	/** Exception which caused this fiber's death. */
 	struct diag diag;
 	/**
@@ -727,6 +757,17 @@ typedef int (*fiber_stat_cb)(struct fiber *f, void *ctx);
 int
 fiber_stat(fiber_stat_cb cb, void *cb_ctx);
 
+/** Occupancy of the cord's cache of recycled fibers. */
+struct fiber_cache_stat {
+	/** Number of fibers retained for reuse. */
+	int idle;
+	/** Stack bytes retained by the idle fibers. */
+	size_t stack_size;
+};
+
+void
+fiber_cache_stat(struct fiber_cache_stat *stat);
+
 #if ENABLE_FIBER_TOP
 bool
 fiber_top_is_enabled();
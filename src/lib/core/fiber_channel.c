@@ -474,3 +474,136 @@ fiber_channel_get_msg_timeout(struct fiber_channel *ch,
 		timeout -= ev_monotonic_now(loop()) - start_time;
 	}
 }
+
+ssize_t
+fiber_channel_put_batch_msg_timeout(struct fiber_channel *ch,
+				    struct ipc_msg **msgs, uint32_t count,
+				    ev_tstamp timeout)
+{
+	ssize_t done = 0;
+	while ((uint32_t)done < count) {
+		if (fiber_channel_has_readers(ch)) {
+			/* See fiber_channel_put_msg_timeout(). */
+			assert(ch->count == 0);
+			assert(ch->is_closed == false);
+			struct fiber *f = rlist_first_entry(&ch->waiters,
+							    struct fiber,
+							    state);
+			f->wait_pad->msg = msgs[done];
+			fiber_channel_waiter_wakeup(f, FIBER_CHANNEL_WAIT_DONE);
+			done++;
+			continue;
+		}
+		if (ch->count < ch->size) {
+			if (ch->is_closed) {
+				if (done > 0)
+					break;
+				diag_set(ChannelIsClosed);
+				return -1;
+			}
+			fiber_channel_buffer_push(ch, msgs[done]);
+			done++;
+			continue;
+		}
+		/*
+		 * The channel is full. Deliver what fit as a
+		 * partial batch rather than yield mid-batch; wait
+		 * only if not a single message went through.
+		 */
+		if (done > 0)
+			break;
+		if (fiber_channel_put_msg_timeout(ch, msgs[0], timeout) != 0)
+			return -1;
+		done = 1;
+	}
+	return done;
+}
+
+ssize_t
+fiber_channel_put_batch_timeout(struct fiber_channel *ch,
+				void **data, uint32_t count,
+				ev_tstamp timeout)
+{
+	ssize_t done = 0;
+	while ((uint32_t)done < count) {
+		struct ipc_value *value = ipc_value_new();
+		if (value == NULL)
+			return done > 0 ? done : -1;
+		value->data = data[done];
+		struct ipc_msg *msg = &value->base;
+		/* Wait for the first message only. */
+		ssize_t rc = fiber_channel_put_batch_msg_timeout(ch, &msg, 1,
+						done == 0 ? timeout : 0);
+		if (rc < 0) {
+			ipc_value_delete(msg);
+			return done > 0 ? done : -1;
+		}
+		done++;
+	}
+	return done;
+}
+
+ssize_t
+fiber_channel_get_batch_msg_timeout(struct fiber_channel *ch,
+				    struct ipc_msg **msgs, uint32_t capacity,
+				    ev_tstamp timeout)
+{
+	if (capacity == 0)
+		return 0;
+	/* Wait for the first message only. */
+	if (fiber_channel_get_msg_timeout(ch, &msgs[0], timeout) != 0)
+		return -1;
+	ssize_t done = 1;
+	while ((uint32_t)done < capacity) {
+		if (ch->count > 0) {
+			msgs[done++] = fiber_channel_buffer_pop(ch);
+			/*
+			 * Move a waiting writer, if any, to the
+			 * freed buffer slot to preserve delivery
+			 * order, see fiber_channel_get_msg_timeout().
+			 */
+			if (fiber_channel_has_writers(ch)) {
+				struct fiber *f =
+					rlist_first_entry(&ch->waiters,
+							  struct fiber,
+							  state);
+				fiber_channel_buffer_push(ch,
+							  f->wait_pad->msg);
+				fiber_channel_waiter_wakeup(f,
+					FIBER_CHANNEL_WAIT_DONE);
+			}
+			continue;
+		}
+		if (fiber_channel_has_writers(ch)) {
+			/* An unbuffered channel, see the single get. */
+			assert(ch->size == 0);
+			struct fiber *f = rlist_first_entry(&ch->waiters,
+							    struct fiber,
+							    state);
+			msgs[done++] = f->wait_pad->msg;
+			fiber_channel_waiter_wakeup(f, FIBER_CHANNEL_WAIT_DONE);
+			continue;
+		}
+		break;
+	}
+	return done;
+}
+
+ssize_t
+fiber_channel_get_batch_timeout(struct fiber_channel *ch,
+				void **data, uint32_t capacity,
+				ev_tstamp timeout)
+{
+	ssize_t done = 0;
+	while ((uint32_t)done < capacity) {
+		struct ipc_value *value;
+		ssize_t rc = fiber_channel_get_batch_msg_timeout(ch,
+					(struct ipc_msg **)&value, 1,
+					done == 0 ? timeout : 0);
+		if (rc < 0)
+			return done > 0 ? done : -1;
+		data[done++] = value->data;
+		ipc_value_delete(&value->base);
+	}
+	return done;
+}
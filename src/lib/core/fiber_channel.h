@@ -32,6 +32,7 @@
  */
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
 #include <tarantool_ev.h>
 #include "small/rlist.h"
 
@@ -276,6 +277,33 @@ fiber_channel_put(struct fiber_channel *ch, void *data)
 	return fiber_channel_put_timeout(ch, data, TIMEOUT_INFINITY);
 }
 
+/**
+ * Put a batch of messages into a channel in one call.
+ *
+ * Messages are handed to waiting readers and then buffered until
+ * either the whole batch is delivered or the channel runs out of
+ * space: a partial batch is delivered without waiting, so a
+ * producer never yields in the middle of a batch. Only when not
+ * a single message can be delivered does the call wait for the
+ * first one like fiber_channel_put_msg_timeout() and then
+ * continue without waiting.
+ *
+ * @retval >= 1 the number of messages delivered, the caller
+ *         keeps ownership of the rest
+ * @retval -1 timeout or the channel is closed, no message is
+ *         delivered
+ */
+ssize_t
+fiber_channel_put_batch_msg_timeout(struct fiber_channel *ch,
+				    struct ipc_msg **msgs, uint32_t count,
+				    ev_tstamp timeout);
+
+/** @copydoc fiber_channel_put_batch_msg_timeout() */
+ssize_t
+fiber_channel_put_batch_timeout(struct fiber_channel *ch,
+				void **data, uint32_t count,
+				ev_tstamp timeout);
+
 /**
  * Get a message from the channel, or time out.
  * The caller is responsible for message destruction.
@@ -305,6 +333,30 @@ fiber_channel_get_timeout(struct fiber_channel *ch,
 			void **data,
 			ev_tstamp timeout);
 
+/**
+ * Get a batch of messages from a channel in one call.
+ *
+ * Waits for the first message like
+ * fiber_channel_get_msg_timeout(), then drains buffered messages
+ * and messages of waiting writers without yielding, up to
+ * @a capacity in total. A consumer woken up once thus collects
+ * everything a batching producer has delivered.
+ *
+ * @retval >= 1 the number of messages fetched, the caller is
+ *         responsible for their destruction
+ * @retval -1 timeout or the channel is closed
+ */
+ssize_t
+fiber_channel_get_batch_msg_timeout(struct fiber_channel *ch,
+				    struct ipc_msg **msgs, uint32_t capacity,
+				    ev_tstamp timeout);
+
+/** @copydoc fiber_channel_get_batch_msg_timeout() */
+ssize_t
+fiber_channel_get_batch_timeout(struct fiber_channel *ch,
+				void **data, uint32_t capacity,
+				ev_tstamp timeout);
+
 /**
  * Fetch a message from the channel. Yields current fiber if the
  * channel is empty.
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "flightrec.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+#include "fiber.h"
+#include "say.h"
+#include "small/rlist.h"
+
+enum {
+	/** Ring capacity per cord, must be a power of two. */
+	FLIGHTREC_EVENT_MAX = 4096,
+	/** At most this many events are printed per cord. */
+	FLIGHTREC_DUMP_MAX = 128,
+};
+
+/** Minimal interval between automatic dumps, in seconds. */
+static const double FLIGHTREC_AUTODUMP_INTERVAL = 1.0;
+
+double flightrec_slice_threshold = 0.1;
+
+struct flightrec_event {
+	/** clock_monotonic() timestamp of the event. */
+	double time;
+	enum flightrec_event_type type;
+	/** Id of the fiber that recorded the event. */
+	uint32_t fid;
+	/** Event type specific payload. */
+	uint64_t arg;
+};
+
+struct flightrec {
+	/** Name of the owning cord, for the dump. */
+	char name[FIBER_NAME_MAX];
+	/**
+	 * Total number of recorded events. The write position is
+	 * count % FLIGHTREC_EVENT_MAX.
+	 */
+	uint64_t count;
+	/** Start of the current fiber slice. */
+	double slice_start;
+	/** Time of the last automatic dump. */
+	double last_autodump;
+	/** Link in the registry. */
+	struct rlist in_registry;
+	struct flightrec_event events[FLIGHTREC_EVENT_MAX];
+};
+
+static const char *flightrec_event_strs[] = {
+	"journal_wait_begin",
+	"journal_wait_end",
+	"cbus_process_begin",
+	"cbus_process_end",
+	"long_slice",
+};
+
+static __thread struct flightrec *flightrec_thread = NULL;
+
+/**
+ * Registry of all cord rings, guarded by a mutex. Recording
+ * never takes it - only registration, unregistration and dump
+ * do.
+ */
+static struct rlist flightrec_registry =
+	RLIST_HEAD_INITIALIZER(flightrec_registry);
+static pthread_mutex_t flightrec_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+flightrec_cord_create(const char *name)
+{
+	assert(flightrec_thread == NULL);
+	struct flightrec *fr = calloc(1, sizeof(*fr));
+	if (fr == NULL)
+		return;
+	snprintf(fr->name, sizeof(fr->name), "%s", name);
+	fr->slice_start = clock_monotonic();
+	pthread_mutex_lock(&flightrec_registry_mutex);
+	rlist_add_tail_entry(&flightrec_registry, fr, in_registry);
+	pthread_mutex_unlock(&flightrec_registry_mutex);
+	flightrec_thread = fr;
+}
+
+void
+flightrec_cord_destroy(void)
+{
+	struct flightrec *fr = flightrec_thread;
+	if (fr == NULL)
+		return;
+	flightrec_thread = NULL;
+	pthread_mutex_lock(&flightrec_registry_mutex);
+	rlist_del_entry(fr, in_registry);
+	pthread_mutex_unlock(&flightrec_registry_mutex);
+	free(fr);
+}
+
+void
+flightrec_record(enum flightrec_event_type type, uint64_t arg)
+{
+	struct flightrec *fr = flightrec_thread;
+	if (fr == NULL)
+		return;
+	struct flightrec_event *event =
+		&fr->events[fr->count % FLIGHTREC_EVENT_MAX];
+	event->time = clock_monotonic();
+	event->type = type;
+	event->fid = fiber()->fid;
+	event->arg = arg;
+	fr->count++;
+}
+
+/** Print the most recent events of a ring to the log. */
+static void
+flightrec_dump_one(struct flightrec *fr, double now)
+{
+	uint64_t total = fr->count;
+	uint64_t n = total;
+	if (n > FLIGHTREC_EVENT_MAX)
+		n = FLIGHTREC_EVENT_MAX;
+	if (n > FLIGHTREC_DUMP_MAX)
+		n = FLIGHTREC_DUMP_MAX;
+	say_info("flightrec: cord '%s', %llu events total, last %llu:",
+		 fr->name, (unsigned long long)total, (unsigned long long)n);
+	for (uint64_t i = total - n; i < total; i++) {
+		struct flightrec_event *event =
+			&fr->events[i % FLIGHTREC_EVENT_MAX];
+		say_info("flightrec:   %-+10.6fs %-20s fid=%u arg=%llu",
+			 event->time - now,
+			 flightrec_event_strs[event->type], event->fid,
+			 (unsigned long long)event->arg);
+	}
+}
+
+void
+flightrec_dump(void)
+{
+	double now = clock_monotonic();
+	pthread_mutex_lock(&flightrec_registry_mutex);
+	struct flightrec *fr;
+	rlist_foreach_entry(fr, &flightrec_registry, in_registry)
+		flightrec_dump_one(fr, now);
+	pthread_mutex_unlock(&flightrec_registry_mutex);
+}
+
+void
+flightrec_csw(void)
+{
+	struct flightrec *fr = flightrec_thread;
+	if (fr == NULL)
+		return;
+	double now = clock_monotonic();
+	double slice = now - fr->slice_start;
+	fr->slice_start = now;
+	if (slice < flightrec_slice_threshold)
+		return;
+	flightrec_record(FLIGHTREC_LONG_SLICE,
+			 (uint64_t)(slice * 1000000));
+	if (now - fr->last_autodump >= FLIGHTREC_AUTODUMP_INTERVAL) {
+		fr->last_autodump = now;
+		say_warn("fiber %u ran for %.3f s without yielding",
+			 fiber()->fid, slice);
+		flightrec_dump_one(fr, now);
+	}
+}
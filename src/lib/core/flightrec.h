@@ -0,0 +1,109 @@
+#ifndef TARANTOOL_LIB_CORE_FLIGHTREC_H_INCLUDED
+#define TARANTOOL_LIB_CORE_FLIGHTREC_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/*
+ * The flight recorder is an always-on, low-overhead timeline of
+ * what each cord was doing over the last few seconds: a
+ * per-thread ring buffer of timestamped events. When a latency
+ * spike hits, the rings can be dumped to the log on demand or
+ * automatically - a long non-yielding fiber slice triggers a
+ * dump of the offending cord's ring.
+ *
+ * Recording is strictly thread-local and lock-free. Dumping a
+ * foreign cord's ring reads it without synchronization: a torn
+ * event at the write position is possible and harmless for a
+ * diagnostic timeline.
+ */
+
+enum flightrec_event_type {
+	/** A fiber started waiting for a journal write. */
+	FLIGHTREC_JOURNAL_WAIT_BEGIN,
+	/** The journal write completed, the fiber resumed. */
+	FLIGHTREC_JOURNAL_WAIT_END,
+	/** A batch of cbus messages entered delivery. */
+	FLIGHTREC_CBUS_PROCESS_BEGIN,
+	/** Delivery of the batch finished, arg = message count. */
+	FLIGHTREC_CBUS_PROCESS_END,
+	/**
+	 * A fiber ran without yielding for longer than
+	 * flightrec_slice_threshold, arg = duration in usec.
+	 */
+	FLIGHTREC_LONG_SLICE,
+	flightrec_event_type_MAX,
+};
+
+/**
+ * A fiber slice longer than this many seconds is recorded as a
+ * FLIGHTREC_LONG_SLICE event and triggers an automatic dump of
+ * the cord's ring (rate limited to one per second).
+ */
+extern double flightrec_slice_threshold;
+
+/**
+ * Create the calling thread's ring buffer and register it for
+ * dumping. Called by cord_create(). Best effort: on OOM the cord
+ * simply records nothing.
+ */
+void
+flightrec_cord_create(const char *name);
+
+/** Unregister and free the calling thread's ring buffer. */
+void
+flightrec_cord_destroy(void);
+
+/** Record an event into the calling thread's ring. */
+void
+flightrec_record(enum flightrec_event_type type, uint64_t arg);
+
+/**
+ * Account a context switch: close the current fiber slice and
+ * record it if it was suspiciously long. Called by the fiber
+ * scheduler on every switch.
+ */
+void
+flightrec_csw(void);
+
+/** Dump the recent events of all registered cords to the log. */
+void
+flightrec_dump(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_FLIGHTREC_H_INCLUDED */
@@ -0,0 +1,370 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "iouring.h"
+
+#include "trivia/config.h"
+#include "say.h"
+#include "fio.h"
+#include "trivia/util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_IO_URING_H)
+
+#include <pmatomic.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+enum {
+	/**
+	 * Queue depth. The ring is used synchronously with at
+	 * most two requests in flight (a write and a linked
+	 * fsync), so it can be tiny.
+	 */
+	IOURING_DEPTH = 4,
+};
+
+/** Completion cookies to tell a write CQE from an fsync CQE. */
+enum {
+	IOURING_UDATA_WRITE = 1,
+	IOURING_UDATA_FSYNC = 2,
+};
+
+struct iouring {
+	/** Ring file descriptor. */
+	int fd;
+	/** Submission queue entry array mapping. */
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	/** Submission ring mapping and its hot pointers. */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	/** Completion ring mapping and its hot pointers. */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+void
+iouring_delete(struct iouring *ring)
+{
+	if (ring == NULL)
+		return;
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != NULL)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring != NULL)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+	free(ring);
+}
+
+struct iouring *
+iouring_new(void)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = sys_io_uring_setup(IOURING_DEPTH, &params);
+	if (fd < 0) {
+		say_syserror("io_uring_setup");
+		return NULL;
+	}
+	struct iouring *ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		close(fd);
+		return NULL;
+	}
+	ring->fd = fd;
+	ring->sq_ring_size = params.sq_off.array +
+			     params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes +
+			     params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size,
+			     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			     fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = NULL;
+		goto fail;
+	}
+	ring->cq_ring = mmap(NULL, ring->cq_ring_size,
+			     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			     fd, IORING_OFF_CQ_RING);
+	if (ring->cq_ring == MAP_FAILED) {
+		ring->cq_ring = NULL;
+		goto fail;
+	}
+	ring->sqes = mmap(NULL, ring->sqes_size,
+			  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			  fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		goto fail;
+	}
+	char *sq = ring->sq_ring;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	char *cq = ring->cq_ring;
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	return ring;
+fail:
+	say_syserror("io_uring mmap");
+	iouring_delete(ring);
+	return NULL;
+}
+
+/** Grab the next free SQE and fill in the common fields. */
+static struct io_uring_sqe *
+iouring_get_sqe(struct iouring *ring, unsigned tail, uint8_t opcode,
+		int fd, uint64_t user_data)
+{
+	unsigned index = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->user_data = user_data;
+	ring->sq_array[index] = index;
+	return sqe;
+}
+
+/**
+ * Submit @a to_submit prepared SQEs. Returns 0 on success, -1 if
+ * the kernel rejected the submission.
+ */
+static int
+iouring_submit(struct iouring *ring, unsigned tail, unsigned to_submit)
+{
+	/* Publish the new tail to the kernel. */
+	pm_atomic_store_explicit(ring->sq_tail, tail,
+				 pm_memory_order_release);
+	while (true) {
+		int rc = sys_io_uring_enter(ring->fd, to_submit, 0, 0);
+		if (rc == (int)to_submit)
+			return 0;
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc >= 0) {
+			/* Can't happen with a ring this shallow. */
+			to_submit -= rc;
+			continue;
+		}
+		say_syserror("io_uring_enter");
+		return -1;
+	}
+}
+
+/** Wait for a single completion and pop it off the CQ ring. */
+static int
+iouring_wait(struct iouring *ring, uint64_t *user_data, ssize_t *res)
+{
+	while (true) {
+		unsigned head = *ring->cq_head;
+		unsigned tail = pm_atomic_load_explicit(
+			ring->cq_tail, pm_memory_order_acquire);
+		if (head != tail) {
+			struct io_uring_cqe *cqe =
+				&ring->cqes[head & *ring->cq_mask];
+			*user_data = cqe->user_data;
+			*res = cqe->res;
+			pm_atomic_store_explicit(ring->cq_head, head + 1,
+						 pm_memory_order_release);
+			return 0;
+		}
+		if (sys_io_uring_enter(ring->fd, 0, 1,
+				       IORING_ENTER_GETEVENTS) < 0 &&
+		    errno != EINTR) {
+			say_syserror("io_uring_enter");
+			return -1;
+		}
+	}
+}
+
+/** Advance an iov array past @a n written bytes. */
+static void
+iouring_advance_iov(struct iovec **iov, int *iovcnt, size_t n)
+{
+	while (n > 0) {
+		if ((*iov)->iov_len <= n) {
+			n -= (*iov)->iov_len;
+			(*iov)++;
+			(*iovcnt)--;
+		} else {
+			(*iov)->iov_base = (char *)(*iov)->iov_base + n;
+			(*iov)->iov_len -= n;
+			n = 0;
+		}
+	}
+}
+
+ssize_t
+iouring_writevn_sync(struct iouring *ring, int fd, struct iovec *iov,
+		     int iovcnt, off_t offset, bool with_fsync)
+{
+	assert(iov && iovcnt >= 0);
+	ssize_t total = 0;
+	bool need_fsync = with_fsync;
+	while (iovcnt > 0 || need_fsync) {
+		unsigned tail = *ring->sq_tail;
+		unsigned to_submit = 0;
+		if (iovcnt > 0) {
+			struct io_uring_sqe *sqe =
+				iouring_get_sqe(ring, tail, IORING_OP_WRITEV,
+						fd, IOURING_UDATA_WRITE);
+			sqe->addr = (uint64_t)(uintptr_t)iov;
+			sqe->len = iovcnt;
+			sqe->off = offset + total;
+			/*
+			 * Don't start the fsync until the write
+			 * has fully completed.
+			 */
+			if (need_fsync)
+				sqe->flags |= IOSQE_IO_LINK;
+			tail++;
+			to_submit++;
+		}
+		if (need_fsync) {
+			struct io_uring_sqe *sqe =
+				iouring_get_sqe(ring, tail, IORING_OP_FSYNC,
+						fd, IOURING_UDATA_FSYNC);
+			sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+			tail++;
+			to_submit++;
+		}
+		if (iouring_submit(ring, tail, to_submit) != 0)
+			return -1;
+		bool failed = false;
+		for (unsigned i = 0; i < to_submit; i++) {
+			uint64_t user_data;
+			ssize_t res;
+			if (iouring_wait(ring, &user_data, &res) != 0)
+				return -1;
+			if (user_data == IOURING_UDATA_WRITE) {
+				if (res >= 0) {
+					total += res;
+					iouring_advance_iov(&iov, &iovcnt,
+							    res);
+				} else if (res != -EINTR && res != -EAGAIN) {
+					errno = -res;
+					say_syserror("io_uring writev, [%s]",
+						     fio_filename(fd));
+					failed = true;
+				}
+			} else {
+				assert(user_data == IOURING_UDATA_FSYNC);
+				if (res == 0) {
+					need_fsync = false;
+				} else if (res != -ECANCELED) {
+					/*
+					 * -ECANCELED means the
+					 * linked write fell short
+					 * and the sync will be
+					 * re-submitted with the
+					 * write remainder.
+					 */
+					errno = -res;
+					say_syserror("io_uring fsync, [%s]",
+						     fio_filename(fd));
+					failed = true;
+				}
+			}
+		}
+		if (failed)
+			return -1;
+	}
+	return total;
+}
+
+#else /* !defined(HAVE_IO_URING_H) */
+
+struct iouring *
+iouring_new(void)
+{
+	errno = ENOSYS;
+	say_syserror("io_uring is not supported on this platform");
+	return NULL;
+}
+
+void
+iouring_delete(struct iouring *ring)
+{
+	assert(ring == NULL);
+	(void)ring;
+}
+
+ssize_t
+iouring_writevn_sync(struct iouring *ring, int fd, struct iovec *iov,
+		     int iovcnt, off_t offset, bool with_fsync)
+{
+	(void)ring;
+	(void)fd;
+	(void)iov;
+	(void)iovcnt;
+	(void)offset;
+	(void)with_fsync;
+	unreachable();
+	return -1;
+}
+
+#endif /* defined(HAVE_IO_URING_H) */
@@ -0,0 +1,89 @@
+#ifndef TARANTOOL_LIB_CORE_IOURING_H_INCLUDED
+#define TARANTOOL_LIB_CORE_IOURING_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * A minimal io_uring wrapper for batched file writes.
+ *
+ * Unlike the generic asynchronous I/O helpers (coio, eio), this
+ * module is synchronous by design: a caller submits a write,
+ * optionally linked with an fdatasync, and blocks until both
+ * complete. The point is not asynchrony but syscall batching -
+ * an entire writev + fdatasync pair costs a single
+ * io_uring_enter(2) instead of two system calls, which matters
+ * for the WAL thread where the write + sync path dominates
+ * commit latency on fast storage.
+ */
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct iouring;
+
+/**
+ * Create a ring. Returns NULL if the kernel has no io_uring
+ * support (or on any other error); the reason is logged. A ring
+ * may only be used from the thread that created it.
+ */
+struct iouring *
+iouring_new(void);
+
+/** Destroy a ring. Safe to call with NULL. */
+void
+iouring_delete(struct iouring *ring);
+
+/**
+ * Write @a iovcnt vectors to @a fd at @a offset, re-trying
+ * partial writes. If @a with_fsync is set, an fdatasync is
+ * submitted as an SQE linked to the write, so that both are
+ * handed to the kernel in one system call and the sync is not
+ * started until the write completes.
+ *
+ * The iov array is modified in the case of a partial write,
+ * like in fio_writevn().
+ *
+ * @retval >= 0 the number of bytes written
+ * @retval -1   write or sync error, logged to the error log
+ */
+ssize_t
+iouring_writevn_sync(struct iouring *ring, int fd, struct iovec *iov,
+		     int iovcnt, off_t offset, bool with_fsync);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_IOURING_H_INCLUDED */
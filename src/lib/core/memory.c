@@ -29,8 +29,14 @@
  * SUCH DAMAGE.
  */
 #include "memory.h"
+#include "say.h"
 #include "small/quota.h"
 
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
 struct slab_arena runtime;
 
 void
@@ -46,6 +52,33 @@ memory_init()
 			  SLAB_SIZE, SLAB_ARENA_PRIVATE);
 }
 
+void
+memory_bind_local(void)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	/*
+	 * MPOL_PREFERRED with an empty node mask means "allocate
+	 * on the node of the faulting thread". The constant is
+	 * from <linux/mempolicy.h>, which is not worth dragging
+	 * in for a single value.
+	 */
+	enum { MPOL_PREFERRED = 1 };
+	if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, NULL, 0) != 0)
+		say_syserror("set_mempolicy");
+#endif
+}
+
+int
+memory_numa_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return node;
+#endif
+	return -1;
+}
+
 void
 memory_free()
 {
@@ -50,6 +50,25 @@ memory_init();
 
 void
 memory_free();
+
+/**
+ * Bind the memory policy of the calling thread to its local NUMA
+ * node: every page the thread faults in is allocated on the node
+ * the thread is running on. Slab arenas only reserve address
+ * space, the pages are faulted in by the thread which uses them,
+ * so a bound thread gets node-local slabs without any help from
+ * the allocator. A no-op on platforms without a memory policy
+ * syscall.
+ */
+void
+memory_bind_local(void);
+
+/**
+ * NUMA node the calling thread is currently running on,
+ * -1 if unknown.
+ */
+int
+memory_numa_node(void);
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "mempool_registry.h"
+
+#include <stdlib.h>
+
+#include <small/mempool.h>
+#include <small/rlist.h>
+
+/** A single named pool in the registry. */
+struct mempool_registry_entry {
+	/** Name the pool was registered under. Not owned. */
+	const char *name;
+	/** The registered pool. */
+	struct mempool *pool;
+	/**
+	 * Max used byte count seen by the registry. Updated each
+	 * time the statistics are collected.
+	 */
+	size_t max_used;
+	/** Link in the registry list. */
+	struct rlist link;
+};
+
+/** List of all registered pools. */
+static RLIST_HEAD(mempool_registry);
+
+void
+mempool_registry_add(struct mempool *pool, const char *name)
+{
+	struct mempool_registry_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		/*
+		 * The registry serves diagnostics only so there
+		 * is no point in failing the caller - the pool
+		 * will work fine, just anonymously.
+		 */
+		return;
+	}
+	entry->name = name;
+	entry->pool = pool;
+	entry->max_used = 0;
+	rlist_add_tail_entry(&mempool_registry, entry, link);
+}
+
+void
+mempool_registry_remove(struct mempool *pool)
+{
+	struct mempool_registry_entry *entry;
+	rlist_foreach_entry(entry, &mempool_registry, link) {
+		if (entry->pool == pool) {
+			rlist_del_entry(entry, link);
+			free(entry);
+			return;
+		}
+	}
+}
+
+int
+mempool_registry_foreach(mempool_registry_f cb, void *cb_ctx)
+{
+	struct mempool_registry_entry *entry;
+	rlist_foreach_entry(entry, &mempool_registry, link) {
+		struct mempool_stats stats;
+		mempool_stats(entry->pool, &stats);
+		if (stats.totals.used > entry->max_used)
+			entry->max_used = stats.totals.used;
+		int rc = cb(entry->name, &stats, entry->max_used, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef TARANTOOL_LIB_CORE_MEMPOOL_REGISTRY_H_INCLUDED
+#define TARANTOOL_LIB_CORE_MEMPOOL_REGISTRY_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct mempool;
+struct mempool_stats;
+
+/**
+ * Registry of named mempools for memory attribution.
+ *
+ * A mempool by itself is anonymous: slab cache statistics show
+ * how much memory is consumed, but not by whom. Subsystems that
+ * want their pools to show up in memory introspection register
+ * them here under a human-readable name.
+ *
+ * The registry is not thread safe - it is supposed to keep pools
+ * of a single thread (in tarantool, the tx thread). Per-thread
+ * pools of auxiliary threads are not covered.
+ */
+
+/**
+ * Register a mempool under the given name. The name is not
+ * copied and must outlive the registration (a string literal).
+ * Registration is best-effort: on memory allocation failure the
+ * pool is simply left unregistered.
+ */
+void
+mempool_registry_add(struct mempool *pool, const char *name);
+
+/**
+ * Remove a mempool from the registry. The pool doesn't have to
+ * be registered - unknown pools are silently ignored so that
+ * callers may unregister unconditionally on shutdown.
+ */
+void
+mempool_registry_remove(struct mempool *pool);
+
+/**
+ * Callback invoked by mempool_registry_foreach() for each
+ * registered pool. @max_used is the highest used byte count
+ * observed at collection points (not a true allocation-time
+ * high watermark). Returning non-zero stops the iteration.
+ */
+typedef int
+(*mempool_registry_f)(const char *name, const struct mempool_stats *stats,
+		      size_t max_used, void *cb_ctx);
+
+/**
+ * Invoke a callback for every registered pool with its current
+ * statistics.
+ *
+ * @retval 0 All pools visited.
+ * @retval non-zero The value returned by the callback that
+ *                  stopped the iteration.
+ */
+int
+mempool_registry_foreach(mempool_registry_f cb, void *cb_ctx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_MEMPOOL_REGISTRY_H_INCLUDED */
@@ -42,6 +42,7 @@
 enum mp_extension_type {
     MP_UNKNOWN_EXTENSION = 0,
     MP_DECIMAL = 1,
+    MP_UUID = 2,
 };
 
 #endif
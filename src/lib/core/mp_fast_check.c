@@ -0,0 +1,119 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "mp_fast_check.h"
+
+#include <stdint.h>
+#include <msgpuck.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Do not descend into containers nested deeper than this,
+ * delegate the whole subtree to mp_check() instead.
+ */
+enum { MP_FAST_CHECK_DEPTH_MAX = 32 };
+
+static int
+mp_fast_check_r(const char **data, const char *end, int depth)
+{
+	if (depth >= MP_FAST_CHECK_DEPTH_MAX)
+		return mp_check(data, end);
+	const char *p = *data;
+	if (p >= end)
+		return 1;
+	/*
+	 * Decode the container header by hand: mp_check() would
+	 * walk the whole subtree. The element count is 64 bit so
+	 * that a map count does not overflow when doubled.
+	 */
+	uint64_t count;
+	uint8_t c = (uint8_t)*p;
+	switch (mp_typeof(*p)) {
+	case MP_ARRAY:
+		if ((c == 0xdc && end - p < 3) || (c == 0xdd && end - p < 5))
+			return 1;
+		count = mp_decode_array(&p);
+		break;
+	case MP_MAP:
+		if ((c == 0xde && end - p < 3) || (c == 0xdf && end - p < 5))
+			return 1;
+		count = 2 * (uint64_t)mp_decode_map(&p);
+		break;
+	default:
+		return mp_check(data, end);
+	}
+	while (count > 0) {
+		if (p >= end)
+			return 1;
+#if defined(__SSE2__)
+		if (count >= 16 && end - p >= 16) {
+			/*
+			 * A byte encodes a fixint iff its signed
+			 * value is >= -32: 0x00..0x7f are positive
+			 * and 0xe0..0xff are negative fixints.
+			 * Each such byte is a complete element.
+			 */
+			__m128i chunk =
+				_mm_loadu_si128((const __m128i *)p);
+			int mask = _mm_movemask_epi8(
+				_mm_cmplt_epi8(chunk, _mm_set1_epi8(-32)));
+			if (mask == 0) {
+				p += 16;
+				count -= 16;
+				continue;
+			}
+			/* Consume the leading fixint run. */
+			int run = __builtin_ctz(mask);
+			p += run;
+			count -= run;
+		}
+#endif
+		int rc;
+		enum mp_type type = mp_typeof(*p);
+		if (type == MP_ARRAY || type == MP_MAP)
+			rc = mp_fast_check_r(&p, end, depth + 1);
+		else
+			rc = mp_check(&p, end);
+		if (rc != 0)
+			return rc;
+		count--;
+	}
+	*data = p;
+	return 0;
+}
+
+int
+mp_fast_check(const char **data, const char *end)
+{
+	return mp_fast_check_r(data, end, 0);
+}
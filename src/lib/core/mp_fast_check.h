@@ -0,0 +1,62 @@
+#ifndef TARANTOOL_LIB_CORE_MP_FAST_CHECK_INCLUDED
+#define TARANTOOL_LIB_CORE_MP_FAST_CHECK_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * \brief Validate a msgpack object the same way mp_check() does,
+ * but classify runs of single-byte fixints 16 bytes at a time
+ * with SSE2 when possible. Tuples are commonly flat arrays of
+ * small integers, for which the plain byte-at-a-time walker is
+ * the bottleneck.
+ *
+ * Arrays and maps are descended into so that fixint runs are
+ * found at any nesting level; any other element is delegated to
+ * mp_check(). Without SSE2 this is equivalent to mp_check().
+ *
+ * \param data - the start of the msgpack buffer, advanced past
+ *		 the validated object on success
+ * \param end - the end of the msgpack buffer
+ * \retval 0 when the object is valid
+ * \retval != 0 when the object is invalid or truncated
+ */
+int
+mp_fast_check(const char **data, const char *end);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_MP_FAST_CHECK_INCLUDED */
@@ -78,72 +78,6 @@ mpstream_init(struct mpstream *stream, void *ctx,
     mpstream_reset(stream);
 }
 
-void
-mpstream_encode_array(struct mpstream *stream, uint32_t size)
-{
-    assert(mp_sizeof_array(size) <= 5);
-    char *data = mpstream_reserve(stream, 5);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_array(data, size);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_map(struct mpstream *stream, uint32_t size)
-{
-    assert(mp_sizeof_map(size) <= 5);
-    char *data = mpstream_reserve(stream, 5);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_map(data, size);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_uint(struct mpstream *stream, uint64_t num)
-{
-    assert(mp_sizeof_uint(num) <= 9);
-    char *data = mpstream_reserve(stream, 9);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_uint(data, num);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_int(struct mpstream *stream, int64_t num)
-{
-    assert(mp_sizeof_int(num) <= 9);
-    char *data = mpstream_reserve(stream, 9);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_int(data, num);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_float(struct mpstream *stream, float num)
-{
-    assert(mp_sizeof_float(num) <= 5);
-    char *data = mpstream_reserve(stream, 5);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_float(data, num);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_double(struct mpstream *stream, double num)
-{
-    assert(mp_sizeof_double(num) <= 9);
-    char *data = mpstream_reserve(stream, 9);
-    char *pos = mp_encode_double(data, num);
-    if (data == NULL)
-        return;
-    mpstream_advance(stream, pos - data);
-}
-
 void
 mpstream_encode_strn(struct mpstream *stream, const char *str, uint32_t len)
 {
@@ -155,28 +89,6 @@ mpstream_encode_strn(struct mpstream *stream, const char *str, uint32_t len)
     mpstream_advance(stream, pos - data);
 }
 
-void
-mpstream_encode_nil(struct mpstream *stream)
-{
-    assert(mp_sizeof_nil() <= 1);
-    char *data = mpstream_reserve(stream, 1);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_nil(data);
-    mpstream_advance(stream, pos - data);
-}
-
-void
-mpstream_encode_bool(struct mpstream *stream, bool val)
-{
-    assert(mp_sizeof_bool(val) <= 1);
-    char *data = mpstream_reserve(stream, 1);
-    if (data == NULL)
-        return;
-    char *pos = mp_encode_bool(data, val);
-    mpstream_advance(stream, pos - data);
-}
-
 void
 mpstream_encode_binl(struct mpstream *stream, uint32_t len)
 {
@@ -33,6 +33,7 @@
 
 #include "diag.h"
 #include "decimal.h"
+#include "msgpuck.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -101,23 +102,102 @@ mpstream_advance(struct mpstream *stream, size_t size)
 	stream->pos += size;
 }
 
-void
-mpstream_encode_array(struct mpstream *stream, uint32_t size);
+/*
+ * Encoders of fixed-bound scalars are defined inline: they are
+ * called once per field in row encoding loops, where an
+ * out-of-line call per scalar costs more than the encoding
+ * itself. The reserve fast path is a single comparison, so a
+ * whole row is usually encoded into one flat chunk without
+ * leaving the loop.
+ */
 
-void
-mpstream_encode_map(struct mpstream *stream, uint32_t size);
+static inline void
+mpstream_encode_array(struct mpstream *stream, uint32_t size)
+{
+	assert(mp_sizeof_array(size) <= 5);
+	char *data = mpstream_reserve(stream, 5);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_array(data, size);
+	mpstream_advance(stream, pos - data);
+}
 
-void
-mpstream_encode_uint(struct mpstream *stream, uint64_t num);
+static inline void
+mpstream_encode_map(struct mpstream *stream, uint32_t size)
+{
+	assert(mp_sizeof_map(size) <= 5);
+	char *data = mpstream_reserve(stream, 5);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_map(data, size);
+	mpstream_advance(stream, pos - data);
+}
 
-void
-mpstream_encode_int(struct mpstream *stream, int64_t num);
+static inline void
+mpstream_encode_uint(struct mpstream *stream, uint64_t num)
+{
+	assert(mp_sizeof_uint(num) <= 9);
+	char *data = mpstream_reserve(stream, 9);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_uint(data, num);
+	mpstream_advance(stream, pos - data);
+}
 
-void
-mpstream_encode_float(struct mpstream *stream, float num);
+static inline void
+mpstream_encode_int(struct mpstream *stream, int64_t num)
+{
+	assert(mp_sizeof_int(num) <= 9);
+	char *data = mpstream_reserve(stream, 9);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_int(data, num);
+	mpstream_advance(stream, pos - data);
+}
 
-void
-mpstream_encode_double(struct mpstream *stream, double num);
+static inline void
+mpstream_encode_float(struct mpstream *stream, float num)
+{
+	assert(mp_sizeof_float(num) <= 5);
+	char *data = mpstream_reserve(stream, 5);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_float(data, num);
+	mpstream_advance(stream, pos - data);
+}
+
+static inline void
+mpstream_encode_double(struct mpstream *stream, double num)
+{
+	assert(mp_sizeof_double(num) <= 9);
+	char *data = mpstream_reserve(stream, 9);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_double(data, num);
+	mpstream_advance(stream, pos - data);
+}
+
+static inline void
+mpstream_encode_nil(struct mpstream *stream)
+{
+	assert(mp_sizeof_nil() <= 1);
+	char *data = mpstream_reserve(stream, 1);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_nil(data);
+	mpstream_advance(stream, pos - data);
+}
+
+static inline void
+mpstream_encode_bool(struct mpstream *stream, bool val)
+{
+	assert(mp_sizeof_bool(val) <= 1);
+	char *data = mpstream_reserve(stream, 1);
+	if (data == NULL)
+		return;
+	char *pos = mp_encode_bool(data, val);
+	mpstream_advance(stream, pos - data);
+}
 
 void
 mpstream_encode_strn(struct mpstream *stream, const char *str, uint32_t len);
@@ -128,12 +208,6 @@ mpstream_encode_str(struct mpstream *stream, const char *str)
 	mpstream_encode_strn(stream, str, strlen(str));
 }
 
-void
-mpstream_encode_nil(struct mpstream *stream);
-
-void
-mpstream_encode_bool(struct mpstream *stream, bool val);
-
 void
 mpstream_encode_binl(struct mpstream *stream, uint32_t len);
 
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "sampler.h"
+
+#include "trivia/config.h"
+#include "diag.h"
+#include "fiber.h"
+#include "pmatomic.h"
+
+#ifdef ENABLE_BACKTRACE
+
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+enum {
+	/** Deep enough for tx stacks through Lua and the engines. */
+	SAMPLER_FRAME_MAX = 32,
+	/** Ring capacity, must be a power of two. */
+	SAMPLER_RING_SIZE = 4096,
+	/** A formatted flamegraph line with all frame names. */
+	SAMPLER_LINE_MAX = 4096,
+};
+
+struct sample {
+	/**
+	 * Number of captured frames. Zero while the slot is
+	 * being filled by the signal handler; stored last, with
+	 * release semantics, to publish the sample.
+	 */
+	int nframes;
+	/** Id of the fiber running when the signal landed. */
+	uint32_t fid;
+	/** Raw instruction pointers, innermost frame first. */
+	void *frames[SAMPLER_FRAME_MAX];
+};
+
+/**
+ * The ring is allocated on the first start and deliberately
+ * never freed: a signal delivered to another thread during
+ * sampler_stop() may still be writing into it.
+ */
+static struct sample *sampler_ring;
+/** Next slot to claim. Only grows, slot index is masked. */
+static uint64_t sampler_head;
+/** Set while the profiling timer is armed. */
+static bool sampler_active;
+
+static void
+sampler_on_prof(int signo)
+{
+	(void) signo;
+	struct sample *ring = sampler_ring;
+	if (ring == NULL || !sampler_active)
+		return;
+	/*
+	 * The signal can land on a non-cord helper thread which
+	 * has no fibers to attribute the sample to.
+	 */
+	if (cord() == NULL)
+		return;
+	uint64_t i = pm_atomic_fetch_add(&sampler_head, 1);
+	struct sample *s = &ring[i & (SAMPLER_RING_SIZE - 1)];
+	pm_atomic_store_explicit(&s->nframes, 0, memory_order_release);
+	s->fid = fiber()->fid;
+	/*
+	 * Only raw instruction pointers are captured here;
+	 * symbolization allocates and is done on dump.
+	 */
+	int nframes = unw_backtrace(s->frames, SAMPLER_FRAME_MAX);
+	pm_atomic_store_explicit(&s->nframes, nframes, memory_order_release);
+}
+
+int
+sampler_start(int freq_hz)
+{
+	if (freq_hz <= 0) {
+		diag_set(IllegalParams, "sampling frequency must be positive");
+		return -1;
+	}
+	if (sampler_ring == NULL) {
+		size_t size = SAMPLER_RING_SIZE * sizeof(struct sample);
+		struct sample *ring = calloc(1, size);
+		if (ring == NULL) {
+			diag_set(OutOfMemory, size, "calloc", "sampler ring");
+			return -1;
+		}
+		sampler_ring = ring;
+	}
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sampler_on_prof;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL) != 0) {
+		diag_set(SystemError, "failed to install SIGPROF handler");
+		return -1;
+	}
+	sampler_active = true;
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 1000000 / freq_hz;
+	if (timer.it_interval.tv_usec == 0)
+		timer.it_interval.tv_usec = 1;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+		sampler_active = false;
+		diag_set(SystemError, "failed to arm the profiling timer");
+		return -1;
+	}
+	return 0;
+}
+
+void
+sampler_stop(void)
+{
+	if (!sampler_active)
+		return;
+	struct itimerval timer;
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	sampler_active = false;
+}
+
+/**
+ * Resolve a frame address into a symbol name, or format the
+ * raw address into @a buf when the symbol is unknown.
+ */
+static const char *
+sampler_frame_name(void *ip, char *buf, size_t size)
+{
+	Dl_info info;
+	if (dladdr(ip, &info) != 0 && info.dli_sname != NULL)
+		return info.dli_sname;
+	snprintf(buf, size, "0x%llx", (unsigned long long) (uintptr_t) ip);
+	return buf;
+}
+
+int
+sampler_dump(sampler_dump_cb cb, void *ctx)
+{
+	if (sampler_ring == NULL)
+		return 0;
+	uint64_t head = pm_atomic_load(&sampler_head);
+	uint64_t count = head < SAMPLER_RING_SIZE ? head : SAMPLER_RING_SIZE;
+	char line[SAMPLER_LINE_MAX];
+	char addr[32];
+	int dumped = 0;
+	for (uint64_t i = 0; i < count; i++) {
+		struct sample *s = &sampler_ring[i];
+		int nframes = pm_atomic_load_explicit(&s->nframes,
+						      memory_order_acquire);
+		if (nframes <= 0)
+			continue;
+		char *pos = line;
+		char *end = line + sizeof(line);
+		pos += snprintf(pos, end - pos, "fiber:%u", (unsigned) s->fid);
+		/* Flamegraph lines go from the root to the leaf. */
+		for (int f = nframes - 1; f >= 0 && pos < end; f--) {
+			pos += snprintf(pos, end - pos, ";%s",
+					sampler_frame_name(s->frames[f], addr,
+							   sizeof(addr)));
+		}
+		if (cb(line, ctx) != 0)
+			return -1;
+		dumped++;
+	}
+	/* Reset the ring for the next collection period. */
+	for (uint64_t i = 0; i < SAMPLER_RING_SIZE; i++)
+		sampler_ring[i].nframes = 0;
+	pm_atomic_store(&sampler_head, 0);
+	return dumped;
+}
+
+#else /* !ENABLE_BACKTRACE */
+
+int
+sampler_start(int freq_hz)
+{
+	(void) freq_hz;
+	diag_set(IllegalParams, "the sampling profiler requires backtrace "
+		 "support");
+	return -1;
+}
+
+void
+sampler_stop(void)
+{
+}
+
+int
+sampler_dump(sampler_dump_cb cb, void *ctx)
+{
+	(void) cb;
+	(void) ctx;
+	return 0;
+}
+
+#endif /* ENABLE_BACKTRACE */
@@ -0,0 +1,86 @@
+#ifndef TARANTOOL_LIB_CORE_SAMPLER_H_INCLUDED
+#define TARANTOOL_LIB_CORE_SAMPLER_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * In-process sampling profiler for environments where perf is
+ * not available. A SIGPROF timer periodically captures the
+ * current fiber id and a raw instruction pointer backtrace of
+ * whichever thread the signal lands on, into a lock-free ring.
+ * Samples are symbolized lazily on dump, never in the signal
+ * handler.
+ */
+
+/**
+ * Start sampling at the given frequency, in samples per second.
+ * Restarting an active sampler just changes the frequency.
+ *
+ * @retval  0 Success.
+ * @retval -1 The profiler is not supported on this platform or
+ *            the sample ring can not be allocated (diag is set).
+ */
+int
+sampler_start(int freq_hz);
+
+/** Stop the profiling timer. Collected samples are kept. */
+void
+sampler_stop(void);
+
+/**
+ * Callback invoked by sampler_dump() once per sample with a
+ * flamegraph-style stack line: semicolon-separated frames,
+ * outermost first, prefixed with the fiber id. Returns a
+ * non-zero value to abort the dump.
+ */
+typedef int
+(*sampler_dump_cb)(const char *line, void *ctx);
+
+/**
+ * Symbolize and report all collected samples, then reset the
+ * sample ring.
+ *
+ * @retval >= 0 Number of reported samples.
+ * @retval -1 The callback aborted the dump.
+ */
+int
+sampler_dump(sampler_dump_cb cb, void *ctx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_SAMPLER_H_INCLUDED */
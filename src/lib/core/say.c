@@ -33,6 +33,8 @@
 #include "errinj.h"
 #include "tt_static.h"
 
+#include <pmatomic.h>
+
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -195,6 +197,72 @@ say_set_log_level(int new_level)
 	log_set_level(log_default, (enum say_level) new_level);
 }
 
+enum {
+	/** Maximum number of per-module log level overrides. */
+	SAY_MODULE_MAX = 8,
+	/** Maximum length of a module name, with the 0 byte. */
+	SAY_MODULE_NAME_MAX = 32,
+};
+
+/** A log level override for a subsystem. */
+struct say_log_module {
+	/** Substring of a source file path naming the module. */
+	char name[SAY_MODULE_NAME_MAX];
+	/** Log level applied to the module's messages. */
+	int level;
+};
+
+/**
+ * Per-module log level overrides, see say_set_module_level().
+ * Updated from the main thread; a logger in another thread may
+ * observe a stale level during reconfiguration, which is as
+ * harmless as the unsynchronized global log_level.
+ */
+static struct say_log_module say_log_modules[SAY_MODULE_MAX];
+static int say_log_module_count = 0;
+
+int
+say_set_module_level(const char *module, int level)
+{
+	int i;
+	for (i = 0; i < say_log_module_count; i++) {
+		if (strncmp(say_log_modules[i].name, module,
+			    SAY_MODULE_NAME_MAX) == 0)
+			break;
+	}
+	if (level < 0) {
+		/* Drop the override, if any. */
+		if (i < say_log_module_count) {
+			say_log_modules[i] =
+				say_log_modules[--say_log_module_count];
+		}
+		return 0;
+	}
+	if (i >= SAY_MODULE_MAX)
+		return -1;
+	snprintf(say_log_modules[i].name, SAY_MODULE_NAME_MAX, "%s", module);
+	say_log_modules[i].level = level;
+	if (i == say_log_module_count)
+		say_log_module_count++;
+	return 0;
+}
+
+/**
+ * Return the log level override matching a source file path,
+ * or -1 if no module covers it.
+ */
+static int
+say_module_level(const char *filename)
+{
+	if (filename == NULL)
+		return -1;
+	for (int i = 0; i < say_log_module_count; i++) {
+		if (strstr(filename, say_log_modules[i].name) != NULL)
+			return say_log_modules[i].level;
+	}
+	return -1;
+}
+
 void
 say_set_log_format(enum say_format format)
 {
@@ -987,6 +1055,35 @@ say_default(int level, const char *filename, int line, const char *error,
 	errno = errsv; /* Preserve the errno. */
 }
 
+/**
+ * Number of log messages dropped because a nonblocking write to
+ * the log file descriptor could not make progress, and the part
+ * of it already reported to the log. Updated from any thread
+ * that logs.
+ */
+static int64_t log_drop_count = 0;
+static int64_t log_drop_reported = 0;
+
+int64_t
+say_drop_count(void)
+{
+	return pm_atomic_load(&log_drop_count);
+}
+
+/** Format and write a message produced by the logger itself. */
+static void
+log_write_internal(struct log *log, int level, const char *format, ...)
+{
+	char mbuf[512];
+	va_list ap;
+	va_start(ap, format);
+	int total = log->format_func(log, mbuf, sizeof(mbuf), level,
+				     __FILE__, __LINE__, NULL, format, ap);
+	va_end(ap);
+	ssize_t r = safe_write(log->fd, mbuf, total);
+	(void) r;                               /* silence gcc warning */
+}
+
 /**
  * File and pipe logger
  */
@@ -998,7 +1095,26 @@ write_to_file(struct log *log, int total)
 	       log->type == SAY_LOGGER_STDERR);
 	assert(total >= 0);
 	ssize_t r = safe_write(log->fd, buf, total);
-	(void) r;                               /* silence gcc warning */
+	if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		/*
+		 * The log device is not keeping up. The fd is
+		 * nonblocking, so the message is dropped rather
+		 * than stalling the logging thread. Account the
+		 * loss and report it once the device recovers.
+		 */
+		pm_atomic_fetch_add(&log_drop_count, 1);
+		return;
+	}
+	int64_t dropped = pm_atomic_load(&log_drop_count);
+	int64_t reported = pm_atomic_load(&log_drop_reported);
+	if (dropped > reported &&
+	    pm_atomic_compare_exchange_strong(&log_drop_reported,
+					      &reported, dropped)) {
+		log_write_internal(log, S_WARN, "%lld log messages were "
+				   "dropped, the log device was not "
+				   "keeping up",
+				   (long long)(dropped - reported));
+	}
 }
 
 /**
@@ -1019,16 +1135,16 @@ write_to_syslog(struct log *log, int total)
 		if (log->fd >= 0)
 			close(log->fd);
 		log->fd = log_syslog_connect(log);
-		if (log->fd >= 0) {
+		if (log->fd >= 0)
 			log_set_nonblock(log);
+		if (log->fd < 0 || safe_write(log->fd, buf, total) <= 0) {
 			/*
-			 * In a case or error the log message is
-			 * lost. We can not wait for connection -
-			 * it would block thread. Try to reconnect
-			 * on next vsay().
+			 * The log message is lost. We can not
+			 * wait for connection - it would block
+			 * thread. Try to reconnect on next
+			 * vsay().
 			 */
-			ssize_t r = safe_write(log->fd, buf, total);
-			(void) r;               /* silence gcc warning */
+			pm_atomic_fetch_add(&log_drop_count, 1);
 		}
 	}
 }
@@ -1198,7 +1314,13 @@ log_vsay(struct log *log, int level, const char *filename, int line,
 	 const char *error, const char *format, va_list ap)
 {
 	int errsv = errno;
-	if (level > log->level) {
+	int max_level = log->level;
+	if (log == log_default && say_log_module_count > 0) {
+		int module_level = say_module_level(filename);
+		if (module_level >= 0)
+			max_level = module_level;
+	}
+	if (level > max_level) {
 		return 0;
 	}
 	int total = log->format_func(log, buf, sizeof(buf), level,
@@ -234,6 +234,31 @@ log_set_format(struct log *log, log_format_func_t format_func);
 void
 say_set_log_level(int new_level);
 
+/**
+ * Set a log level override for a subsystem. A message logged by
+ * the default logger whose source file path contains @a module
+ * as a substring is filtered against this level instead of the
+ * global one, which makes it possible to e.g. enable debug
+ * logging for vinyl alone:
+ *
+ *   say_set_module_level("box/vy_", S_DEBUG);
+ *
+ * Pass a negative @a level to remove the override.
+ *
+ * @retval  0 Success.
+ * @retval -1 Too many modules have an override already.
+ */
+int
+say_set_module_level(const char *module, int level);
+
+/**
+ * Return the number of log messages dropped because a
+ * nonblocking write to the log file descriptor could not make
+ * progress.
+ */
+int64_t
+say_drop_count(void);
+
 /**
  * Set log format for default logger. Can be used dynamically.
  *
@@ -80,6 +80,66 @@ sio_socketname(int fd)
 	return name;
 }
 
+bool
+sio_peer_is_local(int fd)
+{
+	int save_errno = errno;
+	bool is_local = false;
+	struct sockaddr_storage peer;
+	socklen_t peerlen = sizeof(peer);
+	if (getpeername(fd, (struct sockaddr *) &peer, &peerlen) != 0)
+		goto out;
+	switch (peer.ss_family) {
+	case AF_UNIX:
+		is_local = true;
+		break;
+	case AF_INET: {
+		struct sockaddr_in *in = (struct sockaddr_in *) &peer;
+		if ((ntohl(in->sin_addr.s_addr) >> 24) == 127) {
+			is_local = true;
+			break;
+		}
+		/*
+		 * A connection to the host's own interface address:
+		 * the peer address of such a socket equals the local
+		 * address of the server end.
+		 */
+		struct sockaddr_storage self;
+		socklen_t selflen = sizeof(self);
+		if (getsockname(fd, (struct sockaddr *) &self,
+				&selflen) == 0 &&
+		    self.ss_family == AF_INET) {
+			struct sockaddr_in *sin = (struct sockaddr_in *) &self;
+			is_local = sin->sin_addr.s_addr == in->sin_addr.s_addr;
+		}
+		break;
+	}
+	case AF_INET6: {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) &peer;
+		if (IN6_IS_ADDR_LOOPBACK(&in6->sin6_addr)) {
+			is_local = true;
+			break;
+		}
+		struct sockaddr_storage self;
+		socklen_t selflen = sizeof(self);
+		if (getsockname(fd, (struct sockaddr *) &self,
+				&selflen) == 0 &&
+		    self.ss_family == AF_INET6) {
+			struct sockaddr_in6 *sin6 =
+				(struct sockaddr_in6 *) &self;
+			is_local = memcmp(&sin6->sin6_addr, &in6->sin6_addr,
+					  sizeof(in6->sin6_addr)) == 0;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+out:
+	errno = save_errno;
+	return is_local;
+}
+
 /** Get a string representation of a socket option name,
  * for logging.
  */
@@ -96,6 +156,7 @@ sio_option_name(int option)
 #ifdef __linux__
 	CASE_OPTION(TCP_KEEPCNT);
 	CASE_OPTION(TCP_KEEPINTVL);
+	CASE_OPTION(TCP_CORK);
 #endif
 	default:
 		return "undefined";
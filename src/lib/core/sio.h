@@ -142,6 +142,14 @@ sio_add_to_iov(struct iovec *iov, size_t size)
  */
 const char *sio_socketname(int fd);
 
+/**
+ * Check if the peer of a connected socket lives on the same host:
+ * an AF_UNIX peer, a loopback address, or a TCP connection whose
+ * peer address equals the local address of the socket (a host
+ * connected to its own interface address). Preserves the errno.
+ */
+bool sio_peer_is_local(int fd);
+
 /** Create a TCP or AF_UNIX socket. */
 int sio_socket(int domain, int type, int protocol);
 
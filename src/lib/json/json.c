@@ -330,6 +330,33 @@ json_path_multikey_offset(const char *path, int path_len, int index_base)
 	return path_len;
 }
 
+int
+json_path_token_count(const char *path, int path_len, int index_base)
+{
+	struct json_lexer lexer;
+	json_lexer_create(&lexer, path, path_len, index_base);
+	struct json_token token;
+	int rc, count = 0;
+	while ((rc = json_lexer_next_token(&lexer, &token)) == 0 &&
+	       token.type != JSON_TOKEN_END)
+		count++;
+	return rc == 0 ? count : -1;
+}
+
+int
+json_path_compile(const char *path, int path_len, int index_base,
+		  struct json_token *tokens)
+{
+	struct json_lexer lexer;
+	json_lexer_create(&lexer, path, path_len, index_base);
+	struct json_token token;
+	int rc;
+	while ((rc = json_lexer_next_token(&lexer, &token)) == 0 &&
+	       token.type != JSON_TOKEN_END)
+		*tokens++ = token;
+	return rc == 0 ? 0 : -1;
+}
+
 /**
  * An snprint-style helper to print an individual token key.
  */
@@ -602,6 +629,16 @@ json_tree_lookup_path(struct json_tree *tree, struct json_token *root,
 	return ret;
 }
 
+struct json_token *
+json_tree_lookup_tokens(struct json_tree *tree, struct json_token *root,
+			const struct json_token *tokens, uint32_t token_count)
+{
+	struct json_token *ret = root;
+	for (uint32_t i = 0; i < token_count && ret != NULL; i++)
+		ret = json_tree_lookup(tree, ret, &tokens[i]);
+	return ret;
+}
+
 /**
  * Return the child of @parent following @pos or NULL if @pos
  * points to the last child in the children array. If @pos is
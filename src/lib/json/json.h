@@ -276,6 +276,26 @@ json_path_validate(const char *path, int path_len, int index_base);
 int
 json_path_multikey_offset(const char *path, int path_len, int index_base);
 
+/**
+ * Return the number of tokens in a JSON path, not counting
+ * the terminal JSON_TOKEN_END.
+ * Return -1 if the path is invalid.
+ */
+int
+json_path_token_count(const char *path, int path_len, int index_base);
+
+/**
+ * Compile a JSON path into a flat array of tokens so that the
+ * path can be processed repeatedly without running a lexer.
+ * The tokens array must have room for json_path_token_count()
+ * elements. Only the key part of each token (type and num or
+ * str, len) is set. String tokens point into the path buffer.
+ * Return 0 on success, -1 if the path is invalid.
+ */
+int
+json_path_compile(const char *path, int path_len, int index_base,
+		  struct json_token *tokens);
+
 /**
  * Test if a given JSON token is a JSON tree leaf, i.e.
  * has no child nodes.
@@ -422,6 +442,18 @@ struct json_token *
 json_tree_lookup_path(struct json_tree *tree, struct json_token *root,
 		      const char *path, int path_len, int index_base);
 
+/**
+ * Look up a token in a JSON tree by a path compiled into a flat
+ * token array, see json_path_compile(). Works exactly like
+ * json_tree_lookup_path(), but does not run a lexer.
+ *
+ * Returns NULL if no token is found.
+ */
+struct json_token *
+json_tree_lookup_tokens(struct json_tree *tree, struct json_token *root,
+			const struct json_token *tokens,
+			uint32_t token_count);
+
 /**
  * Perform pre-order traversal in a JSON subtree rooted
  * at a given node.
@@ -505,6 +537,16 @@ json_tree_postorder_next(struct json_token *root, struct json_token *pos);
 	json_tree_entry_safe(ret, type, member);			     \
 })
 
+/**
+ * Container-aware wrapper around json_tree_lookup_tokens().
+ */
+#define json_tree_lookup_tokens_entry(tree, root, tokens, token_count,	     \
+				      type, member) ({			     \
+	struct json_token *ret = json_tree_lookup_tokens((tree), (root),     \
+					(tokens), (token_count));	     \
+	json_tree_entry_safe(ret, type, member);			     \
+})
+
 /**
  * Container-aware wrapper around json_tree_preorder_next().
  */
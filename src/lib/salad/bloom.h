@@ -120,6 +120,17 @@ bloom_add(struct bloom *bloom, bloom_hash_t hash);
 static bool
 bloom_maybe_has(const struct bloom *bloom, bloom_hash_t hash);
 
+/**
+ * Prefetch the table block a hash maps to. A filter rarely fits
+ * in cache, so a lookup is usually one cache miss; issuing the
+ * prefetches for a batch of hashes before probing any of them
+ * overlaps the misses instead of taking them one by one.
+ * @param bloom - the bloom filter
+ * @param hash - hash of the value
+ */
+static void
+bloom_prefetch(const struct bloom *bloom, bloom_hash_t hash);
+
 /**
  * Return the expected false positive rate of a bloom filter.
  * @param bloom - the bloom filter
@@ -204,6 +215,18 @@ bloom_maybe_has(const struct bloom *bloom, bloom_hash_t hash)
 	return true;
 }
 
+static inline void
+bloom_prefetch(const struct bloom *bloom, bloom_hash_t hash)
+{
+#if defined(__GNUC__)
+	bloom_hash_t pos = hash % bloom->table_size;
+	__builtin_prefetch(bloom->table + pos, 0);
+#else
+	(void)bloom;
+	(void)hash;
+#endif
+}
+
 /* }}} API definition */
 
 #if defined(__cplusplus)
@@ -137,6 +137,7 @@
  * void bps_tree_destroy(tree);
  * int bps_tree_build(tree, sorted_array, array_size);
  * bps_tree_elem_t *bps_tree_find(tree, key);
+ * void bps_tree_find_multi(tree, keys, count, elems);
  * int bps_tree_insert(tree, new_elem, replaced_elem);
  * int bps_tree_insert_get_iterator(tree, new_elem, replaced_elem,
  * 				    inserted_iterator)
@@ -158,6 +159,7 @@
  * struct bps_tree_iterator bps_tree_lower_bound_elem(tree, elem, exact);
  * struct bps_tree_iterator bps_tree_upper_bound_elem(tree, elem, exact);
  * size_t bps_tree_approxiamte_count(tree, key);
+ * bps_tree_pos_t bps_tree_estimate_splits(tree, count, elems);
  * bps_tree_elem_t *bps_tree_iterator_get_elem(tree, itr);
  * bool bps_tree_iterator_next(tree, itr);
  * bool bps_tree_iterator_prev(tree, itr);
@@ -357,6 +359,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_build _api_name(build)
 #define bps_tree_destroy _api_name(destroy)
 #define bps_tree_find _api_name(find)
+#define bps_tree_find_multi _api_name(find_multi)
 #define bps_tree_insert _api_name(insert)
 #define bps_tree_insert_get_iterator _api_name(insert_get_iterator)
 #define bps_tree_delete _api_name(delete)
@@ -374,6 +377,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_lower_bound_elem _api_name(lower_bound_elem)
 #define bps_tree_upper_bound_elem _api_name(upper_bound_elem)
 #define bps_tree_approximate_count _api_name(approximate_count)
+#define bps_tree_estimate_splits _api_name(estimate_splits)
 #define bps_tree_iterator_get_elem _api_name(iterator_get_elem)
 #define bps_tree_iterator_next _api_name(iterator_next)
 #define bps_tree_iterator_prev _api_name(iterator_prev)
@@ -395,6 +399,7 @@ typedef uint32_t bps_tree_block_id_t;
 
 #define bps_tree_restore_block _bps_tree(restore_block)
 #define bps_tree_restore_block_ver _bps_tree(restore_block_ver)
+#define bps_tree_prefetch_block _bps_tree(prefetch_block)
 #define bps_tree_root _bps_tree(root)
 #define bps_tree_touch_block _bps_tree(touch_block)
 #define bps_tree_find_ins_point_key _bps_tree(find_ins_point_key)
@@ -608,6 +613,18 @@ bps_tree_destroy(struct bps_tree *tree);
 static inline bps_tree_elem_t *
 bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key);
 
+/**
+ * @brief Find elements that are equal to each of the given keys
+ * @param tree - pointer to a tree
+ * @param keys - array of keys that will be compared with elements
+ * @param count - number of keys in the array
+ * @param elems - array of count result pointers; elems[i] is set to
+ *  the first element equal to keys[i] or NULL if there is none
+ */
+static inline void
+bps_tree_find_multi(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **elems);
+
 /**
  * @brief Insert an element to the tree or replace an element in the tree
  * In case of replacing, if 'replaced' argument is not null,
@@ -789,6 +806,25 @@ bps_tree_upper_bound_elem(const struct bps_tree *tree, bps_tree_elem_t key,
 static inline size_t
 bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key);
 
+/**
+ * @brief Collect elements that split the tree into chunks of
+ * roughly equal size, e.g. for scanning the chunks in parallel.
+ * For every requested split point the tree is descended choosing
+ * a child proportionally to the position of the split point, the
+ * same way bps_tree_approximate_count assumes uniform occupancy
+ * of blocks. B+* blocks are filled at least by 2/3, so the true
+ * chunk sizes differ from the average by at most a constant
+ * factor. Equal neighbour split elements are collapsed, so fewer
+ * than count - 1 elements may be returned for a small tree.
+ * @param tree - pointer to a tree
+ * @param count - the desired number of chunks
+ * @param elems - output array of at least count - 1 elements
+ * @return - number of split elements written
+ */
+static inline bps_tree_pos_t
+bps_tree_estimate_splits(const struct bps_tree *tree, bps_tree_pos_t count,
+			 bps_tree_elem_t *elems);
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -1286,6 +1322,28 @@ bps_tree_restore_block_ver(const struct bps_tree *tree, bps_tree_block_id_t id,
 	return (struct bps_block *)matras_view_get(&tree->matras, view, id);
 }
 
+/**
+ * @brief Prefetch all cache lines of a block.
+ * A binary search probes a block in an unpredictable order, so
+ * every probe that leaves the already fetched cache lines stalls
+ * on a new miss. Prefetching the whole block up front lets those
+ * lines be fetched in parallel instead. A no-op on compilers
+ * without __builtin_prefetch.
+ */
+static inline void
+bps_tree_prefetch_block(const struct bps_block *block)
+{
+#if defined(__GNUC__)
+	/* A conservative cache line size, correct for x86 and arm64. */
+	const size_t cache_line_size = 64;
+	const char *addr = (const char *)block;
+	for (size_t i = 0; i < BPS_TREE_BLOCK_SIZE; i += cache_line_size)
+		__builtin_prefetch(addr + i, 0, 3);
+#else
+	(void)block;
+#endif
+}
+
 /**
  * @brief Get a pointer to block by it's ID.
  */
@@ -1693,6 +1751,7 @@ bps_tree_lower_bound(const struct bps_tree *tree, bps_tree_key_t key,
 						  key, exact);
 		block_id = inner->child_ids[pos];
 		block = bps_tree_restore_block(tree, block_id);
+		bps_tree_prefetch_block(block);
 	}
 
 	struct bps_leaf *leaf = (struct bps_leaf *)block;
@@ -1747,6 +1806,7 @@ bps_tree_upper_bound(const struct bps_tree *tree, bps_tree_key_t key,
 			*exact = true;
 		block_id = inner->child_ids[pos];
 		block = bps_tree_restore_block(tree, block_id);
+		bps_tree_prefetch_block(block);
 	}
 
 	struct bps_leaf *leaf = (struct bps_leaf *)block;
@@ -1801,6 +1861,7 @@ bps_tree_lower_bound_elem(const struct bps_tree *tree, bps_tree_elem_t key,
 						   key, exact);
 		block_id = inner->child_ids[pos];
 		block = bps_tree_restore_block(tree, block_id);
+		bps_tree_prefetch_block(block);
 	}
 
 	struct bps_leaf *leaf = (struct bps_leaf *)block;
@@ -1856,6 +1917,7 @@ bps_tree_upper_bound_elem(const struct bps_tree *tree, bps_tree_elem_t key,
 			*exact = true;
 		block_id = inner->child_ids[pos];
 		block = bps_tree_restore_block(tree, block_id);
+		bps_tree_prefetch_block(block);
 	}
 
 	struct bps_leaf *leaf = (struct bps_leaf *)block;
@@ -1957,6 +2019,55 @@ bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key)
 	return result;
 }
 
+/**
+ * @brief Collect elements that split the tree into chunks of
+ * roughly equal size. See the declaration for details.
+ * @param tree - pointer to a tree
+ * @param count - the desired number of chunks
+ * @param elems - output array of at least count - 1 elements
+ * @return - number of split elements written
+ */
+static inline bps_tree_pos_t
+bps_tree_estimate_splits(const struct bps_tree *tree, bps_tree_pos_t count,
+			 bps_tree_elem_t *elems)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1) || count < 2)
+		return 0;
+
+	bps_tree_pos_t written = 0;
+	for (bps_tree_pos_t i = 1; i < count; i++) {
+		/*
+		 * Descend to the leaf of the i/count quantile
+		 * assuming uniform occupancy of blocks, exactly
+		 * like bps_tree_approximate_count does.
+		 */
+		double frac = (double) i / count;
+		struct bps_block *block = bps_tree_root(tree);
+		for (bps_tree_block_id_t level = 1; level < tree->depth;
+		     level++) {
+			struct bps_inner *inner = (struct bps_inner *)block;
+			bps_tree_pos_t pos =
+				(bps_tree_pos_t)(frac * inner->header.size);
+			if (pos >= inner->header.size)
+				pos = inner->header.size - 1;
+			frac = frac * inner->header.size - pos;
+			block = bps_tree_restore_block(tree,
+						       inner->child_ids[pos]);
+		}
+		struct bps_leaf *leaf = (struct bps_leaf *)block;
+		bps_tree_pos_t pos = (bps_tree_pos_t)(frac * leaf->header.size);
+		if (pos >= leaf->header.size)
+			pos = leaf->header.size - 1;
+		bps_tree_elem_t elem = leaf->elems[pos];
+		/* A small tree produces duplicates, drop them. */
+		if (written > 0 &&
+		    BPS_TREE_COMPARE(elem, elems[written - 1], tree->arg) <= 0)
+			continue;
+		elems[written++] = elem;
+	}
+	return written;
+}
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -2083,6 +2194,7 @@ bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key)
 						  inner->header.size - 1,
 						  key, &exact);
 		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+		bps_tree_prefetch_block(block);
 	}
 
 	struct bps_leaf *leaf = (struct bps_leaf *)block;
@@ -2095,6 +2207,74 @@ bps_tree_find(const struct bps_tree *tree, bps_tree_key_t key)
 		return 0;
 }
 
+/**
+ * @brief Find elements that are equal to each of the given keys.
+ * All lookups descend the tree in lock step, level by level: the
+ * children of every lookup are prefetched before any of them is
+ * searched, so while the binary search walks one lookup's block
+ * the cache misses of the other lookups are resolved in parallel.
+ * A large batch of point lookups thereby runs at the speed of the
+ * memory-level parallelism of the CPU rather than of a chain of
+ * dependent misses, which a loop around bps_tree_find would give.
+ * @param tree - pointer to a tree
+ * @param keys - array of keys that will be compared with elements
+ * @param count - number of keys in the array
+ * @param elems - array of count result pointers; elems[i] is set to
+ *  the first element equal to keys[i] or NULL if there is none
+ */
+static inline void
+bps_tree_find_multi(const struct bps_tree *tree, bps_tree_key_t *keys,
+		    size_t count, bps_tree_elem_t **elems)
+{
+	/*
+	 * Wavefront width. Bounds the stack usage and keeps the
+	 * prefetch distance short enough for the blocks fetched
+	 * at the start of a round to still be cached at its end.
+	 */
+	enum { BPS_TREE_FIND_MULTI_WIDTH = 16 };
+	struct bps_block *blocks[BPS_TREE_FIND_MULTI_WIDTH];
+	for (size_t i = 0; i < count; i++)
+		elems[i] = 0;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return;
+	for (size_t base = 0; base < count;
+	     base += BPS_TREE_FIND_MULTI_WIDTH) {
+		size_t n = count - base;
+		if (n > BPS_TREE_FIND_MULTI_WIDTH)
+			n = BPS_TREE_FIND_MULTI_WIDTH;
+		struct bps_block *root = bps_tree_root(tree);
+		bps_tree_prefetch_block(root);
+		for (size_t i = 0; i < n; i++)
+			blocks[i] = root;
+		bool exact = false;
+		for (bps_tree_block_id_t level = 0; level < tree->depth - 1;
+		     level++) {
+			for (size_t i = 0; i < n; i++) {
+				struct bps_inner *inner =
+					(struct bps_inner *)blocks[i];
+				bps_tree_pos_t pos;
+				pos = bps_tree_find_ins_point_key(
+					tree, inner->elems,
+					inner->header.size - 1,
+					keys[base + i], &exact);
+				blocks[i] = bps_tree_restore_block(
+					tree, inner->child_ids[pos]);
+				bps_tree_prefetch_block(blocks[i]);
+			}
+		}
+		for (size_t i = 0; i < n; i++) {
+			struct bps_leaf *leaf = (struct bps_leaf *)blocks[i];
+			bps_tree_pos_t pos;
+			pos = bps_tree_find_ins_point_key(tree, leaf->elems,
+							  leaf->header.size,
+							  keys[base + i],
+							  &exact);
+			if (exact)
+				elems[base + i] = leaf->elems + pos;
+		}
+	}
+}
+
 /**
  * @brief Add a block to the garbage for future reuse
  */
@@ -2276,6 +2456,7 @@ bps_tree_collect_path(struct bps_tree *tree, bps_tree_elem_t new_elem,
 		}
 		block_id = inner->child_ids[pos];
 		block = bps_tree_restore_block(tree, block_id);
+		bps_tree_prefetch_block(block);
 		prev_pos = pos;
 		prev_ext = path + i;
 	}
@@ -6082,6 +6263,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_build
 #undef bps_tree_destroy
 #undef bps_tree_find
+#undef bps_tree_find_multi
 #undef bps_tree_insert
 #undef bps_tree_delete
 #undef bps_tree_delete_value
@@ -6098,6 +6280,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_lower_bound_elem
 #undef bps_tree_upper_bound_elem
 #undef bps_tree_approximate_count
+#undef bps_tree_estimate_splits
 #undef bps_tree_iterator_get_elem
 #undef bps_tree_iterator_next
 #undef bps_tree_iterator_prev
@@ -6118,6 +6301,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef bps_tree_restore_block
 #undef bps_tree_restore_block_ver
+#undef bps_tree_prefetch_block
 #undef bps_tree_root
 #undef bps_tree_touch_block
 #undef bps_tree_find_ins_point_key
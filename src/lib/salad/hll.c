@@ -0,0 +1,59 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "hll.h"
+
+#include <math.h>
+
+uint64_t
+hll_estimate(const struct hll *hll)
+{
+	/* Bias correction constant for 256 registers. */
+	const double alpha = 0.7213 / (1 + 1.079 / HLL_REGISTERS);
+	double sum = 0;
+	int zero_count = 0;
+	for (int i = 0; i < HLL_REGISTERS; i++) {
+		sum += 1.0 / (1ULL << hll->regs[i]);
+		if (hll->regs[i] == 0)
+			zero_count++;
+	}
+	double raw = alpha * HLL_REGISTERS * HLL_REGISTERS / sum;
+	if (raw <= 2.5 * HLL_REGISTERS && zero_count > 0) {
+		/* Small range: linear counting is more accurate. */
+		return (uint64_t)(HLL_REGISTERS *
+				  log((double)HLL_REGISTERS / zero_count));
+	}
+	double two_pow_32 = 4294967296.0;
+	if (raw > two_pow_32 / 30) {
+		/* Large range: correct for 32-bit hash collisions. */
+		return (uint64_t)(-two_pow_32 * log(1 - raw / two_pow_32));
+	}
+	return (uint64_t)raw;
+}
@@ -0,0 +1,92 @@
+#ifndef TARANTOOL_LIB_SALAD_HLL_H_INCLUDED
+#define TARANTOOL_LIB_SALAD_HLL_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * HyperLogLog cardinality estimator over 32-bit hashes.
+ *
+ * The sketch uses 256 one-byte registers, giving a standard
+ * error of about 6.5% in 260 bytes, which is plenty for an
+ * order-of-magnitude estimate. Members can only be added - the
+ * estimate tracks the number of distinct members ever accounted,
+ * so the caller has to deal with deletions itself, e.g. by
+ * clamping the estimate or recreating the sketch.
+ */
+
+enum {
+	/** log2 of the register count. */
+	HLL_PRECISION = 8,
+	/** Number of registers in a sketch. */
+	HLL_REGISTERS = 1 << HLL_PRECISION,
+};
+
+struct hll {
+	/**
+	 * Maximum rank (position of the leftmost set bit in the
+	 * hash tail) observed in each register bucket.
+	 */
+	uint8_t regs[HLL_REGISTERS];
+};
+
+static inline void
+hll_create(struct hll *hll)
+{
+	memset(hll->regs, 0, sizeof(hll->regs));
+}
+
+/** Account a member by its hash. */
+static inline void
+hll_add(struct hll *hll, uint32_t hash)
+{
+	uint32_t idx = hash >> (32 - HLL_PRECISION);
+	uint32_t tail = hash << HLL_PRECISION;
+	uint8_t rank = tail == 0 ? 32 - HLL_PRECISION + 1 :
+		       __builtin_clz(tail) + 1;
+	if (rank > hll->regs[idx])
+		hll->regs[idx] = rank;
+}
+
+/** Estimate the number of distinct members ever added. */
+uint64_t
+hll_estimate(const struct hll *hll);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_SALAD_HLL_H_INCLUDED */
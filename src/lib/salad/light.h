@@ -388,6 +388,25 @@ LIGHT(slot)(const struct LIGHT(core) *ht, uint32_t hash)
 
 }
 
+/**
+ * @brief Prefetch the next record of a collision chain.
+ * LIGHT_EQUAL dereferences the stored value (a tuple in memtx) and
+ * usually stalls on a cache miss, so the next chain record can be
+ * fetched in parallel with the comparison instead of after it.
+ * A no-op on compilers without __builtin_prefetch.
+ */
+static inline void
+LIGHT(prefetch_record)(const struct LIGHT(core) *ht, uint32_t slot)
+{
+#if defined(__GNUC__)
+	if (slot != LIGHT(end))
+		__builtin_prefetch(matras_get(&ht->mtable, slot), 0, 3);
+#else
+	(void)ht;
+	(void)slot;
+#endif
+}
+
 /**
  * @brief Find a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -406,6 +425,7 @@ LIGHT(find)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE value)
 	if (record->next == slot)
 		return LIGHT(end);
 	while (1) {
+		LIGHT(prefetch_record)(ht, record->next);
 		if (record->hash == hash
 		    && LIGHT_EQUAL((record->value), (value), (ht->arg)))
 			return slot;
@@ -437,6 +457,7 @@ LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE key)
 	if (record->next == slot)
 		return LIGHT(end);
 	while (1) {
+		LIGHT(prefetch_record)(ht, record->next);
 		if (record->hash == hash &&
 		    LIGHT_EQUAL_KEY((record->value), (key), (ht->arg)))
 			return slot;
@@ -470,6 +491,7 @@ LIGHT(replace)(struct LIGHT(core) *ht, uint32_t hash,
 	if (record->next == slot)
 		return LIGHT(end);
 	while (1) {
+		LIGHT(prefetch_record)(ht, record->next);
 		if (record->hash == hash
 		    && LIGHT_EQUAL((record->value), (value), (ht->arg))) {
 			record = (struct LIGHT(record) *)
@@ -901,6 +923,7 @@ LIGHT(delete_value)(struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE value
 	uint32_t prev_slot = LIGHT(end);
 	struct LIGHT(record) *prev_record = 0;
 	while (1) {
+		LIGHT(prefetch_record)(ht, record->next);
 		if (record->hash == hash
 		    && LIGHT_EQUAL((record->value), (value), (ht->arg)))
 			break;
@@ -0,0 +1,250 @@
+#ifndef TARANTOOL_LIB_SALAD_MHASH_COW_H_INCLUDED
+#define TARANTOOL_LIB_SALAD_MHASH_COW_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <pmatomic.h>
+
+#include "small/rlist.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/*
+ * Copy-on-write publication of a read-mostly hash table with
+ * epoch-based reclamation.
+ *
+ * An mhash table (see mhash.h) can not be probed concurrently
+ * with a mutation: put and del move nodes around. For registries
+ * that are mutated rarely but read on hot paths - possibly from
+ * threads other than the one owning the table - this wrapper
+ * publishes an immutable snapshot of the table instead:
+ *
+ * - The single writer never mutates the published table. It
+ *   builds a new table (usually by cloning the current one and
+ *   applying the change), then calls mh_cow_publish(). The old
+ *   table is retired, not freed.
+ *
+ * - A reader thread registers an mh_cow_reader once, then brackets
+ *   every probe with mh_cow_read_lock(), which returns the table
+ *   snapshot to probe with the plain mh_*_find() of the
+ *   corresponding mhash instantiation, and mh_cow_read_unlock().
+ *   The read side takes no locks and writes only its own epoch
+ *   slot.
+ *
+ * - A retired table is freed by mh_cow_collect() once every
+ *   registered reader has either left its read section or entered
+ *   a newer epoch, so a snapshot obtained before the publication
+ *   can no longer be in use.
+ *
+ * The writer side is serialized by the caller: in tarantool all
+ * cache mutations happen in the tx thread. The mutex only guards
+ * the reader registry against concurrent thread start and stop.
+ */
+
+/** A retired table awaiting quiescence of its readers. */
+struct mh_cow_garbage {
+	struct rlist in_garbage;
+	/** Epoch at which the table was retired. */
+	uint64_t epoch;
+	void *table;
+};
+
+/** Per-thread reader state, registered once per thread. */
+struct mh_cow_reader {
+	struct rlist in_readers;
+	/**
+	 * Epoch the reader entered its current read section in,
+	 * 0 when the reader is not in a read section.
+	 */
+	uint64_t epoch;
+};
+
+struct mh_cow {
+	/** The published table. Readers load-acquire it. */
+	void *table;
+	/** Monotonic epoch, bumped on every retirement. */
+	uint64_t epoch;
+	/** Retired tables, oldest first. */
+	struct rlist garbage;
+	/** Registered readers. */
+	struct rlist readers;
+	/** Destructor of a retired table. */
+	void (*free_table)(void *table);
+	/** Guards the reader registry. */
+	pthread_mutex_t readers_mutex;
+};
+
+static inline void
+mh_cow_create(struct mh_cow *cow, void *table, void (*free_table)(void *))
+{
+	cow->table = table;
+	cow->epoch = 1;
+	rlist_create(&cow->garbage);
+	rlist_create(&cow->readers);
+	cow->free_table = free_table;
+	pthread_mutex_init(&cow->readers_mutex, NULL);
+}
+
+/**
+ * Free the published table and all retired ones. All readers
+ * must be unregistered by now.
+ */
+static inline void
+mh_cow_destroy(struct mh_cow *cow)
+{
+	struct mh_cow_garbage *garbage, *tmp;
+	rlist_foreach_entry_safe(garbage, &cow->garbage, in_garbage, tmp) {
+		cow->free_table(garbage->table);
+		free(garbage);
+	}
+	if (cow->table != NULL)
+		cow->free_table(cow->table);
+	pthread_mutex_destroy(&cow->readers_mutex);
+}
+
+/** Register a reader thread. */
+static inline void
+mh_cow_register(struct mh_cow *cow, struct mh_cow_reader *reader)
+{
+	pm_atomic_store_explicit(&reader->epoch, (uint64_t)0,
+				 memory_order_relaxed);
+	pthread_mutex_lock(&cow->readers_mutex);
+	rlist_add_tail_entry(&cow->readers, reader, in_readers);
+	pthread_mutex_unlock(&cow->readers_mutex);
+}
+
+/** Unregister a reader thread, e.g. on its shutdown. */
+static inline void
+mh_cow_unregister(struct mh_cow *cow, struct mh_cow_reader *reader)
+{
+	pthread_mutex_lock(&cow->readers_mutex);
+	rlist_del_entry(reader, in_readers);
+	pthread_mutex_unlock(&cow->readers_mutex);
+}
+
+/**
+ * Enter a read section and return the table snapshot to probe.
+ * The snapshot stays valid until mh_cow_read_unlock(). Read
+ * sections must be short: a sleeping reader delays reclamation.
+ */
+static inline void *
+mh_cow_read_lock(struct mh_cow *cow, struct mh_cow_reader *reader)
+{
+	/*
+	 * The epoch announcement must be visible before the table
+	 * pointer is loaded, or the writer could miss this reader
+	 * when collecting the very table it is about to probe.
+	 */
+	pm_atomic_store_explicit(&reader->epoch,
+				 pm_atomic_load_explicit(&cow->epoch,
+							 memory_order_seq_cst),
+				 memory_order_seq_cst);
+	return pm_atomic_load_explicit(&cow->table, memory_order_seq_cst);
+}
+
+/** Leave a read section. */
+static inline void
+mh_cow_read_unlock(struct mh_cow_reader *reader)
+{
+	pm_atomic_store_explicit(&reader->epoch, (uint64_t)0,
+				 memory_order_release);
+}
+
+/**
+ * Get the published table without entering a read section. Only
+ * legal in the writer thread: the writer is the only one to
+ * retire tables, so the snapshot can not go away under it.
+ */
+static inline void *
+mh_cow_get(struct mh_cow *cow)
+{
+	return cow->table;
+}
+
+/** Free the retired tables all readers have moved past. */
+static inline void
+mh_cow_collect(struct mh_cow *cow)
+{
+	if (rlist_empty(&cow->garbage))
+		return;
+	uint64_t min_epoch = UINT64_MAX;
+	pthread_mutex_lock(&cow->readers_mutex);
+	struct mh_cow_reader *reader;
+	rlist_foreach_entry(reader, &cow->readers, in_readers) {
+		uint64_t epoch = pm_atomic_load_explicit(&reader->epoch,
+							 memory_order_seq_cst);
+		if (epoch != 0 && epoch < min_epoch)
+			min_epoch = epoch;
+	}
+	pthread_mutex_unlock(&cow->readers_mutex);
+	struct mh_cow_garbage *garbage, *tmp;
+	rlist_foreach_entry_safe(garbage, &cow->garbage, in_garbage, tmp) {
+		if (garbage->epoch >= min_epoch)
+			break;
+		rlist_del_entry(garbage, in_garbage);
+		cow->free_table(garbage->table);
+		free(garbage);
+	}
+}
+
+/**
+ * Publish a new table, retiring the current one. The retired
+ * table is freed by a later mh_cow_collect() when it is proven
+ * quiescent. Returns -1 on OOM, in which case nothing changes
+ * and the new table is still owned by the caller.
+ */
+static inline int
+mh_cow_publish(struct mh_cow *cow, void *new_table)
+{
+	struct mh_cow_garbage *garbage = malloc(sizeof(*garbage));
+	if (garbage == NULL)
+		return -1;
+	garbage->table = cow->table;
+	garbage->epoch = pm_atomic_fetch_add_explicit(&cow->epoch,
+						      (uint64_t)1,
+						      memory_order_seq_cst);
+	pm_atomic_store_explicit(&cow->table, new_table,
+				 memory_order_seq_cst);
+	rlist_add_tail_entry(&cow->garbage, garbage, in_garbage);
+	mh_cow_collect(cow);
+	return 0;
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_SALAD_MHASH_COW_H_INCLUDED */
@@ -32,7 +32,9 @@
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <sys/types.h>
 
 /*------------------------------------------------------------------------- */
@@ -1006,6 +1008,113 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj)
 	tree->n_records++;
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load: sort-tile-recursive packing */
+/*------------------------------------------------------------------------- */
+
+/*
+ * Dimension the entries are currently sorted along. The r-tree
+ * is not thread safe to begin with, so a plain static sort
+ * context is fine.
+ */
+static unsigned rtree_bulk_sort_dim;
+
+static int
+rtree_bulk_entry_cmp(const void *pa, const void *pb)
+{
+	const struct rtree_bulk_entry *a = pa;
+	const struct rtree_bulk_entry *b = pb;
+	/* Compare rectangle centers; the sum spares a division. */
+	coord_t ca = a->rect.coords[2 * rtree_bulk_sort_dim] +
+		     a->rect.coords[2 * rtree_bulk_sort_dim + 1];
+	coord_t cb = b->rect.coords[2 * rtree_bulk_sort_dim] +
+		     b->rect.coords[2 * rtree_bulk_sort_dim + 1];
+	return ca < cb ? -1 : ca > cb;
+}
+
+/**
+ * Order entries so that each consecutive run of leaf_cap of them
+ * forms a spatially tight leaf page: sort along the current
+ * dimension, cut into slices of roughly equal page count and
+ * recurse into each slice along the next dimension.
+ */
+static void
+rtree_bulk_sort(struct rtree_bulk_entry *entries, unsigned count,
+		unsigned dimension, unsigned dim, unsigned leaf_cap)
+{
+	rtree_bulk_sort_dim = dim;
+	qsort(entries, count, sizeof(*entries), rtree_bulk_entry_cmp);
+	if (dim + 1 >= dimension)
+		return;
+	unsigned pages = (count + leaf_cap - 1) / leaf_cap;
+	unsigned slices = (unsigned)ceil(pow(pages,
+					     1.0 / (dimension - dim)));
+	if (slices == 0)
+		slices = 1;
+	unsigned per_slice = (count + slices - 1) / slices;
+	/* Align slices on page boundaries. */
+	per_slice = (per_slice + leaf_cap - 1) / leaf_cap * leaf_cap;
+	for (unsigned i = 0; i < count; i += per_slice) {
+		unsigned n = count - i < per_slice ? count - i : per_slice;
+		rtree_bulk_sort(entries + i, n, dimension, dim + 1, leaf_cap);
+	}
+}
+
+int
+rtree_bulk_load(struct rtree *tree, struct rtree_bulk_entry *entries,
+		unsigned count)
+{
+	assert(tree->root == NULL);
+	assert(tree->n_records == 0);
+	if (count == 0)
+		return 0;
+	unsigned cap = tree->page_max_fill;
+	rtree_bulk_sort(entries, count, tree->dimension, 0, cap);
+	/*
+	 * Pack the tree bottom up. Each level packs consecutive
+	 * runs of at most page_max_fill entries into full pages
+	 * and leaves the page covers in the head of the entries
+	 * array as the next level's input: a record is a leaf
+	 * branch, a page pointer an inner one. The tail page of
+	 * a level may end up below page_min_fill, which deletion
+	 * already knows how to mend by reinsertion.
+	 */
+	unsigned n = count;
+	unsigned height = 0;
+	for (;;) {
+		height++;
+		unsigned parents = 0;
+		for (unsigned i = 0; i < n; i += cap) {
+			unsigned cnt = n - i < cap ? n - i : cap;
+			struct rtree_page *page = rtree_page_alloc(tree);
+			if (page == NULL)
+				return -1;
+			tree->n_pages++;
+			page->n = cnt;
+			for (unsigned j = 0; j < cnt; j++) {
+				struct rtree_page_branch *b =
+					rtree_branch_get(tree, page, j);
+				b->data.record = entries[i + j].obj;
+				rtree_rect_copy(&b->rect,
+						&entries[i + j].rect,
+						tree->dimension);
+			}
+			entries[parents].obj = (record_t)page;
+			rtree_page_cover(tree, page, &entries[parents].rect);
+			parents++;
+		}
+		if (parents == 1) {
+			tree->root = (struct rtree_page *)entries[0].obj;
+			break;
+		}
+		n = parents;
+	}
+	tree->height = height;
+	tree->n_records = count;
+	tree->version++;
+	return 0;
+}
+
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 {
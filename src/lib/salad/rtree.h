@@ -275,6 +275,33 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * An entry of rtree_bulk_load()
+ */
+struct rtree_bulk_entry {
+	/* Minimal bounding rectangle of the record */
+	struct rtree_rect rect;
+	/* The record itself */
+	record_t obj;
+};
+
+/**
+ * @brief Bulk load an empty tree using sort-tile-recursive packing
+ *
+ * Pages come out full and spatially tight, which one-by-one
+ * insertion cannot achieve; the entries array is reordered and
+ * clobbered in the process.
+ *
+ * @return 0 on success, -1 if a page allocation failed; the tree
+ *         must be destroyed then
+ * @param tree - pointer to an empty tree
+ * @param entries - records with their bounding rectangles
+ * @param count - number of entries
+ */
+int
+rtree_bulk_load(struct rtree *tree, struct rtree_bulk_entry *entries,
+		unsigned count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
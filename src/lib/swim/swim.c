@@ -186,6 +186,34 @@ enum {
 	 * members.
 	 */
 	INDIRECT_PING_COUNT = 2,
+	/**
+	 * One round step pings one member plus one more per this
+	 * many known members. The classical SWIM sends strictly
+	 * one message per step, so a round over N members takes N
+	 * steps and failure detection latency grows linearly with
+	 * the cluster size. Batched steps keep the round time
+	 * sub-linear while the per-step network load still grows
+	 * only as N / this constant.
+	 */
+	ROUND_BATCH_SCALE = 50,
+	/**
+	 * Hard cap on the number of members pinged in one round
+	 * step, to not flood the output queue in a single event
+	 * loop iteration.
+	 */
+	ROUND_BATCH_MAX = 8,
+	/**
+	 * A conservative estimate of how many member passports fit
+	 * into the anti-entropy section of one packet. Used to
+	 * decide how many follow-up anti-entropy packets a round
+	 * message needs to cover the whole member table.
+	 */
+	ANTI_ENTROPY_PACKET_CAPACITY = 20,
+	/**
+	 * Hard cap on the number of follow-up anti-entropy packets
+	 * sent after a round message.
+	 */
+	ANTI_ENTROPY_EXTRA_PACKETS_MAX = 3,
 };
 
 /**
@@ -292,6 +320,19 @@ struct swim_member {
 	 * is not valid anymore and should be dereferenced.
 	 */
 	bool is_dropped;
+	/**
+	 * The latest member table digest received from this
+	 * member. When it matches the local table digest, the
+	 * tables are identical and the anti-entropy section is
+	 * omitted from messages to this member.
+	 */
+	uint64_t table_digest;
+	/**
+	 * True, if @a table_digest was ever received. Can not use
+	 * a special digest value instead - every 64 bit value is
+	 * a valid digest.
+	 */
+	bool is_table_digest_known;
 	/**
 	 *
 	 *                 Dissemination component
@@ -481,6 +522,16 @@ struct swim {
 	 * starting from this instance.
 	 */
 	mh_int_t iterator;
+	/**
+	 * Digest of the whole member table, announced to other
+	 * members so they can skip anti-entropy with this
+	 * instance when their tables are the same. Is
+	 * recalculated lazily, because most of the time the table
+	 * does not change between round steps.
+	 */
+	uint64_t table_digest;
+	/** True, if @a table_digest matches the member table. */
+	bool is_table_digest_valid;
 	/**
 	 *
 	 *               Failure detection component
@@ -598,9 +649,20 @@ swim_wait_ack(struct swim *swim, struct swim_member *member,
 static inline void
 swim_register_event(struct swim *swim, struct swim_member *member)
 {
+	/*
+	 * The queue is kept ordered by event freshness: a new or
+	 * updated event goes to the head. The dissemination
+	 * section is encoded from the head and a packet may not
+	 * fit the whole queue, so what gets cut off the tail are
+	 * the stalest events - those which have already been
+	 * sent the most times.
+	 */
 	if (rlist_empty(&member->in_dissemination_queue)) {
-		rlist_add_tail_entry(&swim->dissemination_queue, member,
-				     in_dissemination_queue);
+		rlist_add_entry(&swim->dissemination_queue, member,
+				in_dissemination_queue);
+	} else {
+		rlist_move_entry(&swim->dissemination_queue, member,
+				 in_dissemination_queue);
 	}
 	/*
 	 * Logarithm is a perfect number of disseminations of an
@@ -622,6 +684,69 @@ swim_register_event(struct swim *swim, struct swim_member *member)
 	member->status_ttd = ceil(log2(mh_size(swim->members))) + 1;
 }
 
+/**
+ * One step of the FNV-1a hash function over a memory block,
+ * continuing a previously calculated hash value.
+ */
+static inline uint64_t
+swim_digest_step(uint64_t h, const void *data, int size)
+{
+	const uint8_t *pos = (const uint8_t *) data;
+	for (int i = 0; i < size; ++i) {
+		h ^= pos[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/**
+ * Calculate a digest of one member. The digest covers exactly the
+ * attributes shipped in the anti-entropy section, so two tables
+ * consisting of members with the same digests have nothing to
+ * tell each other via anti-entropy.
+ */
+static uint64_t
+swim_member_digest(const struct swim_member *member)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	h = swim_digest_step(h, &member->uuid, sizeof(member->uuid));
+	uint8_t status = member->status;
+	h = swim_digest_step(h, &status, sizeof(status));
+	h = swim_digest_step(h, &member->addr.sin_addr.s_addr,
+			     sizeof(member->addr.sin_addr.s_addr));
+	h = swim_digest_step(h, &member->addr.sin_port,
+			     sizeof(member->addr.sin_port));
+	h = swim_digest_step(h, &member->incarnation,
+			     sizeof(member->incarnation));
+	h = swim_digest_step(h, &member->payload_size,
+			     sizeof(member->payload_size));
+	return swim_digest_step(h, member->payload, member->payload_size);
+}
+
+/**
+ * Get a digest of the whole member table. Member digests are
+ * combined with XOR, so the result does not depend on the member
+ * table iteration order. The digest is recalculated lazily - most
+ * of the time the table does not change between round steps, and
+ * all the steps reuse one cached value.
+ */
+static uint64_t
+swim_table_digest(struct swim *swim)
+{
+	if (swim->is_table_digest_valid)
+		return swim->table_digest;
+	uint64_t digest = 0;
+	mh_int_t node;
+	mh_foreach(swim->members, node) {
+		struct swim_member *m =
+			*mh_swim_table_node(swim->members, node);
+		digest ^= swim_member_digest(m);
+	}
+	swim->table_digest = digest;
+	swim->is_table_digest_valid = true;
+	return digest;
+}
+
 /**
  * Make all needed actions to process a member's update like a
  * change of its status, or incarnation, or both.
@@ -631,6 +756,11 @@ swim_on_member_update(struct swim *swim, struct swim_member *member,
 		      enum swim_ev_mask events)
 {
 	member->unacknowledged_pings = 0;
+	/*
+	 * Any attribute change, as well as member addition and
+	 * drop, makes the cached table digest stale.
+	 */
+	swim->is_table_digest_valid = false;
 	swim_register_event(swim, member);
 	/*
 	 * Member event should be delivered to triggers only if
@@ -1054,10 +1184,18 @@ swim_encode_member(struct swim_packet *packet, struct swim_member *m,
 /**
  * Encode anti-entropy header and random members data as many as
  * possible to the end of the packet.
+ * @param swim SWIM instance.
+ * @param packet Packet to encode into.
+ * @param[in,out] rpos Member table position to start encoding
+ *        from, updated to where the encoding stopped so a next
+ *        packet can continue the exchange. Pass NULL, or a
+ *        position equal to mh_end(), to start from a random
+ *        member.
  * @retval Number of key-values added to the packet's root map.
  */
 static int
-swim_encode_anti_entropy(struct swim *swim, struct swim_packet *packet)
+swim_encode_anti_entropy(struct swim *swim, struct swim_packet *packet,
+			 mh_int_t *rpos)
 {
 	struct swim_anti_entropy_header_bin ae_header_bin;
 	struct swim_passport_bin passport_bin;
@@ -1069,9 +1207,14 @@ swim_encode_anti_entropy(struct swim *swim, struct swim_packet *packet)
 	swim_member_payload_bin_create(&payload_header);
 	struct mh_swim_table_t *t = swim->members;
 	int i = 0, member_count = mh_size(t);
-	int rnd = swim_scaled_rand(0, member_count - 1);
-	for (mh_int_t rc = mh_swim_table_random(t, rnd), end = mh_end(t);
-	     i < member_count; ++i) {
+	mh_int_t rc, end = mh_end(t);
+	if (rpos != NULL && *rpos != end) {
+		rc = *rpos;
+	} else {
+		int rnd = swim_scaled_rand(0, member_count - 1);
+		rc = mh_swim_table_random(t, rnd);
+	}
+	for (; i < member_count; ++i) {
 		struct swim_member *m = *mh_swim_table_node(t, rc);
 		if (swim_encode_member(packet, m, &passport_bin,
 				       &payload_header, true) != 0)
@@ -1086,6 +1229,8 @@ swim_encode_anti_entropy(struct swim *swim, struct swim_packet *packet)
 		if (rc == end)
 			rc = mh_first(t);
 	}
+	if (rpos != NULL)
+		*rpos = rc;
 	swim_anti_entropy_header_bin_create(&ae_header_bin, i);
 	memcpy(header, &ae_header_bin, sizeof(ae_header_bin));
 	return 1;
@@ -1156,10 +1301,47 @@ swim_encode_dissemination(struct swim *swim, struct swim_packet *packet)
 	return 1;
 }
 
-/** Encode SWIM components into a UDP packet. */
+/**
+ * Encode the local member table digest.
+ * @retval Number of key-values added to the packet's root map.
+ */
+static int
+swim_encode_member_digest(struct swim *swim, struct swim_packet *packet)
+{
+	struct swim_member_digest_bin digest_bin;
+	char *pos = swim_packet_alloc(packet, sizeof(digest_bin));
+	if (pos == NULL)
+		return 0;
+	swim_member_digest_bin_create(&digest_bin, swim_table_digest(swim));
+	memcpy(pos, &digest_bin, sizeof(digest_bin));
+	return 1;
+}
+
+/**
+ * Check if anti-entropy with @a member can be skipped. It can,
+ * when the member has reported a table digest equal to the local
+ * one - then both tables are identical and anti-entropy would
+ * carry no new information. Once any of the tables changes, the
+ * digests diverge and the exchange is resumed.
+ */
+static inline bool
+swim_can_skip_anti_entropy(struct swim *swim, struct swim_member *member)
+{
+	return member != NULL && member->is_table_digest_known &&
+	       member->table_digest == swim_table_digest(swim);
+}
+
+/**
+ * Encode SWIM components into a UDP packet. @a dst, if not NULL,
+ * is the destination member, whose last reported table digest
+ * allows to omit the anti-entropy section entirely. @a ae_pos, if
+ * not NULL, is the anti-entropy continuation position, see
+ * swim_encode_anti_entropy().
+ */
 static void
 swim_encode_msg(struct swim *swim, struct swim_packet *packet,
-		enum swim_fd_msg_type fd_type)
+		enum swim_fd_msg_type fd_type, struct swim_member *dst,
+		mh_int_t *ae_pos)
 {
 	char *header = swim_packet_alloc(packet, 1);
 	int map_size = 0;
@@ -1170,7 +1352,9 @@ swim_encode_msg(struct swim *swim, struct swim_packet *packet,
 		return;
 	});
 	map_size += swim_encode_dissemination(swim, packet);
-	map_size += swim_encode_anti_entropy(swim, packet);
+	map_size += swim_encode_member_digest(swim, packet);
+	if (! swim_can_skip_anti_entropy(swim, dst))
+		map_size += swim_encode_anti_entropy(swim, packet, ae_pos);
 
 	assert(mp_sizeof_map(map_size) == 1 && map_size >= 2);
 	mp_encode_map(header, map_size);
@@ -1181,12 +1365,13 @@ swim_encode_msg(struct swim *swim, struct swim_packet *packet,
  * Note, since we decrement TTD of all events, even those which
  * have not been actually encoded and sent, if there are more
  * events than can fit into a packet, the tail of the queue begins
- * reeking and rotting. The most recently added members could even
- * be deleted without being sent once. This is, however, very
- * unlikely, since even 1000 bytes can fit 37 events containing
- * ~27 bytes each, which means only happens upon a failure of 37
- * instances. In such a case event loss is the mildest problem to
- * deal with.
+ * reeking and rotting. The queue is ordered by event freshness,
+ * so the rotting tail consists of the stalest events - those
+ * which have been sent the most times already. This is, however,
+ * very unlikely, since even 1000 bytes can fit 37 events
+ * containing ~27 bytes each, which means only happens upon a
+ * failure of 37 instances. In such a case event loss is the
+ * mildest problem to deal with.
  */
 static void
 swim_decrease_event_ttd(struct swim *swim)
@@ -1206,6 +1391,102 @@ swim_decrease_event_ttd(struct swim *swim)
 	}
 }
 
+/**
+ * Continue an anti-entropy exchange with @a dst in follow-up
+ * packets, when the member table is too big to fit into the
+ * round message. UDP keeps each packet within MTU, so a 'jumbo'
+ * exchange is assembled from several independent packets, each
+ * being a valid SWIM message of its own, continuing the member
+ * table scan from where the previous packet stopped.
+ */
+static void
+swim_send_extra_anti_entropy(struct swim *swim, struct swim_member *dst,
+			     mh_int_t *ae_pos)
+{
+	ERROR_INJECT(ERRINJ_SWIM_FD_ONLY, return);
+	if (swim_can_skip_anti_entropy(swim, dst))
+		return;
+	int extra = (mh_size(swim->members) - 1) /
+		    ANTI_ENTROPY_PACKET_CAPACITY;
+	if (extra > ANTI_ENTROPY_EXTRA_PACKETS_MAX)
+		extra = ANTI_ENTROPY_EXTRA_PACKETS_MAX;
+	for (int i = 0; i < extra; ++i) {
+		struct swim_task *task =
+			swim_task_new(swim_task_delete_cb, swim_task_delete_cb,
+				      "anti-entropy");
+		if (task == NULL)
+			return;
+		swim_packet_create(&task->packet);
+		char *header = swim_packet_alloc(&task->packet, 1);
+		int map_size = swim_encode_src_uuid(swim, &task->packet);
+		map_size += swim_encode_anti_entropy(swim, &task->packet,
+						     ae_pos);
+		mp_encode_map(header, map_size);
+		swim_task_send(task, &dst->addr, &swim->scheduler);
+	}
+}
+
+/** Completion of an extra round ping sent in a batch. */
+static void
+swim_complete_batch_step(struct swim_task *task,
+			 struct swim_scheduler *scheduler, int rc)
+{
+	if (rc <= 0)
+		goto finish;
+	struct swim *swim = swim_by_scheduler(scheduler);
+	struct swim_member *m = swim_find_member(swim, &task->uuid);
+	/*
+	 * The member could be deleted, or its address could be
+	 * updated, while the task was in the output queue.
+	 */
+	if (m != NULL && swim_inaddr_eq(&m->addr, &task->dst))
+		swim_wait_ack(swim, m, false);
+finish:
+	swim_task_delete(task);
+}
+
+/**
+ * Ping more members from the round queue in the same event loop
+ * iteration. The batch size scales with the cluster size, see
+ * ROUND_BATCH_SCALE. Each extra target gets its own freshly
+ * built packet, so each one carries an independent random
+ * anti-entropy section - batching multiplies not only failure
+ * detection, but also anti-entropy throughput.
+ */
+static void
+swim_begin_batch_steps(struct swim *swim)
+{
+	int extra = (mh_size(swim->members) - 1) / ROUND_BATCH_SCALE;
+	if (extra > ROUND_BATCH_MAX - 1)
+		extra = ROUND_BATCH_MAX - 1;
+	for (int i = 0; i < extra; ++i) {
+		/*
+		 * The queue head is owned by the main round step
+		 * task until its completion, take the second
+		 * entry.
+		 */
+		struct rlist *second =
+			rlist_next(rlist_next(&swim->round_queue));
+		if (second == &swim->round_queue)
+			break;
+		struct swim_member *m = rlist_entry(second, struct swim_member,
+						    in_round_queue);
+		struct swim_task *task =
+			swim_task_new(swim_complete_batch_step,
+				      swim_task_delete_cb, "batch round ping");
+		if (task == NULL)
+			break;
+		task->uuid = m->uuid;
+		rlist_del_entry(m, in_round_queue);
+		swim_packet_create(&task->packet);
+		mh_int_t ae_pos = mh_end(swim->members);
+		swim_encode_msg(swim, &task->packet, SWIM_FD_MSG_PING, m,
+				&ae_pos);
+		swim_task_send(task, &m->addr, &swim->scheduler);
+		swim_send_extra_anti_entropy(swim, m, &ae_pos);
+	}
+}
+
 /**
  * Once per specified timeout trigger a next round step. In round
  * step a next member is taken from the round queue and a round
@@ -1243,11 +1524,14 @@ swim_begin_step(struct ev_loop *loop, struct ev_timer *t, int events)
 	}
 	struct swim_packet *packet = &swim->round_step_task.packet;
 	swim_packet_create(packet);
-	swim_encode_msg(swim, packet, SWIM_FD_MSG_PING);
 	struct swim_member *m =
 		rlist_first_entry(&swim->round_queue, struct swim_member,
 				  in_round_queue);
+	mh_int_t ae_pos = mh_end(swim->members);
+	swim_encode_msg(swim, packet, SWIM_FD_MSG_PING, m, &ae_pos);
 	swim_task_send(&swim->round_step_task, &m->addr, &swim->scheduler);
+	swim_send_extra_anti_entropy(swim, m, &ae_pos);
+	swim_begin_batch_steps(swim);
 }
 
 /**
@@ -1302,7 +1586,7 @@ swim_send_fd_msg(struct swim *swim, struct swim_task *task,
 	swim_packet_create(&task->packet);
 	if (proxy != NULL)
 		swim_task_set_proxy(task, proxy);
-	swim_encode_msg(swim, &task->packet, type);
+	swim_encode_msg(swim, &task->packet, type, NULL, NULL);
 	say_verbose("SWIM %d: schedule %s to %s", swim_fd(swim),
 		    swim_fd_msg_type_strs[type], swim_inaddr_str(dst));
 	swim_task_send(task, dst, &swim->scheduler);
@@ -1807,6 +2091,34 @@ swim_process_quit(struct swim *swim, const char **pos, const char *end,
 	return 0;
 }
 
+/**
+ * Process a member table digest received from a remote instance.
+ * It is remembered in the sender's member record. When the sender
+ * becomes a round step destination, a digest matching the local
+ * one allows to omit the anti-entropy section.
+ */
+static int
+swim_process_member_digest(struct swim *swim, const char **pos,
+			   const char *end, const struct tt_uuid *uuid)
+{
+	const char *prefix = "invalid member digest message:";
+	uint64_t digest;
+	if (swim_decode_uint(pos, end, &digest, prefix, "digest") != 0)
+		return -1;
+	struct swim_member *sender = swim_find_member(swim, uuid);
+	/*
+	 * The sender may be unknown yet - it is discovered via
+	 * the anti-entropy section of the same message, which is
+	 * processed later. Then its digest is learned from one of
+	 * the next messages.
+	 */
+	if (sender == NULL)
+		return 0;
+	sender->table_digest = digest;
+	sender->is_table_digest_known = true;
+	return 0;
+}
+
 /** Process a new message. */
 static void
 swim_on_input(struct swim_scheduler *scheduler, const char *pos,
@@ -1856,6 +2168,11 @@ swim_on_input(struct swim_scheduler *scheduler, const char *pos,
 			if (swim_process_quit(swim, &pos, end, &uuid) != 0)
 				goto error;
 			break;
+		case SWIM_MEMBER_DIGEST:
+			if (swim_process_member_digest(swim, &pos, end,
+						       &uuid) != 0)
+				goto error;
+			break;
 		default:
 			diag_set(SwimError, "%s unexpected key", prefix);
 			goto error;
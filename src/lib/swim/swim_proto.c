@@ -612,6 +612,15 @@ swim_quit_bin_create(struct swim_quit_bin *header,
 	swim_incarnation_bin_fill(&header->incarnation, incarnation);
 }
 
+void
+swim_member_digest_bin_create(struct swim_member_digest_bin *header,
+			      uint64_t digest)
+{
+	header->k_digest = SWIM_MEMBER_DIGEST;
+	header->m_digest = 0xcf;
+	header->v_digest = mp_bswap_u64(digest);
+}
+
 void
 swim_route_bin_create(struct swim_route_bin *route,
 		      const struct sockaddr_in *src,
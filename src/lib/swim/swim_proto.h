@@ -108,6 +108,10 @@ enum {
  * |                                                             |
  * |               OR/AND                                        |
  * |                                                             |
+ * |     SWIM_MEMBER_DIGEST: uint,                               |
+ * |                                                             |
+ * |               OR/AND                                        |
+ * |                                                             |
  * |     SWIM_QUIT: {                                            |
  * |         SWIM_QUIT_GENERATION: uint,                         |
  * |         SWIM_QUIT_VERSION: uint                             |
@@ -186,6 +190,7 @@ enum swim_body_key {
 	SWIM_FAILURE_DETECTION,
 	SWIM_DISSEMINATION,
 	SWIM_QUIT,
+	SWIM_MEMBER_DIGEST,
 };
 
 /**
@@ -611,6 +616,27 @@ void
 swim_quit_bin_create(struct swim_quit_bin *header,
 		     const struct swim_incarnation *incarnation);
 
+/**
+ * Member table digest section. The digest is a compact summary
+ * of all the attributes the sender would otherwise ship in the
+ * anti-entropy section. A receiver, whose own table digest is the
+ * same, knows that both tables are identical and that
+ * anti-entropy with the sender can be omitted until one of the
+ * tables changes.
+ */
+struct PACKED swim_member_digest_bin {
+	/** mp_encode_uint(SWIM_MEMBER_DIGEST) */
+	uint8_t k_digest;
+	/** mp_encode_uint(64bit digest) */
+	uint8_t m_digest;
+	uint64_t v_digest;
+};
+
+/** Initialize member table digest section. */
+void
+swim_member_digest_bin_create(struct swim_member_digest_bin *header,
+			      uint64_t digest);
+
 /**
  * Helpers to decode some values - map, array, etc with
  * appropriate checks. All of them set diagnostics on an error
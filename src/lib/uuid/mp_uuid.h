@@ -0,0 +1,89 @@
+#ifndef TARANTOOL_LIB_UUID_MP_UUID_INCLUDED
+#define TARANTOOL_LIB_UUID_MP_UUID_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include "tt_uuid.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+enum {
+	/**
+	 * Size of the MP_UUID payload: the 16 bytes of an RFC
+	 * 4122 UUID in network (big-endian) byte order, so that
+	 * memcmp() of two payloads matches tt_uuid_compare().
+	 */
+	UUID_PACKED_LEN = UUID_LEN,
+};
+
+/**
+ * \brief Return the number of bytes an encoded UUID takes.
+ */
+uint32_t
+mp_sizeof_uuid(void);
+
+/**
+ * \brief Unpack an MP_UUID payload of \a len bytes.
+ * \param data - buffer pointer, advanced on success
+ * \param len - payload length, must be UUID_PACKED_LEN
+ * \param[out] uuid - decoded UUID
+ * \retval \a uuid on success, NULL on a malformed payload.
+ */
+struct tt_uuid *
+uuid_unpack(const char **data, uint32_t len, struct tt_uuid *uuid);
+
+/**
+ * \brief Decode a UUID from MsgPack \a data.
+ * \param data - buffer pointer
+ * \param[out] uuid - decoded UUID
+ * \retval \a uuid on success, NULL on a malformed input, in which
+ * case \a data is left intact.
+ */
+struct tt_uuid *
+mp_decode_uuid(const char **data, struct tt_uuid *uuid);
+
+/**
+ * \brief Encode a UUID.
+ * \param data - a buffer of at least mp_sizeof_uuid() bytes
+ * \param uuid - UUID to encode
+ * \return \a data + mp_sizeof_uuid()
+ */
+char *
+mp_encode_uuid(char *data, const struct tt_uuid *uuid);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_UUID_MP_UUID_INCLUDED */
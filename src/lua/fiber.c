@@ -328,6 +328,26 @@ lbox_fiber_statof_nobt(struct fiber *f, void *cb_ctx)
 	return lbox_fiber_statof(f, cb_ctx, false);
 }
 
+/**
+ * Append occupancy of the cord's recycled fiber cache to the
+ * fiber.info() table.
+ */
+static void
+lbox_fiber_cache_info(struct lua_State *L)
+{
+	struct fiber_cache_stat stat;
+	fiber_cache_stat(&stat);
+	lua_pushliteral(L, "pool");
+	lua_newtable(L);
+	lua_pushstring(L, "idle");
+	lua_pushnumber(L, stat.idle);
+	lua_settable(L, -3);
+	lua_pushstring(L, "stack_size");
+	lua_pushnumber(L, stat.stack_size);
+	lua_settable(L, -3);
+	lua_settable(L, -3);
+}
+
 #if ENABLE_FIBER_TOP
 static int
 lbox_fiber_top_entry(struct fiber *f, void *cb_ctx)
@@ -429,6 +449,7 @@ lbox_fiber_info(struct lua_State *L)
 		lua_newtable(L);
 		fiber_stat(lbox_fiber_statof_nobt, L);
 	}
+	lbox_fiber_cache_info(L);
 	lua_createtable(L, 0, 1);
 	lua_pushliteral(L, "mapping"); /* YAML will use block mode */
 	lua_setfield(L, -2, LUAL_SERIALIZE);
@@ -31,6 +31,7 @@
 #include "lua/fiber_channel.h"
 
 #include "lua/fiber.h"
+#include <limits.h>
 #include <trivia/util.h>
 
 #include <lua.h>
@@ -206,6 +207,103 @@ luaT_fiber_channel_get(struct lua_State *L)
 	return 1;
 }
 
+static int
+luaT_fiber_channel_put_all(struct lua_State *L)
+{
+	static const char usage[] = "channel:put_all(table [, timeout])";
+	struct fiber_channel *ch =
+		luaT_checkfiberchannel(L, 1, usage);
+	ev_tstamp timeout;
+
+	if (lua_type(L, 2) != LUA_TTABLE)
+		luaL_error(L, "usage: %s", usage);
+
+	/* timeout (optional) */
+	if (lua_isnoneornil(L, 3)) {
+		timeout = TIMEOUT_INFINITY;
+	} else if (lua_isnumber(L, 3)) {
+		timeout = lua_tonumber(L, 3);
+		if (timeout < 0)
+			luaL_error(L, "usage: %s", usage);
+	} else {
+		luaL_error(L, "usage: %s", usage);
+	}
+
+	int count = lua_objlen(L, 2);
+	int done = 0;
+	while (done < count) {
+		struct ipc_value *value = ipc_value_new();
+		if (value == NULL)
+			break;
+		value->base.destroy = lua_ipc_value_destroy;
+		lua_rawgeti(L, 2, done + 1);
+		value->i = luaL_ref(L, LUA_REGISTRYINDEX);
+		struct ipc_msg *msg = &value->base;
+		/* Wait for the first message only. */
+		if (fiber_channel_put_batch_msg_timeout(ch, &msg, 1,
+					done == 0 ? timeout : 0) < 0) {
+			value->base.destroy(&value->base);
+			luaL_testcancel(L);
+			break;
+		}
+		done++;
+	}
+	lua_pushinteger(L, done);
+	return 1;
+}
+
+static int
+luaT_fiber_channel_get_all(struct lua_State *L)
+{
+	static const char usage[] = "channel:get_all([timeout [, limit]])";
+	struct fiber_channel *ch =
+		luaT_checkfiberchannel(L, 1, usage);
+	ev_tstamp timeout;
+
+	/* timeout (optional) */
+	if (lua_isnoneornil(L, 2)) {
+		timeout = TIMEOUT_INFINITY;
+	} else if (lua_isnumber(L, 2)) {
+		timeout = lua_tonumber(L, 2);
+		if (timeout < 0)
+			luaL_error(L, "usage: %s", usage);
+	} else {
+		luaL_error(L, "usage: %s", usage);
+	}
+
+	/* limit (optional) */
+	int limit = INT_MAX;
+	if (lua_isnumber(L, 3)) {
+		limit = lua_tonumber(L, 3);
+		if (limit < 1)
+			luaL_error(L, "usage: %s", usage);
+	} else if (!lua_isnoneornil(L, 3)) {
+		luaL_error(L, "usage: %s", usage);
+	}
+
+	int done = 0;
+	lua_newtable(L);
+	while (done < limit) {
+		struct ipc_value *value;
+		/* Wait for the first message only. */
+		if (fiber_channel_get_batch_msg_timeout(ch,
+					(struct ipc_msg **)&value, 1,
+					done == 0 ? timeout : 0) < 0) {
+			if (done == 0) {
+				luaL_testcancel(L);
+				lua_pop(L, 1);
+				lua_pushnil(L);
+				return 1;
+			}
+			break;
+		}
+		lua_rawgeti(L, LUA_REGISTRYINDEX, value->i);
+		value->base.destroy(&value->base);
+		lua_rawseti(L, -2, ++done);
+	}
+	return 1;
+}
+
 static int
 luaT_fiber_channel_has_readers(struct lua_State *L)
 {
@@ -280,6 +378,8 @@ tarantool_lua_fiber_channel_init(struct lua_State *L)
 		{"is_empty",	luaT_fiber_channel_is_empty},
 		{"put",		luaT_fiber_channel_put},
 		{"get",		luaT_fiber_channel_get},
+		{"put_all",	luaT_fiber_channel_put_all},
+		{"get_all",	luaT_fiber_channel_get_all},
 		{"has_readers",	luaT_fiber_channel_has_readers},
 		{"has_writers",	luaT_fiber_channel_has_writers},
 		{"count",	luaT_fiber_channel_count},
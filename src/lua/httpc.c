@@ -141,6 +141,34 @@ parse_headers(lua_State *L, char *buffer, size_t len,
 
 enum { MAX_HTTP_HEADER_NAME_LEN = 32 };
 
+/** Context of a Lua body streaming callback. */
+struct luaT_httpc_body_ctx {
+	/** Lua state of the requesting fiber. */
+	lua_State *L;
+	/** Stack index of the Lua callback function. */
+	int cb_index;
+};
+
+/**
+ * Body streaming trampoline: copy the chunk into a Lua string
+ * and call the user supplied function with it.
+ */
+static int
+luaT_httpc_body_cb(void *ctx, const char *chunk, size_t len)
+{
+	struct luaT_httpc_body_ctx *body_ctx =
+		(struct luaT_httpc_body_ctx *) ctx;
+	lua_State *L = body_ctx->L;
+	lua_pushvalue(L, body_ctx->cb_index);
+	lua_pushlstring(L, chunk, len);
+	if (lua_pcall(L, 1, 0, 0) != 0) {
+		diag_set(LuajitError, lua_tostring(L, -1));
+		lua_pop(L, 1);
+		return -1;
+	}
+	return 0;
+}
+
 static int
 luaT_httpc_request(lua_State *L)
 {
@@ -320,6 +348,25 @@ luaT_httpc_request(lua_State *L)
 		httpc_set_accept_encoding(req, lua_tostring(L, -1));
 	lua_pop(L, 1);
 
+	struct luaT_httpc_body_ctx body_ctx;
+	lua_getfield(L, 5, "on_body");
+	if (!lua_isnil(L, -1)) {
+		if (!lua_isfunction(L, -1)) {
+			httpc_request_delete(req);
+			return luaL_error(L, "opts.on_body should be "
+					  "a function");
+		}
+		/*
+		 * Keep the callback on the stack so that the
+		 * index stays valid for the whole transfer.
+		 */
+		body_ctx.L = L;
+		body_ctx.cb_index = lua_gettop(L);
+		httpc_set_on_body(req, luaT_httpc_body_cb, &body_ctx);
+	} else {
+		lua_pop(L, 1);
+	}
+
 	if (httpc_execute(req, timeout) != 0) {
 		httpc_request_delete(req);
 		return luaT_error(L);
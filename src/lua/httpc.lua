@@ -299,6 +299,13 @@ end
 --      accept_encoding - enables automatic decompression of HTTP
 --          responses;
 --
+--      on_body - a function called with each chunk of the
+--          response body as it arrives instead of collecting
+--          the whole body in the response object. The response
+--          is returned without the 'body' field. The transfer
+--          is paused while the consumer lags behind and is
+--          aborted if the function raises an error;
+--
 --  Returns:
 --      {
 --          status=NUMBER,
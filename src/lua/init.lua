@@ -221,9 +221,93 @@ table.insert(package.loaders, 5, gen_loader_func(search_rocks_lib, load_lib))
 -- package.cpath  7
 -- croot          8
 
+-- Find a loader for a module the same way require() does: walk
+-- package.loaders and collect their complaints when none matches.
+--
+-- @param name module name
+-- @return a loader function, or nil and the concatenated errors
+local function search_loader(name)
+    local errors = {}
+    for _, loader in ipairs(package.loaders) do
+        local loaded = loader(name)
+        if type(loaded) == 'function' then
+            return loaded
+        elseif type(loaded) == 'string' then
+            table.insert(errors, loaded)
+        end
+    end
+    return nil, table.concat(errors)
+end
+
+local reload_generation = 0
+
+-- Reload application modules without pausing request processing.
+--
+-- The reload runs in two phases. First the new version of every
+-- module is searched, compiled and executed while the previous
+-- generation keeps serving calls - this part may yield freely,
+-- e.g. while module top-level code reads files or accesses box.
+-- Then the results are flipped into place without a single yield,
+-- so no fiber ever observes a mix of generations. When both the
+-- old and the new module value are tables, the flip is done in
+-- place, preserving the table identity: dispatch tables and
+-- closures which captured the module table start calling the new
+-- code immediately. Closures of the old generation still running
+-- in in-flight fibers keep their captured upvalues and are
+-- retired by the garbage collector when those fibers drain.
+--
+-- If loading any module fails, nothing is flipped and the old
+-- generation stays intact.
+--
+-- @param names a module name or an array of module names
+-- @return the new generation number
+local function reload(names)
+    if type(names) == 'string' then
+        names = { names }
+    end
+    assert(type(names) == 'table', 'Usage: package.reload(name | {names})')
+    -- Phase one: load the new generation in the background.
+    local new_values = {}
+    for _, name in ipairs(names) do
+        local loader, err = search_loader(name)
+        if loader == nil then
+            error(string.format("reload: module '%s' not found:%s",
+                                name, err))
+        end
+        local value = loader(name)
+        if value == nil then
+            -- require() caches modules which return nothing as
+            -- 'true' - keep the same convention on reload.
+            value = true
+        end
+        new_values[name] = value
+    end
+    -- Phase two: flip the generations. No yields below this
+    -- point, the swap is atomic with respect to other fibers.
+    for _, name in ipairs(names) do
+        local old = package.loaded[name]
+        local new = new_values[name]
+        if type(old) == 'table' and type(new) == 'table' then
+            setmetatable(old, nil)
+            for k in pairs(old) do
+                old[k] = nil
+            end
+            for k, v in pairs(new) do
+                old[k] = v
+            end
+            setmetatable(old, getmetatable(new))
+        else
+            package.loaded[name] = new
+        end
+    end
+    reload_generation = reload_generation + 1
+    return reload_generation
+end
+
 package.search = search
 package.searchroot = searchroot
 package.setsearchroot = setsearchroot
+package.reload = reload
 
 return {
     uptime = uptime;
@@ -19,6 +19,12 @@ ffi.cdef[[
     void
     say_set_log_level(int new_level);
 
+    int
+    say_set_module_level(const char *module, int level);
+
+    int64_t
+    say_drop_count(void);
+
     void
     say_set_log_format(enum say_format format);
 
@@ -127,6 +133,26 @@ local function log_level(level)
     return ffi.C.say_set_log_level(level)
 end
 
+-- Set a log level override for a subsystem: messages whose
+-- source file path contains the module name as a substring are
+-- filtered against this level instead of the global one, e.g.
+-- log.module_level('box/vy_', 7) enables debug logging for
+-- vinyl alone. Pass a negative level to drop the override.
+local function log_module_level(module, level)
+    if type(module) ~= 'string' or type(level) ~= 'number' then
+        error("Usage: log.module_level(module, level)")
+    end
+    if ffi.C.say_set_module_level(module, level) ~= 0 then
+        error("log.module_level: too many module overrides")
+    end
+end
+
+-- Number of messages dropped because the log device was not
+-- keeping up with a nonblocking logger.
+local function log_drop_count()
+    return tonumber64(ffi.C.say_drop_count())
+end
+
 local function log_format(format_name)
     if format_name == "json" then
         if ffi.C.log_type() == ffi.C.SAY_LOGGER_SYSLOG then
@@ -164,6 +190,8 @@ return setmetatable({
     rotate = log_rotate;
     pid = log_pid;
     level = log_level;
+    module_level = log_module_level;
+    drop_count = log_drop_count;
     log_format = log_format;
 }, {
     __index = compat_v16;
@@ -44,9 +44,18 @@
 #include "lua/decimal.h" /* lua_pushdecimal() */
 #include "lib/core/decimal.h" /* decimal_unpack() */
 #include "lib/core/mp_extension_types.h"
+#include "lib/uuid/mp_uuid.h" /* mp_decode_uuid() */
 
 #include <fiber.h>
 
+enum {
+	/**
+	 * Maximum capacity of the shared buffer kept allocated
+	 * between msgpack.encode() calls, see lua_msgpack_encode.
+	 */
+	LUAMP_BUF_KEEP_CAPACITY = 65536,
+};
+
 void
 luamp_error(void *error_ctx)
 {
@@ -191,6 +200,15 @@ restart: /* used by MP_EXT */
 		case MP_DECIMAL:
 			mpstream_encode_decimal(stream, field->decval);
 			return MP_EXT;
+		case MP_UUID:
+		{
+			char *data = mpstream_reserve(stream, mp_sizeof_uuid());
+			if (data == NULL)
+				return MP_EXT;
+			char *pos = mp_encode_uuid(data, field->uuidval);
+			mpstream_advance(stream, pos - data);
+			return MP_EXT;
+		}
 		default:
 			/* Run trigger if type can't be encoded */
 			type = luamp_encode_extension(L, top, stream);
@@ -316,6 +334,15 @@ luamp_decode(struct lua_State *L, struct luaL_serializer *cfg,
 			}
 			return;
 		}
+		case MP_UUID:
+		{
+			struct tt_uuid *uuid = luaL_pushuuid(L);
+			if (uuid_unpack(data, len, uuid) == NULL) {
+				lua_pop(L, -1);
+				luaL_error(L, "msgpack.decode: invalid MsgPack");
+			}
+			return;
+		}
 		default:
 			/* reset data to the extension header */
 			*data = svp;
@@ -361,7 +388,16 @@ lua_msgpack_encode(lua_State *L)
 		lua_pushinteger(L, ibuf_used(buf) - used);
 	} else {
 		lua_pushlstring(L, buf->buf, ibuf_used(buf));
-		ibuf_reinit(buf);
+		/*
+		 * Keep a modestly sized buffer allocated between
+		 * encodes instead of bouncing the slab off the
+		 * cache on every call. Abnormally grown buffers
+		 * are given back right away.
+		 */
+		if (ibuf_capacity(buf) > LUAMP_BUF_KEEP_CAPACITY)
+			ibuf_reinit(buf);
+		else
+			ibuf_reset(buf);
 	}
 	return 1;
 }
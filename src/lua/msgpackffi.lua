@@ -282,12 +282,21 @@ local function encode_r(buf, obj, level)
     end
 end
 
+-- Maximum capacity the shared encode buffer is allowed to keep
+-- between encodes. Recycling on every call returns the slab to
+-- the allocator just to take it back on the next encode, which
+-- churns the slab cache on hot serialization paths. Buffers that
+-- grew larger than this are still given back right away.
+local ENCODE_KEEP_CAPACITY = 65536
+
 local function encode(obj)
     local tmpbuf = buffer.IBUF_SHARED
     tmpbuf:reset()
     encode_r(tmpbuf, obj, 0)
     local r = ffi.string(tmpbuf.rpos, tmpbuf:size())
-    tmpbuf:recycle()
+    if tmpbuf:capacity() > ENCODE_KEEP_CAPACITY then
+        tmpbuf:recycle()
+    end
     return r
 end
 
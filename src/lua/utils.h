@@ -61,6 +61,18 @@ extern "C" {
 
 struct lua_State;
 struct ibuf;
+struct tt_uuid;
+
+/** CTypeID of 'struct tt_uuid', shared with the Lua uuid module. */
+extern uint32_t CTID_UUID;
+
+/**
+ * @brief Push an uninitialized uuid cdata onto the stack.
+ * @param L Lua State
+ * @return memory associated with the new cdata
+ */
+struct tt_uuid *
+luaL_pushuuid(struct lua_State *L);
 
 /**
  * Single global lua_State shared by core and modules.
@@ -320,6 +332,7 @@ struct luaL_field {
 		/* Array or map. */
 		uint32_t size;
 		decimal_t *decval;
+		struct tt_uuid *uuidval;
 	};
 	enum mp_type type;
 	/* subtypes of MP_EXT */
@@ -0,0 +1,369 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "lua/worker.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include <msgpuck.h>
+#include <coio_task.h>
+#include <fiber.h>
+#include <small/region.h>
+#include "tt_pthread.h"
+#include "mpstream.h"
+#include "lua/utils.h"
+#include "lua/error.h"
+#include "lua/msgpack.h"
+
+/**
+ * All Lua of the instance runs on the single tx thread state, so
+ * a CPU-bound Lua function stalls every request for its whole
+ * duration. This module keeps a small pool of detached Lua states
+ * with nothing but the standard libraries open and runs chunks on
+ * them from the eio thread pool via coio_call(), the same way
+ * digest.pbkdf2() offloads its hashing. The caller's fiber sleeps
+ * while the chunk runs, so other fibers keep being served.
+ *
+ * The states share nothing with the tx state: arguments and
+ * results cross the thread boundary as msgpack, and only plain
+ * values (nil, boolean, number, string, array, map) are allowed -
+ * tuples and extension types like decimal or uuid are backed by
+ * ctypes registered on the tx state only.
+ */
+
+enum {
+	/**
+	 * Max worker states, and so max chunks running at once.
+	 * More states would not help: the eio pool is about this
+	 * big, and each state holds its own chunk cache, which
+	 * is all warmed up independently.
+	 */
+	WORKER_POOL_MAX = 8,
+};
+
+/** Registry key of the per-state source -> chunk cache. */
+#define WORKER_CHUNK_CACHE "_WORKER_CHUNKS"
+
+static struct {
+	pthread_mutex_t mutex;
+	/** Signalled when a state is returned to the pool. */
+	pthread_cond_t cond;
+	/** States ready to take a call. */
+	struct lua_State *idle[WORKER_POOL_MAX];
+	int idle_count;
+	/** Number of states created so far, capped by the max. */
+	int count;
+} worker_pool = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	{NULL},
+	0,
+	0,
+};
+
+/** A plain realloc()ed buffer serving as an mpstream target. */
+struct worker_buf {
+	char *data;
+	size_t size;
+	size_t used;
+};
+
+static void *
+worker_buf_reserve_cb(void *ctx, size_t *size)
+{
+	struct worker_buf *buf = ctx;
+	if (buf->used + *size > buf->size) {
+		size_t new_size = buf->size > 0 ? buf->size : 1024;
+		while (buf->used + *size > new_size)
+			new_size *= 2;
+		char *data = realloc(buf->data, new_size);
+		if (data == NULL)
+			return NULL;
+		buf->data = data;
+		buf->size = new_size;
+	}
+	*size = buf->size - buf->used;
+	return buf->data + buf->used;
+}
+
+static void *
+worker_buf_alloc_cb(void *ctx, size_t size)
+{
+	struct worker_buf *buf = ctx;
+	buf->used += size;
+	return buf->data + buf->used - size;
+}
+
+/**
+ * A call shipped to a worker state. The source and the argument
+ * buffer stay valid for the whole call - the issuing fiber sleeps
+ * in coio_call() and owns them.
+ */
+struct worker_call {
+	/** Source text of the chunk to run. */
+	const char *src;
+	/** Length of @a src. */
+	size_t src_len;
+	/**
+	 * Msgpack array with the call arguments, on the calling
+	 * fiber's region.
+	 */
+	const char *args;
+	/** Msgpack array with the return values. */
+	struct worker_buf res;
+	/** Error message when the call failed, malloc()ed. */
+	char *error;
+};
+
+/**
+ * Check that msgpack data contains only plain types a detached
+ * state can decode. Advances @a data past the checked value.
+ */
+static int
+worker_mp_check_plain(const char **data)
+{
+	switch (mp_typeof(**data)) {
+	case MP_EXT:
+		return -1;
+	case MP_ARRAY: {
+		uint32_t count = mp_decode_array(data);
+		for (uint32_t i = 0; i < count; i++) {
+			if (worker_mp_check_plain(data) != 0)
+				return -1;
+		}
+		return 0;
+	}
+	case MP_MAP: {
+		uint32_t count = mp_decode_map(data);
+		for (uint32_t i = 0; i < 2 * count; i++) {
+			if (worker_mp_check_plain(data) != 0)
+				return -1;
+		}
+		return 0;
+	}
+	default:
+		mp_next(data);
+		return 0;
+	}
+}
+
+/**
+ * Take an idle state off the pool, creating one if the pool has
+ * not grown to the max yet. Blocks the eio thread while all the
+ * states are busy. Returns NULL if a new state can not be made.
+ */
+static struct lua_State *
+worker_state_take(void)
+{
+	tt_pthread_mutex_lock(&worker_pool.mutex);
+	while (worker_pool.idle_count == 0 &&
+	       worker_pool.count >= WORKER_POOL_MAX)
+		tt_pthread_cond_wait(&worker_pool.cond, &worker_pool.mutex);
+	if (worker_pool.idle_count > 0) {
+		struct lua_State *L =
+			worker_pool.idle[--worker_pool.idle_count];
+		tt_pthread_mutex_unlock(&worker_pool.mutex);
+		return L;
+	}
+	worker_pool.count++;
+	tt_pthread_mutex_unlock(&worker_pool.mutex);
+	/* Create outside the lock - luaL_openlibs() is not cheap. */
+	struct lua_State *L = luaL_newstate();
+	if (L == NULL) {
+		tt_pthread_mutex_lock(&worker_pool.mutex);
+		worker_pool.count--;
+		tt_pthread_cond_signal(&worker_pool.cond);
+		tt_pthread_mutex_unlock(&worker_pool.mutex);
+		return NULL;
+	}
+	luaL_openlibs(L);
+	lua_newtable(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, WORKER_CHUNK_CACHE);
+	return L;
+}
+
+static void
+worker_state_put(struct lua_State *L)
+{
+	tt_pthread_mutex_lock(&worker_pool.mutex);
+	assert(worker_pool.idle_count < WORKER_POOL_MAX);
+	worker_pool.idle[worker_pool.idle_count++] = L;
+	tt_pthread_cond_signal(&worker_pool.cond);
+	tt_pthread_mutex_unlock(&worker_pool.mutex);
+}
+
+/**
+ * Run a call on a worker state. Protected by lua_cpcall(), so
+ * raising a Lua error anywhere here is fine.
+ */
+static int
+worker_exec(struct lua_State *L)
+{
+	struct worker_call *call = lua_touserdata(L, 1);
+	lua_pop(L, 1);
+	/*
+	 * Chunks are compiled once per state and cached by their
+	 * source, which is what makes a repeated call two orders
+	 * of magnitude cheaper than spawning anything external.
+	 */
+	lua_getfield(L, LUA_REGISTRYINDEX, WORKER_CHUNK_CACHE);
+	lua_pushlstring(L, call->src, call->src_len);
+	lua_rawget(L, -2);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		if (luaL_loadbuffer(L, call->src, call->src_len,
+				    "=worker") != 0)
+			return lua_error(L);
+		lua_pushlstring(L, call->src, call->src_len);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+	}
+	lua_remove(L, -2); /* the cache */
+	const char *p = call->args;
+	uint32_t arg_count = mp_decode_array(&p);
+	for (uint32_t i = 0; i < arg_count; i++)
+		luamp_decode(L, luaL_msgpack_default, &p);
+	lua_call(L, arg_count, LUA_MULTRET);
+	int ret_count = lua_gettop(L);
+	struct mpstream stream;
+	mpstream_init(&stream, &call->res, worker_buf_reserve_cb,
+		      worker_buf_alloc_cb, luamp_error, L);
+	mpstream_encode_array(&stream, ret_count);
+	for (int i = 1; i <= ret_count; i++)
+		luamp_encode(L, luaL_msgpack_default, &stream, i);
+	mpstream_flush(&stream);
+	lua_settop(L, 0);
+	return 0;
+}
+
+/** coio_call() callback: the part running on an eio thread. */
+static ssize_t
+worker_call_f(va_list ap)
+{
+	struct worker_call *call = va_arg(ap, struct worker_call *);
+	struct lua_State *L = worker_state_take();
+	if (L == NULL) {
+		call->error = strdup("failed to create a worker Lua state");
+		return 0;
+	}
+	if (lua_cpcall(L, worker_exec, call) != 0) {
+		const char *msg = lua_tostring(L, -1);
+		call->error = strdup(msg != NULL ? msg : "unknown error");
+		lua_settop(L, 0);
+	}
+	worker_state_put(L);
+	return 0;
+}
+
+/**
+ * worker.call(src, ...) - compile @a src as a Lua chunk on a
+ * detached worker state, call it on an eio thread with the rest
+ * of the arguments accessible as `...`, and return whatever it
+ * returns. The chunk sees only the standard Lua libraries, not
+ * the tarantool built-ins, and only plain values may cross the
+ * boundary. The calling fiber sleeps for the duration, the tx
+ * thread does not.
+ */
+static int
+lua_worker_call(struct lua_State *L)
+{
+	size_t src_len;
+	const char *src = lua_tolstring(L, 1, &src_len);
+	if (src == NULL)
+		return luaL_error(L, "Usage: worker.call(src, ...)");
+	int top = lua_gettop(L);
+	struct worker_call call;
+	memset(&call, 0, sizeof(call));
+	call.src = src;
+	call.src_len = src_len;
+	/*
+	 * Encode the arguments on the fiber region: luamp_encode()
+	 * raises a Lua error on a non-encodable value or OOM, and
+	 * the region is reclaimed by the fiber either way, while a
+	 * malloc'ed buffer would leak on the longjmp.
+	 */
+	struct region *gc = &fiber()->gc;
+	size_t used = region_used(gc);
+	struct mpstream stream;
+	mpstream_init(&stream, gc, region_reserve_cb, region_alloc_cb,
+		      luamp_error, L);
+	mpstream_encode_array(&stream, top - 1);
+	for (int i = 2; i <= top; i++)
+		luamp_encode(L, luaL_msgpack_default, &stream, i);
+	mpstream_flush(&stream);
+	size_t args_size = region_used(gc) - used;
+	call.args = region_join(gc, args_size);
+	if (call.args == NULL) {
+		diag_set(OutOfMemory, args_size, "region", "region_join");
+		region_truncate(gc, used);
+		return luaT_error(L);
+	}
+	const char *p = call.args;
+	if (worker_mp_check_plain(&p) != 0) {
+		region_truncate(gc, used);
+		return luaL_error(L, "worker.call: arguments must be "
+				  "plain Lua values");
+	}
+	int rc = coio_call(worker_call_f, &call);
+	region_truncate(gc, used);
+	if (rc < 0 && call.error == NULL && call.res.data == NULL)
+		return luaT_error(L);
+	if (call.error != NULL) {
+		free(call.res.data);
+		lua_pushstring(L, call.error);
+		free(call.error);
+		return lua_error(L);
+	}
+	if (call.res.data == NULL)
+		return luaL_error(L, "worker.call: out of memory");
+	const char *r = call.res.data;
+	uint32_t ret_count = mp_decode_array(&r);
+	for (uint32_t i = 0; i < ret_count; i++)
+		luamp_decode(L, luaL_msgpack_default, &r);
+	free(call.res.data);
+	return ret_count;
+}
+
+void
+tarantool_lua_worker_init(struct lua_State *L)
+{
+	static const struct luaL_Reg lua_worker_methods[] = {
+		{"call", lua_worker_call},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "worker", lua_worker_methods);
+	lua_pop(L, 1);
+}
@@ -71,6 +71,7 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 #cmakedefine HAVE_MADV_DONTNEED 1
+#cmakedefine HAVE_MADV_FREE 1
 /*
  * Defined if O_DSYNC mode exists for open(2).
  */
@@ -170,6 +171,7 @@
 #cmakedefine HAVE_FALLOCATE 1
 #cmakedefine HAVE_MREMAP 1
 #cmakedefine HAVE_SYNC_FILE_RANGE 1
+#cmakedefine HAVE_IO_URING_H 1
 
 #cmakedefine HAVE_MSG_NOSIGNAL 1
 #cmakedefine HAVE_SO_NOSIGPIPE 1
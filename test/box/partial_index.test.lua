@@ -0,0 +1,74 @@
+test_run = require('test_run').new()
+
+--
+-- Partial indexes: a secondary memtx index created with a
+-- 'predicate' option only stores the tuples satisfying the
+-- expression.
+--
+s = box.schema.space.create('test')
+s:format({{'id', 'unsigned'}, {'status', 'string'}, {'payload', 'unsigned'}})
+_ = s:create_index('pk')
+
+-- A primary key can not be partial.
+bad = box.schema.space.create('bad')
+bad:format({{'id', 'unsigned'}, {'status', 'string'}})
+ok, err = pcall(bad.create_index, bad, 'pk', {predicate = [["status" = 'pending']]})
+ok
+err.code == box.error.MODIFY_INDEX
+bad:drop()
+
+-- Neither can a vinyl index.
+v = box.schema.space.create('vbad', {engine = 'vinyl'})
+v:format({{'id', 'unsigned'}, {'status', 'string'}})
+_ = v:create_index('pk')
+v:create_index('sk', {parts = {2, 'string'}, predicate = [["status" = 'pending']]})
+v:drop()
+
+-- Building a partial index over existing data filters out the
+-- tuples the predicate rejects.
+for i = 1, 10 do s:insert{i, i % 2 == 0 and 'pending' or 'done', i} end
+sk = s:create_index('sk', {parts = {2, 'string'}, unique = false, predicate = [["status" = 'pending']]})
+sk:count()
+sk:select('done')
+#sk:select('pending')
+
+-- Inserts on both sides of the predicate boundary.
+s:insert{11, 'pending', 11}
+s:insert{12, 'done', 12}
+sk:count()
+
+-- An update moving a tuple across the boundary changes its
+-- membership.
+s:update(11, {{'=', 2, 'done'}})
+sk:count()
+s:update(12, {{'=', 2, 'pending'}})
+sk:count()
+
+-- Deletes of a member and of a non-member.
+s:delete(12)
+s:delete(11)
+sk:count()
+
+-- Rollback restores membership.
+test_run:cmd("setopt delimiter ';'")
+function rollback_update()
+    box.begin()
+    s:update(2, {{'=', 2, 'done'}})
+    local cnt = sk:count()
+    box.rollback()
+    return cnt
+end;
+function rollback_insert()
+    box.begin()
+    s:insert{13, 'pending', 13}
+    local cnt = sk:count()
+    box.rollback()
+    return cnt
+end;
+test_run:cmd("setopt delimiter ''");
+rollback_update()
+sk:count()
+rollback_insert()
+sk:count()
+
+s:drop()
@@ -0,0 +1,54 @@
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 100 do s:insert{i, i} end
+
+--
+-- Full scan sees all the tuples in the primary key order.
+--
+keys = {}
+for _, tuple in s:snapshot_pairs() do table.insert(keys, tuple[1]) end
+#keys
+keys[1]
+keys[100]
+
+--
+-- A scan iterates a read view: writes made after the scan is
+-- opened are not visible to it, but are visible to readers.
+--
+gen = s:snapshot_pairs()
+s:replace{1, 1000}
+s:insert{101, 101}
+n = 0
+for _, tuple in gen do n = n + 1 end
+n
+s:get(1)[2]
+s:len()
+
+--
+-- Index scans work too and follow the index order.
+--
+_ = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+first = nil
+for _, tuple in s.index.sk:snapshot_pairs() do first = first or tuple[2] end
+first
+
+--
+-- Only engines supporting consistent read views can be scanned.
+--
+_ = s:create_index('bs', {type = 'bitset', unique = false, parts = {2, 'unsigned'}})
+ok, err = pcall(s.index.bs.snapshot_pairs, s.index.bs)
+ok
+tostring(err):match('does not support consistent read view') ~= nil
+
+s:drop()
+
+--
+-- Empty space and space without indexes.
+--
+e = box.schema.space.create('empty')
+_ = e:create_index('pk')
+e:snapshot_pairs():totable()
+e:drop()
+noidx = box.schema.space.create('noidx')
+noidx:snapshot_pairs():totable()
+noidx:drop()
@@ -659,3 +659,16 @@ _ = s:replace{1, dbl1, {{key1 = {key2 = {1, dbl1}}}}}
 s:update({1}, {{'+', 'field3[1].key1.key2[2]', dbl1}})
 
 s:drop()
+
+--
+-- Updating a format-typed non-indexed field must respect the
+-- declared type even when the new value has the same encoded
+-- width as the old one.
+--
+s = box.schema.create_space('test', {format = {{'f1', 'unsigned'}, {'f2', 'unsigned'}}})
+_ = s:create_index('pk')
+s:replace{1, 1}
+s:update({1}, {{'=', 2, true}})
+s:update({1}, {{'-', 2, 10}})
+s:get{1}
+s:drop()
@@ -0,0 +1,139 @@
+#include "unit.h"
+#include "mp_fast_check.h"
+#include "msgpuck.h"
+#include <string.h>
+
+/**
+ * Check that mp_fast_check() agrees with mp_check() on the buffer
+ * itself and on every truncated prefix of it, both in the verdict
+ * and in the advanced position when the buffer is valid.
+ */
+static bool
+matches_mp_check(const char *data, size_t size)
+{
+	for (size_t cut = 0; cut <= size; cut++) {
+		const char *a = data;
+		const char *b = data;
+		bool va = mp_check(&a, data + cut) == 0;
+		bool vb = mp_fast_check(&b, data + cut) == 0;
+		if (va != vb)
+			return false;
+		if (va && a != b)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Replace every byte of the buffer in turn with 0xc1, a reserved
+ * msgpack marker, and check that mp_fast_check() gives the same
+ * verdict as mp_check(). Inside a string or binary payload the
+ * byte is legal, so both verdicts may well stay positive.
+ */
+static bool
+matches_mp_check_corrupt(char *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		char saved = data[i];
+		data[i] = (char)0xc1;
+		const char *a = data;
+		const char *b = data;
+		bool va = mp_check(&a, data + size) == 0;
+		bool vb = mp_fast_check(&b, data + size) == 0;
+		bool same = va == vb && (!va || a == b);
+		data[i] = saved;
+		if (!same)
+			return false;
+	}
+	return true;
+}
+
+static char *
+encode_small_int(char *w, int v)
+{
+	if (v < 0)
+		return mp_encode_int(w, v);
+	return mp_encode_uint(w, v);
+}
+
+int
+main(void)
+{
+	plan(12);
+
+	char buf[1024];
+	char *w;
+
+	/* A flat array of fixints - the vectorized case. */
+	w = buf;
+	w = mp_encode_array(w, 100);
+	for (int i = 0; i < 100; i++)
+		w = encode_small_int(w, i % 64 - 32);
+	ok(matches_mp_check(buf, w - buf), "flat fixint array");
+	ok(matches_mp_check_corrupt(buf, w - buf),
+	   "flat fixint array corruption");
+
+	/* An array of mixed scalars - per-element fallback. */
+	w = buf;
+	w = mp_encode_array(w, 6);
+	w = mp_encode_uint(w, 1234567890123ULL);
+	w = mp_encode_int(w, -1234567890);
+	w = mp_encode_str(w, "hello", 5);
+	w = mp_encode_double(w, 3.14);
+	w = mp_encode_nil(w);
+	w = mp_encode_bool(w, true);
+	ok(matches_mp_check(buf, w - buf), "mixed scalar array");
+	ok(matches_mp_check_corrupt(buf, w - buf),
+	   "mixed scalar array corruption");
+
+	/* Nested containers with fixint runs inside. */
+	w = buf;
+	w = mp_encode_map(w, 2);
+	w = mp_encode_str(w, "key", 3);
+	w = mp_encode_array(w, 40);
+	for (int i = 0; i < 40; i++)
+		w = encode_small_int(w, i);
+	w = encode_small_int(w, 7);
+	w = mp_encode_map(w, 1);
+	w = encode_small_int(w, 1);
+	w = mp_encode_str(w, "value", 5);
+	ok(matches_mp_check(buf, w - buf), "nested containers");
+	ok(matches_mp_check_corrupt(buf, w - buf),
+	   "nested containers corruption");
+
+	/* A map of fixints larger than one SSE chunk. */
+	w = buf;
+	w = mp_encode_map(w, 50);
+	for (int i = 0; i < 50; i++) {
+		w = encode_small_int(w, i % 64 - 32);
+		w = encode_small_int(w, -i % 32);
+	}
+	ok(matches_mp_check(buf, w - buf), "flat fixint map");
+	ok(matches_mp_check_corrupt(buf, w - buf),
+	   "flat fixint map corruption");
+
+	/* Empty containers. */
+	w = buf;
+	w = mp_encode_array(w, 1);
+	w = mp_encode_array(w, 0);
+	ok(matches_mp_check(buf, w - buf), "empty array");
+	w = buf;
+	w = mp_encode_map(w, 0);
+	ok(matches_mp_check(buf, w - buf), "empty map");
+
+	/* A top-level scalar is delegated to mp_check(). */
+	w = buf;
+	w = mp_encode_str(w, "scalar", 6);
+	ok(matches_mp_check(buf, w - buf), "top-level scalar");
+
+	/* An array32 header with a huge count and no elements. */
+	w = buf;
+	*w++ = (char)0xdd;
+	*w++ = (char)0xb2;
+	*w++ = (char)0xd0;
+	*w++ = (char)0x5e;
+	*w++ = (char)0x00;
+	ok(matches_mp_check(buf, w - buf), "truncated huge array");
+
+	return check_plan();
+}
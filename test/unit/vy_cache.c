@@ -133,12 +133,82 @@ test_basic()
 	footer();
 }
 
+static void
+test_scan_resistance()
+{
+	header();
+	plan(7);
+	struct vy_cache cache;
+	uint32_t fields[] = { 0 };
+	uint32_t types[] = { FIELD_TYPE_UNSIGNED };
+	struct key_def *key_def;
+	struct tuple_format *format;
+	create_test_cache(fields, types, lengthof(fields), &cache, &key_def,
+			  &format);
+
+	/*
+	 * Fill the cache with a chain, as a range scan would do.
+	 */
+	const struct vy_stmt_template chain[] = {
+		STMT_TEMPLATE(1, REPLACE, 100),
+		STMT_TEMPLATE(2, REPLACE, 200),
+		STMT_TEMPLATE(3, REPLACE, 300),
+		STMT_TEMPLATE(4, REPLACE, 400),
+		STMT_TEMPLATE(5, REPLACE, 500),
+		STMT_TEMPLATE(6, REPLACE, 600),
+	};
+	vy_cache_insert_templates_chain(&cache, format, chain,
+					lengthof(chain), &key_template,
+					ITER_GE);
+	is(cache_env.mem_used_protected, 0,
+	   "scan data does not get to the protected list");
+
+	/*
+	 * A point lookup promotes the found statement to the
+	 * protected list.
+	 */
+	const struct vy_stmt_template hot_template =
+		STMT_TEMPLATE(0, SELECT, 300);
+	struct vy_entry hot_key = vy_new_simple_stmt(format, key_def,
+						     &hot_template);
+	struct vy_entry found = vy_cache_get(&cache, hot_key);
+	ok(found.stmt != NULL, "hot key is found");
+	ok(cache_env.mem_used_protected > 0, "hot key is promoted");
+	is(cache.stat.promote.rows, 1, "promotion is accounted");
+	vy_cache_get(&cache, hot_key);
+	is(cache.stat.promote.rows, 1, "repeated get does not promote again");
+
+	/*
+	 * Shrink the quota to the size of the protected list:
+	 * the probationary list must be evicted completely while
+	 * the hot key survives.
+	 */
+	vy_cache_env_set_quota(&cache_env, cache_env.mem_used_protected);
+	found = vy_cache_get(&cache, hot_key);
+	ok(found.stmt != NULL, "hot key survives eviction");
+
+	const struct vy_stmt_template cold_template =
+		STMT_TEMPLATE(0, SELECT, 100);
+	struct vy_entry cold_key = vy_new_simple_stmt(format, key_def,
+						      &cold_template);
+	found = vy_cache_get(&cache, cold_key);
+	ok(found.stmt == NULL, "cold key is evicted");
+
+	vy_cache_env_set_quota(&cache_env, 1LLU * 1024LLU * 1024LLU * 1024LLU);
+	tuple_unref(hot_key.stmt);
+	tuple_unref(cold_key.stmt);
+	destroy_test_cache(&cache, key_def, format);
+	check_plan();
+	footer();
+}
+
 int
 main()
 {
 	vy_iterator_C_test_init(1LLU * 1024LLU * 1024LLU * 1024LLU);
 
 	test_basic();
+	test_scan_resistance();
 
 	vy_iterator_C_test_finish();
 	return 0;
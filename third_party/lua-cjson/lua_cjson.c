@@ -48,6 +48,7 @@
 #include "strbuf.h"
 
 #include "lua/utils.h"
+#include "lib/uuid/tt_uuid.h"
 
 #define DEFAULT_ENCODE_KEEP_BUFFER 1
 
@@ -427,6 +428,11 @@ static void json_append_data(lua_State *l, struct luaL_serializer *cfg,
 	    const char *str = decimal_to_string(field.decval);
 	    return json_append_string(cfg, json, str, strlen(str));
 	}
+	case MP_UUID:
+	{
+	    const char *str = tt_uuid_str(field.uuidval);
+	    return json_append_string(cfg, json, str, UUID_STR_LEN);
+	}
 	default:
 	    assert(false);
 	}
@@ -50,6 +50,7 @@ extern "C" {
 } /* extern "C" */
 #include "lua/utils.h"
 #include "lib/core/decimal.h"
+#include "lib/uuid/tt_uuid.h"
 
 #define LUAYAML_TAG_PREFIX "tag:yaml.org,2002:"
 
@@ -699,6 +700,10 @@ static int dump_node(struct lua_yaml_dumper *dumper)
          str = decimal_to_string(field.decval);
 	 len = strlen(str);
 	 break;
+      case MP_UUID:
+         str = tt_uuid_str(field.uuidval);
+	 len = UUID_STR_LEN;
+	 break;
       default:
 	 assert(0); /* checked by luaL_checkfield() */
       }
@@ -0,0 +1,80 @@
+#!/usr/bin/env tarantool
+--
+-- Dump a columnar snapshot segment as CSV.
+--
+-- Segments (<lsn>.<space_id>.colseg) are written next to .snap
+-- files when box.cfg.checkpoint_columnar is enabled. A segment is
+-- a plain msgpack stream: a header map followed by record batch
+-- maps, with the column values packed into typed contiguous
+-- arrays in host byte order - see the colseg writer in
+-- src/box/memtx_engine.c for the exact layout.
+--
+-- Usage: tarantool colseg-dump.lua FILE.colseg
+--
+local ffi = require('ffi')
+local bit = require('bit')
+local msgpackffi = require('msgpackffi')
+
+local filename = arg[1]
+if filename == nil then
+    io.stderr:write('usage: tarantool colseg-dump.lua FILE.colseg\n')
+    os.exit(1)
+end
+
+local f, err = io.open(filename, 'rb')
+if f == nil then
+    io.stderr:write(('colseg-dump: %s\n'):format(err))
+    os.exit(1)
+end
+local body = f:read('*a')
+f:close()
+
+local header, offset = msgpackffi.decode_unchecked(body)
+io.stderr:write(('space %d, %d columns\n'):format(header.space_id,
+                                                  #header.columns))
+
+local names = {}
+for _, col in ipairs(header.columns) do
+    names[#names + 1] = ('field%d_%s'):format(col.field, col.type)
+end
+print(table.concat(names, ','))
+
+local value_ctypes = {
+    unsigned = ffi.typeof('const uint64_t *'),
+    integer = ffi.typeof('const int64_t *'),
+    double = ffi.typeof('const double *'),
+}
+local u32_ptr = ffi.typeof('const uint32_t *')
+local char_ptr = ffi.typeof('const char *')
+
+local function is_valid(validity, row)
+    local byte = validity:byte(math.floor(row / 8) + 1)
+    return bit.band(bit.rshift(byte, row % 8), 1) == 1
+end
+
+while offset <= #body do
+    local batch
+    batch, offset = msgpackffi.decode_unchecked(body, offset)
+    for row = 0, batch.rows - 1 do
+        local line = {}
+        for i, col in ipairs(header.columns) do
+            local blobs = batch.columns[i]
+            local value = ''
+            if is_valid(blobs[1], row) then
+                if col.type == 'string' then
+                    local ends = ffi.cast(u32_ptr, blobs[2])
+                    local data = ffi.cast(char_ptr, blobs[3])
+                    local first = row == 0 and 0 or ends[row - 1]
+                    value = ffi.string(data + first, ends[row] - first)
+                    value = '"' .. value:gsub('"', '""') .. '"'
+                else
+                    local values = ffi.cast(value_ctypes[col.type], blobs[2])
+                    -- Strip the LL/ULL suffix off 64-bit cdata.
+                    value = tostring(values[row]):gsub('[UL]+$', '')
+                end
+            end
+            line[#line + 1] = value
+        end
+        print(table.concat(line, ','))
+    end
+end